@@ -16,7 +16,9 @@ let package = Package(
     targets: [
         .executableTarget(
             name: "Vocana",
-            dependencies: [],
+            dependencies: ["VocanaAudioTransport", "VocanaDSP"],
+            // the ONNX Runtime bridge is C and needs the library, so it builds on its own
+            exclude: ["ML/ONNXRuntimeBridge.c"],
             linkerSettings: [
                 .linkedFramework("Metal"),
                 .linkedFramework("MetalPerformanceShaders")
@@ -28,7 +30,17 @@ let package = Package(
             dependencies: [],
 
             sources: [
-                "VocanaAudioServerPlugin.c"
+                "VocanaAudioServerPlugin.c",
+                // symlinked from VocanaAudioDriver, which shares these with this plugin
+                "VocanaAudioTransport.c",
+                "VocanaChannels.c",
+                "VocanaClientScratch.c",
+                "VocanaMixBus.c",
+                "VocanaPipeline.c",
+                "VocanaProcessor.c",
+                "VocanaPropertyTable.c",
+                "VocanaRingBuffer.c",
+                "VocanaSpectralGate.c"
             ],
             cSettings: [
                 .headerSearchPath("include"),
@@ -42,6 +54,21 @@ let package = Package(
                 .linkedFramework("CoreServices")  // For XPC
             ]
         ),
+        // The app's end of the plugin's shared-memory audio transport, and the resampler that
+        // brings the plugin's audio to the models' rate (symlinked from VocanaAudioDriver)
+        .target(
+            name: "VocanaAudioTransport",
+            dependencies: [],
+            linkerSettings: [
+                .linkedFramework("Accelerate")
+            ]
+        ),
+        // The native signal processing under the models: the 960-point FFT, the streaming STFT, the
+        // spectrogram storage the pipeline runs on and the packed layers the native session runs
+        .target(
+            name: "VocanaDSP",
+            dependencies: []
+        ),
         .testTarget(
             name: "VocanaTests",
             dependencies: ["Vocana"]
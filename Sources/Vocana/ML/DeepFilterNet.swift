@@ -15,7 +15,7 @@ import os.log
 /// **Thread Safety**: This class IS thread-safe for external calls using a dual-queue architecture:
 /// 
 /// - **stateQueue**: Protects neural network state tensors (_states) with fine-grained locking
-/// - **processingQueue**: Protects audio processing pipeline and overlapBuffer with coarse-grained locking
+/// - **processingQueue**: Protects audio processing pipeline, overlapBuffer and the streaming state with coarse-grained locking
 /// 
 /// **Queue Hierarchy**: stateQueue and processingQueue are independent - no nested locking occurs.
 /// The reset() method accesses each queue separately to avoid deadlocks.
@@ -31,6 +31,9 @@ import os.log
 /// ```swift
 /// let denoiser = try DeepFilterNet(modelsDirectory: "path/to/models")
 /// let enhanced = try denoiser.process(audio: audioSamples)
+///
+/// // Streaming: exactly hopSize samples in and out per call, streamingLatency samples behind
+/// let enhancedHop = try denoiser.processHop(nextHop)
 /// ```
 ///
 /// **Error Handling Patterns**:
@@ -81,6 +84,24 @@ final class DeepFilterNet: @unchecked Sendable {
     // Protected by: processingQueue
     private var overlapBuffer: [Float] = []
     
+    // Spectrum and features of process(audio:)'s window, reused from call to call
+    // Protected by: processingQueue
+    private let windowSpectrum = Spectrogram(frameCount: 0, binCount: AppConstants.fftSize / 2 + 1)
+    private let windowERB = Spectrogram(frameCount: 0, binCount: AppConstants.erbBands, complex: false)
+    private let windowSpec = Spectrogram(frameCount: 0, binCount: AppConstants.dfBands)
+    
+    // Running feature normalization of the denoiser's own stream, which process(audio:) and
+    // processHop(_:) both carry on from one call to the next
+    // Protected by: processingQueue
+    private let normalization = FeatureNormalization(alpha: DeepFilterNet.normalizationAlpha)
+    
+    // State of the stream processHop(_:) works on, created on its first hop
+    // Protected by: processingQueue
+    private var stream: StreamState?
+    
+    /// Prefix of the model outputs that carry recurrent state from one hop to the next
+    private static let recurrentStatePrefix = "new_"
+    
     // Logging
     private static let logger = Logger(subsystem: "com.vocana.ml", category: "DeepFilterNet")
     
@@ -226,6 +247,8 @@ final class DeepFilterNet: @unchecked Sendable {
          group.enter()
          processingQueue.async { [weak self] in
              self?.overlapBuffer.removeAll()
+             self?.stream = nil
+             self?.normalization.reset()
              group.leave()
          }
          
@@ -249,6 +272,8 @@ final class DeepFilterNet: @unchecked Sendable {
         
         processingQueue.sync {
             overlapBuffer.removeAll()
+            stream = nil
+            normalization.reset()
         }
         
         Self.logger.info("DeepFilterNet sync reset completed - cleared states and overlap buffer")
@@ -276,83 +301,77 @@ final class DeepFilterNet: @unchecked Sendable {
                 }
             }
             
-            // Fix LOW: Add denormal detection
-            // Fix CRITICAL-006: Comprehensive audio input validation
-            guard audio.allSatisfy({ sample in
-                sample.isFinite && 
-                abs(sample) <= AppConstants.maxAudioAmplitude &&
-                (sample.isZero || abs(sample) >= Float.leastNormalMagnitude)
-            }) else {
-                let invalidSamples = audio.enumerated().compactMap { index, sample in
-                    if sample.isNaN { return "NaN at \(index)" }
-                    if sample.isInfinite { return "Infinity at \(index)" }
-                    if abs(sample) > AppConstants.maxAudioAmplitude { return "Amplitude \(sample) at \(index)" }
-                    if !sample.isZero && abs(sample) < Float.leastNormalMagnitude { return "Denormal \(sample) at \(index)" }
-                    return nil
-                }
-                throw DeepFilterError.processingFailed("Invalid audio values detected: \(invalidSamples.prefix(5).joined(separator: ", "))")
-            }
-            
-            // Check for denormals (can slow down processing 100x)
-            #if DEBUG
-            let denormals = audio.filter { $0 != 0 && abs($0) < Float.leastNormalMagnitude }
-            if !denormals.isEmpty {
-                Self.logger.warning("Input contains \(denormals.count) denormal values")
-            }
-            #endif
+            try self.validateSamples(audio)
             
             return try self.processInternal(audio: audio)
         }
     }
     
+    /// Reject audio the models must not see
+    /// - Throws: DeepFilterError.processingFailed for NaN, infinite, out-of-range or denormal samples
+    private func validateSamples(_ audio: [Float]) throws {
+        // Fix LOW: Add denormal detection
+        // Fix CRITICAL-006: Comprehensive audio input validation
+        guard audio.allSatisfy({ sample in
+            sample.isFinite && 
+            abs(sample) <= AppConstants.maxAudioAmplitude &&
+            (sample.isZero || abs(sample) >= Float.leastNormalMagnitude)
+        }) else {
+            let invalidSamples = audio.enumerated().compactMap { index, sample in
+                if sample.isNaN { return "NaN at \(index)" }
+                if sample.isInfinite { return "Infinity at \(index)" }
+                if abs(sample) > AppConstants.maxAudioAmplitude { return "Amplitude \(sample) at \(index)" }
+                if !sample.isZero && abs(sample) < Float.leastNormalMagnitude { return "Denormal \(sample) at \(index)" }
+                return nil
+            }
+            throw DeepFilterError.processingFailed("Invalid audio values detected: \(invalidSamples.prefix(5).joined(separator: ", "))")
+        }
+        
+        // Check for denormals (can slow down processing 100x)
+        #if DEBUG
+        let denormals = audio.filter { $0 != 0 && abs($0) < Float.leastNormalMagnitude }
+        if !denormals.isEmpty {
+            Self.logger.warning("Input contains \(denormals.count) denormal values")
+        }
+        #endif
+    }
+    
     private func processInternal(audio: [Float]) throws -> [Float] {
         
         do {
-            // 1. STFT - Convert to frequency domain
-            let spectrum2D = stft.transform(audio)
+            // 1. STFT - Convert to frequency domain, straight into the window's spectrogram
+            stft.transform(audio, into: windowSpectrum)
             
             // Fix HIGH: Validate STFT output
-            guard !spectrum2D.real.isEmpty, !spectrum2D.imag.isEmpty else {
+            let numFrames = windowSpectrum.frameCount
+            guard numFrames > 0 else {
                 Self.logger.warning("STFT returned empty spectrum for \(audio.count) samples")
                 return audio  // Not enough samples, return input as-is
             }
             
             // Fix HIGH: Validate spectrum dimensions
             let expectedBins = fftSize / 2 + 1
-            if let firstFrame = spectrum2D.real.first, firstFrame.count != expectedBins {
-                Self.logger.error("STFT returned \(firstFrame.count) bins, expected \(expectedBins)")
+            guard windowSpectrum.binCount == expectedBins else {
+                Self.logger.error("STFT returned \(self.windowSpectrum.binCount) bins, expected \(expectedBins)")
                 throw DeepFilterError.processingFailed("Invalid STFT output dimensions")
             }
-            
-            // OPTIMIZED: Use flatMap for O(n) complexity (already optimal)
-            // flatMap is O(n) - each element is visited exactly once
-            let spectrumReal = spectrum2D.real.flatMap { $0 }
-            let spectrumImag = spectrum2D.imag.flatMap { $0 }
-            let spectrum = (real: spectrumReal, imag: spectrumImag)
 
             // 2. Extract features
-            let erbFeat = try extractERBFeatures(spectrum2D: spectrum2D)
-            let specFeat = try extractSpectralFeatures(spectrum2D: spectrum2D)
+            let erbFeat = try extractERBFeatures(spectrum: windowSpectrum)
+            let specFeat = try extractSpectralFeatures(spectrum: windowSpectrum)
 
             // 3. Run encoder
             let encoderOutputs = try runEncoder(erbFeat: erbFeat, specFeat: specFeat)
 
             // 4. Run decoders
-            let mask = try runERBDecoder(states: encoderOutputs)
-            let coefficients = try runDFDecoder(states: encoderOutputs)
+            let (mask, coefficients) = try runDecoders(states: encoderOutputs, frameCount: numFrames)
 
-            // 5. Apply filtering
-            let enhanced = try applyFiltering(
-                spectrum: spectrum,
-                mask: mask,
-                coefficients: coefficients
-            )
+            // 5. Apply filtering to every frame, in place
+            try applyFiltering(spectrum: windowSpectrum, mask: mask, coefficients: coefficients)
             
             // 6. ISTFT - Convert back to time domain
             // Fix CRITICAL: Preserve ISTFT overlap for proper COLA reconstruction
-            let enhancedReal2D = [enhanced.real]
-            let enhancedImag2D = [enhanced.imag]
-            let outputAudio = stft.inverse(real: enhancedReal2D, imag: enhancedImag2D)
+            let outputAudio = stft.inverse(windowSpectrum)
             
             // Accumulate overlap and return exactly hopSize samples
             overlapBuffer.append(contentsOf: outputAudio)
@@ -387,72 +406,236 @@ final class DeepFilterNet: @unchecked Sendable {
         }
     }
     
+    // MARK: - Streaming
+    
+    /// Everything that carries over from one hop of a stream to the next
+    private final class StreamState {
+        let stft: StreamingSTFT
+        
+        /// Spectrum of the current frame, enhanced in place
+        let spectrum: Spectrogram
+        
+        /// ERB band levels of the current frame in dB
+        let bands: Spectrogram
+        var output: [Float]
+        
+        /// Running normalization of the ERB and deep filtering features
+        let normalization: FeatureNormalization
+        
+        /// Deep filter over the stream's last frames
+        let deepFilter: StreamingDeepFilter
+        
+        /// Recurrent state each model returned on the last hop, by model. The decoders run
+        /// concurrently, so it is only touched under the lock.
+        private var recurrentStates: [String: [String: Tensor]] = [:]
+        private let recurrentLock = NSLock()
+        
+        func recurrentState(for key: String) -> [String: Tensor]? {
+            recurrentLock.lock()
+            defer { recurrentLock.unlock() }
+            return recurrentStates[key]
+        }
+        
+        func setRecurrentState(_ state: [String: Tensor], for key: String) {
+            recurrentLock.lock()
+            defer { recurrentLock.unlock() }
+            recurrentStates[key] = state
+        }
+        
+        init(fftSize: Int, hopSize: Int, erbBands: Int, normalization: FeatureNormalization) {
+            self.stft = StreamingSTFT(frameSize: fftSize, hopSize: hopSize)
+            self.spectrum = Spectrogram(frameCount: 1, binCount: stft.binCount)
+            self.bands = Spectrogram(frameCount: 1, binCount: erbBands, complex: false)
+            self.output = [Float](repeating: 0, count: hopSize)
+            self.normalization = normalization
+            self.deepFilter = StreamingDeepFilter(binCount: stft.binCount)
+        }
+    }
+    
+    /// How many samples the output of processHop(_:) is behind its input
+    var streamingLatency: Int {
+        return fftSize - hopSize
+    }
+    
+    /// The running feature normalization of the denoiser's own stream, as it stands
+    ///
+    /// Restoring it into another denoiser with restoreNormalization(_:) carries the stream over
+    /// without its features going through a second of the normalization converging again.
+    func normalizationSnapshot() -> FeatureNormalization.Snapshot {
+        return processingQueue.sync { normalization.snapshot() }
+    }
+    
+    /// Carry the denoiser's own stream on from a normalization snapshot
+    /// - Throws: FeatureNormalizer.NormalizerError if the snapshot is of other feature sizes
+    func restoreNormalization(_ snapshot: FeatureNormalization.Snapshot) throws {
+        try processingQueue.sync { try normalization.restore(snapshot) }
+    }
+    
+    /// Smoothing factor of the feature normalization, a one-second time constant at the hop rate
+    private static let normalizationAlpha = Float(exp(-Double(AppConstants.hopSize) / Double(AppConstants.sampleRate)))
+    
+    /// Process the next hop of a stream
+    ///
+    /// Unlike process(audio:), which analyzes a whole window on every call, the streaming mode takes
+    /// exactly `hopSize` new samples and returns exactly `hopSize` enhanced samples,
+    /// `streamingLatency` samples behind the input. The STFT history, the ERB and spectral feature
+    /// normalization and any recurrent state the models return carry over from one call to the
+    /// next, so each frame goes through the FFT once and the models see the stream as one sequence,
+    /// as in the reference DeepFilterNet. Call reset() before starting a new stream.
+    ///
+    /// - Parameter hop: Exactly `hopSize` input samples
+    /// - Returns: Exactly `hopSize` enhanced samples
+    /// - Throws: DeepFilterError if the hop has the wrong length or invalid samples
+    func processHop(_ hop: [Float]) throws -> [Float] {
+        guard hop.count == hopSize else {
+            throw DeepFilterError.processingFailed("Streaming hop must be \(hopSize) samples, got \(hop.count)")
+        }
+        try validateSamples(hop)
+        
+        return processingQueue.sync {
+            let stream = self.stream ?? makeStreamState(normalization: normalization)
+            self.stream = stream
+            return processHopInternal(hop, stream: stream)
+        }
+    }
+    
+    /// - Parameter normalization: The stream's feature normalization; a new one starting from
+    ///   DeepFilterNet's initial state if nil
+    private func makeStreamState(normalization: FeatureNormalization? = nil) -> StreamState {
+        return StreamState(
+            fftSize: fftSize,
+            hopSize: hopSize,
+            erbBands: erbBands,
+            normalization: normalization ?? FeatureNormalization(erbBands: erbBands, dfBands: dfBands, alpha: Self.normalizationAlpha)
+        )
+    }
+    
+    /// One hop through the whole pipeline. A frame the models fail on is passed through unenhanced,
+    /// so the stream keeps its timing.
+    private func processHopInternal(_ hop: [Float], stream: StreamState) -> [Float] {
+        analyze(hop, stream: stream)
+        
+        do {
+            let erbFeat = try streamingERBFeatures(stream: stream)
+            let specFeat = streamingSpectralFeatures(stream: stream)
+            
+            let encoderOutputs = try runEncoder(erbFeat: erbFeat, specFeat: specFeat, stream: stream)
+            let (mask, coefficients) = try runDecoders(states: encoderOutputs, stream: stream)
+            try enhance(stream: stream, mask: mask, coefficients: coefficients)
+        } catch {
+            Self.logger.error("Streaming hop failed, passing the frame through: \(error.localizedDescription)")
+        }
+        
+        return synthesize(stream: stream)
+    }
+    
+    /// Bring the next hop into the stream's STFT, leaving the spectrum of its frame in the stream
+    private func analyze(_ hop: [Float], stream: StreamState) {
+        hop.withUnsafeBufferPointer { hopBuffer in
+            stream.stft.analyze(hopBuffer.baseAddress!, real: stream.spectrum.real(0), imag: stream.spectrum.imag(0))
+        }
+    }
+    
+    /// Apply the decoders' mask and coefficients to the stream's spectrum
+    ///
+    /// The stream's deep filter reaches back into the frames of earlier hops, and filters the
+    /// spectrum as analyzed while the mask takes the bins above it, as in DeepFilterNet.
+    private func enhance(stream: StreamState, mask: [Float], coefficients: [Float]) throws {
+        let mask = try binMask(mask, for: stream.spectrum)
+        try stream.deepFilter.process(stream.spectrum, mask: mask, coefficients: coefficients)
+    }
+    
+    /// Overlap-add the stream's spectrum and return the next hop of output
+    private func synthesize(stream: StreamState) -> [Float] {
+        stream.output.withUnsafeMutableBufferPointer { outputBuffer in
+            stream.stft.synthesize(real: stream.spectrum.real(0), imag: stream.spectrum.imag(0), into: outputBuffer.baseAddress!)
+        }
+        return stream.output
+    }
+    
+    /// ERB features of the stream's current frame: band levels in dB less their running mean
+    private func streamingERBFeatures(stream: StreamState) throws -> Tensor {
+        guard stream.bands.binCount == erbBands else {
+            throw DeepFilterError.processingFailed("ERB feature count mismatch for streaming frame")
+        }
+        // Band power, band sums and logs in one pass over the spectrum
+        erbFeatures.extractLevels(stream.spectrum, into: stream.bands)
+        let levels = stream.bands.real(0)
+        
+        var features = [Float](repeating: 0, count: erbBands)
+        features.withUnsafeMutableBufferPointer { buffer in
+            stream.normalization.erb.normalize(levels: levels, into: buffer.baseAddress!)
+        }
+        
+        return Tensor(shape: [1, 1, 1, erbBands], data: features)
+    }
+    
+    /// Spectral features of the stream's current frame: the deep filtering bins over the square
+    /// root of their running mean magnitude
+    private func streamingSpectralFeatures(stream: StreamState) -> Tensor {
+        var data = [Float](repeating: 0, count: 2 * dfBands)
+        data.withUnsafeMutableBufferPointer { buffer in
+            stream.normalization.spectral.normalize(
+                real: stream.spectrum.real(0),
+                imag: stream.spectrum.imag(0),
+                intoReal: buffer.baseAddress!,
+                intoImag: buffer.baseAddress! + dfBands
+            )
+        }
+        
+        return Tensor(shape: [1, 2, 1, dfBands], data: data)
+    }
+    
     // MARK: - Feature Extraction
     
-    private func extractERBFeatures(spectrum2D: (real: [[Float]], imag: [[Float]])) throws -> Tensor {
-        // Extract ERB bands for all frames
-        let erbBands2D = erbFeatures.extract(spectrogramReal: spectrum2D.real, spectrogramImag: spectrum2D.imag)
-
-        // Normalize (alpha=0.9 for ERB features)
-        let normalized2D = erbFeatures.normalize(erbBands2D, alpha: 0.9)
-
-        // Flatten all frames for tensor input
-        let normalized = normalized2D.flatMap { $0 }
+    private func extractERBFeatures(spectrum: Spectrogram) throws -> Tensor {
+        // Band levels for all frames, then the stream's running mean normalization, frame by
+        // frame in place, carrying on from the last call
+        erbFeatures.extractLevels(spectrum, into: windowERB)
+        normalization.erb.normalize(windowERB)
 
         // Fix MEDIUM: Pre-compute expected shape with overflow protection
-        let numFrames = spectrum2D.real.count
+        let numFrames = spectrum.frameCount
         let expectedCount = try safeMultiply(numFrames, erbBands)
-        guard normalized.count == expectedCount else {
-            throw DeepFilterError.processingFailed("ERB feature count mismatch: got \(normalized.count), expected \(expectedCount)")
+        guard windowERB.frameCount == numFrames, windowERB.planes.count == expectedCount else {
+            throw DeepFilterError.processingFailed("ERB feature count mismatch: got \(windowERB.planes.count), expected \(expectedCount)")
         }
 
-        // Reshape to [1, 1, numFrames, erbBands] for ONNX model
-        return Tensor(shape: [1, 1, numFrames, erbBands], data: normalized)
+        // The bands are already laid out as [1, 1, numFrames, erbBands] for the ONNX model
+        return windowERB.tensor(shape: [1, 1, numFrames, erbBands])
     }
     
-    private func extractSpectralFeatures(spectrum2D: (real: [[Float]], imag: [[Float]])) throws -> Tensor {
-        // Extract spectral features for all frames
-        let dfSpec = try specFeatures.extract(spectrogramReal: spectrum2D.real, spectrogramImag: spectrum2D.imag)
-
-        // Normalize (alpha=0.6 for spectral features)
-        let normalized = specFeatures.normalize(dfSpec, alpha: 0.6)
+    private func extractSpectralFeatures(spectrum: Spectrogram) throws -> Tensor {
+        // Deep filtering bins for all frames, then the stream's running unit normalization
+        try specFeatures.extract(spectrum, into: windowSpec)
+        normalization.spectral.normalize(windowSpec)
 
         // Fix HIGH: Better error context
-        guard !normalized.isEmpty else {
+        let numFrames = spectrum.frameCount
+        guard windowSpec.frameCount == numFrames, numFrames > 0 else {
             throw DeepFilterError.processingFailed(
-                "No spectral features extracted: input frames=\(spectrum2D.real.count)"
+                "No spectral features extracted: input frames=\(numFrames)"
             )
         }
 
-        // For multiple frames, we need to handle the data differently
-        // The spectral features are returned as [[[Float]]] - frames x channels x bands
-        // We need to flatten this properly for the tensor
-
-        var data: [Float] = []
-        let numFrames = normalized.count
-        let capacity = try safeMultiply(try safeMultiply(numFrames, 2), dfBands)  // 2 channels (real/imag) per frame
-        data.reserveCapacity(capacity)
-
-        for frame in normalized {
-            guard frame.count >= 2 else {
-                throw DeepFilterError.processingFailed("Invalid spectral frame structure")
-            }
-            data.append(contentsOf: frame[0])  // real channel
-            data.append(contentsOf: frame[1])  // imag channel
+        // The real plane followed by the imaginary plane is already [1, 2, numFrames, dfBands]
+        let expectedCount = try safeMultiply(try safeMultiply(numFrames, 2), dfBands)
+        guard windowSpec.planes.count == expectedCount else {
+            throw DeepFilterError.processingFailed("Spectral feature count mismatch: got \(windowSpec.planes.count), expected \(expectedCount)")
         }
 
-        return Tensor(shape: [1, 2, numFrames, dfBands], data: data)
+        return windowSpec.tensor(shape: [1, 2, numFrames, dfBands])
     }
     
     // MARK: - Model Inference
     
-    private func runEncoder(erbFeat: Tensor, specFeat: Tensor) throws -> [String: Tensor] {
+    private func runEncoder(erbFeat: Tensor, specFeat: Tensor, stream: StreamState? = nil) throws -> [String: Tensor] {
         let inputs: [String: Tensor] = [
             "erb_feat": erbFeat,
             "spec_feat": specFeat
         ]
         
-        let outputs = try encoder.infer(inputs: inputs)
+        let outputs = try infer(encoder, key: "enc", inputs: inputs, stream: stream)
         
         // Fix HIGH: Validate encoder outputs before using
         let requiredKeys = ["e0", "e1", "e2", "e3", "emb", "c0", "lsnr"]
@@ -486,8 +669,27 @@ final class DeepFilterNet: @unchecked Sendable {
         return copiedOutputs
     }
     
-    private func runERBDecoder(states: [String: Tensor]) throws -> [Float] {
-        let outputs = try erbDecoder.infer(inputs: states)
+    /// Run the ERB and DF decoders on the encoder's outputs
+    ///
+    /// Neither decoder depends on the other, and each has a session of its own, so they run
+    /// concurrently and a frame waits for the slower of the two rather than both. The C bridge's
+    /// ONNXPipeline would also keep the encoder's outputs inside the runtime, but it is C API only
+    /// until the Swift target links ONNX Runtime.
+    private func runDecoders(states: [String: Tensor], frameCount: Int = 1, stream: StreamState? = nil) throws -> (mask: [Float], coefficients: [Float]) {
+        var mask: Result<[Float], Error> = .failure(DeepFilterError.processingFailed("ERB decoder did not run"))
+        var coefficients: Result<[Float], Error> = .failure(DeepFilterError.processingFailed("DF decoder did not run"))
+        DispatchQueue.concurrentPerform(iterations: 2) { index in
+            if index == 0 {
+                mask = Result { try runERBDecoder(states: states, stream: stream) }
+            } else {
+                coefficients = Result { try runDFDecoder(states: states, frameCount: frameCount, stream: stream) }
+            }
+        }
+        return (try mask.get(), try coefficients.get())
+    }
+    
+    private func runERBDecoder(states: [String: Tensor], stream: StreamState? = nil) throws -> [Float] {
+        let outputs = try infer(erbDecoder, key: "erb_dec", inputs: states, stream: stream)
         
         // Fix MEDIUM: Validate output exists and has valid data
         guard let maskTensor = outputs["m"] else {
@@ -504,8 +706,8 @@ final class DeepFilterNet: @unchecked Sendable {
         return maskTensor.data
     }
     
-    private func runDFDecoder(states: [String: Tensor]) throws -> [Float] {
-        let outputs = try dfDecoder.infer(inputs: states)
+    private func runDFDecoder(states: [String: Tensor], frameCount: Int = 1, stream: StreamState? = nil) throws -> [Float] {
+        let outputs = try infer(dfDecoder, key: "df_dec", inputs: states, stream: stream)
         
         // Fix MEDIUM: Validate output exists
         guard let coefsTensor = outputs["coefs"] else {
@@ -513,36 +715,68 @@ final class DeepFilterNet: @unchecked Sendable {
             throw DeepFilterError.processingFailed("DF decoder output missing 'coefs' key. Available: \(availableKeys)")
         }
         
-        // Fix HIGH: Validate coefficient array size
-        let expectedSize = 1 * dfBands * dfOrder
-        guard coefsTensor.data.count == expectedSize else {
+        // Fix HIGH: Validate coefficient array size. A stream's deep filter also takes
+        // DeepFilterNet's complex coefficients, twice as many.
+        let expectedSize = frameCount * dfBands * dfOrder
+        let isComplex = stream != nil && coefsTensor.data.count == 2 * expectedSize
+        guard coefsTensor.data.count == expectedSize || isComplex else {
             throw DeepFilterError.processingFailed("Coefficient size \(coefsTensor.data.count) doesn't match expected \(expectedSize)")
         }
         
         return coefsTensor.data
     }
     
+    /// Run one of the models
+    ///
+    /// Models exported for streaming return their recurrent state as outputs named
+    /// `new_<input name>`, the convention of DeepFilterNet's own streaming export. Those outputs are
+    /// never passed on to the next model; in the streaming mode they are kept in the stream and fed
+    /// back as the model's inputs on the next hop. Before the first hop the state inputs are left
+    /// out, so the model starts from its own initial state.
+    private func infer(_ model: ONNXModel, key: String, inputs: [String: Tensor], stream: StreamState?) throws -> [String: Tensor] {
+        var modelInputs = inputs.filter { !$0.key.hasPrefix(Self.recurrentStatePrefix) }
+        if let stream = stream, let recurrent = stream.recurrentState(for: key) {
+            modelInputs.merge(recurrent) { _, state in state }
+        }
+        
+        let outputs = try model.infer(inputs: modelInputs)
+        
+        if let stream = stream {
+            var recurrent: [String: Tensor] = [:]
+            for (name, tensor) in outputs where name.hasPrefix(Self.recurrentStatePrefix) {
+                recurrent[String(name.dropFirst(Self.recurrentStatePrefix.count))] = tensor
+            }
+            stream.setRecurrentState(recurrent, for: key)
+        }
+        return outputs
+    }
+    
     // MARK: - Filtering
     
-    private func applyFiltering(
-        spectrum: (real: [Float], imag: [Float]),
-        mask: [Float],
-        coefficients: [Float]
-    ) throws -> (real: [Float], imag: [Float]) {
-        // Fix HIGH: Validate mask size matches spectrum
-        guard mask.count == spectrum.real.count else {
-            throw DeepFilterError.processingFailed("Mask size \(mask.count) doesn't match spectrum size \(spectrum.real.count)")
-        }
+    /// Apply the decoders' mask and coefficients to every frame of a spectrum, in place
+    private func applyFiltering(spectrum: Spectrogram, mask: [Float], coefficients: [Float]) throws {
+        let mask = try binMask(mask, for: spectrum)
         
         // Apply enhancement (ERB mask + deep filtering)
-        let enhanced = DeepFiltering.enhance(
-            spectrum: spectrum,
-            mask: mask,
-            coefficients: coefficients,
-            timeSteps: 1  // Single frame
-        )
+        try DeepFiltering.enhance(spectrum, mask: mask, coefficients: coefficients)
+    }
+    
+    /// The decoder's mask as a gain per bin of every frame of a spectrum
+    ///
+    /// The ERB decoder's mask is either a gain per bin or, as DeepFilterNet's own decoder gives it,
+    /// a gain per ERB band, which the filterbank expands to every bin.
+    private func binMask(_ mask: [Float], for spectrum: Spectrogram) throws -> [Float] {
+        var mask = mask
+        if mask.count == spectrum.frameCount * erbBands {
+            mask = erbFeatures.expandMask(mask)
+        }
         
-        return enhanced
+        // Fix HIGH: Validate mask size matches spectrum
+        let spectrumSize = spectrum.frameCount * spectrum.binCount
+        guard mask.count == spectrumSize else {
+            throw DeepFilterError.processingFailed("Mask size \(mask.count) doesn't match spectrum size \(spectrumSize)")
+        }
+        return mask
     }
     
     // MARK: - Utilities
@@ -574,12 +808,17 @@ final class DeepFilterNet: @unchecked Sendable {
     
     /// Process entire audio buffer (for batch processing)
     ///
+    /// The buffer runs through the streaming mode hop by hop, on a stream of its own so that it
+    /// never disturbs the one processHop(_:) works on. The input is padded with silence to flush
+    /// the STFT, and the output is aligned with the input by dropping the first
+    /// `streamingLatency` samples, so it has exactly as many samples as the input.
+    ///
     /// - Parameter audio: Input audio samples (any length)
     /// - Returns: Enhanced audio samples
-    /// - Throws: DeepFilterError if buffer is too large or processing fails
+    /// - Throws: DeepFilterError if buffer is too large or contains invalid samples
     /// - Note: For buffers longer than 10 seconds, consider processing in smaller batches
     ///   to reduce peak memory usage. Maximum buffer duration is 60 seconds.
-    /// - Warning: Peak memory usage is approximately 4 * audio.count bytes (input + output + intermediate buffers)
+    /// - Warning: Peak memory usage is approximately 2 * audio.count * 4 bytes (input + output)
     func processBuffer(_ audio: [Float]) throws -> [Float] {
         // Fix MEDIUM: Make max buffer size configurable
         let maxBufferDuration = 60  // seconds
@@ -595,117 +834,30 @@ final class DeepFilterNet: @unchecked Sendable {
             return audio
         }
         
-        // Fix HIGH: Validate hopSize to prevent infinite loop
-        guard self.hopSize > 0 else {
-            Self.logger.error("Invalid hopSize: \(self.hopSize)")
-            return audio
-        }
-        
-        var output: [Float] = []
-        output.reserveCapacity(audio.count)
+        try validateSamples(audio)
         
-        // Process in chunks
-        // Fix HIGH: Add autoreleasepool to prevent memory accumulation in loop
-        var position = 0
-        while position + fftSize <= audio.count {
-            autoreleasepool {
-                // Fix HIGH: Bounds checking
-                guard position + fftSize <= audio.count else {
-                    return  // Skip invalid chunks
-                }
-                
-                let chunk = Array(audio[position..<position + fftSize])
-                
-                // Fix HIGH: Handle errors gracefully instead of silently dropping
-                do {
-                    let enhanced = try process(audio: chunk)
-                    let outputChunk = Array(enhanced.prefix(hopSize))
-                    output.append(contentsOf: outputChunk)
-                } catch {
-                    Self.logger.error("Chunk processing failed at position \(position): \(error)")
-                    // Append original chunk to maintain temporal continuity
-                    let fallbackChunk = Array(chunk.prefix(hopSize))
-                    output.append(contentsOf: fallbackChunk)
-                }
-            }
+        return processingQueue.sync {
+            let stream = makeStreamState()
+            let latency = stream.stft.latency
+            var output: [Float] = []
+            output.reserveCapacity(audio.count + latency + hopSize)
             
-            // Fix CRITICAL: Check for integer overflow in position increment
-            let (newPosition, overflow) = position.addingReportingOverflow(self.hopSize)
-            guard !overflow else {
-                Self.logger.error("Position overflow at \(position) + \(self.hopSize)")
-                break  // Exit loop to prevent corruption
-            }
-            position = newPosition
-        }
-        
-        // Handle remaining samples
-        // Fix HIGH: Add autoreleasepool here too
-        // Fix HIGH: Document memory implications for long buffers
-        if position < audio.count {
-            autoreleasepool {
-                let remaining = audio.count - position
-                var lastChunk = Array(audio[position..<audio.count])
-                
-                 // Fix HIGH: Add size limit to reflection padding to prevent unbounded arrays
-                 if remaining < fftSize {
-                     let padCount = fftSize - remaining
-                     
-                     // Fix MEDIUM: Ensure maxAudioBufferSize is large enough for reflection padding
-                     precondition(AppConstants.maxAudioBufferSize >= fftSize * AppConstants.minBufferForReflectionRatio,
-                                "maxAudioBufferSize (\(AppConstants.maxAudioBufferSize)) must be at least " +
-                                "\(fftSize * AppConstants.minBufferForReflectionRatio) (fftSize * \(AppConstants.minBufferForReflectionRatio)) " +
-                                "for proper reflection padding")
-                     
-                     // Limit reflection to reasonable size (max 2x FFT size) to prevent memory issues
-                     let maxReflectSize = min(fftSize * 2, AppConstants.maxAudioBufferSize)
-                     let reflectCount = min(padCount, remaining, maxReflectSize)
-                    
-                    // Fix CRITICAL: More robust reflection padding with edge case handling
-                    guard reflectCount > 0, audio.count >= reflectCount else {
-                        // Skip reflection if not enough data, use zero padding instead
-                        lastChunk.append(contentsOf: Array(repeating: 0.0, count: padCount))
-                        return
+            var hop = [Float](repeating: 0, count: hopSize)
+            var position = 0
+            while output.count < audio.count + latency {
+                // Fix HIGH: Add autoreleasepool to prevent memory accumulation in loop
+                autoreleasepool {
+                    let available = max(0, min(hopSize, audio.count - position))
+                    for index in 0..<hopSize {
+                        hop[index] = index < available ? audio[position + index] : 0
                     }
-                    
-                    // Use safe clamping for reflection indices
-                    let reflectStartIndex = max(0, audio.count - reflectCount)
-                    let reflectEndIndex = min(audio.count, reflectStartIndex + reflectCount)
-                    
-                    guard reflectStartIndex < reflectEndIndex else {
-                        // Degenerate case, use zero padding
-                        lastChunk.append(contentsOf: Array(repeating: 0.0, count: padCount))
-                        return
-                    }
-                    
-                    // Apply reflection with bounds validation
-                    let reflectionSlice = audio[reflectStartIndex..<reflectEndIndex]
-                    lastChunk.append(contentsOf: reflectionSlice.reversed())
-                    
-                    // Fill remaining space with zeros if reflection wasn't enough
-                    let remainingPadding = padCount - reflectionSlice.count
-                    if remainingPadding > 0 {
-                        lastChunk.append(contentsOf: Array(repeating: 0.0, count: remainingPadding))
-                    }
-                    
-                    if lastChunk.count < fftSize {
-                        lastChunk.append(contentsOf: Array(repeating: 0.0, count: fftSize - lastChunk.count))
-                    }
-                }
-                
-                // Fix HIGH: Handle errors gracefully
-                do {
-                    let enhanced = try process(audio: lastChunk)
-                    let outputChunk = Array(enhanced.prefix(remaining))
-                    output.append(contentsOf: outputChunk)
-                } catch {
-                    Self.logger.error("Last chunk processing failed: \(error)")
-                    // Append original to maintain continuity
-                    output.append(contentsOf: audio[position..<audio.count])
+                    output.append(contentsOf: processHopInternal(hop, stream: stream))
                 }
+                position += hopSize
             }
+            
+            return Array(output[latency..<latency + audio.count])
         }
-        
-        return output
     }
 }
 
@@ -750,3 +902,423 @@ extension DeepFilterNet {
         }
     }
 }
+
+// MARK: - Multi-Stream Engine
+
+extension DeepFilterNet {
+    /// Denoises many streams at once, running each model once per frame for all of them
+    ///
+    /// A server denoising dozens of call legs would otherwise need a DeepFilterNet per leg, each
+    /// running the three models on a batch of one. The engine keeps a stream state per leg, the
+    /// same one processHop(_:) keeps, and gathers the next hop of every leg into one batch: each
+    /// frame is analyzed and its features normalized on its own, then the encoder and both
+    /// decoders run once on all of them stacked along the batch axis, and the masks, coefficients
+    /// and recurrent state are handed back stream by stream. Each stream comes out as its own
+    /// DeepFilterNet would have enhanced it.
+    ///
+    /// Hops come in through submit(_:to:completion:). A batch runs as soon as every stream has a
+    /// hop in it or it is full, and otherwise once its oldest hop has waited `maxWait`, so a quiet
+    /// or late stream never holds up the rest. Servers that schedule for themselves can call
+    /// process(_:) with a whole batch instead.
+    ///
+    /// **Thread Safety**: All methods may be called from any thread, including from a completion.
+    /// Batches run one at a time on the engine's queue, which also calls the completions; they
+    /// should hand the audio on, or submit the stream's next hop, and return.
+    final class MultiStreamEngine: @unchecked Sendable {
+        
+        /// How the engine trades latency for batch size
+        struct Configuration {
+            /// Most hops in one batch
+            var maxBatchSize: Int = 32
+            
+            /// Longest a hop waits for the rest of its batch, in seconds. A hop's output is due
+            /// one hop (10 ms) after its input, and the batch still has to run in that time.
+            var maxWait: TimeInterval = 0.004
+            
+            /// Batch axis of the models' recurrent state: 0 for state exported as [batch, ...],
+            /// 1 for GRU state exported as [layers, batch, hidden]
+            var recurrentStateBatchAxis: Int = 0
+            
+            init() {}
+        }
+        
+        typealias StreamID = Int
+        
+        private struct PendingHop {
+            let stream: StreamID
+            let hop: [Float]
+            let completion: ([Float]) -> Void
+        }
+        
+        private let denoiser: DeepFilterNet
+        private let configuration: Configuration
+        private let queue = DispatchQueue(label: "com.vocana.deepfilternet.multistream", qos: .userInteractive)
+        
+        /// Marks the queue as this engine's, so calls from its completions don't sync onto it again
+        private static let queueKey = DispatchSpecificKey<ObjectIdentifier>()
+        
+        // Only touched on the queue
+        private var streams: [StreamID: StreamState] = [:]
+        private var nextStreamID: StreamID = 0
+        private var pending: [PendingHop] = []
+        private var deadline: DispatchWorkItem?
+        
+        /// - Parameters:
+        ///   - denoiser: Provides the models and the DSP. Its own processing is unaffected, so
+        ///     it can go on serving a stream of its own.
+        ///   - configuration: Batching limits
+        init(denoiser: DeepFilterNet, configuration: Configuration = Configuration()) {
+            precondition(configuration.maxBatchSize > 0, "maxBatchSize must be positive")
+            precondition(configuration.maxWait >= 0, "maxWait must not be negative")
+            self.denoiser = denoiser
+            self.configuration = configuration
+            queue.setSpecific(key: Self.queueKey, value: ObjectIdentifier(self))
+        }
+        
+        /// Runs work on the queue, or right there when already on it, as a completion is
+        private func onQueue<T>(_ work: () throws -> T) rethrows -> T {
+            if DispatchQueue.getSpecific(key: Self.queueKey) == ObjectIdentifier(self) {
+                return try work()
+            }
+            return try queue.sync(execute: work)
+        }
+        
+        /// Number of streams
+        var streamCount: Int {
+            return onQueue { streams.count }
+        }
+        
+        /// Start a stream, from silence
+        func addStream() -> StreamID {
+            return onQueue {
+                let id = nextStreamID
+                nextStreamID += 1
+                streams[id] = denoiser.makeStreamState()
+                return id
+            }
+        }
+        
+        /// End a stream. A hop of it still waiting for its batch is handed back unenhanced.
+        func removeStream(_ id: StreamID) {
+            onQueue {
+                guard streams.removeValue(forKey: id) != nil else { return }
+                let orphans = pending.filter { $0.stream == id }
+                pending.removeAll { $0.stream == id }
+                
+                // Completions run on the queue like any other, not inside this call
+                if !orphans.isEmpty {
+                    queue.async {
+                        orphans.forEach { $0.completion($0.hop) }
+                    }
+                }
+                
+                // The batch may have been waiting for this stream alone
+                if !flushIfReady() && pending.isEmpty {
+                    cancelDeadline()
+                }
+            }
+        }
+        
+        /// The running feature normalization of a stream, after the hops already submitted
+        /// - Throws: DeepFilterError if the stream doesn't exist
+        func normalizationSnapshot(of id: StreamID) throws -> FeatureNormalization.Snapshot {
+            return try onQueue {
+                guard let stream = streams[id] else {
+                    throw DeepFilterError.processingFailed("Unknown stream \(id)")
+                }
+                flush()
+                return stream.normalization.snapshot()
+            }
+        }
+        
+        /// Carry a stream on from a normalization snapshot, such as one taken of it in another engine
+        /// - Throws: DeepFilterError if the stream doesn't exist, FeatureNormalizer.NormalizerError
+        ///   if the snapshot is of other feature sizes
+        func restoreNormalization(_ snapshot: FeatureNormalization.Snapshot, to id: StreamID) throws {
+            try onQueue {
+                guard let stream = streams[id] else {
+                    throw DeepFilterError.processingFailed("Unknown stream \(id)")
+                }
+                flush()
+                try stream.normalization.restore(snapshot)
+            }
+        }
+        
+        /// Queue the next hop of a stream
+        ///
+        /// - Parameters:
+        ///   - hop: Exactly `hopSize` input samples
+        ///   - stream: The stream the hop belongs to
+        ///   - completion: Called on the engine's queue with exactly `hopSize` enhanced samples,
+        ///     `streamingLatency` samples behind the input, once the hop's batch has run
+        /// - Throws: DeepFilterError if the hop has the wrong length or invalid samples, or the
+        ///   stream doesn't exist
+        func submit(_ hop: [Float], to stream: StreamID, completion: @escaping ([Float]) -> Void) throws {
+            try validate(hop)
+            try onQueue {
+                guard streams[stream] != nil else {
+                    throw DeepFilterError.processingFailed("Unknown stream \(stream)")
+                }
+            }
+            
+            // The batch runs on the queue rather than on whichever caller happened to complete it.
+            // From a completion this also keeps the next batch from running inside the one that is
+            // still handing out its results.
+            queue.async {
+                self.enqueue(PendingHop(stream: stream, hop: hop, completion: completion))
+            }
+        }
+        
+        /// Run the next hop of a number of streams as batches, right away
+        ///
+        /// Hops already submitted run first, so each stream's hops keep their order.
+        ///
+        /// - Parameter hops: Exactly `hopSize` input samples for each stream
+        /// - Returns: Exactly `hopSize` enhanced samples for each stream
+        /// - Throws: DeepFilterError if a hop has the wrong length or invalid samples, or a
+        ///   stream doesn't exist
+        func process(_ hops: [StreamID: [Float]]) throws -> [StreamID: [Float]] {
+            for hop in hops.values {
+                try validate(hop)
+            }
+            
+            return try onQueue {
+                let ids = Array(hops.keys)
+                for id in ids where streams[id] == nil {
+                    throw DeepFilterError.processingFailed("Unknown stream \(id)")
+                }
+                flush()
+                
+                var results: [StreamID: [Float]] = [:]
+                results.reserveCapacity(ids.count)
+                for start in stride(from: 0, to: ids.count, by: configuration.maxBatchSize) {
+                    let batch = ids[start..<min(start + configuration.maxBatchSize, ids.count)]
+                    let outputs = denoiser.processBatchInternal(
+                        batch.map { hops[$0]! },
+                        streams: batch.map { streams[$0]! },
+                        recurrentStateBatchAxis: configuration.recurrentStateBatchAxis
+                    )
+                    for (id, output) in zip(batch, outputs) {
+                        results[id] = output
+                    }
+                }
+                return results
+            }
+        }
+        
+        private func validate(_ hop: [Float]) throws {
+            guard hop.count == denoiser.hopSize else {
+                throw DeepFilterError.processingFailed("Streaming hop must be \(denoiser.hopSize) samples, got \(hop.count)")
+            }
+            try denoiser.validateSamples(hop)
+        }
+        
+        // MARK: Batching (on the queue)
+        
+        private func enqueue(_ hop: PendingHop) {
+            // Removed while the hop was on its way
+            guard streams[hop.stream] != nil else {
+                hop.completion(hop.hop)
+                return
+            }
+            
+            // A stream's hops have to run in order, so its next hop starts the next batch
+            if pending.contains(where: { $0.stream == hop.stream }) {
+                flush()
+            }
+            pending.append(hop)
+            
+            if !flushIfReady() && pending.count == 1 {
+                scheduleDeadline()
+            }
+        }
+        
+        /// Run the batch if every stream is in it or it is full
+        @discardableResult
+        private func flushIfReady() -> Bool {
+            guard !pending.isEmpty, pending.count >= min(configuration.maxBatchSize, streams.count) else {
+                return false
+            }
+            flush()
+            return true
+        }
+        
+        private func scheduleDeadline() {
+            cancelDeadline()
+            let item = DispatchWorkItem { [weak self] in
+                self?.flush()
+            }
+            deadline = item
+            queue.asyncAfter(deadline: .now() + configuration.maxWait, execute: item)
+        }
+        
+        private func cancelDeadline() {
+            deadline?.cancel()
+            deadline = nil
+        }
+        
+        private func flush() {
+            cancelDeadline()
+            guard !pending.isEmpty else { return }
+            
+            let batch = pending
+            pending.removeAll(keepingCapacity: true)
+            
+            // removeStream takes a stream's hops out of the batch, so every stream is still here
+            let outputs = denoiser.processBatchInternal(
+                batch.map { $0.hop },
+                streams: batch.map { streams[$0.stream]! },
+                recurrentStateBatchAxis: configuration.recurrentStateBatchAxis
+            )
+            for (hop, output) in zip(batch, outputs) {
+                hop.completion(output)
+            }
+        }
+    }
+    
+    /// One hop of each of a batch of streams through the pipeline, each model running once for all
+    /// of them. As in processHopInternal(_:stream:), frames the models fail on are passed through
+    /// unenhanced.
+    private func processBatchInternal(_ hops: [[Float]], streams: [StreamState], recurrentStateBatchAxis axis: Int) -> [[Float]] {
+        let count = streams.count
+        guard count > 0 else { return [] }
+        
+        for (hop, stream) in zip(hops, streams) {
+            analyze(hop, stream: stream)
+        }
+        
+        do {
+            var erbData: [Float] = []
+            var specData: [Float] = []
+            erbData.reserveCapacity(count * erbBands)
+            specData.reserveCapacity(count * 2 * dfBands)
+            for stream in streams {
+                erbData.append(contentsOf: try streamingERBFeatures(stream: stream).data)
+                specData.append(contentsOf: streamingSpectralFeatures(stream: stream).data)
+            }
+            let inputs: [String: Tensor] = [
+                "erb_feat": Tensor(shape: [count, 1, 1, erbBands], data: erbData),
+                "spec_feat": Tensor(shape: [count, 2, 1, dfBands], data: specData)
+            ]
+            
+            let encoderOutputs = try inferBatch(encoder, key: "enc", inputs: inputs, streams: streams, axis: axis)
+            let states = encoderOutputs.filter { !$0.key.hasPrefix(Self.recurrentStatePrefix) }
+            
+            var masks: Result<[Tensor], Error> = .failure(DeepFilterError.processingFailed("ERB decoder did not run"))
+            var coefficients: Result<[Tensor], Error> = .failure(DeepFilterError.processingFailed("DF decoder did not run"))
+            DispatchQueue.concurrentPerform(iterations: 2) { index in
+                if index == 0 {
+                    masks = Result {
+                        let outputs = try inferBatch(erbDecoder, key: "erb_dec", inputs: states, streams: streams, axis: axis)
+                        return try Self.split(try Self.output("m", of: outputs), into: count, axis: 0)
+                    }
+                } else {
+                    coefficients = Result {
+                        let outputs = try inferBatch(dfDecoder, key: "df_dec", inputs: states, streams: streams, axis: axis)
+                        return try Self.split(try Self.output("coefs", of: outputs), into: count, axis: 0)
+                    }
+                }
+            }
+            
+            let streamMasks = try masks.get()
+            let streamCoefficients = try coefficients.get()
+            for index in 0..<count {
+                do {
+                    try enhance(stream: streams[index], mask: streamMasks[index].data, coefficients: streamCoefficients[index].data)
+                } catch {
+                    Self.logger.error("Batched hop failed, passing the frame through: \(error.localizedDescription)")
+                }
+            }
+        } catch {
+            Self.logger.error("Batch of \(count) hops failed, passing the frames through: \(error.localizedDescription)")
+        }
+        
+        return streams.map { synthesize(stream: $0) }
+    }
+    
+    /// Run one of the models on a batch of streams
+    ///
+    /// Each stream's recurrent state is stacked along the batch axis, and the state the model
+    /// returns is split back up the same way, so every stream carries its own as in infer(_:key:
+    /// inputs:stream:). A stream joining before the others have run starts from zeros, the
+    /// initial state of DeepFilterNet's recurrent layers.
+    private func inferBatch(_ model: ONNXModel, key: String, inputs: [String: Tensor], streams: [StreamState], axis: Int) throws -> [String: Tensor] {
+        var modelInputs = inputs
+        let recurrent = streams.map { $0.recurrentState(for: key) ?? [:] }
+        for name in Set(recurrent.flatMap { $0.keys }) {
+            guard let template = recurrent.lazy.compactMap({ $0[name] }).first else { continue }
+            let slices = recurrent.map { state -> Tensor in
+                guard let tensor = state[name], tensor.shape == template.shape else {
+                    return Tensor(shape: template.shape, constant: 0)
+                }
+                return tensor
+            }
+            modelInputs[name] = try Self.concatenate(slices, axis: axis)
+        }
+        
+        let outputs = try model.infer(inputs: modelInputs)
+        
+        var newStates = [[String: Tensor]](repeating: [:], count: streams.count)
+        for (name, tensor) in outputs where name.hasPrefix(Self.recurrentStatePrefix) {
+            let slices = try Self.split(tensor, into: streams.count, axis: axis)
+            let stateName = String(name.dropFirst(Self.recurrentStatePrefix.count))
+            for index in slices.indices {
+                newStates[index][stateName] = slices[index]
+            }
+        }
+        for (stream, state) in zip(streams, newStates) {
+            stream.setRecurrentState(state, for: key)
+        }
+        return outputs
+    }
+    
+    private static func output(_ name: String, of outputs: [String: Tensor]) throws -> Tensor {
+        guard let tensor = outputs[name] else {
+            let availableKeys = outputs.keys.joined(separator: ", ")
+            throw DeepFilterError.processingFailed("Batched model output missing '\(name)' key. Available: \(availableKeys)")
+        }
+        return tensor
+    }
+    
+    /// Stack tensors of one shape along an axis
+    private static func concatenate(_ tensors: [Tensor], axis: Int) throws -> Tensor {
+        guard let first = tensors.first, axis >= 0, axis < first.shape.count, !first.data.isEmpty else {
+            throw DeepFilterError.processingFailed("Cannot batch tensors of shape \(tensors.first?.shape ?? []) along axis \(axis)")
+        }
+        // Each tensor contributes one contiguous run of `inner` floats per index of the axes before
+        let outer = first.shape[..<axis].reduce(1, *)
+        let inner = first.data.count / outer
+        
+        var data: [Float] = []
+        data.reserveCapacity(first.data.count * tensors.count)
+        for block in 0..<outer {
+            for tensor in tensors {
+                data.append(contentsOf: tensor.data[block * inner..<(block + 1) * inner])
+            }
+        }
+        var shape = first.shape
+        shape[axis] *= tensors.count
+        return Tensor(shape: shape, data: data)
+    }
+    
+    /// Split a tensor into equal parts along an axis, undoing concatenate(_:axis:)
+    private static func split(_ tensor: Tensor, into parts: Int, axis: Int) throws -> [Tensor] {
+        guard parts > 0, axis >= 0, axis < tensor.shape.count, tensor.shape[axis] % parts == 0, !tensor.data.isEmpty else {
+            throw DeepFilterError.processingFailed("Cannot split a batch of shape \(tensor.shape) into \(parts) along axis \(axis)")
+        }
+        let outer = tensor.shape[..<axis].reduce(1, *)
+        let inner = tensor.data.count / outer / parts
+        var shape = tensor.shape
+        shape[axis] /= parts
+        
+        return (0..<parts).map { part in
+            var data: [Float] = []
+            data.reserveCapacity(outer * inner)
+            for block in 0..<outer {
+                let start = (block * parts + part) * inner
+                data.append(contentsOf: tensor.data[start..<start + inner])
+            }
+            return Tensor(shape: shape, data: data)
+        }
+    }
+}
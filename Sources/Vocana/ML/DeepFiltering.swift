@@ -1,6 +1,7 @@
 import Foundation
 import Accelerate
 import os.log
+import VocanaDSP
 
 /// Deep Filtering implementation for DeepFilterNet
 ///
@@ -10,8 +11,8 @@ import os.log
 /// **Thread Safety**: All methods are pure functions with no shared state.
 /// Safe to call from multiple threads simultaneously.
 ///
-/// **Performance**: Optimized with Accelerate framework for vectorized operations.
-/// Typical performance: ~1ms for 480 samples (10ms audio) on Apple Silicon.
+/// **Performance**: The filter runs natively in VocanaDeepFilter, the mask with Accelerate.
+/// Streams are enhanced a frame at a time by StreamingDeepFilter.
 enum DeepFiltering {
     
     /// Number of deep filtering frequency bins (first dfBands bins)
@@ -74,118 +75,50 @@ enum DeepFiltering {
             throw DeepFilteringError.coefficientSizeMismatch(got: coefficients.count, expected: expectedCoefSize)
         }
         
-        // Fix CRITICAL: Use inout-style processing to avoid array copies
         var filteredReal = spectrum.real
         var filteredImag = spectrum.imag
-        
-        // Apply filtering to first dfBins bins only
-        for t in 0..<timeSteps {
-            // Fix HIGH: Cross-platform Task cancellation support  
-            if Task.isCancelled {
-                logger.warning("Deep filtering cancelled at time step \(t)")
-                return (filteredReal, filteredImag)
-            }
-            
-            for f in 0..<DeepFiltering.dfBins {
-                // Fix CRITICAL: Simplified bounds checking - use safe multiplication
-                let (baseOffset, overflowed) = t.multipliedReportingOverflow(by: DeepFiltering.dfBins)
-                guard !overflowed else {
-                    logger.error("Integer overflow in coefficient offset calculation: t=\(t), dfBins=\(DeepFiltering.dfBins)")
-                    continue
-                }
-                
-                let freqOffset = baseOffset + f
-                guard freqOffset >= baseOffset else {
-                    logger.error("Integer overflow adding frequency index: \(baseOffset) + \(f)")
-                    continue
-                }
-                
-                let coefOffset = freqOffset * DeepFiltering.dfOrder
-                guard coefOffset >= freqOffset else {
-                    logger.error("Integer overflow in final coefficient offset: \(freqOffset) * \(DeepFiltering.dfOrder)")
-                    continue
+        filteredReal.withUnsafeMutableBufferPointer { realBuffer in
+            filteredImag.withUnsafeMutableBufferPointer { imagBuffer in
+                coefficients.withUnsafeBufferPointer { coefficientBuffer in
+                    filterFrames(
+                        real: realBuffer.baseAddress!,
+                        imag: imagBuffer.baseAddress!,
+                        frameStride: freqBins,
+                        frameCount: timeSteps,
+                        coefficients: coefficientBuffer.baseAddress!
+                    )
                 }
-                
-                // Bounds check on coefficients array access
-                guard coefOffset >= 0 && coefOffset + DeepFiltering.dfOrder <= coefficients.count else {
-                    logger.error("Coefficient offset out of bounds: \(coefOffset) + \(DeepFiltering.dfOrder) > \(coefficients.count)")
-                    continue
-                }
-                
-                // Fix CRITICAL: Pass offset directly instead of creating array slice
-                let (filteredR, filteredI) = try applyFIRFilter(
-                    real: filteredReal,
-                    imag: filteredImag,
-                    timeIndex: t,
-                    freqIndex: f,
-                    freqBins: freqBins,
-                    coefficients: coefficients,
-                    coefficientOffset: coefOffset
-                )
-                
-                let idx = t * freqBins + f
-                filteredReal[idx] = filteredR
-                filteredImag[idx] = filteredI
             }
         }
         
         return (filteredReal, filteredImag)
     }
     
-    /// Apply FIR filter at a single time-frequency point
-    private static func applyFIRFilter(
-        real: [Float],
-        imag: [Float],
-        timeIndex: Int,
-        freqIndex: Int,
-        freqBins: Int,
-        coefficients: [Float],
-        coefficientOffset: Int
-    ) throws -> (Float, Float) {
-        var outputReal: Float = 0.0
-        var outputImag: Float = 0.0
-        
+    /// Apply deep filtering to the first `dfBins` bins of frames in place
+    ///
+    /// Each output bin is a `dfOrder`-tap FIR over the same bin of the frames around it, centered
+    /// on its own frame, with taps past either end of the block left out. Frames are filtered in
+    /// order and in place, so the taps before a frame see the frames already filtered, as they
+    /// always have. VocanaDeepFilter_FilterFrames runs the taps over a tile of contiguous bins at a
+    /// time, with the tile's coefficients laid out tap by tap on the stack.
+    ///
+    /// - Parameters:
+    ///   - real: Real parts of the first frame; frame t starts at `real + t * frameStride`
+    ///   - imag: Imaginary parts, laid out the same way
+    ///   - frameStride: Floats from one frame to the next
+    ///   - frameCount: Number of frames
+    ///   - coefficients: [frameCount, dfBins, dfOrder]
+    private static func filterFrames(
+        real: UnsafeMutablePointer<Float>,
+        imag: UnsafeMutablePointer<Float>,
+        frameStride: Int,
+        frameCount: Int,
+        coefficients: UnsafePointer<Float>
+    ) {
         // Fix LOW: Assert dfOrder is odd for proper centering
         assert(DeepFiltering.dfOrder % 2 == 1, "dfOrder must be odd for proper filter centering")
-        
-        // 5-tap FIR filter centered at current time
-        let halfOrder = DeepFiltering.dfOrder / 2  // 2 for dfOrder=5
-        
-        // Fix MEDIUM: Cache totalTimeSteps calculation
-        let totalTimeSteps = real.count / freqBins
-        
-        for tap in 0..<DeepFiltering.dfOrder {
-            // Fix CRITICAL: Use safe arithmetic instead of wrapping to prevent boundary violations
-            let tSigned = timeIndex - halfOrder + tap
-            
-            // Ensure t is within valid bounds before using as array index
-            guard tSigned >= 0 && tSigned < totalTimeSteps else {
-                continue  // Skip invalid time indices
-            }
-            let t = tSigned  // Now safe to use
-            
-
-            
-            let idx = t * freqBins + freqIndex
-            
-            // Bounds check
-            guard idx < real.count && idx < imag.count else {
-                continue
-            }
-            
-            // Fix HIGH: Add bounds check for coefficients
-            let coefIdx = coefficientOffset + tap
-            guard coefIdx < coefficients.count else {
-                continue
-            }
-            
-            let coef = coefficients[coefIdx]
-            
-            outputReal += real[idx] * coef
-            outputImag += imag[idx] * coef
-        }
-        
-        return (outputReal, outputImag)
+        VocanaDeepFilter_FilterFrames(real, imag, frameStride, UInt32(frameCount),
+                                      UInt32(DeepFiltering.dfBins), UInt32(DeepFiltering.dfOrder), coefficients)
     }
     
     /// Apply ERB mask to spectrum
@@ -259,6 +192,55 @@ enum DeepFiltering {
         }
     }
     
+    /// Apply the ERB mask and deep filtering to every frame of a spectrogram, in place
+    ///
+    /// The same enhancement as enhance(spectrum:mask:coefficients:timeSteps:), row by row on the
+    /// spectrogram with nothing allocated. Everything is validated before the spectrogram is
+    /// touched, so on an error it is left as it was.
+    ///
+    /// - Parameters:
+    ///   - spectrum: Complex spectrogram [T, F], enhanced in place
+    ///   - mask: ERB mask [T, F]
+    ///   - coefficients: DF coefficients [T, dfBins, dfOrder]
+    /// - Throws: DeepFilteringError if the sizes don't match
+    static func enhance(_ spectrum: Spectrogram, mask: [Float], coefficients: [Float]) throws {
+        let timeSteps = spectrum.frameCount
+        let freqBins = spectrum.binCount
+        guard timeSteps > 0, spectrum.isComplex else {
+            throw DeepFilteringError.invalidTimeSteps(timeSteps)
+        }
+        guard mask.count == timeSteps * freqBins else {
+            throw DeepFilteringError.invalidDimensions("Mask size \(mask.count) doesn't match \(timeSteps) frames of \(freqBins) bins")
+        }
+        guard freqBins >= DeepFiltering.dfBins else {
+            throw DeepFilteringError.frequencyBinsMismatch(got: freqBins, expected: DeepFiltering.dfBins)
+        }
+        let expectedCoefSize = timeSteps * DeepFiltering.dfBins * DeepFiltering.dfOrder
+        guard coefficients.count == expectedCoefSize else {
+            throw DeepFilteringError.coefficientSizeMismatch(got: coefficients.count, expected: expectedCoefSize)
+        }
+        
+        // Step 1: Apply ERB mask, a row at a time since the spectrogram's rows are padded
+        mask.withUnsafeBufferPointer { maskBuffer in
+            for t in 0..<timeSteps {
+                let maskRow = maskBuffer.baseAddress! + t * freqBins
+                vDSP_vmul(spectrum.real(t), 1, maskRow, 1, spectrum.real(t), 1, vDSP_Length(freqBins))
+                vDSP_vmul(spectrum.imag(t), 1, maskRow, 1, spectrum.imag(t), 1, vDSP_Length(freqBins))
+            }
+        }
+        
+        // Step 2: Apply deep filtering to low frequencies
+        coefficients.withUnsafeBufferPointer { coefficientBuffer in
+            filterFrames(
+                real: spectrum.real(0),
+                imag: spectrum.imag(0),
+                frameStride: spectrum.frameStride,
+                frameCount: timeSteps,
+                coefficients: coefficientBuffer.baseAddress!
+            )
+        }
+    }
+    
     /// Compute average gain from mask (for visualization/debugging)
     static func computeGain(mask: [Float]) -> Float {
         // Fix HIGH: Validate empty array
@@ -317,34 +299,109 @@ enum DeepFiltering {
     }
 }
 
+/// DeepFilterNet's enhancement of a stream a frame at a time, on the native VocanaDeepFilter
+///
+/// As in DeepFilterNet, the first `dfBins` bins of each frame are the deep filter over the same
+/// bins of the frames as they were analyzed, and the bins above them take the ERB mask. The
+/// filter keeps the last `dfOrder` frames' low bins itself, so the taps before the current frame
+/// reach back into earlier hops instead of being left out as they are for a block of one frame.
+/// Taps past the current frame are left out, as at the end of a block.
+///
+/// The decoder's coefficients are either real, [dfBins, dfOrder] a frame, or DeepFilterNet's
+/// complex ones, [dfBins, dfOrder, 2], told apart by their count.
+///
+/// **Thread Safety**: Not thread-safe. A StreamingDeepFilter belongs to one stream and is used by
+/// one thread at a time.
+final class StreamingDeepFilter {
+    let binCount: Int
+    
+    private let filter: UnsafeMutablePointer<VocanaDeepFilter>
+    
+    /// - Parameters:
+    ///   - binCount: Bins per frame
+    ///   - lookahead: Taps past the frame being filtered; DeepFiltering's centered filter by default
+    init(binCount: Int, lookahead: Int = DeepFiltering.dfOrder / 2) {
+        precondition(binCount >= DeepFiltering.dfBins && binCount <= Int(kVocanaDeepFilter_MaxBins),
+                     "Bin count must be in range [\(DeepFiltering.dfBins), \(kVocanaDeepFilter_MaxBins)], got \(binCount)")
+        
+        self.binCount = binCount
+        self.filter = UnsafeMutablePointer<VocanaDeepFilter>.allocate(capacity: 1)
+        let status = VocanaDeepFilter_Init(filter, UInt32(binCount), UInt32(DeepFiltering.dfBins),
+                                           UInt32(DeepFiltering.dfOrder), UInt32(lookahead))
+        guard status == 0 else {
+            filter.deallocate()
+            preconditionFailure("VocanaDeepFilter_Init failed with \(status) for \(binCount) bins, lookahead \(lookahead)")
+        }
+    }
+    
+    deinit {
+        VocanaDeepFilter_Teardown(filter)
+        filter.deallocate()
+    }
+    
+    /// Forget the frames seen so far, as at the start of a new stream
+    func reset() {
+        VocanaDeepFilter_Reset(filter)
+    }
+    
+    /// Enhance every frame of a spectrogram in place, in order, as the next frames of the stream
+    ///
+    /// Everything is validated before the spectrogram is touched, so on an error it and the
+    /// stream are left as they were.
+    ///
+    /// - Parameters:
+    ///   - spectrum: Complex spectrogram [T, binCount]
+    ///   - mask: Gain per bin [T, binCount], of which the bins above `dfBins` are used
+    ///   - coefficients: Real [T, dfBins, dfOrder] or complex [T, dfBins, dfOrder, 2]
+    /// - Throws: DeepFiltering.DeepFilteringError if the sizes don't match
+    func process(_ spectrum: Spectrogram, mask: [Float], coefficients: [Float]) throws {
+        let frames = spectrum.frameCount
+        guard spectrum.isComplex, spectrum.binCount == binCount else {
+            throw DeepFiltering.DeepFilteringError.frequencyBinsMismatch(got: spectrum.binCount, expected: binCount)
+        }
+        guard mask.count == frames * binCount else {
+            throw DeepFiltering.DeepFilteringError.invalidDimensions("Mask size \(mask.count) doesn't match \(frames) frames of \(binCount) bins")
+        }
+        let realSize = DeepFiltering.dfBins * DeepFiltering.dfOrder
+        guard coefficients.count == frames * realSize || coefficients.count == 2 * frames * realSize else {
+            throw DeepFiltering.DeepFilteringError.coefficientSizeMismatch(got: coefficients.count, expected: frames * realSize)
+        }
+        let frameSize = coefficients.count / max(frames, 1)
+        
+        mask.withUnsafeBufferPointer { maskBuffer in
+            coefficients.withUnsafeBufferPointer { coefficientBuffer in
+                for t in 0..<frames {
+                    let frameMask = maskBuffer.baseAddress! + t * binCount
+                    let frameCoefficients = coefficientBuffer.baseAddress! + t * frameSize
+                    if frameSize == realSize {
+                        VocanaDeepFilter_Process(filter, spectrum.real(t), spectrum.imag(t), frameMask, frameCoefficients)
+                    } else {
+                        VocanaDeepFilter_ProcessComplex(filter, spectrum.real(t), spectrum.imag(t), frameMask, frameCoefficients)
+                    }
+                }
+            }
+        }
+    }
+}
+
 // MARK: - Performance Notes
 
 /*
- Optimization opportunities:
- 
- 1. Vectorize FIR filtering:
-    - Use vDSP_conv for convolution
-    - Process multiple frequencies in parallel
- 
- 2. SIMD optimizations:
-    - Process 4-8 complex values at once
-    - Use vDSP_zvmul for complex multiplication
+ Both paths run natively in VocanaDeepFilter:
  
- 3. Memory layout:
-    - Consider SoA (Structure of Arrays) for better cache locality
-    - Pre-allocate output buffers (DONE)
+ 1. Blocks (apply, enhance): VocanaDeepFilter_FilterFrames
+    - Tiles of 64 bins go through every frame before the next tile
+    - Each tile's coefficients are laid out tap by tap on the stack, so every tap is a
+      multiply-accumulate over contiguous split-complex bins, four bins a step
  
- 4. Metal GPU acceleration:
-    - Offload filtering to GPU for real-time processing
-    - Use MPSImageConvolution for 2D filtering
+ 2. Streams (StreamingDeepFilter): VocanaDeepFilter_Process / _ProcessComplex
+    - The last dfOrder frames' low bins live in a ring, so the taps reach back into earlier hops
+    - Real or complex coefficients; the mask is applied to the bins above dfBins in the same call
+    - Nothing allocated per frame
  
- Current performance:
- - CPU: ~1ms for 480 samples (10ms audio) on Apple Silicon
- - Target: <5ms for real-time processing ✓ ACHIEVED
+ Current performance (VocanaDeepFilterTests test_cost, 96 bins x 5 complex taps):
+ - A microsecond or two per frame on a shared x86 CI machine at -O2, against a 10 ms hop
  
- Recent optimizations:
- - Eliminated array copies in hot loop (50% faster)
- - Proper buffer management (reduced allocations)
- - Safe overflow protection
- - Comprehensive error handling
+ Remaining opportunities:
+ - Metal GPU acceleration is not worth it at this size; batching streams is (see MultiStreamEngine)
  */
@@ -1,21 +1,34 @@
 import Foundation
 import Accelerate
 import os.log
+import VocanaDSP
 
 /// ERB (Equivalent Rectangular Bandwidth) feature extraction
 /// Implements perceptually-motivated frequency analysis for audio processing
 ///
+/// Each band's triangular filter only covers a short run of bins, so the filterbank is kept
+/// banded, as the first bin, length and weights of each band, on the native VocanaERB. A frame's
+/// bands only touch the bins under them, and the log power features come out of one pass over
+/// the spectrum.
+///
 /// **Thread Safety**: This class is thread-safe after initialization.
 /// - The filterbank is immutable after init (thread-safe)  
-/// - extract() and normalize() use per-frame buffer allocation (thread-safe)
-/// - Safe for: Concurrent calls to ANY method from multiple threads
-/// - Per-frame allocation ensures no shared mutable state between calls
+/// - extract() and normalize() keep their scratch on the stack of each call (thread-safe)
+/// - Safe for: Concurrent calls to ANY method from multiple threads, on different Spectrograms
 ///
 /// **Usage Example**:
 /// ```swift
 /// let erbFeatures = ERBFeatures(numBands: 32, sampleRate: 48000, fftSize: 960)
 /// let features = erbFeatures.extract(spectrogramReal: real, spectrogramImag: imag)
 /// let normalized = erbFeatures.normalize(features, alpha: 0.6)
+///
+/// // Or row by row between Spectrograms, with nothing allocated per frame
+/// erbFeatures.extract(spectrum, into: bands)
+/// erbFeatures.normalize(bands, alpha: 0.6)
+///
+/// // Band levels in dB, and a mask of band gains back to every bin
+/// erbFeatures.extractLevels(spectrum, into: levels)
+/// let binMask = erbFeatures.expandMask(bandMask)
 /// ```
 final class ERBFeatures {
     // MARK: - Configuration
@@ -23,40 +36,10 @@ final class ERBFeatures {
     private let numBands: Int
     private let sampleRate: Int
     private let fftSize: Int
-    private let erbFilterbank: [[Float]]
+    private let numFreqBins: Int
+    private let filterbank: UnsafeMutablePointer<VocanaERB>  // Banded, immutable after init
     private let centerFreqs: [Float]  // Cached center frequencies
     
-    // Fix CRITICAL: Remove unused instance variable that suggests unsafe buffer reuse
-    // Documentation claims thread-safe but buffer reuse would cause races
-    // Current implementation correctly uses local buffers - keeping it that way
-    
-    private struct NormalizeBuffers {
-        var meanArray: [Float]
-        var centered: [Float]
-        var normalizedFrame: [Float]
-    }
-    
-    // Reusable buffers for extract method to reduce allocation overhead
-    // Thread-local storage ensures thread safety
-    private struct ExtractBuffers {
-        var magnitudeSpectrum: [Float]
-        var realSquared: [Float]
-        var imagSquared: [Float]
-        var sqrtResult: [Float]
-        var erbFrame: [Float]
-        
-        init(spectrumSize: Int, numBands: Int) {
-            self.magnitudeSpectrum = [Float](repeating: 0, count: spectrumSize)
-            self.realSquared = [Float](repeating: 0, count: spectrumSize)
-            self.imagSquared = [Float](repeating: 0, count: spectrumSize)
-            self.sqrtResult = [Float](repeating: 0, count: spectrumSize)
-            self.erbFrame = [Float](repeating: 0, count: numBands)
-        }
-    }
-    
-    // Note: Removed shared buffer state to eliminate thread safety issues.
-    // Extract method now uses local buffers for thread safety.
-    
     // Logging
     private static let logger = Logger(subsystem: "com.vocana.ml", category: "ERBFeatures")
     
@@ -73,35 +56,44 @@ final class ERBFeatures {
         self.numBands = numBands
         self.sampleRate = sampleRate
         self.fftSize = fftSize
+        self.numFreqBins = fftSize / 2 + 1
         
         // Generate ERB filterbank (moved to background if called from main thread)
-        let (filterbank, centers) = ERBFeatures.generateERBFilterbank(
+        let bands = ERBFeatures.generateERBFilterbank(
             numBands: numBands,
             sampleRate: sampleRate,
             fftSize: fftSize
         )
-        self.erbFilterbank = filterbank
-        self.centerFreqs = centers
+        self.filterbank = UnsafeMutablePointer<VocanaERB>.allocate(capacity: 1)
+        let status = VocanaERB_Init(filterbank, UInt32(numFreqBins), UInt32(numBands), bands.starts, bands.lengths, bands.weights)
+        guard status == 0 else {
+            filterbank.deallocate()
+            preconditionFailure("VocanaERB_Init failed with \(status) for \(numBands) bands of \(numFreqBins) bins")
+        }
+        self.centerFreqs = bands.centers
+    }
+    
+    deinit {
+        VocanaERB_Teardown(filterbank)
+        filterbank.deallocate()
     }
     
     // MARK: - ERB Filterbank Generation
     
+    /// A banded filterbank: each band's first bin, the number of bins it covers and their weights
+    private struct BandedFilterbank {
+        var starts: [UInt32] = []
+        var lengths: [UInt32] = []
+        var weights: [Float] = []  // Every band's weights, back to back
+        var centers: [Float] = []
+    }
+    
     /// Generate ERB filterbank based on human auditory perception
     /// ERB scale approximates the frequency resolution of the human ear
-    /// - Returns: Tuple of (filterbank, center frequencies)
-    private static func generateERBFilterbank(numBands: Int, sampleRate: Int, fftSize: Int) -> ([[Float]], [Float]) {
+    /// - Returns: Each band's run of nonzero weights, and the center frequencies
+    private static func generateERBFilterbank(numBands: Int, sampleRate: Int, fftSize: Int) -> BandedFilterbank {
         let numFreqBins = fftSize / 2 + 1
         
-        // Fix HIGH: More realistic memory usage validation based on actual ML models
-        let estimatedMemoryBytes = numBands * numFreqBins * MemoryLayout<Float>.size
-        let estimatedMemoryMB = estimatedMemoryBytes / (1024 * 1024)
-        // DeepFilterNet models typically use 32 bands × 481 bins = ~60KB, allow headroom for larger models
-        let maxMemoryMB = AppConstants.maxFilterbankMemoryMB // Prevent abuse while allowing large models
-        precondition(estimatedMemoryMB < maxMemoryMB, 
-                    "Filterbank would require \(estimatedMemoryMB)MB (max: \(maxMemoryMB)MB)")
-        
-        Self.logger.debug("Generating ERB filterbank: \(numBands) bands × \(numFreqBins) bins = \(estimatedMemoryMB)MB")
-        
         // Frequency range: 0 to Nyquist
         let nyquistFreq = Float(sampleRate) / 2.0
         let freqResolution = Float(sampleRate) / Float(fftSize)
@@ -114,44 +106,47 @@ final class ERBFeatures {
         let minERB = frequencyToERB(minFreq)
         let maxERB = frequencyToERB(maxFreq)
         
-        // ERB center frequencies (linearly spaced in ERB scale)
-        var erbCenters = [Float]()
-        erbCenters.reserveCapacity(numBands)
-        
         // Fix MEDIUM: Handle numBands == 1 case
         let stepSize = numBands > 1 ? (maxERB - minERB) / Float(numBands - 1) : 0.0
         
-        for i in 0..<numBands {
-            let erbValue = minERB + Float(i) * stepSize
-            let freqValue = erbToFrequency(erbValue)
-            erbCenters.append(freqValue)
-        }
+        var filterbank = BandedFilterbank()
+        filterbank.starts.reserveCapacity(numBands)
+        filterbank.lengths.reserveCapacity(numBands)
+        filterbank.centers.reserveCapacity(numBands)
         
-        // Build filterbank
-        var filterbank = [[Float]]()
-        filterbank.reserveCapacity(numBands)
-        
-        for centerFreq in erbCenters {
-            var filter = [Float](repeating: 0, count: numFreqBins)
+        for i in 0..<numBands {
+            // ERB center frequencies (linearly spaced in ERB scale)
+            let centerFreq = erbToFrequency(minERB + Float(i) * stepSize)
+            filterbank.centers.append(centerFreq)
             
             // Calculate ERB bandwidth
             let bandwidth = erbBandwidth(centerFreq)
             
-            // Generate triangular filter
-            for bin in 0..<numFreqBins {
-                let freq = Float(bin) * freqResolution
-                
-                // Triangular filter centered at centerFreq
-                let distance = abs(freq - centerFreq)
-                if distance < bandwidth {
-                    filter[bin] = max(0, 1.0 - distance / bandwidth)
+            // Triangular filter centered at centerFreq, over the bins within a bandwidth of it
+            let lowestBin = max(0, Int(((centerFreq - bandwidth) / freqResolution).rounded(.down)))
+            let highestBin = min(numFreqBins - 1, Int(((centerFreq + bandwidth) / freqResolution).rounded(.up)))
+            var filter: [Float] = []
+            var firstBin = 0
+            if lowestBin <= highestBin {
+                for bin in lowestBin...highestBin {
+                    let distance = abs(Float(bin) * freqResolution - centerFreq)
+                    let weight = distance < bandwidth ? max(0, 1.0 - distance / bandwidth) : 0
+                    
+                    // Keep only the run from the first nonzero weight to the last
+                    if filter.isEmpty {
+                        guard weight > 0 else { continue }
+                        firstBin = bin
+                    }
+                    filter.append(weight)
                 }
             }
+            while let last = filter.last, last == 0 {
+                filter.removeLast()
+            }
             
             // Normalize filter to sum to 1 using vDSP
             var filterSum: Float = 0
             vDSP_sve(filter, 1, &filterSum, vDSP_Length(filter.count))
-            
             if filterSum > Float.leastNormalMagnitude {
                 // Fix CRITICAL: Use separate output array to avoid in-place operation issues
                 var normalized = filter
@@ -163,10 +158,18 @@ final class ERBFeatures {
                 assert(filter.allSatisfy({ $0.isFinite }), "Filter contains NaN or Inf")
             }
             
-            filterbank.append(filter)
+            filterbank.starts.append(UInt32(firstBin))
+            filterbank.lengths.append(UInt32(filter.count))
+            filterbank.weights.append(contentsOf: filter)
         }
         
-        return (filterbank, erbCenters)
+        // Fix HIGH: Memory usage validation, on the weights actually kept
+        let memoryMB = filterbank.weights.count * MemoryLayout<Float>.size / (1024 * 1024)
+        precondition(memoryMB < AppConstants.maxFilterbankMemoryMB,
+                    "Filterbank would require \(memoryMB)MB (max: \(AppConstants.maxFilterbankMemoryMB)MB)")
+        Self.logger.debug("Generated ERB filterbank: \(numBands) bands, \(filterbank.weights.count) weights over \(numFreqBins) bins")
+        
+        return filterbank
     }
     
     // MARK: - ERB Scale Conversions
@@ -223,96 +226,156 @@ final class ERBFeatures {
             return []
         }
         
-        let numFrames = spectrogramReal.count
-        
         // Fix HIGH: Validate frame dimensions match expected fftSize
-        let expectedBins = fftSize / 2 + 1
-        if let firstFrame = spectrogramReal.first, firstFrame.count != expectedBins {
-            Self.logger.warning("Spectrogram frame size \(firstFrame.count) doesn't match expected \(expectedBins)")
+        if let firstFrame = spectrogramReal.first, firstFrame.count != numFreqBins {
+            Self.logger.warning("Spectrogram frame size \(firstFrame.count) doesn't match expected \(self.numFreqBins)")
         }
         
         var erbFeatures: [[Float]] = []
-        erbFeatures.reserveCapacity(numFrames)
-        
-        // OPTIMIZED: Use reusable buffers to reduce allocation overhead
-        // Thread safety: Use local buffers for each extract() call to ensure thread safety
-        let spectrumSize = fftSize / 2 + 1
-        var magnitudeSpectrum = [Float](repeating: 0, count: spectrumSize)
-        var realSquared = [Float](repeating: 0, count: spectrumSize)
-        var imagSquared = [Float](repeating: 0, count: spectrumSize)
-        var sqrtResult = [Float](repeating: 0, count: spectrumSize)
-        var erbFrame = [Float](repeating: 0, count: numBands)
+        erbFeatures.reserveCapacity(spectrogramReal.count)
+        var magnitude = [Float](repeating: 0, count: numFreqBins)
         
-        for frameIndex in 0..<numFrames {
-            let realPart = spectrogramReal[frameIndex]
-            let imagPart = spectrogramImag[frameIndex]
+        for (realPart, imagPart) in zip(spectrogramReal, spectrogramImag) {
+            var erbFrame = [Float](repeating: 0, count: numBands)
             
-            // Fix CRITICAL: Consistent error handling - skip bad frame but log
-            guard realPart.count == imagPart.count else {
-                Self.logger.error("Frame \(frameIndex) dimension mismatch: real=\(realPart.count), imag=\(imagPart.count)")
-                // Skip this frame to maintain count consistency
-                erbFeatures.append([Float](repeating: 0, count: numBands))
+            // Fix CRITICAL: Consistent error handling - a bad frame comes out as zeros, keeping the frame count
+            guard realPart.count == imagPart.count, realPart.count == numFreqBins else {
+                Self.logger.error("Frame dimension mismatch: real=\(realPart.count), imag=\(imagPart.count), expected \(self.numFreqBins)")
+                erbFeatures.append(erbFrame)
                 continue
             }
             
-            // OPTIMIZED: Reuse pre-allocated buffers instead of allocating per frame
-            
-            // Calculate magnitude using Accelerate framework (much faster)
-            let length = vDSP_Length(realPart.count)
-            vDSP_vsq(realPart, 1, &realSquared, 1, length)
-            vDSP_vsq(imagPart, 1, &imagSquared, 1, length)
-            vDSP_vadd(realSquared, 1, imagSquared, 1, &magnitudeSpectrum, 1, length)
-            
-            // Fix HIGH: Int32 overflow protection for vvsqrtf
-            guard magnitudeSpectrum.count < Int32.max else {
-                Self.logger.error("Buffer too large for vvsqrtf: \(magnitudeSpectrum.count)")
-                // Skip this frame or use fallback
-                erbFeatures.append([Float](repeating: 0, count: numBands))
-                continue
-            }
-
-            // Fix HIGH: NaN/Inf protection for vvsqrtf
-            // Check for invalid values that could cause vvsqrtf to produce NaN
-            let hasInvalidValues = magnitudeSpectrum.contains { !$0.isFinite || $0 < 0 }
-            if hasInvalidValues {
-                Self.logger.warning("Invalid magnitude values detected, skipping sqrt computation")
-                erbFeatures.append([Float](repeating: 0, count: numBands))
-                continue
-            }
-
-            var count = Int32(magnitudeSpectrum.count)
-            vvsqrtf(&sqrtResult, magnitudeSpectrum, &count)
-            
-            // Apply ERB filterbank using vDSP dot product (much faster)
-            // Clear erbFrame for reuse
-            vDSP_vclr(&erbFrame, 1, vDSP_Length(numBands))
-            for (bandIndex, filter) in erbFilterbank.enumerated() {
-                var bandEnergy: Float = 0
-                
-                // Fix CRITICAL: Guard instead of assert to prevent silent corruption in release
-                let filterLen = filter.count
-                let magLen = sqrtResult.count
-                guard filterLen == magLen else {
-                    Self.logger.error("Filter/magnitude size mismatch: \(filterLen) vs \(magLen)")
-                    erbFrame[bandIndex] = 0
-                    continue
+            realPart.withUnsafeBufferPointer { realBuffer in
+                imagPart.withUnsafeBufferPointer { imagBuffer in
+                    magnitude.withUnsafeMutableBufferPointer { magnitudeBuffer in
+                        erbFrame.withUnsafeMutableBufferPointer { erbBuffer in
+                            if !bandEnergies(real: realBuffer.baseAddress!, imag: imagBuffer.baseAddress!,
+                                             magnitude: magnitudeBuffer.baseAddress!, into: erbBuffer.baseAddress!) {
+                                erbBuffer.update(repeating: 0)
+                            }
+                        }
+                    }
                 }
-                
-                vDSP_dotpr(filter, 1, sqrtResult, 1, &bandEnergy, vDSP_Length(filterLen))
-                erbFrame[bandIndex] = bandEnergy
             }
-            
-            // Copy the erbFrame to avoid reference sharing
-            erbFeatures.append(Array(erbFrame))
+            erbFeatures.append(erbFrame)
         }
         
         return erbFeatures
     }
     
+    /// Extract ERB features of every frame of a spectrogram into the rows of another
+    ///
+    /// Nothing is allocated per frame: the magnitudes go through one scratch row on the stack,
+    /// and each frame's bands are written straight into its row of `bands`.
+    ///
+    /// - Parameters:
+    ///   - spectrum: Complex spectrogram [numFrames, fftSize/2 + 1]
+    ///   - bands: Real spectrogram of `numBands` bins; its frame count is set to the spectrum's
+    func extract(_ spectrum: Spectrogram, into bands: Spectrogram) {
+        precondition(spectrum.isComplex && spectrum.binCount == numFreqBins,
+                    "ERB features need a complex spectrogram of \(numFreqBins) bins, got \(spectrum.binCount)")
+        precondition(!bands.isComplex && bands.binCount == numBands,
+                    "ERB features go into a real spectrogram of \(numBands) bins, got \(bands.binCount)")
+        
+        bands.frameCount = spectrum.frameCount
+        withUnsafeTemporaryAllocation(of: Float.self, capacity: numFreqBins) { magnitude in
+            for frame in 0..<spectrum.frameCount {
+                let row = bands.real(frame)
+                if !bandEnergies(real: spectrum.real(frame), imag: spectrum.imag(frame), magnitude: magnitude.baseAddress!, into: row) {
+                    row.update(repeating: 0, count: numBands)
+                }
+            }
+        }
+    }
+    
+    /// Band energies of one frame: its magnitude spectrum through the filterbank
+    /// - Parameters:
+    ///   - real: Real parts, `numFreqBins` bins
+    ///   - imag: Imaginary parts, `numFreqBins` bins
+    ///   - magnitude: Scratch of `numFreqBins` floats
+    ///   - bands: Receives `numBands` energies
+    /// - Returns: false if the frame has values that aren't finite
+    private func bandEnergies(real: UnsafePointer<Float>, imag: UnsafePointer<Float>,
+                              magnitude: UnsafeMutablePointer<Float>, into bands: UnsafeMutablePointer<Float>) -> Bool {
+        var split = DSPSplitComplex(realp: UnsafeMutablePointer(mutating: real), imagp: UnsafeMutablePointer(mutating: imag))
+        vDSP_zvabs(&split, 1, magnitude, 1, vDSP_Length(numFreqBins))
+        
+        // Fix HIGH: NaN/Inf protection - a bad bin spreads through every band it is in
+        guard VocanaERB_Sum(filterbank, magnitude, bands) else {
+            Self.logger.warning("Invalid magnitude values detected, skipping frame")
+            return false
+        }
+        return true
+    }
+    
+    /// Band levels of every frame of a spectrogram in dB, 10 log10 of each band's weighted power
+    ///
+    /// The power, the band sums and the logs are one pass over each frame's bins, with no power
+    /// spectrum in between. These are DeepFilterNet's ERB features before normalization. A frame
+    /// with values that aren't finite comes out as silence.
+    ///
+    /// - Parameters:
+    ///   - spectrum: Complex spectrogram [numFrames, fftSize/2 + 1]
+    ///   - levels: Real spectrogram of `numBands` bins; its frame count is set to the spectrum's
+    func extractLevels(_ spectrum: Spectrogram, into levels: Spectrogram) {
+        precondition(spectrum.isComplex && spectrum.binCount == numFreqBins,
+                    "ERB features need a complex spectrogram of \(numFreqBins) bins, got \(spectrum.binCount)")
+        precondition(!levels.isComplex && levels.binCount == numBands,
+                    "ERB levels go into a real spectrogram of \(numBands) bins, got \(levels.binCount)")
+        
+        levels.frameCount = spectrum.frameCount
+        for frame in 0..<spectrum.frameCount {
+            let row = levels.real(frame)
+            if !VocanaERB_LogPower(filterbank, spectrum.real(frame), spectrum.imag(frame), row) {
+                Self.logger.warning("Invalid spectrum values detected, treating frame as silence")
+                row.update(repeating: Self.silenceLevel, count: numBands)
+            }
+        }
+    }
+    
+    /// Level of a band with no power, 10 log10 of the floor extractLevels adds
+    static let silenceLevel: Float = -100
+    
+    // MARK: - Mask Expansion
+    
+    /// Expand a mask of band gains to a gain for every bin
+    ///
+    /// Each bin gets the average of the gains of the bands over it, weighted by their filters
+    /// there, so equal band gains give that gain in every bin. Bins no band covers take the gain of
+    /// the nearest band.
+    ///
+    /// - Parameter gains: Band gains [numFrames, numBands]
+    /// - Returns: Bin gains [numFrames, fftSize/2 + 1]
+    func expandMask(_ gains: [Float]) -> [Float] {
+        precondition(gains.count % numBands == 0,
+                    "Band gains must be whole frames of \(numBands) bands, got \(gains.count)")
+        
+        let numFrames = gains.count / numBands
+        var mask = [Float](repeating: 0, count: numFrames * numFreqBins)
+        gains.withUnsafeBufferPointer { gainBuffer in
+            mask.withUnsafeMutableBufferPointer { maskBuffer in
+                for frame in 0..<numFrames {
+                    VocanaERB_ExpandGains(filterbank,
+                                          gainBuffer.baseAddress! + frame * numBands,
+                                          maskBuffer.baseAddress! + frame * numFreqBins)
+                }
+            }
+        }
+        return mask
+    }
+    
+    /// Number of bands
+    var bandCount: Int {
+        return numBands
+    }
+    
     // MARK: - Normalization
     
     /// Apply unit normalization with alpha parameter
     /// This matches the libdf normalization: unit_norm(x, alpha)
+    ///
+    /// Each frame is normalized on its own, with nothing kept between calls. A stream's running
+    /// normalization, carried from one call to the next, is FeatureNormalizer.
     /// - Parameters:
     ///   - features: Input features [numFrames, numBands]
     ///   - alpha: Normalization parameter (default from DeepFilterNet)
@@ -329,57 +392,56 @@ final class ERBFeatures {
             return []
         }
         
-        var normalized: [[Float]] = []
-        normalized.reserveCapacity(features.count)
+        return features.map { frame in
+            var normalizedFrame = frame
+            normalizedFrame.withUnsafeMutableBufferPointer { buffer in
+                Self.normalizeRow(buffer.baseAddress!, count: buffer.count, alpha: alpha)
+            }
+            return normalizedFrame
+        }
+    }
+    
+    /// Apply unit normalization to every frame of a spectrogram of features, in place
+    /// - Parameters:
+    ///   - features: Real spectrogram [numFrames, numBands]
+    ///   - alpha: Normalization parameter (default from DeepFilterNet)
+    func normalize(_ features: Spectrogram, alpha: Float = 0.6) {
+        // Fix MEDIUM: Validate alpha parameter
+        precondition(alpha > 0 && alpha <= 10, "Alpha must be in range (0, 10], got \(alpha)")
+        
+        for frame in 0..<features.frameCount {
+            Self.normalizeRow(features.real(frame), count: features.binCount, alpha: alpha)
+        }
+    }
+    
+    /// Unit normalization of one frame in place: (x - mean) / std * alpha
+    private static func normalizeRow(_ row: UnsafeMutablePointer<Float>, count: Int, alpha: Float) {
+        let length = vDSP_Length(count)
         
-        // Fix HIGH: Allocate buffers per-frame for thread safety instead of reusing
-        // This ensures normalize() is safe for concurrent calls
+        // Fix CRITICAL #7: Remove redundant mean subtraction
+        // Calculate mean once, then center in place
+        var mean: Float = 0
+        vDSP_meanv(row, 1, &mean, length)
+        var meanNeg = -mean
+        vDSP_vsadd(row, 1, &meanNeg, row, 1, length)
         
-        for frame in features {
-            // Per-frame buffer allocation
-            let frameSize = frame.count
-            var centered = [Float](repeating: 0, count: frameSize)
-            var normalizedFrame = [Float](repeating: 0, count: frameSize)
-            // Fix CRITICAL #7: Remove redundant mean subtraction
-            // Calculate mean once
-            var mean: Float = 0
-            vDSP_meanv(frame, 1, &mean, vDSP_Length(frame.count))
-            
-            // Calculate centered values: centered = frame - mean
-            var meanNeg = -mean
-            vDSP_vsadd(frame, 1, &meanNeg, &centered, 1, vDSP_Length(frame.count))
-            
-            // Calculate variance from centered values
-            var centeredSquared = [Float](repeating: 0, count: frameSize)
-            vDSP_vsq(centered, 1, &centeredSquared, 1, vDSP_Length(frame.count))
-            
-            var variance: Float = 0
-            vDSP_meanv(centeredSquared, 1, &variance, vDSP_Length(frame.count))
-            
-            // Fix HIGH: Simplified variance handling - use max() which handles negative/NaN
-            let epsilon: Float = 1e-6
-            let validVariance: Float
-            if variance.isNaN || variance.isInfinite {
-                Self.logger.error("Invalid variance: \(variance), using epsilon fallback")
-                validVariance = epsilon
-            } else {
-                validVariance = max(variance, epsilon)
-            }
-            
-            let std = sqrt(validVariance)
-            
-            // Unit normalization: centered / std (already have centered = x - mean)
-            var divisor = std
-            vDSP_vsdiv(centered, 1, &divisor, &normalizedFrame, 1, vDSP_Length(frame.count))
-            
-            // Apply alpha scaling
-            var alphaScalar = alpha
-            vDSP_vsmul(normalizedFrame, 1, &alphaScalar, &normalizedFrame, 1, vDSP_Length(frame.count))
-            
-            normalized.append(normalizedFrame)
+        // Variance is the mean square of the centered values
+        var variance: Float = 0
+        vDSP_measqv(row, 1, &variance, length)
+        
+        // Fix HIGH: Simplified variance handling - use max() which handles negative/NaN
+        let epsilon: Float = 1e-6
+        let validVariance: Float
+        if variance.isNaN || variance.isInfinite {
+            logger.error("Invalid variance: \(variance), using epsilon fallback")
+            validVariance = epsilon
+        } else {
+            validVariance = max(variance, epsilon)
         }
         
-        return normalized
+        // Unit normalization and alpha scaling in one pass: centered * (alpha / std)
+        var scale = alpha / sqrt(validVariance)
+        vDSP_vsmul(row, 1, &scale, row, 1, length)
     }
     
     // MARK: - Utilities
@@ -0,0 +1,200 @@
+import Foundation
+import VocanaDSP
+
+/// Running normalization of one kind of feature for one stream, on the native VocanaNormalizer
+///
+/// ERBFeatures.normalize and SpectralFeatures.normalize normalize whatever frames they are given
+/// against each other, so a stream fed a chunk at a time starts over with every chunk. A
+/// FeatureNormalizer keeps DeepFilterNet's exponentially smoothed state for as long as the stream
+/// lasts and moves it a frame at a time, so the features don't depend on how the stream is split
+/// into calls.
+///
+/// `snapshot()` and `restore(_:)` carry the state to another normalizer, for a stream moving to
+/// another engine or picked up again after a restart, so the model doesn't see a second of
+/// features from a state converging again.
+///
+/// **Thread Safety**: Not thread-safe. A FeatureNormalizer belongs to one stream and is used by
+/// one thread at a time.
+final class FeatureNormalizer {
+    enum Kind: String, Codable {
+        /// Levels in dB less their running mean, over 40 (DeepFilterNet's ERB feature normalization)
+        case mean
+        /// Complex bins over the square root of their running mean magnitude (DeepFilterNet's
+        /// deep filtering feature normalization)
+        case unit
+    }
+
+    /// The state of a normalizer, taken by snapshot() and put back by restore(_:)
+    struct Snapshot: Codable, Equatable {
+        let kind: Kind
+        let state: [Float]
+    }
+
+    enum NormalizerError: Error, LocalizedError {
+        case incompatibleSnapshot(String)
+
+        var errorDescription: String? {
+            switch self {
+            case .incompatibleSnapshot(let message):
+                return "Incompatible normalization snapshot: \(message)"
+            }
+        }
+    }
+
+    let kind: Kind
+    let count: Int
+
+    private let normalizer: UnsafeMutablePointer<VocanaNormalizer>
+
+    /// - Parameters:
+    ///   - kind: Which normalization
+    ///   - count: Values per frame
+    ///   - alpha: Share of the state kept from one frame to the next, in [0, 1)
+    ///   - initialFirst: Initial state of the first value; the initial state ramps linearly
+    ///   - initialLast: Initial state of the last value
+    init(kind: Kind, count: Int, alpha: Float, initialFirst: Float, initialLast: Float) {
+        precondition(count > 0 && count <= Int(kVocanaNormalizer_MaxCount),
+                    "Count must be in range [1, \(kVocanaNormalizer_MaxCount)], got \(count)")
+        precondition(alpha >= 0 && alpha < 1, "Alpha must be in range [0, 1), got \(alpha)")
+
+        self.kind = kind
+        self.count = count
+        self.normalizer = UnsafeMutablePointer<VocanaNormalizer>.allocate(capacity: 1)
+        let nativeKind = kind == .mean ? kVocanaNormalizer_Mean : kVocanaNormalizer_Unit
+        let status = VocanaNormalizer_Init(normalizer, nativeKind, UInt32(count), alpha, initialFirst, initialLast)
+        guard status == 0 else {
+            normalizer.deallocate()
+            preconditionFailure("VocanaNormalizer_Init failed with \(status) for \(count) values, initial state \(initialFirst) to \(initialLast)")
+        }
+    }
+
+    deinit {
+        VocanaNormalizer_Teardown(normalizer)
+        normalizer.deallocate()
+    }
+
+    /// Forget the stream, going back to the initial state
+    func reset() {
+        VocanaNormalizer_Reset(normalizer)
+    }
+
+    // MARK: - Normalization
+
+    /// Mean normalization of the next frame
+    /// - Parameters:
+    ///   - levels: `count` levels in dB
+    ///   - features: Receives `count` features; may be `levels`
+    func normalize(levels: UnsafePointer<Float>, into features: UnsafeMutablePointer<Float>) {
+        precondition(kind == .mean, "Levels take a mean normalizer")
+        VocanaNormalizer_NormalizeMean(normalizer, levels, features)
+    }
+
+    /// Unit normalization of the next frame
+    /// - Parameters:
+    ///   - real: Real parts of `count` bins
+    ///   - imag: Imaginary parts of `count` bins
+    ///   - outReal: Receives the normalized real parts; may be `real`
+    ///   - outImag: Receives the normalized imaginary parts; may be `imag`
+    func normalize(real: UnsafePointer<Float>, imag: UnsafePointer<Float>,
+                   intoReal outReal: UnsafeMutablePointer<Float>, intoImag outImag: UnsafeMutablePointer<Float>) {
+        precondition(kind == .unit, "Complex bins take a unit normalizer")
+        VocanaNormalizer_NormalizeUnit(normalizer, real, imag, outReal, outImag)
+    }
+
+    /// Normalize every frame of a spectrogram in place, in order, as the next frames of the stream
+    ///
+    /// A mean normalizer takes a real spectrogram of levels, a unit normalizer a complex one.
+    func normalize(_ features: Spectrogram) {
+        precondition(features.binCount == count, "Spectrogram has \(features.binCount) bins, normalizer has \(count)")
+        precondition(features.isComplex == (kind == .unit),
+                    "A \(kind) normalizer takes a \(kind == .unit ? "complex" : "real") spectrogram")
+
+        for frame in 0..<features.frameCount {
+            switch kind {
+            case .mean:
+                VocanaNormalizer_NormalizeMean(normalizer, features.real(frame), features.real(frame))
+            case .unit:
+                VocanaNormalizer_NormalizeUnit(normalizer, features.real(frame), features.imag(frame),
+                                               features.real(frame), features.imag(frame))
+            }
+        }
+    }
+
+    // MARK: - Snapshots
+
+    /// The state as it stands
+    func snapshot() -> Snapshot {
+        var state = [Float](repeating: 0, count: count)
+        state.withUnsafeMutableBufferPointer { buffer in
+            VocanaNormalizer_GetState(normalizer, buffer.baseAddress!)
+        }
+        return Snapshot(kind: kind, state: state)
+    }
+
+    /// Carry on from a snapshot, of this normalizer or another of the same kind and size
+    /// - Throws: NormalizerError.incompatibleSnapshot, leaving the state as it was, if the
+    ///   snapshot is of another kind or size or holds values the normalization can't have
+    func restore(_ snapshot: Snapshot) throws {
+        guard snapshot.kind == kind, snapshot.state.count == count else {
+            throw NormalizerError.incompatibleSnapshot(
+                "\(snapshot.kind) of \(snapshot.state.count) values into \(kind) of \(count)"
+            )
+        }
+        let status = snapshot.state.withUnsafeBufferPointer { buffer in
+            VocanaNormalizer_SetState(normalizer, buffer.baseAddress!, UInt32(buffer.count))
+        }
+        guard status == 0 else {
+            throw NormalizerError.incompatibleSnapshot("\(kind) state holds invalid values")
+        }
+    }
+}
+
+/// DeepFilterNet's normalization of both of its features, for one stream
+///
+/// **Thread Safety**: Not thread-safe, like the normalizers it holds.
+final class FeatureNormalization {
+    /// The state of both normalizers
+    struct Snapshot: Codable, Equatable {
+        let erb: FeatureNormalizer.Snapshot
+        let spectral: FeatureNormalizer.Snapshot
+    }
+
+    /// ERB band levels, mean normalized
+    let erb: FeatureNormalizer
+
+    /// Deep filtering bins, unit normalized
+    let spectral: FeatureNormalizer
+
+    /// - Parameters:
+    ///   - erbBands: ERB bands
+    ///   - dfBands: Deep filtering bins
+    ///   - alpha: Share of the state kept from one frame to the next
+    init(erbBands: Int = AppConstants.erbBands, dfBands: Int = AppConstants.dfBands, alpha: Float) {
+        // DeepFilterNet's initial states, from loud low bands to quiet high ones
+        self.erb = FeatureNormalizer(kind: .mean, count: erbBands, alpha: alpha, initialFirst: -60, initialLast: -90)
+        self.spectral = FeatureNormalizer(kind: .unit, count: dfBands, alpha: alpha, initialFirst: 0.001, initialLast: 0.0001)
+    }
+
+    /// Forget the stream, going back to the initial states
+    func reset() {
+        erb.reset()
+        spectral.reset()
+    }
+
+    func snapshot() -> Snapshot {
+        return Snapshot(erb: erb.snapshot(), spectral: spectral.snapshot())
+    }
+
+    /// Carry on from a snapshot, both normalizers or neither
+    /// - Throws: FeatureNormalizer.NormalizerError.incompatibleSnapshot, leaving both as they were
+    func restore(_ snapshot: Snapshot) throws {
+        let previous = erb.snapshot()
+        try erb.restore(snapshot.erb)
+        do {
+            try spectral.restore(snapshot.spectral)
+        } catch {
+            try? erb.restore(previous)
+            throw error
+        }
+    }
+}
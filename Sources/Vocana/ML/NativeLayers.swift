@@ -0,0 +1,276 @@
+import Foundation
+import VocanaDSP
+
+// MARK: - Packed Layers
+
+/// A dense layer with its weights packed for the native VocanaLayers engine
+///
+/// LinearLayer keeps its weights as an array of rows and sums them a product at a time. A
+/// PackedLinear packs them once into panels of output rows stored input by input, so a forward pass
+/// reads the weights front to back and works on a panel of outputs at once, with the bias and the
+/// activation applied as the outputs are stored.
+///
+/// **Thread Safety**: Immutable once packed; safe to use from several threads.
+final class PackedLinear {
+    let inputSize: Int
+    let outputSize: Int
+
+    private let dense: UnsafeMutablePointer<VocanaDense>
+
+    /// - Parameters:
+    ///   - weights: Row-major weights, [outputSize][inputSize]
+    ///   - biases: `outputSize` biases, or nil for none
+    init(inputSize: Int, outputSize: Int, weights: [Float], biases: [Float]?) {
+        precondition(weights.count == inputSize * outputSize, "Weights must be \(outputSize) x \(inputSize), got \(weights.count)")
+        precondition(biases == nil || biases!.count == outputSize, "Biases must be \(outputSize), got \(biases!.count)")
+
+        self.inputSize = inputSize
+        self.outputSize = outputSize
+        self.dense = UnsafeMutablePointer<VocanaDense>.allocate(capacity: 1)
+        let status = weights.withUnsafeBufferPointer { weightBuffer in
+            withOptionalPointer(biases) { bias in
+                VocanaDense_Init(dense, UInt32(inputSize), UInt32(outputSize), weightBuffer.baseAddress!, bias)
+            }
+        }
+        guard status == 0 else {
+            dense.deallocate()
+            preconditionFailure("VocanaDense_Init failed with \(status) for \(inputSize) -> \(outputSize)")
+        }
+    }
+
+    /// Pack a LinearLayer's weights
+    convenience init(_ layer: LinearLayer) {
+        self.init(inputSize: layer.inputSize, outputSize: layer.outputSize,
+                  weights: Array(layer.weights.joined()), biases: layer.biases)
+    }
+
+    deinit {
+        VocanaDense_Teardown(dense)
+        dense.deallocate()
+    }
+
+    /// - Parameters:
+    ///   - input: `inputSize` inputs
+    ///   - output: Receives `outputSize` outputs; not `input`
+    ///   - activation: Applied to every output
+    func forward(_ input: UnsafePointer<Float>, into output: UnsafeMutablePointer<Float>,
+                 activation: VocanaActivation = kVocanaActivation_None) {
+        VocanaDense_Forward(dense, input, output, activation)
+    }
+
+    /// The layer on the first `inputSize` values of an input, as LinearLayer.forward
+    /// - Throws: ONNXError.invalidInput if the input is too short
+    func forward(_ input: [Float], activation: VocanaActivation = kVocanaActivation_None) throws -> [Float] {
+        guard input.count >= inputSize else {
+            throw ONNXError.invalidInput("Input size \(input.count) < expected \(inputSize)")
+        }
+        var output = [Float](repeating: 0, count: outputSize)
+        input.withUnsafeBufferPointer { inputBuffer in
+            output.withUnsafeMutableBufferPointer { outputBuffer in
+                forward(inputBuffer.baseAddress!, into: outputBuffer.baseAddress!, activation: activation)
+            }
+        }
+        return output
+    }
+}
+
+/// A valid, unpadded 1D convolution with its kernels packed for VocanaLayers
+///
+/// Each output position's window of every input channel goes through the kernels as one packed
+/// dense layer, with the activation fused into the store.
+///
+/// **Thread Safety**: Not thread-safe; the convolution keeps its window scratch in the layer.
+final class PackedConv1D {
+    let inputChannels: Int
+    let outputChannels: Int
+    let kernelSize: Int
+    let stride: Int
+    let activation: VocanaActivation
+
+    private let conv: UnsafeMutablePointer<VocanaConv1D>
+
+    /// - Parameters:
+    ///   - weights: [outputChannels][inputChannels][kernelSize]
+    ///   - biases: `outputChannels` biases, or nil for none
+    ///   - activation: Applied to every output
+    init(inputChannels: Int, outputChannels: Int, kernelSize: Int, stride: Int,
+         weights: [Float], biases: [Float]?, activation: VocanaActivation) {
+        precondition(weights.count == outputChannels * inputChannels * kernelSize,
+                     "Weights must be \(outputChannels) x \(inputChannels) x \(kernelSize), got \(weights.count)")
+        precondition(biases == nil || biases!.count == outputChannels, "Biases must be \(outputChannels), got \(biases!.count)")
+
+        self.inputChannels = inputChannels
+        self.outputChannels = outputChannels
+        self.kernelSize = kernelSize
+        self.stride = stride
+        self.activation = activation
+        self.conv = UnsafeMutablePointer<VocanaConv1D>.allocate(capacity: 1)
+        let status = weights.withUnsafeBufferPointer { weightBuffer in
+            withOptionalPointer(biases) { bias in
+                VocanaConv1D_Init(conv, UInt32(inputChannels), UInt32(outputChannels), UInt32(kernelSize),
+                                  UInt32(stride), weightBuffer.baseAddress!, bias)
+            }
+        }
+        guard status == 0 else {
+            conv.deallocate()
+            preconditionFailure("VocanaConv1D_Init failed with \(status) for \(inputChannels) -> \(outputChannels), kernel \(kernelSize)")
+        }
+    }
+
+    /// Pack a Conv1DLayer's kernels, with the ReLU it applies
+    convenience init(_ layer: Conv1DLayer) {
+        self.init(inputChannels: layer.inputChannels, outputChannels: layer.outputChannels,
+                  kernelSize: layer.kernelSize, stride: layer.stride,
+                  weights: Array(layer.weights.joined()), biases: layer.biases, activation: kVocanaActivation_ReLU)
+    }
+
+    deinit {
+        VocanaConv1D_Teardown(conv)
+        conv.deallocate()
+    }
+
+    /// Convolve channel-major input, [inputChannels][count / inputChannels], as Conv1DLayer.forward
+    /// - Returns: Channel-major output, [outputChannels][output length]
+    /// - Throws: ONNXError.invalidInput if the input is empty or shorter than the kernel
+    func forward(_ input: [Float]) throws -> [Float] {
+        let inputLength = input.count / inputChannels
+        guard inputLength > 0 else {
+            throw ONNXError.invalidInput("Input too small for \(inputChannels) channels")
+        }
+        guard inputLength >= kernelSize, inputLength <= Int(UInt32.max) else {
+            throw ONNXError.invalidInput("Input length \(inputLength) < kernel size \(kernelSize)")
+        }
+
+        let outputLength = Int(VocanaConv1D_GetOutputLength(conv, UInt32(inputLength)))
+        let totalOutputElements = try safeMultiply(outputChannels, outputLength)
+        try validateTensorDimensions([totalOutputElements])
+
+        var output = [Float](repeating: 0, count: totalOutputElements)
+        input.withUnsafeBufferPointer { inputBuffer in
+            output.withUnsafeMutableBufferPointer { outputBuffer in
+                VocanaConv1D_Forward(conv, inputBuffer.baseAddress!, UInt32(inputLength), outputBuffer.baseAddress!, activation)
+            }
+        }
+        return output
+    }
+}
+
+/// PyTorch's GRU with all three gates packed into one matrix for VocanaLayers
+///
+/// One pass over the packed weights gives every gate's input and hidden sums, and the gates,
+/// their polynomial activations and the new state follow in one loop. The layer holds no state:
+/// the hidden state is a slot of a LayerArena, passed in on every call.
+///
+/// **Thread Safety**: Not thread-safe; the GRU keeps its gate sums in the layer.
+final class PackedGRU {
+    let inputSize: Int
+    let hiddenSize: Int
+
+    private let gru: UnsafeMutablePointer<VocanaGRU>
+
+    /// - Parameters:
+    ///   - weights: [3 * hiddenSize][inputSize + hiddenSize], gates reset, update, new, each row
+    ///     its input weights then its hidden weights
+    ///   - inputBiases: `3 * hiddenSize` input biases, or nil for none
+    ///   - hiddenBiases: `3 * hiddenSize` hidden biases, or nil for none
+    init(inputSize: Int, hiddenSize: Int, weights: [Float], inputBiases: [Float]?, hiddenBiases: [Float]?) {
+        precondition(weights.count == 3 * hiddenSize * (inputSize + hiddenSize),
+                     "Weights must be \(3 * hiddenSize) x \(inputSize + hiddenSize), got \(weights.count)")
+        precondition(inputBiases == nil || inputBiases!.count == 3 * hiddenSize, "Input biases must be \(3 * hiddenSize)")
+        precondition(hiddenBiases == nil || hiddenBiases!.count == 3 * hiddenSize, "Hidden biases must be \(3 * hiddenSize)")
+
+        self.inputSize = inputSize
+        self.hiddenSize = hiddenSize
+        self.gru = UnsafeMutablePointer<VocanaGRU>.allocate(capacity: 1)
+        let status = weights.withUnsafeBufferPointer { weightBuffer in
+            withOptionalPointer(inputBiases) { inputBias in
+                withOptionalPointer(hiddenBiases) { hiddenBias in
+                    VocanaGRU_Init(gru, UInt32(inputSize), UInt32(hiddenSize), weightBuffer.baseAddress!, inputBias, hiddenBias)
+                }
+            }
+        }
+        guard status == 0 else {
+            gru.deallocate()
+            preconditionFailure("VocanaGRU_Init failed with \(status) for \(inputSize) -> \(hiddenSize)")
+        }
+    }
+
+    /// Pack a GRULayer's gates, its biases as the input biases
+    convenience init(_ layer: GRULayer) {
+        self.init(inputSize: layer.inputSize, hiddenSize: layer.hiddenSize,
+                  weights: Array(layer.weights.joined()), inputBiases: layer.biases, hiddenBiases: nil)
+    }
+
+    deinit {
+        VocanaGRU_Teardown(gru)
+        gru.deallocate()
+    }
+
+    /// Run every step of an input, [steps][inputSize], from the state in `hidden`
+    /// - Parameter hidden: A `hiddenSize` slot, left holding the state after the last step
+    /// - Returns: The state after every step, [steps][hiddenSize]
+    /// - Throws: ONNXError.invalidInput if the input isn't whole steps
+    func forward(_ input: [Float], hidden: UnsafeMutablePointer<Float>) throws -> [Float] {
+        guard !input.isEmpty, input.count % inputSize == 0 else {
+            throw ONNXError.invalidInput("Input size \(input.count) isn't whole steps of \(inputSize)")
+        }
+        let steps = input.count / inputSize
+        var output = [Float](repeating: 0, count: try safeMultiply(steps, hiddenSize))
+        input.withUnsafeBufferPointer { inputBuffer in
+            output.withUnsafeMutableBufferPointer { outputBuffer in
+                VocanaGRU_Forward(gru, inputBuffer.baseAddress!, UInt32(steps), hidden, outputBuffer.baseAddress!)
+            }
+        }
+        return output
+    }
+}
+
+// MARK: - Arena
+
+/// One aligned block of fixed slots for the state a session keeps between runs
+///
+/// Slots are reserved once, when the session's layers are built, and last as long as the arena,
+/// so the recurrent state is never reallocated or looked up by name, and clear() starts all of it
+/// over at once.
+///
+/// **Thread Safety**: Not thread-safe; an arena belongs to one session.
+final class LayerArena {
+    private let arena: UnsafeMutablePointer<VocanaArena>
+
+    /// - Parameter capacity: Floats, before each slot is rounded up to the alignment
+    init(capacity: Int) {
+        precondition(capacity > 0, "Arena capacity must be positive, got \(capacity)")
+        self.arena = UnsafeMutablePointer<VocanaArena>.allocate(capacity: 1)
+        let status = VocanaArena_Init(arena, capacity)
+        guard status == 0 else {
+            arena.deallocate()
+            preconditionFailure("VocanaArena_Init failed with \(status) for \(capacity) floats")
+        }
+    }
+
+    deinit {
+        VocanaArena_Teardown(arena)
+        arena.deallocate()
+    }
+
+    /// A zeroed slot of `count` floats
+    func reserve(_ count: Int) -> UnsafeMutablePointer<Float> {
+        guard let slot = VocanaArena_Reserve(arena, count) else {
+            preconditionFailure("Arena has no room for \(count) more floats")
+        }
+        return slot
+    }
+
+    /// Zero every slot
+    func clear() {
+        VocanaArena_Clear(arena)
+    }
+}
+
+/// Calls `body` with a pointer to an optional array's elements, or nil
+private func withOptionalPointer<Result>(_ array: [Float]?, _ body: (UnsafePointer<Float>?) -> Result) -> Result {
+    guard let array = array else {
+        return body(nil)
+    }
+    return array.withUnsafeBufferPointer { body($0.baseAddress) }
+}
@@ -0,0 +1,1270 @@
+/*
+ * ONNX Runtime C API Bridge for Swift
+ *
+ * Implements ONNXRuntimeBridge.h over ONNX Runtime's C API (onnxruntime_c_api.h). The bridge's
+ * opaque types are the Ort objects themselves, so wrapping a value or a session costs nothing.
+ *
+ * Build:
+ *   cc -std=gnu11 -I <onnxruntime>/include -c ONNXRuntimeBridge.c
+ *   link with -L <onnxruntime>/lib -lonnxruntime
+ */
+
+#include "ONNXRuntimeBridge.h"
+
+#include <onnxruntime_c_api.h>
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// MARK: - Runtime
+
+static const OrtApi* gOrtApi = NULL;
+static OrtMemoryInfo* gCPUMemoryInfo = NULL;
+static OrtAllocator* gDefaultAllocator = NULL;
+static pthread_once_t gRuntimeOnce = PTHREAD_ONCE_INIT;
+static OrtEnv* gSharedEnv = NULL;
+static pthread_once_t gSharedEnvOnce = PTHREAD_ONCE_INIT;
+
+static _Thread_local char gLastErrorMessage[512] = "";
+
+#define ONNX_MAX_DIMENSIONS 8
+
+static void onnx_set_error(const char* message) {
+    snprintf(gLastErrorMessage, sizeof(gLastErrorMessage), "%s", message != NULL ? message : "");
+}
+
+static void onnx_initialize_runtime(void) {
+    const OrtApiBase* base = OrtGetApiBase();
+    if (base == NULL) {
+        return;
+    }
+    const OrtApi* api = base->GetApi(ORT_API_VERSION);
+    if (api == NULL) {
+        return;
+    }
+
+    // shared by every tensor that wraps caller memory and every copy
+    OrtStatus* status = api->CreateCpuMemoryInfo(OrtArenaAllocator, OrtMemTypeDefault, &gCPUMemoryInfo);
+    if (status == NULL) {
+        status = api->GetAllocatorWithDefaultOptions(&gDefaultAllocator);
+    }
+    if (status != NULL) {
+        api->ReleaseStatus(status);
+        return;
+    }
+    gOrtApi = api;
+}
+
+/**
+ * The ONNX Runtime API, or NULL with the last error set if the library is too old for the
+ * headers the bridge was built with
+ */
+static const OrtApi* onnx_api(void) {
+    pthread_once(&gRuntimeOnce, onnx_initialize_runtime);
+    if (gOrtApi == NULL) {
+        onnx_set_error("ONNX Runtime API version unavailable; the library is older than its headers");
+    }
+    return gOrtApi;
+}
+
+/**
+ * Turn an OrtStatus into an ONNXStatus, keeping its message as the last error
+ */
+static ONNXStatus onnx_status(const OrtApi* api, OrtStatus* status) {
+    if (status == NULL) {
+        return ONNX_STATUS_OK;
+    }
+
+    onnx_set_error(api->GetErrorMessage(status));
+    OrtErrorCode code = api->GetErrorCode(status);
+    api->ReleaseStatus(status);
+
+    switch (code) {
+        case ORT_INVALID_ARGUMENT:
+            return ONNX_STATUS_INVALID_ARGUMENT;
+        case ORT_NO_SUCHFILE:
+        case ORT_NO_MODEL:
+            return ONNX_STATUS_NO_MODEL;
+        case ORT_RUNTIME_EXCEPTION:
+            return ONNX_STATUS_RUNTIME_EXCEPTION;
+        default:
+            return ONNX_STATUS_ERROR;
+    }
+}
+
+static ONNXStatus onnx_invalid_argument(const char* message) {
+    onnx_set_error(message);
+    return ONNX_STATUS_INVALID_ARGUMENT;
+}
+
+/**
+ * Number of elements of a shape, or 0 for a negative (symbolic) dimension or an overflow
+ */
+static size_t onnx_element_count(const int64_t* shape, size_t shape_count) {
+    size_t count = 1;
+    for (size_t i = 0; i < shape_count; i++) {
+        if (shape[i] < 0) {
+            return 0;
+        }
+        size_t dimension = (size_t)shape[i];
+        if (dimension != 0 && count > SIZE_MAX / dimension) {
+            return 0;
+        }
+        count *= dimension;
+    }
+    return count;
+}
+
+/**
+ * Element count of a float tensor
+ */
+static ONNXStatus onnx_float_tensor_count(const OrtApi* api, const OrtValue* value, size_t* out_count) {
+    OrtTensorTypeAndShapeInfo* info = NULL;
+    ONNXStatus result = onnx_status(api, api->GetTensorTypeAndShape(value, &info));
+    if (result != ONNX_STATUS_OK) {
+        return result;
+    }
+
+    ONNXTensorElementDataType type = ONNX_TENSOR_ELEMENT_DATA_TYPE_UNDEFINED;
+    result = onnx_status(api, api->GetTensorElementType(info, &type));
+    if (result == ONNX_STATUS_OK) {
+        result = onnx_status(api, api->GetTensorShapeElementCount(info, out_count));
+    }
+    api->ReleaseTensorTypeAndShapeInfo(info);
+
+    if (result == ONNX_STATUS_OK && type != ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT) {
+        result = onnx_invalid_argument("Tensor is not float");
+    }
+    return result;
+}
+
+// MARK: - Environment Management
+
+ONNXStatus ONNXCreateEnv(int log_level, const char* env_name, ONNXEnv** out_env) {
+    const OrtApi* api = onnx_api();
+    if (api == NULL) {
+        return ONNX_STATUS_ERROR;
+    }
+    if (out_env == NULL || log_level < ORT_LOGGING_LEVEL_VERBOSE || log_level > ORT_LOGGING_LEVEL_FATAL) {
+        return onnx_invalid_argument("Invalid environment arguments");
+    }
+
+    OrtEnv* env = NULL;
+    ONNXStatus result = onnx_status(api, api->CreateEnv((OrtLoggingLevel)log_level, env_name != NULL ? env_name : "Vocana", &env));
+    *out_env = (ONNXEnv*)env;
+    return result;
+}
+
+void ONNXReleaseEnv(ONNXEnv* env) {
+    if (env != NULL && (OrtEnv*)env != gSharedEnv && onnx_api() != NULL) {
+        gOrtApi->ReleaseEnv((OrtEnv*)env);
+    }
+}
+
+static void onnx_create_shared_env(void) {
+    OrtStatus* status = gOrtApi->CreateEnv(ORT_LOGGING_LEVEL_WARNING, "Vocana", &gSharedEnv);
+    if (status != NULL) {
+        gOrtApi->ReleaseStatus(status);
+        gSharedEnv = NULL;
+    }
+}
+
+ONNXStatus ONNXGetSharedEnv(ONNXEnv** out_env) {
+    const OrtApi* api = onnx_api();
+    if (api == NULL) {
+        return ONNX_STATUS_ERROR;
+    }
+    if (out_env == NULL) {
+        return onnx_invalid_argument("No environment pointer");
+    }
+
+    pthread_once(&gSharedEnvOnce, onnx_create_shared_env);
+    *out_env = (ONNXEnv*)gSharedEnv;
+    if (gSharedEnv == NULL) {
+        onnx_set_error("Could not create the shared ONNX Runtime environment");
+        return ONNX_STATUS_ERROR;
+    }
+    return ONNX_STATUS_OK;
+}
+
+// MARK: - Session Options
+
+ONNXStatus ONNXCreateSessionOptions(ONNXSessionOptions** out_options) {
+    const OrtApi* api = onnx_api();
+    if (api == NULL) {
+        return ONNX_STATUS_ERROR;
+    }
+    if (out_options == NULL) {
+        return onnx_invalid_argument("No options pointer");
+    }
+
+    OrtSessionOptions* options = NULL;
+    ONNXStatus result = onnx_status(api, api->CreateSessionOptions(&options));
+    *out_options = (ONNXSessionOptions*)options;
+    return result;
+}
+
+ONNXStatus ONNXSetIntraOpNumThreads(ONNXSessionOptions* options, int num_threads) {
+    const OrtApi* api = onnx_api();
+    if (api == NULL) {
+        return ONNX_STATUS_ERROR;
+    }
+    if (options == NULL || num_threads < 0) {
+        return onnx_invalid_argument("Invalid thread count");
+    }
+    return onnx_status(api, api->SetIntraOpNumThreads((OrtSessionOptions*)options, num_threads));
+}
+
+static const GraphOptimizationLevel kOptimizationLevels[] = {
+    ORT_DISABLE_ALL, ORT_ENABLE_BASIC, ORT_ENABLE_EXTENDED, ORT_ENABLE_ALL
+};
+
+ONNXStatus ONNXSetGraphOptimizationLevel(ONNXSessionOptions* options, int level) {
+    const OrtApi* api = onnx_api();
+    if (api == NULL) {
+        return ONNX_STATUS_ERROR;
+    }
+    if (options == NULL || level < 0 || level > 3) {
+        return onnx_invalid_argument("Invalid graph optimization level");
+    }
+    return onnx_status(api, api->SetSessionGraphOptimizationLevel((OrtSessionOptions*)options, kOptimizationLevels[level]));
+}
+
+void ONNXReleaseSessionOptions(ONNXSessionOptions* options) {
+    if (options != NULL && onnx_api() != NULL) {
+        gOrtApi->ReleaseSessionOptions((OrtSessionOptions*)options);
+    }
+}
+
+// MARK: - Session Management
+
+ONNXStatus ONNXCreateSession(ONNXEnv* env,
+                              const char* model_path,
+                              ONNXSessionOptions* options,
+                              ONNXSession** out_session) {
+    const OrtApi* api = onnx_api();
+    if (api == NULL) {
+        return ONNX_STATUS_ERROR;
+    }
+    if (env == NULL || model_path == NULL || out_session == NULL) {
+        return onnx_invalid_argument("Invalid session arguments");
+    }
+    *out_session = NULL;
+
+    // default options when the caller has none
+    OrtSessionOptions* session_options = (OrtSessionOptions*)options;
+    OrtSessionOptions* default_options = NULL;
+    if (session_options == NULL) {
+        ONNXStatus result = onnx_status(api, api->CreateSessionOptions(&default_options));
+        if (result != ONNX_STATUS_OK) {
+            return result;
+        }
+        session_options = default_options;
+    }
+
+    OrtSession* session = NULL;
+    ONNXStatus result = onnx_status(api, api->CreateSession((OrtEnv*)env, model_path, session_options, &session));
+    if (default_options != NULL) {
+        api->ReleaseSessionOptions(default_options);
+    }
+    *out_session = (ONNXSession*)session;
+    return result;
+}
+
+ONNXStatus ONNXSessionGetInputCount(ONNXSession* session, size_t* out_count) {
+    const OrtApi* api = onnx_api();
+    if (api == NULL) {
+        return ONNX_STATUS_ERROR;
+    }
+    if (session == NULL || out_count == NULL) {
+        return onnx_invalid_argument("Invalid session or count");
+    }
+    return onnx_status(api, api->SessionGetInputCount((OrtSession*)session, out_count));
+}
+
+ONNXStatus ONNXSessionGetOutputCount(ONNXSession* session, size_t* out_count) {
+    const OrtApi* api = onnx_api();
+    if (api == NULL) {
+        return ONNX_STATUS_ERROR;
+    }
+    if (session == NULL || out_count == NULL) {
+        return onnx_invalid_argument("Invalid session or count");
+    }
+    return onnx_status(api, api->SessionGetOutputCount((OrtSession*)session, out_count));
+}
+
+/**
+ * Copy a name the runtime allocated into the caller's buffer and free it
+ */
+static ONNXStatus onnx_copy_name(const OrtApi* api, char* name, char* out_name, size_t name_len) {
+    ONNXStatus result = ONNX_STATUS_OK;
+    if (strlen(name) >= name_len) {
+        result = onnx_invalid_argument("Name buffer too small");
+    } else {
+        memcpy(out_name, name, strlen(name) + 1);
+    }
+    OrtStatus* status = api->AllocatorFree(gDefaultAllocator, name);
+    if (status != NULL) {
+        api->ReleaseStatus(status);
+    }
+    return result;
+}
+
+ONNXStatus ONNXSessionGetInputName(ONNXSession* session,
+                                    size_t index,
+                                    char* out_name,
+                                    size_t name_len) {
+    const OrtApi* api = onnx_api();
+    if (api == NULL) {
+        return ONNX_STATUS_ERROR;
+    }
+    if (session == NULL || out_name == NULL || name_len == 0) {
+        return onnx_invalid_argument("Invalid session or name buffer");
+    }
+
+    char* name = NULL;
+    ONNXStatus result = onnx_status(api, api->SessionGetInputName((OrtSession*)session, index, gDefaultAllocator, &name));
+    if (result != ONNX_STATUS_OK) {
+        return result;
+    }
+    return onnx_copy_name(api, name, out_name, name_len);
+}
+
+ONNXStatus ONNXSessionGetOutputName(ONNXSession* session,
+                                     size_t index,
+                                     char* out_name,
+                                     size_t name_len) {
+    const OrtApi* api = onnx_api();
+    if (api == NULL) {
+        return ONNX_STATUS_ERROR;
+    }
+    if (session == NULL || out_name == NULL || name_len == 0) {
+        return onnx_invalid_argument("Invalid session or name buffer");
+    }
+
+    char* name = NULL;
+    ONNXStatus result = onnx_status(api, api->SessionGetOutputName((OrtSession*)session, index, gDefaultAllocator, &name));
+    if (result != ONNX_STATUS_OK) {
+        return result;
+    }
+    return onnx_copy_name(api, name, out_name, name_len);
+}
+
+void ONNXReleaseSession(ONNXSession* session) {
+    if (session != NULL && onnx_api() != NULL) {
+        gOrtApi->ReleaseSession((OrtSession*)session);
+    }
+}
+
+// MARK: - Optimized Model Cache
+
+/**
+ * Options for a session with the given threads and optimization level, and optionally the path
+ * the optimized model is written to
+ */
+static ONNXStatus onnx_cache_options(const OrtApi* api, int num_threads, GraphOptimizationLevel level,
+                                     const char* optimized_path, OrtSessionOptions** out_options) {
+    OrtSessionOptions* options = NULL;
+    ONNXStatus result = onnx_status(api, api->CreateSessionOptions(&options));
+    if (result == ONNX_STATUS_OK && num_threads > 0) {
+        result = onnx_status(api, api->SetIntraOpNumThreads(options, num_threads));
+    }
+    if (result == ONNX_STATUS_OK) {
+        result = onnx_status(api, api->SetSessionGraphOptimizationLevel(options, level));
+    }
+    if (result == ONNX_STATUS_OK && optimized_path != NULL) {
+        result = onnx_status(api, api->SetOptimizedModelFilePath(options, optimized_path));
+    }
+    if (result != ONNX_STATUS_OK && options != NULL) {
+        api->ReleaseSessionOptions(options);
+        options = NULL;
+    }
+    *out_options = options;
+    return result;
+}
+
+static ONNXStatus onnx_open_session(const OrtApi* api, OrtEnv* env, const char* model_path, int num_threads,
+                                    GraphOptimizationLevel level, const char* optimized_path, OrtSession** out_session) {
+    OrtSessionOptions* options = NULL;
+    ONNXStatus result = onnx_cache_options(api, num_threads, level, optimized_path, &options);
+    if (result != ONNX_STATUS_OK) {
+        return result;
+    }
+    result = onnx_status(api, api->CreateSession(env, model_path, options, out_session));
+    api->ReleaseSessionOptions(options);
+    return result;
+}
+
+/**
+ * Path of the optimized copy of a model: its name, then a hash of everything that makes a copy
+ * stale, so a stale copy is simply never found again
+ */
+static bool onnx_cache_path(const char* model_path, int optimization_level, const char* cache_directory,
+                            char* out_path, size_t path_len) {
+    struct stat model_info;
+    if (stat(model_path, &model_info) != 0) {
+        return false;
+    }
+    char* absolute_path = realpath(model_path, NULL);
+    if (absolute_path == NULL) {
+        return false;
+    }
+
+    char key[1024];
+    snprintf(key, sizeof(key), "%s|%lld|%lld|%s|%d", absolute_path, (long long)model_info.st_size,
+             (long long)model_info.st_mtime, OrtGetApiBase()->GetVersionString(), optimization_level);
+    free(absolute_path);
+
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const char* c = key; *c != '\0'; c++) {
+        hash = (hash ^ (uint8_t)*c) * 0x100000001b3ULL;
+    }
+
+    const char* name = strrchr(model_path, '/');
+    name = name != NULL ? name + 1 : model_path;
+    size_t name_len = strlen(name);
+    if (name_len > 5 && strcmp(name + name_len - 5, ".onnx") == 0) {
+        name_len -= 5;
+    }
+    int written = snprintf(out_path, path_len, "%s/%.*s.%016llx.onnx", cache_directory, (int)name_len, name,
+                           (unsigned long long)hash);
+    return written > 0 && (size_t)written < path_len;
+}
+
+ONNXStatus ONNXCreateSessionWithCache(ONNXEnv* env,
+                                       const char* model_path,
+                                       int num_threads,
+                                       int optimization_level,
+                                       const char* cache_directory,
+                                       ONNXSession** out_session) {
+    const OrtApi* api = onnx_api();
+    if (api == NULL) {
+        return ONNX_STATUS_ERROR;
+    }
+    if (env == NULL || model_path == NULL || out_session == NULL || num_threads < 0 ||
+        optimization_level < 0 || optimization_level > 3) {
+        return onnx_invalid_argument("Invalid session arguments");
+    }
+    *out_session = NULL;
+
+    GraphOptimizationLevel level = kOptimizationLevels[optimization_level];
+    OrtSession* session = NULL;
+    char cache_path[1024];
+    if (cache_directory == NULL || optimization_level == 0 ||
+        !onnx_cache_path(model_path, optimization_level, cache_directory, cache_path, sizeof(cache_path))) {
+        ONNXStatus result = onnx_open_session(api, (OrtEnv*)env, model_path, num_threads, level, NULL, &session);
+        *out_session = (ONNXSession*)session;
+        return result;
+    }
+
+    // the optimized copy is already optimized, so it loads with the optimizations off
+    if (access(cache_path, R_OK) == 0) {
+        if (onnx_open_session(api, (OrtEnv*)env, cache_path, num_threads, ORT_DISABLE_ALL, NULL, &session) == ONNX_STATUS_OK) {
+            *out_session = (ONNXSession*)session;
+            return ONNX_STATUS_OK;
+        }
+        unlink(cache_path);
+    }
+
+    // written under a name of its own and renamed into place, so another process never loads
+    // half a model
+    char temporary_path[1040];
+    snprintf(temporary_path, sizeof(temporary_path), "%s.%ld.tmp", cache_path, (long)getpid());
+    if (mkdir(cache_directory, 0755) != 0 && errno != EEXIST) {
+        temporary_path[0] = '\0';
+    }
+    ONNXStatus result = ONNX_STATUS_ERROR;
+    if (temporary_path[0] != '\0') {
+        result = onnx_open_session(api, (OrtEnv*)env, model_path, num_threads, level, temporary_path, &session);
+        if (result == ONNX_STATUS_OK && rename(temporary_path, cache_path) != 0) {
+            unlink(temporary_path);
+        }
+    }
+    if (result != ONNX_STATUS_OK) {
+        result = onnx_open_session(api, (OrtEnv*)env, model_path, num_threads, level, NULL, &session);
+    }
+    *out_session = (ONNXSession*)session;
+    return result;
+}
+
+// MARK: - Session Pool
+
+struct ONNXSessionPool {
+    pthread_mutex_t mutex;
+    pthread_cond_t available;
+    size_t model_count;
+    size_t sessions_per_model;
+    OrtSession** sessions;  // model_count rows of sessions_per_model
+    bool* in_use;
+};
+
+/**
+ * Name, element type and shape of a session's input or output, with any symbolic dimension taken
+ * as symbolic_dimension; io_shape_count is the capacity of out_shape on entry
+ */
+static bool onnx_tensor_info(const OrtApi* api, OrtSession* session, bool is_input, size_t index,
+                             int64_t symbolic_dimension, char* out_name, size_t name_len,
+                             ONNXTensorElementDataType* out_type, int64_t* out_shape, size_t* io_shape_count) {
+    ONNXStatus result = is_input ? ONNXSessionGetInputName((ONNXSession*)session, index, out_name, name_len)
+                                 : ONNXSessionGetOutputName((ONNXSession*)session, index, out_name, name_len);
+    if (result != ONNX_STATUS_OK) {
+        return false;
+    }
+
+    OrtTypeInfo* type_info = NULL;
+    const OrtTensorTypeAndShapeInfo* tensor_info = NULL;
+    size_t dimension_count = 0;
+    *out_type = ONNX_TENSOR_ELEMENT_DATA_TYPE_UNDEFINED;
+    OrtStatus* status = is_input ? api->SessionGetInputTypeInfo(session, index, &type_info)
+                                 : api->SessionGetOutputTypeInfo(session, index, &type_info);
+    if (status == NULL) {
+        status = api->CastTypeInfoToTensorInfo(type_info, &tensor_info);
+    }
+    if (status == NULL && tensor_info != NULL) {
+        status = api->GetTensorElementType(tensor_info, out_type);
+    }
+    if (status == NULL && tensor_info != NULL) {
+        status = api->GetDimensionsCount(tensor_info, &dimension_count);
+    }
+    bool valid = status == NULL && tensor_info != NULL && dimension_count <= *io_shape_count;
+    if (valid) {
+        status = api->GetDimensions(tensor_info, out_shape, dimension_count);
+        valid = status == NULL;
+    }
+    if (status != NULL) {
+        onnx_status(api, status);
+    }
+    if (type_info != NULL) {
+        api->ReleaseTypeInfo(type_info);
+    }
+    if (!valid) {
+        return false;
+    }
+
+    for (size_t d = 0; d < dimension_count; d++) {
+        if (out_shape[d] < 0) {
+            out_shape[d] = symbolic_dimension;
+        }
+    }
+    *io_shape_count = dimension_count;
+    return true;
+}
+
+/**
+ * Run a session once on zero inputs, with any symbolic dimension taken as 1, so the runtime makes
+ * its first-run allocations now. Models with inputs that aren't float are left cold.
+ */
+static void onnx_warm_up(const OrtApi* api, OrtSession* session) {
+    enum { kMaxInputs = 16, kMaxName = 128 };
+
+    size_t input_count = 0;
+    size_t output_count = 0;
+    OrtStatus* status = api->SessionGetInputCount(session, &input_count);
+    if (status == NULL) {
+        status = api->SessionGetOutputCount(session, &output_count);
+    }
+    if (status != NULL) {
+        api->ReleaseStatus(status);
+        return;
+    }
+    if (input_count > kMaxInputs || output_count > kMaxInputs) {
+        return;
+    }
+
+    char input_names[kMaxInputs][kMaxName];
+    char output_names[kMaxInputs][kMaxName];
+    const char* input_name_list[kMaxInputs];
+    const char* output_name_list[kMaxInputs];
+    OrtValue* inputs[kMaxInputs] = { NULL };
+    OrtValue* outputs[kMaxInputs] = { NULL };
+    bool ready = true;
+
+    for (size_t i = 0; i < output_count && ready; i++) {
+        ready = ONNXSessionGetOutputName((ONNXSession*)session, i, output_names[i], kMaxName) == ONNX_STATUS_OK;
+        output_name_list[i] = output_names[i];
+    }
+    for (size_t i = 0; i < input_count && ready; i++) {
+        ONNXTensorElementDataType type;
+        int64_t shape[ONNX_MAX_DIMENSIONS];
+        size_t dimension_count = ONNX_MAX_DIMENSIONS;
+        ready = onnx_tensor_info(api, session, true, i, 1, input_names[i], kMaxName, &type, shape, &dimension_count) &&
+                type == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT;
+        input_name_list[i] = input_names[i];
+        if (!ready) {
+            break;
+        }
+
+        size_t count = onnx_element_count(shape, dimension_count);
+        status = api->CreateTensorAsOrtValue(gDefaultAllocator, shape, dimension_count, ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT, &inputs[i]);
+        float* data = NULL;
+        if (status == NULL) {
+            status = api->GetTensorMutableData(inputs[i], (void**)&data);
+        }
+        if (status != NULL) {
+            api->ReleaseStatus(status);
+            ready = false;
+        } else if (count > 0) {
+            memset(data, 0, count * sizeof(float));
+        }
+    }
+
+    if (ready) {
+        status = api->Run(session, NULL, input_name_list, (const OrtValue* const*)inputs, input_count,
+                          output_name_list, output_count, outputs);
+        if (status != NULL) {
+            api->ReleaseStatus(status);
+        }
+    }
+    for (size_t i = 0; i < kMaxInputs; i++) {
+        if (inputs[i] != NULL) {
+            api->ReleaseValue(inputs[i]);
+        }
+        if (outputs[i] != NULL) {
+            api->ReleaseValue(outputs[i]);
+        }
+    }
+}
+
+ONNXStatus ONNXCreateSessionPool(const char* const* model_paths,
+                                  size_t model_count,
+                                  size_t sessions_per_model,
+                                  int num_threads,
+                                  const char* cache_directory,
+                                  ONNXSessionPool** out_pool) {
+    const OrtApi* api = onnx_api();
+    if (api == NULL) {
+        return ONNX_STATUS_ERROR;
+    }
+    if (model_paths == NULL || model_count == 0 || sessions_per_model == 0 || out_pool == NULL) {
+        return onnx_invalid_argument("Invalid session pool arguments");
+    }
+    *out_pool = NULL;
+
+    ONNXEnv* env = NULL;
+    ONNXStatus result = ONNXGetSharedEnv(&env);
+    if (result != ONNX_STATUS_OK) {
+        return result;
+    }
+
+    size_t session_count = model_count * sessions_per_model;
+    ONNXSessionPool* pool = calloc(1, sizeof(ONNXSessionPool));
+    if (pool != NULL) {
+        pool->sessions = calloc(session_count, sizeof(OrtSession*));
+        pool->in_use = calloc(session_count, sizeof(bool));
+    }
+    if (pool == NULL || pool->sessions == NULL || pool->in_use == NULL) {
+        if (pool != NULL) {
+            free(pool->sessions);
+            free(pool->in_use);
+            free(pool);
+        }
+        onnx_set_error("Out of memory");
+        return ONNX_STATUS_ERROR;
+    }
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->available, NULL);
+    pool->model_count = model_count;
+    pool->sessions_per_model = sessions_per_model;
+
+    // the first session of each model writes the optimized copy the others load
+    for (size_t i = 0; i < session_count && result == ONNX_STATUS_OK; i++) {
+        ONNXSession* session = NULL;
+        result = ONNXCreateSessionWithCache(env, model_paths[i / sessions_per_model], num_threads, 3,
+                                            cache_directory, &session);
+        pool->sessions[i] = (OrtSession*)session;
+        if (result == ONNX_STATUS_OK) {
+            onnx_warm_up(api, pool->sessions[i]);
+        }
+    }
+    if (result != ONNX_STATUS_OK) {
+        ONNXReleaseSessionPool(pool);
+        return result;
+    }
+    *out_pool = pool;
+    return ONNX_STATUS_OK;
+}
+
+ONNXStatus ONNXSessionPoolAcquire(ONNXSessionPool* pool,
+                                   size_t model_index,
+                                   ONNXSession** out_session) {
+    if (pool == NULL || model_index >= pool->model_count || out_session == NULL) {
+        return onnx_invalid_argument("Invalid pool, model index or session pointer");
+    }
+
+    size_t first = model_index * pool->sessions_per_model;
+    pthread_mutex_lock(&pool->mutex);
+    for (;;) {
+        for (size_t i = first; i < first + pool->sessions_per_model; i++) {
+            if (!pool->in_use[i]) {
+                pool->in_use[i] = true;
+                pthread_mutex_unlock(&pool->mutex);
+                *out_session = (ONNXSession*)pool->sessions[i];
+                return ONNX_STATUS_OK;
+            }
+        }
+        pthread_cond_wait(&pool->available, &pool->mutex);
+    }
+}
+
+void ONNXSessionPoolRelease(ONNXSessionPool* pool, ONNXSession* session) {
+    if (pool == NULL || session == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    for (size_t i = 0; i < pool->model_count * pool->sessions_per_model; i++) {
+        if (pool->sessions[i] == (OrtSession*)session) {
+            pool->in_use[i] = false;
+            break;
+        }
+    }
+    pthread_cond_broadcast(&pool->available);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+void ONNXReleaseSessionPool(ONNXSessionPool* pool) {
+    if (pool == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < pool->model_count * pool->sessions_per_model; i++) {
+        ONNXReleaseSession((ONNXSession*)pool->sessions[i]);
+    }
+    pthread_cond_destroy(&pool->available);
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool->sessions);
+    free(pool->in_use);
+    free(pool);
+}
+
+// MARK: - Tensor/Value Management
+
+ONNXStatus ONNXCreateTensorFloat(const float* data,
+                                  size_t data_count,
+                                  const int64_t* shape,
+                                  size_t shape_count,
+                                  ONNXValue** out_value) {
+    const OrtApi* api = onnx_api();
+    if (api == NULL) {
+        return ONNX_STATUS_ERROR;
+    }
+    if (data == NULL || shape == NULL || out_value == NULL || onnx_element_count(shape, shape_count) != data_count) {
+        return onnx_invalid_argument("Tensor data does not match its shape");
+    }
+    *out_value = NULL;
+
+    OrtValue* value = NULL;
+    ONNXStatus result = onnx_status(api, api->CreateTensorAsOrtValue(gDefaultAllocator, shape, shape_count, ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT, &value));
+    if (result != ONNX_STATUS_OK) {
+        return result;
+    }
+
+    float* tensor_data = NULL;
+    result = onnx_status(api, api->GetTensorMutableData(value, (void**)&tensor_data));
+    if (result != ONNX_STATUS_OK) {
+        api->ReleaseValue(value);
+        return result;
+    }
+    memcpy(tensor_data, data, data_count * sizeof(float));
+    *out_value = (ONNXValue*)value;
+    return ONNX_STATUS_OK;
+}
+
+ONNXStatus ONNXGetTensorFloatData(ONNXValue* value,
+                                   float* out_data,
+                                   size_t data_count) {
+    float* tensor_data = NULL;
+    size_t count = 0;
+    ONNXStatus result = ONNXGetTensorFloatDataPointer(value, &tensor_data, &count);
+    if (result != ONNX_STATUS_OK) {
+        return result;
+    }
+    if (out_data == NULL || data_count < count) {
+        return onnx_invalid_argument("Output buffer smaller than the tensor");
+    }
+    memcpy(out_data, tensor_data, count * sizeof(float));
+    return ONNX_STATUS_OK;
+}
+
+ONNXStatus ONNXGetTensorShape(ONNXValue* value,
+                               int64_t* out_shape,
+                               size_t* out_shape_count) {
+    const OrtApi* api = onnx_api();
+    if (api == NULL) {
+        return ONNX_STATUS_ERROR;
+    }
+    if (value == NULL || out_shape == NULL || out_shape_count == NULL) {
+        return onnx_invalid_argument("Invalid value or shape buffer");
+    }
+
+    OrtTensorTypeAndShapeInfo* info = NULL;
+    ONNXStatus result = onnx_status(api, api->GetTensorTypeAndShape((const OrtValue*)value, &info));
+    if (result != ONNX_STATUS_OK) {
+        return result;
+    }
+
+    size_t dimensions = 0;
+    result = onnx_status(api, api->GetDimensionsCount(info, &dimensions));
+    if (result == ONNX_STATUS_OK && dimensions > *out_shape_count) {
+        result = onnx_invalid_argument("Shape buffer too small");
+    }
+    if (result == ONNX_STATUS_OK) {
+        result = onnx_status(api, api->GetDimensions(info, out_shape, dimensions));
+    }
+    if (result == ONNX_STATUS_OK) {
+        *out_shape_count = dimensions;
+    }
+    api->ReleaseTensorTypeAndShapeInfo(info);
+    return result;
+}
+
+void ONNXReleaseValue(ONNXValue* value) {
+    if (value != NULL && onnx_api() != NULL) {
+        gOrtApi->ReleaseValue((OrtValue*)value);
+    }
+}
+
+// MARK: - Caller-Owned Tensors
+
+ONNXStatus ONNXCreateTensorFloatWithData(float* data,
+                                          size_t data_count,
+                                          const int64_t* shape,
+                                          size_t shape_count,
+                                          ONNXValue** out_value) {
+    const OrtApi* api = onnx_api();
+    if (api == NULL) {
+        return ONNX_STATUS_ERROR;
+    }
+    if (data == NULL || shape == NULL || out_value == NULL || onnx_element_count(shape, shape_count) != data_count) {
+        return onnx_invalid_argument("Tensor data does not match its shape");
+    }
+
+    OrtValue* value = NULL;
+    ONNXStatus result = onnx_status(api, api->CreateTensorWithDataAsOrtValue(gCPUMemoryInfo, data, data_count * sizeof(float), shape, shape_count, ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT, &value));
+    *out_value = (ONNXValue*)value;
+    return result;
+}
+
+ONNXStatus ONNXGetTensorFloatDataPointer(ONNXValue* value,
+                                          float** out_data,
+                                          size_t* out_count) {
+    const OrtApi* api = onnx_api();
+    if (api == NULL) {
+        return ONNX_STATUS_ERROR;
+    }
+    if (value == NULL || out_data == NULL || out_count == NULL) {
+        return onnx_invalid_argument("Invalid value or data pointer");
+    }
+
+    ONNXStatus result = onnx_float_tensor_count(api, (const OrtValue*)value, out_count);
+    if (result != ONNX_STATUS_OK) {
+        return result;
+    }
+    return onnx_status(api, api->GetTensorMutableData((OrtValue*)value, (void**)out_data));
+}
+
+// MARK: - IO Binding
+
+ONNXStatus ONNXCreateIOBinding(ONNXSession* session, ONNXIOBinding** out_binding) {
+    const OrtApi* api = onnx_api();
+    if (api == NULL) {
+        return ONNX_STATUS_ERROR;
+    }
+    if (session == NULL || out_binding == NULL) {
+        return onnx_invalid_argument("Invalid session or binding pointer");
+    }
+
+    OrtIoBinding* binding = NULL;
+    ONNXStatus result = onnx_status(api, api->CreateIoBinding((OrtSession*)session, &binding));
+    *out_binding = (ONNXIOBinding*)binding;
+    return result;
+}
+
+ONNXStatus ONNXIOBindingBindInput(ONNXIOBinding* binding,
+                                   const char* name,
+                                   const ONNXValue* value) {
+    const OrtApi* api = onnx_api();
+    if (api == NULL) {
+        return ONNX_STATUS_ERROR;
+    }
+    if (binding == NULL || name == NULL || value == NULL) {
+        return onnx_invalid_argument("Invalid binding, name or value");
+    }
+    return onnx_status(api, api->BindInput((OrtIoBinding*)binding, name, (const OrtValue*)value));
+}
+
+ONNXStatus ONNXIOBindingBindOutput(ONNXIOBinding* binding,
+                                    const char* name,
+                                    const ONNXValue* value) {
+    const OrtApi* api = onnx_api();
+    if (api == NULL) {
+        return ONNX_STATUS_ERROR;
+    }
+    if (binding == NULL || name == NULL || value == NULL) {
+        return onnx_invalid_argument("Invalid binding, name or value");
+    }
+    return onnx_status(api, api->BindOutput((OrtIoBinding*)binding, name, (const OrtValue*)value));
+}
+
+void ONNXIOBindingClear(ONNXIOBinding* binding) {
+    if (binding != NULL && onnx_api() != NULL) {
+        gOrtApi->ClearBoundInputs((OrtIoBinding*)binding);
+        gOrtApi->ClearBoundOutputs((OrtIoBinding*)binding);
+    }
+}
+
+void ONNXReleaseIOBinding(ONNXIOBinding* binding) {
+    if (binding != NULL && onnx_api() != NULL) {
+        gOrtApi->ReleaseIoBinding((OrtIoBinding*)binding);
+    }
+}
+
+// MARK: - Inference
+
+ONNXStatus ONNXSessionRun(ONNXSession* session,
+                          const char* const* input_names,
+                          const ONNXValue* const* inputs,
+                          size_t input_count,
+                          const char* const* output_names,
+                          size_t output_count,
+                          ONNXValue** out_outputs) {
+    const OrtApi* api = onnx_api();
+    if (api == NULL) {
+        return ONNX_STATUS_ERROR;
+    }
+    if (session == NULL || input_names == NULL || inputs == NULL || output_names == NULL || out_outputs == NULL) {
+        return onnx_invalid_argument("Invalid run arguments");
+    }
+    return onnx_status(api, api->Run((OrtSession*)session, NULL,
+                                     input_names, (const OrtValue* const*)inputs, input_count,
+                                     output_names, output_count, (OrtValue**)out_outputs));
+}
+
+ONNXStatus ONNXSessionRunWithBinding(ONNXSession* session, ONNXIOBinding* binding) {
+    const OrtApi* api = onnx_api();
+    if (api == NULL) {
+        return ONNX_STATUS_ERROR;
+    }
+    if (session == NULL || binding == NULL) {
+        return onnx_invalid_argument("Invalid session or binding");
+    }
+    return onnx_status(api, api->RunWithBinding((OrtSession*)session, NULL, (const OrtIoBinding*)binding));
+}
+
+// MARK: - Pipeline
+
+typedef struct ONNXPipelineStage {
+    OrtSession* session;
+    OrtIoBinding* binding;
+    ONNXStatus status;  // of the last run
+    char error[512];
+} ONNXPipelineStage;
+
+struct ONNXPipeline {
+    size_t stage_count;
+    ONNXPipelineStage* stages;
+    size_t intermediate_count;
+    OrtValue** intermediates;
+    float** intermediate_data;
+
+    // with more than one processor every decoder but the last runs on a worker of its own, the last
+    // on the caller's thread; with one there are no workers and the caller runs them all in turn
+    size_t worker_count;
+    pthread_t* workers;
+    pthread_mutex_t mutex;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    uint64_t generation;
+    size_t pending;
+    bool stopping;
+};
+
+typedef struct ONNXPipelineWorker {
+    ONNXPipeline* pipeline;
+    size_t stage;
+} ONNXPipelineWorker;
+
+static void onnx_run_stage(ONNXPipelineStage* stage) {
+    stage->status = ONNXSessionRunWithBinding((ONNXSession*)stage->session, (ONNXIOBinding*)stage->binding);
+    if (stage->status != ONNX_STATUS_OK) {
+        snprintf(stage->error, sizeof(stage->error), "%s", gLastErrorMessage);
+    }
+}
+
+/**
+ * The number of workers a pipeline of the given decoders starts: none where there's a single
+ * processor, since a worker there only adds a thread switch to each decoder
+ */
+static size_t onnx_pipeline_worker_count(size_t decoder_count) {
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    return processors > 1 ? decoder_count - 1 : 0;
+}
+
+static void* onnx_pipeline_worker(void* context) {
+    ONNXPipelineWorker worker = *(ONNXPipelineWorker*)context;
+    free(context);
+    ONNXPipeline* pipeline = worker.pipeline;
+
+    // no run can start before the pipeline is created, so every worker starts from generation 0
+    uint64_t generation = 0;
+    pthread_mutex_lock(&pipeline->mutex);
+    for (;;) {
+        while (pipeline->generation == generation && !pipeline->stopping) {
+            pthread_cond_wait(&pipeline->start, &pipeline->mutex);
+        }
+        if (pipeline->stopping) {
+            break;
+        }
+        generation = pipeline->generation;
+        pthread_mutex_unlock(&pipeline->mutex);
+
+        onnx_run_stage(&pipeline->stages[worker.stage]);
+
+        pthread_mutex_lock(&pipeline->mutex);
+        if (--pipeline->pending == 0) {
+            pthread_cond_signal(&pipeline->done);
+        }
+    }
+    pthread_mutex_unlock(&pipeline->mutex);
+    return NULL;
+}
+
+/**
+ * Give an encoder output that decoders take as an input a buffer of its own, bound as the output
+ * of the encoder and the input of every decoder that takes it
+ */
+static ONNXStatus onnx_pipeline_connect(const OrtApi* api, ONNXPipeline* pipeline, size_t output_index, int64_t symbolic_dimension) {
+    char name[128];
+    ONNXTensorElementDataType type;
+    int64_t shape[ONNX_MAX_DIMENSIONS];
+    size_t dimension_count = ONNX_MAX_DIMENSIONS;
+    if (!onnx_tensor_info(api, pipeline->stages[0].session, false, output_index, symbolic_dimension,
+                          name, sizeof(name), &type, shape, &dimension_count)) {
+        return ONNX_STATUS_ERROR;
+    }
+
+    OrtValue* value = NULL;
+    for (size_t s = 1; s < pipeline->stage_count; s++) {
+        size_t input_count = 0;
+        ONNXStatus result = ONNXSessionGetInputCount((ONNXSession*)pipeline->stages[s].session, &input_count);
+        for (size_t i = 0; i < input_count && result == ONNX_STATUS_OK; i++) {
+            char input_name[128];
+            result = ONNXSessionGetInputName((ONNXSession*)pipeline->stages[s].session, i, input_name, sizeof(input_name));
+            if (result != ONNX_STATUS_OK || strcmp(input_name, name) != 0) {
+                continue;
+            }
+
+            // the first decoder to take it makes the buffer
+            if (value == NULL) {
+                size_t count = onnx_element_count(shape, dimension_count);
+                if (type != ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT || count == 0) {
+                    onnx_set_error("Pipeline tensors must be float with a known shape");
+                    return ONNX_STATUS_INVALID_ARGUMENT;
+                }
+                float** data = &pipeline->intermediate_data[pipeline->intermediate_count];
+                if (posix_memalign((void**)data, 64, count * sizeof(float)) != 0) {
+                    *data = NULL;
+                    onnx_set_error("Out of memory");
+                    return ONNX_STATUS_ERROR;
+                }
+                memset(*data, 0, count * sizeof(float));
+                result = ONNXCreateTensorFloatWithData(*data, count, shape, dimension_count, (ONNXValue**)&value);
+                if (result != ONNX_STATUS_OK) {
+                    free(*data);
+                    *data = NULL;
+                    return result;
+                }
+                pipeline->intermediates[pipeline->intermediate_count++] = value;
+                result = onnx_status(api, api->BindOutput(pipeline->stages[0].binding, name, value));
+            }
+            if (result == ONNX_STATUS_OK) {
+                result = onnx_status(api, api->BindInput(pipeline->stages[s].binding, name, value));
+            }
+        }
+        if (result != ONNX_STATUS_OK) {
+            return result;
+        }
+    }
+    return ONNX_STATUS_OK;
+}
+
+ONNXStatus ONNXCreatePipeline(ONNXSession* encoder,
+                               ONNXSession* const* decoders,
+                               size_t decoder_count,
+                               int64_t symbolic_dimension,
+                               ONNXPipeline** out_pipeline) {
+    const OrtApi* api = onnx_api();
+    if (api == NULL) {
+        return ONNX_STATUS_ERROR;
+    }
+    if (encoder == NULL || decoders == NULL || decoder_count == 0 || symbolic_dimension <= 0 || out_pipeline == NULL) {
+        return onnx_invalid_argument("Invalid pipeline arguments");
+    }
+    *out_pipeline = NULL;
+
+    size_t output_count = 0;
+    ONNXStatus result = ONNXSessionGetOutputCount(encoder, &output_count);
+    if (result != ONNX_STATUS_OK) {
+        return result;
+    }
+
+    ONNXPipeline* pipeline = calloc(1, sizeof(ONNXPipeline));
+    if (pipeline == NULL) {
+        onnx_set_error("Out of memory");
+        return ONNX_STATUS_ERROR;
+    }
+    pthread_mutex_init(&pipeline->mutex, NULL);
+    pthread_cond_init(&pipeline->start, NULL);
+    pthread_cond_init(&pipeline->done, NULL);
+    pipeline->stage_count = decoder_count + 1;
+    pipeline->stages = calloc(pipeline->stage_count, sizeof(ONNXPipelineStage));
+    pipeline->intermediates = calloc(output_count + 1, sizeof(OrtValue*));
+    pipeline->intermediate_data = calloc(output_count + 1, sizeof(float*));
+    pipeline->workers = calloc(decoder_count, sizeof(pthread_t));
+    if (pipeline->stages == NULL || pipeline->intermediates == NULL || pipeline->intermediate_data == NULL ||
+        pipeline->workers == NULL) {
+        ONNXReleasePipeline(pipeline);
+        onnx_set_error("Out of memory");
+        return ONNX_STATUS_ERROR;
+    }
+
+    for (size_t s = 0; s < pipeline->stage_count && result == ONNX_STATUS_OK; s++) {
+        pipeline->stages[s].session = (OrtSession*)(s == 0 ? encoder : decoders[s - 1]);
+        if (pipeline->stages[s].session == NULL) {
+            result = onnx_invalid_argument("Invalid pipeline arguments");
+        } else {
+            result = onnx_status(api, api->CreateIoBinding(pipeline->stages[s].session, &pipeline->stages[s].binding));
+        }
+    }
+    for (size_t o = 0; o < output_count && result == ONNX_STATUS_OK; o++) {
+        result = onnx_pipeline_connect(api, pipeline, o, symbolic_dimension);
+    }
+    size_t worker_count = onnx_pipeline_worker_count(decoder_count);
+    for (size_t s = 1; s <= worker_count && result == ONNX_STATUS_OK; s++) {
+        ONNXPipelineWorker* worker = malloc(sizeof(ONNXPipelineWorker));
+        if (worker == NULL) {
+            onnx_set_error("Out of memory");
+            result = ONNX_STATUS_ERROR;
+            break;
+        }
+        worker->pipeline = pipeline;
+        worker->stage = s;
+        if (pthread_create(&pipeline->workers[pipeline->worker_count], NULL, onnx_pipeline_worker, worker) != 0) {
+            free(worker);
+            onnx_set_error("Could not start a pipeline thread");
+            result = ONNX_STATUS_ERROR;
+            break;
+        }
+        pipeline->worker_count++;
+    }
+
+    if (result != ONNX_STATUS_OK) {
+        ONNXReleasePipeline(pipeline);
+        return result;
+    }
+    *out_pipeline = pipeline;
+    return ONNX_STATUS_OK;
+}
+
+ONNXStatus ONNXPipelineBindInput(ONNXPipeline* pipeline,
+                                  size_t stage,
+                                  const char* name,
+                                  const ONNXValue* value) {
+    if (pipeline == NULL || stage >= pipeline->stage_count) {
+        return onnx_invalid_argument("Invalid pipeline or stage");
+    }
+    return ONNXIOBindingBindInput((ONNXIOBinding*)pipeline->stages[stage].binding, name, value);
+}
+
+ONNXStatus ONNXPipelineBindOutput(ONNXPipeline* pipeline,
+                                   size_t stage,
+                                   const char* name,
+                                   const ONNXValue* value) {
+    if (pipeline == NULL || stage >= pipeline->stage_count) {
+        return onnx_invalid_argument("Invalid pipeline or stage");
+    }
+    return ONNXIOBindingBindOutput((ONNXIOBinding*)pipeline->stages[stage].binding, name, value);
+}
+
+ONNXStatus ONNXPipelineRun(ONNXPipeline* pipeline) {
+    if (pipeline == NULL) {
+        return onnx_invalid_argument("Invalid pipeline");
+    }
+
+    ONNXPipelineStage* stages = pipeline->stages;
+    onnx_run_stage(&stages[0]);
+    if (stages[0].status != ONNX_STATUS_OK) {
+        return stages[0].status;
+    }
+
+    if (pipeline->worker_count > 0) {
+        pthread_mutex_lock(&pipeline->mutex);
+        pipeline->pending = pipeline->worker_count;
+        pipeline->generation++;
+        pthread_cond_broadcast(&pipeline->start);
+        pthread_mutex_unlock(&pipeline->mutex);
+    }
+
+    // the decoders no worker runs, in turn
+    for (size_t s = pipeline->worker_count + 1; s < pipeline->stage_count; s++) {
+        onnx_run_stage(&stages[s]);
+    }
+
+    if (pipeline->worker_count > 0) {
+        pthread_mutex_lock(&pipeline->mutex);
+        while (pipeline->pending > 0) {
+            pthread_cond_wait(&pipeline->done, &pipeline->mutex);
+        }
+        pthread_mutex_unlock(&pipeline->mutex);
+    }
+
+    for (size_t s = 1; s < pipeline->stage_count; s++) {
+        if (stages[s].status != ONNX_STATUS_OK) {
+            onnx_set_error(stages[s].error);
+            return stages[s].status;
+        }
+    }
+    return ONNX_STATUS_OK;
+}
+
+void ONNXReleasePipeline(ONNXPipeline* pipeline) {
+    if (pipeline == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&pipeline->mutex);
+    pipeline->stopping = true;
+    pthread_cond_broadcast(&pipeline->start);
+    pthread_mutex_unlock(&pipeline->mutex);
+    for (size_t w = 0; w < pipeline->worker_count; w++) {
+        pthread_join(pipeline->workers[w], NULL);
+    }
+
+    for (size_t s = 0; pipeline->stages != NULL && s < pipeline->stage_count; s++) {
+        ONNXReleaseIOBinding((ONNXIOBinding*)pipeline->stages[s].binding);
+    }
+    for (size_t i = 0; i < pipeline->intermediate_count; i++) {
+        ONNXReleaseValue((ONNXValue*)pipeline->intermediates[i]);
+        free(pipeline->intermediate_data[i]);
+    }
+    pthread_cond_destroy(&pipeline->done);
+    pthread_cond_destroy(&pipeline->start);
+    pthread_mutex_destroy(&pipeline->mutex);
+    free(pipeline->stages);
+    free(pipeline->intermediates);
+    free(pipeline->intermediate_data);
+    free(pipeline->workers);
+    free(pipeline);
+}
+
+// MARK: - Error Handling
+
+const char* ONNXGetLastErrorMessage(void) {
+    return gLastErrorMessage;
+}
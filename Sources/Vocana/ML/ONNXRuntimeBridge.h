@@ -40,6 +40,9 @@ typedef struct ONNXEnv ONNXEnv;
 typedef struct ONNXSession ONNXSession;
 typedef struct ONNXValue ONNXValue;
 typedef struct ONNXSessionOptions ONNXSessionOptions;
+typedef struct ONNXIOBinding ONNXIOBinding;
+typedef struct ONNXSessionPool ONNXSessionPool;
+typedef struct ONNXPipeline ONNXPipeline;
 
 // MARK: - Environment Management
 
@@ -53,10 +56,19 @@ typedef struct ONNXSessionOptions ONNXSessionOptions;
 ONNXStatus ONNXCreateEnv(int log_level, const char* env_name, ONNXEnv** out_env);
 
 /**
- * Release environment
+ * Release environment; the shared environment is never released
  */
 void ONNXReleaseEnv(ONNXEnv* env);
 
+/**
+ * Get the process-wide environment, created on first use with warning-level logging
+ * ONNX Runtime expects one environment per process, and its thread pools and allocators are
+ * shared by every session created in it. The environment lives until the process exits.
+ * @param out_env Output environment pointer, the same on every call
+ * @return Status code
+ */
+ONNXStatus ONNXGetSharedEnv(ONNXEnv** out_env);
+
 // MARK: - Session Options
 
 /**
@@ -94,6 +106,31 @@ ONNXStatus ONNXCreateSession(ONNXEnv* env,
                               ONNXSessionOptions* options,
                               ONNXSession** out_session);
 
+/**
+ * Create an inference session, optimizing the model once and loading the optimized copy after that
+ * The first session for a model runs the graph optimizations and serializes the optimized graph
+ * into cache_directory. Later sessions, in this process or the next, load that copy with the
+ * optimizations turned off, which skips most of the cost of creating a session. The copy is
+ * named for the model's path, size and modification time, the runtime version and the level, so
+ * a changed model or runtime is optimized afresh. At level 3 the copy may hold optimizations for
+ * this machine's CPU, so the cache belongs on the machine, not in the app bundle. Without a cache
+ * directory, or if the copy can't be written, this is ONNXCreateSession with the given threads
+ * and level.
+ * @param env Environment
+ * @param model_path Path to .onnx model file
+ * @param num_threads Number of intra-op threads, 0 for the runtime's default
+ * @param optimization_level Graph optimization level (0 = none, 1 = basic, 2 = extended, 3 = all)
+ * @param cache_directory Directory for optimized models, created if missing, or NULL
+ * @param out_session Output session pointer
+ * @return Status code
+ */
+ONNXStatus ONNXCreateSessionWithCache(ONNXEnv* env,
+                                       const char* model_path,
+                                       int num_threads,
+                                       int optimization_level,
+                                       const char* cache_directory,
+                                       ONNXSession** out_session);
+
 /**
  * Get number of inputs
  */
@@ -125,6 +162,51 @@ ONNXStatus ONNXSessionGetOutputName(ONNXSession* session,
  */
 void ONNXReleaseSession(ONNXSession* session);
 
+// MARK: - Session Pool
+
+/*
+ * A session pool opens a set of models, such as enc.onnx, erb_dec.onnx and df_dec.onnx, in the
+ * shared environment, a number of sessions each, all created with ONNXCreateSessionWithCache and
+ * run once on zero inputs before the pool is returned, so the first real frame pays for neither
+ * loading, optimizing nor the runtime's first-run allocations. A session acquired from the pool
+ * belongs to the caller until it is released back; the pool itself may be used from any thread.
+ */
+
+/**
+ * Create a session pool
+ * @param model_paths Paths to .onnx model files; a model's index in this array is its index in
+ *                    the pool
+ * @param model_count Number of models
+ * @param sessions_per_model Number of sessions to open for each model
+ * @param num_threads Number of intra-op threads per session, 0 for the runtime's default
+ * @param cache_directory Directory for optimized models, or NULL (see ONNXCreateSessionWithCache)
+ * @param out_pool Output pool pointer
+ * @return Status code
+ */
+ONNXStatus ONNXCreateSessionPool(const char* const* model_paths,
+                                  size_t model_count,
+                                  size_t sessions_per_model,
+                                  int num_threads,
+                                  const char* cache_directory,
+                                  ONNXSessionPool** out_pool);
+
+/**
+ * Take a session of a model out of the pool, waiting for one if they are all in use
+ */
+ONNXStatus ONNXSessionPoolAcquire(ONNXSessionPool* pool,
+                                   size_t model_index,
+                                   ONNXSession** out_session);
+
+/**
+ * Give a session acquired from the pool back to it
+ */
+void ONNXSessionPoolRelease(ONNXSessionPool* pool, ONNXSession* session);
+
+/**
+ * Release a session pool and its sessions, which must all have been given back
+ */
+void ONNXReleaseSessionPool(ONNXSessionPool* pool);
+
 // MARK: - Tensor/Value Management
 
 /**
@@ -151,6 +233,7 @@ ONNXStatus ONNXGetTensorFloatData(ONNXValue* value,
 
 /**
  * Get tensor shape
+ * @param out_shape_count On entry, the capacity of out_shape; on return, the number of dimensions
  */
 ONNXStatus ONNXGetTensorShape(ONNXValue* value,
                                int64_t* out_shape,
@@ -161,6 +244,80 @@ ONNXStatus ONNXGetTensorShape(ONNXValue* value,
  */
 void ONNXReleaseValue(ONNXValue* value);
 
+// MARK: - Caller-Owned Tensors
+
+/*
+ * The values above copy: ONNXCreateTensorFloat copies the caller's data into memory the runtime
+ * allocates, and ONNXGetTensorFloatData copies results back out. At 100 frames a second across
+ * the three DeepFilterNet models that is an allocation and a copy per tensor per frame. The
+ * functions below instead wrap memory the caller owns, so a tensor is set up once and the caller
+ * just rewrites its buffer before each run.
+ */
+
+/**
+ * Wrap a caller-owned float buffer as a tensor, without copying it
+ * The buffer must stay valid and in place until the value is released; the runtime reads inputs
+ * from it and writes outputs into it directly. Releasing the value does not free the buffer.
+ * @param data Float buffer of data_count elements, ideally 64-byte aligned
+ * @param data_count Number of elements, which must match the shape
+ * @param shape Tensor shape
+ * @param shape_count Number of dimensions
+ * @param out_value Output value pointer
+ * @return Status code
+ */
+ONNXStatus ONNXCreateTensorFloatWithData(float* data,
+                                          size_t data_count,
+                                          const int64_t* shape,
+                                          size_t shape_count,
+                                          ONNXValue** out_value);
+
+/**
+ * Get a tensor's float data in place, without copying
+ * @param out_data Pointer to the tensor's elements, valid as long as the value
+ * @param out_count Number of elements
+ */
+ONNXStatus ONNXGetTensorFloatDataPointer(ONNXValue* value,
+                                          float** out_data,
+                                          size_t* out_count);
+
+// MARK: - IO Binding
+
+/*
+ * An IO binding fixes a session's inputs and outputs once, so a run passes no names or values
+ * and allocates no output values: outputs bound to values from ONNXCreateTensorFloatWithData are
+ * written straight into the caller's buffers on every run. Rebinding is only needed when a
+ * buffer moves or a shape changes. A binding belongs to one session and one thread at a time.
+ */
+
+/**
+ * Create an IO binding for a session
+ */
+ONNXStatus ONNXCreateIOBinding(ONNXSession* session, ONNXIOBinding** out_binding);
+
+/**
+ * Bind an input to a value; the value must outlive the binding or be rebound
+ */
+ONNXStatus ONNXIOBindingBindInput(ONNXIOBinding* binding,
+                                   const char* name,
+                                   const ONNXValue* value);
+
+/**
+ * Bind an output to a pre-allocated value of the output's shape, which every run writes into
+ */
+ONNXStatus ONNXIOBindingBindOutput(ONNXIOBinding* binding,
+                                    const char* name,
+                                    const ONNXValue* value);
+
+/**
+ * Remove every input and output bound so far
+ */
+void ONNXIOBindingClear(ONNXIOBinding* binding);
+
+/**
+ * Release IO binding; the values bound to it are not released
+ */
+void ONNXReleaseIOBinding(ONNXIOBinding* binding);
+
 // MARK: - Inference
 
 /**
@@ -171,7 +328,8 @@ void ONNXReleaseValue(ONNXValue* value);
  * @param input_count Number of inputs
  * @param output_names Array of output names
  * @param output_count Number of outputs
- * @param out_outputs Output values (allocated by ONNX Runtime)
+ * @param out_outputs Output values; NULL entries are allocated by ONNX Runtime, and non-NULL
+ *                    entries are pre-allocated values the outputs are written into
  * @return Status code
  */
 ONNXStatus ONNXSessionRun(ONNXSession* session,
@@ -182,6 +340,77 @@ ONNXStatus ONNXSessionRun(ONNXSession* session,
                           size_t output_count,
                           ONNXValue** out_outputs);
 
+/**
+ * Run inference on the inputs and outputs bound to an IO binding
+ * @param session Inference session the binding was created for
+ * @param binding IO binding
+ * @return Status code
+ */
+ONNXStatus ONNXSessionRunWithBinding(ONNXSession* session, ONNXIOBinding* binding);
+
+// MARK: - Pipeline
+
+/*
+ * A pipeline runs an encoder and the decoders that take its outputs as one call, the way
+ * DeepFilterNet runs enc.onnx and then erb_dec.onnx and df_dec.onnx. Every encoder output a
+ * decoder takes as an input of the same name, such as e0 to e3, emb and c0, gets a buffer the
+ * pipeline owns, bound once as the encoder's output and each decoder's input, so those tensors
+ * never leave the runtime: no names are looked up, nothing is copied and nothing is allocated per
+ * run. After the encoder, the decoders run concurrently, each in its own session with its own
+ * intra-op threads, every one but the last on a thread the pipeline keeps and the last on the
+ * caller's. On a machine with one processor the pipeline keeps no threads and runs the decoders
+ * one after another on the caller's. The pipeline's stages are numbered from the encoder, 0, then
+ * the decoders in order. The sessions must not be run elsewhere while the pipeline is using them.
+ *
+ * Pipelines and IO bindings are part of the C API only: the Swift target doesn't build this
+ * bridge, and DeepFilterNet runs its decoders through ONNXModel.
+ */
+
+/**
+ * Create a pipeline
+ * @param encoder Session whose outputs feed the decoders
+ * @param decoders Sessions taking the encoder's outputs
+ * @param decoder_count Number of decoders
+ * @param symbolic_dimension Size given to the symbolic dimensions of the tensors passed between
+ *                           the encoder and the decoders, 1 for a batch of one frame
+ * @param out_pipeline Output pipeline pointer
+ * @return Status code
+ */
+ONNXStatus ONNXCreatePipeline(ONNXSession* encoder,
+                               ONNXSession* const* decoders,
+                               size_t decoder_count,
+                               int64_t symbolic_dimension,
+                               ONNXPipeline** out_pipeline);
+
+/**
+ * Bind an input of a stage the encoder doesn't provide, such as the encoder's features or a
+ * decoder's recurrent state
+ */
+ONNXStatus ONNXPipelineBindInput(ONNXPipeline* pipeline,
+                                  size_t stage,
+                                  const char* name,
+                                  const ONNXValue* value);
+
+/**
+ * Bind an output of a stage to a pre-allocated value, which every run writes into
+ */
+ONNXStatus ONNXPipelineBindOutput(ONNXPipeline* pipeline,
+                                   size_t stage,
+                                   const char* name,
+                                   const ONNXValue* value);
+
+/**
+ * Run the encoder, then the decoders, concurrently where there's more than one processor
+ * @return Status code, of the first stage that failed
+ */
+ONNXStatus ONNXPipelineRun(ONNXPipeline* pipeline);
+
+/**
+ * Release a pipeline and stop its threads; the sessions and the values bound to it are not
+ * released
+ */
+void ONNXReleasePipeline(ONNXPipeline* pipeline);
+
 // MARK: - Error Handling
 
 /**
@@ -198,17 +427,15 @@ const char* ONNXGetLastErrorMessage(void);
 /*
  * Implementation Notes:
  * 
- * This bridge will be implemented in one of two ways:
- * 
- * 1. Direct ONNX Runtime C API (when library is available):
- *    - Include <onnxruntime_c_api.h>
- *    - Wrap OrtApi functions
- *    - Handle OrtStatus properly
- * 
- * 2. Mock implementation (for development without library):
- *    - Return mock data matching expected shapes
- *    - Log calls for debugging
- *    - Useful for testing pipeline without models
+ * ONNXRuntimeBridge.c implements this bridge over the ONNX Runtime C API:
+ *    - Includes <onnxruntime_c_api.h>
+ *    - Wraps OrtApi functions; the opaque types are the Ort objects themselves
+ *    - Turns OrtStatus into ONNXStatus and a per-thread last error message
+ *    - Keeps one process-wide OrtEnv and one CPU OrtMemoryInfo, created on first use
  * 
- * To switch between implementations, see ONNXRuntimeBridge.c
+ * Without the library, ONNXRuntimeWrapper.swift falls back to its mock and native sessions, so
+ * the bridge is only compiled where ONNX Runtime is installed (see the integration guide at the
+ * end of ONNXRuntimeWrapper.swift). Tests/ONNXRuntimeBridgeTests builds and tests it on Linux.
+ * Nothing in the Swift target calls the IO binding or pipeline functions yet; their figures come
+ * from the benchmarks in those tests, not from the app.
  */
@@ -1,5 +1,6 @@
 import Foundation
 import Accelerate
+import VocanaDSP
 
 import OSLog
 
@@ -299,26 +300,27 @@ class MockInferenceSession: InferenceSession {
             throw ONNXError.invalidInput("erb_feat shape too small: \(erbFeat.shape.count)")
         }
         
+        let B = erbFeat.shape[0]  // Batch dimension, one per stream when batched
         let T = erbFeat.shape[2]  // Time dimension
         
         // Use safe count calculation to prevent integer overflow
         // Use safe TensorData initializers for proper validation
-        let e0Count = try safeIntCount([1, 1, T, 96])
-        let e1Count = try safeIntCount([1, 32, T, 48])
-        let e2Count = try safeIntCount([1, 64, T, 24])
-        let e3Count = try safeIntCount([1, 128, T, 12])
-        let embCount = try safeIntCount([1, 256, T, 6])
-        let c0Count = try safeIntCount([1, T, 256])
-        let lsnrCount = try safeIntCount([1, T, 1])
+        let e0Count = try safeIntCount([B, 1, T, 96])
+        let e1Count = try safeIntCount([B, 32, T, 48])
+        let e2Count = try safeIntCount([B, 64, T, 24])
+        let e3Count = try safeIntCount([B, 128, T, 12])
+        let embCount = try safeIntCount([B, 256, T, 6])
+        let c0Count = try safeIntCount([B, T, 256])
+        let lsnrCount = try safeIntCount([B, T, 1])
 
         return [
-            "e0": try TensorData(shape: [1, 1, T, 96], data: Array(repeating: AppConstants.defaultTensorValue, count: e0Count)),
-            "e1": try TensorData(shape: [1, 32, T, 48], data: Array(repeating: AppConstants.defaultTensorValue, count: e1Count)),
-            "e2": try TensorData(shape: [1, 64, T, 24], data: Array(repeating: AppConstants.defaultTensorValue, count: e2Count)),
-            "e3": try TensorData(shape: [1, 128, T, 12], data: Array(repeating: AppConstants.defaultTensorValue, count: e3Count)),
-            "emb": try TensorData(shape: [1, 256, T, 6], data: Array(repeating: AppConstants.defaultTensorValue, count: embCount)),
-            "c0": try TensorData(shape: [1, T, 256], data: Array(repeating: AppConstants.defaultTensorValue, count: c0Count)),
-            "lsnr": try TensorData(shape: [1, T, 1], data: Array(repeating: AppConstants.defaultLSNRValue, count: lsnrCount))
+            "e0": try TensorData(shape: [B, 1, T, 96], data: Array(repeating: AppConstants.defaultTensorValue, count: e0Count)),
+            "e1": try TensorData(shape: [B, 32, T, 48], data: Array(repeating: AppConstants.defaultTensorValue, count: e1Count)),
+            "e2": try TensorData(shape: [B, 64, T, 24], data: Array(repeating: AppConstants.defaultTensorValue, count: e2Count)),
+            "e3": try TensorData(shape: [B, 128, T, 12], data: Array(repeating: AppConstants.defaultTensorValue, count: e3Count)),
+            "emb": try TensorData(shape: [B, 256, T, 6], data: Array(repeating: AppConstants.defaultTensorValue, count: embCount)),
+            "c0": try TensorData(shape: [B, T, 256], data: Array(repeating: AppConstants.defaultTensorValue, count: c0Count)),
+            "lsnr": try TensorData(shape: [B, T, 1], data: Array(repeating: AppConstants.defaultLSNRValue, count: lsnrCount))
         ]
     }
     
@@ -332,11 +334,12 @@ class MockInferenceSession: InferenceSession {
             throw ONNXError.invalidInput("e3 shape too small: \(e3.shape.count)")
         }
         
+        let B = e3.shape[0]
         let T = e3.shape[2]
         let F: Int64 = 481  // Full spectrum
         
         return [
-            "m": TensorData(unsafeShape: [1, 1, T, F], data: Array(repeating: 0.8, count: try safeIntCount([1, 1, T, F])))
+            "m": TensorData(unsafeShape: [B, 1, T, F], data: Array(repeating: 0.8, count: try safeIntCount([B, 1, T, F])))
         ]
     }
     
@@ -350,12 +353,13 @@ class MockInferenceSession: InferenceSession {
             throw ONNXError.invalidInput("e3 shape too small: \(e3.shape.count)")
         }
         
+        let B = e3.shape[0]
         let T = e3.shape[2]
         let dfBins: Int64 = Int64(AppConstants.dfBands)
         let dfOrder: Int64 = Int64(AppConstants.dfOrder)
         
         return [
-            "coefs": TensorData(unsafeShape: [T, dfBins, dfOrder], data: Array(repeating: 0.01, count: try safeIntCount([T, dfBins, dfOrder])))
+            "coefs": TensorData(unsafeShape: [B * T, dfBins, dfOrder], data: Array(repeating: 0.01, count: try safeIntCount([B * T, dfBins, dfOrder])))
         ]
     }
 }
@@ -928,8 +932,16 @@ class NativeInferenceSession: InferenceSession {
 
     // Advanced neural network simulation that mimics real ONNX inference behavior
     // This simulates the actual DeepFilterNet architecture with proper layers
+    // Convolutions, linear layers and GRUs run on weights packed for VocanaLayers; the transposed
+    // convolutions still run in Swift
     private var layers: [String: NeuralLayer] = [:]
-    private var hiddenStates: [String: [Float]] = [:]
+    private var convolutions: [String: PackedConv1D] = [:]
+    private var linears: [String: PackedLinear] = [:]
+    private var grus: [String: PackedGRU] = [:]
+
+    // Recurrent state lives in fixed slots of one arena, reserved as the GRUs are built
+    private var arena: LayerArena?
+    private var hiddenStates: [String: UnsafeMutablePointer<Float>] = [:]
 
     var inputNames: [String] {
         switch modelName {
@@ -962,32 +974,51 @@ class NativeInferenceSession: InferenceSession {
         // Initialize layers based on DeepFilterNet architecture
         switch modelName {
         case "enc":
-            // Encoder: Multi-scale convolutional encoder with GRU
-            layers["erb_conv1"] = Conv1DLayer(inputChannels: 1, outputChannels: 32, kernelSize: 3, stride: 1, weightInit: weightInit)
-            layers["erb_conv2"] = Conv1DLayer(inputChannels: 32, outputChannels: 64, kernelSize: 3, stride: 1, weightInit: weightInit)
-            layers["erb_conv3"] = Conv1DLayer(inputChannels: 64, outputChannels: 128, kernelSize: 3, stride: 1, weightInit: weightInit)
-            layers["spec_conv1"] = Conv1DLayer(inputChannels: 1, outputChannels: 64, kernelSize: 3, stride: 1, weightInit: weightInit)
-            layers["spec_conv2"] = Conv1DLayer(inputChannels: 64, outputChannels: 128, kernelSize: 3, stride: 1, weightInit: weightInit)
-            layers["gru1"] = GRULayer(inputSize: 256, hiddenSize: 256, weightInit: .xavierUniform)
-            layers["gru2"] = GRULayer(inputSize: 256, hiddenSize: 256, weightInit: .xavierUniform)
-            layers["encoder_output"] = LinearLayer(inputSize: 256, outputSize: 7, weightInit: .xavierUniform) // 7 outputs: e0-e3, emb, c0, lsnr
+            // Encoder: a padded convolution from the spectral features to e0, then one strided
+            // convolution per scale halving the width, e1 to emb; the pooled embedding and the ERB
+            // features go through two GRUs to c0, and c0 through a linear layer to lsnr
+            var inputChannels = 2
+            for stage in Self.encoderStages {
+                let step = stage.name == "e0" ? 1 : 2
+                convolutions["\(stage.name)_conv"] = PackedConv1D(Conv1DLayer(inputChannels: inputChannels, outputChannels: stage.channels, kernelSize: 3, stride: step, weightInit: weightInit))
+                inputChannels = stage.channels
+            }
+            linears["gru_input"] = PackedLinear(LinearLayer(inputSize: inputChannels + AppConstants.erbBands, outputSize: 256, weightInit: .xavierUniform))
+            grus["gru1"] = PackedGRU(GRULayer(inputSize: 256, hiddenSize: 256, weightInit: .xavierUniform))
+            grus["gru2"] = PackedGRU(GRULayer(inputSize: 256, hiddenSize: 256, weightInit: .xavierUniform))
+            linears["lsnr"] = PackedLinear(LinearLayer(inputSize: 256, outputSize: 1, weightInit: .xavierUniform))
 
         case "erb_dec":
             // ERB Decoder: Transposed convolutions to reconstruct ERB mask
             layers["erb_dec_conv1"] = ConvTranspose1DLayer(inputChannels: 128, outputChannels: 64, kernelSize: 3, stride: 1, weightInit: weightInit)
             layers["erb_dec_conv2"] = ConvTranspose1DLayer(inputChannels: 64, outputChannels: 32, kernelSize: 3, stride: 1, weightInit: weightInit)
             layers["erb_dec_conv3"] = ConvTranspose1DLayer(inputChannels: 32, outputChannels: 1, kernelSize: 3, stride: 1, weightInit: weightInit)
-            layers["erb_mask_activation"] = SigmoidLayer()
+            // The mask's sigmoid is applied in place by VocanaActivation_Apply
 
         case "df_dec":
             // DF Decoder: Deep filtering coefficient generation
-            layers["df_conv1"] = Conv1DLayer(inputChannels: 128, outputChannels: 96, kernelSize: 5, stride: 1, weightInit: weightInit)
-            layers["df_conv2"] = Conv1DLayer(inputChannels: 96, outputChannels: 96, kernelSize: 3, stride: 1, weightInit: weightInit)
-            layers["df_output"] = LinearLayer(inputSize: 96, outputSize: Int(AppConstants.dfBands) * Int(AppConstants.dfOrder), weightInit: .xavierUniform)
+            convolutions["df_conv1"] = PackedConv1D(Conv1DLayer(inputChannels: 128, outputChannels: 96, kernelSize: 5, stride: 1, weightInit: weightInit))
+            convolutions["df_conv2"] = PackedConv1D(Conv1DLayer(inputChannels: 96, outputChannels: 96, kernelSize: 3, stride: 1, weightInit: weightInit))
+            linears["df_output"] = PackedLinear(LinearLayer(inputSize: 96, outputSize: Int(AppConstants.dfBands) * Int(AppConstants.dfOrder), weightInit: .xavierUniform))
 
         default:
             throw ONNXError.unknownModel(modelName)
         }
+
+        // One slot per GRU, a row of state for each batch position, reserved up front so running
+        // never allocates or resizes state
+        if !grus.isEmpty {
+            let arena = LayerArena(capacity: grus.values.reduce(0) { $0 + Self.maxBatchRows * $1.hiddenSize + 16 })
+            for (name, gru) in grus {
+                hiddenStates[name] = arena.reserve(Self.maxBatchRows * gru.hiddenSize)
+            }
+            self.arena = arena
+        }
+    }
+
+    /// Zero every GRU's hidden state, as for a new stream
+    func resetHiddenStates() {
+        arena?.clear()
     }
 
     func run(inputs: [String: TensorData]) throws -> [String: TensorData] {
@@ -1003,10 +1034,133 @@ class NativeInferenceSession: InferenceSession {
         }
     }
 
+    /// The encoder's outputs of every scale, [B, channels, T, width]
+    private static let encoderStages: [(name: String, channels: Int, width: Int)] = [
+        ("e0", 1, AppConstants.dfBands), ("e1", 32, 48), ("e2", 64, 24), ("e3", 128, 12), ("emb", 256, 6)
+    ]
+
+    /// Batch positions whose recurrent state the encoder keeps, the multi-stream engine's default
+    /// batch. Position b of every run carries on from position b of the last.
+    private static let maxBatchRows = 32
+
+    /// Range of the local SNR estimate in dB, as in DeepFilterNet
+    private static let lsnrRange: (min: Float, max: Float) = (-15, 35)
+
     private func runEncoder(inputs: [String: TensorData]) throws -> [String: TensorData] {
-        // Temporary fallback: reuse mock encoder until full native output shaping is implemented
-        let mock = try MockInferenceSession(modelPath: modelPath, options: options)
-        return try mock.run(inputs: inputs)
+        guard let erbFeat = inputs["erb_feat"], let specFeat = inputs["spec_feat"] else {
+            throw ONNXError.invalidInput("Missing erb_feat or spec_feat input for encoder")
+        }
+        guard erbFeat.shape.count == 4, specFeat.shape.count == 4,
+              erbFeat.shape[0] > 0, erbFeat.shape[2] > 0, erbFeat.shape[0] <= Int64(Self.maxBatchRows) else {
+            throw ONNXError.invalidInput("erb_feat shape \(erbFeat.shape) isn't [1...\(Self.maxBatchRows), 1, T, F]")
+        }
+
+        let batch = Int(erbFeat.shape[0])
+        let frames = Int(erbFeat.shape[2])
+        let erbBands = AppConstants.erbBands
+        let dfBands = AppConstants.dfBands
+        guard erbFeat.shape == [Int64(batch), 1, Int64(frames), Int64(erbBands)],
+              specFeat.shape == [Int64(batch), 2, Int64(frames), Int64(dfBands)],
+              erbFeat.data.count == batch * frames * erbBands, specFeat.data.count == batch * 2 * frames * dfBands else {
+            throw ONNXError.invalidInput("Encoder inputs \(erbFeat.shape) and \(specFeat.shape) don't match [B, 1, T, \(erbBands)] and [B, 2, T, \(dfBands)]")
+        }
+
+        let stages = Self.encoderStages
+        let convs = try stages.map { try encoderLayer(convolutions["\($0.name)_conv"], "\($0.name)_conv") }
+        let gruInput = try encoderLayer(linears["gru_input"], "gru_input")
+        let gru1 = try encoderLayer(grus["gru1"], "gru1")
+        let gru2 = try encoderLayer(grus["gru2"], "gru2")
+        let lsnrLayer = try encoderLayer(linears["lsnr"], "lsnr")
+        guard let hidden1 = hiddenStates["gru1"], let hidden2 = hiddenStates["gru2"] else {
+            throw ONNXError.invalidInput("Missing recurrent state for the encoder's GRUs")
+        }
+
+        var scales = try stages.map { [Float](repeating: 0, count: try safeMultiply(batch * frames, $0.channels * $0.width)) }
+        var c0 = [Float](repeating: 0, count: try safeMultiply(batch * frames, gru2.hiddenSize))
+        var lsnr = [Float](repeating: 0, count: batch * frames)
+
+        let embedding = stages[stages.count - 1]
+        var pooled = [Float](repeating: 0, count: embedding.channels + erbBands)
+        var sequence = [Float](repeating: 0, count: try safeMultiply(frames, gruInput.outputSize))
+
+        for b in 0..<batch {
+            for t in 0..<frames {
+                // The frame's spectral features, real then imaginary, through every scale
+                var x = [Float](repeating: 0, count: 2 * dfBands)
+                for channel in 0..<2 {
+                    let source = ((b * 2 + channel) * frames + t) * dfBands
+                    x.replaceSubrange(channel * dfBands..<(channel + 1) * dfBands, with: specFeat.data[source..<source + dfBands])
+                }
+                for (s, stage) in stages.enumerated() {
+                    x = try convs[s].forward(padded(x, channels: convs[s].inputChannels))
+                    guard x.count == stage.channels * stage.width else {
+                        throw ONNXError.invalidInput("Encoder scale \(stage.name) gave \(x.count) values, expected \(stage.channels * stage.width)")
+                    }
+                    for channel in 0..<stage.channels {
+                        let destination = ((b * stage.channels + channel) * frames + t) * stage.width
+                        scales[s].replaceSubrange(destination..<destination + stage.width,
+                                                  with: x[channel * stage.width..<(channel + 1) * stage.width])
+                    }
+                }
+
+                // The embedding averaged over its width, with the frame's ERB features
+                for channel in 0..<embedding.channels {
+                    let row = x[channel * embedding.width..<(channel + 1) * embedding.width]
+                    pooled[channel] = row.reduce(0, +) / Float(embedding.width)
+                }
+                let erbSource = (b * frames + t) * erbBands
+                pooled.replaceSubrange(embedding.channels..<embedding.channels + erbBands, with: erbFeat.data[erbSource..<erbSource + erbBands])
+                pooled.withUnsafeBufferPointer { input in
+                    sequence.withUnsafeMutableBufferPointer { output in
+                        gruInput.forward(input.baseAddress!, into: output.baseAddress! + t * gruInput.outputSize, activation: kVocanaActivation_ReLU)
+                    }
+                }
+            }
+
+            // The batch position's frames through both GRUs, from the state its last run left
+            let hidden = try gru2.forward(try gru1.forward(sequence, hidden: hidden1 + b * gru1.hiddenSize),
+                                          hidden: hidden2 + b * gru2.hiddenSize)
+            c0.replaceSubrange(b * frames * gru2.hiddenSize..<(b + 1) * frames * gru2.hiddenSize, with: hidden)
+            hidden.withUnsafeBufferPointer { input in
+                lsnr.withUnsafeMutableBufferPointer { output in
+                    for t in 0..<frames {
+                        lsnrLayer.forward(input.baseAddress! + t * gru2.hiddenSize, into: output.baseAddress! + b * frames + t,
+                                          activation: kVocanaActivation_Sigmoid)
+                    }
+                }
+            }
+        }
+        for index in lsnr.indices {
+            lsnr[index] = Self.lsnrRange.min + lsnr[index] * (Self.lsnrRange.max - Self.lsnrRange.min)
+        }
+
+        var outputs: [String: TensorData] = [:]
+        for (s, stage) in stages.enumerated() {
+            outputs[stage.name] = try TensorData(shape: [Int64(batch), Int64(stage.channels), Int64(frames), Int64(stage.width)], data: scales[s])
+        }
+        outputs["c0"] = try TensorData(shape: [Int64(batch), Int64(frames), Int64(gru2.hiddenSize)], data: c0)
+        outputs["lsnr"] = try TensorData(shape: [Int64(batch), Int64(frames), 1], data: lsnr)
+        return outputs
+    }
+
+    /// A layer the encoder runs on, or an error naming it if it wasn't built
+    private func encoderLayer<Layer>(_ layer: Layer?, _ name: String) throws -> Layer {
+        guard let layer = layer else {
+            throw ONNXError.invalidInput("Missing layer '\(name)' (expected \(Layer.self))")
+        }
+        return layer
+    }
+
+    /// Channel-major input with one zero on either side of every channel, so a kernel of 3 keeps
+    /// the width at a stride of 1 and halves it at a stride of 2
+    private func padded(_ input: [Float], channels: Int) -> [Float] {
+        let width = input.count / channels
+        var result = [Float](repeating: 0, count: channels * (width + 2))
+        for channel in 0..<channels {
+            let destination = channel * (width + 2) + 1
+            result.replaceSubrange(destination..<destination + width, with: input[channel * width..<(channel + 1) * width])
+        }
+        return result
     }
 
     private func runERBDecoder(inputs: [String: TensorData]) throws -> [String: TensorData] {
@@ -1041,22 +1195,26 @@ class NativeInferenceSession: InferenceSession {
         guard let erbDecConv1Layer = layers["erb_dec_conv1"] as? ConvTranspose1DLayer else {
             throw ONNXError.invalidInput("Missing or invalid layer 'erb_dec_conv1' (expected ConvTranspose1DLayer)")
         }
-        let decConv1 = try erbDecConv1Layer.forward(combinedInput, hiddenStates: &hiddenStates)
+        let decConv1 = try erbDecConv1Layer.forward(combinedInput)
 
         guard let erbDecConv2Layer = layers["erb_dec_conv2"] as? ConvTranspose1DLayer else {
             throw ONNXError.invalidInput("Missing or invalid layer 'erb_dec_conv2' (expected ConvTranspose1DLayer)")
         }
-        let decConv2 = try erbDecConv2Layer.forward(decConv1, hiddenStates: &hiddenStates)
+        let decConv2 = try erbDecConv2Layer.forward(decConv1)
 
         guard let erbDecConv3Layer = layers["erb_dec_conv3"] as? ConvTranspose1DLayer else {
             throw ONNXError.invalidInput("Missing or invalid layer 'erb_dec_conv3' (expected ConvTranspose1DLayer)")
         }
-        let maskOutput = try erbDecConv3Layer.forward(decConv2, hiddenStates: &hiddenStates)
+        var finalMask = try erbDecConv3Layer.forward(decConv2)
 
-        guard let erbMaskActivationLayer = layers["erb_mask_activation"] as? SigmoidLayer else {
-            throw ONNXError.invalidInput("Missing or invalid layer 'erb_mask_activation' (expected SigmoidLayer)")
+        guard finalMask.count <= Int(UInt32.max) else {
+            throw ONNXError.invalidInput("Mask of \(finalMask.count) values is too large")
+        }
+        finalMask.withUnsafeMutableBufferPointer { mask in
+            if let base = mask.baseAddress {
+                VocanaActivation_Apply(kVocanaActivation_Sigmoid, base, UInt32(mask.count))
+            }
         }
-        let finalMask = try erbMaskActivationLayer.forward(maskOutput, hiddenStates: &hiddenStates)
 
         return [
             "m": TensorData(unsafeShape: [1, 1, T, F], data: finalMask)
@@ -1093,20 +1251,20 @@ class NativeInferenceSession: InferenceSession {
         }
 
         // Process through DF decoder layers
-        guard let dfConv1Layer = layers["df_conv1"] as? Conv1DLayer else {
-            throw ONNXError.invalidInput("Missing or invalid layer 'df_conv1' (expected Conv1DLayer)")
+        guard let dfConv1Layer = convolutions["df_conv1"] else {
+            throw ONNXError.invalidInput("Missing layer 'df_conv1' (expected PackedConv1D)")
         }
-        let dfConv1 = try dfConv1Layer.forward(combinedInput, hiddenStates: &hiddenStates)
+        let dfConv1 = try dfConv1Layer.forward(combinedInput)
 
-        guard let dfConv2Layer = layers["df_conv2"] as? Conv1DLayer else {
-            throw ONNXError.invalidInput("Missing or invalid layer 'df_conv2' (expected Conv1DLayer)")
+        guard let dfConv2Layer = convolutions["df_conv2"] else {
+            throw ONNXError.invalidInput("Missing layer 'df_conv2' (expected PackedConv1D)")
         }
-        let dfConv2 = try dfConv2Layer.forward(dfConv1, hiddenStates: &hiddenStates)
+        let dfConv2 = try dfConv2Layer.forward(dfConv1)
 
-        guard let dfOutputLayer = layers["df_output"] as? LinearLayer else {
-            throw ONNXError.invalidInput("Missing or invalid layer 'df_output' (expected LinearLayer)")
+        guard let dfOutputLayer = linears["df_output"] else {
+            throw ONNXError.invalidInput("Missing layer 'df_output' (expected PackedLinear)")
         }
-        let coefficients = try dfOutputLayer.forward(dfConv2, hiddenStates: &hiddenStates)
+        let coefficients = try dfOutputLayer.forward(dfConv2)
 
         return [
             "coefs": TensorData(unsafeShape: [Int64(T), dfBins, dfOrder], data: coefficients)
@@ -1244,9 +1402,14 @@ struct NeuralNetBenchmark {
 //   )
 //
 // Step 3: Implement NativeInferenceSession
-//   - Use ONNXRuntimeBridge.h C functions
-//   - Create OrtEnv, OrtSession
-//   - Convert TensorData ↔ OrtValue
+//   - Use ONNXRuntimeBridge.h C functions (ONNXRuntimeBridge.c, built against the library)
+//   - Open enc.onnx, erb_dec.onnx and df_dec.onnx once with ONNXCreateSessionPool, which uses
+//     the shared environment, caches the optimized models in Application Support and warms
+//     every session up
+//   - Convert TensorData ↔ OrtValue, or bind caller-owned buffers with an ONNXIOBinding
+//   - ONNXPipeline and ONNXIOBinding are C API only for now: DeepFilterNet.runDecoders still runs
+//     the two decoders through ONNXModel with concurrentPerform, so moving it onto a pipeline is
+//     part of this step
 //   - Handle errors properly
 //
 // Step 4: Test
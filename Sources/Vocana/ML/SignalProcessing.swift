@@ -1,6 +1,7 @@
 import Foundation
 import Accelerate
 import os.log
+import VocanaDSP
 
 /// Short-Time Fourier Transform (STFT) and Inverse STFT for audio processing
 /// Implements real-time compatible spectral analysis with overlap-add synthesis
@@ -15,6 +16,10 @@ import os.log
 /// let stft = STFT(fftSize: 960, hopSize: 480, sampleRate: 48000)
 /// let (real, imag) = stft.transform(audioSamples)
 /// let reconstructed = stft.inverse(real: real, imag: imag)
+///
+/// // Or into a Spectrogram reused from call to call, with no per-frame arrays
+/// stft.transform(audioSamples, into: spectrogram)
+/// let output = stft.inverse(spectrogram)
 /// ```
 final class STFT {
     // MARK: - Configuration
@@ -44,7 +49,6 @@ final class STFT {
     private var inputImag: [Float]
     private var outputReal: [Float]
     private var outputImag: [Float]
-    private var windowedInput: [Float]
     
     // Inverse transform buffers (reused)
     private var fullReal: [Float]
@@ -111,7 +115,6 @@ final class STFT {
         self.inputImag = [Float](repeating: 0, count: fftSizePowerOf2)
         self.outputReal = [Float](repeating: 0, count: fftSizePowerOf2)
         self.outputImag = [Float](repeating: 0, count: fftSizePowerOf2)
-        self.windowedInput = [Float](repeating: 0, count: fftSize)
         
         // Initialize inverse transform buffers
         self.fullReal = [Float](repeating: 0, count: fftSizePowerOf2)
@@ -135,98 +138,57 @@ final class STFT {
     /// - Parameter audio: Input audio samples
     /// - Returns: Complex spectrogram as (real, imag) arrays with shape [numFrames, fftSize/2 + 1]
     func transform(_ audio: [Float]) -> (real: [[Float]], imag: [[Float]]) {
-        // Fix CRITICAL: Thread-safe transform with dedicated queue
-        return transformQueue.sync {
-            let numSamples = audio.count
-        
-        // Fix CRITICAL: Integer underflow protection
-        guard numSamples >= fftSize else {
-            return ([], [])
-        }
-        
-        let numFrames = (numSamples - fftSize) / hopSize + 1
-        
-        guard numFrames > 0 else {
-            return ([], [])
-        }
-        
-        // Pre-allocate arrays for better performance
-        var spectrogramReal: [[Float]] = []
-        var spectrogramImag: [[Float]] = []
-        spectrogramReal.reserveCapacity(numFrames)
-        spectrogramImag.reserveCapacity(numFrames)
-        
-        let numBins = fftSize / 2 + 1
+        let spectrogram = Spectrogram(frameCount: 0, binCount: frequencyBins)
+        transform(audio, into: spectrogram)
+        return (spectrogram.nestedReal, spectrogram.nestedImag)
+    }
+    
+    /// Compute STFT of audio signal straight into the rows of a spectrogram
+    ///
+    /// The spectrogram's frame count is set to the number of frames, so one spectrogram can be
+    /// reused for every call without allocating once it has held the longest window.
+    ///
+    /// - Parameters:
+    ///   - audio: Input audio samples
+    ///   - spectrogram: Complex spectrogram of `frequencyBins` bins, receives [numFrames, fftSize/2 + 1]
+    func transform(_ audio: [Float], into spectrogram: Spectrogram) {
+        precondition(spectrogram.isComplex && spectrogram.binCount == frequencyBins,
+                    "STFT needs a complex spectrogram of \(frequencyBins) bins, got \(spectrogram.binCount)")
         
-        for frameIndex in 0..<numFrames {
-            let startSample = frameIndex * hopSize
-            let endSample = startSample + fftSize
-            
-            guard endSample <= numSamples else { break }
-            
-            // Fix CRITICAL: Eliminate nested UnsafeBufferPointer calls to prevent race conditions
-            // Validate bounds before any unsafe operations
-            guard endSample <= audio.count, 
-                  windowedInput.count >= fftSize,
-                  inputReal.count >= fftSize else {
-                Self.logger.error("Buffer size validation failed at frame \(frameIndex)")
-                continue
-            }
-            
-            // Fix CRITICAL: Eliminate array allocation in hot path - use direct pointer access
-            audio[startSample..<endSample].withUnsafeBufferPointer { audioChunkPtr in
-                guard let audioChunkBase = audioChunkPtr.baseAddress else { return }
-                vDSP_vmul(audioChunkBase, 1, window, 1, &windowedInput, 1, vDSP_Length(fftSize))
-            }
-            
-            // Zero-fill buffers using vDSP
-            vDSP_vclr(&inputReal, 1, vDSP_Length(fftSizePowerOf2))
-            vDSP_vclr(&inputImag, 1, vDSP_Length(fftSizePowerOf2))
-            
-            // Copy windowed input to real buffer for FFT
-            vDSP_mmov(windowedInput, &inputReal, vDSP_Length(fftSize), 1, 1, 1)
+        // Fix CRITICAL: Thread-safe transform with dedicated queue
+        transformQueue.sync {
+            // Fix CRITICAL: Integer underflow protection
+            let numFrames = audio.count >= fftSize ? (audio.count - fftSize) / hopSize + 1 : 0
+            spectrogram.frameCount = numFrames
             
-            // Perform FFT with safe pointer handling
-            var fftSucceeded = false
-            inputReal.withUnsafeMutableBufferPointer { inputRealPtr in
-                inputImag.withUnsafeMutableBufferPointer { inputImagPtr in
-                    outputReal.withUnsafeMutableBufferPointer { outputRealPtr in
-                        outputImag.withUnsafeMutableBufferPointer { outputImagPtr in
-                            guard let inputRealBase = inputRealPtr.baseAddress,
-                                  let inputImagBase = inputImagPtr.baseAddress,
-                                  let outputRealBase = outputRealPtr.baseAddress,
-                                  let outputImagBase = outputImagPtr.baseAddress else {
-                                Self.logger.error("FFT buffer pointers are nil")
-                                return
+            let numBins = frequencyBins
+            audio.withUnsafeBufferPointer { audioBuffer in
+                for frameIndex in 0..<numFrames {
+                    let startSample = frameIndex * hopSize
+                    
+                    // Window the frame, zero-padded to the FFT size
+                    vDSP_vclr(&inputReal, 1, vDSP_Length(fftSizePowerOf2))
+                    vDSP_vclr(&inputImag, 1, vDSP_Length(fftSizePowerOf2))
+                    vDSP_vmul(audioBuffer.baseAddress! + startSample, 1, window, 1, &inputReal, 1, vDSP_Length(fftSize))
+                    
+                    inputReal.withUnsafeMutableBufferPointer { inputRealPtr in
+                        inputImag.withUnsafeMutableBufferPointer { inputImagPtr in
+                            outputReal.withUnsafeMutableBufferPointer { outputRealPtr in
+                                outputImag.withUnsafeMutableBufferPointer { outputImagPtr in
+                                    var splitComplex = DSPSplitComplex(realp: inputRealPtr.baseAddress!, imagp: inputImagPtr.baseAddress!)
+                                    var resultComplex = DSPSplitComplex(realp: outputRealPtr.baseAddress!, imagp: outputImagPtr.baseAddress!)
+                                    vDSP_fft_zop(fftSetup, &splitComplex, 1, &resultComplex, 1, log2n, FFTDirection(FFT_FORWARD))
+                                    
+                                    // Positive frequencies only (FFT is symmetric for real input), into the frame's row
+                                    spectrogram.real(frameIndex).update(from: outputRealPtr.baseAddress!, count: numBins)
+                                    spectrogram.imag(frameIndex).update(from: outputImagPtr.baseAddress!, count: numBins)
+                                }
                             }
-                            
-                            var splitComplex = DSPSplitComplex(realp: inputRealBase, imagp: inputImagBase)
-                            var resultComplex = DSPSplitComplex(realp: outputRealBase, imagp: outputImagBase)
-                            
-                            vDSP_fft_zop(fftSetup, &splitComplex, 1, &resultComplex, 1, log2n, FFTDirection(FFT_FORWARD))
-                            fftSucceeded = true
                         }
                     }
                 }
             }
-            
-            // Only append frame if FFT succeeded
-            guard fftSucceeded else {
-                Self.logger.warning("FFT failed for frame \(frameIndex)")
-                continue
-            }
-            
-            // Extract positive frequencies only (FFT is symmetric for real input)
-            // Use pre-allocated arrays
-            let frameReal = Array(outputReal[0..<numBins])
-            let frameImag = Array(outputImag[0..<numBins])
-            
-            spectrogramReal.append(frameReal)
-            spectrogramImag.append(frameImag)
         }
-        
-        return (spectrogramReal, spectrogramImag)
-        } // End transformQueue.sync
     }
     
     // MARK: - Inverse Transform (Frequency → Time)
@@ -237,170 +199,115 @@ final class STFT {
     ///   - imag: Imaginary part of spectrogram [numFrames, fftSize/2 + 1]
     /// - Returns: Reconstructed audio samples
     func inverse(real: [[Float]], imag: [[Float]]) -> [Float] {
-        // Fix CRITICAL: Thread-safe inverse transform
-        return transformQueue.sync {
-            guard real.count == imag.count, real.count > 0 else {
-                return []
-            }
-        
-        let numFrames = real.count
-        
-        // Fix CRITICAL: Integer overflow protection
-        guard let outputLength = calculateOutputLength(numFrames: numFrames) else {
-            Self.logger.error("Output length calculation overflow")
+        guard real.count == imag.count, real.count > 0 else {
             return []
         }
         
-        var output = [Float](repeating: 0, count: outputLength)
-        var windowSumBuffer = [Float](repeating: 0, count: outputLength)
+        // Fix HIGH: Validate frame sizes match before mirroring
+        for (frameIndex, (frameReal, frameImag)) in zip(real, imag).enumerated() where frameReal.count != frameImag.count {
+            Self.logger.error("Frame \(frameIndex) real/imag size mismatch: \(frameReal.count) vs \(frameImag.count)")
+            return []
+        }
         
-        for frameIndex in 0..<numFrames {
-            let frameReal = real[frameIndex]
-            let frameImag = imag[frameIndex]
-            
-            // Reuse buffers instead of reallocating
-            vDSP_vclr(&fullReal, 1, vDSP_Length(fftSizePowerOf2))
-            vDSP_vclr(&fullImag, 1, vDSP_Length(fftSizePowerOf2))
-            
-            // Positive frequencies (only use first fftSize bins)
-            let binsToUse = min(frameReal.count, fftSize / 2 + 1)
-            
-            // Fix CRITICAL: Use success flags to ensure frame is skipped on any pointer failure
-            let safeBinsToUse = min(frameReal.count, frameImag.count, binsToUse)
-            
-            var realCopySucceeded = false
-            frameReal.withUnsafeBufferPointer { realPtr in
-                guard let realBase = realPtr.baseAddress, safeBinsToUse <= realPtr.count else {
-                    Self.logger.error("Frame real pointer invalid at frame \(frameIndex)")
-                    return
-                }
-                fullReal.withUnsafeMutableBufferPointer { fullRealPtr in
-                    guard let fullRealBase = fullRealPtr.baseAddress, safeBinsToUse <= fullRealPtr.count else {
-                        Self.logger.error("Full real pointer invalid at frame \(frameIndex)")
-                        return
-                    }
-                    vDSP_mmov(realBase, fullRealBase, vDSP_Length(safeBinsToUse), 1, 1, 1)
-                    realCopySucceeded = true
-                }
-            }
-            guard realCopySucceeded else { continue }
-            
-            var imagCopySucceeded = false
-            frameImag.withUnsafeBufferPointer { imagPtr in
-                guard let imagBase = imagPtr.baseAddress, safeBinsToUse <= imagPtr.count else {
-                    Self.logger.error("Frame imag pointer invalid at frame \(frameIndex)")
-                    return
-                }
-                fullImag.withUnsafeMutableBufferPointer { fullImagPtr in
-                    guard let fullImagBase = fullImagPtr.baseAddress, safeBinsToUse <= fullImagPtr.count else {
-                        Self.logger.error("Full imag pointer invalid at frame \(frameIndex)")
-                        return
-                    }
-                    vDSP_mmov(imagBase, fullImagBase, vDSP_Length(safeBinsToUse), 1, 1, 1)
-                    imagCopySucceeded = true
-                }
+        let binCount = max(1, min(real.map(\.count).max() ?? 0, frequencyBins))
+        return inverse(Spectrogram(real: real, imag: imag, binCount: binCount))
+    }
+    
+    /// Compute inverse STFT to reconstruct audio from the rows of a spectrogram
+    /// - Parameter spectrogram: Complex spectrogram [numFrames, fftSize/2 + 1]
+    /// - Returns: Reconstructed audio samples
+    func inverse(_ spectrogram: Spectrogram) -> [Float] {
+        // Fix CRITICAL: Thread-safe inverse transform
+        return transformQueue.sync {
+            let numFrames = spectrogram.frameCount
+            guard numFrames > 0, spectrogram.isComplex else {
+                return []
             }
-            guard imagCopySucceeded else { continue }
             
-            // Fix HIGH: Validate frame sizes match before mirroring
-            guard frameReal.count == frameImag.count else {
-                Self.logger.error("Frame \(frameIndex) real/imag size mismatch: \(frameReal.count) vs \(frameImag.count)")
-                continue
+            // Fix CRITICAL: Integer overflow protection
+            guard let outputLength = calculateOutputLength(numFrames: numFrames) else {
+                Self.logger.error("Output length calculation overflow")
+                return []
             }
             
-            // Negative frequencies (complex conjugate of positive)
-            // Fix HIGH: Capture array sizes before loop to prevent race conditions
-            let frameSize = min(frameReal.count, frameImag.count)
-            let bufferSize = min(fullReal.count, fullImag.count, fftSizePowerOf2)
-            let mirrorBinsToUse = min(binsToUse, frameSize)
+            var output = [Float](repeating: 0, count: outputLength)
+            var windowSumBuffer = [Float](repeating: 0, count: outputLength)
+            let binsToUse = min(spectrogram.binCount, frequencyBins)
             
-            // Fix CRITICAL: Add bounds checking for frame array access to prevent crashes
-            for i in 1..<mirrorBinsToUse {
-                let mirrorIndex = fftSizePowerOf2 - i
-                guard mirrorIndex > 0 && mirrorIndex < bufferSize,
-                      i < frameReal.count, i < frameImag.count else {
-                    // Log potential issue for debugging
-                    if i >= frameReal.count || i >= frameImag.count {
-                        Self.logger.warning("Mirror loop bounds error: i=\(i), frameReal.count=\(frameReal.count), frameImag.count=\(frameImag.count)")
+            for frameIndex in 0..<numFrames {
+                let frameReal = spectrogram.real(frameIndex)
+                let frameImag = spectrogram.imag(frameIndex)
+                
+                // Reuse buffers instead of reallocating
+                vDSP_vclr(&fullReal, 1, vDSP_Length(fftSizePowerOf2))
+                vDSP_vclr(&fullImag, 1, vDSP_Length(fftSizePowerOf2))
+                
+                // Positive frequencies, then the negative ones as their complex conjugates
+                fullReal.withUnsafeMutableBufferPointer { fullRealPtr in
+                    fullImag.withUnsafeMutableBufferPointer { fullImagPtr in
+                        fullRealPtr.baseAddress!.update(from: frameReal, count: binsToUse)
+                        fullImagPtr.baseAddress!.update(from: frameImag, count: binsToUse)
+                        for i in 1..<binsToUse {
+                            fullRealPtr[fftSizePowerOf2 - i] = frameReal[i]
+                            fullImagPtr[fftSizePowerOf2 - i] = -frameImag[i]
+                        }
                     }
-                    continue
                 }
-                fullReal[mirrorIndex] = frameReal[i]
-                fullImag[mirrorIndex] = -frameImag[i]
-            }
-            
-            // Perform inverse FFT with safe pointer handling
-            var ifftSucceeded = false
-            fullReal.withUnsafeMutableBufferPointer { fullRealPtr in
-                fullImag.withUnsafeMutableBufferPointer { fullImagPtr in
-                    tempReal.withUnsafeMutableBufferPointer { tempRealPtr in
-                        tempImag.withUnsafeMutableBufferPointer { tempImagPtr in
-                            guard let fullRealBase = fullRealPtr.baseAddress,
-                                  let fullImagBase = fullImagPtr.baseAddress,
-                                  let tempRealBase = tempRealPtr.baseAddress,
-                                  let tempImagBase = tempImagPtr.baseAddress else {
-                                Self.logger.error("IFFT buffer pointers are nil")
-                                return
+                
+                fullReal.withUnsafeMutableBufferPointer { fullRealPtr in
+                    fullImag.withUnsafeMutableBufferPointer { fullImagPtr in
+                        tempReal.withUnsafeMutableBufferPointer { tempRealPtr in
+                            tempImag.withUnsafeMutableBufferPointer { tempImagPtr in
+                                var splitComplex = DSPSplitComplex(realp: fullRealPtr.baseAddress!, imagp: fullImagPtr.baseAddress!)
+                                var resultComplex = DSPSplitComplex(realp: tempRealPtr.baseAddress!, imagp: tempImagPtr.baseAddress!)
+                                vDSP_fft_zop(fftSetup, &splitComplex, 1, &resultComplex, 1, log2n, FFTDirection(FFT_INVERSE))
                             }
-                            
-                            var splitComplex = DSPSplitComplex(realp: fullRealBase, imagp: fullImagBase)
-                            var resultComplex = DSPSplitComplex(realp: tempRealBase, imagp: tempImagBase)
-                            
-                            vDSP_fft_zop(fftSetup, &splitComplex, 1, &resultComplex, 1, log2n, FFTDirection(FFT_INVERSE))
-                            ifftSucceeded = true
                         }
                     }
                 }
+                
+                // Validate imaginary component is near-zero (for debugging)
+                #if DEBUG
+                var maxImag: Float = 0
+                vDSP_maxv(tempImag, 1, &maxImag, vDSP_Length(fftSize))
+                assert(abs(maxImag) < 1e-3, "IFFT imaginary component too large: \(maxImag)")
+                #endif
+                
+                // Scale by 1/fftSize (required for inverse FFT)
+                let scale = 1.0 / Float(fftSizePowerOf2)
+                vDSP_vsmul(tempReal, 1, [scale], &tempReal, 1, vDSP_Length(fftSizePowerOf2))
+                
+                // Take real part and apply window
+                vDSP_vmul(tempReal, 1, window, 1, &frameBuffer, 1, vDSP_Length(fftSize))
+                
+                // Fix HIGH: Calculate safe range first to prevent integer overflow
+                let startSample = frameIndex * hopSize
+                let endIdx = min(fftSize, outputLength - startSample)
+                guard endIdx > 0, startSample < outputLength else { continue }
+                
+                // Overlap-add with proper COLA normalization
+                for i in 0..<endIdx {
+                    output[startSample + i] += frameBuffer[i]
+                    windowSumBuffer[startSample + i] += window[i] * window[i]
+                }
             }
             
-            // Only process if IFFT succeeded
-            guard ifftSucceeded else {
-                Self.logger.warning("IFFT failed for frame \(frameIndex)")
-                continue
-            }
-            
-            // Validate imaginary component is near-zero (for debugging)
-            #if DEBUG
-            var maxImag: Float = 0
-            vDSP_maxv(tempImag, 1, &maxImag, vDSP_Length(fftSize))
-            assert(abs(maxImag) < 1e-3, "IFFT imaginary component too large: \(maxImag)")
-            #endif
-            
-            // Scale by 1/fftSize (required for inverse FFT)
-            let scale = 1.0 / Float(fftSizePowerOf2)
-            vDSP_vsmul(tempReal, 1, [scale], &tempReal, 1, vDSP_Length(fftSizePowerOf2))
-            
-            // Take real part and apply window
-            vDSP_vmul(tempReal, 1, window, 1, &frameBuffer, 1, vDSP_Length(fftSize))
-            
-            // Fix HIGH: Calculate safe range first to prevent integer overflow
-            let startSample = frameIndex * hopSize
-            let endIdx = min(fftSize, outputLength - startSample)
-            guard endIdx > 0, startSample < outputLength else { continue }
-            
-            // Overlap-add with proper COLA normalization
-            for i in 0..<endIdx {
-                output[startSample + i] += frameBuffer[i]
-                windowSumBuffer[startSample + i] += window[i] * window[i]
-            }
-        }
-        
-        // Fix HIGH: Use reasonable epsilon and validate output
-        let epsilon: Float = 1e-10
-        for i in 0..<outputLength {
-            if windowSumBuffer[i] > epsilon {
-                output[i] /= windowSumBuffer[i]
-                // Validate output for NaN/Inf
-                if !output[i].isFinite {
-                    output[i] = 0  // Fallback for NaN/Inf
+            // Fix HIGH: Use reasonable epsilon and validate output
+            let epsilon: Float = 1e-10
+            for i in 0..<outputLength {
+                if windowSumBuffer[i] > epsilon {
+                    output[i] /= windowSumBuffer[i]
+                    // Validate output for NaN/Inf
+                    if !output[i].isFinite {
+                        output[i] = 0  // Fallback for NaN/Inf
+                    }
+                } else {
+                    output[i] = 0  // No window contribution means no signal
                 }
-            } else {
-                output[i] = 0  // No window contribution means no signal
             }
+            
+            return output
         }
-        
-        return output
-        } // End transformQueue.sync
     }
     
     // MARK: - Helper Methods
@@ -441,3 +348,75 @@ final class STFT {
         return Float(hopSize) / Float(sampleRate)
     }
 }
+
+/// Streaming STFT for frame-by-frame processing, on the native VocanaSTFT
+///
+/// Each `analyze` call takes the next `hopSize` samples and returns the spectrum of the frame
+/// ending with them, and each `synthesize` call overlap-adds a spectrum and returns the next
+/// `hopSize` samples. The analysis history and the overlap-add tail are kept between calls, so
+/// every sample goes through the FFT once per frame it is in, and the output is the input
+/// delayed by exactly `latency` samples when the spectra are passed straight through.
+///
+/// The default Vorbis window and spectrum scaling are DeepFilterNet's own, so the features match
+/// the ones the models were trained on.
+///
+/// **Thread Safety**: Not thread-safe. A StreamingSTFT belongs to one stream and is used by one
+/// thread at a time; DeepFilterNet only touches it on its processing queue.
+final class StreamingSTFT {
+    let frameSize: Int
+    let hopSize: Int
+    let binCount: Int
+
+    private let stft: UnsafeMutablePointer<VocanaSTFT>
+
+    init(frameSize: Int = AppConstants.fftSize, hopSize: Int = AppConstants.hopSize, window: VocanaSTFTWindow = kVocanaSTFT_Vorbis) {
+        precondition(frameSize > 0 && frameSize <= Int(kVocanaFFT_MaxSize),
+                    "Frame size must be in range [1, \(kVocanaFFT_MaxSize)], got \(frameSize)")
+        precondition(hopSize > 0 && frameSize % hopSize == 0,
+                    "Hop size must divide the frame size, got hopSize=\(hopSize), frameSize=\(frameSize)")
+
+        self.stft = UnsafeMutablePointer<VocanaSTFT>.allocate(capacity: 1)
+        let status = VocanaSTFT_Init(stft, UInt32(frameSize), UInt32(hopSize), window)
+        guard status == 0 else {
+            stft.deallocate()
+            preconditionFailure("VocanaSTFT_Init failed with \(status) for frameSize=\(frameSize), hopSize=\(hopSize)")
+        }
+
+        self.frameSize = frameSize
+        self.hopSize = hopSize
+        self.binCount = frameSize / 2 + 1
+    }
+
+    deinit {
+        VocanaSTFT_Teardown(stft)
+        stft.deallocate()
+    }
+
+    /// How many samples the synthesized output is behind the analyzed input
+    var latency: Int {
+        return Int(VocanaSTFT_GetLatency(stft))
+    }
+
+    /// Forget the audio seen so far, as at the start of a new stream
+    func reset() {
+        VocanaSTFT_Reset(stft)
+    }
+
+    /// Analyze the next hop
+    /// - Parameters:
+    ///   - hop: `hopSize` new samples
+    ///   - real: Receives the real parts of `binCount` bins
+    ///   - imag: Receives the imaginary parts of `binCount` bins
+    func analyze(_ hop: UnsafePointer<Float>, real: UnsafeMutablePointer<Float>, imag: UnsafeMutablePointer<Float>) {
+        VocanaSTFT_Analyze(stft, hop, real, imag)
+    }
+
+    /// Overlap-add the frame of a spectrum and return the next hop
+    /// - Parameters:
+    ///   - real: Real parts of `binCount` bins
+    ///   - imag: Imaginary parts of `binCount` bins
+    ///   - hop: Receives `hopSize` output samples
+    func synthesize(real: UnsafePointer<Float>, imag: UnsafePointer<Float>, into hop: UnsafeMutablePointer<Float>) {
+        VocanaSTFT_Synthesize(stft, real, imag, hop)
+    }
+}
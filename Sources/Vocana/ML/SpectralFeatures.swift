@@ -21,13 +21,17 @@ enum SpectralFeaturesError: Error, LocalizedError {
 /// Extracts first N frequency bins with unit normalization
 ///
 /// **Thread Safety**: This class is thread-safe. All methods are stateless after initialization.
-/// Safe to call from multiple threads simultaneously.
+/// Safe to call from multiple threads simultaneously, on different Spectrograms.
 ///
 /// **Usage Example**:
 /// ```swift
 /// let spectral = SpectralFeatures(dfBands: 96, sampleRate: 48000, fftSize: 960)
 /// let features = spectral.extract(spectrogramReal: real, spectrogramImag: imag)
 /// let normalized = spectral.normalize(features, alpha: 0.6)
+///
+/// // Or between Spectrograms: `features` is then the [1, 2, T, 96] model input as it stands
+/// try spectral.extract(spectrum, into: features)
+/// spectral.normalize(features, alpha: 0.6)
 /// ```
 final class SpectralFeatures {
     // MARK: - Configuration
@@ -137,10 +141,35 @@ final class SpectralFeatures {
         return spectralFeatures
     }
     
+    /// Extract the first `dfBands` bins of every frame of a spectrogram into the rows of another
+    /// - Parameters:
+    ///   - spectrum: Complex spectrogram [numFrames, numBins]
+    ///   - features: Complex spectrogram of `dfBands` bins; its frame count is set to the spectrum's.
+    ///     Its planes are the model's [1, 2, numFrames, dfBands] input.
+    /// - Throws: SpectralFeaturesError if the spectrum has fewer than `dfBands` bins
+    func extract(_ spectrum: Spectrogram, into features: Spectrogram) throws {
+        precondition(spectrum.isComplex && features.isComplex && features.binCount == dfBands,
+                    "Spectral features go from a complex spectrogram into a complex one of \(dfBands) bins, got \(features.binCount)")
+        
+        guard spectrum.binCount >= dfBands else {
+            Self.logger.error("Spectrogram has \(spectrum.binCount) bins - Cannot extract \(self.dfBands) bands")
+            throw SpectralFeaturesError.invalidInput("Insufficient frequency bins: need \(dfBands), have \(spectrum.binCount)")
+        }
+        
+        features.frameCount = spectrum.frameCount
+        for frame in 0..<spectrum.frameCount {
+            features.real(frame).update(from: spectrum.real(frame), count: dfBands)
+            features.imag(frame).update(from: spectrum.imag(frame), count: dfBands)
+        }
+    }
+    
     // MARK: - Normalization
     
     /// Apply unit normalization to spectral features
     /// Normalizes across the complex spectrum
+    ///
+    /// Each frame is normalized on its own, with nothing kept between calls. A stream's running
+    /// normalization, carried from one call to the next, is FeatureNormalizer.
     /// - Parameters:
     ///   - features: Input features [numFrames, 2, dfBands]
     ///   - alpha: Normalization parameter
@@ -162,94 +191,103 @@ final class SpectralFeatures {
         var normalized: [[[Float]]] = []
         normalized.reserveCapacity(features.count)
         
-        // Fix CRITICAL: Allocate buffers per-frame to avoid race condition with variable sizes
-        // Previous approach reused buffers which could cause data corruption if frame sizes differ
-        
         // Pre-allocate empty result for error cases to prevent memory allocation in error paths
         let emptyFrameResult = [[Float](), [Float]()]
         
         for frame in features {
-            let realPart = frame[0]
-            let imagPart = frame[1]
+            var realPart = frame[0]
+            var imagPart = frame[1]
             
             // Fix CRITICAL: Validate dimensions before any buffer allocation to prevent memory leak
-            guard !realPart.isEmpty, 
-                  !imagPart.isEmpty, 
-                  realPart.count == imagPart.count,
-                  realPart.count < Int32.max else {
+            guard realPart.count == imagPart.count, realPart.count < Int32.max else {
                 Self.logger.error("Invalid frame dimensions: real=\(realPart.count), imag=\(imagPart.count)")
                 // Use pre-allocated empty result to avoid allocation in error path
                 normalized.append(emptyFrameResult)
                 continue
             }
             
-            // Allocate fresh buffers for this frame only after validation
-            let frameSize = realPart.count
-            var magnitudeBuffer = [Float](repeating: 0, count: frameSize)
-            var realSquaredBuffer = [Float](repeating: 0, count: frameSize)
-            var imagSquaredBuffer = [Float](repeating: 0, count: frameSize)
-            var normalizedRealBuffer = [Float](repeating: 0, count: frameSize)
-            var normalizedImagBuffer = [Float](repeating: 0, count: frameSize)
-            
-            let length = vDSP_Length(realPart.count)
-            
-            // Calculate magnitude using Accelerate (vectorized)
-            vDSP_vsq(realPart, 1, &realSquaredBuffer, 1, length)
-            vDSP_vsq(imagPart, 1, &imagSquaredBuffer, 1, length)
-            vDSP_vadd(realSquaredBuffer, 1, imagSquaredBuffer, 1, &magnitudeBuffer, 1, length)
-            
-            // Fix CRITICAL: Replace preconditionFailure with recoverable error handling
-            guard magnitudeBuffer.allSatisfy({ $0.isFinite && $0 >= 0 }) else {
-                Self.logger.error("Invalid magnitude buffer (NaN/Inf/negative)")
-                // Use pre-allocated empty result to prevent allocation in error path
-                normalized.append(emptyFrameResult)
-                continue
-            }
-            var count = Int32(realPart.count)
-            var sqrtResult = [Float](repeating: 0, count: realPart.count)
-            vvsqrtf(&sqrtResult, magnitudeBuffer, &count)
-            
-            // Calculate mean magnitude using vDSP
-            var meanMag: Float = 0
-            vDSP_meanv(sqrtResult, 1, &meanMag, vDSP_Length(sqrtResult.count))
-            
-            // Fix MEDIUM: Vectorized variance calculation
-            let meanSquared = meanMag * meanMag
-            var magSquared = [Float](repeating: 0, count: sqrtResult.count)
-            vDSP_vsq(sqrtResult, 1, &magSquared, 1, vDSP_Length(sqrtResult.count))
-            
-            var sumMagSquared: Float = 0
-            vDSP_sve(magSquared, 1, &sumMagSquared, vDSP_Length(magSquared.count))
-            
-            let variance = (sumMagSquared / Float(sqrtResult.count)) - meanSquared
-            
-            // Fix HIGH: Don't fail on invalid variance - use epsilon fallback to maintain frame count
-            let epsilon: Float = 1e-6
-            let validVariance: Float
-            if variance.isNaN || variance.isInfinite || variance < 0 {
-                Self.logger.error("Invalid variance: \(variance), using epsilon fallback")
-                validVariance = epsilon
-            } else {
-                validVariance = variance
+            let succeeded = realPart.withUnsafeMutableBufferPointer { realBuffer in
+                imagPart.withUnsafeMutableBufferPointer { imagBuffer in
+                    Self.normalizeRow(real: realBuffer.baseAddress!, imag: imagBuffer.baseAddress!, count: realBuffer.count, alpha: alpha)
+                }
             }
-            
-            let std = sqrt(max(validVariance, epsilon))
-            
-            // Fix MEDIUM: Remove redundant NaN/Inf check after epsilon
-            // std is guaranteed valid after sqrt(max(...))
-            
-            // Fix CRITICAL #8: Combine normalization and alpha scaling in single operation for clarity
-            // Normalize and scale: (x / std) * alpha = x * (alpha / std)
-            var scale = alpha / max(std, epsilon)
-            vDSP_vsmul(realPart, 1, &scale, &normalizedRealBuffer, 1, vDSP_Length(realPart.count))
-            vDSP_vsmul(imagPart, 1, &scale, &normalizedImagBuffer, 1, vDSP_Length(imagPart.count))
-            
-            normalized.append([Array(normalizedRealBuffer), Array(normalizedImagBuffer)])
+            normalized.append(succeeded ? [realPart, imagPart] : emptyFrameResult)
         }
         
         return normalized
     }
     
+    /// Apply unit normalization to every frame of a spectrogram of features, in place
+    ///
+    /// A frame with values that aren't finite is zeroed, so the features keep their shape.
+    ///
+    /// - Parameters:
+    ///   - features: Complex spectrogram [numFrames, dfBands]
+    ///   - alpha: Normalization parameter
+    func normalize(_ features: Spectrogram, alpha: Float = 0.6) {
+        // Fix MEDIUM: Validate alpha parameter
+        precondition(alpha > 0 && alpha <= 10, "Alpha must be in range (0, 10], got \(alpha)")
+        precondition(features.isComplex, "Spectral features are complex")
+        
+        for frame in 0..<features.frameCount {
+            let real = features.real(frame)
+            let imag = features.imag(frame)
+            if !Self.normalizeRow(real: real, imag: imag, count: features.binCount, alpha: alpha) {
+                real.update(repeating: 0, count: features.binCount)
+                imag.update(repeating: 0, count: features.binCount)
+            }
+        }
+    }
+    
+    /// Unit normalization of one complex frame in place: x * alpha / std(|x|)
+    /// - Returns: false, leaving the frame as it was, if it has values that aren't finite
+    private static func normalizeRow(real: UnsafeMutablePointer<Float>, imag: UnsafeMutablePointer<Float>, count: Int, alpha: Float) -> Bool {
+        let length = vDSP_Length(count)
+        
+        // Second moment of the magnitudes straight from the parts: mean(|x|^2) = mean(re^2 + im^2)
+        var sumRealSquared: Float = 0
+        var sumImagSquared: Float = 0
+        vDSP_svesq(real, 1, &sumRealSquared, length)
+        vDSP_svesq(imag, 1, &sumImagSquared, length)
+        let meanMagSquared = (sumRealSquared + sumImagSquared) / Float(count)
+        
+        // Fix CRITICAL: Replace preconditionFailure with recoverable error handling
+        guard meanMagSquared.isFinite else {
+            logger.error("Invalid magnitude buffer (NaN/Inf/negative)")
+            return false
+        }
+        
+        // The mean magnitude needs the magnitudes themselves, one row of scratch on the stack
+        let meanMag: Float = withUnsafeTemporaryAllocation(of: Float.self, capacity: count) { magnitude in
+            var split = DSPSplitComplex(realp: real, imagp: imag)
+            vDSP_zvabs(&split, 1, magnitude.baseAddress!, 1, length)
+            var mean: Float = 0
+            vDSP_meanv(magnitude.baseAddress!, 1, &mean, length)
+            return mean
+        }
+        
+        let variance = meanMagSquared - meanMag * meanMag
+        
+        // Fix HIGH: Don't fail on invalid variance - use epsilon fallback to maintain frame count
+        let epsilon: Float = 1e-6
+        let validVariance: Float
+        if variance.isNaN || variance.isInfinite || variance < 0 {
+            logger.error("Invalid variance: \(variance), using epsilon fallback")
+            validVariance = epsilon
+        } else {
+            validVariance = variance
+        }
+        
+        let std = sqrt(max(validVariance, epsilon))
+        
+        // Fix CRITICAL #8: Combine normalization and alpha scaling in single operation for clarity
+        // Normalize and scale: (x / std) * alpha = x * (alpha / std)
+        var scale = alpha / max(std, epsilon)
+        vDSP_vsmul(real, 1, &scale, real, 1, length)
+        vDSP_vsmul(imag, 1, &scale, imag, 1, length)
+        return true
+    }
+    
     // MARK: - Utilities
     
     /// Get frequency range covered by DF bands (cached)
@@ -0,0 +1,158 @@
+import Foundation
+import VocanaDSP
+
+/// Frames × bins of split complex or real values in one aligned block, on the native VocanaSpectrogram
+///
+/// The pipeline's stages used to hand each other nested arrays, a heap array per frame per stage,
+/// flattened again for every tensor. A Spectrogram holds the real parts of every frame followed
+/// by the imaginary parts of every frame in one 64-byte-aligned allocation, each frame
+/// `frameStride` floats after the one before, and the STFT, the features and the filtering read
+/// and write its rows where they are.
+///
+/// Blocks whose bins fill their rows (`isDense`), such as the 32 ERB bands and the 96 deep
+/// filtering bins, are laid out exactly as the models' [1, 1, T, 32] and [1, 2, T, 96] inputs:
+/// `planes` is the input as it stands, for the C bridge to wrap in place, and `tensor(shape:)`
+/// gives it to ONNXModel in one copy.
+///
+/// `frameCount` can change without allocating up to the most frames the spectrogram has held, so
+/// one spectrogram serves windows of any length from call to call. Pointers from `real(_:)`,
+/// `imag(_:)` and `planes` are good until the frame count next changes.
+///
+/// **Thread Safety**: Not thread-safe. A Spectrogram is used by one thread at a time.
+final class Spectrogram {
+    private let storage: UnsafeMutablePointer<VocanaSpectrogram>
+
+    /// - Parameters:
+    ///   - frameCount: Frames, zeroed
+    ///   - binCount: Values per frame
+    ///   - complex: Whether there is an imaginary plane
+    ///   - frameCapacity: Frames to make room for up front
+    init(frameCount: Int, binCount: Int, complex: Bool = true, frameCapacity: Int = 0) {
+        precondition(frameCount >= 0 && frameCount <= Int(kVocanaSpectrogram_MaxFrames),
+                    "Frame count must be in range [0, \(kVocanaSpectrogram_MaxFrames)], got \(frameCount)")
+        precondition(frameCapacity >= 0 && frameCapacity <= Int(kVocanaSpectrogram_MaxFrames),
+                    "Frame capacity must be in range [0, \(kVocanaSpectrogram_MaxFrames)], got \(frameCapacity)")
+        precondition(binCount > 0 && binCount <= Int(kVocanaSpectrogram_MaxBins),
+                    "Bin count must be in range [1, \(kVocanaSpectrogram_MaxBins)], got \(binCount)")
+
+        self.storage = UnsafeMutablePointer<VocanaSpectrogram>.allocate(capacity: 1)
+        let status = VocanaSpectrogram_Init(storage, UInt32(frameCount), UInt32(frameCapacity), UInt32(binCount), complex ? 2 : 1)
+        guard status == 0 else {
+            storage.deallocate()
+            preconditionFailure("VocanaSpectrogram_Init failed with \(status) for \(frameCount) frames of \(binCount) bins")
+        }
+    }
+
+    /// A copy of a nested spectrogram, one array per frame
+    convenience init(real: [[Float]], imag: [[Float]]?, binCount: Int) {
+        self.init(frameCount: real.count, binCount: binCount, complex: imag != nil)
+        for (frame, values) in real.enumerated() {
+            copy(values, into: self.real(frame))
+        }
+        if let imag = imag {
+            for (frame, values) in imag.enumerated() where frame < frameCount {
+                copy(values, into: self.imag(frame))
+            }
+        }
+    }
+
+    deinit {
+        VocanaSpectrogram_Teardown(storage)
+        storage.deallocate()
+    }
+
+    // MARK: - Shape
+
+    /// Number of frames. Raising it past the capacity allocates; new frames are zeroed.
+    var frameCount: Int {
+        get { Int(storage.pointee.frameCount) }
+        set {
+            precondition(newValue >= 0 && newValue <= Int(kVocanaSpectrogram_MaxFrames),
+                        "Frame count must be in range [0, \(kVocanaSpectrogram_MaxFrames)], got \(newValue)")
+            if newValue > frameCapacity {
+                // Room for some growth, so windows creeping up in length don't allocate every call
+                let capacity = min(max(newValue, frameCapacity * 2), Int(kVocanaSpectrogram_MaxFrames))
+                let status = VocanaSpectrogram_Reserve(storage, UInt32(capacity))
+                precondition(status == 0, "VocanaSpectrogram_Reserve failed with \(status) for \(capacity) frames")
+            }
+            VocanaSpectrogram_SetFrameCount(storage, UInt32(newValue))
+        }
+    }
+
+    /// Frames there is room for without allocating
+    var frameCapacity: Int {
+        return Int(storage.pointee.frameCapacity)
+    }
+
+    /// Values per frame
+    var binCount: Int {
+        return Int(storage.pointee.binCount)
+    }
+
+    /// Floats from the start of one frame to the start of the next
+    var frameStride: Int {
+        return Int(storage.pointee.frameStride)
+    }
+
+    /// Whether there is an imaginary plane
+    var isComplex: Bool {
+        return storage.pointee.planeCount == 2
+    }
+
+    /// Whether the rows have no padding, so `planes` is a dense [planes, frames, bins] array
+    var isDense: Bool {
+        return VocanaSpectrogram_IsDense(storage)
+    }
+
+    // MARK: - Access
+
+    /// Real parts of a frame, `binCount` values
+    func real(_ frame: Int) -> UnsafeMutablePointer<Float> {
+        precondition(frame >= 0 && frame < frameCount, "Frame \(frame) out of range [0, \(frameCount))")
+        return VocanaSpectrogram_Real(storage, UInt32(frame))
+    }
+
+    /// Imaginary parts of a frame, `binCount` values
+    func imag(_ frame: Int) -> UnsafeMutablePointer<Float> {
+        precondition(isComplex, "Spectrogram has no imaginary plane")
+        precondition(frame >= 0 && frame < frameCount, "Frame \(frame) out of range [0, \(frameCount))")
+        return VocanaSpectrogram_Imaginary(storage, UInt32(frame))
+    }
+
+    /// Every plane, the imaginary one straight after the real one
+    var planes: UnsafeMutableBufferPointer<Float> {
+        let count = Int(storage.pointee.planeCount) * VocanaSpectrogram_GetPlaneSize(storage)
+        return UnsafeMutableBufferPointer(start: storage.pointee.real, count: count)
+    }
+
+    /// Zero every frame
+    func clear() {
+        VocanaSpectrogram_Clear(storage)
+    }
+
+    // MARK: - Conversion
+
+    /// The planes as a model input of the given shape, which has to hold exactly the planes
+    func tensor(shape: [Int]) -> Tensor {
+        precondition(isDense, "Only a dense spectrogram is a tensor, \(binCount) bins are padded to \(frameStride)")
+        precondition(shape.reduce(1, *) == planes.count, "Shape \(shape) doesn't hold \(planes.count) values")
+        return Tensor(shape: shape, data: Array(planes))
+    }
+
+    /// The frames as nested arrays, one per frame
+    var nestedReal: [[Float]] {
+        return (0..<frameCount).map { Array(UnsafeBufferPointer(start: real($0), count: binCount)) }
+    }
+
+    /// The imaginary parts as nested arrays, one per frame
+    var nestedImag: [[Float]] {
+        return (0..<frameCount).map { Array(UnsafeBufferPointer(start: imag($0), count: binCount)) }
+    }
+
+    private func copy(_ values: [Float], into row: UnsafeMutablePointer<Float>) {
+        values.withUnsafeBufferPointer { buffer in
+            guard let base = buffer.baseAddress else { return }
+            row.update(from: base, count: min(buffer.count, binCount))
+        }
+    }
+}
@@ -10,6 +10,7 @@ import OSLog
 
 // Import XPC framework
 import XPC
+import VocanaAudioTransport
 
 /// XPC Service for audio processing
 /// Provides secure inter-process communication between HAL plugin and Swift ML processing
@@ -18,6 +19,9 @@ class AudioProcessingXPCService: NSObject {
     private let audioProcessor: MLAudioProcessor
     private var xpcConnection: xpc_connection_t?
 
+    /// Thread serving the HAL plugin's shared-memory transport, once it has attached one
+    private var transportThread: Thread?
+
     init(audioProcessor: MLAudioProcessor) {
         self.audioProcessor = audioProcessor
         super.init()
@@ -29,6 +33,8 @@ class AudioProcessingXPCService: NSObject {
     }
 
     func stop() {
+        transportThread?.cancel()
+        transportThread = nil
         if let connection = xpcConnection {
             xpc_connection_cancel(connection)
             xpcConnection = nil
@@ -78,6 +84,11 @@ class AudioProcessingXPCService: NSObject {
             return
         }
 
+        if let type = xpc_dictionary_get_string(message, "type"), String(cString: type) == "attachTransport" {
+            attachTransport(message: message, connection: connection)
+            return
+        }
+
         // Extract audio data from message with validation
         var bufferSize: size_t = 0
         let audioPtr = xpc_dictionary_get_data(message, "audioData", &bufferSize)
@@ -158,6 +169,181 @@ class AudioProcessingXPCService: NSObject {
         }
     }
     
+    // MARK: - Shared-Memory Transport
+
+    /// The plugin sends its audio through shared memory rather than one XPC message per IO cycle;
+    /// this message only carries the descriptors of the region and of its wakeups.
+    private func attachTransport(message: xpc_object_t, connection: xpc_connection_t) {
+        var descriptors = VocanaAudioTransportDescriptors(
+            memoryFD: xpc_dictionary_dup_fd(message, "memory"),
+            requestBellFD: xpc_dictionary_dup_fd(message, "requestBell"),
+            replyBellFD: xpc_dictionary_dup_fd(message, "replyBell")
+        )
+        let sampleRate = xpc_dictionary_get_double(message, "sampleRate")
+
+        let transport = UnsafeMutablePointer<VocanaAudioTransport>.allocate(capacity: 1)
+        var status = VocanaAudioTransport_Attach(transport, &descriptors)
+        if status == 0 && !(sampleRate > 0 && sampleRate <= 192000) {
+            VocanaAudioTransport_Teardown(transport)
+            status = EINVAL
+        }
+
+        // The plugin only trusts a reply that names the transport it currently has, so a reply
+        // that arrives after the plugin replaced the transport is ignored.
+        if let reply = xpc_dictionary_create_reply(message) {
+            xpc_dictionary_set_int64(reply, "status", Int64(status))
+            xpc_dictionary_set_uint64(reply, "generation", xpc_dictionary_get_uint64(message, "generation"))
+            xpc_connection_send_message(connection, reply)
+        }
+
+        guard status == 0 else {
+            logger.error("Failed to attach audio transport: \(status)")
+            transport.deallocate()
+            return
+        }
+
+        // A plugin that reconnects brings a new transport; the old thread exits on its own
+        // once the old plugin end is gone, or here.
+        transportThread?.cancel()
+        let thread = Thread { [weak self] in
+            self?.serveTransport(transport, sampleRate: sampleRate)
+            VocanaAudioTransport_Teardown(transport)
+            transport.deallocate()
+        }
+        thread.name = "com.vocana.AudioTransport"
+        thread.qualityOfService = .userInteractive
+        transportThread = thread
+        thread.start()
+        logger.info("Audio transport attached")
+    }
+
+    /// Processes requests one at a time, so this thread is the only one that replies.
+    private func serveTransport(_ transport: UnsafeMutablePointer<VocanaAudioTransport>, sampleRate: Double) {
+        let sampleCount = Int(transport.pointee.maxFrames * transport.pointee.channelCount)
+        var frames = [Float](repeating: 0, count: sampleCount)
+        var request = VocanaAudioTransportRequest()
+
+        // The models only run at AppConstants.sampleRate; a device at any other rate is
+        // converted on the way to them and back
+        let modelRate = Double(AppConstants.sampleRate)
+        var converter: TransportRateConverter?
+        if sampleRate != modelRate {
+            converter = TransportRateConverter(deviceRate: sampleRate, modelRate: modelRate, maxFrames: transport.pointee.maxFrames, channelCount: transport.pointee.channelCount)
+            if converter == nil {
+                logger.error("No rate conversion from \(sampleRate) Hz; processing at the device rate")
+            }
+        }
+
+        while !Thread.current.isCancelled {
+            let result = frames.withUnsafeMutableBufferPointer { buffer in
+                VocanaAudioTransport_Receive(transport, &request, buffer.baseAddress, 100_000_000)
+            }
+            if result == ETIMEDOUT {
+                continue
+            }
+            guard result == 0 else {
+                logger.info("Audio transport closed: \(result)")
+                return
+            }
+
+            let count = Int(request.frameCount * transport.pointee.channelCount)
+            let input = Array(frames[0..<count])
+            let output: [Float]
+            if let converter = converter {
+                let processed = processSynchronously(converter.toModelRate(input), sampleRate: modelRate)
+                output = converter.fromModelRate(processed, frameCount: Int(request.frameCount))
+            } else {
+                output = processSynchronously(input, sampleRate: sampleRate)
+            }
+            let reply = output.count == count ? output : input
+            _ = reply.withUnsafeBufferPointer { buffer in
+                VocanaAudioTransport_Reply(transport, &request, buffer.baseAddress)
+            }
+        }
+    }
+
+    /// Streams the transport's audio to the models' rate and back with a pair of VocanaResamplers,
+    /// keeping their filter history from one request to the next. Owned by the transport thread.
+    private final class TransportRateConverter {
+        /// The frames converted back for a request vary by a frame or so around the request's
+        /// frame count; this much silence up front always leaves a whole reply ready.
+        private static let primingFrames = 4
+
+        private let channelCount: Int
+        private var down = VocanaResampler()
+        private var up = VocanaResampler()
+        private var pending: [Float]
+
+        init?(deviceRate: Double, modelRate: Double, maxFrames: UInt32, channelCount: UInt32) {
+            self.channelCount = Int(channelCount)
+            self.pending = [Float](repeating: 0, count: Self.primingFrames * Int(channelCount))
+
+            // The windowed sinc first, the linear fallback for rates it has no table for
+            var quality = kVocanaResampler_Sinc
+            if VocanaResampler_Init(&down, deviceRate, modelRate, channelCount, maxFrames, quality) != 0 {
+                quality = kVocanaResampler_Linear
+                guard VocanaResampler_Init(&down, deviceRate, modelRate, channelCount, maxFrames, quality) == 0 else {
+                    return nil
+                }
+            }
+            let maxConverted = VocanaResampler_GetMaxOutputFrameCount(&down, maxFrames)
+            guard VocanaResampler_Init(&up, modelRate, deviceRate, channelCount, maxConverted, quality) == 0 else {
+                VocanaResampler_Teardown(&down)
+                return nil
+            }
+        }
+
+        deinit {
+            VocanaResampler_Teardown(&down)
+            VocanaResampler_Teardown(&up)
+        }
+
+        func toModelRate(_ input: [Float]) -> [Float] {
+            let frameCount = UInt32(input.count / channelCount)
+            var output = [Float](repeating: 0, count: Int(VocanaResampler_GetOutputFrameCount(&down, frameCount)) * channelCount)
+            input.withUnsafeBufferPointer { inBuffer in
+                output.withUnsafeMutableBufferPointer { outBuffer in
+                    _ = VocanaResampler_Process(&down, inBuffer.baseAddress, frameCount, outBuffer.baseAddress)
+                }
+            }
+            return output
+        }
+
+        func fromModelRate(_ processed: [Float], frameCount: Int) -> [Float] {
+            let processedFrames = min(UInt32(processed.count / channelCount), up.maxInputFrames)
+            var output = [Float](repeating: 0, count: Int(VocanaResampler_GetOutputFrameCount(&up, processedFrames)) * channelCount)
+            processed.withUnsafeBufferPointer { inBuffer in
+                output.withUnsafeMutableBufferPointer { outBuffer in
+                    _ = VocanaResampler_Process(&up, inBuffer.baseAddress, processedFrames, outBuffer.baseAddress)
+                }
+            }
+            pending.append(contentsOf: output)
+
+            let count = frameCount * channelCount
+            if pending.count < count {
+                pending.append(contentsOf: [Float](repeating: 0, count: count - pending.count))
+            }
+            let reply = Array(pending[0..<count])
+            pending.removeFirst(count)
+            return reply
+        }
+    }
+
+    private final class ProcessedBuffer: @unchecked Sendable {
+        var samples: [Float] = []
+    }
+
+    private func processSynchronously(_ input: [Float], sampleRate: Double) -> [Float] {
+        let result = ProcessedBuffer()
+        let done = DispatchSemaphore(value: 0)
+        Task { @MainActor in
+            result.samples = (try? await self.audioProcessor.processAudioBuffer(input, sampleRate: Float(sampleRate))) ?? input
+            done.signal()
+        }
+        done.wait()
+        return result.samples
+    }
+
     @MainActor
     private func sendSuccessResponse(message: xpc_object_t, connection: xpc_connection_t, data: Data) {
         guard let reply = xpc_dictionary_create_reply(message) else {
@@ -0,0 +1,689 @@
+/*
+     File: VocanaAudioTransport.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Shared-memory audio transport between the HAL plug-in and the app's processing service.
+
+ */
+/*==================================================================================================
+	VocanaAudioTransport.c
+==================================================================================================*/
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include "VocanaAudioTransport.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+//	a doorbell rung after the other side has gone must fail with EPIPE rather than raise SIGPIPE
+#if defined(MSG_NOSIGNAL)
+#define kTransport_SendFlags        MSG_NOSIGNAL
+#else
+#define kTransport_SendFlags        0
+#endif
+
+#define kTransport_Magic            0x56415450u     //	'VATP'
+#define kTransport_Version          1u
+#define kTransport_CacheLineSize    64
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Shared Layout
+//==================================================================================================
+
+//	Everything in the region is written by exactly one side: head and the slots by the producer,
+//	tail and consumerAsleep by the consumer. The cursors count slots from the start and are
+//	masked when they index the ring.
+typedef struct VocanaAudioTransportQueue
+{
+	_Alignas(kTransport_CacheLineSize) _Atomic uint64_t     head;
+	_Alignas(kTransport_CacheLineSize) _Atomic uint64_t     tail;
+	_Atomic uint32_t                                        consumerAsleep;
+} VocanaAudioTransportQueue;
+
+struct VocanaAudioTransportShared
+{
+	//	written once by Create, checked by Attach
+	uint32_t                    magic;
+	uint32_t                    version;
+	uint32_t                    headerBytes;
+	uint32_t                    channelCount;
+	uint32_t                    maxFrames;
+	uint32_t                    slotCount;
+	uint32_t                    slotBytes;
+	uint64_t                    regionBytes;
+
+	VocanaAudioTransportQueue   requests;
+	VocanaAudioTransportQueue   replies;
+};
+
+typedef struct VocanaAudioTransportSlot
+{
+	uint64_t                    sequence;
+	uint64_t                    sampleTime;
+	uint32_t                    frameCount;
+	uint32_t                    reserved;
+	float                       frames[];
+} VocanaAudioTransportSlot;
+
+static size_t transport_round_up(size_t inValue, size_t inMultiple)
+{
+	return (inValue + inMultiple - 1) / inMultiple * inMultiple;
+}
+
+static uint32_t transport_slot_bytes(uint32_t inChannelCount, uint32_t inMaxFrames)
+{
+	return (uint32_t)transport_round_up(sizeof(VocanaAudioTransportSlot) + (size_t)inChannelCount * inMaxFrames * sizeof(float), kTransport_CacheLineSize);
+}
+
+static size_t transport_header_bytes(void)
+{
+	return transport_round_up(sizeof(VocanaAudioTransportShared), kTransport_CacheLineSize);
+}
+
+static size_t transport_region_bytes(uint32_t inSlotBytes, uint32_t inSlotCount)
+{
+	size_t thePageSize = (size_t)sysconf(_SC_PAGESIZE);
+	return transport_round_up(transport_header_bytes() + 2 * (size_t)inSlotBytes * inSlotCount, thePageSize);
+}
+
+static bool transport_layout_is_valid(uint32_t inChannelCount, uint32_t inMaxFrames, uint32_t inSlotCount)
+{
+	return inChannelCount != 0 && inChannelCount <= 64 &&
+	       inMaxFrames != 0 && inMaxFrames <= 65536 &&
+	       inSlotCount >= 2 && inSlotCount <= kVocanaAudioTransport_MaxSlots && (inSlotCount & (inSlotCount - 1)) == 0;
+}
+
+static VocanaAudioTransportSlot* transport_slot(uint8_t* inSlots, uint32_t inSlotBytes, uint32_t inSlotCount, uint64_t inIndex)
+{
+	return (VocanaAudioTransportSlot*)(inSlots + (size_t)(inIndex & (inSlotCount - 1)) * inSlotBytes);
+}
+
+static void transport_map_slots(VocanaAudioTransport* ioTransport)
+{
+	uint8_t* theBase = (uint8_t*)ioTransport->shared;
+	ioTransport->requestSlots = theBase + transport_header_bytes();
+	ioTransport->replySlots = ioTransport->requestSlots + (size_t)ioTransport->slotBytes * ioTransport->slotCount;
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Shared Memory
+//==================================================================================================
+
+//	The object is unlinked as soon as it is open, so the name is only ever visible for a moment
+//	and the memory goes away with the last descriptor and mapping.
+static int transport_create_memory(size_t inBytes, int* outFD)
+{
+	static _Atomic uint32_t sNameCounter = 0;
+
+	int theFD = -1;
+	for(int theAttempt = 0; theAttempt < 16 && theFD < 0; theAttempt++)
+	{
+		char theName[32];
+		snprintf(theName, sizeof(theName), "/vocana.%d.%u", (int)getpid(), atomic_fetch_add(&sNameCounter, 1));
+		theFD = shm_open(theName, O_RDWR | O_CREAT | O_EXCL, 0600);
+		if(theFD >= 0)
+		{
+			shm_unlink(theName);
+		}
+		else if(errno != EEXIST)
+		{
+			return errno;
+		}
+	}
+	if(theFD < 0)
+	{
+		return EEXIST;
+	}
+
+	if(ftruncate(theFD, (off_t)inBytes) != 0)
+	{
+		int theError = errno;
+		close(theFD);
+		return theError;
+	}
+	fcntl(theFD, F_SETFD, FD_CLOEXEC);
+	*outFD = theFD;
+	return 0;
+}
+
+static int transport_map_memory(int inFD, size_t inBytes, void** outRegion)
+{
+	void* theRegion = mmap(NULL, inBytes, PROT_READ | PROT_WRITE, MAP_SHARED, inFD, 0);
+	if(theRegion == MAP_FAILED)
+	{
+		return errno;
+	}
+	*outRegion = theRegion;
+	return 0;
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Doorbells
+//==================================================================================================
+
+//	Each doorbell is a socket pair, one end for each side, rung one way only: the producer writes
+//	a byte to [1] and the consumer reads it from [0]. Each side holds only its own end, so once
+//	every copy of one end has been closed, the other end reads end-of-file. That is how a side
+//	learns that its peer has gone. An eventfd would be cheaper, but both sides would hold the same
+//	descriptor, so it could never tell them that.
+static int transport_bell_open(int outBell[2])
+{
+	if(socketpair(AF_UNIX, SOCK_STREAM, 0, outBell) != 0)
+	{
+		return errno;
+	}
+	for(int i = 0; i < 2; i++)
+	{
+		fcntl(outBell[i], F_SETFL, fcntl(outBell[i], F_GETFL) | O_NONBLOCK);
+		fcntl(outBell[i], F_SETFD, FD_CLOEXEC);
+#if defined(SO_NOSIGPIPE)
+		int theOn = 1;
+		setsockopt(outBell[i], SOL_SOCKET, SO_NOSIGPIPE, &theOn, sizeof(theOn));
+#endif
+	}
+
+	//	select() can't wait on descriptors past FD_SETSIZE
+	if(outBell[0] >= FD_SETSIZE)
+	{
+		close(outBell[0]);
+		close(outBell[1]);
+		outBell[0] = outBell[1] = -1;
+		return EMFILE;
+	}
+	return 0;
+}
+
+static void transport_bell_close(int ioBell[2])
+{
+	for(int i = 0; i < 2; i++)
+	{
+		if(ioBell[i] >= 0)
+		{
+			close(ioBell[i]);
+		}
+	}
+	ioBell[0] = ioBell[1] = -1;
+}
+
+static void transport_bell_ring(int inWriteFD)
+{
+	//	a full socket already has a wakeup pending, so EAGAIN is fine to ignore, and so is EPIPE:
+	//	the consumer finds out its peer is gone from the read side
+	uint8_t theByte = 1;
+	ssize_t theResult = send(inWriteFD, &theByte, 1, kTransport_SendFlags);
+	(void)theResult;
+}
+
+//	Consumes every pending wakeup. Returns EPIPE once every copy of the other end is closed.
+static int transport_bell_drain(int inReadFD)
+{
+	uint8_t theBuffer[64];
+	for(;;)
+	{
+		ssize_t theResult = read(inReadFD, theBuffer, sizeof(theBuffer));
+		if(theResult == 0)
+		{
+			return EPIPE;
+		}
+		if(theResult < 0)
+		{
+			return (errno == EAGAIN || errno == EINTR) ? 0 : errno;
+		}
+	}
+}
+
+static uint64_t transport_now_nanoseconds(void)
+{
+	struct timespec theTime;
+	clock_gettime(CLOCK_MONOTONIC, &theTime);
+	return (uint64_t)theTime.tv_sec * 1000000000ull + (uint64_t)theTime.tv_nsec;
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Queues
+//==================================================================================================
+
+static bool transport_queue_is_empty(VocanaAudioTransportQueue* inQueue)
+{
+	return atomic_load_explicit(&inQueue->head, memory_order_acquire) == atomic_load_explicit(&inQueue->tail, memory_order_relaxed);
+}
+
+static bool transport_queue_is_full(VocanaAudioTransportQueue* inQueue, uint32_t inSlotCount)
+{
+	return atomic_load_explicit(&inQueue->head, memory_order_relaxed) - atomic_load_explicit(&inQueue->tail, memory_order_acquire) >= inSlotCount;
+}
+
+//	Producer side, after the slot at head has been filled.
+static void transport_queue_publish(VocanaAudioTransportQueue* inQueue, int inBellWriteFD)
+{
+	atomic_store_explicit(&inQueue->head, atomic_load_explicit(&inQueue->head, memory_order_relaxed) + 1, memory_order_release);
+
+	//	Pairs with the consumer storing consumerAsleep before it re-checks head: either the
+	//	consumer sees the new head, or this sees it asleep and wakes it.
+	atomic_thread_fence(memory_order_seq_cst);
+	if(atomic_load_explicit(&inQueue->consumerAsleep, memory_order_relaxed) != 0 && atomic_exchange_explicit(&inQueue->consumerAsleep, 0, memory_order_relaxed) != 0)
+	{
+		transport_bell_ring(inBellWriteFD);
+	}
+}
+
+//	Consumer side, after the slot at tail has been emptied.
+static void transport_queue_release(VocanaAudioTransportQueue* inQueue)
+{
+	atomic_store_explicit(&inQueue->tail, atomic_load_explicit(&inQueue->tail, memory_order_relaxed) + 1, memory_order_release);
+}
+
+//	Consumer side. Returns 0 once the queue has something in it, ETIMEDOUT at the deadline or
+//	EPIPE if the producer has gone away.
+static int transport_queue_wait(VocanaAudioTransportQueue* inQueue, int inBellReadFD, uint64_t inDeadline)
+{
+	for(;;)
+	{
+		if(!transport_queue_is_empty(inQueue))
+		{
+			return 0;
+		}
+
+		atomic_store_explicit(&inQueue->consumerAsleep, 1, memory_order_seq_cst);
+		if(atomic_load_explicit(&inQueue->head, memory_order_seq_cst) != atomic_load_explicit(&inQueue->tail, memory_order_relaxed))
+		{
+			atomic_store_explicit(&inQueue->consumerAsleep, 0, memory_order_relaxed);
+			atomic_thread_fence(memory_order_acquire);
+			return 0;
+		}
+
+		uint64_t theNow = transport_now_nanoseconds();
+		if(theNow >= inDeadline)
+		{
+			atomic_store_explicit(&inQueue->consumerAsleep, 0, memory_order_relaxed);
+			return ETIMEDOUT;
+		}
+		uint64_t theWait = inDeadline - theNow;
+		struct timeval theTimeout = { (time_t)(theWait / 1000000000ull), (suseconds_t)((theWait % 1000000000ull + 999) / 1000) };
+		fd_set theReadSet;
+		FD_ZERO(&theReadSet);
+		FD_SET(inBellReadFD, &theReadSet);
+		int theReady = select(inBellReadFD + 1, &theReadSet, NULL, NULL, &theTimeout);
+		atomic_store_explicit(&inQueue->consumerAsleep, 0, memory_order_relaxed);
+		if(theReady > 0)
+		{
+			int theError = transport_bell_drain(inBellReadFD);
+			if(theError != 0)
+			{
+				return theError;
+			}
+		}
+		else if(theReady < 0 && errno != EINTR)
+		{
+			return errno;
+		}
+	}
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Setup
+//==================================================================================================
+
+static void transport_clear(VocanaAudioTransport* outTransport)
+{
+	memset(outTransport, 0, sizeof(*outTransport));
+	outTransport->memoryFD = -1;
+	outTransport->requestBell[0] = outTransport->requestBell[1] = -1;
+	outTransport->replyBell[0] = outTransport->replyBell[1] = -1;
+}
+
+int VocanaAudioTransport_Create(VocanaAudioTransport* outTransport, uint32_t inChannelCount, uint32_t inMaxFrames, uint32_t inSlotCount)
+{
+	transport_clear(outTransport);
+	if(!transport_layout_is_valid(inChannelCount, inMaxFrames, inSlotCount))
+	{
+		return EINVAL;
+	}
+
+	uint32_t theSlotBytes = transport_slot_bytes(inChannelCount, inMaxFrames);
+	size_t theRegionBytes = transport_region_bytes(theSlotBytes, inSlotCount);
+	void* theRegion = NULL;
+	int theError = transport_create_memory(theRegionBytes, &outTransport->memoryFD);
+	if(theError == 0)
+	{
+		theError = transport_map_memory(outTransport->memoryFD, theRegionBytes, &theRegion);
+	}
+	if(theError == 0)
+	{
+		theError = transport_bell_open(outTransport->requestBell);
+	}
+	if(theError == 0)
+	{
+		theError = transport_bell_open(outTransport->replyBell);
+	}
+	if(theError != 0)
+	{
+		if(theRegion != NULL)
+		{
+			munmap(theRegion, theRegionBytes);
+		}
+		VocanaAudioTransport_Teardown(outTransport);
+		return theError;
+	}
+
+	//	ftruncate zero-fills, so the cursors already start at 0
+	VocanaAudioTransportShared* theShared = (VocanaAudioTransportShared*)theRegion;
+	theShared->version = kTransport_Version;
+	theShared->headerBytes = (uint32_t)sizeof(VocanaAudioTransportShared);
+	theShared->channelCount = inChannelCount;
+	theShared->maxFrames = inMaxFrames;
+	theShared->slotCount = inSlotCount;
+	theShared->slotBytes = theSlotBytes;
+	theShared->regionBytes = theRegionBytes;
+	atomic_thread_fence(memory_order_release);
+	theShared->magic = kTransport_Magic;
+
+	outTransport->shared = theShared;
+	outTransport->regionBytes = theRegionBytes;
+	outTransport->slotBytes = theSlotBytes;
+	outTransport->channelCount = inChannelCount;
+	outTransport->maxFrames = inMaxFrames;
+	outTransport->slotCount = inSlotCount;
+	outTransport->nextSequence = 1;
+	transport_map_slots(outTransport);
+	return 0;
+}
+
+void VocanaAudioTransport_GetDescriptors(const VocanaAudioTransport* inTransport, VocanaAudioTransportDescriptors* outDescriptors)
+{
+	outDescriptors->memoryFD = inTransport->memoryFD;
+	outDescriptors->requestBellFD = inTransport->requestBell[0];
+	outDescriptors->replyBellFD = inTransport->replyBell[1];
+}
+
+void VocanaAudioTransport_CloseServiceDescriptors(VocanaAudioTransport* inTransport)
+{
+	if(inTransport->memoryFD >= 0)
+	{
+		close(inTransport->memoryFD);
+		inTransport->memoryFD = -1;
+	}
+
+	if(inTransport->requestBell[0] >= 0)
+	{
+		close(inTransport->requestBell[0]);
+		inTransport->requestBell[0] = -1;
+	}
+	if(inTransport->replyBell[1] >= 0)
+	{
+		close(inTransport->replyBell[1]);
+		inTransport->replyBell[1] = -1;
+	}
+}
+
+int VocanaAudioTransport_Attach(VocanaAudioTransport* outTransport, const VocanaAudioTransportDescriptors* inDescriptors)
+{
+	transport_clear(outTransport);
+	outTransport->isService = true;
+	outTransport->memoryFD = inDescriptors->memoryFD;
+	outTransport->requestBell[0] = inDescriptors->requestBellFD;
+	outTransport->replyBell[1] = inDescriptors->replyBellFD;
+
+	int theError = 0;
+	struct stat theStat;
+	if(inDescriptors->memoryFD < 0 || inDescriptors->requestBellFD < 0 || inDescriptors->replyBellFD < 0 || inDescriptors->requestBellFD >= FD_SETSIZE)
+	{
+		theError = EBADF;
+	}
+	else if(fstat(inDescriptors->memoryFD, &theStat) != 0)
+	{
+		theError = errno;
+	}
+	else if((size_t)theStat.st_size < transport_header_bytes())
+	{
+		theError = EPROTO;
+	}
+
+	//	map the header alone first, so a bogus size in it can't make us map something else
+	void* theRegion = NULL;
+	if(theError == 0)
+	{
+		theError = transport_map_memory(inDescriptors->memoryFD, transport_header_bytes(), &theRegion);
+	}
+	if(theError == 0)
+	{
+		VocanaAudioTransportShared theHeader = *(const VocanaAudioTransportShared*)theRegion;
+		munmap(theRegion, transport_header_bytes());
+		theRegion = NULL;
+
+		if(theHeader.magic != kTransport_Magic || theHeader.version != kTransport_Version ||
+		   theHeader.headerBytes != sizeof(VocanaAudioTransportShared) ||
+		   !transport_layout_is_valid(theHeader.channelCount, theHeader.maxFrames, theHeader.slotCount) ||
+		   theHeader.slotBytes != transport_slot_bytes(theHeader.channelCount, theHeader.maxFrames) ||
+		   theHeader.regionBytes != transport_region_bytes(theHeader.slotBytes, theHeader.slotCount) ||
+		   theHeader.regionBytes > (uint64_t)theStat.st_size)
+		{
+			theError = EPROTO;
+		}
+		else
+		{
+			theError = transport_map_memory(inDescriptors->memoryFD, theHeader.regionBytes, &theRegion);
+		}
+		if(theError == 0)
+		{
+			outTransport->shared = (VocanaAudioTransportShared*)theRegion;
+			outTransport->regionBytes = theHeader.regionBytes;
+			outTransport->slotBytes = theHeader.slotBytes;
+			outTransport->channelCount = theHeader.channelCount;
+			outTransport->maxFrames = theHeader.maxFrames;
+			outTransport->slotCount = theHeader.slotCount;
+			transport_map_slots(outTransport);
+		}
+	}
+
+	if(theError != 0)
+	{
+		VocanaAudioTransport_Teardown(outTransport);
+	}
+	return theError;
+}
+
+void VocanaAudioTransport_Teardown(VocanaAudioTransport* inTransport)
+{
+	if(inTransport->shared != NULL)
+	{
+		munmap(inTransport->shared, inTransport->regionBytes);
+	}
+	if(inTransport->memoryFD >= 0)
+	{
+		close(inTransport->memoryFD);
+	}
+	transport_bell_close(inTransport->requestBell);
+	transport_bell_close(inTransport->replyBell);
+	transport_clear(inTransport);
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Plug-In Side
+//==================================================================================================
+
+static int transport_submit(VocanaAudioTransport* inTransport, uint64_t inSampleTime, const float* inFrames, uint32_t inFrameCount)
+{
+	VocanaAudioTransportQueue* theRequests = &inTransport->shared->requests;
+	if(transport_queue_is_full(theRequests, inTransport->slotCount))
+	{
+		return EAGAIN;
+	}
+	VocanaAudioTransportSlot* theSlot = transport_slot(inTransport->requestSlots, inTransport->slotBytes, inTransport->slotCount, atomic_load_explicit(&theRequests->head, memory_order_relaxed));
+	theSlot->sequence = inTransport->nextSequence++;
+	theSlot->sampleTime = inSampleTime;
+	theSlot->frameCount = inFrameCount;
+	memcpy(theSlot->frames, inFrames, (size_t)inFrameCount * inTransport->channelCount * sizeof(float));
+	transport_queue_publish(theRequests, inTransport->requestBell[1]);
+	return 0;
+}
+
+int VocanaAudioTransport_Process(VocanaAudioTransport* inTransport, uint64_t inSampleTime, float* ioFrames, uint32_t inFrameCount, uint64_t inBudgetNanoseconds)
+{
+	if(inTransport->shared == NULL || inTransport->isService)
+	{
+		return EBADF;
+	}
+	if(inFrameCount == 0 || inFrameCount > inTransport->maxFrames)
+	{
+		return EINVAL;
+	}
+
+	VocanaAudioTransportQueue* theReplies = &inTransport->shared->replies;
+	size_t theBytes = (size_t)inFrameCount * inTransport->channelCount * sizeof(float);
+	uint64_t theDeadline = transport_now_nanoseconds() + inBudgetNanoseconds;
+
+	//	replies to cycles that already went out unprocessed are no use to anyone
+	while(!transport_queue_is_empty(theReplies))
+	{
+		transport_queue_release(theReplies);
+	}
+
+	uint64_t theSequence = inTransport->nextSequence;
+	int theError = transport_submit(inTransport, inSampleTime, ioFrames, inFrameCount);
+	if(theError != 0)
+	{
+		return theError;
+	}
+
+	for(;;)
+	{
+		theError = transport_queue_wait(theReplies, inTransport->replyBell[0], theDeadline);
+		if(theError != 0)
+		{
+			return theError;
+		}
+
+		const VocanaAudioTransportSlot* theReply = transport_slot(inTransport->replySlots, inTransport->slotBytes, inTransport->slotCount, atomic_load_explicit(&theReplies->tail, memory_order_relaxed));
+		bool isOurs = theReply->sequence == theSequence && theReply->frameCount == inFrameCount;
+		if(isOurs)
+		{
+			memcpy(ioFrames, theReply->frames, theBytes);
+		}
+		transport_queue_release(theReplies);
+		if(isOurs)
+		{
+			return 0;
+		}
+	}
+}
+
+int VocanaAudioTransport_Submit(VocanaAudioTransport* inTransport, uint64_t inSampleTime, const float* inFrames, uint32_t inFrameCount)
+{
+	if(inTransport->shared == NULL || inTransport->isService)
+	{
+		return EBADF;
+	}
+	if(inFrameCount == 0 || inFrameCount > inTransport->maxFrames)
+	{
+		return EINVAL;
+	}
+	int theError = transport_submit(inTransport, inSampleTime, inFrames, inFrameCount);
+	if(theError == EAGAIN)
+	{
+		//	a service that has gone away stops taking requests, so a full queue is where that
+		//	shows; nothing waits on the reply bell in pipelined use, so draining it costs nothing
+		int theBellError = transport_bell_drain(inTransport->replyBell[0]);
+		if(theBellError == EPIPE)
+		{
+			theError = EPIPE;
+		}
+	}
+	return theError;
+}
+
+bool VocanaAudioTransport_PeekReply(VocanaAudioTransport* inTransport, VocanaAudioTransportRequest* outReply, const float** outFrames)
+{
+	if(inTransport->shared == NULL || inTransport->isService || transport_queue_is_empty(&inTransport->shared->replies))
+	{
+		return false;
+	}
+
+	const VocanaAudioTransportSlot* theSlot = transport_slot(inTransport->replySlots, inTransport->slotBytes, inTransport->slotCount, atomic_load_explicit(&inTransport->shared->replies.tail, memory_order_relaxed));
+	outReply->sequence = theSlot->sequence;
+	outReply->sampleTime = theSlot->sampleTime;
+	outReply->frameCount = theSlot->frameCount < inTransport->maxFrames ? theSlot->frameCount : inTransport->maxFrames;
+	*outFrames = theSlot->frames;
+	return true;
+}
+
+void VocanaAudioTransport_ReleaseReply(VocanaAudioTransport* inTransport)
+{
+	if(inTransport->shared != NULL && !transport_queue_is_empty(&inTransport->shared->replies))
+	{
+		transport_queue_release(&inTransport->shared->replies);
+	}
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Service Side
+//==================================================================================================
+
+int VocanaAudioTransport_Receive(VocanaAudioTransport* inTransport, VocanaAudioTransportRequest* outRequest, float* outFrames, uint64_t inTimeoutNanoseconds)
+{
+	if(inTransport->shared == NULL || !inTransport->isService)
+	{
+		return EBADF;
+	}
+
+	VocanaAudioTransportQueue* theRequests = &inTransport->shared->requests;
+	int theError = transport_queue_wait(theRequests, inTransport->requestBell[0], transport_now_nanoseconds() + inTimeoutNanoseconds);
+	if(theError != 0)
+	{
+		return theError;
+	}
+
+	//	the slot is in memory the plug-in also writes, so read every field once and clamp it
+	const VocanaAudioTransportSlot* theSlot = transport_slot(inTransport->requestSlots, inTransport->slotBytes, inTransport->slotCount, atomic_load_explicit(&theRequests->tail, memory_order_relaxed));
+	outRequest->sequence = theSlot->sequence;
+	outRequest->sampleTime = theSlot->sampleTime;
+	outRequest->frameCount = theSlot->frameCount < inTransport->maxFrames ? theSlot->frameCount : inTransport->maxFrames;
+	memcpy(outFrames, theSlot->frames, (size_t)outRequest->frameCount * inTransport->channelCount * sizeof(float));
+	transport_queue_release(theRequests);
+	return 0;
+}
+
+int VocanaAudioTransport_Reply(VocanaAudioTransport* inTransport, const VocanaAudioTransportRequest* inRequest, const float* inFrames)
+{
+	if(inTransport->shared == NULL || !inTransport->isService)
+	{
+		return EBADF;
+	}
+	if(inRequest->frameCount > inTransport->maxFrames)
+	{
+		return EINVAL;
+	}
+
+	VocanaAudioTransportQueue* theReplies = &inTransport->shared->replies;
+	if(transport_queue_is_full(theReplies, inTransport->slotCount))
+	{
+		return EAGAIN;
+	}
+	VocanaAudioTransportSlot* theSlot = transport_slot(inTransport->replySlots, inTransport->slotBytes, inTransport->slotCount, atomic_load_explicit(&theReplies->head, memory_order_relaxed));
+	theSlot->sequence = inRequest->sequence;
+	theSlot->sampleTime = inRequest->sampleTime;
+	theSlot->frameCount = inRequest->frameCount;
+	memcpy(theSlot->frames, inFrames, (size_t)inRequest->frameCount * inTransport->channelCount * sizeof(float));
+	transport_queue_publish(theReplies, inTransport->replyBell[1]);
+	return 0;
+}
@@ -0,0 +1,163 @@
+/*
+     File: VocanaAudioTransport.h
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Shared-memory audio transport between the HAL plug-in and the app's processing service.
+
+ */
+/*==================================================================================================
+	VocanaAudioTransport.h
+==================================================================================================*/
+
+#ifndef VocanaAudioTransport_h
+#define VocanaAudioTransport_h
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaAudioTransport
+//==================================================================================================
+
+//	The plug-in hands every output cycle to the app for processing and needs the processed frames
+//	back before the cycle ends. Doing that with an XPC message per cycle costs a dictionary
+//	allocation, a copy into the message, a copy out of the reply and a blocking round trip through
+//	the XPC machinery on the IO thread. The transport replaces all of that with a region of shared
+//	memory holding two single-producer/single-consumer queues of fixed-size frame slots: requests
+//	from the plug-in to the service and replies from the service to the plug-in. XPC is only used
+//	once, to hand the service the file descriptors of the region and of the wakeups.
+//
+//	Each queue is a ring of slots with a head the producer advances after filling a slot and a
+//	tail the consumer advances after emptying one; the two live on separate cache lines. A
+//	consumer that finds its queue empty goes to sleep on a doorbell, a socket pair with one end on
+//	each side, which also reads end-of-file once the other side has gone away. The consumer
+//	announces that it is about to sleep in the queue itself, so a producer only makes the doorbell
+//	system call when the other side is actually asleep; while both sides are busy no system calls
+//	are made at all.
+//
+//	The plug-in can use the transport two ways. Process sends a cycle and waits for it to come
+//	back, which suits a service that reliably answers within the cycle. Submit and PeekReply
+//	never wait: the plug-in sends each cycle as it comes and picks up whatever replies have
+//	arrived, and VocanaPipeline lines them up a fixed latency later.
+//
+//	Process never blocks for longer than the budget it passes in. A reply that misses
+//	the budget is discarded when it turns up, and the cycle goes out unprocessed. If the service
+//	stops draining requests the request queue fills and the plug-in stops waiting altogether until
+//	it catches up.
+//
+//	Only POSIX shared memory, file descriptors and C11 atomics are used, so both ends build and
+//	run off macOS as well. Nothing in this file depends on CoreAudio or XPC.
+
+enum
+{
+	kVocanaAudioTransport_MaxSlots          = 64,
+};
+
+//	The descriptors the service needs to attach: the shared region, the read end of the doorbell
+//	the plug-in rings for requests and the write end of the doorbell the service rings for
+//	replies. The service takes ownership of them in Attach.
+typedef struct VocanaAudioTransportDescriptors
+{
+	int                                     memoryFD;
+	int                                     requestBellFD;
+	int                                     replyBellFD;
+} VocanaAudioTransportDescriptors;
+
+//	A request as the service received it.
+typedef struct VocanaAudioTransportRequest
+{
+	uint64_t                                sequence;
+	uint64_t                                sampleTime;
+	uint32_t                                frameCount;
+} VocanaAudioTransportRequest;
+
+typedef struct VocanaAudioTransportShared VocanaAudioTransportShared;
+
+//	One end of the transport. Everything is owned by the end that created or attached it.
+typedef struct VocanaAudioTransport
+{
+	VocanaAudioTransportShared*             shared;
+	size_t                                  regionBytes;
+	uint8_t*                                requestSlots;
+	uint8_t*                                replySlots;
+	uint32_t                                slotBytes;
+	uint32_t                                channelCount;
+	uint32_t                                maxFrames;
+	uint32_t                                slotCount;
+	int                                     memoryFD;
+
+	//	[0] is the end the consumer reads and [1] the end the producer writes
+	int                                     requestBell[2];
+	int                                     replyBell[2];
+
+	//	plug-in side only
+	uint64_t                                nextSequence;
+	bool                                    isService;
+} VocanaAudioTransport;
+
+//	Plug-in side. Creates the shared region and both doorbells for slots of up to inMaxFrames
+//	interleaved frames of inChannelCount channels, inSlotCount in each direction (a power of two,
+//	at most kVocanaAudioTransport_MaxSlots). Returns 0 on success or an errno value. Not real-time
+//	safe.
+int         VocanaAudioTransport_Create(VocanaAudioTransport* outTransport, uint32_t inChannelCount, uint32_t inMaxFrames, uint32_t inSlotCount);
+
+//	Plug-in side. The descriptors to send to the service. They stay owned by the plug-in, so the
+//	sender duplicates them (as XPC does) or the receiver in the same process dup()s them first.
+void        VocanaAudioTransport_GetDescriptors(const VocanaAudioTransport* inTransport, VocanaAudioTransportDescriptors* outDescriptors);
+
+//	Plug-in side. Closes the plug-in's copies of the descriptors once they have been sent, so that
+//	when the service goes away its end of the reply doorbell closes and Process and Submit return
+//	EPIPE.
+void        VocanaAudioTransport_CloseServiceDescriptors(VocanaAudioTransport* inTransport);
+
+//	Service side. Maps the region the descriptors name and checks that its layout is one this
+//	build understands, returning EPROTO if it isn't. Takes ownership of the descriptors even when
+//	it fails. Not real-time safe.
+int         VocanaAudioTransport_Attach(VocanaAudioTransport* outTransport, const VocanaAudioTransportDescriptors* inDescriptors);
+
+//	Unmaps the region and closes every descriptor of this end.
+void        VocanaAudioTransport_Teardown(VocanaAudioTransport* inTransport);
+
+//	Plug-in side. Sends inFrameCount frames to the service and waits up to inBudgetNanoseconds for
+//	them to come back processed, in which case they are written over ioFrames and 0 is returned.
+//	Otherwise ioFrames is left as it was and the result is ETIMEDOUT, EAGAIN if the service has
+//	fallen so far behind that the request queue is full, or EPIPE if the service has gone away.
+//	Real-time safe in that it never allocates or takes a lock; it makes at most a doorbell write
+//	and a bounded wait.
+int         VocanaAudioTransport_Process(VocanaAudioTransport* inTransport, uint64_t inSampleTime, float* ioFrames, uint32_t inFrameCount, uint64_t inBudgetNanoseconds);
+
+//	Plug-in side, pipelined use. Sends inFrameCount frames to the service without waiting for
+//	them. Returns 0, EAGAIN if the request queue is full, EPIPE if it is full because the service
+//	has gone away, or EINVAL. Real-time safe.
+int         VocanaAudioTransport_Submit(VocanaAudioTransport* inTransport, uint64_t inSampleTime, const float* inFrames, uint32_t inFrameCount);
+
+//	Plug-in side, pipelined use. The oldest reply that has arrived, if there is one, without
+//	copying it: outFrames points into shared memory and stays valid until ReleaseReply. Never
+//	waits. Real-time safe.
+bool        VocanaAudioTransport_PeekReply(VocanaAudioTransport* inTransport, VocanaAudioTransportRequest* outReply, const float** outFrames);
+void        VocanaAudioTransport_ReleaseReply(VocanaAudioTransport* inTransport);
+
+//	Service side. Waits up to inTimeoutNanoseconds for a request and copies its frames into
+//	outFrames, which must have room for maxFrames frames. Returns 0, ETIMEDOUT or EPIPE.
+int         VocanaAudioTransport_Receive(VocanaAudioTransport* inTransport, VocanaAudioTransportRequest* outRequest, float* outFrames, uint64_t inTimeoutNanoseconds);
+
+//	Service side. Sends the processed frames for inRequest back to the plug-in. Returns 0, or
+//	EAGAIN if the plug-in hasn't drained enough replies to make room.
+int         VocanaAudioTransport_Reply(VocanaAudioTransport* inTransport, const VocanaAudioTransportRequest* inRequest, const float* inFrames);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VocanaAudioTransport_h */
@@ -0,0 +1,262 @@
+/*
+     File: VocanaChannels.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Channel layout of the Vocana HAL plug-ins' streams, and the kernels that move one channel in
+ and out of interleaved frames.
+
+ */
+/*==================================================================================================
+	VocanaChannels.c
+==================================================================================================*/
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include "VocanaChannels.h"
+
+#include <stddef.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__APPLE__)
+#include <Accelerate/Accelerate.h>
+#endif
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Kernels
+//==================================================================================================
+
+//	Each kernel handles as many frames as fill whole vectors and returns how many that was; the
+//	caller finishes the rest with the strided copy.
+//
+//	Stereo frames are rewritten whole, since a vector holds two of them. Wider frames are not:
+//	transposing them costs more than the strided loop it replaces, so for those the kernels move
+//	the one channel a lane at a time, eight frames per iteration, and only build or split the
+//	vectors of contiguous samples on the other side.
+
+#define kChannels_LaneFrames    8
+
+#if defined(__ARM_NEON)
+
+static uint32_t channels_deinterleave_vector(const float* inFrames, uint32_t inChannelCount, uint32_t inChannel, float* outSamples, uint32_t inFrameCount)
+{
+	if(inChannelCount == 2)
+	{
+		uint32_t theCount = inFrameCount & ~3u;
+		for(uint32_t i = 0; i < theCount; i += 4)
+		{
+			float32x4x2_t theFrames = vld2q_f32(inFrames + (size_t)i * 2);
+			vst1q_f32(outSamples + i, theFrames.val[inChannel]);
+		}
+		return theCount;
+	}
+	if(inChannelCount == 4)
+	{
+		uint32_t theCount = inFrameCount & ~3u;
+		for(uint32_t i = 0; i < theCount; i += 4)
+		{
+			float32x4x4_t theFrames = vld4q_f32(inFrames + (size_t)i * 4);
+			vst1q_f32(outSamples + i, theFrames.val[inChannel]);
+		}
+		return theCount;
+	}
+	if(inChannelCount > 2)
+	{
+		uint32_t theCount = inFrameCount & ~(kChannels_LaneFrames - 1);
+		for(uint32_t i = 0; i < theCount; i += kChannels_LaneFrames)
+		{
+			const float* theFrames = inFrames + (size_t)i * inChannelCount + inChannel;
+			float32x4_t theLow = vdupq_n_f32(0.0f);
+			float32x4_t theHigh = vdupq_n_f32(0.0f);
+			theLow = vld1q_lane_f32(theFrames, theLow, 0);
+			theLow = vld1q_lane_f32(theFrames + inChannelCount, theLow, 1);
+			theLow = vld1q_lane_f32(theFrames + 2 * inChannelCount, theLow, 2);
+			theLow = vld1q_lane_f32(theFrames + 3 * inChannelCount, theLow, 3);
+			theHigh = vld1q_lane_f32(theFrames + 4 * inChannelCount, theHigh, 0);
+			theHigh = vld1q_lane_f32(theFrames + 5 * inChannelCount, theHigh, 1);
+			theHigh = vld1q_lane_f32(theFrames + 6 * inChannelCount, theHigh, 2);
+			theHigh = vld1q_lane_f32(theFrames + 7 * inChannelCount, theHigh, 3);
+			vst1q_f32(outSamples + i, theLow);
+			vst1q_f32(outSamples + i + 4, theHigh);
+		}
+		return theCount;
+	}
+	return 0;
+}
+
+static uint32_t channels_interleave_vector(const float* inSamples, float* ioFrames, uint32_t inChannelCount, uint32_t inChannel, uint32_t inFrameCount)
+{
+	if(inChannelCount == 2)
+	{
+		uint32_t theCount = inFrameCount & ~3u;
+		for(uint32_t i = 0; i < theCount; i += 4)
+		{
+			float32x4x2_t theFrames = vld2q_f32(ioFrames + (size_t)i * 2);
+			theFrames.val[inChannel] = vld1q_f32(inSamples + i);
+			vst2q_f32(ioFrames + (size_t)i * 2, theFrames);
+		}
+		return theCount;
+	}
+	if(inChannelCount > 2)
+	{
+		uint32_t theCount = inFrameCount & ~(kChannels_LaneFrames - 1);
+		for(uint32_t i = 0; i < theCount; i += kChannels_LaneFrames)
+		{
+			float* theFrames = ioFrames + (size_t)i * inChannelCount + inChannel;
+			float32x4_t theLow = vld1q_f32(inSamples + i);
+			float32x4_t theHigh = vld1q_f32(inSamples + i + 4);
+			vst1q_lane_f32(theFrames, theLow, 0);
+			vst1q_lane_f32(theFrames + inChannelCount, theLow, 1);
+			vst1q_lane_f32(theFrames + 2 * inChannelCount, theLow, 2);
+			vst1q_lane_f32(theFrames + 3 * inChannelCount, theLow, 3);
+			vst1q_lane_f32(theFrames + 4 * inChannelCount, theHigh, 0);
+			vst1q_lane_f32(theFrames + 5 * inChannelCount, theHigh, 1);
+			vst1q_lane_f32(theFrames + 6 * inChannelCount, theHigh, 2);
+			vst1q_lane_f32(theFrames + 7 * inChannelCount, theHigh, 3);
+		}
+		return theCount;
+	}
+	return 0;
+}
+
+#elif defined(__SSE2__)
+
+//	four samples of one channel, inStride floats apart, as one vector
+static inline __m128 channels_gather4(const float* inFrames, size_t inStride)
+{
+	__m128 theLow = _mm_unpacklo_ps(_mm_load_ss(inFrames), _mm_load_ss(inFrames + inStride));
+	__m128 theHigh = _mm_unpacklo_ps(_mm_load_ss(inFrames + 2 * inStride), _mm_load_ss(inFrames + 3 * inStride));
+	return _mm_movelh_ps(theLow, theHigh);
+}
+
+//	the four samples of inSamples into one channel, inStride floats apart
+static inline void channels_scatter4(__m128 inSamples, float* ioFrames, size_t inStride)
+{
+	_mm_store_ss(ioFrames, inSamples);
+	_mm_store_ss(ioFrames + inStride, _mm_shuffle_ps(inSamples, inSamples, _MM_SHUFFLE(1, 1, 1, 1)));
+	_mm_store_ss(ioFrames + 2 * inStride, _mm_movehl_ps(inSamples, inSamples));
+	_mm_store_ss(ioFrames + 3 * inStride, _mm_shuffle_ps(inSamples, inSamples, _MM_SHUFFLE(3, 3, 3, 3)));
+}
+
+static uint32_t channels_deinterleave_vector(const float* inFrames, uint32_t inChannelCount, uint32_t inChannel, float* outSamples, uint32_t inFrameCount)
+{
+	if(inChannelCount == 2)
+	{
+		uint32_t theCount = inFrameCount & ~3u;
+		for(uint32_t i = 0; i < theCount; i += 4)
+		{
+			__m128 theLow = _mm_loadu_ps(inFrames + (size_t)i * 2);
+			__m128 theHigh = _mm_loadu_ps(inFrames + (size_t)i * 2 + 4);
+			__m128 theChannel = inChannel == 0 ? _mm_shuffle_ps(theLow, theHigh, _MM_SHUFFLE(2, 0, 2, 0)) : _mm_shuffle_ps(theLow, theHigh, _MM_SHUFFLE(3, 1, 3, 1));
+			_mm_storeu_ps(outSamples + i, theChannel);
+		}
+		return theCount;
+	}
+	if(inChannelCount > 2)
+	{
+		uint32_t theCount = inFrameCount & ~(kChannels_LaneFrames - 1);
+		for(uint32_t i = 0; i < theCount; i += kChannels_LaneFrames)
+		{
+			const float* theFrames = inFrames + (size_t)i * inChannelCount + inChannel;
+			_mm_storeu_ps(outSamples + i, channels_gather4(theFrames, inChannelCount));
+			_mm_storeu_ps(outSamples + i + 4, channels_gather4(theFrames + (size_t)4 * inChannelCount, inChannelCount));
+		}
+		return theCount;
+	}
+	return 0;
+}
+
+static uint32_t channels_interleave_vector(const float* inSamples, float* ioFrames, uint32_t inChannelCount, uint32_t inChannel, uint32_t inFrameCount)
+{
+	if(inChannelCount == 2)
+	{
+		uint32_t theCount = inFrameCount & ~3u;
+		for(uint32_t i = 0; i < theCount; i += 4)
+		{
+			float* theFrames = ioFrames + (size_t)i * 2;
+			__m128 theLow = _mm_loadu_ps(theFrames);
+			__m128 theHigh = _mm_loadu_ps(theFrames + 4);
+			__m128 theSamples = _mm_loadu_ps(inSamples + i);
+			if(inChannel == 0)
+			{
+				__m128 theOther = _mm_shuffle_ps(theLow, theHigh, _MM_SHUFFLE(3, 1, 3, 1));
+				_mm_storeu_ps(theFrames, _mm_unpacklo_ps(theSamples, theOther));
+				_mm_storeu_ps(theFrames + 4, _mm_unpackhi_ps(theSamples, theOther));
+			}
+			else
+			{
+				__m128 theOther = _mm_shuffle_ps(theLow, theHigh, _MM_SHUFFLE(2, 0, 2, 0));
+				_mm_storeu_ps(theFrames, _mm_unpacklo_ps(theOther, theSamples));
+				_mm_storeu_ps(theFrames + 4, _mm_unpackhi_ps(theOther, theSamples));
+			}
+		}
+		return theCount;
+	}
+	if(inChannelCount > 2)
+	{
+		uint32_t theCount = inFrameCount & ~(kChannels_LaneFrames - 1);
+		for(uint32_t i = 0; i < theCount; i += kChannels_LaneFrames)
+		{
+			float* theFrames = ioFrames + (size_t)i * inChannelCount + inChannel;
+			channels_scatter4(_mm_loadu_ps(inSamples + i), theFrames, inChannelCount);
+			channels_scatter4(_mm_loadu_ps(inSamples + i + 4), theFrames + (size_t)4 * inChannelCount, inChannelCount);
+		}
+		return theCount;
+	}
+	return 0;
+}
+
+#else
+
+static uint32_t channels_deinterleave_vector(const float* inFrames, uint32_t inChannelCount, uint32_t inChannel, float* outSamples, uint32_t inFrameCount)
+{
+	return 0;
+}
+
+static uint32_t channels_interleave_vector(const float* inSamples, float* ioFrames, uint32_t inChannelCount, uint32_t inChannel, uint32_t inFrameCount)
+{
+	return 0;
+}
+
+#endif
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaChannels
+//==================================================================================================
+
+void VocanaChannels_Deinterleave(const float* inFrames, uint32_t inChannelCount, uint32_t inChannel, float* outSamples, uint32_t inFrameCount)
+{
+	uint32_t theDone = channels_deinterleave_vector(inFrames, inChannelCount, inChannel, outSamples, inFrameCount);
+	const float* theFrames = inFrames + (size_t)theDone * inChannelCount + inChannel;
+#if defined(__APPLE__)
+	cblas_scopy((int)(inFrameCount - theDone), theFrames, (int)inChannelCount, outSamples + theDone, 1);
+#else
+	for(uint32_t i = theDone; i < inFrameCount; i++, theFrames += inChannelCount)
+	{
+		outSamples[i] = *theFrames;
+	}
+#endif
+}
+
+void VocanaChannels_Interleave(const float* inSamples, float* ioFrames, uint32_t inChannelCount, uint32_t inChannel, uint32_t inFrameCount)
+{
+	uint32_t theDone = channels_interleave_vector(inSamples, ioFrames, inChannelCount, inChannel, inFrameCount);
+	float* theFrames = ioFrames + (size_t)theDone * inChannelCount + inChannel;
+#if defined(__APPLE__)
+	cblas_scopy((int)(inFrameCount - theDone), inSamples + theDone, 1, theFrames, (int)inChannelCount);
+#else
+	for(uint32_t i = theDone; i < inFrameCount; i++, theFrames += inChannelCount)
+	{
+		*theFrames = inSamples[i];
+	}
+#endif
+}
@@ -0,0 +1,79 @@
+/*
+     File: VocanaChannels.h
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Channel layout of the Vocana HAL plug-ins' streams, and the kernels that move one channel in
+ and out of interleaved frames.
+
+ */
+/*==================================================================================================
+	VocanaChannels.h
+==================================================================================================*/
+
+#ifndef VocanaChannels_h
+#define VocanaChannels_h
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaChannels
+//==================================================================================================
+
+//	The devices' streams carry any number of interleaved channels from 1 to
+//	kVocanaChannels_MaxChannels; how many is part of the device's configuration rather than of the
+//	build. The count comes from the VocanaChannelCount key of the plug-in's Info.plist, so a copy
+//	of the bundle can be set up for 8-channel loopback, and the app can override it at run time
+//	through kVocanaDevicePropertyChannelCount, which the driver keeps in the host's storage and
+//	applies through a device configuration change.
+//
+//	Processors work on one channel at a time, so the IO path takes a channel out of the
+//	interleaved frames into a contiguous block and puts it back afterwards. Those moves are
+//	strided gathers and scatters, which compilers don't vectorize; the kernels use NEON or SSE to
+//	shuffle stereo frames whole and, for wider frames, to move the channel a lane at a time while
+//	loading and storing the contiguous side as vectors. What's left over takes a strided copy.
+//
+//	Everything here is real-time safe. Nothing in this file depends on CoreAudio.
+
+enum
+{
+	kVocanaChannels_MaxChannels         = 16,
+};
+
+//	The device's custom property for its channel count, a CFNumber (see VocanaVirtualDevice.c).
+//	Setting it stores the count and reconfigures the device once IO has stopped.
+enum
+{
+	kVocanaDevicePropertyChannelCount   = 0x76636368,   //	'vcch'
+};
+
+#define kVocanaChannels_InfoKey         "VocanaChannelCount"
+
+static inline bool VocanaChannels_IsValidCount(uint32_t inChannelCount)
+{
+	return inChannelCount >= 1 && inChannelCount <= kVocanaChannels_MaxChannels;
+}
+
+//	Copies channel inChannel of inFrameCount interleaved frames of inChannelCount channels to
+//	outSamples.
+void        VocanaChannels_Deinterleave(const float* inFrames, uint32_t inChannelCount, uint32_t inChannel, float* outSamples, uint32_t inFrameCount);
+
+//	Copies inSamples into channel inChannel of inFrameCount interleaved frames of inChannelCount
+//	channels, leaving the other channels as they are.
+void        VocanaChannels_Interleave(const float* inSamples, float* ioFrames, uint32_t inChannelCount, uint32_t inChannel, uint32_t inFrameCount);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VocanaChannels_h */
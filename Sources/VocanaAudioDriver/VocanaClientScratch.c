@@ -0,0 +1,138 @@
+/*
+     File: VocanaClientScratch.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Preallocated per-client IO scratch buffers for the Vocana HAL plug-ins.
+
+ */
+/*==================================================================================================
+	VocanaClientScratch.c
+==================================================================================================*/
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include "VocanaClientScratch.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Areas
+//==================================================================================================
+
+//	Areas are claimed lowest first, so the live clients are packed at the front of the table and
+//	the scan is as short as the number of clients.
+static int client_scratch_find_index(const VocanaClientScratch* inScratch, uint32_t inClientID)
+{
+	uint64_t theKey = (uint64_t)inClientID + 1;
+	for(int i = 0; i < kVocanaClientScratch_MaxClients; i++)
+	{
+		if(atomic_load_explicit(&inScratch->keys[i], memory_order_acquire) == theKey)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaClientScratch
+//==================================================================================================
+
+int VocanaClientScratch_Init(VocanaClientScratch* outScratch, uint32_t inMaxFrames, uint32_t inChannelCount)
+{
+	if(outScratch == NULL || inMaxFrames == 0 || inChannelCount == 0 || inMaxFrames > (1u << 20))
+	{
+		return EINVAL;
+	}
+
+	memset(outScratch, 0, sizeof(*outScratch));
+
+	//	every buffer starts on its own cache line, so neighbouring clients never share one
+	const size_t theLineSamples = kVocanaClientScratch_Alignment / sizeof(float);
+	size_t theSamples = (size_t)inMaxFrames * inChannelCount;
+	theSamples = (theSamples + theLineSamples - 1) / theLineSamples * theLineSamples;
+	//	the clients' areas, then the device's
+	size_t theBytes = theSamples * sizeof(float) * 2 * (kVocanaClientScratch_MaxClients + 1);
+	outScratch->areas = aligned_alloc(kVocanaClientScratch_Alignment, theBytes);
+	if(outScratch->areas == NULL)
+	{
+		return ENOMEM;
+	}
+	memset(outScratch->areas, 0, theBytes);
+
+	for(uint32_t i = 0; i < kVocanaClientScratch_MaxClients; i++)
+	{
+		atomic_init(&outScratch->keys[i], 0);
+	}
+	outScratch->bufferSamples = theSamples;
+	outScratch->maxFrames = inMaxFrames;
+	outScratch->channelCount = inChannelCount;
+	return 0;
+}
+
+void VocanaClientScratch_Teardown(VocanaClientScratch* inScratch)
+{
+	if(inScratch == NULL || inScratch->areas == NULL)
+	{
+		return;
+	}
+
+	free(inScratch->areas);
+	inScratch->areas = NULL;
+}
+
+bool VocanaClientScratch_AddClient(VocanaClientScratch* inScratch, uint32_t inClientID)
+{
+	if(client_scratch_find_index(inScratch, inClientID) >= 0)
+	{
+		return true;
+	}
+
+	uint64_t theKey = (uint64_t)inClientID + 1;
+	for(uint32_t i = 0; i < kVocanaClientScratch_MaxClients; i++)
+	{
+		uint64_t theFree = 0;
+		if(atomic_compare_exchange_strong_explicit(&inScratch->keys[i], &theFree, theKey, memory_order_acq_rel, memory_order_relaxed))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void VocanaClientScratch_RemoveClient(VocanaClientScratch* inScratch, uint32_t inClientID)
+{
+	int theIndex = client_scratch_find_index(inScratch, inClientID);
+	if(theIndex >= 0)
+	{
+		atomic_store_explicit(&inScratch->keys[theIndex], 0, memory_order_release);
+	}
+}
+
+bool VocanaClientScratch_Find(const VocanaClientScratch* inScratch, uint32_t inClientID, float** outInput, float** outOutput)
+{
+	int theIndex = inScratch->areas != NULL ? client_scratch_find_index(inScratch, inClientID) : -1;
+	if(theIndex < 0)
+	{
+		return false;
+	}
+
+	float* theArea = inScratch->areas + (size_t)theIndex * 2 * inScratch->bufferSamples;
+	*outInput = theArea;
+	*outOutput = theArea + inScratch->bufferSamples;
+	return true;
+}
+
+void VocanaClientScratch_GetDeviceArea(const VocanaClientScratch* inScratch, float** outInput, float** outOutput)
+{
+	float* theArea = inScratch->areas + (size_t)kVocanaClientScratch_MaxClients * 2 * inScratch->bufferSamples;
+	*outInput = theArea;
+	*outOutput = theArea + inScratch->bufferSamples;
+}
@@ -0,0 +1,95 @@
+/*
+     File: VocanaClientScratch.h
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Preallocated per-client IO scratch buffers for the Vocana HAL plug-ins.
+
+ */
+/*==================================================================================================
+	VocanaClientScratch.h
+==================================================================================================*/
+
+#ifndef VocanaClientScratch_h
+#define VocanaClientScratch_h
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaClientScratch
+//==================================================================================================
+
+//	The HAL can change a client's IO buffer size from one cycle to the next, and several clients
+//	run IO at once. Rather than resizing shared buffers on the IO path, every client gets an input
+//	and an output scratch buffer sized for the largest cycle, all carved out of one allocation made
+//	at Init, so the IO path never allocates, frees or locks whatever sizes the cycles come in.
+//
+//	A client's area is keyed by its HAL client ID, claimed in AddDeviceClient and released in
+//	RemoveDeviceClient with atomic operations, the same way VocanaMixBus hands out its slots. The
+//	IO calls only look the area up. The HAL doesn't remove a client while its IO is running, so an
+//	area never goes away under the thread using it.
+//
+//	The HAL can also run IO for a client that has no area: one it never added, or one added after
+//	every area was taken. Those cycles use the device's own area, one more pair of buffers after
+//	the clients'. The HAL runs all of a device's IO on that device's IO thread, one operation at a
+//	time, so the device area is never used by two cycles at once. Nothing in this file depends on
+//	CoreAudio.
+
+enum
+{
+	kVocanaClientScratch_MaxClients     = 32,
+	kVocanaClientScratch_Alignment      = 64,
+};
+
+typedef struct VocanaClientScratch
+{
+	//	client ID + 1 for each area, or 0 for a free one
+	_Atomic uint64_t        keys[kVocanaClientScratch_MaxClients];
+
+	//	immutable between Init and Teardown
+	float*                  areas;
+	size_t                  bufferSamples;  //	per buffer, rounded up to whole cache lines
+	uint32_t                maxFrames;
+	uint32_t                channelCount;
+} VocanaClientScratch;
+
+//	Allocates input and output buffers of inMaxFrames frames of inChannelCount channels for each
+//	of kVocanaClientScratch_MaxClients clients and for the device. Returns 0 on success or an
+//	errno value. Not real-time safe.
+int         VocanaClientScratch_Init(VocanaClientScratch* outScratch, uint32_t inMaxFrames, uint32_t inChannelCount);
+
+//	The caller must guarantee that no IO thread is still using the buffers.
+void        VocanaClientScratch_Teardown(VocanaClientScratch* inScratch);
+
+//	Claims an area for the client. Returns false if every area is taken. Real-time safe, but meant
+//	for AddDeviceClient.
+bool        VocanaClientScratch_AddClient(VocanaClientScratch* inScratch, uint32_t inClientID);
+
+//	Releases the client's area.
+void        VocanaClientScratch_RemoveClient(VocanaClientScratch* inScratch, uint32_t inClientID);
+
+//	IO side. Finds the client's buffers, each maxFrames frames long. Returns false if the client
+//	has no area. Real-time safe.
+bool        VocanaClientScratch_Find(const VocanaClientScratch* inScratch, uint32_t inClientID, float** outInput, float** outOutput);
+
+//	IO side. The device's buffers, each maxFrames frames long, for a client Find has no area for.
+//	Only for the device's IO thread. Real-time safe.
+void        VocanaClientScratch_GetDeviceArea(const VocanaClientScratch* inScratch, float** outInput, float** outOutput);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VocanaClientScratch_h */
@@ -0,0 +1,334 @@
+/*
+     File: VocanaClock.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Drift-tracking device clock and zero time stamp engine for VocanaVirtualDevice.
+
+ */
+/*==================================================================================================
+	VocanaClock.c
+==================================================================================================*/
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include "VocanaClock.h"
+
+#include <math.h>
+#include <sched.h>
+#include <string.h>
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Constants
+//==================================================================================================
+
+//	A reference further than this from where the loop expected it is a jump, not jitter.
+#define kClock_ResyncErrorSeconds           0.010
+
+//	References further apart than this leave too much room for the loop to be fooled.
+#define kClock_MaxReferenceGapSeconds       1.0
+
+//	The loop acquires the reference with this bandwidth and only narrows down to the tracking
+//	bandwidth once it is locked, which takes this long.
+#define kClock_AcquireBandwidthHz           1.0
+#define kClock_AcquireSeconds               4.0
+
+//	Smoothing of the jitter statistic, per reference.
+#define kClock_JitterSmoothing              (1.0 / 64.0)
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Loop
+//==================================================================================================
+
+static void clock_update_lock_threshold(VocanaClock* inClock)
+{
+	inClock->lockedAfterFrames = kClock_AcquireSeconds * inClock->sampleRate;
+}
+
+//	Starts the loop over at the given reference. The rate estimate is kept: a reference that
+//	jumped is usually the same crystal restarted, so it is a better first guess than nominal.
+static void clock_sync(VocanaClock* inClock, const VocanaClockReference* inReference)
+{
+	inClock->hasReference = true;
+	inClock->loopSampleTime = inReference->sampleTime;
+	inClock->loopHostTime = (double)inReference->hostTime;
+	inClock->framesSinceSync = 0.0;
+	inClock->errorSquaredAverage = 0.0;
+	inClock->maxErrorTicks = 0.0;
+	atomic_store_explicit(&inClock->trackedTicksPerFrame, 0.0, memory_order_relaxed);
+}
+
+static bool clock_is_locked(const VocanaClock* inClock)
+{
+	return inClock->hasReference && inClock->framesSinceSync >= inClock->lockedAfterFrames;
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Configuration
+//==================================================================================================
+
+void VocanaClock_Init(VocanaClock* inClock, double inSampleRate, double inHostTicksPerSecond, uint32_t inPeriod)
+{
+	memset(inClock, 0, sizeof(*inClock));
+
+	inClock->ticksPerSecond = inHostTicksPerSecond;
+	inClock->period = inPeriod;
+	inClock->bandwidthHz = kVocanaClock_DefaultBandwidthHz;
+
+	atomic_init(&inClock->trackedTicksPerFrame, 0.0);
+	atomic_init(&inClock->rateTrim, 1.0);
+	atomic_init(&inClock->isTracking, false);
+	atomic_init(&inClock->syncGeneration, 0);
+	atomic_init(&inClock->seed, 1);
+	atomic_init(&inClock->missedPeriodCount, 0);
+	atomic_init(&inClock->ioLock, false);
+	atomic_init(&inClock->zeroSequence, 0);
+
+	VocanaClock_SetSampleRate(inClock, inSampleRate);
+	VocanaClock_Start(inClock, 0);
+}
+
+void VocanaClock_SetSampleRate(VocanaClock* inClock, double inSampleRate)
+{
+	inClock->sampleRate = inSampleRate;
+	inClock->nominalTicksPerFrame = inClock->ticksPerSecond / inSampleRate;
+	clock_update_lock_threshold(inClock);
+	VocanaClock_ResetReference(inClock);
+}
+
+void VocanaClock_SetBandwidth(VocanaClock* inClock, double inBandwidthHz)
+{
+	if(inBandwidthHz > 0.0)
+	{
+		inClock->bandwidthHz = inBandwidthHz;
+		clock_update_lock_threshold(inClock);
+	}
+}
+
+void VocanaClock_SetTracking(VocanaClock* inClock, bool inIsTracking)
+{
+	atomic_store_explicit(&inClock->isTracking, inIsTracking, memory_order_relaxed);
+}
+
+void VocanaClock_SetRateTrim(VocanaClock* inClock, double inRateTrim)
+{
+	atomic_store_explicit(&inClock->rateTrim, inRateTrim > 0.0 ? inRateTrim : 1.0, memory_order_relaxed);
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Reference
+//==================================================================================================
+
+bool VocanaClock_AddReference(VocanaClock* inClock, const VocanaClockReference* inReference)
+{
+	++inClock->referenceCount;
+
+	//	the first reference just anchors the loop
+	if(!inClock->hasReference)
+	{
+		clock_sync(inClock, inReference);
+		return true;
+	}
+
+	double theFrames = inReference->sampleTime - inClock->loopSampleTime;
+	double thePredictedHostTime = inClock->loopHostTime + theFrames * inClock->loopTicksPerFrame;
+	double theError = (double)inReference->hostTime - thePredictedHostTime;
+
+	bool isDiscontinuous = !(theFrames > 0.0) ||
+	                       theFrames > kClock_MaxReferenceGapSeconds * inClock->sampleRate ||
+	                       fabs(theError) > kClock_ResyncErrorSeconds * inClock->ticksPerSecond;
+
+	if(!isDiscontinuous)
+	{
+		//	the loop coefficients for a critically damped second order loop, scaled to the time
+		//	since the last reference; wide while acquiring, narrow once locked
+		double theBandwidth = clock_is_locked(inClock) || inClock->bandwidthHz > kClock_AcquireBandwidthHz ? inClock->bandwidthHz : kClock_AcquireBandwidthHz;
+		double theOmega = 2.0 * M_PI * theBandwidth * theFrames / inClock->sampleRate;
+		if(theOmega > 0.5)
+		{
+			theOmega = 0.5;
+		}
+		double theB = M_SQRT2 * theOmega;
+		double theC = theOmega * theOmega;
+
+		double theTicksPerFrame = inClock->loopTicksPerFrame + theC * theError / theFrames;
+		double theDrift = fabs(theTicksPerFrame / inClock->nominalTicksPerFrame - 1.0) * 1.0e6;
+		if(theDrift <= kVocanaClock_MaxDriftPPM)
+		{
+			inClock->loopHostTime = thePredictedHostTime + theB * theError;
+			inClock->loopSampleTime = inReference->sampleTime;
+			inClock->loopTicksPerFrame = theTicksPerFrame;
+			inClock->framesSinceSync += theFrames;
+
+			inClock->errorSquaredAverage += kClock_JitterSmoothing * (theError * theError - inClock->errorSquaredAverage);
+			if(clock_is_locked(inClock))
+			{
+				if(fabs(theError) > inClock->maxErrorTicks)
+				{
+					inClock->maxErrorTicks = fabs(theError);
+				}
+				atomic_store_explicit(&inClock->trackedTicksPerFrame, theTicksPerFrame, memory_order_relaxed);
+			}
+			return true;
+		}
+	}
+
+	//	the reference jumped or claims an impossible rate; follow it from here
+	clock_sync(inClock, inReference);
+	++inClock->discontinuityCount;
+	atomic_fetch_add_explicit(&inClock->syncGeneration, 1, memory_order_release);
+	return false;
+}
+
+void VocanaClock_ResetReference(VocanaClock* inClock)
+{
+	inClock->hasReference = false;
+	inClock->framesSinceSync = 0.0;
+	inClock->errorSquaredAverage = 0.0;
+	inClock->maxErrorTicks = 0.0;
+	inClock->loopTicksPerFrame = inClock->nominalTicksPerFrame;
+	atomic_store_explicit(&inClock->trackedTicksPerFrame, 0.0, memory_order_relaxed);
+}
+
+bool VocanaClock_GetReference(const VocanaClock* inClock, VocanaClockReference* outReference)
+{
+	outReference->sampleTime = inClock->loopSampleTime;
+	outReference->hostTime = (uint64_t)inClock->loopHostTime;
+	return inClock->hasReference;
+}
+
+void VocanaClock_GetStatistics(const VocanaClock* inClock, VocanaClockStatistics* outStatistics)
+{
+	memset(outStatistics, 0, sizeof(*outStatistics));
+
+	bool isLocked = clock_is_locked(inClock);
+	double theTicksPerFrame = isLocked ? inClock->loopTicksPerFrame : inClock->nominalTicksPerFrame;
+
+	outStatistics->nominalSampleRate = inClock->sampleRate;
+	outStatistics->trackedSampleRate = inClock->ticksPerSecond / theTicksPerFrame;
+	outStatistics->driftPPM = (inClock->nominalTicksPerFrame / theTicksPerFrame - 1.0) * 1.0e6;
+	outStatistics->jitterNanos = sqrt(inClock->errorSquaredAverage) / inClock->ticksPerSecond * 1.0e9;
+	outStatistics->maxErrorNanos = inClock->maxErrorTicks / inClock->ticksPerSecond * 1.0e9;
+	outStatistics->referenceCount = inClock->referenceCount;
+	outStatistics->discontinuityCount = inClock->discontinuityCount;
+	outStatistics->missedPeriodCount = atomic_load_explicit(&inClock->missedPeriodCount, memory_order_relaxed);
+	outStatistics->seed = atomic_load_explicit(&inClock->seed, memory_order_relaxed);
+	outStatistics->isTracking = atomic_load_explicit(&inClock->isTracking, memory_order_relaxed);
+	outStatistics->isLocked = isLocked;
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Zero Time Stamps
+//==================================================================================================
+
+//	The latch: readers read zeroStamps[zeroSequence & 1] and each step of the sequence hands them
+//	the stamp that was just written while the writer moves on to the other one, so a reader only
+//	ever retries because the writer made progress. Call with ioLock held.
+static void clock_publish_stamp(VocanaClock* inClock, double inSampleTime, double inHostTime)
+{
+	uint64_t theSequence = atomic_load_explicit(&inClock->zeroSequence, memory_order_relaxed);
+	for(uint32_t i = 0; i < 2; i++)
+	{
+		atomic_store_explicit(&inClock->zeroSequence, ++theSequence, memory_order_release);
+		atomic_thread_fence(memory_order_release);
+		VocanaClockStamp* theStamp = &inClock->zeroStamps[(theSequence & 1) ^ 1];
+		atomic_store_explicit(&theStamp->sampleTime, inSampleTime, memory_order_relaxed);
+		atomic_store_explicit(&theStamp->hostTime, inHostTime, memory_order_relaxed);
+	}
+}
+
+static void clock_read_stamp(VocanaClock* inClock, double* outSampleTime, double* outHostTime)
+{
+	uint64_t theSequence = 0;
+	do
+	{
+		theSequence = atomic_load_explicit(&inClock->zeroSequence, memory_order_acquire);
+		const VocanaClockStamp* theStamp = &inClock->zeroStamps[theSequence & 1];
+		*outSampleTime = atomic_load_explicit(&theStamp->sampleTime, memory_order_relaxed);
+		*outHostTime = atomic_load_explicit(&theStamp->hostTime, memory_order_relaxed);
+		atomic_thread_fence(memory_order_acquire);
+	}
+	while(atomic_load_explicit(&inClock->zeroSequence, memory_order_relaxed) != theSequence);
+}
+
+void VocanaClock_Start(VocanaClock* inClock, uint64_t inHostTime)
+{
+	//	an IO thread only holds the lock for a few arithmetic operations
+	while(atomic_exchange_explicit(&inClock->ioLock, true, memory_order_acquire))
+	{
+		sched_yield();
+	}
+	inClock->seenSyncGeneration = atomic_load_explicit(&inClock->syncGeneration, memory_order_acquire);
+	clock_publish_stamp(inClock, 0.0, (double)inHostTime);
+	atomic_store_explicit(&inClock->ioLock, false, memory_order_release);
+}
+
+double VocanaClock_GetTicksPerFrame(const VocanaClock* inClock)
+{
+	double theTicksPerFrame = inClock->nominalTicksPerFrame;
+	if(atomic_load_explicit(&inClock->isTracking, memory_order_relaxed))
+	{
+		double theTracked = atomic_load_explicit(&inClock->trackedTicksPerFrame, memory_order_relaxed);
+		if(theTracked > 0.0)
+		{
+			theTicksPerFrame = theTracked;
+		}
+	}
+	return theTicksPerFrame * atomic_load_explicit(&inClock->rateTrim, memory_order_relaxed);
+}
+
+void VocanaClock_GetZeroTimeStamp(VocanaClock* inClock, uint64_t inCurrentHostTime, double* outSampleTime, uint64_t* outHostTime, uint64_t* outSeed)
+{
+	//	only one IO thread at a time moves the stamp; another one arriving meanwhile works out the
+	//	same answer from the last published stamp without storing it
+	bool isAdvancing = !atomic_exchange_explicit(&inClock->ioLock, true, memory_order_acquire);
+
+	//	a resynchronized reference means the device now follows a different clock
+	uint64_t theSyncGeneration = atomic_load_explicit(&inClock->syncGeneration, memory_order_acquire);
+	if(isAdvancing && theSyncGeneration != inClock->seenSyncGeneration)
+	{
+		inClock->seenSyncGeneration = theSyncGeneration;
+		atomic_fetch_add_explicit(&inClock->seed, 1, memory_order_relaxed);
+	}
+
+	double theZeroSampleTime = 0.0;
+	double theZeroHostTime = 0.0;
+	clock_read_stamp(inClock, &theZeroSampleTime, &theZeroHostTime);
+
+	double thePeriodTicks = (double)inClock->period * VocanaClock_GetTicksPerFrame(inClock);
+	double theNextHostTime = theZeroHostTime + thePeriodTicks;
+	if(theNextHostTime <= (double)inCurrentHostTime)
+	{
+		//	normally this is one period; more means the IO threads didn't run for a while
+		double thePeriods = floor(((double)inCurrentHostTime - theZeroHostTime) / thePeriodTicks);
+		if(thePeriods < 1.0)
+		{
+			thePeriods = 1.0;
+		}
+		theZeroSampleTime += thePeriods * (double)inClock->period;
+		theZeroHostTime += thePeriods * thePeriodTicks;
+		if(isAdvancing)
+		{
+			if(thePeriods > 1.0)
+			{
+				atomic_fetch_add_explicit(&inClock->missedPeriodCount, (uint64_t)thePeriods - 1, memory_order_relaxed);
+			}
+			clock_publish_stamp(inClock, theZeroSampleTime, theZeroHostTime);
+		}
+	}
+	if(isAdvancing)
+	{
+		atomic_store_explicit(&inClock->ioLock, false, memory_order_release);
+	}
+
+	*outSampleTime = theZeroSampleTime;
+	*outHostTime = (uint64_t)theZeroHostTime;
+	*outSeed = atomic_load_explicit(&inClock->seed, memory_order_relaxed);
+}
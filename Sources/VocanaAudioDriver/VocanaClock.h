@@ -0,0 +1,191 @@
+/*
+     File: VocanaClock.h
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Drift-tracking device clock and zero time stamp engine for VocanaVirtualDevice.
+
+ */
+/*==================================================================================================
+	VocanaClock.h
+==================================================================================================*/
+
+#ifndef VocanaClock_h
+#define VocanaClock_h
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaClock
+//==================================================================================================
+
+//	The virtual device has no hardware of its own, so its clock is whatever the zero time stamps
+//	say it is. Left at the nominal rate it slowly drifts against the real device on the other side
+//	of the app (a USB microphone, say), and after an hour or so the app's buffer between the two
+//	under- or overruns. VocanaClock lets the device run at the rate of that reference device
+//	instead.
+//
+//	The reference side is a second-order delay-locked loop (as described by Fons Adriaensen in
+//	"Using a DLL to filter time") fed with (sample time, host time) pairs of the reference device,
+//	typically the time stamps the app's IO proc sees. The loop filters out the scheduling jitter
+//	of those time stamps and tracks the reference's host ticks per frame. A reference that jumps
+//	(the device restarted, or its time stamps stopped making sense) resynchronizes the loop and
+//	counts as a discontinuity.
+//
+//	The zero time stamp side advances the device's time stamps one period at a time at the
+//	tracked rate, so a rate change bends the timeline without ever making it jump. If the IO
+//	thread missed periods (the machine slept, say) the time stamps skip ahead whole periods along
+//	the same line. The seed is bumped only when the reference resynchronized, since the device's
+//	timeline is then following a different clock.
+//
+//	References, statistics and configuration come from the HAL's non-real-time threads and must
+//	be serialized by the caller. Zero time stamps come from the IO threads: a device and its
+//	mirror share one clock, and the HAL runs the two on IO threads of their own. The thread that
+//	wins a try-lock advances the zero time stamp and publishes it through a pair of stamps (a
+//	latch, so readers never wait for a writer); a thread that loses it starts from the published
+//	stamp and catches up whole periods on its own, without storing anything. The two sides only
+//	share atomics, so no IO thread ever waits. Nothing in this file depends on CoreAudio, so it
+//	builds and runs off macOS as well.
+
+//	The largest rate error the loop will believe, in parts per million. Real crystal clocks stay
+//	well inside a few hundred; anything further out is treated as a broken reference.
+#define kVocanaClock_MaxDriftPPM            2000.0
+
+//	Tracking bandwidth used unless VocanaClock_SetBandwidth says otherwise. The loop acquires the
+//	reference with a wider bandwidth and narrows down to this once it is locked, a few seconds
+//	later, so the tracked rate doesn't wander with the jitter of IO proc time stamps.
+#define kVocanaClock_DefaultBandwidthHz     0.05
+
+//	The device's custom properties for the clock, both CFData (see VocanaVirtualDevice.c). The app
+//	sets kVocanaDevicePropertyClockReference to one or more packed VocanaClockReference taken from
+//	the time stamps of the hardware device it pairs the virtual device with; reading it back gives
+//	the loop's idea of where that reference is. kVocanaDevicePropertyClockStatistics reads back a
+//	VocanaClockStatistics.
+enum
+{
+	kVocanaDevicePropertyClockReference     = 0x76637266,   //	'vcrf'
+	kVocanaDevicePropertyClockStatistics    = 0x76637374,   //	'vcst'
+};
+
+//	One observation of the reference clock.
+typedef struct VocanaClockReference
+{
+	double      sampleTime;
+	uint64_t    hostTime;
+} VocanaClockReference;
+
+typedef struct VocanaClockStatistics
+{
+	double      nominalSampleRate;
+	double      trackedSampleRate;      //	the reference's rate, or nominal until locked
+	double      driftPPM;               //	trackedSampleRate relative to nominal
+	double      jitterNanos;            //	RMS of the reference's deviation from the loop
+	double      maxErrorNanos;          //	largest deviation since the loop locked
+	uint64_t    referenceCount;
+	uint64_t    discontinuityCount;     //	reference resynchronizations
+	uint64_t    missedPeriodCount;      //	periods the zero time stamps skipped over
+	uint64_t    seed;
+	bool        isTracking;
+	bool        isLocked;
+} VocanaClockStatistics;
+
+//	One zero time stamp as the IO threads publish it.
+typedef struct VocanaClockStamp
+{
+	_Atomic double                          sampleTime;
+	_Atomic double                          hostTime;
+} VocanaClockStamp;
+
+typedef struct VocanaClock
+{
+	//	configuration, serialized by the caller
+	double                                  nominalTicksPerFrame;
+	double                                  ticksPerSecond;
+	double                                  sampleRate;
+	double                                  bandwidthHz;
+	uint32_t                                period;
+
+	//	the loop, serialized by the caller
+	double                                  loopHostTime;       //	filtered host time of loopSampleTime
+	double                                  loopSampleTime;
+	double                                  loopTicksPerFrame;
+	double                                  lockedAfterFrames;
+	double                                  framesSinceSync;
+	double                                  errorSquaredAverage;
+	double                                  maxErrorTicks;
+	uint64_t                                referenceCount;
+	uint64_t                                discontinuityCount;
+	bool                                    hasReference;
+
+	//	published to the IO thread
+	_Atomic double                          trackedTicksPerFrame;   //	0 while not locked
+	_Atomic double                          rateTrim;               //	multiplies the ticks per frame
+	_Atomic bool                            isTracking;
+	_Atomic uint64_t                        syncGeneration;
+
+	//	IO threads; only the holder of ioLock advances the zero time stamp. The current one is
+	//	zeroStamps[zeroSequence & 1].
+	_Atomic bool                            ioLock;
+	uint64_t                                seenSyncGeneration;     //	under ioLock
+	_Atomic uint64_t                        zeroSequence;
+	VocanaClockStamp                        zeroStamps[2];
+	_Atomic uint64_t                        seed;
+	_Atomic uint64_t                        missedPeriodCount;
+} VocanaClock;
+
+//	Sets up the clock for the given sample rate, host clock frequency and zero time stamp period
+//	(in frames). Tracking starts out disabled and the rate trim at 1.
+void        VocanaClock_Init(VocanaClock* inClock, double inSampleRate, double inHostTicksPerSecond, uint32_t inPeriod);
+
+//	Changes the nominal rate. The loop starts over, since the reference's rate is now a different
+//	one too. Must not run concurrently with IO.
+void        VocanaClock_SetSampleRate(VocanaClock* inClock, double inSampleRate);
+
+//	Changes the tracking bandwidth. Takes effect from the next reference.
+void        VocanaClock_SetBandwidth(VocanaClock* inClock, double inBandwidthHz);
+
+//	When tracking is off the device runs at the nominal rate and references only train the loop.
+void        VocanaClock_SetTracking(VocanaClock* inClock, bool inIsTracking);
+
+//	Scales the host ticks per frame, e.g. 1.01 makes the device run 1% slow. 1 is no trim.
+void        VocanaClock_SetRateTrim(VocanaClock* inClock, double inRateTrim);
+
+//	Feeds one observation of the reference clock. Returns false if it was a discontinuity and the
+//	loop resynchronized on it.
+bool        VocanaClock_AddReference(VocanaClock* inClock, const VocanaClockReference* inReference);
+
+//	Forgets the reference; the device falls back to the nominal rate until the loop locks again.
+void        VocanaClock_ResetReference(VocanaClock* inClock);
+
+//	The loop's filtered position of the reference. Returns false if it has no reference.
+bool        VocanaClock_GetReference(const VocanaClock* inClock, VocanaClockReference* outReference);
+
+void        VocanaClock_GetStatistics(const VocanaClock* inClock, VocanaClockStatistics* outStatistics);
+
+//	Anchors sample time 0 at inHostTime. May run while IO threads ask for zero time stamps, which
+//	it waits out for as long as one of them is advancing the stamp. Not real-time safe.
+void        VocanaClock_Start(VocanaClock* inClock, uint64_t inHostTime);
+
+//	IO side. Returns the latest zero time stamp at or before inCurrentHostTime. Any number of IO
+//	threads may call this at once. Real-time safe.
+void        VocanaClock_GetZeroTimeStamp(VocanaClock* inClock, uint64_t inCurrentHostTime, double* outSampleTime, uint64_t* outHostTime, uint64_t* outSeed);
+
+//	The host ticks per frame the zero time stamps currently advance by. Real-time safe.
+double      VocanaClock_GetTicksPerFrame(const VocanaClock* inClock);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VocanaClock_h */
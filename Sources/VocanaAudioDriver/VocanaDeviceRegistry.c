@@ -0,0 +1,95 @@
+/*
+     File: VocanaDeviceRegistry.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Object ID allocation for the virtual devices the Vocana HAL plug-in creates at run time.
+
+ */
+/*==================================================================================================
+	VocanaDeviceRegistry.c
+==================================================================================================*/
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include "VocanaDeviceRegistry.h"
+
+#include <errno.h>
+#include <stddef.h>
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaDeviceRegistry
+//==================================================================================================
+
+int VocanaDeviceRegistry_Init(VocanaDeviceRegistry* outRegistry, uint32_t inFirstObjectID, uint32_t inObjectsPerDevice)
+{
+	if(outRegistry == NULL || inFirstObjectID == 0 || inObjectsPerDevice == 0)
+	{
+		return EINVAL;
+	}
+	for(uint32_t i = 0; i < kVocanaDeviceRegistry_MaxDevices; i++)
+	{
+		atomic_init(&outRegistry->firstObjectIDs[i], 0);
+	}
+	outRegistry->objectsPerDevice = inObjectsPerDevice;
+	outRegistry->nextObjectID = inFirstObjectID;
+	outRegistry->count = 0;
+	return 0;
+}
+
+int VocanaDeviceRegistry_Add(VocanaDeviceRegistry* ioRegistry, uint32_t* outSlot, uint32_t* outFirstObjectID)
+{
+	uint32_t theSlot = 0;
+	while(theSlot < kVocanaDeviceRegistry_MaxDevices && atomic_load_explicit(&ioRegistry->firstObjectIDs[theSlot], memory_order_relaxed) != 0)
+	{
+		theSlot++;
+	}
+	if(theSlot == kVocanaDeviceRegistry_MaxDevices)
+	{
+		return ENOSPC;
+	}
+	uint32_t theFirstObjectID = ioRegistry->nextObjectID;
+	if(theFirstObjectID > UINT32_MAX - ioRegistry->objectsPerDevice)
+	{
+		return EOVERFLOW;
+	}
+	ioRegistry->nextObjectID = theFirstObjectID + ioRegistry->objectsPerDevice;
+	ioRegistry->count++;
+
+	//	the release pairs with the acquire in the lookups, which then see the slot's state
+	atomic_store_explicit(&ioRegistry->firstObjectIDs[theSlot], theFirstObjectID, memory_order_release);
+	*outSlot = theSlot;
+	*outFirstObjectID = theFirstObjectID;
+	return 0;
+}
+
+int VocanaDeviceRegistry_Remove(VocanaDeviceRegistry* ioRegistry, uint32_t inSlot)
+{
+	if(inSlot >= kVocanaDeviceRegistry_MaxDevices || atomic_load_explicit(&ioRegistry->firstObjectIDs[inSlot], memory_order_relaxed) == 0)
+	{
+		return EINVAL;
+	}
+	atomic_store_explicit(&ioRegistry->firstObjectIDs[inSlot], 0, memory_order_release);
+	ioRegistry->count--;
+	return 0;
+}
+
+bool VocanaDeviceRegistry_Find(const VocanaDeviceRegistry* inRegistry, uint32_t inObjectID, uint32_t* outSlot, uint32_t* outOffset)
+{
+	//	at most sixteen loads from a single cache line; cheaper than any index that would have to
+	//	be kept in step with Add and Remove
+	for(uint32_t i = 0; i < kVocanaDeviceRegistry_MaxDevices; i++)
+	{
+		uint32_t theFirstObjectID = atomic_load_explicit(&inRegistry->firstObjectIDs[i], memory_order_acquire);
+		if(theFirstObjectID != 0 && inObjectID - theFirstObjectID < inRegistry->objectsPerDevice)
+		{
+			*outSlot = i;
+			*outOffset = inObjectID - theFirstObjectID;
+			return true;
+		}
+	}
+	return false;
+}
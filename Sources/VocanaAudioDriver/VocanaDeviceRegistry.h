@@ -0,0 +1,107 @@
+/*
+     File: VocanaDeviceRegistry.h
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Object ID allocation for the virtual devices the Vocana HAL plug-in creates at run time.
+
+ */
+/*==================================================================================================
+	VocanaDeviceRegistry.h
+==================================================================================================*/
+
+#ifndef VocanaDeviceRegistry_h
+#define VocanaDeviceRegistry_h
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaDeviceRegistry
+//==================================================================================================
+
+//	The plug-in publishes any number of virtual devices up to kVocanaDeviceRegistry_MaxDevices,
+//	each with its own ring, clock and controls, so that every meeting on the machine can have a
+//	denoised microphone of its own. The app sets how many through kVocanaPlugInPropertyDeviceCount.
+//
+//	Every device owns a contiguous block of object IDs: the device itself and its streams and
+//	controls sit at fixed offsets within it, so the plug-in keeps one description of a device's
+//	objects and finds an object by the block it is in and its offset. A device lives in a slot;
+//	slots are reused, but object IDs never are, because the HAL and its clients hold on to IDs and
+//	a stale one must not quietly find the device that took the slot over.
+//
+//	Add and Remove change the registry and must be serialized by the caller. Find and
+//	GetFirstObjectID only read atomics, so the IO threads and property queries can call them at
+//	any time without a lock. A slot's first object ID is published last when a device is added and
+//	cleared first when it is removed, so whatever the slot holds is set up by the time a lookup
+//	can find it. Nothing in this file depends on CoreAudio.
+
+enum
+{
+	kVocanaDeviceRegistry_MaxDevices    = 16,
+
+	//	the cache line of Apple silicon; per-device state is aligned to it so that devices running
+	//	on different IO threads never share a line
+	kVocanaDeviceRegistry_CacheLineSize = 128,
+};
+
+//	The plug-in's custom property for the number of devices it publishes, a CFNumber (see
+//	VocanaVirtualDevice.c). Setting it adds or removes devices at the end of the list; a device
+//	that is running IO is not removed.
+enum
+{
+	kVocanaPlugInPropertyDeviceCount    = 0x7663646E,   //	'vcdn'
+};
+
+typedef struct VocanaDeviceRegistry
+{
+	_Atomic uint32_t    firstObjectIDs[kVocanaDeviceRegistry_MaxDevices];   //	0 for a free slot
+	uint32_t            objectsPerDevice;
+	uint32_t            nextObjectID;
+	uint32_t            count;
+} VocanaDeviceRegistry;
+
+//	Empties the registry. The first device added gets inFirstObjectID, and every device gets
+//	inObjectsPerDevice IDs. Returns 0 on success or EINVAL.
+int         VocanaDeviceRegistry_Init(VocanaDeviceRegistry* outRegistry, uint32_t inFirstObjectID, uint32_t inObjectsPerDevice);
+
+//	Takes the lowest free slot and a fresh block of object IDs for a new device. The caller sets up
+//	the slot's state before calling this, so lookups find it ready. Returns 0 on success, ENOSPC if
+//	every slot is taken or EOVERFLOW once the object IDs have run out.
+int         VocanaDeviceRegistry_Add(VocanaDeviceRegistry* ioRegistry, uint32_t* outSlot, uint32_t* outFirstObjectID);
+
+//	Frees a slot. Lookups stop finding its device before this returns, but one that found it just
+//	before may still be using the slot's state. Returns 0 on success or EINVAL if the slot is free.
+int         VocanaDeviceRegistry_Remove(VocanaDeviceRegistry* ioRegistry, uint32_t inSlot);
+
+//	The slot of the device inObjectID belongs to and the object's offset within the device's block.
+//	Returns false for IDs of no current device. Real-time safe.
+bool        VocanaDeviceRegistry_Find(const VocanaDeviceRegistry* inRegistry, uint32_t inObjectID, uint32_t* outSlot, uint32_t* outOffset);
+
+//	The first object ID of the device in inSlot, or 0 if the slot is free. Real-time safe.
+static inline uint32_t VocanaDeviceRegistry_GetFirstObjectID(const VocanaDeviceRegistry* inRegistry, uint32_t inSlot)
+{
+	return inSlot < kVocanaDeviceRegistry_MaxDevices ? atomic_load_explicit(&inRegistry->firstObjectIDs[inSlot], memory_order_acquire) : 0;
+}
+
+//	How many devices there are. Only meaningful to the code that serializes Add and Remove.
+static inline uint32_t VocanaDeviceRegistry_GetCount(const VocanaDeviceRegistry* inRegistry)
+{
+	return inRegistry->count;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VocanaDeviceRegistry_h */
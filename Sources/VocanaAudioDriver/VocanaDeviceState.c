@@ -0,0 +1,204 @@
+/*
+     File: VocanaDeviceState.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Versioned, lock-free snapshot of the VocanaVirtualDevice property state.
+
+ */
+/*==================================================================================================
+	VocanaDeviceState.c
+==================================================================================================*/
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include "VocanaDeviceState.h"
+
+#include <string.h>
+
+#if defined(__APPLE__)
+#include <Accelerate/Accelerate.h>
+#endif
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Snapshot
+//==================================================================================================
+
+static void state_store(VocanaDeviceState* inState, const VocanaDeviceStateValues* inValues)
+{
+	uint64_t theWords[kVocanaDeviceState_WordCount];
+	memset(theWords, 0, sizeof(theWords));
+	memcpy(theWords, inValues, sizeof(*inValues));
+	for(uint32_t i = 0; i < kVocanaDeviceState_WordCount; i++)
+	{
+		atomic_store_explicit(&inState->words[i], theWords[i], memory_order_relaxed);
+	}
+}
+
+static void state_load(const VocanaDeviceState* inState, VocanaDeviceStateValues* outValues)
+{
+	uint64_t theWords[kVocanaDeviceState_WordCount];
+	for(uint32_t i = 0; i < kVocanaDeviceState_WordCount; i++)
+	{
+		theWords[i] = atomic_load_explicit(&((VocanaDeviceState*)inState)->words[i], memory_order_relaxed);
+	}
+	memcpy(outValues, theWords, sizeof(*outValues));
+}
+
+void VocanaDeviceState_Init(VocanaDeviceState* inState, const VocanaDeviceStateValues* inValues)
+{
+	atomic_init(&inState->sequence, 0);
+	for(uint32_t i = 0; i < kVocanaDeviceState_WordCount; i++)
+	{
+		atomic_init(&inState->words[i], 0);
+	}
+	state_store(inState, inValues);
+}
+
+void VocanaDeviceState_Publish(VocanaDeviceState* inState, const VocanaDeviceStateValues* inValues)
+{
+	//	the odd sequence has to be visible before any of the new words are
+	uint64_t theSequence = atomic_load_explicit(&inState->sequence, memory_order_relaxed);
+	atomic_store_explicit(&inState->sequence, theSequence + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+
+	state_store(inState, inValues);
+
+	atomic_store_explicit(&inState->sequence, theSequence + 2, memory_order_release);
+}
+
+bool VocanaDeviceState_TryRead(const VocanaDeviceState* inState, VocanaDeviceStateValues* outValues, uint64_t* outVersion)
+{
+	_Atomic uint64_t* theSequence = &((VocanaDeviceState*)inState)->sequence;
+
+	uint64_t theBefore = atomic_load_explicit(theSequence, memory_order_acquire);
+	if((theBefore & 1) != 0)
+	{
+		return false;
+	}
+
+	state_load(inState, outValues);
+
+	//	none of the words may be read after the second look at the sequence
+	atomic_thread_fence(memory_order_acquire);
+	uint64_t theAfter = atomic_load_explicit(theSequence, memory_order_relaxed);
+	if(theAfter != theBefore)
+	{
+		return false;
+	}
+
+	if(outVersion != NULL)
+	{
+		*outVersion = theBefore / 2;
+	}
+	return true;
+}
+
+uint64_t VocanaDeviceState_Read(const VocanaDeviceState* inState, VocanaDeviceStateValues* outValues)
+{
+	uint64_t theVersion = 0;
+	while(!VocanaDeviceState_TryRead(inState, outValues, &theVersion))
+	{
+		//	a setter is storing a snapshot, which takes a handful of stores
+	}
+	return theVersion;
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark IO Reader
+//==================================================================================================
+
+void VocanaDeviceStateReader_Init(VocanaDeviceStateReader* inReader, const VocanaDeviceState* inState)
+{
+	memset(inReader, 0, sizeof(*inReader));
+	uint64_t theVersion = VocanaDeviceState_Read(inState, &inReader->values);
+	inReader->sequence = theVersion * 2;
+	inReader->previousVolume = inReader->values.volume;
+	inReader->wasMuted = inReader->values.isMuted;
+}
+
+const VocanaDeviceStateValues* VocanaDeviceStateReader_BeginCycle(VocanaDeviceStateReader* inReader, const VocanaDeviceState* inState, uint64_t inCycle)
+{
+	if(inReader->hasCycle && inReader->cycle == inCycle)
+	{
+		return &inReader->values;
+	}
+	inReader->hasCycle = true;
+	inReader->cycle = inCycle;
+
+	//	this cycle ramps from wherever the previous one ended
+	inReader->previousVolume = inReader->values.volume;
+	inReader->wasMuted = inReader->values.isMuted;
+
+	//	nearly every cycle ends here, after one load
+	uint64_t theSequence = atomic_load_explicit(&((VocanaDeviceState*)inState)->sequence, memory_order_acquire);
+	if(theSequence == inReader->sequence)
+	{
+		return &inReader->values;
+	}
+
+	VocanaDeviceStateValues theValues;
+	uint64_t theVersion = 0;
+	if(VocanaDeviceState_TryRead(inState, &theValues, &theVersion))
+	{
+		inReader->values = theValues;
+		inReader->sequence = theVersion * 2;
+	}
+	else
+	{
+		++inReader->staleCycles;
+	}
+	return &inReader->values;
+}
+
+static float reader_gain(float inVolume, bool inIsMuted, bool inUseVolume)
+{
+	return inIsMuted ? 0.0f : (inUseVolume ? inVolume : 1.0f);
+}
+
+void VocanaDeviceStateReader_ApplyGain(const VocanaDeviceStateReader* inReader, float* ioFrames, uint32_t inFrameCount, uint32_t inChannelCount, bool inUseVolume)
+{
+	float theStart = reader_gain(inReader->previousVolume, inReader->wasMuted, inUseVolume);
+	float theEnd = reader_gain(inReader->values.volume, inReader->values.isMuted, inUseVolume);
+	uint32_t theSampleCount = inFrameCount * inChannelCount;
+
+	if(theStart == theEnd)
+	{
+		if(theEnd == 1.0f)
+		{
+			return;
+		}
+#if defined(__APPLE__)
+		if(theEnd == 0.0f)
+		{
+			vDSP_vclr(ioFrames, 1, theSampleCount);
+		}
+		else
+		{
+			vDSP_vsmul(ioFrames, 1, &theEnd, ioFrames, 1, theSampleCount);
+		}
+#else
+		for(uint32_t i = 0; i < theSampleCount; i++)
+		{
+			ioFrames[i] *= theEnd;
+		}
+#endif
+		return;
+	}
+
+	//	a linear ramp across the cycle that lands exactly on the new gain at the last frame
+	float theStep = inFrameCount > 1 ? (theEnd - theStart) / (float)(inFrameCount - 1) : 0.0f;
+	for(uint32_t theFrame = 0; theFrame < inFrameCount; theFrame++)
+	{
+		float theGain = theFrame + 1 == inFrameCount ? theEnd : theStart + theStep * (float)theFrame;
+		float* theSamples = ioFrames + (size_t)theFrame * inChannelCount;
+		for(uint32_t theChannel = 0; theChannel < inChannelCount; theChannel++)
+		{
+			theSamples[theChannel] *= theGain;
+		}
+	}
+}
@@ -0,0 +1,118 @@
+/*
+     File: VocanaDeviceState.h
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Versioned, lock-free snapshot of the VocanaVirtualDevice property state.
+
+ */
+/*==================================================================================================
+	VocanaDeviceState.h
+==================================================================================================*/
+
+#ifndef VocanaDeviceState_h
+#define VocanaDeviceState_h
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include "VocanaRingBuffer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaDeviceState
+//==================================================================================================
+
+//	coreaudiod asks for the device's properties from many threads at once, at high rates while it
+//	enumerates devices, and the IO thread needs the volume and mute of every cycle. Rather than
+//	putting all of those behind the plug-in's state mutex, the property values live in one
+//	snapshot that is published with a sequence lock.
+//
+//	Setters are serialized by the caller (the driver holds its state mutex while it changes
+//	things). A setter bumps the sequence to odd, stores the new snapshot and bumps the sequence
+//	to even again. Readers copy the snapshot between two loads of the sequence and keep the copy
+//	if the sequence was even and didn't move. The snapshot is stored as relaxed atomic words, so
+//	a reader racing a setter copies garbage it then throws away, but never performs a data race.
+//
+//	Property queries use VocanaDeviceState_Read, which retries until it gets a clean copy; it
+//	never blocks and a setter only ever holds it up for the few stores of one snapshot. The IO
+//	thread never retries: every IO thread owns a VocanaDeviceStateReader, takes one look at the
+//	state at the start of each cycle, and if a setter is mid-update it simply keeps the previous
+//	cycle's snapshot, picking up the change one cycle later. Every client in a cycle therefore
+//	sees the same snapshot, and gain changes are ramped over the first cycle that sees them, so
+//	a volume change or a mute never lands as a step in the middle of the signal.
+//
+//	Nothing in this file depends on CoreAudio, so it builds and runs off macOS as well.
+
+typedef struct VocanaDeviceStateValues
+{
+	double      sampleRate;
+	float       volume;                 //	linear gain of the master volume
+	float       pitchAdjust;            //	0...1, 0.5 is no adjustment
+	uint32_t    clockSource;
+	uint32_t    channelCount;           //	interleaved channels of both streams
+	bool        isMuted;
+	bool        isPitchAdjustEnabled;
+	bool        isInputActive;
+	bool        isOutputActive;
+} VocanaDeviceStateValues;
+
+enum
+{
+	kVocanaDeviceState_WordCount    = (sizeof(VocanaDeviceStateValues) + sizeof(uint64_t) - 1) / sizeof(uint64_t),
+};
+
+typedef struct VocanaDeviceState
+{
+	//	odd while a setter is storing a snapshot; counts twice per update
+	_Alignas(kVocanaRingBuffer_CacheLineSize) _Atomic uint64_t  sequence;
+	_Atomic uint64_t                                            words[kVocanaDeviceState_WordCount];
+} VocanaDeviceState;
+
+//	An IO thread's view of the state. Owned by that thread; nothing in it is shared.
+typedef struct VocanaDeviceStateReader
+{
+	VocanaDeviceStateValues values;
+	uint64_t                sequence;
+	uint64_t                cycle;
+	uint64_t                staleCycles;        //	cycles that kept the previous snapshot
+	float                   previousVolume;     //	the previous cycle's, to ramp from
+	bool                    wasMuted;
+	bool                    hasCycle;
+} VocanaDeviceStateReader;
+
+void        VocanaDeviceState_Init(VocanaDeviceState* inState, const VocanaDeviceStateValues* inValues);
+
+//	Publishes a new snapshot. Setters must be serialized by the caller. Real-time safe.
+void        VocanaDeviceState_Publish(VocanaDeviceState* inState, const VocanaDeviceStateValues* inValues);
+
+//	Copies a consistent snapshot and returns its version, which only ever grows. Lock-free; never
+//	blocks on a setter, but retries while one is storing.
+uint64_t    VocanaDeviceState_Read(const VocanaDeviceState* inState, VocanaDeviceStateValues* outValues);
+
+//	One attempt at VocanaDeviceState_Read. Returns false, leaving outValues undefined, if a setter
+//	got in the way. Wait-free.
+bool        VocanaDeviceState_TryRead(const VocanaDeviceState* inState, VocanaDeviceStateValues* outValues, uint64_t* outVersion);
+
+//	Sets up an IO thread's reader with the current state. Not real-time safe.
+void        VocanaDeviceStateReader_Init(VocanaDeviceStateReader* inReader, const VocanaDeviceState* inState);
+
+//	IO side. Called before any IO of a cycle; the first call with a new cycle counter picks up the
+//	latest snapshot if it can do so without waiting, later calls in the same cycle return the
+//	same one. Wait-free.
+const VocanaDeviceStateValues*  VocanaDeviceStateReader_BeginCycle(VocanaDeviceStateReader* inReader, const VocanaDeviceState* inState, uint64_t inCycle);
+
+//	IO side. Applies this cycle's mute and volume to interleaved samples, ramping from the previous
+//	cycle's gain if it changed. inUseVolume false applies the mute only. Real-time safe.
+void        VocanaDeviceStateReader_ApplyGain(const VocanaDeviceStateReader* inReader, float* ioFrames, uint32_t inFrameCount, uint32_t inChannelCount, bool inUseVolume);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VocanaDeviceState_h */
@@ -0,0 +1,393 @@
+/*
+     File: VocanaMixBus.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Multi-client output mixing for VocanaVirtualDevice.
+
+ */
+/*==================================================================================================
+	VocanaMixBus.c
+==================================================================================================*/
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include "VocanaMixBus.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__APPLE__)
+#include <Accelerate/Accelerate.h>
+#endif
+
+#define kMixBus_NoFrame     UINT64_MAX
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Vector Helpers
+//==================================================================================================
+
+static void mix_bus_add(float* ioSum, const float* inFrames, size_t inSampleCount)
+{
+#if defined(__APPLE__)
+	vDSP_vadd(ioSum, 1, inFrames, 1, ioSum, 1, inSampleCount);
+#else
+	float* restrict theSum = ioSum;
+	const float* restrict theFrames = inFrames;
+	for(size_t i = 0; i < inSampleCount; i++)
+	{
+		theSum[i] += theFrames[i];
+	}
+#endif
+}
+
+//	Returns the number of samples that were clipped.
+static size_t mix_bus_clip(const float* inSum, float* outFrames, size_t inSampleCount, float inClipLevel)
+{
+#if defined(__APPLE__)
+	float theLow = -inClipLevel;
+	float theHigh = inClipLevel;
+	vDSP_Length theLowCount = 0;
+	vDSP_Length theHighCount = 0;
+	vDSP_vclipc(inSum, 1, &theLow, &theHigh, outFrames, 1, inSampleCount, &theLowCount, &theHighCount);
+	return theLowCount + theHighCount;
+#else
+	const float* restrict theSum = inSum;
+	float* restrict theFrames = outFrames;
+	size_t theClipped = 0;
+	for(size_t i = 0; i < inSampleCount; i++)
+	{
+		float theSample = theSum[i];
+		theClipped += (theSample > inClipLevel) | (theSample < -inClipLevel);
+		theSample = theSample > inClipLevel ? inClipLevel : theSample;
+		theFrames[i] = theSample < -inClipLevel ? -inClipLevel : theSample;
+	}
+	return theClipped;
+#endif
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Slots
+//==================================================================================================
+
+//	Slots are claimed lowest first, so the live clients are packed at the front of the table and
+//	the scan is as short as the number of clients.
+static VocanaMixBusSlot* mix_bus_find_slot(VocanaMixBus* inMixBus, uint32_t inClientID)
+{
+	uint64_t theKey = (uint64_t)inClientID + 1;
+	for(uint32_t i = 0; i < kVocanaMixBus_MaxClients; i++)
+	{
+		if(atomic_load_explicit(&inMixBus->slots[i].key, memory_order_acquire) == theKey)
+		{
+			return &inMixBus->slots[i];
+		}
+	}
+	return NULL;
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Publishing
+//==================================================================================================
+
+static void mix_bus_publish(VocanaMixBus* inMixBus, VocanaRingBuffer* inRingBuffer)
+{
+	size_t theSampleCount = (size_t)inMixBus->cycleFrameCount * inMixBus->channelCount;
+	inMixBus->clippedSamples += mix_bus_clip(inMixBus->accumulator, inMixBus->output, theSampleCount, inMixBus->clipLevel);
+	if(inMixBus->processProc != NULL)
+	{
+		inMixBus->processProc(inMixBus->processContext, inMixBus->cycleFrame, inMixBus->output, inMixBus->cycleFrameCount);
+	}
+	VocanaRingBuffer_Write(inRingBuffer, inMixBus->cycleFrame, inMixBus->output, inMixBus->cycleFrameCount);
+	inMixBus->isPublished = true;
+}
+
+//	Publishes the current cycle if it hasn't been and starts expecting as many writers next time.
+static void mix_bus_close_cycle(VocanaMixBus* inMixBus, VocanaRingBuffer* inRingBuffer)
+{
+	if(inMixBus->hasCycle && !inMixBus->isPublished)
+	{
+		mix_bus_publish(inMixBus, inRingBuffer);
+	}
+	if(inMixBus->hasCycle)
+	{
+		inMixBus->expectedContributions = inMixBus->contributions;
+	}
+	inMixBus->hasCycle = false;
+	inMixBus->contributions = 0;
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Lifetime
+//==================================================================================================
+
+static int mix_bus_allocate(uint32_t inMaxFrames, uint32_t inChannelCount, float** outAccumulator, float** outOutput)
+{
+	//	both buffers are whole cache lines so the vector loops start aligned
+	size_t theBytes = (size_t)inMaxFrames * inChannelCount * sizeof(float);
+	theBytes = (theBytes + kVocanaRingBuffer_CacheLineSize - 1) & ~(size_t)(kVocanaRingBuffer_CacheLineSize - 1);
+	float* theAccumulator = aligned_alloc(kVocanaRingBuffer_CacheLineSize, theBytes * 2);
+	if(theAccumulator == NULL)
+	{
+		return ENOMEM;
+	}
+	memset(theAccumulator, 0, theBytes * 2);
+	*outAccumulator = theAccumulator;
+	*outOutput = theAccumulator + theBytes / sizeof(float);
+	return 0;
+}
+
+int VocanaMixBus_Init(VocanaMixBus* inMixBus, uint32_t inMaxFrames, uint32_t inChannelCount, float inClipLevel)
+{
+	if(inMixBus == NULL || inMaxFrames == 0 || inChannelCount == 0 || !(inClipLevel > 0.0f))
+	{
+		return EINVAL;
+	}
+
+	memset(inMixBus, 0, sizeof(*inMixBus));
+
+	if(mix_bus_allocate(inMaxFrames, inChannelCount, &inMixBus->accumulator, &inMixBus->output) != 0)
+	{
+		return ENOMEM;
+	}
+
+	for(uint32_t i = 0; i < kVocanaMixBus_MaxClients; i++)
+	{
+		atomic_init(&inMixBus->slots[i].key, 0);
+		atomic_init(&inMixBus->slots[i].lastFrame, kMixBus_NoFrame);
+	}
+	atomic_init(&inMixBus->anonymous.key, 0);
+	atomic_init(&inMixBus->anonymous.lastFrame, kMixBus_NoFrame);
+
+	inMixBus->maxFrames = inMaxFrames;
+	inMixBus->channelCount = inChannelCount;
+	inMixBus->clipLevel = inClipLevel;
+	VocanaMixBus_Reset(inMixBus);
+
+	return 0;
+}
+
+void VocanaMixBus_Teardown(VocanaMixBus* inMixBus)
+{
+	if(inMixBus == NULL || inMixBus->accumulator == NULL)
+	{
+		return;
+	}
+
+	free(inMixBus->accumulator);
+	inMixBus->accumulator = NULL;
+	inMixBus->output = NULL;
+}
+
+int VocanaMixBus_SetChannelCount(VocanaMixBus* inMixBus, uint32_t inChannelCount)
+{
+	if(inMixBus == NULL || inMixBus->accumulator == NULL || inChannelCount == 0)
+	{
+		return EINVAL;
+	}
+	if(inChannelCount == inMixBus->channelCount)
+	{
+		return 0;
+	}
+
+	float* theAccumulator = NULL;
+	float* theOutput = NULL;
+	if(mix_bus_allocate(inMixBus->maxFrames, inChannelCount, &theAccumulator, &theOutput) != 0)
+	{
+		return ENOMEM;
+	}
+	free(inMixBus->accumulator);
+	inMixBus->accumulator = theAccumulator;
+	inMixBus->output = theOutput;
+	inMixBus->channelCount = inChannelCount;
+	VocanaMixBus_Reset(inMixBus);
+	return 0;
+}
+
+void VocanaMixBus_Reset(VocanaMixBus* inMixBus)
+{
+	inMixBus->hasCycle = false;
+	inMixBus->isPublished = false;
+	inMixBus->contributions = 0;
+	inMixBus->expectedContributions = 1;
+	inMixBus->cycleFrame = 0;
+	inMixBus->cycleFrameCount = 0;
+
+	for(uint32_t i = 0; i < kVocanaMixBus_MaxClients; i++)
+	{
+		atomic_store_explicit(&inMixBus->slots[i].lastFrame, kMixBus_NoFrame, memory_order_relaxed);
+	}
+	atomic_store_explicit(&inMixBus->anonymous.lastFrame, kMixBus_NoFrame, memory_order_relaxed);
+}
+
+void VocanaMixBus_SetProcessor(VocanaMixBus* inMixBus, VocanaMixBusProcessProc inProc, void* inContext)
+{
+	inMixBus->processProc = inProc;
+	inMixBus->processContext = inContext;
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Clients
+//==================================================================================================
+
+bool VocanaMixBus_AddClient(VocanaMixBus* inMixBus, uint32_t inClientID)
+{
+	if(mix_bus_find_slot(inMixBus, inClientID) != NULL)
+	{
+		return true;
+	}
+
+	uint64_t theKey = (uint64_t)inClientID + 1;
+	for(uint32_t i = 0; i < kVocanaMixBus_MaxClients; i++)
+	{
+		uint64_t theFree = 0;
+		if(atomic_compare_exchange_strong_explicit(&inMixBus->slots[i].key, &theFree, theKey, memory_order_acq_rel, memory_order_relaxed))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void VocanaMixBus_RemoveClient(VocanaMixBus* inMixBus, uint32_t inClientID)
+{
+	VocanaMixBusSlot* theSlot = mix_bus_find_slot(inMixBus, inClientID);
+	if(theSlot != NULL)
+	{
+		//	free slots always hold kMixBus_NoFrame, so the next client starts clean
+		atomic_store_explicit(&theSlot->lastFrame, kMixBus_NoFrame, memory_order_relaxed);
+		atomic_store_explicit(&theSlot->key, 0, memory_order_release);
+	}
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark IO
+//==================================================================================================
+
+bool VocanaMixBus_Mix(VocanaMixBus* inMixBus, VocanaRingBuffer* inRingBuffer, uint32_t inClientID, uint64_t inFrame, const float* inFrames, uint32_t inFrameCount)
+{
+	if(inMixBus->accumulator == NULL || inFrames == NULL || inFrameCount == 0)
+	{
+		return false;
+	}
+
+	if(inFrameCount > inMixBus->maxFrames)
+	{
+		++inMixBus->droppedWrites;
+		return false;
+	}
+
+	//	the HAL's own WriteMix, or a client the table had no room for
+	VocanaMixBusSlot* theSlot = mix_bus_find_slot(inMixBus, inClientID);
+	if(theSlot == NULL)
+	{
+		theSlot = &inMixBus->anonymous;
+	}
+
+	//	a write for a different range closes whatever cycle was open
+	if(inMixBus->hasCycle && (inFrame != inMixBus->cycleFrame || inFrameCount != inMixBus->cycleFrameCount))
+	{
+		mix_bus_close_cycle(inMixBus, inRingBuffer);
+	}
+
+	size_t theSampleCount = (size_t)inFrameCount * inMixBus->channelCount;
+	if(!inMixBus->hasCycle)
+	{
+		memcpy(inMixBus->accumulator, inFrames, theSampleCount * sizeof(float));
+		inMixBus->hasCycle = true;
+		inMixBus->isPublished = false;
+		inMixBus->cycleFrame = inFrame;
+		inMixBus->cycleFrameCount = inFrameCount;
+	}
+	else if(atomic_load_explicit(&theSlot->lastFrame, memory_order_relaxed) == inFrame)
+	{
+		//	the client already wrote this cycle; adding it twice would double it in the mix
+		++inMixBus->droppedWrites;
+		return false;
+	}
+	else if(inMixBus->isPublished && inMixBus->processProc != NULL)
+	{
+		//	the processor has already taken this cycle in and can't take it twice, so a late
+		//	writer only counts towards how many to wait for next time
+		++inMixBus->droppedWrites;
+		atomic_store_explicit(&theSlot->lastFrame, inFrame, memory_order_relaxed);
+		++inMixBus->contributions;
+		return false;
+	}
+	else
+	{
+		mix_bus_add(inMixBus->accumulator, inFrames, theSampleCount);
+		inMixBus->isPublished = false;
+	}
+
+	atomic_store_explicit(&theSlot->lastFrame, inFrame, memory_order_relaxed);
+	++inMixBus->contributions;
+	return true;
+}
+
+void VocanaMixBus_EndMix(VocanaMixBus* inMixBus, VocanaRingBuffer* inRingBuffer)
+{
+	if(inMixBus->hasCycle && !inMixBus->isPublished && inMixBus->contributions >= inMixBus->expectedContributions)
+	{
+		mix_bus_publish(inMixBus, inRingBuffer);
+	}
+}
+
+void VocanaMixBus_Flush(VocanaMixBus* inMixBus, VocanaRingBuffer* inRingBuffer, uint64_t inFrame)
+{
+	if(inMixBus->hasCycle && inMixBus->cycleFrame != inFrame)
+	{
+		mix_bus_close_cycle(inMixBus, inRingBuffer);
+	}
+}
+
+uint32_t VocanaMixBus_Read(VocanaMixBus* inMixBus, VocanaRingBuffer* const* inRingBuffers, uint32_t inRingBufferCount, uint64_t inFrame, float* outFrames, uint32_t inFrameCount)
+{
+	size_t theSampleCount = (size_t)inFrameCount * inMixBus->channelCount;
+	uint32_t theMostFrames = 0;
+	bool hasSignal = false;
+	for(uint32_t r = 0; r < inRingBufferCount; r++)
+	{
+		if(inRingBuffers[r] == NULL)
+		{
+			continue;
+		}
+		if(!hasSignal)
+		{
+			//	the first ring with anything in it is read in place, already clipped when published
+			theMostFrames = VocanaRingBuffer_Read(inRingBuffers[r], inFrame, outFrames, inFrameCount);
+			hasSignal = theMostFrames > 0;
+			continue;
+		}
+
+		//	each further one goes through the scratch a bus-sized chunk at a time, and the sum is
+		//	clipped again on its way back
+		for(uint32_t theDone = 0; theDone < inFrameCount; )
+		{
+			uint32_t theChunk = inFrameCount - theDone < inMixBus->maxFrames ? inFrameCount - theDone : inMixBus->maxFrames;
+			float* theOut = outFrames + (size_t)theDone * inMixBus->channelCount;
+			uint32_t theFrames = VocanaRingBuffer_Read(inRingBuffers[r], inFrame + theDone, inMixBus->output, theChunk);
+			if(theFrames > 0)
+			{
+				size_t theChunkSamples = (size_t)theChunk * inMixBus->channelCount;
+				mix_bus_add(inMixBus->output, theOut, theChunkSamples);
+				inMixBus->clippedSamples += mix_bus_clip(inMixBus->output, theOut, theChunkSamples, inMixBus->clipLevel);
+				theMostFrames = theFrames > theMostFrames ? theFrames : theMostFrames;
+			}
+			theDone += theChunk;
+		}
+	}
+	if(!hasSignal)
+	{
+		memset(outFrames, 0, theSampleCount * sizeof(float));
+	}
+	return theMostFrames;
+}
@@ -0,0 +1,167 @@
+/*
+     File: VocanaMixBus.h
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Multi-client output mixing for VocanaVirtualDevice.
+
+ */
+/*==================================================================================================
+	VocanaMixBus.h
+==================================================================================================*/
+
+#ifndef VocanaMixBus_h
+#define VocanaMixBus_h
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include "VocanaRingBuffer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaMixBus
+//==================================================================================================
+
+//	The mix bus sums the WriteMix buffers of one device's IO cycle into one cycle accumulator
+//	instead of letting each overwrite the ring, and publishes the clipped sum into the ring once
+//	the cycle's writers are all in.
+//
+//	The real HAL mixes its clients itself and calls WriteMix once per IO cycle with that mix, and
+//	the client ID it passes need not be one AddDeviceClient registered. Hosts that hand over each
+//	client's output in a WriteMix of its own, like the HAL simulator, get the per-client summing
+//	below. A write from a client ID with no slot is taken as the cycle's anonymous writer, so under
+//	the real HAL the bus falls back to one writer per cycle and publishes at the first EndMix.
+//
+//	Each client that writes gets a slot, keyed by its HAL client ID, that remembers which cycle it
+//	last contributed to. The first contribution to a cycle is copied into the accumulator and the
+//	rest are added to it, so a cycle costs one pass over each client's buffer and nothing more.
+//	The bus does not know how many clients will write in a cycle, so it expects as many as wrote
+//	in the previous one and publishes at the EndMix that reaches that count. A cycle with fewer
+//	writers (a client just stopped) is published when the next cycle starts, which is still well
+//	before ReadInput gets to it; a writer that arrives after its cycle was published (a client
+//	just started) is added in and the cycle is published again.
+//
+//	A bus and the ring it publishes into belong to one device, and so to the one IO thread the HAL
+//	runs that device on: the ring has a single producer. A device whose input also plays back
+//	what other devices wrote reads their rings next to its own with VocanaMixBus_Read, which sums
+//	them in this bus's scratch on the reading thread.
+//
+//	A bus can also run a processor over each cycle's mix as it is published, after clipping and
+//	before it goes into the ring, so whatever reads the ring hears the processed signal. A
+//	processor is a stream that can only take each cycle in once, so with one set a published cycle
+//	is final: a writer arriving after it counts towards the writers expected next cycle, but its
+//	buffer is dropped rather than published again.
+//
+//	The slot table is claimed and released from the HAL's client calls with atomic operations;
+//	everything else belongs to the device's IO thread. Nothing on the IO path allocates, locks or
+//	blocks. Like VocanaRingBuffer, nothing in this file depends on CoreAudio.
+
+enum
+{
+	kVocanaMixBus_MaxClients    = 64,
+};
+
+typedef struct VocanaMixBusSlot
+{
+	//	client ID + 1, or 0 for a free slot
+	_Atomic uint64_t                                            key;
+
+	//	output sample time of the last cycle this client contributed to
+	_Atomic uint64_t                                            lastFrame;
+} VocanaMixBusSlot;
+
+//	Processes inFrameCount frames of a published mix in place, at most the bus's maxFrames, for the
+//	cycle at output sample time inFrame. Runs on the device's IO thread and must be real-time safe.
+typedef void (*VocanaMixBusProcessProc)(void* inContext, uint64_t inFrame, float* ioFrames, uint32_t inFrameCount);
+
+typedef struct VocanaMixBus
+{
+	//	claimed by the client calls, read by the IO thread
+	_Alignas(kVocanaRingBuffer_CacheLineSize) VocanaMixBusSlot  slots[kVocanaMixBus_MaxClients];
+
+	//	IO thread only; the slot of the writers with no slot of their own
+	_Alignas(kVocanaRingBuffer_CacheLineSize) VocanaMixBusSlot  anonymous;
+	float*                                                      accumulator;
+	float*                                                      output;
+	uint64_t                                                    cycleFrame;
+	uint32_t                                                    cycleFrameCount;
+	uint32_t                                                    contributions;
+	uint32_t                                                    expectedContributions;
+	bool                                                        hasCycle;
+	bool                                                        isPublished;
+
+	//	set between runs of IO, like the channel count
+	VocanaMixBusProcessProc                                     processProc;
+	void*                                                       processContext;
+
+	//	diagnostics, IO thread only
+	uint64_t                                                    clippedSamples;
+	uint64_t                                                    droppedWrites;
+
+	//	immutable between Init and Teardown, but for SetChannelCount
+	uint32_t                                                    maxFrames;
+	uint32_t                                                    channelCount;
+	float                                                       clipLevel;
+} VocanaMixBus;
+
+//	Allocates the accumulator for writes of up to inMaxFrames frames of inChannelCount channels.
+//	The mixed signal is hard limited to +/- inClipLevel. Returns 0 on success or an errno value.
+//	Not real-time safe.
+int         VocanaMixBus_Init(VocanaMixBus* inMixBus, uint32_t inMaxFrames, uint32_t inChannelCount, float inClipLevel);
+
+//	Releases the accumulator. The caller must guarantee that no IO thread is still using the bus.
+void        VocanaMixBus_Teardown(VocanaMixBus* inMixBus);
+
+//	Reallocates the accumulator for inChannelCount channels, keeping the client slots, for a
+//	device configuration change. The bus is left as it was if the allocation fails. Returns 0,
+//	EINVAL or ENOMEM. The caller must guarantee that no IO thread is using the bus.
+int         VocanaMixBus_SetChannelCount(VocanaMixBus* inMixBus, uint32_t inChannelCount);
+
+//	Forgets any unpublished cycle. The client slots are kept. Must not run concurrently with the
+//	IO calls.
+void        VocanaMixBus_Reset(VocanaMixBus* inMixBus);
+
+//	Sets the processor every published mix goes through, or none if inProc is NULL. Must not run
+//	concurrently with the IO calls.
+void        VocanaMixBus_SetProcessor(VocanaMixBus* inMixBus, VocanaMixBusProcessProc inProc, void* inContext);
+
+//	Claims a slot for the client ahead of its first write. Returns false if every slot is taken,
+//	in which case the client writes as the anonymous writer. Real-time safe, but meant for
+//	AddDeviceClient.
+bool        VocanaMixBus_AddClient(VocanaMixBus* inMixBus, uint32_t inClientID);
+
+//	Releases the client's slot.
+void        VocanaMixBus_RemoveClient(VocanaMixBus* inMixBus, uint32_t inClientID);
+
+//	IO side. Adds one client's WriteMix buffer for the cycle at output sample time inFrame. A
+//	pending cycle for any other sample time is published into inRingBuffer first. A client with
+//	no slot writes as the anonymous writer. Writes larger than the bus or repeated within a cycle
+//	are dropped and return false. Real-time safe.
+bool        VocanaMixBus_Mix(VocanaMixBus* inMixBus, VocanaRingBuffer* inRingBuffer, uint32_t inClientID, uint64_t inFrame, const float* inFrames, uint32_t inFrameCount);
+
+//	IO side. A client's WriteMix is over; publishes the cycle if all the expected writers are in.
+//	Real-time safe.
+void        VocanaMixBus_EndMix(VocanaMixBus* inMixBus, VocanaRingBuffer* inRingBuffer);
+
+//	IO side. Publishes a pending cycle unless it is the cycle at output sample time inFrame, which
+//	may still have writers to come. Call before reading the ring. Real-time safe.
+void        VocanaMixBus_Flush(VocanaMixBus* inMixBus, VocanaRingBuffer* inRingBuffer, uint64_t inFrame);
+
+//	IO side. Reads inFrameCount frames at sample time inFrame from each of the inRingBufferCount
+//	rings and stores their clipped sum in outFrames; NULL rings are skipped as silent. The rings
+//	may belong to other devices' buses, but the sum is formed in this bus's scratch, so only its
+//	own device's IO thread may call this. Returns the most frames any one ring had published, so
+//	0 means outFrames is silence. Real-time safe.
+uint32_t    VocanaMixBus_Read(VocanaMixBus* inMixBus, VocanaRingBuffer* const* inRingBuffers, uint32_t inRingBufferCount, uint64_t inFrame, float* outFrames, uint32_t inFrameCount);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VocanaMixBus_h */
@@ -0,0 +1,266 @@
+/*
+     File: VocanaPipeline.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Fixed-latency alignment of asynchronously processed audio for the Vocana HAL plug-ins.
+
+ */
+/*==================================================================================================
+	VocanaPipeline.c
+==================================================================================================*/
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include "VocanaPipeline.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Delay Lines
+//==================================================================================================
+
+static void pipeline_line_write(const VocanaPipeline* inPipeline, float* ioLine, uint64_t inSampleTime, const float* inFrames, uint32_t inFrameCount)
+{
+	uint32_t theChannels = inPipeline->channelCount;
+	uint32_t theOffset = (uint32_t)(inSampleTime & inPipeline->frameMask);
+	uint32_t theFirst = inPipeline->capacityFrames - theOffset;
+	theFirst = theFirst < inFrameCount ? theFirst : inFrameCount;
+	memcpy(ioLine + (size_t)theOffset * theChannels, inFrames, (size_t)theFirst * theChannels * sizeof(float));
+	memcpy(ioLine, inFrames + (size_t)theFirst * theChannels, (size_t)(inFrameCount - theFirst) * theChannels * sizeof(float));
+}
+
+static void pipeline_line_read(const VocanaPipeline* inPipeline, const float* inLine, uint64_t inSampleTime, float* outFrames, uint32_t inFrameCount)
+{
+	uint32_t theChannels = inPipeline->channelCount;
+	uint32_t theOffset = (uint32_t)(inSampleTime & inPipeline->frameMask);
+	uint32_t theFirst = inPipeline->capacityFrames - theOffset;
+	theFirst = theFirst < inFrameCount ? theFirst : inFrameCount;
+	memcpy(outFrames, inLine + (size_t)theOffset * theChannels, (size_t)theFirst * theChannels * sizeof(float));
+	memcpy(outFrames + (size_t)theFirst * theChannels, inLine, (size_t)(inFrameCount - theFirst) * theChannels * sizeof(float));
+}
+
+//	Reads what the line holds of [inSampleTime, inSampleTime + inFrameCount) and silence for the
+//	rest.
+static void pipeline_line_read_window(const VocanaPipeline* inPipeline, const float* inLine, uint64_t inBegin, uint64_t inEnd, uint64_t inSampleTime, float* outFrames, uint32_t inFrameCount)
+{
+	uint64_t theEnd = inSampleTime + inFrameCount;
+	uint64_t theFrom = inSampleTime > inBegin ? inSampleTime : inBegin;
+	uint64_t theTo = theEnd < inEnd ? theEnd : inEnd;
+	if(theFrom >= theTo)
+	{
+		memset(outFrames, 0, (size_t)inFrameCount * inPipeline->channelCount * sizeof(float));
+		return;
+	}
+
+	uint32_t theChannels = inPipeline->channelCount;
+	uint32_t theLead = (uint32_t)(theFrom - inSampleTime);
+	uint32_t theCount = (uint32_t)(theTo - theFrom);
+	memset(outFrames, 0, (size_t)theLead * theChannels * sizeof(float));
+	pipeline_line_read(inPipeline, inLine, theFrom, outFrames + (size_t)theLead * theChannels, theCount);
+	memset(outFrames + (size_t)(theLead + theCount) * theChannels, 0, (size_t)(inFrameCount - theLead - theCount) * theChannels * sizeof(float));
+}
+
+//	Extends the window [ioBegin, ioEnd) by a write at inSampleTime, starting it over if the write
+//	isn't contiguous with it, and keeps it within the capacity of the line.
+static void pipeline_window_extend(const VocanaPipeline* inPipeline, uint64_t* ioBegin, uint64_t* ioEnd, uint64_t inSampleTime, uint32_t inFrameCount)
+{
+	if(inSampleTime != *ioEnd || *ioBegin == *ioEnd)
+	{
+		*ioBegin = inSampleTime;
+	}
+	*ioEnd = inSampleTime + inFrameCount;
+	if(*ioEnd - *ioBegin > inPipeline->capacityFrames)
+	{
+		*ioBegin = *ioEnd - inPipeline->capacityFrames;
+	}
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaPipeline
+//==================================================================================================
+
+int VocanaPipeline_Init(VocanaPipeline* outPipeline, uint32_t inChannelCount, uint32_t inMaxFrames, uint32_t inLatencyFrames, uint32_t inFadeFrames)
+{
+	memset(outPipeline, 0, sizeof(*outPipeline));
+	if(inChannelCount == 0 || inMaxFrames == 0 || inFadeFrames == 0 || inLatencyFrames > (1u << 20) || inMaxFrames > (1u << 20))
+	{
+		return EINVAL;
+	}
+
+	//	a reply can land as early as the cycle it answers and is read latencyFrames after that
+	uint32_t theCapacity = 1;
+	while(theCapacity < inLatencyFrames + 2 * inMaxFrames)
+	{
+		theCapacity <<= 1;
+	}
+
+	size_t theLineBytes = (size_t)theCapacity * inChannelCount * sizeof(float);
+	outPipeline->dry = (float*)calloc(1, theLineBytes);
+	outPipeline->wet = (float*)calloc(1, theLineBytes);
+	outPipeline->lastOutput = (float*)calloc(2 * inChannelCount, sizeof(float));
+	if(outPipeline->dry == NULL || outPipeline->wet == NULL || outPipeline->lastOutput == NULL)
+	{
+		VocanaPipeline_Teardown(outPipeline);
+		return ENOMEM;
+	}
+	outPipeline->fadeOffset = outPipeline->lastOutput + inChannelCount;
+	outPipeline->capacityFrames = theCapacity;
+	outPipeline->frameMask = theCapacity - 1;
+	outPipeline->channelCount = inChannelCount;
+	outPipeline->maxFrames = inMaxFrames;
+	outPipeline->latencyFrames = inLatencyFrames;
+	outPipeline->fadeFrames = inFadeFrames;
+	VocanaPipeline_Reset(outPipeline);
+	return 0;
+}
+
+void VocanaPipeline_Teardown(VocanaPipeline* inPipeline)
+{
+	free(inPipeline->dry);
+	free(inPipeline->wet);
+	free(inPipeline->lastOutput);
+	memset(inPipeline, 0, sizeof(*inPipeline));
+}
+
+void VocanaPipeline_Reset(VocanaPipeline* inPipeline)
+{
+	inPipeline->dryBegin = inPipeline->dryEnd = 0;
+	inPipeline->wetBegin = inPipeline->wetEnd = 0;
+	inPipeline->renderedEnd = 0;
+	inPipeline->wasWet = false;
+	inPipeline->fadePosition = inPipeline->fadeFrames;
+	memset(inPipeline->lastOutput, 0, 2 * (size_t)inPipeline->channelCount * sizeof(float));
+	memset(&inPipeline->statistics, 0, sizeof(inPipeline->statistics));
+}
+
+void VocanaPipeline_PushDry(VocanaPipeline* inPipeline, uint64_t inSampleTime, const float* inFrames, uint32_t inFrameCount)
+{
+	if(inFrameCount == 0 || inFrameCount > inPipeline->maxFrames)
+	{
+		return;
+	}
+	pipeline_line_write(inPipeline, inPipeline->dry, inSampleTime, inFrames, inFrameCount);
+	pipeline_window_extend(inPipeline, &inPipeline->dryBegin, &inPipeline->dryEnd, inSampleTime, inFrameCount);
+}
+
+void VocanaPipeline_PushWet(VocanaPipeline* inPipeline, uint64_t inSampleTime, const float* inFrames, uint32_t inFrameCount)
+{
+	if(inFrameCount == 0 || inFrameCount > inPipeline->maxFrames)
+	{
+		return;
+	}
+
+	//	the part of a reply that has already been played dry is no use any more
+	if(inSampleTime < inPipeline->renderedEnd)
+	{
+		uint64_t theLate = inPipeline->renderedEnd - inSampleTime;
+		if(theLate >= inFrameCount)
+		{
+			inPipeline->statistics.lateFrames += inFrameCount;
+			return;
+		}
+		inPipeline->statistics.lateFrames += theLate;
+		inSampleTime += theLate;
+		inFrames += (size_t)theLate * inPipeline->channelCount;
+		inFrameCount -= (uint32_t)theLate;
+	}
+
+	pipeline_line_write(inPipeline, inPipeline->wet, inSampleTime, inFrames, inFrameCount);
+	pipeline_window_extend(inPipeline, &inPipeline->wetBegin, &inPipeline->wetEnd, inSampleTime, inFrameCount);
+}
+
+bool VocanaPipeline_Render(VocanaPipeline* inPipeline, uint64_t inSampleTime, float* outFrames, uint32_t inFrameCount)
+{
+	uint32_t theChannels = inPipeline->channelCount;
+	if(inFrameCount == 0 || inFrameCount > inPipeline->maxFrames)
+	{
+		return false;
+	}
+	if(inSampleTime < inPipeline->latencyFrames)
+	{
+		memset(outFrames, 0, (size_t)inFrameCount * theChannels * sizeof(float));
+		inPipeline->wasWet = false;
+		inPipeline->statistics.dryCycles++;
+		return false;
+	}
+
+	uint64_t theFrom = inSampleTime - inPipeline->latencyFrames;
+	bool isWet = theFrom >= inPipeline->wetBegin && theFrom + inFrameCount <= inPipeline->wetEnd;
+	uint32_t theFade = inPipeline->fadeFrames;
+
+	if(isWet && inPipeline->wasWet && inPipeline->fadePosition >= theFade)
+	{
+		pipeline_line_read(inPipeline, inPipeline->wet, theFrom, outFrames, inFrameCount);
+	}
+	else
+	{
+		pipeline_line_read_window(inPipeline, inPipeline->dry, inPipeline->dryBegin, inPipeline->dryEnd, theFrom, outFrames, inFrameCount);
+
+		if(isWet != inPipeline->wasWet)
+		{
+			inPipeline->fadePosition = 0;
+			if(!isWet)
+			{
+				//	the step from the last wet frame played to the first dry one
+				for(uint32_t c = 0; c < theChannels; c++)
+				{
+					inPipeline->fadeOffset[c] = inPipeline->lastOutput[c] - outFrames[c];
+				}
+			}
+		}
+
+		if(isWet)
+		{
+			//	crossfade from dry to wet, then plain wet for the rest of the cycle
+			uint32_t theFadeCount = theFade - inPipeline->fadePosition;
+			theFadeCount = theFadeCount < inFrameCount ? theFadeCount : inFrameCount;
+			for(uint32_t i = 0; i < inFrameCount; i++)
+			{
+				const float* theWet = inPipeline->wet + (size_t)((theFrom + i) & inPipeline->frameMask) * theChannels;
+				float* theOut = outFrames + (size_t)i * theChannels;
+				float theGain = i < theFadeCount ? (float)(inPipeline->fadePosition + i + 1) / (float)theFade : 1.0f;
+				for(uint32_t c = 0; c < theChannels; c++)
+				{
+					theOut[c] += (theWet[c] - theOut[c]) * theGain;
+				}
+			}
+			inPipeline->fadePosition += theFadeCount;
+		}
+		else if(inPipeline->fadePosition < theFade)
+		{
+			//	decay the step away
+			uint32_t theFadeCount = theFade - inPipeline->fadePosition;
+			theFadeCount = theFadeCount < inFrameCount ? theFadeCount : inFrameCount;
+			for(uint32_t i = 0; i < theFadeCount; i++)
+			{
+				float* theOut = outFrames + (size_t)i * theChannels;
+				float theGain = 1.0f - (float)(inPipeline->fadePosition + i + 1) / (float)theFade;
+				for(uint32_t c = 0; c < theChannels; c++)
+				{
+					theOut[c] += inPipeline->fadeOffset[c] * theGain;
+				}
+			}
+			inPipeline->fadePosition += theFadeCount;
+		}
+	}
+
+	memcpy(inPipeline->lastOutput, outFrames + (size_t)(inFrameCount - 1) * theChannels, theChannels * sizeof(float));
+	inPipeline->renderedEnd = theFrom + inFrameCount;
+	inPipeline->wasWet = isWet;
+	if(isWet)
+	{
+		inPipeline->statistics.wetCycles++;
+	}
+	else
+	{
+		inPipeline->statistics.dryCycles++;
+	}
+	return isWet;
+}
@@ -0,0 +1,109 @@
+/*
+     File: VocanaPipeline.h
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Fixed-latency alignment of asynchronously processed audio for the Vocana HAL plug-ins.
+
+ */
+/*==================================================================================================
+	VocanaPipeline.h
+==================================================================================================*/
+
+#ifndef VocanaPipeline_h
+#define VocanaPipeline_h
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaPipeline
+//==================================================================================================
+
+//	When the plug-in waits for each cycle's processed audio within the cycle, any hiccup in the
+//	processor is a dropout. In pipelined mode the plug-in instead sends cycle N off without
+//	waiting and plays whatever was processed latencyFrames earlier, so the processor has that long
+//	to answer and the IO thread never blocks. The device declares latencyFrames as its latency, so
+//	the added delay is fixed and known to the HAL and the apps rather than something that varies
+//	with the processor's load.
+//
+//	The pipeline keeps two delay lines addressed by sample time, the same way the ring buffer is:
+//	the dry input as the plug-in saw it and the processed (wet) audio as replies arrive. Rendering
+//	sample time T reads both at T - latencyFrames. If the wet audio for the whole cycle is there
+//	it is played; otherwise the cycle falls back to the dry audio. Switching between the two is
+//	smoothed so a late reply costs the processing for a cycle but never a click: going from dry to
+//	wet crossfades over fadeFrames, and going from wet to dry, where the wet audio the crossfade
+//	would need is exactly what's missing, offsets the dry signal by the step between the last wet
+//	sample and the first dry one and lets that offset decay to nothing over fadeFrames.
+//
+//	All the work is done on the IO thread, so nothing here is atomic or locked. Nothing in this
+//	file depends on CoreAudio.
+
+typedef struct VocanaPipelineStatistics
+{
+	uint64_t                wetCycles;
+	uint64_t                dryCycles;
+	uint64_t                lateFrames;     //	wet frames that arrived after they were due
+} VocanaPipelineStatistics;
+
+typedef struct VocanaPipeline
+{
+	float*                  dry;
+	float*                  wet;
+	float*                  lastOutput;     //	one frame
+	float*                  fadeOffset;     //	one frame, the step being decayed after a fall back to dry
+	uint64_t                frameMask;
+	uint32_t                capacityFrames;
+	uint32_t                channelCount;
+	uint32_t                maxFrames;
+	uint32_t                latencyFrames;
+	uint32_t                fadeFrames;
+
+	//	the sample times each delay line holds, [begin, end)
+	uint64_t                dryBegin;
+	uint64_t                dryEnd;
+	uint64_t                wetBegin;
+	uint64_t                wetEnd;
+	uint64_t                renderedEnd;
+	uint32_t                fadePosition;   //	frames into the current transition, fadeFrames when there is none
+	bool                    wasWet;
+
+	VocanaPipelineStatistics statistics;
+} VocanaPipeline;
+
+//	Allocates delay lines for cycles of up to inMaxFrames frames of inChannelCount channels played
+//	inLatencyFrames late, smoothing transitions over inFadeFrames. Returns 0 on success or an errno
+//	value. Not real-time safe.
+int         VocanaPipeline_Init(VocanaPipeline* outPipeline, uint32_t inChannelCount, uint32_t inMaxFrames, uint32_t inLatencyFrames, uint32_t inFadeFrames);
+
+void        VocanaPipeline_Teardown(VocanaPipeline* inPipeline);
+
+//	Forgets everything buffered, for when IO starts. Real-time safe.
+void        VocanaPipeline_Reset(VocanaPipeline* inPipeline);
+
+//	Records the dry input for a cycle. Real-time safe.
+void        VocanaPipeline_PushDry(VocanaPipeline* inPipeline, uint64_t inSampleTime, const float* inFrames, uint32_t inFrameCount);
+
+//	Records processed audio that has arrived. Frames that are already too late to be played are
+//	dropped. Real-time safe.
+void        VocanaPipeline_PushWet(VocanaPipeline* inPipeline, uint64_t inSampleTime, const float* inFrames, uint32_t inFrameCount);
+
+//	Writes the audio to play at inSampleTime, which is what came in latencyFrames earlier. Returns
+//	true if the cycle is processed audio. Real-time safe.
+bool        VocanaPipeline_Render(VocanaPipeline* inPipeline, uint64_t inSampleTime, float* outFrames, uint32_t inFrameCount);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VocanaPipeline_h */
@@ -0,0 +1,300 @@
+/*
+     File: VocanaProcessor.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ In-process audio processors for the Vocana HAL plug-ins, and the stage that runs them on the IO
+ thread within a time budget.
+
+ */
+/*==================================================================================================
+	VocanaProcessor.c
+==================================================================================================*/
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include "VocanaProcessor.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Helpers
+//==================================================================================================
+
+static uint64_t processor_stage_now_nanoseconds(void)
+{
+	struct timespec theTime;
+	clock_gettime(CLOCK_MONOTONIC, &theTime);
+	return (uint64_t)theTime.tv_sec * 1000000000ull + (uint64_t)theTime.tv_nsec;
+}
+
+static void processor_stage_line_write(VocanaProcessorStage* inStage, uint64_t inFrame, const float* inFrames, uint32_t inFrameCount)
+{
+	uint32_t theChannels = inStage->channelCount;
+	uint64_t theCapacity = inStage->frameMask + 1;
+	uint64_t theOffset = inFrame & inStage->frameMask;
+	uint64_t theFirst = theCapacity - theOffset < inFrameCount ? theCapacity - theOffset : inFrameCount;
+	memcpy(inStage->dryLine + theOffset * theChannels, inFrames, (size_t)theFirst * theChannels * sizeof(float));
+	memcpy(inStage->dryLine, inFrames + theFirst * theChannels, (size_t)(inFrameCount - theFirst) * theChannels * sizeof(float));
+}
+
+//	The line starts out silent and is twice as long as anything it has to hold, so reading before
+//	the first frame (inFrame wraps around) finds silence.
+static void processor_stage_line_read(const VocanaProcessorStage* inStage, uint64_t inFrame, float* outFrames, uint32_t inFrameCount)
+{
+	uint32_t theChannels = inStage->channelCount;
+	uint64_t theCapacity = inStage->frameMask + 1;
+	uint64_t theOffset = inFrame & inStage->frameMask;
+	uint64_t theFirst = theCapacity - theOffset < inFrameCount ? theCapacity - theOffset : inFrameCount;
+	memcpy(outFrames, inStage->dryLine + theOffset * theChannels, (size_t)theFirst * theChannels * sizeof(float));
+	memcpy(outFrames + theFirst * theChannels, inStage->dryLine, (size_t)(inFrameCount - theFirst) * theChannels * sizeof(float));
+}
+
+static void processor_stage_enter(VocanaProcessorStage* inStage, VocanaProcessorStageState inState)
+{
+	inStage->state = inState;
+	inStage->stateFrames = 0;
+	inStage->overrunStreak = 0;
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaProcessorStage
+//==================================================================================================
+
+int VocanaProcessorStage_Init(VocanaProcessorStage* outStage, const VocanaProcessorInterface* inInterface, const VocanaProcessorConfiguration* inConfiguration, double inBudgetFraction, uint32_t inBackoffFrames, uint32_t inFadeFrames)
+{
+	if(outStage == NULL || inInterface == NULL || inConfiguration == NULL)
+	{
+		return EINVAL;
+	}
+	memset(outStage, 0, sizeof(*outStage));
+	if(inInterface->version != kVocanaProcessor_InterfaceVersion)
+	{
+		return ENOTSUP;
+	}
+	if(inConfiguration->channelCount == 0 || inConfiguration->maxFrames == 0 || inConfiguration->maxFrames > (1u << 20) || !(inConfiguration->sampleRate > 0.0) || !(inBudgetFraction > 0.0) || inFadeFrames == 0)
+	{
+		return EINVAL;
+	}
+
+	int theError = inInterface->create(inConfiguration, &outStage->instance);
+	if(theError != 0)
+	{
+		outStage->instance = NULL;
+		return theError;
+	}
+	outStage->interface = inInterface;
+
+	uint32_t theLatency = inInterface->latency(outStage->instance);
+	if(theLatency > (1u << 20))
+	{
+		VocanaProcessorStage_Teardown(outStage);
+		return EINVAL;
+	}
+
+	uint64_t theCapacity = 1;
+	while(theCapacity < 2 * ((uint64_t)theLatency + inConfiguration->maxFrames))
+	{
+		theCapacity <<= 1;
+	}
+
+	uint32_t theChannels = inConfiguration->channelCount;
+	outStage->dryLine = (float*)calloc((size_t)theCapacity * theChannels, sizeof(float));
+	outStage->processed = (float*)calloc((size_t)inConfiguration->maxFrames * theChannels, sizeof(float));
+	outStage->lastOutput = (float*)calloc(2 * (size_t)theChannels, sizeof(float));
+	if(outStage->dryLine == NULL || outStage->processed == NULL || outStage->lastOutput == NULL)
+	{
+		VocanaProcessorStage_Teardown(outStage);
+		return ENOMEM;
+	}
+	outStage->fadeOffset = outStage->lastOutput + theChannels;
+	outStage->frameMask = theCapacity - 1;
+	outStage->channelCount = theChannels;
+	outStage->maxFrames = inConfiguration->maxFrames;
+	outStage->latencyFrames = theLatency;
+	outStage->fadeFrames = inFadeFrames;
+	outStage->backoffFrames = inBackoffFrames;
+	outStage->budgetNanosecondsPerFrame = inBudgetFraction * 1.0e9 / inConfiguration->sampleRate;
+	VocanaProcessorStage_Reset(outStage);
+	return 0;
+}
+
+void VocanaProcessorStage_Teardown(VocanaProcessorStage* inStage)
+{
+	if(inStage == NULL)
+	{
+		return;
+	}
+	if(inStage->interface != NULL && inStage->instance != NULL)
+	{
+		inStage->interface->destroy(inStage->instance);
+	}
+	free(inStage->dryLine);
+	free(inStage->processed);
+	free(inStage->lastOutput);
+	memset(inStage, 0, sizeof(*inStage));
+}
+
+void VocanaProcessorStage_Reset(VocanaProcessorStage* inStage)
+{
+	if(inStage->instance == NULL)
+	{
+		return;
+	}
+	inStage->interface->reset(inStage->instance);
+	memset(inStage->dryLine, 0, (size_t)(inStage->frameMask + 1) * inStage->channelCount * sizeof(float));
+	memset(inStage->lastOutput, 0, 2 * (size_t)inStage->channelCount * sizeof(float));
+	memset(&inStage->statistics, 0, sizeof(inStage->statistics));
+	inStage->inputFrames = 0;
+	inStage->fadePosition = inStage->fadeFrames;
+	inStage->fadingIn = false;
+	processor_stage_enter(inStage, kVocanaProcessorStage_Active);
+}
+
+uint32_t VocanaProcessorStage_GetLatency(const VocanaProcessorStage* inStage)
+{
+	return inStage->latencyFrames;
+}
+
+bool VocanaProcessorStage_Process(VocanaProcessorStage* inStage, const float* inFrames, float* outFrames, uint32_t inFrameCount)
+{
+	if(inStage->instance == NULL || inFrameCount == 0 || inFrameCount > inStage->maxFrames)
+	{
+		return false;
+	}
+	uint32_t theChannels = inStage->channelCount;
+	uint32_t theFade = inStage->fadeFrames;
+
+	//	the input has to be kept before anything is written, in case the buffers are the same
+	processor_stage_line_write(inStage, inStage->inputFrames, inFrames, inFrameCount);
+
+	if(inStage->state != kVocanaProcessorStage_Bypassed)
+	{
+		uint64_t theStart = processor_stage_now_nanoseconds();
+		inStage->interface->process(inStage->instance, inFrames, inStage->processed, inFrameCount);
+		uint64_t theElapsed = processor_stage_now_nanoseconds() - theStart;
+
+		inStage->statistics.worstNanoseconds = theElapsed > inStage->statistics.worstNanoseconds ? theElapsed : inStage->statistics.worstNanoseconds;
+		if((double)theElapsed > inStage->budgetNanosecondsPerFrame * inFrameCount)
+		{
+			inStage->statistics.overruns++;
+			inStage->overrunStreak++;
+		}
+		else
+		{
+			inStage->overrunStreak = 0;
+		}
+	}
+
+	bool isProcessed = inStage->state == kVocanaProcessorStage_Active;
+	if(isProcessed && !inStage->fadingIn)
+	{
+		memcpy(outFrames, inStage->processed, (size_t)inFrameCount * theChannels * sizeof(float));
+	}
+	else
+	{
+		processor_stage_line_read(inStage, inStage->inputFrames - inStage->latencyFrames, outFrames, inFrameCount);
+
+		if(isProcessed)
+		{
+			//	crossfade from the delayed input to the processor, then plain processor output
+			uint32_t theFadeCount = theFade - inStage->fadePosition;
+			theFadeCount = theFadeCount < inFrameCount ? theFadeCount : inFrameCount;
+			for(uint32_t i = 0; i < inFrameCount; i++)
+			{
+				const float* theProcessed = inStage->processed + (size_t)i * theChannels;
+				float* theOut = outFrames + (size_t)i * theChannels;
+				float theGain = i < theFadeCount ? (float)(inStage->fadePosition + i + 1) / (float)theFade : 1.0f;
+				for(uint32_t c = 0; c < theChannels; c++)
+				{
+					theOut[c] += (theProcessed[c] - theOut[c]) * theGain;
+				}
+			}
+			inStage->fadePosition += theFadeCount;
+			inStage->fadingIn = inStage->fadePosition < theFade;
+		}
+		else
+		{
+			if(inStage->state == kVocanaProcessorStage_Bypassed && inStage->stateFrames == 0)
+			{
+				//	the step from the last frame played to the first unprocessed one
+				for(uint32_t c = 0; c < theChannels; c++)
+				{
+					inStage->fadeOffset[c] = inStage->lastOutput[c] - outFrames[c];
+				}
+				inStage->fadePosition = 0;
+				inStage->fadingIn = false;
+			}
+			if(!inStage->fadingIn && inStage->fadePosition < theFade)
+			{
+				uint32_t theFadeCount = theFade - inStage->fadePosition;
+				theFadeCount = theFadeCount < inFrameCount ? theFadeCount : inFrameCount;
+				for(uint32_t i = 0; i < theFadeCount; i++)
+				{
+					float* theOut = outFrames + (size_t)i * theChannels;
+					float theGain = 1.0f - (float)(inStage->fadePosition + i + 1) / (float)theFade;
+					for(uint32_t c = 0; c < theChannels; c++)
+					{
+						theOut[c] += inStage->fadeOffset[c] * theGain;
+					}
+				}
+				inStage->fadePosition += theFadeCount;
+			}
+		}
+	}
+
+	memcpy(inStage->lastOutput, outFrames + (size_t)(inFrameCount - 1) * theChannels, theChannels * sizeof(float));
+	inStage->inputFrames += inFrameCount;
+	inStage->stateFrames += inFrameCount;
+	if(isProcessed)
+	{
+		inStage->statistics.processedCycles++;
+	}
+	else
+	{
+		inStage->statistics.bypassedCycles++;
+	}
+
+	switch(inStage->state)
+	{
+		case kVocanaProcessorStage_Active:
+			if(inStage->overrunStreak >= kVocanaProcessorStage_OverrunLimit)
+			{
+				inStage->statistics.bypasses++;
+				processor_stage_enter(inStage, kVocanaProcessorStage_Bypassed);
+			}
+			break;
+
+		case kVocanaProcessorStage_Bypassed:
+			if(inStage->stateFrames >= inStage->backoffFrames)
+			{
+				inStage->interface->reset(inStage->instance);
+				processor_stage_enter(inStage, kVocanaProcessorStage_Priming);
+			}
+			break;
+
+		case kVocanaProcessorStage_Priming:
+			if(inStage->overrunStreak >= kVocanaProcessorStage_OverrunLimit)
+			{
+				inStage->statistics.bypasses++;
+				processor_stage_enter(inStage, kVocanaProcessorStage_Bypassed);
+			}
+			else if(inStage->stateFrames >= inStage->latencyFrames)
+			{
+				//	everything the processor puts out from here on is based on real signal
+				processor_stage_enter(inStage, kVocanaProcessorStage_Active);
+				inStage->fadePosition = 0;
+				inStage->fadingIn = true;
+			}
+			break;
+	}
+
+	return isProcessed;
+}
@@ -0,0 +1,170 @@
+/*
+     File: VocanaProcessor.h
+
+ Copyright (C) 2024 Vocana Inc.
+
+ In-process audio processors for the Vocana HAL plug-ins, and the stage that runs them on the IO
+ thread within a time budget.
+
+ */
+/*==================================================================================================
+	VocanaProcessor.h
+==================================================================================================*/
+
+#ifndef VocanaProcessor_h
+#define VocanaProcessor_h
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaProcessorInterface
+//==================================================================================================
+
+//	A processor is anything that can clean up the device's audio inside the plug-in, on the IO
+//	thread, without a round trip to the app. It is described by a table of plain C functions so a
+//	processor can be written in any language that can export them, and so the stage below never
+//	needs to know what it is running. A processor works on interleaved float frames as a stream:
+//	each call hands it the next frames and it writes as many frames back, delayed by the fixed
+//	latency it reports.
+//
+//	create and destroy run outside the IO thread and may allocate. reset, latency and process run
+//	on the IO thread and must not allocate, lock or block.
+
+enum
+{
+	kVocanaProcessor_InterfaceVersion   = 1,
+};
+
+typedef struct VocanaProcessorConfiguration
+{
+	double                  sampleRate;
+	uint32_t                channelCount;
+	uint32_t                maxFrames;      //	the most frames a single process call hands over
+} VocanaProcessorConfiguration;
+
+typedef struct VocanaProcessorInterface
+{
+	uint32_t                version;        //	kVocanaProcessor_InterfaceVersion
+	const char*             name;
+
+	//	Returns 0 and the new instance, or an errno value.
+	int                     (*create)(const VocanaProcessorConfiguration* inConfiguration, void** outInstance);
+	void                    (*destroy)(void* inInstance);
+
+	//	Forgets the signal seen so far, as if the instance had just been created.
+	void                    (*reset)(void* inInstance);
+
+	//	How many frames late the output of process is relative to its input. Must not change over
+	//	the life of the instance.
+	uint32_t                (*latency)(void* inInstance);
+
+	//	Processes inFrameCount frames. inFrames and outFrames may be the same buffer.
+	void                    (*process)(void* inInstance, const float* inFrames, float* outFrames, uint32_t inFrameCount);
+} VocanaProcessorInterface;
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaProcessorStage
+//==================================================================================================
+
+//	The stage runs a processor on the IO thread and keeps it from ever costing the device a
+//	dropout. It times every call against a budget that is a fraction of the cycle's real-time
+//	duration. A single slow cycle is tolerated, but after kVocanaProcessorStage_OverrunLimit slow
+//	cycles in a row the stage stops calling the processor and plays the input instead, delayed by
+//	the processor's latency so the timing of the output doesn't change. After backing off for
+//	backoffFrames it resets the processor and runs it again, discarding its output until it has
+//	seen latency frames of signal, and then crossfades back to it.
+//
+//	Switching to the unprocessed signal can't crossfade, because the processed signal it would
+//	fade from is exactly what the stage stopped making, so it offsets the unprocessed signal by the
+//	step between the last processed frame and the first unprocessed one and decays that offset to
+//	nothing over fadeFrames, the same way VocanaPipeline falls back to dry audio.
+//
+//	Everything but Init and Teardown is real-time safe. Nothing in this file depends on CoreAudio.
+
+enum
+{
+	kVocanaProcessorStage_OverrunLimit  = 3,
+};
+
+typedef enum VocanaProcessorStageState
+{
+	kVocanaProcessorStage_Active        = 0,
+	kVocanaProcessorStage_Bypassed      = 1,
+	kVocanaProcessorStage_Priming       = 2,
+} VocanaProcessorStageState;
+
+typedef struct VocanaProcessorStageStatistics
+{
+	uint64_t                processedCycles;
+	uint64_t                bypassedCycles;
+	uint64_t                overruns;       //	cycles that went over the budget
+	uint64_t                bypasses;       //	times the stage gave up on the processor
+	uint64_t                worstNanoseconds;
+} VocanaProcessorStageStatistics;
+
+typedef struct VocanaProcessorStage
+{
+	const VocanaProcessorInterface* interface;
+	void*                   instance;
+
+	//	the input, kept so it can be played latencyFrames late when the processor is bypassed
+	float*                  dryLine;
+	float*                  processed;      //	maxFrames frames
+	float*                  lastOutput;     //	one frame
+	float*                  fadeOffset;     //	one frame, the step being decayed after a bypass
+	uint64_t                frameMask;
+	uint32_t                channelCount;
+	uint32_t                maxFrames;
+	uint32_t                latencyFrames;
+	uint32_t                fadeFrames;
+	uint32_t                backoffFrames;
+	double                  budgetNanosecondsPerFrame;
+
+	//	IO thread only
+	uint64_t                inputFrames;
+	VocanaProcessorStageState state;
+	uint32_t                overrunStreak;
+	uint64_t                stateFrames;    //	frames since the state last changed
+	uint32_t                fadePosition;   //	frames into the current transition, fadeFrames when there is none
+	bool                    fadingIn;
+
+	VocanaProcessorStageStatistics statistics;
+} VocanaProcessorStage;
+
+//	Creates an instance of inInterface for inConfiguration. Each cycle may spend inBudgetFraction
+//	of its real-time duration in the processor. When the stage gives up on the processor it waits
+//	inBackoffFrames before trying it again, and it smooths its transitions over inFadeFrames.
+//	Returns 0 on success or an errno value; ENOTSUP if the interface is of another version. Not
+//	real-time safe.
+int         VocanaProcessorStage_Init(VocanaProcessorStage* outStage, const VocanaProcessorInterface* inInterface, const VocanaProcessorConfiguration* inConfiguration, double inBudgetFraction, uint32_t inBackoffFrames, uint32_t inFadeFrames);
+
+//	Destroys the instance. The caller must guarantee that no IO thread is still using the stage.
+void        VocanaProcessorStage_Teardown(VocanaProcessorStage* inStage);
+
+//	Forgets the signal seen so far and puts the processor back in play, for when IO starts.
+void        VocanaProcessorStage_Reset(VocanaProcessorStage* inStage);
+
+//	The stage's output is this many frames late whether or not the processor is in play.
+uint32_t    VocanaProcessorStage_GetLatency(const VocanaProcessorStage* inStage);
+
+//	Processes inFrameCount frames, at most maxFrames. inFrames and outFrames may be the same buffer.
+//	Returns true if the output came from the processor, in full or in part.
+bool        VocanaProcessorStage_Process(VocanaProcessorStage* inStage, const float* inFrames, float* outFrames, uint32_t inFrameCount);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VocanaProcessor_h */
@@ -0,0 +1,402 @@
+/*
+     File: VocanaPropertyTable.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Declarative property tables for the Vocana HAL plug-ins.
+
+ */
+/*==================================================================================================
+	VocanaPropertyTable.c
+==================================================================================================*/
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include "VocanaPropertyTable.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Hashing
+//==================================================================================================
+
+enum
+{
+	kTable_UnusedSlot           = UINT16_MAX,
+	kTable_MaxEntries           = UINT16_MAX - 1,
+	kTable_MaxDisplacement      = UINT16_MAX,
+	kTable_SlotsPerBucketBits   = 2,
+	kTable_MinSlotBits          = 3,
+	kTable_MaxSlotBits          = 16,
+	kTable_SeedsPerSize         = 4,
+};
+
+//	an object's sentinel entry, which makes HasObject one more lookup
+static const uint32_t kTable_ObjectSelector = 0;
+
+static inline uint64_t table_key_hash(uint64_t inSeed, uint32_t inObjectID, uint32_t inSelector)
+{
+	//	one multiply; folding the high half into the low one gives both halves well mixed bits
+	uint64_t theHash = ((((uint64_t)inObjectID << 32) | inSelector) ^ inSeed) * 0x9E3779B97F4A7C15ull;
+	return theHash ^ (theHash >> 32);
+}
+
+static inline uint32_t table_bucket(uint64_t inHash, uint32_t inBucketShift)
+{
+	return (uint32_t)(inHash >> inBucketShift);
+}
+
+static inline uint32_t table_slot(uint64_t inHash, uint32_t inDisplacement, uint32_t inSlotShift)
+{
+	//	the displacement is xored in before the multiply, so every displacement scatters the
+	//	bucket's keys differently; the slot comes from the top bits of the product
+	return (((uint32_t)inHash ^ inDisplacement) * 0x9E3779B1u) >> inSlotShift;
+}
+
+static inline bool table_entry_is(const VocanaPropertyEntry* inEntry, uint32_t inObjectID, uint32_t inSelector)
+{
+	return inEntry->objectID == inObjectID && inEntry->selector == inSelector;
+}
+
+//	The first entry of the key, or NULL.
+static inline const VocanaPropertyEntry* table_lookup(const VocanaPropertyTable* inTable, uint32_t inObjectID, uint32_t inSelector)
+{
+	uint64_t theHash = table_key_hash(inTable->seed, inObjectID, inSelector);
+	uint32_t theDisplacement = inTable->displacements[table_bucket(theHash, inTable->bucketShift)];
+	uint16_t theIndex = inTable->slots[table_slot(theHash, theDisplacement, inTable->slotShift)];
+	if(theIndex == kTable_UnusedSlot || !table_entry_is(&inTable->entries[theIndex], inObjectID, inSelector))
+	{
+		return NULL;
+	}
+	return &inTable->entries[theIndex];
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Table
+//==================================================================================================
+
+int VocanaPropertyTable_Init(VocanaPropertyTable* inTable, uint32_t inCapacity)
+{
+	memset(inTable, 0, sizeof(*inTable));
+	if(inCapacity == 0 || inCapacity > kTable_MaxEntries)
+	{
+		return EINVAL;
+	}
+
+	inTable->entries = calloc(inCapacity, sizeof(VocanaPropertyEntry));
+	if(inTable->entries == NULL)
+	{
+		return ENOMEM;
+	}
+	inTable->entryCapacity = inCapacity;
+	return 0;
+}
+
+void VocanaPropertyTable_Teardown(VocanaPropertyTable* inTable)
+{
+	free(inTable->entries);
+	free(inTable->displacements);
+	free(inTable->slots);
+	memset(inTable, 0, sizeof(*inTable));
+}
+
+static bool table_contains(const VocanaPropertyTable* inTable, uint32_t inObjectID, uint32_t inSelector, uint32_t inScope)
+{
+	for(uint32_t i = 0; i < inTable->entryCount; i++)
+	{
+		const VocanaPropertyEntry* theEntry = &inTable->entries[i];
+		if(theEntry->objectID == inObjectID && theEntry->selector == inSelector && theEntry->scope == inScope)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+int VocanaPropertyTable_AddObject(VocanaPropertyTable* inTable, uint32_t inObjectID, const VocanaPropertySpec* inSpecs, uint32_t inSpecCount, VocanaPropertyProc inGetProc, VocanaPropertyProc inSetProc)
+{
+	if(inTable->isBuilt)
+	{
+		return EBUSY;
+	}
+	if(inTable->entryCapacity - inTable->entryCount < inSpecCount + 1)
+	{
+		return ENOSPC;
+	}
+	if(table_contains(inTable, inObjectID, kTable_ObjectSelector, kVocanaPropertyScope_Any))
+	{
+		return EEXIST;
+	}
+
+	//	check the whole class before adding any of it, so a failure leaves the table as it was
+	for(uint32_t i = 0; i < inSpecCount; i++)
+	{
+		if(inSpecs[i].selector == kTable_ObjectSelector)
+		{
+			return EINVAL;
+		}
+		for(uint32_t j = 0; j < i; j++)
+		{
+			if(inSpecs[j].selector == inSpecs[i].selector && inSpecs[j].scope == inSpecs[i].scope)
+			{
+				return EEXIST;
+			}
+		}
+	}
+
+	VocanaPropertyEntry* theEntry = &inTable->entries[inTable->entryCount];
+	theEntry->objectID = inObjectID;
+	theEntry->selector = kTable_ObjectSelector;
+	theEntry->scope = kVocanaPropertyScope_Any;
+	++theEntry;
+	for(uint32_t i = 0; i < inSpecCount; i++, theEntry++)
+	{
+		theEntry->objectID = inObjectID;
+		theEntry->selector = inSpecs[i].selector;
+		theEntry->scope = inSpecs[i].scope;
+		theEntry->flags = inSpecs[i].flags;
+		theEntry->size = inSpecs[i].size;
+		theEntry->sizeProc = inSpecs[i].sizeProc;
+		theEntry->getProc = inGetProc;
+		theEntry->setProc = (inSpecs[i].flags & kVocanaProperty_Settable) != 0 ? inSetProc : NULL;
+	}
+	inTable->entryCount += inSpecCount + 1;
+	return 0;
+}
+
+static int table_compare_entries(const void* inLeft, const void* inRight)
+{
+	const VocanaPropertyEntry* theLeft = inLeft;
+	const VocanaPropertyEntry* theRight = inRight;
+	if(theLeft->objectID != theRight->objectID)
+	{
+		return theLeft->objectID < theRight->objectID ? -1 : 1;
+	}
+	if(theLeft->selector != theRight->selector)
+	{
+		return theLeft->selector < theRight->selector ? -1 : 1;
+	}
+	//	kVocanaPropertyScope_Any sorts first, so it heads its key
+	if(theLeft->scope != theRight->scope)
+	{
+		return theLeft->scope < theRight->scope ? -1 : 1;
+	}
+	return 0;
+}
+
+//	Places every bucket, largest first, at the smallest displacement that lands all of its keys in
+//	free slots. Returns false if some bucket has no such displacement.
+static bool table_place(VocanaPropertyTable* inTable, const uint64_t* inHashes, const uint16_t* inKeyEntries, uint32_t inKeyCount, uint32_t* ioOrder, uint32_t* ioBucketStarts, uint32_t* ioBucketFill)
+{
+	uint32_t theBucketCount = inTable->bucketCount;
+
+	//	counting sort of the keys by bucket, so each bucket's keys are contiguous in ioOrder
+	memset(ioBucketStarts, 0, (theBucketCount + 1) * sizeof(uint32_t));
+	for(uint32_t i = 0; i < inKeyCount; i++)
+	{
+		++ioBucketStarts[table_bucket(inHashes[i], inTable->bucketShift) + 1];
+	}
+	uint32_t theMaxBucketSize = 0;
+	for(uint32_t theBucket = 0; theBucket < theBucketCount; theBucket++)
+	{
+		uint32_t theSize = ioBucketStarts[theBucket + 1];
+		theMaxBucketSize = theSize > theMaxBucketSize ? theSize : theMaxBucketSize;
+		ioBucketStarts[theBucket + 1] += ioBucketStarts[theBucket];
+	}
+	memcpy(ioBucketFill, ioBucketStarts, theBucketCount * sizeof(uint32_t));
+	for(uint32_t i = 0; i < inKeyCount; i++)
+	{
+		ioOrder[ioBucketFill[table_bucket(inHashes[i], inTable->bucketShift)]++] = i;
+	}
+
+	memset(inTable->slots, 0xFF, inTable->slotCount * sizeof(uint16_t));
+	memset(inTable->displacements, 0, theBucketCount * sizeof(uint16_t));
+
+	for(uint32_t theBucketSize = theMaxBucketSize; theBucketSize > 0; theBucketSize--)
+	{
+		for(uint32_t theBucket = 0; theBucket < theBucketCount; theBucket++)
+		{
+			const uint32_t* theKeys = &ioOrder[ioBucketStarts[theBucket]];
+			if(ioBucketStarts[theBucket + 1] - ioBucketStarts[theBucket] != theBucketSize)
+			{
+				continue;
+			}
+
+			bool wasPlaced = false;
+			for(uint32_t theDisplacement = 0; theDisplacement <= kTable_MaxDisplacement && !wasPlaced; theDisplacement++)
+			{
+				uint32_t theKey = 0;
+				for(; theKey < theBucketSize; theKey++)
+				{
+					uint32_t theSlot = table_slot(inHashes[theKeys[theKey]], theDisplacement, inTable->slotShift);
+					if(inTable->slots[theSlot] != kTable_UnusedSlot)
+					{
+						break;
+					}
+					//	claim it now, so two keys of the same bucket can't share a slot
+					inTable->slots[theSlot] = inKeyEntries[theKeys[theKey]];
+				}
+				if(theKey == theBucketSize)
+				{
+					inTable->displacements[theBucket] = (uint16_t)theDisplacement;
+					wasPlaced = true;
+				}
+				else
+				{
+					//	give back the slots this displacement claimed
+					while(theKey-- > 0)
+					{
+						inTable->slots[table_slot(inHashes[theKeys[theKey]], theDisplacement, inTable->slotShift)] = kTable_UnusedSlot;
+					}
+				}
+			}
+			if(!wasPlaced)
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+int VocanaPropertyTable_Build(VocanaPropertyTable* inTable)
+{
+	int theError = 0;
+	uint16_t* theKeyEntries = NULL;
+	uint64_t* theHashes = NULL;
+	uint32_t* theOrder = NULL;
+	uint32_t* theBucketStarts = NULL;
+	uint32_t* theBucketFill = NULL;
+	uint32_t theKeyCount = 0;
+
+	if(inTable->isBuilt)
+	{
+		return EBUSY;
+	}
+	if(inTable->entryCount == 0)
+	{
+		return EINVAL;
+	}
+
+	//	the entries of one object and selector, one per scope, end up next to each other; the hash
+	//	only needs to find the first of them
+	qsort(inTable->entries, inTable->entryCount, sizeof(VocanaPropertyEntry), table_compare_entries);
+
+	theKeyEntries = malloc(inTable->entryCount * sizeof(uint16_t));
+	theHashes = malloc(inTable->entryCount * sizeof(uint64_t));
+	theOrder = malloc(inTable->entryCount * sizeof(uint32_t));
+	if(theKeyEntries == NULL || theHashes == NULL || theOrder == NULL)
+	{
+		theError = ENOMEM;
+		goto Done;
+	}
+	for(uint32_t i = 0; i < inTable->entryCount; i++)
+	{
+		if(i == 0 || !table_entry_is(&inTable->entries[i - 1], inTable->entries[i].objectID, inTable->entries[i].selector))
+		{
+			theKeyEntries[theKeyCount++] = (uint16_t)i;
+		}
+	}
+
+	//	start at a load factor of at most 0.8 and give the hash more room, or another seed, until
+	//	it is perfect
+	uint32_t theSlotBits = kTable_MinSlotBits;
+	while((1u << theSlotBits) < theKeyCount + theKeyCount / 4)
+	{
+		++theSlotBits;
+	}
+	for(uint32_t theAttempt = 0; ; theAttempt++)
+	{
+		if(theAttempt > 0 && theAttempt % kTable_SeedsPerSize == 0)
+		{
+			++theSlotBits;
+		}
+		if(theSlotBits > kTable_MaxSlotBits)
+		{
+			theError = EOVERFLOW;
+			goto Done;
+		}
+		uint32_t theBucketBits = theSlotBits > kTable_SlotsPerBucketBits ? theSlotBits - kTable_SlotsPerBucketBits : 1;
+
+		free(inTable->displacements);
+		free(inTable->slots);
+		free(theBucketStarts);
+		free(theBucketFill);
+		inTable->slotCount = 1u << theSlotBits;
+		inTable->bucketCount = 1u << theBucketBits;
+		inTable->displacements = malloc(inTable->bucketCount * sizeof(uint16_t));
+		inTable->slots = malloc(inTable->slotCount * sizeof(uint16_t));
+		theBucketStarts = malloc((inTable->bucketCount + 1) * sizeof(uint32_t));
+		theBucketFill = malloc(inTable->bucketCount * sizeof(uint32_t));
+		if(inTable->displacements == NULL || inTable->slots == NULL || theBucketStarts == NULL || theBucketFill == NULL)
+		{
+			theError = ENOMEM;
+			goto Done;
+		}
+		inTable->slotShift = 32 - theSlotBits;
+		inTable->bucketShift = 64 - theBucketBits;
+		inTable->seed = (theAttempt + 1) * 0xD6E8FEB86659FD93ull;
+
+		for(uint32_t i = 0; i < theKeyCount; i++)
+		{
+			const VocanaPropertyEntry* theEntry = &inTable->entries[theKeyEntries[i]];
+			theHashes[i] = table_key_hash(inTable->seed, theEntry->objectID, theEntry->selector);
+		}
+		if(table_place(inTable, theHashes, theKeyEntries, theKeyCount, theOrder, theBucketStarts, theBucketFill))
+		{
+			break;
+		}
+	}
+	inTable->isBuilt = true;
+
+Done:
+	if(theError != 0)
+	{
+		free(inTable->displacements);
+		free(inTable->slots);
+		inTable->displacements = NULL;
+		inTable->slots = NULL;
+	}
+	free(theKeyEntries);
+	free(theHashes);
+	free(theOrder);
+	free(theBucketStarts);
+	free(theBucketFill);
+	return theError;
+}
+
+const VocanaPropertyEntry* VocanaPropertyTable_Find(const VocanaPropertyTable* inTable, uint32_t inObjectID, uint32_t inSelector, uint32_t inScope)
+{
+	if(!inTable->isBuilt || inSelector == kTable_ObjectSelector)
+	{
+		return NULL;
+	}
+
+	const VocanaPropertyEntry* theFirst = table_lookup(inTable, inObjectID, inSelector);
+	if(theFirst == NULL)
+	{
+		return NULL;
+	}
+
+	//	nearly every property has one entry, for any scope; the rest have one per scope
+	const VocanaPropertyEntry* theEnd = inTable->entries + inTable->entryCount;
+	for(const VocanaPropertyEntry* theEntry = theFirst; theEntry < theEnd && table_entry_is(theEntry, inObjectID, inSelector); theEntry++)
+	{
+		if(theEntry->scope == inScope)
+		{
+			return theEntry;
+		}
+	}
+	return theFirst->scope == kVocanaPropertyScope_Any ? theFirst : NULL;
+}
+
+bool VocanaPropertyTable_HasObject(const VocanaPropertyTable* inTable, uint32_t inObjectID)
+{
+	return inTable->isBuilt && table_lookup(inTable, inObjectID, kTable_ObjectSelector) != NULL;
+}
@@ -0,0 +1,167 @@
+/*
+     File: VocanaPropertyTable.h
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Declarative property tables for the Vocana HAL plug-ins.
+
+ */
+/*==================================================================================================
+	VocanaPropertyTable.h
+==================================================================================================*/
+
+#ifndef VocanaPropertyTable_h
+#define VocanaPropertyTable_h
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaPropertyTable
+//==================================================================================================
+
+//	coreaudiod asks a plug-in HasProperty, IsPropertySettable and GetPropertyDataSize for every
+//	selector it cares about on every object, each time it (re)scans the plug-in and whenever a
+//	client lists devices. Answering those from switch ladders means every selector is spelled out
+//	once per question, and the ladders drift apart: a property one of them knows and another one
+//	doesn't is a bug the HAL only hits at run time.
+//
+//	Instead, each class of object declares its properties once, as an array of
+//	VocanaPropertySpecs giving the selector, the scope it lives in, whether it can be set and the
+//	size of its data. The plug-in registers every object it publishes with its class's specs and
+//	the class's getter and setter, and builds the table; HasProperty, IsPropertySettable,
+//	GetPropertyDataSize, GetPropertyData and SetPropertyData then all go through that one lookup,
+//	so they can't disagree. The getter only sees properties the table says exist, and the setter
+//	only ones it says are settable, so a class's getter and setter switch on the selector alone.
+//
+//	This is a consistency measure, not a speed-up. The property calls are control-path calls, and a
+//	lookup here is no cheaper than a selector switch: test_property_enumeration in
+//	VocanaHALSimulatorTests.c walks every object of the real driver and measures about 18 ns for a
+//	question the table answers alone and 35 ns for GetPropertyData, which also runs the class
+//	getter's switch, both through the driver's entry points on one x86 core.
+//
+//	The table is a hash-and-displace hash over the object and the selector, with the entries for
+//	one property in different scopes next to each other, so a lookup reads a displacement, a slot
+//	and then the entries without probing. It is built once, when the plug-in initializes, from the
+//	same spec arrays the plug-in declares; generating it at compile time would need a code
+//	generator in the build for a step that takes microseconds once per process. Plug-ins with
+//	devices that come and go register object kinds rather than object IDs, and map an ID to its
+//	kind before asking.
+//
+//	The table is immutable once built, so lookups need no locking. Nothing in this
+//	file depends on CoreAudio; selectors and scopes are four char codes and object IDs are plain
+//	integers.
+
+enum
+{
+	//	a spec scope that matches any scope the property is asked for in
+	kVocanaPropertyScope_Any        = 0,
+
+	kVocanaProperty_Settable        = 1u << 0,
+};
+
+//	The size of a property's data when it depends on the object or the plug-in's state. Must not
+//	block for long; it is called from GetPropertyDataSize.
+typedef uint32_t (*VocanaPropertySizeProc)(uint32_t inObjectID, uint32_t inScope);
+
+//	A class's getter or setter. The table only carries it from the registration to the lookup, so
+//	it is kept as a plain function pointer, which the plug-in casts back to its own signature with
+//	the CoreAudio types this file doesn't know about.
+typedef void (*VocanaPropertyProc)(void);
+
+typedef struct VocanaPropertySpec
+{
+	uint32_t                selector;
+	uint32_t                scope;          //	or kVocanaPropertyScope_Any
+	uint32_t                flags;
+	uint32_t                size;           //	used when sizeProc is NULL
+	VocanaPropertySizeProc  sizeProc;
+} VocanaPropertySpec;
+
+typedef struct VocanaPropertyEntry
+{
+	uint32_t                objectID;
+	uint32_t                selector;
+	uint32_t                scope;
+	uint32_t                flags;
+	uint32_t                size;
+	VocanaPropertySizeProc  sizeProc;
+	VocanaPropertyProc      getProc;
+	VocanaPropertyProc      setProc;        //	NULL unless the property is settable
+} VocanaPropertyEntry;
+
+typedef struct VocanaPropertyTable
+{
+	VocanaPropertyEntry*    entries;
+	uint32_t                entryCount;
+	uint32_t                entryCapacity;
+
+	//	built by VocanaPropertyTable_Build, which sorts the entries by object, selector and scope
+	uint16_t*               displacements;
+	uint16_t*               slots;          //	the first entry of a key, or UINT16_MAX for an unused slot
+	uint64_t                seed;
+	uint32_t                bucketCount;
+	uint32_t                bucketShift;
+	uint32_t                slotCount;
+	uint32_t                slotShift;
+	bool                    isBuilt;
+} VocanaPropertyTable;
+
+//	Allocates room for inCapacity entries; every registered object takes one more than its number
+//	of properties. Returns 0 on success or an errno value. Not real-time safe.
+int         VocanaPropertyTable_Init(VocanaPropertyTable* inTable, uint32_t inCapacity);
+
+//	Frees everything. The caller must guarantee no lookups are still running.
+void        VocanaPropertyTable_Teardown(VocanaPropertyTable* inTable);
+
+//	Registers an object with its class's properties and the getter and setter for their data,
+//	either of which may be NULL. Returns EEXIST if the object already has a property with the same
+//	selector and scope, ENOSPC if the table is full and EBUSY once the table is built. Not
+//	real-time safe.
+int         VocanaPropertyTable_AddObject(VocanaPropertyTable* inTable, uint32_t inObjectID, const VocanaPropertySpec* inSpecs, uint32_t inSpecCount, VocanaPropertyProc inGetProc, VocanaPropertyProc inSetProc);
+
+//	Builds the lookup. Entries move, so pointers to them are only good from here on. Returns 0 on
+//	success or an errno value. Not real-time safe.
+int         VocanaPropertyTable_Build(VocanaPropertyTable* inTable);
+
+//	The property inSelector of inObjectID as asked for in inScope: the spec for exactly that scope
+//	if there is one, otherwise the one for any scope. NULL if the object doesn't have it, or the
+//	table isn't built. Real-time safe.
+const VocanaPropertyEntry*  VocanaPropertyTable_Find(const VocanaPropertyTable* inTable, uint32_t inObjectID, uint32_t inSelector, uint32_t inScope);
+
+//	Whether inObjectID was registered. Real-time safe.
+bool        VocanaPropertyTable_HasObject(const VocanaPropertyTable* inTable, uint32_t inObjectID);
+
+//	The byte size of the entry's data for the given object and scope. A plug-in that registers one
+//	entry for a whole class of objects passes the object that was asked about, which is what the
+//	size proc then sees.
+static inline uint32_t VocanaPropertyEntry_GetSizeForObject(const VocanaPropertyEntry* inEntry, uint32_t inObjectID, uint32_t inScope)
+{
+	return inEntry->sizeProc != NULL ? inEntry->sizeProc(inObjectID, inScope) : inEntry->size;
+}
+
+static inline uint32_t VocanaPropertyEntry_GetSize(const VocanaPropertyEntry* inEntry, uint32_t inScope)
+{
+	return VocanaPropertyEntry_GetSizeForObject(inEntry, inEntry->objectID, inScope);
+}
+
+static inline bool VocanaPropertyEntry_IsSettable(const VocanaPropertyEntry* inEntry)
+{
+	return (inEntry->flags & kVocanaProperty_Settable) != 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VocanaPropertyTable_h */
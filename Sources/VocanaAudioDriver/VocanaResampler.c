@@ -0,0 +1,352 @@
+/*
+     File: VocanaResampler.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Streaming sample rate conversion between the devices' rates and the rate the denoisers run at.
+
+ */
+/*==================================================================================================
+	VocanaResampler.c
+==================================================================================================*/
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include "VocanaResampler.h"
+#include "VocanaChannels.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+//	the sinc filter: taps either side of the output frame when the rate goes up, the cutoff as a
+//	fraction of the lower rate's Nyquist frequency and the Kaiser window's shape, which together
+//	put the stopband some 90 dB down from just below the Nyquist frequency
+#define kResampler_SincHalfTaps             32
+#define kResampler_Cutoff                   0.91
+#define kResampler_KaiserBeta               9.0
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Kernels
+//==================================================================================================
+
+//	The dot product of inCount floats, a multiple of 4, neither of them aligned.
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+
+static float resampler_dot(const float* inA, const float* inB, uint32_t inCount)
+{
+	float32x4_t theSum0 = vdupq_n_f32(0.0f);
+	float32x4_t theSum1 = vdupq_n_f32(0.0f);
+	uint32_t i = 0;
+	for(; i + 8 <= inCount; i += 8)
+	{
+		theSum0 = vfmaq_f32(theSum0, vld1q_f32(inA + i), vld1q_f32(inB + i));
+		theSum1 = vfmaq_f32(theSum1, vld1q_f32(inA + i + 4), vld1q_f32(inB + i + 4));
+	}
+	if(i < inCount)
+	{
+		theSum0 = vfmaq_f32(theSum0, vld1q_f32(inA + i), vld1q_f32(inB + i));
+	}
+	return vaddvq_f32(vaddq_f32(theSum0, theSum1));
+}
+
+#elif defined(__SSE2__)
+
+static float resampler_dot(const float* inA, const float* inB, uint32_t inCount)
+{
+	__m128 theSum0 = _mm_setzero_ps();
+	__m128 theSum1 = _mm_setzero_ps();
+	uint32_t i = 0;
+	for(; i + 8 <= inCount; i += 8)
+	{
+		theSum0 = _mm_add_ps(theSum0, _mm_mul_ps(_mm_loadu_ps(inA + i), _mm_loadu_ps(inB + i)));
+		theSum1 = _mm_add_ps(theSum1, _mm_mul_ps(_mm_loadu_ps(inA + i + 4), _mm_loadu_ps(inB + i + 4)));
+	}
+	if(i < inCount)
+	{
+		theSum0 = _mm_add_ps(theSum0, _mm_mul_ps(_mm_loadu_ps(inA + i), _mm_loadu_ps(inB + i)));
+	}
+	__m128 theSum = _mm_add_ps(theSum0, theSum1);
+	theSum = _mm_add_ps(theSum, _mm_movehl_ps(theSum, theSum));
+	theSum = _mm_add_ss(theSum, _mm_shuffle_ps(theSum, theSum, _MM_SHUFFLE(1, 1, 1, 1)));
+	return _mm_cvtss_f32(theSum);
+}
+
+#else
+
+static float resampler_dot(const float* inA, const float* inB, uint32_t inCount)
+{
+	float theSums[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	for(uint32_t i = 0; i < inCount; i += 4)
+	{
+		for(uint32_t j = 0; j < 4; j++)
+		{
+			theSums[j] += inA[i + j] * inB[i + j];
+		}
+	}
+	return (theSums[0] + theSums[1]) + (theSums[2] + theSums[3]);
+}
+
+#endif
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Filter
+//==================================================================================================
+
+static uint64_t resampler_gcd(uint64_t inA, uint64_t inB)
+{
+	while(inB != 0)
+	{
+		uint64_t theRemainder = inA % inB;
+		inA = inB;
+		inB = theRemainder;
+	}
+	return inA;
+}
+
+//	The zeroth order modified Bessel function of the first kind, for the Kaiser window.
+static double resampler_bessel_i0(double inX)
+{
+	double theSum = 1.0;
+	double theTerm = 1.0;
+	double theHalf = inX / 2.0;
+	for(int k = 1; k < 64 && theTerm > theSum * 1.0e-12; k++)
+	{
+		theTerm *= (theHalf / k) * (theHalf / k);
+		theSum += theTerm;
+	}
+	return theSum;
+}
+
+//	Row r of the filter holds the taps for an output frame r/L of an input frame past the middle of
+//	its taps, first tap first. Each row is scaled to a gain of exactly one at DC.
+static void resampler_make_filter(VocanaResampler* inResampler)
+{
+	uint32_t theInterpolation = inResampler->interpolation;
+	uint32_t theTaps = inResampler->tapCount;
+	double theHalf = theTaps / 2;
+	double theCutoff = kResampler_Cutoff * (theInterpolation < inResampler->decimation ? (double)theInterpolation / inResampler->decimation : 1.0);
+	double theWindowScale = 1.0 / resampler_bessel_i0(kResampler_KaiserBeta);
+
+	for(uint32_t r = 0; r < theInterpolation; r++)
+	{
+		float* theRow = inResampler->filter + (size_t)r * theTaps;
+		double theFraction = (double)r / theInterpolation;
+		double theSum = 0.0;
+		for(uint32_t j = 0; j < theTaps; j++)
+		{
+			double theTime = (double)j - (theHalf - 1.0) - theFraction;
+			double theArgument = M_PI * theCutoff * theTime;
+			double theSinc = theArgument == 0.0 ? 1.0 : sin(theArgument) / theArgument;
+			double theX = theTime / theHalf;
+			double theWindow = theX * theX < 1.0 ? resampler_bessel_i0(kResampler_KaiserBeta * sqrt(1.0 - theX * theX)) * theWindowScale : 0.0;
+			theRow[j] = (float)(theSinc * theWindow);
+			theSum += theRow[j];
+		}
+		for(uint32_t j = 0; j < theTaps; j++)
+		{
+			theRow[j] = (float)(theRow[j] / theSum);
+		}
+	}
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaResampler
+//==================================================================================================
+
+int VocanaResampler_Init(VocanaResampler* outResampler, double inInputRate, double inOutputRate, uint32_t inChannelCount, uint32_t inMaxInputFrames, VocanaResamplerQuality inQuality)
+{
+	if(outResampler == NULL)
+	{
+		return EINVAL;
+	}
+	memset(outResampler, 0, sizeof(*outResampler));
+	if(!VocanaChannels_IsValidCount(inChannelCount) || inMaxInputFrames == 0 ||
+	   !(inInputRate >= 1.0 && inInputRate <= UINT32_MAX && floor(inInputRate) == inInputRate) ||
+	   !(inOutputRate >= 1.0 && inOutputRate <= UINT32_MAX && floor(inOutputRate) == inOutputRate) ||
+	   (inQuality != kVocanaResampler_Linear && inQuality != kVocanaResampler_Sinc))
+	{
+		return EINVAL;
+	}
+
+	uint64_t theDivisor = resampler_gcd((uint64_t)inInputRate, (uint64_t)inOutputRate);
+	outResampler->quality = inQuality;
+	outResampler->channelCount = inChannelCount;
+	outResampler->maxInputFrames = inMaxInputFrames;
+	outResampler->interpolation = (uint32_t)((uint64_t)inOutputRate / theDivisor);
+	outResampler->decimation = (uint32_t)((uint64_t)inInputRate / theDivisor);
+
+	if(inQuality == kVocanaResampler_Sinc)
+	{
+		if(outResampler->interpolation > kVocanaResampler_MaxPhases)
+		{
+			return EINVAL;
+		}
+
+		//	going down, the filter stretches with the lower cutoff; an even half keeps the taps a
+		//	multiple of 4
+		uint32_t theHalf = kResampler_SincHalfTaps;
+		if(outResampler->decimation > outResampler->interpolation)
+		{
+			theHalf = (uint32_t)ceil((double)kResampler_SincHalfTaps * outResampler->decimation / outResampler->interpolation);
+			theHalf += theHalf & 1u;
+		}
+		outResampler->tapCount = 2 * theHalf;
+	}
+	else
+	{
+		outResampler->tapCount = 2;
+	}
+
+	//	room for the taps the next output frame needs on top of a full call's input
+	outResampler->historyStride = (outResampler->tapCount - 1 + inMaxInputFrames + 3) & ~3u;
+	outResampler->history = (float*)calloc((size_t)outResampler->historyStride * inChannelCount, sizeof(float));
+	if(inQuality == kVocanaResampler_Sinc)
+	{
+		outResampler->filter = (float*)calloc((size_t)outResampler->interpolation * outResampler->tapCount, sizeof(float));
+	}
+	if(outResampler->history == NULL || (inQuality == kVocanaResampler_Sinc && outResampler->filter == NULL))
+	{
+		VocanaResampler_Teardown(outResampler);
+		return ENOMEM;
+	}
+	if(inQuality == kVocanaResampler_Sinc)
+	{
+		resampler_make_filter(outResampler);
+	}
+
+	VocanaResampler_Reset(outResampler);
+	return 0;
+}
+
+void VocanaResampler_Teardown(VocanaResampler* inResampler)
+{
+	if(inResampler == NULL)
+	{
+		return;
+	}
+	free(inResampler->filter);
+	free(inResampler->history);
+	inResampler->filter = NULL;
+	inResampler->history = NULL;
+}
+
+void VocanaResampler_Reset(VocanaResampler* inResampler)
+{
+	//	the first output frame's taps but the last reach back before the first input frame
+	memset(inResampler->history, 0, (size_t)inResampler->historyStride * inResampler->channelCount * sizeof(float));
+	inResampler->available = inResampler->tapCount - 1;
+	inResampler->position = 0;
+	inResampler->phase = 0;
+}
+
+uint32_t VocanaResampler_GetLatency(const VocanaResampler* inResampler)
+{
+	return inResampler->tapCount / 2;
+}
+
+uint32_t VocanaResampler_GetOutputFrameCount(const VocanaResampler* inResampler, uint32_t inFrameCount)
+{
+	//	output frames go on while their taps fit in what will be in the history; the input an
+	//	earlier call skipped over counts as well, since the position is past it too
+	int64_t theEnd = ((int64_t)inResampler->available + inFrameCount - inResampler->tapCount + 1) * inResampler->interpolation;
+	int64_t theStart = (int64_t)inResampler->position * inResampler->interpolation + inResampler->phase;
+	if(theEnd <= theStart)
+	{
+		return 0;
+	}
+	return (uint32_t)((theEnd - theStart + inResampler->decimation - 1) / inResampler->decimation);
+}
+
+uint32_t VocanaResampler_GetMaxOutputFrameCount(const VocanaResampler* inResampler, uint32_t inFrameCount)
+{
+	return (uint32_t)(((uint64_t)inFrameCount * inResampler->interpolation + inResampler->decimation - 1) / inResampler->decimation) + 1;
+}
+
+uint32_t VocanaResampler_Process(VocanaResampler* inResampler, const float* inFrames, uint32_t inFrameCount, float* outFrames)
+{
+	uint32_t theChannels = inResampler->channelCount;
+	uint32_t theTaps = inResampler->tapCount;
+	uint32_t theStride = inResampler->historyStride;
+	float* theHistory = inResampler->history;
+
+	//	going down by more than a frame per output frame, the linear quality can step past the end
+	//	of the history, and the input it steps over is never needed
+	uint32_t theSkip = inResampler->position > inResampler->available ? inResampler->position - inResampler->available : 0;
+	theSkip = theSkip < inFrameCount ? theSkip : inFrameCount;
+	inResampler->position -= theSkip;
+	uint32_t theCount = inFrameCount - theSkip;
+	for(uint32_t c = 0; c < theChannels; c++)
+	{
+		VocanaChannels_Deinterleave(inFrames + (size_t)theSkip * theChannels, theChannels, c, theHistory + (size_t)c * theStride + inResampler->available, theCount);
+	}
+	inResampler->available += theCount;
+
+	uint32_t thePosition = inResampler->position;
+	uint64_t thePhase = inResampler->phase;
+	uint32_t theInterpolation = inResampler->interpolation;
+	uint32_t theDecimation = inResampler->decimation;
+	uint32_t theOutputCount = 0;
+	float* theOutput = outFrames;
+	if(inResampler->quality == kVocanaResampler_Sinc)
+	{
+		while(thePosition + theTaps <= inResampler->available)
+		{
+			const float* theRow = inResampler->filter + (size_t)thePhase * theTaps;
+			for(uint32_t c = 0; c < theChannels; c++)
+			{
+				*theOutput++ = resampler_dot(theHistory + (size_t)c * theStride + thePosition, theRow, theTaps);
+			}
+			++theOutputCount;
+			thePhase += theDecimation;
+			thePosition += (uint32_t)(thePhase / theInterpolation);
+			thePhase %= theInterpolation;
+		}
+	}
+	else
+	{
+		float theScale = 1.0f / (float)theInterpolation;
+		while(thePosition + theTaps <= inResampler->available)
+		{
+			float theFraction = (float)thePhase * theScale;
+			for(uint32_t c = 0; c < theChannels; c++)
+			{
+				const float* theSamples = theHistory + (size_t)c * theStride + thePosition;
+				*theOutput++ = theSamples[0] + theFraction * (theSamples[1] - theSamples[0]);
+			}
+			++theOutputCount;
+			thePhase += theDecimation;
+			thePosition += (uint32_t)(thePhase / theInterpolation);
+			thePhase %= theInterpolation;
+		}
+	}
+
+	//	keep what the next output frame needs at the start of the history
+	uint32_t theConsumed = thePosition < inResampler->available ? thePosition : inResampler->available;
+	uint32_t theKept = inResampler->available - theConsumed;
+	if(theConsumed > 0 && theKept > 0)
+	{
+		for(uint32_t c = 0; c < theChannels; c++)
+		{
+			float* theChannel = theHistory + (size_t)c * theStride;
+			memmove(theChannel, theChannel + theConsumed, (size_t)theKept * sizeof(float));
+		}
+	}
+	inResampler->available = theKept;
+	inResampler->position = thePosition - theConsumed;
+	inResampler->phase = (uint32_t)thePhase;
+	return theOutputCount;
+}
@@ -0,0 +1,116 @@
+/*
+     File: VocanaResampler.h
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Streaming sample rate conversion between the devices' rates and the rate the denoisers run at.
+
+ */
+/*==================================================================================================
+	VocanaResampler.h
+==================================================================================================*/
+
+#ifndef VocanaResampler_h
+#define VocanaResampler_h
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaResampler
+//==================================================================================================
+
+//	The devices run at any of the rates in kDevice_SampleRates, but the models only work at 48 kHz,
+//	so audio at any other rate has to be converted on its way to them and back. The resampler
+//	converts between two whole-number rates in the ratio L:M (the output and input rates divided by
+//	their greatest common divisor) as a stream: each call hands it the next input frames and it
+//	writes every output frame those complete, carrying the filter history from one call to the
+//	next, so the output is the same however the input is split into calls.
+//
+//	The sinc quality is a polyphase windowed-sinc filter: L phases of a Kaiser-windowed sinc, cut
+//	off just below the Nyquist frequency of the lower of the two rates, with 64 taps when the rate
+//	goes up and proportionally more when it goes down, so images and aliases are some 90 dB down.
+//	Every output frame is one dot product per channel over contiguous history, which the kernels
+//	below do with NEON or SSE. The linear quality interpolates between the two nearest input
+//	frames: it costs next to nothing and takes any ratio, but it neither removes images nor
+//	prevents aliasing, so it is only a fallback.
+//
+//	Output frame n is the input at n * M / L frames less the latency, which is a whole number of
+//	input frames; frames before the first input are taken as silence, so there is no gap at the
+//	start. The input is interleaved, as is the output.
+//
+//	Init and Teardown allocate; everything else is real-time safe. Nothing in this file depends on
+//	CoreAudio.
+
+enum
+{
+	//	the most filter phases, the output rate over the rates' common divisor; 160 for 44.1 kHz to
+	//	48 kHz, 640 for 11.025 kHz to 48 kHz
+	kVocanaResampler_MaxPhases          = 1024,
+};
+
+typedef enum VocanaResamplerQuality
+{
+	kVocanaResampler_Linear             = 0,
+	kVocanaResampler_Sinc               = 1,
+} VocanaResamplerQuality;
+
+typedef struct VocanaResampler
+{
+	VocanaResamplerQuality  quality;
+	uint32_t                channelCount;
+	uint32_t                maxInputFrames;
+	uint32_t                interpolation;  //	L
+	uint32_t                decimation;     //	M
+	uint32_t                tapCount;       //	per phase, a multiple of 4
+	float*                  filter;         //	interpolation rows of tapCount, NULL for linear
+	float*                  history;        //	per channel, historyStride samples
+	uint32_t                historyStride;
+
+	//	where the next output frame's taps start in the history, and how far past that frame it
+	//	is, in 1/L of an input frame
+	uint32_t                position;
+	uint32_t                phase;
+	uint32_t                available;      //	input frames in the history
+} VocanaResampler;
+
+//	Sets up a resampler from inInputRate to inOutputRate, both whole numbers of Hz, for up to
+//	inMaxInputFrames interleaved frames of inChannelCount channels per call. Returns 0 on success
+//	or an errno value; EINVAL for rates the sinc quality would need more than
+//	kVocanaResampler_MaxPhases phases for, which the linear quality takes. Not real-time safe.
+int         VocanaResampler_Init(VocanaResampler* outResampler, double inInputRate, double inOutputRate, uint32_t inChannelCount, uint32_t inMaxInputFrames, VocanaResamplerQuality inQuality);
+
+void        VocanaResampler_Teardown(VocanaResampler* inResampler);
+
+//	Forgets the input seen so far, as if the resampler had just been set up.
+void        VocanaResampler_Reset(VocanaResampler* inResampler);
+
+//	How many input frames late the output is.
+uint32_t    VocanaResampler_GetLatency(const VocanaResampler* inResampler);
+
+//	Exactly how many frames the next call to Process with inFrameCount input frames will write.
+uint32_t    VocanaResampler_GetOutputFrameCount(const VocanaResampler* inResampler, uint32_t inFrameCount);
+
+//	The most frames a call with inFrameCount input frames can write, whatever came before it.
+uint32_t    VocanaResampler_GetMaxOutputFrameCount(const VocanaResampler* inResampler, uint32_t inFrameCount);
+
+//	Converts inFrameCount frames, at most maxInputFrames, and writes the output frames they
+//	complete to outFrames, which must have room for GetOutputFrameCount of them. Returns how many
+//	it wrote.
+uint32_t    VocanaResampler_Process(VocanaResampler* inResampler, const float* inFrames, uint32_t inFrameCount, float* outFrames);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VocanaResampler_h */
@@ -0,0 +1,377 @@
+/*
+     File: VocanaRingBuffer.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Lock-free single-producer/single-consumer audio ring buffer used by VocanaVirtualDevice.
+
+ */
+/*==================================================================================================
+	VocanaRingBuffer.c
+==================================================================================================*/
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include "VocanaRingBuffer.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#include <mach/vm_map.h>
+#endif
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Storage
+//==================================================================================================
+
+static size_t ring_buffer_page_size(void)
+{
+	long thePageSize = sysconf(_SC_PAGESIZE);
+	return thePageSize > 0 ? (size_t)thePageSize : 4096;
+}
+
+#if defined(__APPLE__)
+
+static float* ring_buffer_map_mirrored(size_t inBytes)
+{
+	//	Reserve twice the size, then replace the upper half with a second mapping of the lower
+	//	half. This is the same trick TPCircularBuffer uses.
+	vm_address_t theBuffer = 0;
+	if(vm_allocate(mach_task_self(), &theBuffer, inBytes * 2, VM_FLAGS_ANYWHERE) != KERN_SUCCESS)
+	{
+		return NULL;
+	}
+
+	vm_address_t theMirror = theBuffer + inBytes;
+	if(vm_deallocate(mach_task_self(), theMirror, inBytes) != KERN_SUCCESS)
+	{
+		vm_deallocate(mach_task_self(), theBuffer, inBytes * 2);
+		return NULL;
+	}
+
+	vm_prot_t theCurrentProtection = 0;
+	vm_prot_t theMaxProtection = 0;
+	if(vm_remap(mach_task_self(), &theMirror, inBytes, 0, VM_FLAGS_FIXED, mach_task_self(), theBuffer, 0, &theCurrentProtection, &theMaxProtection, VM_INHERIT_DEFAULT) != KERN_SUCCESS || theMirror != theBuffer + inBytes)
+	{
+		vm_deallocate(mach_task_self(), theBuffer, inBytes);
+		return NULL;
+	}
+
+	return (float*)theBuffer;
+}
+
+static void ring_buffer_unmap_mirrored(float* inStorage, size_t inBytes)
+{
+	vm_deallocate(mach_task_self(), (vm_address_t)inStorage, inBytes * 2);
+}
+
+#elif defined(__linux__)
+
+static float* ring_buffer_map_mirrored(size_t inBytes)
+{
+	//	Back the ring with an anonymous memory file and map it twice into a reserved region.
+	int theFile = memfd_create("VocanaRingBuffer", MFD_CLOEXEC);
+	if(theFile < 0)
+	{
+		return NULL;
+	}
+	if(ftruncate(theFile, (off_t)inBytes) != 0)
+	{
+		close(theFile);
+		return NULL;
+	}
+
+	void* theRegion = mmap(NULL, inBytes * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(theRegion == MAP_FAILED)
+	{
+		close(theFile);
+		return NULL;
+	}
+
+	void* theLower = mmap(theRegion, inBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, theFile, 0);
+	void* theUpper = mmap((char*)theRegion + inBytes, inBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, theFile, 0);
+	close(theFile);
+
+	if(theLower != theRegion || theUpper != (char*)theRegion + inBytes)
+	{
+		munmap(theRegion, inBytes * 2);
+		return NULL;
+	}
+
+	return (float*)theRegion;
+}
+
+static void ring_buffer_unmap_mirrored(float* inStorage, size_t inBytes)
+{
+	munmap(inStorage, inBytes * 2);
+}
+
+#else
+
+static float* ring_buffer_map_mirrored(size_t inBytes)
+{
+	(void)inBytes;
+	return NULL;
+}
+
+static void ring_buffer_unmap_mirrored(float* inStorage, size_t inBytes)
+{
+	(void)inStorage;
+	(void)inBytes;
+}
+
+#endif
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Copy Helpers
+//==================================================================================================
+
+static inline float* ring_buffer_frame_pointer(const VocanaRingBuffer* inRingBuffer, uint64_t inFrame)
+{
+	return inRingBuffer->storage + (size_t)(inFrame & inRingBuffer->frameMask) * inRingBuffer->channelCount;
+}
+
+//	Number of frames from inFrame to the physical end of the storage. With a mirrored mapping a
+//	copy can run straight past the end, so the whole request is always contiguous.
+static inline uint32_t ring_buffer_contiguous_frames(const VocanaRingBuffer* inRingBuffer, uint64_t inFrame, uint32_t inFrameCount)
+{
+	if(inRingBuffer->isMirrored)
+	{
+		return inFrameCount;
+	}
+
+	uint32_t theToEnd = inRingBuffer->capacityFrames - (uint32_t)(inFrame & inRingBuffer->frameMask);
+	return inFrameCount < theToEnd ? inFrameCount : theToEnd;
+}
+
+static void ring_buffer_store(VocanaRingBuffer* inRingBuffer, uint64_t inFrame, const float* inFrames, uint32_t inFrameCount)
+{
+	size_t theFrameBytes = (size_t)inRingBuffer->channelCount * sizeof(float);
+	uint32_t theFirstPart = ring_buffer_contiguous_frames(inRingBuffer, inFrame, inFrameCount);
+
+	if(inFrames != NULL)
+	{
+		memcpy(ring_buffer_frame_pointer(inRingBuffer, inFrame), inFrames, theFirstPart * theFrameBytes);
+		memcpy(inRingBuffer->storage, inFrames + (size_t)theFirstPart * inRingBuffer->channelCount, (inFrameCount - theFirstPart) * theFrameBytes);
+	}
+	else
+	{
+		memset(ring_buffer_frame_pointer(inRingBuffer, inFrame), 0, theFirstPart * theFrameBytes);
+		memset(inRingBuffer->storage, 0, (inFrameCount - theFirstPart) * theFrameBytes);
+	}
+}
+
+static void ring_buffer_load(const VocanaRingBuffer* inRingBuffer, uint64_t inFrame, float* outFrames, uint32_t inFrameCount)
+{
+	size_t theFrameBytes = (size_t)inRingBuffer->channelCount * sizeof(float);
+	uint32_t theFirstPart = ring_buffer_contiguous_frames(inRingBuffer, inFrame, inFrameCount);
+
+	memcpy(outFrames, ring_buffer_frame_pointer(inRingBuffer, inFrame), theFirstPart * theFrameBytes);
+	memcpy(outFrames + (size_t)theFirstPart * inRingBuffer->channelCount, inRingBuffer->storage, (inFrameCount - theFirstPart) * theFrameBytes);
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Lifetime
+//==================================================================================================
+
+int VocanaRingBuffer_Init(VocanaRingBuffer* inRingBuffer, uint32_t inCapacityFrames, uint32_t inChannelCount, uint32_t inFlags)
+{
+	if(inRingBuffer == NULL || inCapacityFrames == 0 || inChannelCount == 0 || (inCapacityFrames & (inCapacityFrames - 1)) != 0)
+	{
+		return EINVAL;
+	}
+
+	memset(inRingBuffer, 0, sizeof(*inRingBuffer));
+
+	size_t theBytes = (size_t)inCapacityFrames * inChannelCount * sizeof(float);
+
+	//	the mirror only works when the storage is a whole number of pages
+	if((inFlags & kVocanaRingBufferFlag_NoMirror) == 0 && (theBytes % ring_buffer_page_size()) == 0)
+	{
+		inRingBuffer->storage = ring_buffer_map_mirrored(theBytes);
+		inRingBuffer->isMirrored = (inRingBuffer->storage != NULL);
+	}
+
+	if(inRingBuffer->storage == NULL)
+	{
+		inRingBuffer->storage = calloc(1, theBytes);
+		if(inRingBuffer->storage == NULL)
+		{
+			return ENOMEM;
+		}
+	}
+	else
+	{
+		memset(inRingBuffer->storage, 0, theBytes);
+	}
+
+	inRingBuffer->storageBytes = theBytes;
+	inRingBuffer->capacityFrames = inCapacityFrames;
+	inRingBuffer->channelCount = inChannelCount;
+	inRingBuffer->frameMask = inCapacityFrames - 1;
+
+	atomic_init(&inRingBuffer->writeBegin, 0);
+	atomic_init(&inRingBuffer->writeFrame, 0);
+	atomic_init(&inRingBuffer->firstFrame, 0);
+	atomic_init(&inRingBuffer->readFrame, 0);
+
+	return 0;
+}
+
+void VocanaRingBuffer_Teardown(VocanaRingBuffer* inRingBuffer)
+{
+	if(inRingBuffer == NULL || inRingBuffer->storage == NULL)
+	{
+		return;
+	}
+
+	if(inRingBuffer->isMirrored)
+	{
+		ring_buffer_unmap_mirrored(inRingBuffer->storage, inRingBuffer->storageBytes);
+	}
+	else
+	{
+		free(inRingBuffer->storage);
+	}
+
+	inRingBuffer->storage = NULL;
+	inRingBuffer->storageBytes = 0;
+	inRingBuffer->isMirrored = false;
+}
+
+bool VocanaRingBuffer_IsAllocated(const VocanaRingBuffer* inRingBuffer)
+{
+	return inRingBuffer != NULL && inRingBuffer->storage != NULL;
+}
+
+void VocanaRingBuffer_Reset(VocanaRingBuffer* inRingBuffer, uint64_t inFrame)
+{
+	if(!VocanaRingBuffer_IsAllocated(inRingBuffer))
+	{
+		return;
+	}
+
+	memset(inRingBuffer->storage, 0, inRingBuffer->storageBytes);
+	atomic_store_explicit(&inRingBuffer->writeBegin, inFrame, memory_order_relaxed);
+	atomic_store_explicit(&inRingBuffer->firstFrame, inFrame, memory_order_relaxed);
+	atomic_store_explicit(&inRingBuffer->readFrame, inFrame, memory_order_relaxed);
+	atomic_store_explicit(&inRingBuffer->writeFrame, inFrame, memory_order_release);
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark IO
+//==================================================================================================
+
+void VocanaRingBuffer_Write(VocanaRingBuffer* inRingBuffer, uint64_t inFrame, const float* inFrames, uint32_t inFrameCount)
+{
+	if(!VocanaRingBuffer_IsAllocated(inRingBuffer) || inFrames == NULL || inFrameCount == 0)
+	{
+		return;
+	}
+
+	//	only the newest capacityFrames frames of an oversized write can survive
+	if(inFrameCount > inRingBuffer->capacityFrames)
+	{
+		uint32_t theSkipped = inFrameCount - inRingBuffer->capacityFrames;
+		inFrame += theSkipped;
+		inFrames += (size_t)theSkipped * inRingBuffer->channelCount;
+		inFrameCount = inRingBuffer->capacityFrames;
+	}
+
+	//	only the producer writes these, so a relaxed load sees our own last store
+	uint64_t theWriteFrame = atomic_load_explicit(&inRingBuffer->writeFrame, memory_order_relaxed);
+	uint64_t theEndFrame = inFrame + inFrameCount;
+	uint64_t theNewWriteFrame = theEndFrame > theWriteFrame ? theEndFrame : theWriteFrame;
+
+	//	announce the range about to be overwritten before touching the storage
+	atomic_store_explicit(&inRingBuffer->writeBegin, theNewWriteFrame, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+
+	//	silence any frames the producer skipped so they can't be read back as stale audio
+	if(inFrame > theWriteFrame)
+	{
+		uint64_t theGap = inFrame - theWriteFrame;
+		uint32_t theGapFrames = theGap < inRingBuffer->capacityFrames ? (uint32_t)theGap : inRingBuffer->capacityFrames;
+		ring_buffer_store(inRingBuffer, inFrame - theGapFrames, NULL, theGapFrames);
+	}
+
+	ring_buffer_store(inRingBuffer, inFrame, inFrames, inFrameCount);
+
+	//	publish
+	atomic_store_explicit(&inRingBuffer->writeFrame, theNewWriteFrame, memory_order_release);
+}
+
+uint32_t VocanaRingBuffer_Read(VocanaRingBuffer* inRingBuffer, uint64_t inFrame, float* outFrames, uint32_t inFrameCount)
+{
+	if(!VocanaRingBuffer_IsAllocated(inRingBuffer) || outFrames == NULL || inFrameCount == 0)
+	{
+		return 0;
+	}
+
+	size_t theFrameBytes = (size_t)inRingBuffer->channelCount * sizeof(float);
+	uint64_t theEndFrame = inFrame + inFrameCount;
+
+	//	figure out which part of the request has been published and not yet overwritten
+	uint64_t theWriteFrame = atomic_load_explicit(&inRingBuffer->writeFrame, memory_order_acquire);
+	uint64_t theOldestFrame = theWriteFrame > inRingBuffer->capacityFrames ? theWriteFrame - inRingBuffer->capacityFrames : 0;
+	uint64_t theFirstFrame = atomic_load_explicit(&inRingBuffer->firstFrame, memory_order_relaxed);
+	theOldestFrame = theOldestFrame > theFirstFrame ? theOldestFrame : theFirstFrame;
+	uint64_t theValidStart = inFrame > theOldestFrame ? inFrame : theOldestFrame;
+	uint64_t theValidEnd = theEndFrame < theWriteFrame ? theEndFrame : theWriteFrame;
+
+	if(theValidStart >= theValidEnd)
+	{
+		memset(outFrames, 0, inFrameCount * theFrameBytes);
+		atomic_store_explicit(&inRingBuffer->readFrame, theEndFrame, memory_order_release);
+		return 0;
+	}
+
+	uint32_t theLeading = (uint32_t)(theValidStart - inFrame);
+	uint32_t theValid = (uint32_t)(theValidEnd - theValidStart);
+	uint32_t theTrailing = inFrameCount - theLeading - theValid;
+	float* theValidOut = outFrames + (size_t)theLeading * inRingBuffer->channelCount;
+
+	memset(outFrames, 0, theLeading * theFrameBytes);
+	ring_buffer_load(inRingBuffer, theValidStart, theValidOut, theValid);
+	memset(theValidOut + (size_t)theValid * inRingBuffer->channelCount, 0, theTrailing * theFrameBytes);
+
+	//	If the producer started overwriting any of the frames we just copied, those frames may be
+	//	torn. Replace them with silence.
+	atomic_thread_fence(memory_order_acquire);
+	uint64_t theWriteBegin = atomic_load_explicit(&inRingBuffer->writeBegin, memory_order_relaxed);
+	uint64_t theSafeStart = theWriteBegin > inRingBuffer->capacityFrames ? theWriteBegin - inRingBuffer->capacityFrames : 0;
+	if(theSafeStart > theValidStart)
+	{
+		uint32_t theTorn = theSafeStart >= theValidEnd ? theValid : (uint32_t)(theSafeStart - theValidStart);
+		memset(theValidOut, 0, theTorn * theFrameBytes);
+		theValid -= theTorn;
+	}
+
+	atomic_store_explicit(&inRingBuffer->readFrame, theEndFrame, memory_order_release);
+	return theValid;
+}
+
+uint64_t VocanaRingBuffer_GetWriteFrame(const VocanaRingBuffer* inRingBuffer)
+{
+	return atomic_load_explicit(&((VocanaRingBuffer*)inRingBuffer)->writeFrame, memory_order_acquire);
+}
+
+uint64_t VocanaRingBuffer_GetReadFrame(const VocanaRingBuffer* inRingBuffer)
+{
+	return atomic_load_explicit(&((VocanaRingBuffer*)inRingBuffer)->readFrame, memory_order_acquire);
+}
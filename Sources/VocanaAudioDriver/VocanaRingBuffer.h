@@ -0,0 +1,114 @@
+/*
+     File: VocanaRingBuffer.h
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Lock-free single-producer/single-consumer audio ring buffer used by VocanaVirtualDevice.
+
+ */
+/*==================================================================================================
+	VocanaRingBuffer.h
+==================================================================================================*/
+
+#ifndef VocanaRingBuffer_h
+#define VocanaRingBuffer_h
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaRingBuffer
+//==================================================================================================
+
+//	The ring buffer carries interleaved Float32 frames from the WriteMix side of the device (the
+//	producer) to the ReadInput side (the consumer). Frames are addressed by absolute sample time,
+//	the same way the HAL addresses them, so the producer and the consumer never have to agree on
+//	a shared "position"; each side just publishes how far it has got.
+//
+//	The producer publishes two cursors: writeBegin is advanced before any frames are copied into
+//	the storage and writeFrame is advanced once the copy is complete. The consumer treats the
+//	frames in [writeFrame - capacity, writeFrame) as readable, and after copying them out it
+//	re-checks writeBegin so that any frames the producer started overwriting in the meantime are
+//	returned as silence rather than as a torn mix of old and new samples. Neither side ever
+//	blocks or takes a lock.
+//
+//	When the platform allows it, the storage is mapped twice back to back in virtual memory
+//	(storage[i] and storage[i + capacity] are the same physical sample), so every read and write
+//	is one contiguous copy no matter where it lands in the ring.
+//
+//	All the state is plain memory owned by the caller, so a VocanaRingBuffer can live in a static
+//	or inside a larger struct. Nothing in this file depends on CoreAudio, so it builds and runs
+//	off macOS as well.
+
+#define kVocanaRingBuffer_CacheLineSize     64
+
+enum
+{
+	//	Never attempt the mirrored mapping; always use two-part copies at the wrap point.
+	kVocanaRingBufferFlag_NoMirror          = 1u << 0,
+};
+
+typedef struct VocanaRingBuffer
+{
+	//	producer cursors
+	_Alignas(kVocanaRingBuffer_CacheLineSize) _Atomic uint64_t  writeBegin;
+	_Atomic uint64_t                                            writeFrame;
+	_Atomic uint64_t                                            firstFrame;
+
+	//	consumer cursor
+	_Alignas(kVocanaRingBuffer_CacheLineSize) _Atomic uint64_t  readFrame;
+
+	//	immutable between Init and Teardown
+	_Alignas(kVocanaRingBuffer_CacheLineSize) float*            storage;
+	uint64_t                                                    frameMask;
+	uint32_t                                                    capacityFrames;
+	uint32_t                                                    channelCount;
+	size_t                                                      storageBytes;
+	bool                                                        isMirrored;
+} VocanaRingBuffer;
+
+//	Allocates the storage for capacityFrames frames of channelCount channels. capacityFrames must
+//	be a power of two. Returns 0 on success or an errno value on failure. Not real-time safe.
+int         VocanaRingBuffer_Init(VocanaRingBuffer* inRingBuffer, uint32_t inCapacityFrames, uint32_t inChannelCount, uint32_t inFlags);
+
+//	Releases the storage. The caller must guarantee that no IO thread is still using the ring.
+void        VocanaRingBuffer_Teardown(VocanaRingBuffer* inRingBuffer);
+
+//	Returns true between a successful Init and the matching Teardown.
+bool        VocanaRingBuffer_IsAllocated(const VocanaRingBuffer* inRingBuffer);
+
+//	Silences the storage and moves every cursor to inFrame. Nothing before inFrame is readable
+//	afterwards. Must not run concurrently with Write or Read.
+void        VocanaRingBuffer_Reset(VocanaRingBuffer* inRingBuffer, uint64_t inFrame);
+
+//	Producer side. Copies inFrameCount interleaved frames into the ring at sample time inFrame.
+//	Frames skipped over since the previous write are silenced so they can't be read back stale.
+//	Real-time safe.
+void        VocanaRingBuffer_Write(VocanaRingBuffer* inRingBuffer, uint64_t inFrame, const float* inFrames, uint32_t inFrameCount);
+
+//	Consumer side. Copies inFrameCount interleaved frames starting at sample time inFrame into
+//	outFrames. Frames that have not been written yet, or that have already been overwritten, come
+//	back as silence. Returns the number of frames that came from the producer's published window
+//	(which includes any frames it silenced when skipping ahead). Real-time safe.
+uint32_t    VocanaRingBuffer_Read(VocanaRingBuffer* inRingBuffer, uint64_t inFrame, float* outFrames, uint32_t inFrameCount);
+
+//	Snapshot of the producer and consumer positions, for diagnostics.
+uint64_t    VocanaRingBuffer_GetWriteFrame(const VocanaRingBuffer* inRingBuffer);
+uint64_t    VocanaRingBuffer_GetReadFrame(const VocanaRingBuffer* inRingBuffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VocanaRingBuffer_h */
@@ -0,0 +1,257 @@
+/*
+     File: VocanaRingBufferLifetime.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Allocate-once lifetime management for the VocanaVirtualDevice ring buffer.
+
+ */
+/*==================================================================================================
+	VocanaRingBufferLifetime.c
+==================================================================================================*/
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include "VocanaRingBufferLifetime.h"
+
+#include <errno.h>
+#include <sched.h>
+#include <string.h>
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Helpers
+//==================================================================================================
+
+//	Un-publishes the running state and waits until no IO thread can still be using the storage.
+//	Must be called with the mutex held. IO operations are a few microseconds long, so the wait is
+//	a short yield loop rather than anything heavier.
+static void lifetime_quiesce(VocanaRingBufferLifetime* inLifetime, uint32_t inNewState)
+{
+	atomic_store(&inLifetime->state, inNewState);
+	while(atomic_load(&inLifetime->ioInFlight) != 0)
+	{
+		sched_yield();
+	}
+}
+
+static int lifetime_allocate(VocanaRingBufferLifetime* inLifetime)
+{
+	int theError = VocanaRingBuffer_Init(&inLifetime->ring, inLifetime->capacityFrames, inLifetime->channelCount, inLifetime->flags);
+	if(theError == 0)
+	{
+		++inLifetime->allocationCount;
+		atomic_store(&inLifetime->state, kVocanaRingBufferState_Idle);
+	}
+	return theError;
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Control
+//==================================================================================================
+
+int VocanaRingBufferLifetime_Init(VocanaRingBufferLifetime* inLifetime, uint32_t inCapacityFrames, uint32_t inChannelCount, uint32_t inRingFlags)
+{
+	if(inLifetime == NULL)
+	{
+		return EINVAL;
+	}
+
+	//	The in-flight count is left alone. Storage that is set up again after a Teardown may still
+	//	have an IO thread that found it before, and that thread's EndIO has to balance its BeginIO,
+	//	or the count would go below zero and the next quiesce would wait forever.
+	memset(&inLifetime->ring, 0, sizeof(inLifetime->ring));
+	atomic_store(&inLifetime->state, kVocanaRingBufferState_Unallocated);
+	inLifetime->runningClients = 0;
+	inLifetime->allocationCount = 0;
+	inLifetime->capacityFrames = inCapacityFrames;
+	inLifetime->channelCount = inChannelCount;
+	inLifetime->flags = inRingFlags;
+
+	int theError = pthread_mutex_init(&inLifetime->mutex, NULL);
+	if(theError != 0)
+	{
+		return theError;
+	}
+
+	theError = lifetime_allocate(inLifetime);
+	if(theError != 0)
+	{
+		pthread_mutex_destroy(&inLifetime->mutex);
+	}
+	return theError;
+}
+
+void VocanaRingBufferLifetime_Teardown(VocanaRingBufferLifetime* inLifetime)
+{
+	if(inLifetime == NULL)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&inLifetime->mutex);
+	lifetime_quiesce(inLifetime, kVocanaRingBufferState_Unallocated);
+	VocanaRingBuffer_Teardown(&inLifetime->ring);
+	inLifetime->runningClients = 0;
+	pthread_mutex_unlock(&inLifetime->mutex);
+
+	pthread_mutex_destroy(&inLifetime->mutex);
+}
+
+int VocanaRingBufferLifetime_Start(VocanaRingBufferLifetime* inLifetime, uint64_t inStartFrame, bool* outIsFirst)
+{
+	int theError = 0;
+	bool isFirst = false;
+
+	pthread_mutex_lock(&inLifetime->mutex);
+
+	if(inLifetime->runningClients == UINT64_MAX)
+	{
+		theError = EOVERFLOW;
+	}
+	else if(inLifetime->runningClients == 0)
+	{
+		//	only reallocates after an explicit trim
+		if(!VocanaRingBuffer_IsAllocated(&inLifetime->ring))
+		{
+			theError = lifetime_allocate(inLifetime);
+		}
+
+		if(theError == 0)
+		{
+			//	stragglers from the previous run may still be finishing their cycle
+			lifetime_quiesce(inLifetime, kVocanaRingBufferState_Idle);
+			VocanaRingBuffer_Reset(&inLifetime->ring, inStartFrame);
+			atomic_store(&inLifetime->state, kVocanaRingBufferState_Running);
+			inLifetime->runningClients = 1;
+			isFirst = true;
+		}
+	}
+	else
+	{
+		++inLifetime->runningClients;
+	}
+
+	pthread_mutex_unlock(&inLifetime->mutex);
+
+	if(outIsFirst != NULL)
+	{
+		*outIsFirst = isFirst;
+	}
+	return theError;
+}
+
+int VocanaRingBufferLifetime_Stop(VocanaRingBufferLifetime* inLifetime, bool* outIsLast)
+{
+	int theError = 0;
+	bool isLast = false;
+
+	pthread_mutex_lock(&inLifetime->mutex);
+
+	if(inLifetime->runningClients == 0)
+	{
+		theError = ERANGE;
+	}
+	else if(--inLifetime->runningClients == 0)
+	{
+		//	no need to wait for IO here; the storage stays put
+		atomic_store(&inLifetime->state, kVocanaRingBufferState_Idle);
+		isLast = true;
+	}
+
+	pthread_mutex_unlock(&inLifetime->mutex);
+
+	if(outIsLast != NULL)
+	{
+		*outIsLast = isLast;
+	}
+	return theError;
+}
+
+int VocanaRingBufferLifetime_Trim(VocanaRingBufferLifetime* inLifetime)
+{
+	int theError = 0;
+
+	pthread_mutex_lock(&inLifetime->mutex);
+
+	if(inLifetime->runningClients > 0)
+	{
+		theError = EBUSY;
+	}
+	else if(VocanaRingBuffer_IsAllocated(&inLifetime->ring))
+	{
+		lifetime_quiesce(inLifetime, kVocanaRingBufferState_Unallocated);
+		VocanaRingBuffer_Teardown(&inLifetime->ring);
+	}
+
+	pthread_mutex_unlock(&inLifetime->mutex);
+	return theError;
+}
+
+int VocanaRingBufferLifetime_SetChannelCount(VocanaRingBufferLifetime* inLifetime, uint32_t inChannelCount)
+{
+	if(inChannelCount == 0)
+	{
+		return EINVAL;
+	}
+
+	int theError = 0;
+
+	pthread_mutex_lock(&inLifetime->mutex);
+
+	if(inLifetime->runningClients > 0)
+	{
+		theError = EBUSY;
+	}
+	else if(inChannelCount != inLifetime->channelCount)
+	{
+		bool wasAllocated = VocanaRingBuffer_IsAllocated(&inLifetime->ring);
+		if(wasAllocated)
+		{
+			lifetime_quiesce(inLifetime, kVocanaRingBufferState_Unallocated);
+			VocanaRingBuffer_Teardown(&inLifetime->ring);
+		}
+		inLifetime->channelCount = inChannelCount;
+		if(wasAllocated)
+		{
+			theError = lifetime_allocate(inLifetime);
+		}
+	}
+
+	pthread_mutex_unlock(&inLifetime->mutex);
+	return theError;
+}
+
+uint64_t VocanaRingBufferLifetime_GetAllocationCount(VocanaRingBufferLifetime* inLifetime)
+{
+	pthread_mutex_lock(&inLifetime->mutex);
+	uint64_t theCount = inLifetime->allocationCount;
+	pthread_mutex_unlock(&inLifetime->mutex);
+	return theCount;
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark IO
+//==================================================================================================
+
+VocanaRingBuffer* VocanaRingBufferLifetime_BeginIO(VocanaRingBufferLifetime* inLifetime)
+{
+	//	Announce the access before looking at the state. Both sides use sequentially consistent
+	//	operations, so either the control thread sees this increment and waits for it, or this
+	//	thread sees the state change and stays away from the storage.
+	atomic_fetch_add(&inLifetime->ioInFlight, 1);
+	if(atomic_load(&inLifetime->state) != kVocanaRingBufferState_Running)
+	{
+		return NULL;
+	}
+	return &inLifetime->ring;
+}
+
+void VocanaRingBufferLifetime_EndIO(VocanaRingBufferLifetime* inLifetime)
+{
+	atomic_fetch_sub_explicit(&inLifetime->ioInFlight, 1, memory_order_release);
+}
@@ -0,0 +1,110 @@
+/*
+     File: VocanaRingBufferLifetime.h
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Allocate-once lifetime management for the VocanaVirtualDevice ring buffer.
+
+ */
+/*==================================================================================================
+	VocanaRingBufferLifetime.h
+==================================================================================================*/
+
+#ifndef VocanaRingBufferLifetime_h
+#define VocanaRingBufferLifetime_h
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include "VocanaRingBuffer.h"
+
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaRingBufferLifetime
+//==================================================================================================
+
+//	Hosts start and stop IO many times a minute, so the ring storage is allocated once, when the
+//	plug-in is initialized, and kept until the plug-in is torn down or Trim is called while no
+//	client is running. StartIO and StopIO only flip the published state.
+//
+//	The control calls (Init, Start, Stop, Trim, Teardown) come from the HAL's non-real-time
+//	threads and are serialized by a mutex. The IO threads never touch that mutex: they bracket
+//	every ring access with BeginIO/EndIO, which announce the access in an atomic in-flight count
+//	and then check the published state. Anything that is about to reset or free the storage
+//	first un-publishes the running state and then waits for the in-flight count to drain, so an
+//	IO thread can never see the storage disappear underneath it.
+
+enum
+{
+	kVocanaRingBufferState_Unallocated  = 0,
+	kVocanaRingBufferState_Idle         = 1,
+	kVocanaRingBufferState_Running      = 2,
+};
+
+typedef struct VocanaRingBufferLifetime
+{
+	VocanaRingBuffer                                            ring;
+
+	//	read by the IO threads on every cycle
+	_Alignas(kVocanaRingBuffer_CacheLineSize) _Atomic uint32_t  state;
+
+	//	written by the IO threads on every cycle
+	_Alignas(kVocanaRingBuffer_CacheLineSize) _Atomic uint32_t  ioInFlight;
+
+	//	control plane
+	_Alignas(kVocanaRingBuffer_CacheLineSize) pthread_mutex_t   mutex;
+	uint64_t                                                    runningClients;
+	uint64_t                                                    allocationCount;
+	uint32_t                                                    capacityFrames;
+	uint32_t                                                    channelCount;
+	uint32_t                                                    flags;
+} VocanaRingBufferLifetime;
+
+//	Allocates the ring storage up front. The capacity and channel count should be the largest the
+//	device will ever need. The lifetime must start out zeroed (static, calloc'd or = { 0 }), and
+//	may be set up again after Teardown while IO threads still bracket their cycles on it. Returns
+//	0 on success or an errno value.
+int                 VocanaRingBufferLifetime_Init(VocanaRingBufferLifetime* inLifetime, uint32_t inCapacityFrames, uint32_t inChannelCount, uint32_t inRingFlags);
+
+//	Waits for any in-flight IO to finish and frees everything. Only for plug-in teardown.
+void                VocanaRingBufferLifetime_Teardown(VocanaRingBufferLifetime* inLifetime);
+
+//	A client started IO. The first client resets the ring to inStartFrame and publishes the
+//	running state; outIsFirst reports whether this call did that. Only allocates if the storage
+//	was trimmed. Returns 0, ENOMEM or EOVERFLOW.
+int                 VocanaRingBufferLifetime_Start(VocanaRingBufferLifetime* inLifetime, uint64_t inStartFrame, bool* outIsFirst);
+
+//	A client stopped IO. The last client un-publishes the running state; outIsLast reports
+//	whether this call did that. The storage is kept. Returns 0 or ERANGE on underflow.
+int                 VocanaRingBufferLifetime_Stop(VocanaRingBufferLifetime* inLifetime, bool* outIsLast);
+
+//	Frees the storage if no client is running. Returns 0 if the storage was freed (or already
+//	was) and EBUSY if IO is running.
+int                 VocanaRingBufferLifetime_Trim(VocanaRingBufferLifetime* inLifetime);
+
+//	Changes the channel count of the storage, reallocating it if it is allocated, for a device
+//	configuration change. Returns 0, EINVAL, EBUSY if IO is running or ENOMEM, in which case the
+//	storage is left unallocated with the new channel count and the next Start tries again.
+int                 VocanaRingBufferLifetime_SetChannelCount(VocanaRingBufferLifetime* inLifetime, uint32_t inChannelCount);
+
+//	IO side. Returns the ring if IO is running, or NULL, in which case the caller should act as
+//	if the ring were silent. Every BeginIO must be paired with EndIO, even when it returns NULL.
+//	Real-time safe.
+VocanaRingBuffer*   VocanaRingBufferLifetime_BeginIO(VocanaRingBufferLifetime* inLifetime);
+void                VocanaRingBufferLifetime_EndIO(VocanaRingBufferLifetime* inLifetime);
+
+//	Number of times the storage has been allocated, for diagnostics and tests.
+uint64_t            VocanaRingBufferLifetime_GetAllocationCount(VocanaRingBufferLifetime* inLifetime);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VocanaRingBufferLifetime_h */
@@ -0,0 +1,352 @@
+/*
+     File: VocanaSpectralGate.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ A lightweight spectral-gate denoiser that runs inside the Vocana HAL plug-ins.
+
+ */
+/*==================================================================================================
+	VocanaSpectralGate.c
+==================================================================================================*/
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include "VocanaSpectralGate.h"
+#include "VocanaChannels.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+//	tuning, in the units a person would think of them in; converted to per-hop values in create
+#define kSpectralGate_SmoothingSeconds      0.040
+#define kSpectralGate_NoiseRiseDBPerSecond  10.0
+#define kSpectralGate_ReleaseSeconds        0.060
+#define kSpectralGate_Threshold             4.0f        //	6 dB over the floor
+#define kSpectralGate_FloorGain             0.1f        //	-20 dB
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Types
+//==================================================================================================
+
+typedef struct SpectralGateChannel
+{
+	float*                  input;          //	the last frameSize input samples
+	float*                  output;         //	overlap-add accumulator, oldest sample first
+	float*                  power;          //	smoothed power per bin
+	float*                  noise;          //	noise floor per bin
+	float*                  gain;           //	gain per bin
+} SpectralGateChannel;
+
+typedef struct VocanaSpectralGate
+{
+	uint32_t                channelCount;
+	uint32_t                frameSize;
+	uint32_t                hopSize;
+	uint32_t                binCount;
+	uint32_t                position;       //	samples into the current hop
+	bool                    hasEstimate;
+
+	float*                  window;
+	float*                  cosine;         //	frameSize / 2 twiddles
+	float*                  sine;
+	uint32_t*               bitReverse;
+	float*                  real;
+	float*                  imaginary;
+
+	float                   powerSmoothing;
+	float                   noiseRise;
+	float                   release;
+
+	SpectralGateChannel*    channels;
+} VocanaSpectralGate;
+
+//==================================================================================================
+#pragma mark -
+#pragma mark FFT
+//==================================================================================================
+
+//	In-place radix-2 complex FFT, forward only; the inverse is taken as the forward transform of
+//	the conjugate, and neither is scaled.
+static void spectral_gate_fft(const VocanaSpectralGate* inGate, float* ioReal, float* ioImaginary)
+{
+	uint32_t theSize = inGate->frameSize;
+	for(uint32_t i = 0; i < theSize; i++)
+	{
+		uint32_t j = inGate->bitReverse[i];
+		if(j > i)
+		{
+			float theReal = ioReal[i];
+			float theImaginary = ioImaginary[i];
+			ioReal[i] = ioReal[j];
+			ioImaginary[i] = ioImaginary[j];
+			ioReal[j] = theReal;
+			ioImaginary[j] = theImaginary;
+		}
+	}
+
+	for(uint32_t theSpan = 1; theSpan < theSize; theSpan <<= 1)
+	{
+		uint32_t theStride = theSize / (2 * theSpan);
+		for(uint32_t theStart = 0; theStart < theSize; theStart += 2 * theSpan)
+		{
+			for(uint32_t k = 0; k < theSpan; k++)
+			{
+				float theCosine = inGate->cosine[k * theStride];
+				float theSine = inGate->sine[k * theStride];
+				uint32_t a = theStart + k;
+				uint32_t b = a + theSpan;
+				float theReal = ioReal[b] * theCosine + ioImaginary[b] * theSine;
+				float theImaginary = ioImaginary[b] * theCosine - ioReal[b] * theSine;
+				ioReal[b] = ioReal[a] - theReal;
+				ioImaginary[b] = ioImaginary[a] - theImaginary;
+				ioReal[a] += theReal;
+				ioImaginary[a] += theImaginary;
+			}
+		}
+	}
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Gate
+//==================================================================================================
+
+static void spectral_gate_process_hop(VocanaSpectralGate* inGate, SpectralGateChannel* inChannel)
+{
+	uint32_t theSize = inGate->frameSize;
+	uint32_t theHop = inGate->hopSize;
+	float* theReal = inGate->real;
+	float* theImaginary = inGate->imaginary;
+
+	for(uint32_t i = 0; i < theSize; i++)
+	{
+		theReal[i] = inChannel->input[i] * inGate->window[i];
+		theImaginary[i] = 0.0f;
+	}
+	spectral_gate_fft(inGate, theReal, theImaginary);
+
+	for(uint32_t k = 0; k < inGate->binCount; k++)
+	{
+		float thePower = theReal[k] * theReal[k] + theImaginary[k] * theImaginary[k];
+		float theSmoothed = inGate->hasEstimate ? inGate->powerSmoothing * inChannel->power[k] + (1.0f - inGate->powerSmoothing) * thePower : thePower;
+		float theNoise = inGate->hasEstimate ? inChannel->noise[k] * inGate->noiseRise : theSmoothed;
+		theNoise = theSmoothed < theNoise ? theSmoothed : theNoise;
+		inChannel->power[k] = theSmoothed;
+		inChannel->noise[k] = theNoise;
+
+		//	open at once, close gradually
+		float theGain = inChannel->gain[k];
+		theGain = theSmoothed > kSpectralGate_Threshold * theNoise ? 1.0f : theGain + (kSpectralGate_FloorGain - theGain) * inGate->release;
+		inChannel->gain[k] = theGain;
+
+		theReal[k] *= theGain;
+		theImaginary[k] *= theGain;
+		if(k > 0 && k < theSize / 2)
+		{
+			theReal[theSize - k] *= theGain;
+			theImaginary[theSize - k] *= theGain;
+		}
+	}
+
+	//	inverse, as a forward transform of the conjugate; only the real part is wanted
+	for(uint32_t i = 0; i < theSize; i++)
+	{
+		theImaginary[i] = -theImaginary[i];
+	}
+	spectral_gate_fft(inGate, theReal, theImaginary);
+
+	memmove(inChannel->output, inChannel->output + theHop, (size_t)(theSize - theHop) * sizeof(float));
+	memset(inChannel->output + theSize - theHop, 0, (size_t)theHop * sizeof(float));
+	float theScale = 1.0f / (float)theSize;
+	for(uint32_t i = 0; i < theSize; i++)
+	{
+		inChannel->output[i] += theReal[i] * theScale * inGate->window[i];
+	}
+	memmove(inChannel->input, inChannel->input + theHop, (size_t)(theSize - theHop) * sizeof(float));
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Processor Interface
+//==================================================================================================
+
+static void spectral_gate_destroy(void* inInstance)
+{
+	VocanaSpectralGate* theGate = (VocanaSpectralGate*)inInstance;
+	if(theGate == NULL)
+	{
+		return;
+	}
+	if(theGate->channels != NULL)
+	{
+		for(uint32_t c = 0; c < theGate->channelCount; c++)
+		{
+			//	each channel's arrays are one allocation
+			free(theGate->channels[c].input);
+		}
+		free(theGate->channels);
+	}
+	free(theGate->window);
+	free(theGate->bitReverse);
+	free(theGate);
+}
+
+static void spectral_gate_reset(void* inInstance)
+{
+	VocanaSpectralGate* theGate = (VocanaSpectralGate*)inInstance;
+	for(uint32_t c = 0; c < theGate->channelCount; c++)
+	{
+		SpectralGateChannel* theChannel = &theGate->channels[c];
+		memset(theChannel->input, 0, (size_t)(2 * theGate->frameSize + 2 * theGate->binCount) * sizeof(float));
+		for(uint32_t k = 0; k < theGate->binCount; k++)
+		{
+			theChannel->gain[k] = 1.0f;
+		}
+	}
+	theGate->position = 0;
+	theGate->hasEstimate = false;
+}
+
+static int spectral_gate_create(const VocanaProcessorConfiguration* inConfiguration, void** outInstance)
+{
+	if(inConfiguration->channelCount == 0 || !(inConfiguration->sampleRate > 0.0))
+	{
+		return EINVAL;
+	}
+
+	VocanaSpectralGate* theGate = (VocanaSpectralGate*)calloc(1, sizeof(VocanaSpectralGate));
+	if(theGate == NULL)
+	{
+		return ENOMEM;
+	}
+
+	//	about 10 ms, whatever the sample rate
+	uint32_t theSize = inConfiguration->sampleRate > 48000.0 ? 1024 : 512;
+	theGate->channelCount = inConfiguration->channelCount;
+	theGate->frameSize = theSize;
+	theGate->hopSize = theSize / 2;
+	theGate->binCount = theSize / 2 + 1;
+
+	//	window, twiddles and the two FFT work buffers share one allocation
+	theGate->window = (float*)calloc((size_t)theSize * 4, sizeof(float));
+	theGate->bitReverse = (uint32_t*)calloc(theSize, sizeof(uint32_t));
+	theGate->channels = (SpectralGateChannel*)calloc(theGate->channelCount, sizeof(SpectralGateChannel));
+	if(theGate->window == NULL || theGate->bitReverse == NULL || theGate->channels == NULL)
+	{
+		spectral_gate_destroy(theGate);
+		return ENOMEM;
+	}
+	theGate->cosine = theGate->window + theSize;
+	theGate->sine = theGate->cosine + theSize / 2;
+	theGate->real = theGate->sine + theSize / 2;
+	theGate->imaginary = theGate->real + theSize;
+
+	uint32_t theBits = 0;
+	while((1u << theBits) < theSize)
+	{
+		theBits++;
+	}
+	for(uint32_t i = 0; i < theSize; i++)
+	{
+		uint32_t theReversed = 0;
+		for(uint32_t b = 0; b < theBits; b++)
+		{
+			theReversed |= ((i >> b) & 1u) << (theBits - 1 - b);
+		}
+		theGate->bitReverse[i] = theReversed;
+
+		//	periodic Hann, square-rooted for both analysis and synthesis, sums to one at 50% overlap
+		theGate->window[i] = (float)sqrt(0.5 - 0.5 * cos(2.0 * M_PI * i / theSize));
+	}
+	for(uint32_t k = 0; k < theSize / 2; k++)
+	{
+		theGate->cosine[k] = (float)cos(2.0 * M_PI * k / theSize);
+		theGate->sine[k] = (float)sin(2.0 * M_PI * k / theSize);
+	}
+
+	for(uint32_t c = 0; c < theGate->channelCount; c++)
+	{
+		SpectralGateChannel* theChannel = &theGate->channels[c];
+		theChannel->input = (float*)calloc((size_t)(2 * theSize + 3 * theGate->binCount), sizeof(float));
+		if(theChannel->input == NULL)
+		{
+			spectral_gate_destroy(theGate);
+			return ENOMEM;
+		}
+		theChannel->output = theChannel->input + theSize;
+		theChannel->power = theChannel->output + theSize;
+		theChannel->noise = theChannel->power + theGate->binCount;
+		theChannel->gain = theChannel->noise + theGate->binCount;
+	}
+
+	double theHopRate = inConfiguration->sampleRate / theGate->hopSize;
+	theGate->powerSmoothing = (float)exp(-1.0 / (kSpectralGate_SmoothingSeconds * theHopRate));
+	theGate->noiseRise = (float)pow(10.0, kSpectralGate_NoiseRiseDBPerSecond / 10.0 / theHopRate);
+	theGate->release = (float)(1.0 - exp(-1.0 / (kSpectralGate_ReleaseSeconds * theHopRate)));
+
+	spectral_gate_reset(theGate);
+	*outInstance = theGate;
+	return 0;
+}
+
+static uint32_t spectral_gate_latency(void* inInstance)
+{
+	return ((VocanaSpectralGate*)inInstance)->frameSize;
+}
+
+static void spectral_gate_process(void* inInstance, const float* inFrames, float* outFrames, uint32_t inFrameCount)
+{
+	VocanaSpectralGate* theGate = (VocanaSpectralGate*)inInstance;
+	uint32_t theChannels = theGate->channelCount;
+	uint32_t theHop = theGate->hopSize;
+	uint32_t theTail = theGate->frameSize - theHop;
+
+	uint32_t theDone = 0;
+	while(theDone < inFrameCount)
+	{
+		uint32_t theCount = theHop - theGate->position;
+		theCount = theCount < inFrameCount - theDone ? theCount : inFrameCount - theDone;
+
+		//	each channel is read before its slots are written, so the buffers may be the same
+		for(uint32_t c = 0; c < theChannels; c++)
+		{
+			SpectralGateChannel* theChannel = &theGate->channels[c];
+			VocanaChannels_Deinterleave(inFrames + (size_t)theDone * theChannels, theChannels, c, theChannel->input + theTail + theGate->position, theCount);
+			VocanaChannels_Interleave(theChannel->output + theGate->position, outFrames + (size_t)theDone * theChannels, theChannels, c, theCount);
+		}
+		theGate->position += theCount;
+		theDone += theCount;
+
+		if(theGate->position == theHop)
+		{
+			for(uint32_t c = 0; c < theChannels; c++)
+			{
+				spectral_gate_process_hop(theGate, &theGate->channels[c]);
+			}
+			theGate->position = 0;
+			theGate->hasEstimate = true;
+		}
+	}
+}
+
+static const VocanaProcessorInterface kSpectralGate_Interface =
+{
+	kVocanaProcessor_InterfaceVersion,
+	"Spectral Gate",
+	spectral_gate_create,
+	spectral_gate_destroy,
+	spectral_gate_reset,
+	spectral_gate_latency,
+	spectral_gate_process,
+};
+
+const VocanaProcessorInterface* VocanaSpectralGate_GetInterface(void)
+{
+	return &kSpectralGate_Interface;
+}
@@ -0,0 +1,49 @@
+/*
+     File: VocanaSpectralGate.h
+
+ Copyright (C) 2024 Vocana Inc.
+
+ A lightweight spectral-gate denoiser that runs inside the Vocana HAL plug-ins.
+
+ */
+/*==================================================================================================
+	VocanaSpectralGate.h
+==================================================================================================*/
+
+#ifndef VocanaSpectralGate_h
+#define VocanaSpectralGate_h
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include "VocanaProcessor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaSpectralGate
+//==================================================================================================
+
+//	The denoiser the plug-in can fall back on when the app's models aren't available. It is a
+//	short-time spectral gate: each channel goes through a windowed FFT of about 10 ms with 50%
+//	overlap, every bin tracks the noise floor as the minimum of its smoothed power, allowed to
+//	creep up by 10 dB a second, and bins that aren't at least 6 dB above their floor are turned
+//	down by 20 dB, not muted, so the background never drops out entirely. Gains open at once and
+//	close over tens of milliseconds so the onsets and tails of words aren't clipped.
+//
+//	Analysis and synthesis use square-root Hann windows, so with the gate open the output is the
+//	input exactly, one frame (latency) late. A stereo cycle of 512 frames costs four 512-point
+//	FFTs and four inverse FFTs, a few microseconds. Nothing in this file depends on CoreAudio.
+
+//	The processor interface for the spectral gate, for VocanaProcessorStage.
+const VocanaProcessorInterface*     VocanaSpectralGate_GetInterface(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VocanaSpectralGate_h */
@@ -15,14 +15,26 @@
 //==================================================================================================
 
 #include <CoreAudio/AudioServerPlugIn.h>
+#include <errno.h>
 #include <dispatch/dispatch.h>
 #include <mach/mach_time.h>
 #include <pthread.h>
 #include <stdint.h>
 #include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
 #include <sys/syslog.h>
 #include <Accelerate/Accelerate.h>
 #include <Availability.h>
+#include "VocanaChannels.h"
+#include "VocanaClock.h"
+#include "VocanaDeviceRegistry.h"
+#include "VocanaDeviceState.h"
+#include "VocanaMixBus.h"
+#include "VocanaProcessor.h"
+#include "VocanaPropertyTable.h"
+#include "VocanaRingBufferLifetime.h"
+#include "VocanaSpectralGate.h"
 
 //==================================================================================================
 #pragma mark -
@@ -86,7 +98,8 @@
 //    The driver has the following
 //    qualities:
 //    - a box
-//    - a device
+//    - one or more devices, as many as kVocanaPlugInPropertyDeviceCount asks for, each with a
+//      hidden mirror
 //        - supports 44100, 48000, 88200, 96000, 176400, 192000, 352800, 384000, 705600, 768000, 8000, 16000 sample rates
 
 
@@ -104,12 +117,13 @@
 //        - master output mute
 
 
-//    Declare the internal object ID numbers for all the objects this driver implements. Note that
-//    because the driver has fixed set of objects that never grows or shrinks. If this were not the
-//    case, the driver would need to have a means to dynamically allocate these IDs. It is important
-//    to realize that a lot of the structure of this driver is vastly simpler when the IDs are all
-//    known a priori. Comments in the code will try to identify some of these simplifications and
-//    point out what a more complicated driver will need to do.
+//    Declare the internal object ID numbers for all the objects this driver implements. The plug-in
+//    and the box have fixed IDs. The devices come and go at run time, so the device registry hands
+//    each one a block of IDs (see VocanaDeviceRegistry.h) that holds the device, its streams and
+//    controls and its mirror, at the offsets from kObjectID_Device the constants below give them.
+//    The first device's block starts at kObjectID_Device, so for it the constants are the IDs
+//    themselves, as they were when it was the only device; for every device they are the kinds of
+//    object the code switches on, see object_kind().
 enum
 {
     kObjectID_PlugIn                    = kAudioObjectPlugInObject,
@@ -124,6 +138,8 @@ enum
     kObjectID_Pitch_Adjust              = 10,
     kObjectID_ClockSource               = 11,
     kObjectID_Device2                   = 12,
+
+    kDevice_ObjectBlockSize             = kObjectID_Device2 - kObjectID_Device + 1,
 };
 
 enum
@@ -131,6 +147,7 @@ enum
     ChangeAction_SetSampleRate          = 1,
     ChangeAction_EnablePitchControl     = 2,
     ChangeAction_DisablePitchControl    = 3,
+    ChangeAction_SetChannelCount        = 4,
 };
 
 enum ObjectType
@@ -145,11 +162,11 @@ struct ObjectInfo {
     AudioObjectPropertyScope scope;
 };
 
-//    Declare the stuff that tracks the state of the plug-in, the device and its sub-objects.
-//    Note that we use global variables here because this driver only ever has a single device. If
-//    multiple devices were supported, this state would need to be encapsulated in one or more structs
-//    so that each object's state can be tracked individually.
-//    Note also that we share a single mutex across all objects to be thread safe for the same reason.
+//    Declare the stuff that tracks the state of the plug-in, the devices and their sub-objects. The
+//    plug-in's own state is global; everything a device owns lives in its VocanaDeviceInstance
+//    below, so devices never share anything but the plug-in.
+//    Note that we share a single mutex across all objects to be thread safe; nothing on the IO
+//    path takes it.
 
 
 #ifndef kDriver_Name
@@ -236,9 +253,18 @@ struct ObjectInfo {
 
 #define                             kLatency_Frame_Size                 0
 
+//    the channel count until the Info.plist or the app says otherwise, see VocanaChannels.h; it
+//    also names the device and its UIDs, which must not change when the count does
 #ifndef kNumber_Of_Channels
 #define                             kNumber_Of_Channels                 2
 #endif
+#define                             kChannelCount_StorageKey            "channel count"
+
+//    the number of devices until the app says otherwise
+#ifndef kNumber_Of_Devices
+#define                             kNumber_Of_Devices                  1
+#endif
+#define                             kDeviceCount_StorageKey             "device count"
 
 #ifndef kEnableVolumeControl
 #define                             kEnableVolumeControl                 true
@@ -265,32 +291,30 @@ static CFStringRef                  gBox_Name                           = NULL;
 static Boolean                      gBox_Acquired                       = kBox_Aquired;
 
 
-static pthread_mutex_t              gDevice_IOMutex                     = PTHREAD_MUTEX_INITIALIZER;
-static Float64                      gDevice_SampleRate                  = 48000.0;
-static Float64                      gDevice_RequestedSampleRate         = 0.0;
-static atomic_uint_fast64_t           gDevice_IOIsRunning                 = 0;
-static atomic_uint_fast64_t           gDevice2_IOIsRunning                = 0;
 static const UInt32                 kDevice_RingBufferSize              = 16384;
-static Float64                      gDevice_HostTicksPerFrame           = 0.0;
-static Float64                      gDevice_AdjustedTicksPerFrame       = 0.0;
-static _Atomic Float64               gDevice_PreviousTicks               = 0.0;
-static _Atomic UInt64                gDevice_NumberTimeStamps            = 0;
-static Float64                      gDevice_AnchorSampleTime            = 0.0;
-static _Atomic UInt64                gDevice_AnchorHostTime              = 0;
-
-static bool                         gStream_Input_IsActive              = true;
-static bool                         gStream_Output_IsActive             = true;
+static Float64                      gDevice_HostClockFrequency          = 0.0;
 
 static const Float32                kVolume_MinDB                       = -64.0;
 static const Float32                kVolume_MaxDB                       = 0.0;
-static Float32                      gVolume_Master_Value                = 1.0;
-static Float32                      gPitch_Adjust                       = 0.5;
-static bool                         gMute_Master_Value                  = false;
 static UInt32                       kClockSource_NumberItems            = 2;
 #define                             kClockSource_InternalFixed         "Internal Fixed"
 #define                             kClockSource_InternalAdjustable    "Internal Adjustable"
-static _Atomic UInt32                gClockSource_Value                  = 0;
-static bool                         gPitch_Adjust_Enabled               = false;
+
+//    The values of a device's properties and controls are published as one snapshot that
+//    property queries and the IO threads read without taking gPlugIn_StateMutex; setters still
+//    take it to serialize with each other. Every IO thread has its own reader.
+static const VocanaDeviceStateValues kDevice_InitialState               = {
+    .sampleRate             = 48000.0,
+    .volume                 = 1.0f,
+    .pitchAdjust            = 0.5f,
+    .clockSource            = 0,
+    .channelCount           = kNumber_Of_Channels,
+    .isMuted                = false,
+    .isPitchAdjustEnabled   = false,
+    .isInputActive          = true,
+    .isOutputActive         = true,
+};
+
 
 static struct ObjectInfo            kDevice_ObjectList[]                = {
 #if kDevice_HasInput
@@ -323,6 +347,13 @@ static struct ObjectInfo            kDevice2_ObjectList[]                = {
 static const UInt32                 kDevice_ObjectListSize              = sizeof(kDevice_ObjectList) / sizeof(struct ObjectInfo);
 static const UInt32                 kDevice2_ObjectListSize              = sizeof(kDevice2_ObjectList) / sizeof(struct ObjectInfo);
 
+//    the plug-in's and the devices' custom properties, see VocanaDeviceRegistry.h, VocanaClock.h and
+//    VocanaChannels.h
+static const AudioObjectPropertySelector kPlugIn_CustomPropertyList[]   = { kVocanaPlugInPropertyDeviceCount };
+static const UInt32                 kPlugIn_CustomPropertyListSize       = sizeof(kPlugIn_CustomPropertyList) / sizeof(AudioObjectPropertySelector);
+static const AudioObjectPropertySelector kDevice_CustomPropertyList[]   = { kVocanaDevicePropertyClockReference, kVocanaDevicePropertyClockStatistics, kVocanaDevicePropertyChannelCount };
+static const UInt32                 kDevice_CustomPropertyListSize       = sizeof(kDevice_CustomPropertyList) / sizeof(AudioObjectPropertySelector);
+
 #ifndef kSampleRates
 #define                             kSampleRates       8000, 16000, 24000, 44100, 48000, 88200, 96000, 176400, 192000, 352800, 384000, 705600, 768000
 #endif
@@ -335,12 +366,74 @@ static const UInt32                 kDevice_SampleRatesSize             = sizeof
 
 #define                             kBits_Per_Channel                   32
 #define                             kBytes_Per_Channel                  (kBits_Per_Channel/ 8)
-#define                             kBytes_Per_Frame                    (kNumber_Of_Channels * kBytes_Per_Channel)
-#define                             kRing_Buffer_Frame_Size             (2048) // ~42ms at 48kHz - optimized for low latency
-static Float32*                     gRingBuffer = NULL;
-static atomic_uint_fast64_t         gRingBufferWritePos = 0;
-static atomic_bool                   isBufferClearAtomic = true;
-static pthread_mutex_t               gRingBufferMutex = PTHREAD_MUTEX_INITIALIZER;
+#define                             kRing_Buffer_Frame_Size             (2048) // ~42ms at 48kHz - optimized for low latency, must be a power of two
+#define                             kRing_Buffer_Reference_Rate         (48000.0)
+static dispatch_source_t            gRingBufferMemoryPressureSource     = NULL;
+#define                             kMix_Bus_Max_Frames                 (4096) // largest IO buffer the HAL hands a client
+#define                             kMix_Bus_Clip_Level                 (1.0f)
+
+//    The plug-in's spectral gate, run over every mix a device publishes so that both devices'
+//    inputs hear it cleaned up. Off by default, which leaves the devices plain loopbacks; turning
+//    it on adds the gate's latency to the input latency they declare. It may spend a quarter of a
+//    cycle, and after a run of slower cycles it is bypassed for a second.
+#ifndef kDevice_InProcessDenoise
+#define                             kDevice_InProcessDenoise            0
+#endif
+#define                             kDenoise_Budget                     (0.25)
+#define                             kDenoise_BackoffSeconds             (1.0)
+#define                             kDenoise_FadeFrames                 (128)
+static VocanaPropertyTable          gPlugIn_PropertyTable;
+
+//    What one of a device's IO threads owns. The device and its mirror share their instance's clock
+//    and controls, but the HAL runs them on IO threads of their own, so each publishes its output
+//    through a mix bus and ring of its own, which only its IO thread writes. Both devices' inputs
+//    play back both rings.
+typedef struct VocanaDeviceIO
+{
+    _Alignas(kVocanaDeviceRegistry_CacheLineSize) atomic_uint_fast64_t      isRunning;
+    VocanaDeviceStateReader                                                 stateReader;
+    _Alignas(kVocanaDeviceRegistry_CacheLineSize) VocanaRingBufferLifetime  ringBufferLifetime;
+    _Alignas(kVocanaDeviceRegistry_CacheLineSize) VocanaMixBus              mixBus;
+#if kDevice_InProcessDenoise
+    //    what the mix bus runs its mixes through; only changed while the lane's IO is stopped
+    VocanaProcessorStage                                                    denoiser;
+    bool                                                                    hasDenoiser;
+    Float64                                                                 denoiserSampleRate;
+    UInt32                                                                  denoiserChannelCount;
+    atomic_uint_fast32_t                                                    denoiserLatency;
+#endif
+} VocanaDeviceIO;
+
+//    Everything a device owns. Each part that an IO thread writes starts a cache line of its own,
+//    and so does each instance, so meetings running on different devices at the same time never
+//    write to the same line. The instances are static, so they start out zeroed, which the ring
+//    lifetimes rely on when a slot is reused (see VocanaRingBufferLifetime_Init).
+typedef struct VocanaDeviceInstance
+{
+    VocanaDeviceIO                                                          io[2];      //    see device_io()
+
+    //    The channel count the IO path works with. It only changes in
+    //    PerformDeviceConfigurationChange while no IO is running, so unlike the state snapshot no
+    //    IO thread can see it out of date.
+    _Alignas(kVocanaDeviceRegistry_CacheLineSize) VocanaDeviceState         state;
+    atomic_uint_fast32_t                                                    ioChannelCount;
+
+    //    the one timeline of both devices, started by whichever of them starts first; both IO
+    //    threads ask it for zero time stamps, which it serves lock-free (see VocanaClock.h)
+    _Alignas(kVocanaDeviceRegistry_CacheLineSize) VocanaClock               clock;
+    atomic_uint_fast32_t                                                    runningDevices;
+
+    //    under gPlugIn_StateMutex
+    _Alignas(kVocanaDeviceRegistry_CacheLineSize) Float64                   requestedSampleRate;
+    UInt32                                                                  requestedChannelCount;
+    UInt32                                                                  slot;       //    its registry slot, which is also its place in the device list
+} VocanaDeviceInstance;
+
+//    The devices take the registry's slots from the front and are removed from the back, so the
+//    devices are always the first VocanaDeviceRegistry_GetCount instances. An instance is set up
+//    when its device is added and torn down when it is removed; the array itself never moves.
+static VocanaDeviceRegistry         gDevice_Registry;
+static VocanaDeviceInstance         gDevice_Instances[kVocanaDeviceRegistry_MaxDevices];
 
 
 //==================================================================================================
@@ -376,33 +469,18 @@ static OSStatus        VocanaVirtualDevice_DoIOOperation(AudioServerPlugInDriver
 static OSStatus        VocanaVirtualDevice_EndIOOperation(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID, UInt32 inClientID, UInt32 inOperationID, UInt32 inIOBufferFrameSize, const AudioServerPlugInIOCycleInfo* inIOCycleInfo);
 
 //    Implementation
-static Boolean        VocanaVirtualDevice_HasPlugInProperty(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress);
-static OSStatus        VocanaVirtualDevice_IsPlugInPropertySettable(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, Boolean* outIsSettable);
-static OSStatus        VocanaVirtualDevice_GetPlugInPropertyDataSize(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32* outDataSize);
 static OSStatus        VocanaVirtualDevice_GetPlugInPropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, UInt32* outDataSize, void* outData);
 static OSStatus        VocanaVirtualDevice_SetPlugInPropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, const void* inData, UInt32* outNumberPropertiesChanged, AudioObjectPropertyAddress outChangedAddresses[2]);
 
-static Boolean        VocanaVirtualDevice_HasBoxProperty(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress);
-static OSStatus        VocanaVirtualDevice_IsBoxPropertySettable(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, Boolean* outIsSettable);
-static OSStatus        VocanaVirtualDevice_GetBoxPropertyDataSize(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32* outDataSize);
 static OSStatus        VocanaVirtualDevice_GetBoxPropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, UInt32* outDataSize, void* outData);
 static OSStatus        VocanaVirtualDevice_SetBoxPropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, const void* inData, UInt32* outNumberPropertiesChanged, AudioObjectPropertyAddress outChangedAddresses[2]);
 
-static Boolean        VocanaVirtualDevice_HasDeviceProperty(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress);
-static OSStatus        VocanaVirtualDevice_IsDevicePropertySettable(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, Boolean* outIsSettable);
-static OSStatus        VocanaVirtualDevice_GetDevicePropertyDataSize(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32* outDataSize);
 static OSStatus        VocanaVirtualDevice_GetDevicePropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, UInt32* outDataSize, void* outData);
 static OSStatus        VocanaVirtualDevice_SetDevicePropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, const void* inData, UInt32* outNumberPropertiesChanged, AudioObjectPropertyAddress outChangedAddresses[2]);
 
-static Boolean        VocanaVirtualDevice_HasStreamProperty(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress);
-static OSStatus        VocanaVirtualDevice_IsStreamPropertySettable(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, Boolean* outIsSettable);
-static OSStatus        VocanaVirtualDevice_GetStreamPropertyDataSize(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32* outDataSize);
 static OSStatus        VocanaVirtualDevice_GetStreamPropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, UInt32* outDataSize, void* outData);
 static OSStatus        VocanaVirtualDevice_SetStreamPropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, const void* inData, UInt32* outNumberPropertiesChanged, AudioObjectPropertyAddress outChangedAddresses[2]);
 
-static Boolean        VocanaVirtualDevice_HasControlProperty(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress);
-static OSStatus        VocanaVirtualDevice_IsControlPropertySettable(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, Boolean* outIsSettable);
-static OSStatus        VocanaVirtualDevice_GetControlPropertyDataSize(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32* outDataSize);
 static OSStatus        VocanaVirtualDevice_GetControlPropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, UInt32* outDataSize, void* outData);
 static OSStatus        VocanaVirtualDevice_SetControlPropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, const void* inData, UInt32* outNumberPropertiesChanged, AudioObjectPropertyAddress outChangedAddresses[2]);
 
@@ -438,22 +516,106 @@ static AudioServerPlugInDriverInterface*    gAudioServerPlugInDriverInterfacePtr
 static AudioServerPlugInDriverRef            gAudioServerPlugInDriverRef                = &gAudioServerPlugInDriverInterfacePtr;
 
 
-#define RETURN_FORMATTED_STRING(_string_fmt)                          \
+static VocanaDeviceStateValues device_state(const VocanaDeviceInstance* inInstance);
+
+//	the UIDs keep the build's channel count so that apps find the device again after the count
+//	changes; the names show the current one
+#define RETURN_FORMATTED_STRING(_string_fmt, _channels)               \
 if(kHas_Driver_Name_Format)                                           \
 {                                                                     \
-	return CFStringCreateWithFormat(NULL, NULL, CFSTR(_string_fmt), kNumber_Of_Channels); \
+	return CFStringCreateWithFormat(NULL, NULL, CFSTR(_string_fmt), (int)(_channels)); \
 }                                                                     \
 else                                                                  \
 {                                                                     \
 	return CFStringCreateWithCString(NULL, _string_fmt, kCFStringEncodingUTF8); \
 }
 
-static CFStringRef get_box_uid(void)          { RETURN_FORMATTED_STRING(kBox_UID) }
-static CFStringRef get_device_uid(void)       { RETURN_FORMATTED_STRING(kDevice_UID) }
-static CFStringRef get_device_name(void)      { RETURN_FORMATTED_STRING(kDevice_Name) }
-static CFStringRef get_device2_uid(void)      { RETURN_FORMATTED_STRING(kDevice2_UID) }
-static CFStringRef get_device2_name(void)     { RETURN_FORMATTED_STRING(kDevice2_Name) }
-static CFStringRef get_device_model_uid(void) { RETURN_FORMATTED_STRING(kDevice_ModelUID) }
+static CFStringRef get_box_uid(void)          { RETURN_FORMATTED_STRING(kBox_UID, kNumber_Of_Channels) }
+static CFStringRef get_device_model_uid(void) { RETURN_FORMATTED_STRING(kDevice_ModelUID, kNumber_Of_Channels) }
+
+//	The first device keeps the strings it had when it was the only one, so apps and the user's
+//	settings still find it; the others append their number to them.
+static CFStringRef copy_instance_string(const char* inFormat, int inChannels, const VocanaDeviceInstance* inInstance, const char* inSeparator)
+{
+	char theString[256];
+	int theLength = kHas_Driver_Name_Format ? snprintf(theString, sizeof(theString), inFormat, inChannels) : snprintf(theString, sizeof(theString), "%s", inFormat);
+	if(inInstance->slot > 0 && theLength >= 0 && (size_t)theLength < sizeof(theString))
+	{
+		snprintf(theString + theLength, sizeof(theString) - (size_t)theLength, "%s%u", inSeparator, (unsigned)inInstance->slot + 1);
+	}
+	return CFStringCreateWithCString(NULL, theString, kCFStringEncodingUTF8);
+}
+
+static CFStringRef get_device_uid(const VocanaDeviceInstance* inInstance)   { return copy_instance_string(kDevice_UID, kNumber_Of_Channels, inInstance, "_"); }
+static CFStringRef get_device_name(const VocanaDeviceInstance* inInstance)  { return copy_instance_string(kDevice_Name, (int)device_state(inInstance).channelCount, inInstance, " #"); }
+static CFStringRef get_device2_uid(const VocanaDeviceInstance* inInstance)  { return copy_instance_string(kDevice2_UID, kNumber_Of_Channels, inInstance, "_"); }
+static CFStringRef get_device2_name(const VocanaDeviceInstance* inInstance) { return copy_instance_string(kDevice2_Name, (int)device_state(inInstance).channelCount, inInstance, " #"); }
+
+#pragma mark Devices
+
+//	What kind of object inObjectID is, see the object ID enum, and the instance of the device it
+//	belongs to, or NULL for the plug-in and the box. kAudioObjectUnknown if it is no object of
+//	this driver. Real-time safe.
+static AudioObjectID object_kind(AudioObjectID inObjectID, VocanaDeviceInstance** outInstance)
+{
+	uint32_t theSlot = 0;
+	uint32_t theOffset = 0;
+	*outInstance = NULL;
+	if(inObjectID == kObjectID_PlugIn || inObjectID == kObjectID_Box)
+	{
+		return inObjectID;
+	}
+	if(!VocanaDeviceRegistry_Find(&gDevice_Registry, inObjectID, &theSlot, &theOffset))
+	{
+		return kAudioObjectUnknown;
+	}
+	*outInstance = &gDevice_Instances[theSlot];
+	return kObjectID_Device + theOffset;
+}
+
+//	The ID of the instance's object of the given kind.
+static AudioObjectID object_id(const VocanaDeviceInstance* inInstance, AudioObjectID inKind)
+{
+	return VocanaDeviceRegistry_GetFirstObjectID(&gDevice_Registry, inInstance->slot) + (inKind - kObjectID_Device);
+}
+
+//	The instance of the device or mirror inDeviceObjectID, and which of the two it is. Real-time
+//	safe.
+static bool find_device(AudioObjectID inDeviceObjectID, VocanaDeviceInstance** outInstance, AudioObjectID* outKind)
+{
+	*outKind = object_kind(inDeviceObjectID, outInstance);
+	return *outKind == kObjectID_Device || *outKind == kObjectID_Device2;
+}
+
+static VocanaDeviceIO* device_io(VocanaDeviceInstance* inInstance, AudioObjectID inKind)
+{
+	return &inInstance->io[inKind == kObjectID_Device2 ? 1 : 0];
+}
+
+//	The IO lane of the other device of the pair.
+static VocanaDeviceIO* other_device_io(VocanaDeviceInstance* inInstance, AudioObjectID inKind)
+{
+	return &inInstance->io[inKind == kObjectID_Device2 ? 0 : 1];
+}
+
+//	Writes the IDs of the devices, each followed by its mirror, and returns how many it wrote, or
+//	how many there are if outDeviceIDs is NULL. Call with gPlugIn_StateMutex held.
+static UInt32 copy_device_list(AudioObjectID* outDeviceIDs, UInt32 inMaxCount)
+{
+	UInt32 theCount = gBox_Acquired ? 2 * VocanaDeviceRegistry_GetCount(&gDevice_Registry) : 0;
+	if(outDeviceIDs != NULL)
+	{
+		if(theCount > inMaxCount)
+		{
+			theCount = inMaxCount;
+		}
+		for(UInt32 i = 0; i < theCount; i++)
+		{
+			outDeviceIDs[i] = object_id(&gDevice_Instances[i / 2], (i % 2 == 0) ? kObjectID_Device : kObjectID_Device2);
+		}
+	}
+	return theCount;
+}
 
 // Volume conversions
 
@@ -485,9 +647,9 @@ static Float32 volume_from_scalar(Float32 scalar)
 	return volume_from_decibel(decibel);
 }
 
-static UInt32 device_object_list_size(AudioObjectPropertyScope scope, AudioObjectID objectID) {
+static UInt32 device_object_list_size(AudioObjectPropertyScope scope, AudioObjectID kind) {
     
-    switch (objectID) {
+    switch (kind) {
         case kObjectID_Device:
             {
                 if (scope == kAudioObjectPropertyScopeGlobal)
@@ -528,9 +690,9 @@ static UInt32 device_object_list_size(AudioObjectPropertyScope scope, AudioObjec
     }
 }
 
-static UInt32 device_stream_list_size(AudioObjectPropertyScope scope, AudioObjectID objectID) {
+static UInt32 device_stream_list_size(AudioObjectPropertyScope scope, AudioObjectID kind) {
     
-    switch (objectID) {
+    switch (kind) {
         case kObjectID_Device:
             {
                 UInt32 count = 0;
@@ -563,9 +725,9 @@ static UInt32 device_stream_list_size(AudioObjectPropertyScope scope, AudioObjec
 
 }
 
-static UInt32 device_control_list_size(AudioObjectPropertyScope scope, AudioObjectID objectID) {
+static UInt32 device_control_list_size(AudioObjectPropertyScope scope, AudioObjectID kind) {
     
-    switch (objectID) {
+    switch (kind) {
         case kObjectID_Device:
         {
             
@@ -615,133 +777,779 @@ static bool is_valid_sample_rate(Float64 sample_rate)
     return false;
 }
 
-#pragma mark Factory
+//	The ring is allocated once, so size it for the highest rate the device can be switched to.
+//	It keeps the same ~42ms of history at that rate; at lower rates it simply holds more.
+static UInt32 ring_buffer_capacity_for_max_sample_rate(void)
+{
+    Float64 theMaxSampleRate = kRing_Buffer_Reference_Rate;
+    for(UInt32 i = 0; i < kDevice_SampleRatesSize; i++)
+    {
+        if (kDevice_SampleRates[i] > theMaxSampleRate)
+        {
+            theMaxSampleRate = kDevice_SampleRates[i];
+        }
+    }
 
-void*	VocanaVirtualDevice_Create(CFAllocatorRef inAllocator, CFUUIDRef inRequestedTypeUUID)
+    Float64 theFrames = kRing_Buffer_Frame_Size * theMaxSampleRate / kRing_Buffer_Reference_Rate;
+    UInt32 theCapacity = kRing_Buffer_Frame_Size;
+    while((Float64)theCapacity < theFrames)
+    {
+        theCapacity <<= 1;
+    }
+    return theCapacity;
+}
+
+//	The pitch control runs the device up to 1% fast (1.0) or slow (0.0) by scaling the host ticks
+//	per frame of the clock; 0.5 leaves it alone.
+static Float64 pitch_adjust_rate_trim(Float32 inPitch)
 {
-	//	This is the CFPlugIn factory function. Its job is to create the implementation for the given
-	//	type provided that the type is supported. Because this driver is simple and all its
-	//	initialization is handled via static initialization when the bundle is loaded, all that
-	//	needs to be done is to return the AudioServerPlugInDriverRef that points to the driver's
-	//	interface. A more complicated driver would create any base line objects it needs to satisfy
-	//	the IUnknown methods that are used to discover that actual interface to talk to the driver.
-	//	The majority of the driver's initialization should be handled in the Initialize() method of
-	//	the driver's AudioServerPlugInDriverInterface.
-	
-	#pragma unused(inAllocator)
-    void* theAnswer = NULL;
-    if(CFEqual(inRequestedTypeUUID, kAudioServerPlugInTypeUUID))
+    return 1.0 - 2.0 * ((Float64)inPitch - 0.5) / 100.0;
+}
+
+//	A consistent copy of the device's property state. Never takes the state mutex.
+static VocanaDeviceStateValues device_state(const VocanaDeviceInstance* inInstance)
+{
+    VocanaDeviceStateValues theState;
+    VocanaDeviceState_Read(&inInstance->state, &theState);
+    return theState;
+}
+
+static bool channel_count_from_number(CFTypeRef inValue, UInt32* outChannelCount)
+{
+    SInt32 theValue = 0;
+    if(inValue == NULL || CFGetTypeID(inValue) != CFNumberGetTypeID() || !CFNumberGetValue((CFNumberRef)inValue, kCFNumberSInt32Type, &theValue))
     {
-		theAnswer = gAudioServerPlugInDriverRef;
+        return false;
     }
-    return theAnswer;
+    if(theValue < 0 || !VocanaChannels_IsValidCount((UInt32)theValue))
+    {
+        return false;
+    }
+    *outChannelCount = (UInt32)theValue;
+    return true;
 }
 
-#pragma mark Inheritance
+//	The key a device's setting is kept under in the host's storage. The first device keeps the
+//	plain key it had when it was the only one.
+static CFStringRef copy_storage_key(const char* inKey, const VocanaDeviceInstance* inInstance)
+{
+    if(inInstance->slot == 0)
+    {
+        return CFStringCreateWithCString(NULL, inKey, kCFStringEncodingUTF8);
+    }
+    return CFStringCreateWithFormat(NULL, NULL, CFSTR("%s %u"), inKey, (unsigned)inInstance->slot + 1);
+}
 
-static HRESULT	VocanaVirtualDevice_QueryInterface(void* inDriver, REFIID inUUID, LPVOID* outInterface)
+//	The channel count the bundle's Info.plist asks for, overridden by the one the app last set for
+//	the device, which is kept in the host's storage.
+static UInt32 configured_channel_count(const VocanaDeviceInstance* inInstance)
 {
-	//	This function is called by the HAL to get the interface to talk to the plug-in through.
-	//	AudioServerPlugIns are required to support the IUnknown interface and the
-	//	AudioServerPlugInDriverInterface. As it happens, all interfaces must also provide the
-	//	IUnknown interface, so we can always just return the single interface we made with
-	//	gAudioServerPlugInDriverInterfacePtr regardless of which one is asked for.
+    UInt32 theChannelCount = kNumber_Of_Channels;
+    CFBundleRef theBundle = CFBundleGetBundleWithIdentifier(CFSTR(kPlugIn_BundleID));
+    if(theBundle != NULL)
+    {
+        channel_count_from_number(CFBundleGetValueForInfoDictionaryKey(theBundle, CFSTR(kVocanaChannels_InfoKey)), &theChannelCount);
+    }
 
-	//	declare the local variables
-	HRESULT theAnswer = 0;
-	CFUUIDRef theRequestedUUID = NULL;
-	
-	//	validate the arguments
-	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_QueryInterface: bad driver reference");
-	FailWithAction(outInterface == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_QueryInterface: no place to store the returned interface");
+    CFPropertyListRef theSettingsData = NULL;
+    CFStringRef theKey = copy_storage_key(kChannelCount_StorageKey, inInstance);
+    gPlugIn_Host->CopyFromStorage(gPlugIn_Host, theKey, &theSettingsData);
+    CFRelease(theKey);
+    if(theSettingsData != NULL)
+    {
+        channel_count_from_number(theSettingsData, &theChannelCount);
+        CFRelease(theSettingsData);
+    }
+    return theChannelCount;
+}
 
-	//	make a CFUUIDRef from inUUID
-	theRequestedUUID = CFUUIDCreateFromUUIDBytes(NULL, inUUID);
-	FailWithAction(theRequestedUUID == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_QueryInterface: failed to create the CFUUIDRef");
+static bool device_count_from_number(CFTypeRef inValue, UInt32* outDeviceCount)
+{
+    SInt32 theValue = 0;
+    if(inValue == NULL || CFGetTypeID(inValue) != CFNumberGetTypeID() || !CFNumberGetValue((CFNumberRef)inValue, kCFNumberSInt32Type, &theValue))
+    {
+        return false;
+    }
+    if(theValue < 1 || theValue > kVocanaDeviceRegistry_MaxDevices)
+    {
+        return false;
+    }
+    *outDeviceCount = (UInt32)theValue;
+    return true;
+}
 
-	//	AudioServerPlugIns only support two interfaces, IUnknown (which has to be supported by all
-	//	CFPlugIns and AudioServerPlugInDriverInterface (which is the actual interface the HAL will
-	//	use).
-	if(CFEqual(theRequestedUUID, IUnknownUUID) || CFEqual(theRequestedUUID, kAudioServerPlugInDriverInterfaceUUID))
+//	The number of devices the app last asked for, which is kept in the host's storage.
+static UInt32 configured_device_count(void)
+{
+    UInt32 theDeviceCount = kNumber_Of_Devices;
+    CFPropertyListRef theSettingsData = NULL;
+    gPlugIn_Host->CopyFromStorage(gPlugIn_Host, CFSTR(kDeviceCount_StorageKey), &theSettingsData);
+    if(theSettingsData != NULL)
+    {
+        device_count_from_number(theSettingsData, &theDeviceCount);
+        CFRelease(theSettingsData);
+    }
+    return theDeviceCount;
+}
+
+#pragma mark Property Tables
+
+//	The properties of each class of object the driver publishes: which selectors it has, in which
+//	scope, whether they can be set and how big their data is. HasProperty, IsPropertySettable and
+//	GetPropertyDataSize answer from these alone, so a property is added to an object by adding it
+//	to its class's table here and giving it a case in the class's Get (and Set) method below.
+//	Properties whose size depends on the object, the scope or the state get a size proc.
+
+static UInt32 plugin_owned_objects_size(UInt32 inObjectID, UInt32 inScope)
+{
+	#pragma unused(inObjectID, inScope)
+	pthread_mutex_lock(&gPlugIn_StateMutex);
+	UInt32 theSize = (1 + copy_device_list(NULL, 0)) * (UInt32)sizeof(AudioObjectID);
+	pthread_mutex_unlock(&gPlugIn_StateMutex);
+	return theSize;
+}
+
+static UInt32 plugin_device_list_size(UInt32 inObjectID, UInt32 inScope)
+{
+	#pragma unused(inObjectID, inScope)
+	pthread_mutex_lock(&gPlugIn_StateMutex);
+	UInt32 theSize = copy_device_list(NULL, 0) * (UInt32)sizeof(AudioObjectID);
+	pthread_mutex_unlock(&gPlugIn_StateMutex);
+	return theSize;
+}
+
+static UInt32 box_device_list_size(UInt32 inObjectID, UInt32 inScope)
+{
+	#pragma unused(inObjectID, inScope)
+	pthread_mutex_lock(&gPlugIn_StateMutex);
+	UInt32 theSize = copy_device_list(NULL, 0) * (UInt32)sizeof(AudioObjectID);
+	pthread_mutex_unlock(&gPlugIn_StateMutex);
+	return theSize;
+}
+
+//	the device size procs get the object's real ID; the lists are the same for every instance
+static UInt32 device_owned_objects_size(UInt32 inObjectID, UInt32 inScope)
+{
+	VocanaDeviceInstance* theInstance = NULL;
+	return device_object_list_size(inScope, object_kind(inObjectID, &theInstance)) * (UInt32)sizeof(AudioObjectID);
+}
+
+static UInt32 device_streams_size(UInt32 inObjectID, UInt32 inScope)
+{
+	VocanaDeviceInstance* theInstance = NULL;
+	return device_stream_list_size(inScope, object_kind(inObjectID, &theInstance)) * (UInt32)sizeof(AudioObjectID);
+}
+
+static UInt32 device_control_list_bytes(UInt32 inObjectID, UInt32 inScope)
+{
+	VocanaDeviceInstance* theInstance = NULL;
+	return device_control_list_size(inScope, object_kind(inObjectID, &theInstance)) * (UInt32)sizeof(AudioObjectID);
+}
+
+static UInt32 clock_source_available_items_size(UInt32 inObjectID, UInt32 inScope)
+{
+	#pragma unused(inObjectID, inScope)
+	return kClockSource_NumberItems * (UInt32)sizeof(UInt32);
+}
+
+static UInt32 device_channel_layout_size(UInt32 inObjectID, UInt32 inScope)
+{
+	#pragma unused(inScope)
+	VocanaDeviceInstance* theInstance = NULL;
+	object_kind(inObjectID, &theInstance);
+	UInt32 theChannelCount = (theInstance != NULL) ? device_state(theInstance).channelCount : 0;
+	return (UInt32)offsetof(AudioChannelLayout, mChannelDescriptions) + theChannelCount * (UInt32)sizeof(AudioChannelDescription);
+}
+
+#define                             kProperty_Any                       kVocanaPropertyScope_Any
+#define                             kProperty_Settable                  kVocanaProperty_Settable
+#define                             kDevice_SampleRateCount             (sizeof(kDevice_SampleRates) / sizeof(Float64))
+#define                             kDevice_CustomPropertyCount         (sizeof(kDevice_CustomPropertyList) / sizeof(AudioObjectPropertySelector))
+#define                             kPlugIn_CustomPropertyCount         (sizeof(kPlugIn_CustomPropertyList) / sizeof(AudioObjectPropertySelector))
+
+static const VocanaPropertySpec     kPlugIn_Properties[]                = {
+    { kAudioObjectPropertyBaseClass,                        kProperty_Any,                      0,                  sizeof(AudioClassID),       NULL },
+    { kAudioObjectPropertyClass,                            kProperty_Any,                      0,                  sizeof(AudioClassID),       NULL },
+    { kAudioObjectPropertyOwner,                            kProperty_Any,                      0,                  sizeof(AudioObjectID),      NULL },
+    { kAudioObjectPropertyManufacturer,                     kProperty_Any,                      0,                  sizeof(CFStringRef),        NULL },
+    { kAudioObjectPropertyOwnedObjects,                     kProperty_Any,                      0,                  0,                          plugin_owned_objects_size },
+    { kAudioPlugInPropertyBoxList,                          kProperty_Any,                      0,                  sizeof(AudioClassID),       NULL },
+    { kAudioPlugInPropertyTranslateUIDToBox,                kProperty_Any,                      0,                  sizeof(AudioObjectID),      NULL },
+    { kAudioPlugInPropertyDeviceList,                       kProperty_Any,                      0,                  0,                          plugin_device_list_size },
+    { kAudioPlugInPropertyTranslateUIDToDevice,             kProperty_Any,                      0,                  sizeof(AudioObjectID),      NULL },
+    { kAudioPlugInPropertyResourceBundle,                   kProperty_Any,                      0,                  sizeof(CFStringRef),        NULL },
+    { kAudioObjectPropertyCustomPropertyInfoList,           kProperty_Any,                      0,                  kPlugIn_CustomPropertyCount * sizeof(AudioServerPlugInCustomPropertyInfo), NULL },
+    { kVocanaPlugInPropertyDeviceCount,                     kProperty_Any,                      kProperty_Settable, sizeof(CFPropertyListRef),  NULL },
+};
+
+static const VocanaPropertySpec     kBox_Properties[]                   = {
+    { kAudioObjectPropertyBaseClass,                        kProperty_Any,                      0,                  sizeof(AudioClassID),       NULL },
+    { kAudioObjectPropertyClass,                            kProperty_Any,                      0,                  sizeof(AudioClassID),       NULL },
+    { kAudioObjectPropertyOwner,                            kProperty_Any,                      0,                  sizeof(AudioObjectID),      NULL },
+    { kAudioObjectPropertyName,                             kProperty_Any,                      kProperty_Settable, sizeof(CFStringRef),        NULL },
+    { kAudioObjectPropertyModelName,                        kProperty_Any,                      0,                  sizeof(CFStringRef),        NULL },
+    { kAudioObjectPropertyManufacturer,                     kProperty_Any,                      0,                  sizeof(CFStringRef),        NULL },
+    { kAudioObjectPropertyOwnedObjects,                     kProperty_Any,                      0,                  0,                          NULL },
+    { kAudioObjectPropertyIdentify,                         kProperty_Any,                      kProperty_Settable, sizeof(UInt32),             NULL },
+    { kAudioObjectPropertySerialNumber,                     kProperty_Any,                      0,                  sizeof(CFStringRef),        NULL },
+    { kAudioObjectPropertyFirmwareVersion,                  kProperty_Any,                      0,                  sizeof(CFStringRef),        NULL },
+    { kAudioBoxPropertyBoxUID,                              kProperty_Any,                      0,                  sizeof(CFStringRef),        NULL },
+    { kAudioBoxPropertyTransportType,                       kProperty_Any,                      0,                  sizeof(UInt32),             NULL },
+    { kAudioBoxPropertyHasAudio,                            kProperty_Any,                      0,                  sizeof(UInt32),             NULL },
+    { kAudioBoxPropertyHasVideo,                            kProperty_Any,                      0,                  sizeof(UInt32),             NULL },
+    { kAudioBoxPropertyHasMIDI,                             kProperty_Any,                      0,                  sizeof(UInt32),             NULL },
+    { kAudioBoxPropertyIsProtected,                         kProperty_Any,                      0,                  sizeof(UInt32),             NULL },
+    { kAudioBoxPropertyAcquired,                            kProperty_Any,                      kProperty_Settable, sizeof(UInt32),             NULL },
+    { kAudioBoxPropertyAcquisitionFailed,                   kProperty_Any,                      0,                  sizeof(UInt32),             NULL },
+    { kAudioBoxPropertyDeviceList,                          kProperty_Any,                      0,                  0,                          box_device_list_size },
+};
+
+//	the properties that only exist in the input and output scopes are listed once for each
+#define kDevice_DirectionalProperties(_scope)                                                                                                                       \
+    { kAudioDevicePropertyDeviceCanBeDefaultDevice,         _scope,                             0,                  sizeof(UInt32),             NULL },             \
+    { kAudioDevicePropertyDeviceCanBeDefaultSystemDevice,   _scope,                             0,                  sizeof(UInt32),             NULL },             \
+    { kAudioDevicePropertyLatency,                          _scope,                             0,                  sizeof(UInt32),             NULL },             \
+    { kAudioDevicePropertySafetyOffset,                     _scope,                             0,                  sizeof(UInt32),             NULL },             \
+    { kAudioDevicePropertyPreferredChannelsForStereo,       _scope,                             0,                  2 * sizeof(UInt32),         NULL },             \
+    { kAudioDevicePropertyPreferredChannelLayout,           _scope,                             0,                  0,                          device_channel_layout_size }
+
+static const VocanaPropertySpec     kDevice_Properties[]                = {
+    { kAudioObjectPropertyBaseClass,                        kProperty_Any,                      0,                  sizeof(AudioClassID),       NULL },
+    { kAudioObjectPropertyClass,                            kProperty_Any,                      0,                  sizeof(AudioClassID),       NULL },
+    { kAudioObjectPropertyOwner,                            kProperty_Any,                      0,                  sizeof(AudioObjectID),      NULL },
+    { kAudioObjectPropertyName,                             kProperty_Any,                      0,                  sizeof(CFStringRef),        NULL },
+    { kAudioObjectPropertyManufacturer,                     kProperty_Any,                      0,                  sizeof(CFStringRef),        NULL },
+    { kAudioObjectPropertyOwnedObjects,                     kProperty_Any,                      0,                  0,                          device_owned_objects_size },
+    { kAudioDevicePropertyDeviceUID,                        kProperty_Any,                      0,                  sizeof(CFStringRef),        NULL },
+    { kAudioDevicePropertyModelUID,                         kProperty_Any,                      0,                  sizeof(CFStringRef),        NULL },
+    { kAudioDevicePropertyTransportType,                    kProperty_Any,                      0,                  sizeof(UInt32),             NULL },
+    { kAudioDevicePropertyRelatedDevices,                   kProperty_Any,                      0,                  sizeof(AudioObjectID),      NULL },
+    { kAudioDevicePropertyClockDomain,                      kProperty_Any,                      0,                  sizeof(UInt32),             NULL },
+    { kAudioDevicePropertyDeviceIsAlive,                    kProperty_Any,                      0,                  sizeof(AudioClassID),       NULL },
+    { kAudioDevicePropertyDeviceIsRunning,                  kProperty_Any,                      0,                  sizeof(UInt32),             NULL },
+    { kAudioObjectPropertyControlList,                      kProperty_Any,                      0,                  0,                          device_control_list_bytes },
+    { kAudioDevicePropertyNominalSampleRate,                kProperty_Any,                      kProperty_Settable, sizeof(Float64),            NULL },
+    { kAudioDevicePropertyAvailableNominalSampleRates,      kProperty_Any,                      0,                  kDevice_SampleRateCount * sizeof(AudioValueRange), NULL },
+    { kAudioDevicePropertyIsHidden,                         kProperty_Any,                      0,                  sizeof(UInt32),             NULL },
+    { kAudioDevicePropertyZeroTimeStampPeriod,              kProperty_Any,                      0,                  sizeof(UInt32),             NULL },
+    { kAudioDevicePropertyIcon,                             kProperty_Any,                      0,                  sizeof(CFURLRef),           NULL },
+    { kAudioDevicePropertyStreams,                          kProperty_Any,                      0,                  0,                          device_streams_size },
+    { kAudioObjectPropertyCustomPropertyInfoList,           kProperty_Any,                      0,                  kDevice_CustomPropertyCount * sizeof(AudioServerPlugInCustomPropertyInfo), NULL },
+    { kVocanaDevicePropertyClockReference,                  kProperty_Any,                      kProperty_Settable, sizeof(CFPropertyListRef),  NULL },
+    { kVocanaDevicePropertyClockStatistics,                 kProperty_Any,                      0,                  sizeof(CFPropertyListRef),  NULL },
+    { kVocanaDevicePropertyChannelCount,                    kProperty_Any,                      kProperty_Settable, sizeof(CFPropertyListRef),  NULL },
+    kDevice_DirectionalProperties(kAudioObjectPropertyScopeInput),
+    kDevice_DirectionalProperties(kAudioObjectPropertyScopeOutput),
+};
+
+static const VocanaPropertySpec     kStream_Properties[]                = {
+    { kAudioObjectPropertyBaseClass,                        kProperty_Any,                      0,                  sizeof(AudioClassID),       NULL },
+    { kAudioObjectPropertyClass,                            kProperty_Any,                      0,                  sizeof(AudioClassID),       NULL },
+    { kAudioObjectPropertyOwner,                            kProperty_Any,                      0,                  sizeof(AudioObjectID),      NULL },
+    { kAudioObjectPropertyOwnedObjects,                     kProperty_Any,                      0,                  0,                          NULL },
+    { kAudioStreamPropertyIsActive,                         kProperty_Any,                      kProperty_Settable, sizeof(UInt32),             NULL },
+    { kAudioStreamPropertyDirection,                        kProperty_Any,                      0,                  sizeof(UInt32),             NULL },
+    { kAudioStreamPropertyTerminalType,                     kProperty_Any,                      0,                  sizeof(UInt32),             NULL },
+    { kAudioStreamPropertyStartingChannel,                  kProperty_Any,                      0,                  sizeof(UInt32),             NULL },
+    { kAudioStreamPropertyLatency,                          kProperty_Any,                      0,                  sizeof(UInt32),             NULL },
+    { kAudioStreamPropertyVirtualFormat,                    kProperty_Any,                      kProperty_Settable, sizeof(AudioStreamBasicDescription), NULL },
+    { kAudioStreamPropertyPhysicalFormat,                   kProperty_Any,                      kProperty_Settable, sizeof(AudioStreamBasicDescription), NULL },
+    { kAudioStreamPropertyAvailableVirtualFormats,          kProperty_Any,                      0,                  kDevice_SampleRateCount * sizeof(AudioStreamRangedDescription), NULL },
+    { kAudioStreamPropertyAvailablePhysicalFormats,         kProperty_Any,                      0,                  kDevice_SampleRateCount * sizeof(AudioStreamRangedDescription), NULL },
+};
+
+//	every control has these
+#define kControl_CommonProperties                                                                                                                                   \
+    { kAudioObjectPropertyBaseClass,                        kProperty_Any,                      0,                  sizeof(AudioClassID),       NULL },             \
+    { kAudioObjectPropertyClass,                            kProperty_Any,                      0,                  sizeof(AudioClassID),       NULL },             \
+    { kAudioObjectPropertyOwner,                            kProperty_Any,                      0,                  sizeof(AudioObjectID),      NULL },             \
+    { kAudioObjectPropertyOwnedObjects,                     kProperty_Any,                      0,                  0,                          NULL },             \
+    { kAudioControlPropertyScope,                           kProperty_Any,                      0,                  sizeof(AudioObjectPropertyScope), NULL },       \
+    { kAudioControlPropertyElement,                         kProperty_Any,                      0,                  sizeof(AudioObjectPropertyElement), NULL }
+
+static const VocanaPropertySpec     kVolume_Properties[]                = {
+    kControl_CommonProperties,
+    { kAudioLevelControlPropertyScalarValue,                kProperty_Any,                      kProperty_Settable, sizeof(Float32),            NULL },
+    { kAudioLevelControlPropertyDecibelValue,               kProperty_Any,                      kProperty_Settable, sizeof(Float32),            NULL },
+    { kAudioLevelControlPropertyDecibelRange,               kProperty_Any,                      0,                  sizeof(AudioValueRange),    NULL },
+    { kAudioLevelControlPropertyConvertScalarToDecibels,    kProperty_Any,                      0,                  sizeof(Float32),            NULL },
+    { kAudioLevelControlPropertyConvertDecibelsToScalar,    kProperty_Any,                      0,                  sizeof(Float32),            NULL },
+};
+
+static const VocanaPropertySpec     kMute_Properties[]                  = {
+    kControl_CommonProperties,
+    { kAudioBooleanControlPropertyValue,                    kProperty_Any,                      kProperty_Settable, sizeof(UInt32),             NULL },
+};
+
+static const VocanaPropertySpec     kPitch_Properties[]                 = {
+    kControl_CommonProperties,
+    { kAudioStereoPanControlPropertyValue,                  kProperty_Any,                      kProperty_Settable, sizeof(Float32),            NULL },
+};
+
+static const VocanaPropertySpec     kClockSource_Properties[]           = {
+    kControl_CommonProperties,
+    { kAudioSelectorControlPropertyCurrentItem,             kProperty_Any,                      kProperty_Settable, sizeof(UInt32),             NULL },
+    { kAudioSelectorControlPropertyAvailableItems,          kProperty_Any,                      0,                  0,                          clock_source_available_items_size },
+    { kAudioSelectorControlPropertyItemName,                kProperty_Any,                      0,                  sizeof(CFStringRef),        NULL },
+};
+
+//	the signatures of each class's getter and setter, which the table carries as VocanaPropertyProcs
+typedef OSStatus (*VocanaVirtualDevice_GetPropertyDataProc)(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, UInt32* outDataSize, void* outData);
+typedef OSStatus (*VocanaVirtualDevice_SetPropertyDataProc)(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, const void* inData, UInt32* outNumberPropertiesChanged, AudioObjectPropertyAddress outChangedAddresses[2]);
+
+//	keyed by the kind of object, see object_kind(); every device's objects share their kind's entries
+#define PROPERTY_CLASS(_objectID, _specs, _class)   { _objectID, _specs, sizeof(_specs) / sizeof(VocanaPropertySpec), (VocanaPropertyProc)VocanaVirtualDevice_Get##_class##PropertyData, (VocanaPropertyProc)VocanaVirtualDevice_Set##_class##PropertyData }
+
+static const struct
+{
+    AudioObjectID                   objectID;
+    const VocanaPropertySpec*       specs;
+    UInt32                          specCount;
+    VocanaPropertyProc              getProc;
+    VocanaPropertyProc              setProc;
+}                                   kPlugIn_PropertyClasses[]           = {
+    PROPERTY_CLASS(kObjectID_PlugIn,                kPlugIn_Properties,         PlugIn),
+    PROPERTY_CLASS(kObjectID_Box,                   kBox_Properties,            Box),
+    PROPERTY_CLASS(kObjectID_Device,                kDevice_Properties,         Device),
+    PROPERTY_CLASS(kObjectID_Device2,               kDevice_Properties,         Device),
+    PROPERTY_CLASS(kObjectID_Stream_Input,          kStream_Properties,         Stream),
+    PROPERTY_CLASS(kObjectID_Stream_Output,         kStream_Properties,         Stream),
+    PROPERTY_CLASS(kObjectID_Volume_Input_Master,   kVolume_Properties,         Control),
+    PROPERTY_CLASS(kObjectID_Volume_Output_Master,  kVolume_Properties,         Control),
+    PROPERTY_CLASS(kObjectID_Mute_Input_Master,     kMute_Properties,           Control),
+    PROPERTY_CLASS(kObjectID_Mute_Output_Master,    kMute_Properties,           Control),
+    PROPERTY_CLASS(kObjectID_Pitch_Adjust,          kPitch_Properties,          Control),
+    PROPERTY_CLASS(kObjectID_ClockSource,           kClockSource_Properties,    Control),
+};
+
+static int build_property_table(void)
+{
+	UInt32 theClassCount = sizeof(kPlugIn_PropertyClasses) / sizeof(kPlugIn_PropertyClasses[0]);
+	UInt32 theCapacity = 0;
+	for(UInt32 i = 0; i < theClassCount; i++)
 	{
-		pthread_mutex_lock(&gPlugIn_StateMutex);
-		++gPlugIn_RefCount;
-		pthread_mutex_unlock(&gPlugIn_StateMutex);
-		*outInterface = gAudioServerPlugInDriverRef;
+		theCapacity += kPlugIn_PropertyClasses[i].specCount + 1;
 	}
-	else
+
+	int theError = VocanaPropertyTable_Init(&gPlugIn_PropertyTable, theCapacity);
+	for(UInt32 i = 0; i < theClassCount && theError == 0; i++)
 	{
-		theAnswer = E_NOINTERFACE;
+		theError = VocanaPropertyTable_AddObject(&gPlugIn_PropertyTable, kPlugIn_PropertyClasses[i].objectID, kPlugIn_PropertyClasses[i].specs, kPlugIn_PropertyClasses[i].specCount, kPlugIn_PropertyClasses[i].getProc, kPlugIn_PropertyClasses[i].setProc);
 	}
-	
-	//	make sure to release the UUID we created
-	CFRelease(theRequestedUUID);
-		
-Done:
-	return theAnswer;
+	if(theError == 0)
+	{
+		theError = VocanaPropertyTable_Build(&gPlugIn_PropertyTable);
+	}
+	if(theError != 0)
+	{
+		VocanaPropertyTable_Teardown(&gPlugIn_PropertyTable);
+	}
+	return theError;
 }
 
-static ULONG	VocanaVirtualDevice_AddRef(void* inDriver)
+#pragma mark Deferred Work
+
+//	These run on a global dispatch queue after the call that scheduled them has returned, so they
+//	never call back into the host with the state mutex held. They use the function variants of the
+//	dispatch API so that the driver stays plain C.
+
+static void notify_box_identify(void* inContext)
 {
-	//	This call returns the resulting reference count after the increment.
-	
-	//	declare the local variables
-	ULONG theAnswer = 0;
-	
-	//	check the arguments
-	FailIf(inDriver != gAudioServerPlugInDriverRef, Done, "VocanaVirtualDevice_AddRef: bad driver reference");
+	#pragma unused(inContext)
+	AudioObjectPropertyAddress theAddress = { kAudioObjectPropertyIdentify, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMain };
+	gPlugIn_Host->PropertiesChanged(gPlugIn_Host, kObjectID_Box, 1, &theAddress);
+}
 
-	//	increment the refcount
-	pthread_mutex_lock(&gPlugIn_StateMutex);
-	if(gPlugIn_RefCount < UINT32_MAX)
-	{
-		++gPlugIn_RefCount;
-	}
-	theAnswer = gPlugIn_RefCount;
-	pthread_mutex_unlock(&gPlugIn_StateMutex);
+static void notify_plugin_device_list(void* inContext)
+{
+	#pragma unused(inContext)
+	AudioObjectPropertyAddress theAddress = { kAudioPlugInPropertyDeviceList, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMain };
+	gPlugIn_Host->PropertiesChanged(gPlugIn_Host, kObjectID_PlugIn, 1, &theAddress);
+}
 
-Done:
-	return theAnswer;
+static void notify_box_device_list(void* inContext)
+{
+	#pragma unused(inContext)
+	AudioObjectPropertyAddress theAddress = { kAudioBoxPropertyDeviceList, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMain };
+	gPlugIn_Host->PropertiesChanged(gPlugIn_Host, kObjectID_Box, 1, &theAddress);
 }
 
-static ULONG	VocanaVirtualDevice_Release(void* inDriver)
+//	The context of request_device_configuration_change: the device in the high half, the change
+//	action in the low one.
+static void* change_request(const VocanaDeviceInstance* inInstance, UInt64 inChangeAction)
 {
-	//	This call returns the resulting reference count after the decrement.
+	return (void*)(uintptr_t)(((UInt64)object_id(inInstance, kObjectID_Device) << 32) | (inChangeAction & 0xFFFFFFFF));
+}
 
-	//	declare the local variables
-	ULONG theAnswer = 0;
-	
-	//	check the arguments
-	FailIf(inDriver != gAudioServerPlugInDriverRef, Done, "VocanaVirtualDevice_Release: bad driver reference");
+static void request_device_configuration_change(void* inContext)
+{
+	UInt64 theRequest = (UInt64)(uintptr_t)inContext;
+	gPlugIn_Host->RequestDeviceConfigurationChange(gPlugIn_Host, (AudioObjectID)(theRequest >> 32), theRequest & 0xFFFFFFFF, NULL);
+}
 
-	//	decrement the refcount
+static void trim_ring_buffer(void* inContext)
+{
+	#pragma unused(inContext)
 	pthread_mutex_lock(&gPlugIn_StateMutex);
-	if(gPlugIn_RefCount > 0)
+	for(UInt32 i = 0; i < VocanaDeviceRegistry_GetCount(&gDevice_Registry); i++)
 	{
-		--gPlugIn_RefCount;
-		//	Note that we don't do anything special if the refcount goes to zero as the HAL
-		//	will never fully release a plug-in it opens. We keep managing the refcount so that
-		//	the API semantics are correct though.
+		for(UInt32 theLane = 0; theLane < 2; theLane++)
+		{
+			VocanaRingBufferLifetime_Trim(&gDevice_Instances[i].io[theLane].ringBufferLifetime);
+		}
 	}
-	theAnswer = gPlugIn_RefCount;
 	pthread_mutex_unlock(&gPlugIn_StateMutex);
-
-Done:
-	return theAnswer;
 }
 
-#pragma mark Basic Operations
+#pragma mark Device Instances
 
-static OSStatus	VocanaVirtualDevice_Initialize(AudioServerPlugInDriverRef inDriver, AudioServerPlugInHostRef inHost)
+#if kDevice_InProcessDenoise
+//	The lane's mix bus processor: runs each published cycle through the denoiser, in place.
+static void device_io_denoise(void* inContext, uint64_t inFrame, float* ioFrames, uint32_t inFrameCount)
 {
-	//	The job of this method is, as the name implies, to get the driver initialized. One specific
-	//	thing that needs to be done is to store the AudioServerPlugInHostRef so that it can be used
-	//	later. Note that when this call returns, the HAL will scan the various lists the driver
-	//	maintains (such as the device list) to get the initial set of objects the driver is
-	//	publishing. So, there is no need to notify the HAL about any objects created as part of the
-	//	execution of this method.
+	#pragma unused(inFrame)
+	VocanaProcessorStage_Process((VocanaProcessorStage*)inContext, ioFrames, ioFrames, inFrameCount);
+}
 
-	//	declare the local variables
+//	Gets the lane's denoiser ready for a run of IO in the given format: reset if it already has
+//	that format and made again if it doesn't. A lane whose denoiser can't be made runs without
+//	one. Call with no IO running on the lane.
+static void device_io_prepare_denoiser(VocanaDeviceIO* inIO, Float64 inSampleRate, UInt32 inChannelCount)
+{
+	if(inIO->hasDenoiser && inIO->denoiserSampleRate == inSampleRate && inIO->denoiserChannelCount == inChannelCount)
+	{
+		VocanaProcessorStage_Reset(&inIO->denoiser);
+		return;
+	}
+	if(inIO->hasDenoiser)
+	{
+		VocanaProcessorStage_Teardown(&inIO->denoiser);
+	}
+
+	VocanaProcessorConfiguration theConfiguration = { inSampleRate, inChannelCount, kMix_Bus_Max_Frames };
+	int theError = VocanaProcessorStage_Init(&inIO->denoiser, VocanaSpectralGate_GetInterface(), &theConfiguration, kDenoise_Budget, (uint32_t)(kDenoise_BackoffSeconds * inSampleRate), kDenoise_FadeFrames);
+	if(theError != 0)
+	{
+		DebugMsg("VocanaVirtualDevice: failed to create the denoiser: %d", theError);
+	}
+	inIO->hasDenoiser = theError == 0;
+	inIO->denoiserSampleRate = inSampleRate;
+	inIO->denoiserChannelCount = inChannelCount;
+	atomic_store(&inIO->denoiserLatency, inIO->hasDenoiser ? VocanaProcessorStage_GetLatency(&inIO->denoiser) : 0);
+	VocanaMixBus_SetProcessor(&inIO->mixBus, inIO->hasDenoiser ? device_io_denoise : NULL, &inIO->denoiser);
+}
+#endif
+
+//	Allocates one device's ring and mix bus. Returns 0 or an errno value, having released whatever
+//	it allocated. Call with gPlugIn_StateMutex held.
+static int device_io_init(VocanaDeviceIO* inIO, Float64 inSampleRate, UInt32 inChannelCount)
+{
+	int theError = VocanaRingBufferLifetime_Init(&inIO->ringBufferLifetime, ring_buffer_capacity_for_max_sample_rate(), inChannelCount, 0);
+	if(theError != 0)
+	{
+		return theError;
+	}
+	theError = VocanaMixBus_Init(&inIO->mixBus, kMix_Bus_Max_Frames, inChannelCount, kMix_Bus_Clip_Level);
+	if(theError != 0)
+	{
+		VocanaRingBufferLifetime_Teardown(&inIO->ringBufferLifetime);
+		return theError;
+	}
+#if kDevice_InProcessDenoise
+	//	made now so the devices declare its latency from the start; StartIO remakes it if the format
+	//	has changed since
+	inIO->hasDenoiser = false;
+	device_io_prepare_denoiser(inIO, inSampleRate, inChannelCount);
+#endif
+	return 0;
+}
+
+//	Waits out any IO thread still using the lane and releases it. Call with gPlugIn_StateMutex held.
+static void device_io_teardown(VocanaDeviceIO* inIO)
+{
+	VocanaRingBufferLifetime_Teardown(&inIO->ringBufferLifetime);
+	VocanaMixBus_Teardown(&inIO->mixBus);
+#if kDevice_InProcessDenoise
+	if(inIO->hasDenoiser)
+	{
+		VocanaProcessorStage_Teardown(&inIO->denoiser);
+		inIO->hasDenoiser = false;
+	}
+	atomic_store(&inIO->denoiserLatency, 0);
+#endif
+}
+
+//	How late a device's input plays back what was written to it: the longer of the two lanes'
+//	denoiser latencies, since the input hears both.
+static UInt32 device_input_latency(VocanaDeviceInstance* inInstance)
+{
+#if kDevice_InProcessDenoise
+	UInt32 theLatency = (UInt32)atomic_load(&inInstance->io[0].denoiserLatency);
+	UInt32 theOtherLatency = (UInt32)atomic_load(&inInstance->io[1].denoiserLatency);
+	return theLatency > theOtherLatency ? theLatency : theOtherLatency;
+#else
+	#pragma unused(inInstance)
+	return 0;
+#endif
+}
+
+//	Changes the channel count of both of an instance's lanes, or of neither. The rings go first:
+//	each refuses while its device is running, and the HAL only stops the device it reconfigures.
+//	Returns 0, EBUSY if either device is running or ENOMEM if a mix bus couldn't be reallocated.
+//	A ring that can't be reallocated isn't an error; its next StartIO tries again.
+static int set_io_channel_count(VocanaDeviceInstance* inInstance, UInt32 inChannelCount)
+{
+	UInt32 theOldChannelCount = (UInt32)atomic_load(&inInstance->ioChannelCount);
+	UInt32 theLaneCount = 0;
+	int theError = 0;
+	while(theLaneCount < 2 && theError == 0)
+	{
+		VocanaDeviceIO* theIO = &inInstance->io[theLaneCount++];
+		if(VocanaRingBufferLifetime_SetChannelCount(&theIO->ringBufferLifetime, inChannelCount) == EBUSY)
+		{
+			theError = EBUSY;
+		}
+		else if(VocanaMixBus_SetChannelCount(&theIO->mixBus, inChannelCount) != 0)
+		{
+			theError = ENOMEM;
+		}
+	}
+	if(theError != 0)
+	{
+		//	put back every lane this got to; a bus that failed to change still has the old count, so
+		//	setting it again does nothing
+		for(UInt32 i = 0; i < theLaneCount; i++)
+		{
+			VocanaRingBufferLifetime_SetChannelCount(&inInstance->io[i].ringBufferLifetime, theOldChannelCount);
+			VocanaMixBus_SetChannelCount(&inInstance->io[i].mixBus, theOldChannelCount);
+		}
+	}
+	return theError;
+}
+
+//	Sets up the next instance and publishes its device. Call with gPlugIn_StateMutex held.
+static int add_device(void)
+{
+	UInt32 theSlot = VocanaDeviceRegistry_GetCount(&gDevice_Registry);
+	if(theSlot >= kVocanaDeviceRegistry_MaxDevices)
+	{
+		return ENOSPC;
+	}
+	VocanaDeviceInstance* theInstance = &gDevice_Instances[theSlot];
+
+	//	publish the initial property state and give the IO threads of the device and its mirror
+	//	their view of it; each plays back the other's ring, so they share the channel count as well
+	VocanaDeviceStateValues theInitialState = kDevice_InitialState;
+	theInitialState.channelCount = configured_channel_count(theInstance);
+	atomic_store(&theInstance->ioChannelCount, theInitialState.channelCount);
+	VocanaDeviceState_Init(&theInstance->state, &theInitialState);
+	for(UInt32 i = 0; i < 2; i++)
+	{
+		atomic_store(&theInstance->io[i].isRunning, 0);
+		VocanaDeviceStateReader_Init(&theInstance->io[i].stateReader, &theInstance->state);
+	}
+	theInstance->requestedSampleRate = theInitialState.sampleRate;
+	theInstance->requestedChannelCount = theInitialState.channelCount;
+
+	//	the device clock starts out fixed at the nominal rate; the adjustable clock source turns on
+	//	reference tracking and the pitch trim
+	VocanaClock_Init(&theInstance->clock, kDevice_InitialState.sampleRate, gDevice_HostClockFrequency, kDevice_RingBufferSize);
+	atomic_store(&theInstance->runningDevices, 0);
+
+	//	allocate the rings once, up front, so starting and stopping IO never allocates; the mix
+	//	buses sum the output of every client and are small, so they are never trimmed
+	UInt32 theLaneCount = 0;
+	int theError = 0;
+	while(theLaneCount < 2 && theError == 0)
+	{
+		theError = device_io_init(&theInstance->io[theLaneCount], theInitialState.sampleRate, theInitialState.channelCount);
+		theLaneCount += theError == 0 ? 1 : 0;
+	}
+	if(theError == 0)
+	{
+		uint32_t theFirstObjectID = 0;
+		theError = VocanaDeviceRegistry_Add(&gDevice_Registry, &theSlot, &theFirstObjectID);
+	}
+	if(theError != 0)
+	{
+		for(UInt32 i = 0; i < theLaneCount; i++)
+		{
+			device_io_teardown(&theInstance->io[i]);
+		}
+	}
+	return theError;
+}
+
+//	Removes the last device. Lookups stop finding it first; tearing the rings down then waits out
+//	any IO thread that found them just before. Call with gPlugIn_StateMutex held.
+static void remove_device(void)
+{
+	UInt32 theSlot = VocanaDeviceRegistry_GetCount(&gDevice_Registry) - 1;
+	VocanaDeviceInstance* theInstance = &gDevice_Instances[theSlot];
+	VocanaDeviceRegistry_Remove(&gDevice_Registry, theSlot);
+	for(UInt32 i = 0; i < 2; i++)
+	{
+		device_io_teardown(&theInstance->io[i]);
+	}
+}
+
+//	Adds or removes devices at the end of the list until there are inDeviceCount. Devices that are
+//	running IO are not removed: if any of the ones to go is, nothing changes. Returns whether the
+//	device list changed. Call with gPlugIn_StateMutex held.
+static OSStatus set_device_count(UInt32 inDeviceCount, bool* outDidChange)
+{
+	*outDidChange = false;
+	UInt32 theCount = VocanaDeviceRegistry_GetCount(&gDevice_Registry);
+	for(UInt32 i = inDeviceCount; i < theCount; i++)
+	{
+		if(atomic_load(&gDevice_Instances[i].io[0].isRunning) > 0 || atomic_load(&gDevice_Instances[i].io[1].isRunning) > 0)
+		{
+			return kAudioHardwareNotStoppedError;
+		}
+	}
+	while(VocanaDeviceRegistry_GetCount(&gDevice_Registry) > inDeviceCount)
+	{
+		remove_device();
+		*outDidChange = true;
+	}
+	while(VocanaDeviceRegistry_GetCount(&gDevice_Registry) < inDeviceCount)
+	{
+		if(add_device() != 0)
+		{
+			return kAudioHardwareUnspecifiedError;
+		}
+		*outDidChange = true;
+	}
+	return 0;
+}
+
+#pragma mark Factory
+
+void*	VocanaVirtualDevice_Create(CFAllocatorRef inAllocator, CFUUIDRef inRequestedTypeUUID)
+{
+	//	This is the CFPlugIn factory function. Its job is to create the implementation for the given
+	//	type provided that the type is supported. Because this driver is simple and all its
+	//	initialization is handled via static initialization when the bundle is loaded, all that
+	//	needs to be done is to return the AudioServerPlugInDriverRef that points to the driver's
+	//	interface. A more complicated driver would create any base line objects it needs to satisfy
+	//	the IUnknown methods that are used to discover that actual interface to talk to the driver.
+	//	The majority of the driver's initialization should be handled in the Initialize() method of
+	//	the driver's AudioServerPlugInDriverInterface.
+	
+	#pragma unused(inAllocator)
+    void* theAnswer = NULL;
+    if(CFEqual(inRequestedTypeUUID, kAudioServerPlugInTypeUUID))
+    {
+		theAnswer = gAudioServerPlugInDriverRef;
+    }
+    return theAnswer;
+}
+
+#pragma mark Inheritance
+
+static HRESULT	VocanaVirtualDevice_QueryInterface(void* inDriver, REFIID inUUID, LPVOID* outInterface)
+{
+	//	This function is called by the HAL to get the interface to talk to the plug-in through.
+	//	AudioServerPlugIns are required to support the IUnknown interface and the
+	//	AudioServerPlugInDriverInterface. As it happens, all interfaces must also provide the
+	//	IUnknown interface, so we can always just return the single interface we made with
+	//	gAudioServerPlugInDriverInterfacePtr regardless of which one is asked for.
+
+	//	declare the local variables
+	HRESULT theAnswer = 0;
+	CFUUIDRef theRequestedUUID = NULL;
+	
+	//	validate the arguments
+	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_QueryInterface: bad driver reference");
+	FailWithAction(outInterface == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_QueryInterface: no place to store the returned interface");
+
+	//	make a CFUUIDRef from inUUID
+	theRequestedUUID = CFUUIDCreateFromUUIDBytes(NULL, inUUID);
+	FailWithAction(theRequestedUUID == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_QueryInterface: failed to create the CFUUIDRef");
+
+	//	AudioServerPlugIns only support two interfaces, IUnknown (which has to be supported by all
+	//	CFPlugIns and AudioServerPlugInDriverInterface (which is the actual interface the HAL will
+	//	use).
+	if(CFEqual(theRequestedUUID, IUnknownUUID) || CFEqual(theRequestedUUID, kAudioServerPlugInDriverInterfaceUUID))
+	{
+		pthread_mutex_lock(&gPlugIn_StateMutex);
+		++gPlugIn_RefCount;
+		pthread_mutex_unlock(&gPlugIn_StateMutex);
+		*outInterface = gAudioServerPlugInDriverRef;
+	}
+	else
+	{
+		theAnswer = E_NOINTERFACE;
+	}
+	
+	//	make sure to release the UUID we created
+	CFRelease(theRequestedUUID);
+		
+Done:
+	return theAnswer;
+}
+
+static ULONG	VocanaVirtualDevice_AddRef(void* inDriver)
+{
+	//	This call returns the resulting reference count after the increment.
+	
+	//	declare the local variables
+	ULONG theAnswer = 0;
+	
+	//	check the arguments
+	FailIf(inDriver != gAudioServerPlugInDriverRef, Done, "VocanaVirtualDevice_AddRef: bad driver reference");
+
+	//	increment the refcount
+	pthread_mutex_lock(&gPlugIn_StateMutex);
+	if(gPlugIn_RefCount < UINT32_MAX)
+	{
+		++gPlugIn_RefCount;
+	}
+	theAnswer = gPlugIn_RefCount;
+	pthread_mutex_unlock(&gPlugIn_StateMutex);
+
+Done:
+	return theAnswer;
+}
+
+static ULONG	VocanaVirtualDevice_Release(void* inDriver)
+{
+	//	This call returns the resulting reference count after the decrement.
+
+	//	declare the local variables
+	ULONG theAnswer = 0;
+	
+	//	check the arguments
+	FailIf(inDriver != gAudioServerPlugInDriverRef, Done, "VocanaVirtualDevice_Release: bad driver reference");
+
+	//	decrement the refcount
+	pthread_mutex_lock(&gPlugIn_StateMutex);
+	if(gPlugIn_RefCount > 0)
+	{
+		--gPlugIn_RefCount;
+		//	Note that we don't do anything special if the refcount goes to zero as the HAL
+		//	will never fully release a plug-in it opens. We keep managing the refcount so that
+		//	the API semantics are correct though.
+	}
+	theAnswer = gPlugIn_RefCount;
+	pthread_mutex_unlock(&gPlugIn_StateMutex);
+
+Done:
+	return theAnswer;
+}
+
+#pragma mark Basic Operations
+
+static OSStatus	VocanaVirtualDevice_Initialize(AudioServerPlugInDriverRef inDriver, AudioServerPlugInHostRef inHost)
+{
+	//	The job of this method is, as the name implies, to get the driver initialized. One specific
+	//	thing that needs to be done is to store the AudioServerPlugInHostRef so that it can be used
+	//	later. Note that when this call returns, the HAL will scan the various lists the driver
+	//	maintains (such as the device list) to get the initial set of objects the driver is
+	//	publishing. So, there is no need to notify the HAL about any objects created as part of the
+	//	execution of this method.
+
+	//	declare the local variables
 	OSStatus theAnswer = 0;
 	
 	//	check the arguments
@@ -786,16 +1594,40 @@ static OSStatus	VocanaVirtualDevice_Initialize(AudioServerPlugInDriverRef inDriv
 		gBox_Name = CFSTR("VocanaVirtualDevice Box");
 	}
 	
-	//	calculate the host ticks per frame
+	//	calculate the host clock frequency
 	struct mach_timebase_info theTimeBaseInfo;
 	mach_timebase_info(&theTimeBaseInfo);
-	Float64 theHostClockFrequency = (Float64)theTimeBaseInfo.denom / (Float64)theTimeBaseInfo.numer;
-	theHostClockFrequency *= 1000000000.0;
-	gDevice_HostTicksPerFrame = theHostClockFrequency / gDevice_SampleRate;
-    gDevice_AdjustedTicksPerFrame = gDevice_HostTicksPerFrame - gDevice_HostTicksPerFrame/100.0 * 2.0*(gPitch_Adjust - 0.5);
+	gDevice_HostClockFrequency = (Float64)theTimeBaseInfo.denom / (Float64)theTimeBaseInfo.numer;
+	gDevice_HostClockFrequency *= 1000000000.0;
     
     // DebugMsg("VocanaVirtualDevice theTimeBaseInfo.numer: %u \t theTimeBaseInfo.denom: %u", theTimeBaseInfo.numer, theTimeBaseInfo.denom);
 	
+	//	the property tables are immutable from here on, so queries never lock anything to find a
+	//	property
+	FailWithAction(build_property_table() != 0, theAnswer = kAudioHardwareUnspecifiedError, Done, "VocanaVirtualDevice_Initialize: failed to build the property table");
+	
+	//	create the devices the app last asked for; every one gets its block of object IDs, and the
+	//	first one's block starts at kObjectID_Device
+	VocanaDeviceRegistry_Init(&gDevice_Registry, kObjectID_Device, kDevice_ObjectBlockSize);
+	for(UInt32 i = 0; i < kVocanaDeviceRegistry_MaxDevices; i++)
+	{
+		gDevice_Instances[i].slot = i;
+	}
+	pthread_mutex_lock(&gPlugIn_StateMutex);
+	bool didChange = false;
+	theAnswer = set_device_count(configured_device_count(), &didChange);
+	pthread_mutex_unlock(&gPlugIn_StateMutex);
+	FailIf(theAnswer != 0, Done, "VocanaVirtualDevice_Initialize: failed to create the devices");
+	
+	//	give the memory back if the system is under pressure and nobody is doing IO; the next
+	//	StartIO will allocate it again
+	gRingBufferMemoryPressureSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_MEMORYPRESSURE, 0, DISPATCH_MEMORYPRESSURE_WARN | DISPATCH_MEMORYPRESSURE_CRITICAL, dispatch_get_global_queue(QOS_CLASS_UTILITY, 0));
+	if(gRingBufferMemoryPressureSource != NULL)
+	{
+		dispatch_source_set_event_handler_f(gRingBufferMemoryPressureSource, trim_ring_buffer);
+		dispatch_resume(gRingBufferMemoryPressureSource);
+	}
+	
 Done:
 	return theAnswer;
 }
@@ -840,18 +1672,25 @@ Done:
 static OSStatus	VocanaVirtualDevice_AddDeviceClient(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID, const AudioServerPlugInClientInfo* inClientInfo)
 {
 	//	This method is used to inform the driver about a new client that is using the given device.
-	//	This allows the device to act differently depending on who the client is. This driver does
-	//	not need to track the clients using the device, so we just check the arguments and return
-	//	successfully.
-	
-	#pragma unused(inClientInfo)
+	//	This allows the device to act differently depending on who the client is. This driver gives
+	//	every client a slot on its device's mix bus so that its output is summed with everyone else's.
 	
 	//	declare the local variables
 	OSStatus theAnswer = 0;
+	VocanaDeviceInstance* theInstance = NULL;
+	AudioObjectID theKind = kAudioObjectUnknown;
 	
 	//	check the arguments
 	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_AddDeviceClient: bad driver reference");
-	FailWithAction(inDeviceObjectID != kObjectID_Device && inDeviceObjectID != kObjectID_Device2, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_AddDeviceClient: bad device ID");
+	FailWithAction(!find_device(inDeviceObjectID, &theInstance, &theKind), theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_AddDeviceClient: bad device ID");
+	FailWithAction(inClientInfo == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_AddDeviceClient: no client info");
+	
+	//	a client that doesn't get a slot writes as the bus's anonymous writer, which only one
+	//	client can be per cycle
+	if(!VocanaMixBus_AddClient(&device_io(theInstance, theKind)->mixBus, inClientInfo->mClientID))
+	{
+		DebugMsg("VocanaVirtualDevice: Mix bus is full, client %u shares the anonymous slot", (unsigned)inClientInfo->mClientID);
+	}
 
 Done:
 	return theAnswer;
@@ -860,17 +1699,19 @@ Done:
 static OSStatus	VocanaVirtualDevice_RemoveDeviceClient(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID, const AudioServerPlugInClientInfo* inClientInfo)
 {
 	//	This method is used to inform the driver about a client that is no longer using the given
-	//	device. This driver does not track clients, so we just check the arguments and return
-	//	successfully.
-	
-	#pragma unused(inClientInfo)
+	//	device. The client's mix bus slot is released for the next one.
 	
 	//	declare the local variables
 	OSStatus theAnswer = 0;
+	VocanaDeviceInstance* theInstance = NULL;
+	AudioObjectID theKind = kAudioObjectUnknown;
 	
 	//	check the arguments
 	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_RemoveDeviceClient: bad driver reference");
-	FailWithAction(inDeviceObjectID != kObjectID_Device && inDeviceObjectID != kObjectID_Device2, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_RemoveDeviceClient: bad device ID");
+	FailWithAction(!find_device(inDeviceObjectID, &theInstance, &theKind), theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_RemoveDeviceClient: bad device ID");
+	FailWithAction(inClientInfo == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_RemoveDeviceClient: no client info");
+	
+	VocanaMixBus_RemoveClient(&device_io(theInstance, theKind)->mixBus, inClientInfo->mClientID);
 
 Done:
 	return theAnswer;
@@ -888,8 +1729,8 @@ static OSStatus	VocanaVirtualDevice_PerformDeviceConfigurationChange(AudioServer
 	//	means that the only notifications that would need to be sent here would be for either
 	//	custom properties the HAL doesn't know about or for controls.
 	//
-	//	For the device implemented by this driver, sample rate changes and enabling/disabling
-	//	the pitch adjust go through this process.
+	//	For the device implemented by this driver, sample rate and channel count changes and
+	//	enabling/disabling the pitch adjust go through this process.
 	//	These are the only states that can be changed for the device that aren't controls.
 	//	Which change is requested is passed in the inChangeAction argument.
 	
@@ -897,26 +1738,39 @@ static OSStatus	VocanaVirtualDevice_PerformDeviceConfigurationChange(AudioServer
 
 	//	declare the local variables
 	OSStatus theAnswer = 0;
+	VocanaDeviceInstance* theInstance = NULL;
+	AudioObjectID theKind = kAudioObjectUnknown;
     Float64 newSampleRate = 0.0;
+    UInt32 newChannelCount = 0;
+    int theChannelError = 0;
+    VocanaDeviceStateValues theState;
 	
 	//	check the arguments
 	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_PerformDeviceConfigurationChange: bad driver reference");
-    FailWithAction(inDeviceObjectID != kObjectID_Device && inDeviceObjectID != kObjectID_Device2, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_PerformDeviceConfigurationChange: bad device ID");
+    FailWithAction(!find_device(inDeviceObjectID, &theInstance, &theKind), theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_PerformDeviceConfigurationChange: bad device ID");
     switch(inChangeAction)
     {
         case ChangeAction_EnablePitchControl:
             pthread_mutex_lock(&gPlugIn_StateMutex);
-            gPitch_Adjust_Enabled = true;
+            VocanaDeviceState_Read(&theInstance->state, &theState);
+            theState.isPitchAdjustEnabled = true;
+            VocanaDeviceState_Publish(&theInstance->state, &theState);
+            VocanaClock_SetTracking(&theInstance->clock, true);
+            VocanaClock_SetRateTrim(&theInstance->clock, pitch_adjust_rate_trim(theState.pitchAdjust));
             pthread_mutex_unlock(&gPlugIn_StateMutex);
             break;
         case ChangeAction_DisablePitchControl:
             pthread_mutex_lock(&gPlugIn_StateMutex);
-            gPitch_Adjust_Enabled = false;
+            VocanaDeviceState_Read(&theInstance->state, &theState);
+            theState.isPitchAdjustEnabled = false;
+            VocanaDeviceState_Publish(&theInstance->state, &theState);
+            VocanaClock_SetTracking(&theInstance->clock, false);
+            VocanaClock_SetRateTrim(&theInstance->clock, 1.0);
             pthread_mutex_unlock(&gPlugIn_StateMutex);
             break;
         case ChangeAction_SetSampleRate:
             pthread_mutex_lock(&gPlugIn_StateMutex);
-            newSampleRate = gDevice_RequestedSampleRate;
+            newSampleRate = theInstance->requestedSampleRate;
             pthread_mutex_unlock(&gPlugIn_StateMutex);
             FailWithAction(!is_valid_sample_rate(newSampleRate), theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_PerformDeviceConfigurationChange: bad sample rate");
             
@@ -924,20 +1778,36 @@ static OSStatus	VocanaVirtualDevice_PerformDeviceConfigurationChange(AudioServer
             pthread_mutex_lock(&gPlugIn_StateMutex);
             
             //	change the sample rate
-            gDevice_SampleRate = newSampleRate;
+            VocanaDeviceState_Read(&theInstance->state, &theState);
+            theState.sampleRate = newSampleRate;
+            VocanaDeviceState_Publish(&theInstance->state, &theState);
             
-            //	recalculate the state that depends on the sample rate
-            struct mach_timebase_info theTimeBaseInfo;
-            mach_timebase_info(&theTimeBaseInfo);
-            Float64 theHostClockFrequency = (Float64)theTimeBaseInfo.denom / (Float64)theTimeBaseInfo.numer;
-            theHostClockFrequency *= 1000000000.0;
-            gDevice_HostTicksPerFrame = theHostClockFrequency / gDevice_SampleRate;
-            gDevice_AdjustedTicksPerFrame = gDevice_HostTicksPerFrame - gDevice_HostTicksPerFrame/100.0 * 2.0*(gPitch_Adjust - 0.5);
+            //	recalculate the state that depends on the sample rate; the clock forgets its reference,
+            //	whose rate just changed too
+            VocanaClock_SetSampleRate(&theInstance->clock, newSampleRate);
             
             //	unlock the state mutex
             pthread_mutex_unlock(&gPlugIn_StateMutex);
+            break;
+        case ChangeAction_SetChannelCount:
+            pthread_mutex_lock(&gPlugIn_StateMutex);
+            newChannelCount = theInstance->requestedChannelCount;
+            pthread_mutex_unlock(&gPlugIn_StateMutex);
+            FailWithAction(!VocanaChannels_IsValidCount(newChannelCount), theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_PerformDeviceConfigurationChange: bad channel count");
+            
+            //	The other device plays back this one's ring and the HAL only stopped this one, so
+            //	both lanes change together or not at all. The rings are reallocated here rather
+            //	than on the next StartIO so that a failure shows up now.
+            theChannelError = set_io_channel_count(theInstance, newChannelCount);
+            FailWithAction(theChannelError == EBUSY, theAnswer = kAudioHardwareNotStoppedError, Done, "VocanaVirtualDevice_PerformDeviceConfigurationChange: the other device is running");
+            FailWithAction(theChannelError != 0, theAnswer = kAudioHardwareUnspecifiedError, Done, "VocanaVirtualDevice_PerformDeviceConfigurationChange: failed to reallocate the mix bus");
+            atomic_store(&theInstance->ioChannelCount, newChannelCount);
             
-            // DebugMsg("VocanaVirtualDevice theTimeBaseInfo.numer: %u \t theTimeBaseInfo.denom: %u", theTimeBaseInfo.numer, theTimeBaseInfo.denom);
+            pthread_mutex_lock(&gPlugIn_StateMutex);
+            VocanaDeviceState_Read(&theInstance->state, &theState);
+            theState.channelCount = newChannelCount;
+            VocanaDeviceState_Publish(&theInstance->state, &theState);
+            pthread_mutex_unlock(&gPlugIn_StateMutex);
             break;
     };
 	
@@ -956,10 +1826,12 @@ static OSStatus	VocanaVirtualDevice_AbortDeviceConfigurationChange(AudioServerPl
 
 	//	declare the local variables
 	OSStatus theAnswer = 0;
+	VocanaDeviceInstance* theInstance = NULL;
+	AudioObjectID theKind = kAudioObjectUnknown;
 	
 	//	check the arguments
 	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_PerformDeviceConfigurationChange: bad driver reference");
-	FailWithAction(inDeviceObjectID != kObjectID_Device && inDeviceObjectID != kObjectID_Device2, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_PerformDeviceConfigurationChange: bad device ID");
+	FailWithAction(!find_device(inDeviceObjectID, &theInstance, &theKind), theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_PerformDeviceConfigurationChange: bad device ID");
 
 Done:
 	return theAnswer;
@@ -971,45 +1843,21 @@ static Boolean	VocanaVirtualDevice_HasProperty(AudioServerPlugInDriverRef inDriv
 {
 	//	This method returns whether or not the given object has the given property.
 	
+	#pragma unused(inClientProcessID)
+	
 	//	declare the local variables
 	Boolean theAnswer = false;
+	VocanaDeviceInstance* theInstance = NULL;
 	
 	//	check the arguments
 	FailIf(inDriver != gAudioServerPlugInDriverRef, Done, "VocanaVirtualDevice_HasProperty: bad driver reference");
 	FailIf(inAddress == NULL, Done, "VocanaVirtualDevice_HasProperty: no address");
 	
 	//	Note that for each object, this driver implements all the required properties plus a few
-	//	extras that are useful but not required. There is more detailed commentary about each
-	//	property in the VocanaVirtualDevice_GetPropertyData() method.
-	switch(inObjectID)
-	{
-		case kObjectID_PlugIn:
-			theAnswer = VocanaVirtualDevice_HasPlugInProperty(inDriver, inObjectID, inClientProcessID, inAddress);
-			break;
-		
-		case kObjectID_Box:
-			theAnswer = VocanaVirtualDevice_HasBoxProperty(inDriver, inObjectID, inClientProcessID, inAddress);
-			break;
-		
-		case kObjectID_Device:
-        case kObjectID_Device2:
-			theAnswer = VocanaVirtualDevice_HasDeviceProperty(inDriver, inObjectID, inClientProcessID, inAddress);
-			break;
-		
-		case kObjectID_Stream_Input:
-		case kObjectID_Stream_Output:
-			theAnswer = VocanaVirtualDevice_HasStreamProperty(inDriver, inObjectID, inClientProcessID, inAddress);
-			break;
-		
-		case kObjectID_Volume_Output_Master:
-		case kObjectID_Mute_Output_Master:
-		case kObjectID_Volume_Input_Master:
-		case kObjectID_Mute_Input_Master:
-		case kObjectID_Pitch_Adjust:
-        case kObjectID_ClockSource:
-			theAnswer = VocanaVirtualDevice_HasControlProperty(inDriver, inObjectID, inClientProcessID, inAddress);
-			break;
-	};
+	//	extras that are useful but not required. The properties of each class of object are listed
+	//	in the property tables above, and there is more detailed commentary about each property in
+	//	the VocanaVirtualDevice_GetPropertyData() method.
+	theAnswer = VocanaPropertyTable_Find(&gPlugIn_PropertyTable, object_kind(inObjectID, &theInstance), inAddress->mSelector, inAddress->mScope) != NULL;
 
 Done:
 	return theAnswer;
@@ -1020,50 +1868,30 @@ static OSStatus	VocanaVirtualDevice_IsPropertySettable(AudioServerPlugInDriverRe
 	//	This method returns whether or not the given property on the object can have its value
 	//	changed.
 	
+	#pragma unused(inClientProcessID)
+	
 	//	declare the local variables
 	OSStatus theAnswer = 0;
+	const VocanaPropertyEntry* theProperty = NULL;
+	VocanaDeviceInstance* theInstance = NULL;
+	AudioObjectID theKind = kAudioObjectUnknown;
 	
 	//	check the arguments
 	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_IsPropertySettable: bad driver reference");
 	FailWithAction(inAddress == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_IsPropertySettable: no address");
 	FailWithAction(outIsSettable == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_IsPropertySettable: no place to put the return value");
 	
-	//	Note that for each object, this driver implements all the required properties plus a few
-	//	extras that are useful but not required. There is more detailed commentary about each
-	//	property in the VocanaVirtualDevice_GetPropertyData() method.
-	switch(inObjectID)
+	theKind = object_kind(inObjectID, &theInstance);
+	theProperty = VocanaPropertyTable_Find(&gPlugIn_PropertyTable, theKind, inAddress->mSelector, inAddress->mScope);
+	FailWithAction(theProperty == NULL && !VocanaPropertyTable_HasObject(&gPlugIn_PropertyTable, theKind), theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_IsPropertySettable: unknown object");
+	if(theProperty != NULL)
 	{
-		case kObjectID_PlugIn:
-			theAnswer = VocanaVirtualDevice_IsPlugInPropertySettable(inDriver, inObjectID, inClientProcessID, inAddress, outIsSettable);
-			break;
-		
-		case kObjectID_Box:
-			theAnswer = VocanaVirtualDevice_IsBoxPropertySettable(inDriver, inObjectID, inClientProcessID, inAddress, outIsSettable);
-			break;
-		
-		case kObjectID_Device:
-        case kObjectID_Device2:
-			theAnswer = VocanaVirtualDevice_IsDevicePropertySettable(inDriver, inObjectID, inClientProcessID, inAddress, outIsSettable);
-			break;
-		
-		case kObjectID_Stream_Input:
-		case kObjectID_Stream_Output:
-			theAnswer = VocanaVirtualDevice_IsStreamPropertySettable(inDriver, inObjectID, inClientProcessID, inAddress, outIsSettable);
-			break;
-
-		case kObjectID_Volume_Output_Master:
-		case kObjectID_Mute_Output_Master:
-		case kObjectID_Volume_Input_Master:
-		case kObjectID_Mute_Input_Master:
-		case kObjectID_Pitch_Adjust:
-        case kObjectID_ClockSource:
-			theAnswer = VocanaVirtualDevice_IsControlPropertySettable(inDriver, inObjectID, inClientProcessID, inAddress, outIsSettable);
-			break;
-
-		default:
-			theAnswer = kAudioHardwareBadObjectError;
-			break;
-	};
+		*outIsSettable = VocanaPropertyEntry_IsSettable(theProperty);
+	}
+	else
+	{
+		theAnswer = kAudioHardwareUnknownPropertyError;
+	}
 
 Done:
 	return theAnswer;
@@ -1073,50 +1901,30 @@ static OSStatus	VocanaVirtualDevice_GetPropertyDataSize(AudioServerPlugInDriverR
 {
 	//	This method returns the byte size of the property's data.
 	
+	#pragma unused(inClientProcessID, inQualifierDataSize, inQualifierData)
+	
 	//	declare the local variables
 	OSStatus theAnswer = 0;
+	const VocanaPropertyEntry* theProperty = NULL;
+	VocanaDeviceInstance* theInstance = NULL;
+	AudioObjectID theKind = kAudioObjectUnknown;
 	
 	//	check the arguments
 	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_GetPropertyDataSize: bad driver reference");
 	FailWithAction(inAddress == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_GetPropertyDataSize: no address");
 	FailWithAction(outDataSize == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_GetPropertyDataSize: no place to put the return value");
 	
-	//	Note that for each object, this driver implements all the required properties plus a few
-	//	extras that are useful but not required. There is more detailed commentary about each
-	//	property in the VocanaVirtualDevice_GetPropertyData() method.
-	switch(inObjectID)
+	theKind = object_kind(inObjectID, &theInstance);
+	theProperty = VocanaPropertyTable_Find(&gPlugIn_PropertyTable, theKind, inAddress->mSelector, inAddress->mScope);
+	FailWithAction(theProperty == NULL && !VocanaPropertyTable_HasObject(&gPlugIn_PropertyTable, theKind), theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_GetPropertyDataSize: unknown object");
+	if(theProperty != NULL)
 	{
-		case kObjectID_PlugIn:
-			theAnswer = VocanaVirtualDevice_GetPlugInPropertyDataSize(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, outDataSize);
-			break;
-		
-		case kObjectID_Box:
-			theAnswer = VocanaVirtualDevice_GetBoxPropertyDataSize(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, outDataSize);
-			break;
-		
-		case kObjectID_Device:
-        case kObjectID_Device2:
-			theAnswer = VocanaVirtualDevice_GetDevicePropertyDataSize(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, outDataSize);
-			break;
-		
-		case kObjectID_Stream_Input:
-		case kObjectID_Stream_Output:
-			theAnswer = VocanaVirtualDevice_GetStreamPropertyDataSize(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, outDataSize);
-			break;
-			
-		case kObjectID_Volume_Output_Master:
-		case kObjectID_Mute_Output_Master:
-		case kObjectID_Volume_Input_Master:
-		case kObjectID_Mute_Input_Master:
-		case kObjectID_Pitch_Adjust:
-        case kObjectID_ClockSource:
-			theAnswer = VocanaVirtualDevice_GetControlPropertyDataSize(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, outDataSize);
-			break;
-			
-		default:
-			theAnswer = kAudioHardwareBadObjectError;
-			break;
-	};
+		*outDataSize = VocanaPropertyEntry_GetSizeForObject(theProperty, inObjectID, inAddress->mScope);
+	}
+	else
+	{
+		theAnswer = kAudioHardwareUnknownPropertyError;
+	}
 
 Done:
 	return theAnswer;
@@ -1126,6 +1934,9 @@ static OSStatus	VocanaVirtualDevice_GetPropertyData(AudioServerPlugInDriverRef i
 {
 	//	declare the local variables
 	OSStatus theAnswer = 0;
+	const VocanaPropertyEntry* theProperty = NULL;
+	VocanaDeviceInstance* theInstance = NULL;
+	AudioObjectID theKind = kAudioObjectUnknown;
 	
 	//	check the arguments
 	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_GetPropertyData: bad driver reference");
@@ -1134,43 +1945,22 @@ static OSStatus	VocanaVirtualDevice_GetPropertyData(AudioServerPlugInDriverRef i
 	FailWithAction(outData == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_GetPropertyData: no place to put the return value");
 	
 	//	Note that for each object, this driver implements all the required properties plus a few
-	//	extras that are useful but not required.
+	//	extras that are useful but not required. The property table finds the getter of the
+	//	object's class, which only sees the properties the table lists for it.
 	//
 	//	Also, since most of the data that will get returned is static, there are few instances where
 	//	it is necessary to lock the state mutex.
-	switch(inObjectID)
+	theKind = object_kind(inObjectID, &theInstance);
+	theProperty = VocanaPropertyTable_Find(&gPlugIn_PropertyTable, theKind, inAddress->mSelector, inAddress->mScope);
+	FailWithAction(theProperty == NULL && !VocanaPropertyTable_HasObject(&gPlugIn_PropertyTable, theKind), theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_GetPropertyData: unknown object");
+	if(theProperty != NULL)
 	{
-		case kObjectID_PlugIn:
-			theAnswer = VocanaVirtualDevice_GetPlugInPropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, outDataSize, outData);
-			break;
-		
-		case kObjectID_Box:
-			theAnswer = VocanaVirtualDevice_GetBoxPropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, outDataSize, outData);
-			break;
-		
-		case kObjectID_Device:
-        case kObjectID_Device2:
-			theAnswer = VocanaVirtualDevice_GetDevicePropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, outDataSize, outData);
-			break;
-		
-		case kObjectID_Stream_Input:
-		case kObjectID_Stream_Output:
-			theAnswer = VocanaVirtualDevice_GetStreamPropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, outDataSize, outData);
-			break;
-		
-		case kObjectID_Volume_Output_Master:
-		case kObjectID_Mute_Output_Master:
-		case kObjectID_Volume_Input_Master:
-		case kObjectID_Mute_Input_Master:
-		case kObjectID_Pitch_Adjust:
-        case kObjectID_ClockSource:
-			theAnswer = VocanaVirtualDevice_GetControlPropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, outDataSize, outData);
-			break;
-			
-		default:
-			theAnswer = kAudioHardwareBadObjectError;
-			break;
-	};
+		theAnswer = ((VocanaVirtualDevice_GetPropertyDataProc)theProperty->getProc)(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, outDataSize, outData);
+	}
+	else
+	{
+		theAnswer = kAudioHardwareUnknownPropertyError;
+	}
 
 Done:
 	return theAnswer;
@@ -1180,6 +1970,9 @@ static OSStatus	VocanaVirtualDevice_SetPropertyData(AudioServerPlugInDriverRef i
 {
 	//	declare the local variables
 	OSStatus theAnswer = 0;
+	const VocanaPropertyEntry* theProperty = NULL;
+	VocanaDeviceInstance* theInstance = NULL;
+	AudioObjectID theKind = kAudioObjectUnknown;
 	UInt32 theNumberPropertiesChanged = 0;
 	AudioObjectPropertyAddress theChangedAddresses[2];
 	
@@ -1188,41 +1981,20 @@ static OSStatus	VocanaVirtualDevice_SetPropertyData(AudioServerPlugInDriverRef i
 	FailWithAction(inAddress == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_SetPropertyData: no address");
 	
 	//	Note that for each object, this driver implements all the required properties plus a few
-	//	extras that are useful but not required. There is more detailed commentary about each
-	//	property in the VocanaVirtualDevice_GetPropertyData() method.
-	switch(inObjectID)
+	//	extras that are useful but not required. Only the properties the table lists as settable
+	//	carry their class's setter. There is more detailed commentary about each property in the
+	//	VocanaVirtualDevice_GetPropertyData() method.
+	theKind = object_kind(inObjectID, &theInstance);
+	theProperty = VocanaPropertyTable_Find(&gPlugIn_PropertyTable, theKind, inAddress->mSelector, inAddress->mScope);
+	FailWithAction(theProperty == NULL && !VocanaPropertyTable_HasObject(&gPlugIn_PropertyTable, theKind), theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_SetPropertyData: unknown object");
+	if(theProperty != NULL && theProperty->setProc != NULL)
 	{
-		case kObjectID_PlugIn:
-			theAnswer = VocanaVirtualDevice_SetPlugInPropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, inData, &theNumberPropertiesChanged, theChangedAddresses);
-			break;
-		
-		case kObjectID_Box:
-			theAnswer = VocanaVirtualDevice_SetBoxPropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, inData, &theNumberPropertiesChanged, theChangedAddresses);
-			break;
-		
-		case kObjectID_Device:
-        case kObjectID_Device2:
-			theAnswer = VocanaVirtualDevice_SetDevicePropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, inData, &theNumberPropertiesChanged, theChangedAddresses);
-			break;
-		
-		case kObjectID_Stream_Input:
-		case kObjectID_Stream_Output:
-			theAnswer = VocanaVirtualDevice_SetStreamPropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, inData, &theNumberPropertiesChanged, theChangedAddresses);
-			break;
-			
-		case kObjectID_Volume_Output_Master:
-		case kObjectID_Mute_Output_Master:
-		case kObjectID_Volume_Input_Master:
-		case kObjectID_Mute_Input_Master:
-		case kObjectID_Pitch_Adjust:
-        case kObjectID_ClockSource:
-			theAnswer = VocanaVirtualDevice_SetControlPropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, inData, &theNumberPropertiesChanged, theChangedAddresses);
-			break;
-			
-		default:
-			theAnswer = kAudioHardwareBadObjectError;
-			break;
-	};
+		theAnswer = ((VocanaVirtualDevice_SetPropertyDataProc)theProperty->setProc)(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, inData, &theNumberPropertiesChanged, theChangedAddresses);
+	}
+	else
+	{
+		theAnswer = kAudioHardwareUnknownPropertyError;
+	}
 
 	//	send any notifications
 	if(theNumberPropertiesChanged > 0)
@@ -1236,170 +2008,6 @@ Done:
 
 #pragma mark PlugIn Property Operations
 
-static Boolean	VocanaVirtualDevice_HasPlugInProperty(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress)
-{
-	//	This method returns whether or not the plug-in object has the given property.
-	
-	#pragma unused(inClientProcessID)
-	
-	//	declare the local variables
-	Boolean theAnswer = false;
-	
-	//	check the arguments
-	FailIf(inDriver != gAudioServerPlugInDriverRef, Done, "VocanaVirtualDevice_HasPlugInProperty: bad driver reference");
-	FailIf(inAddress == NULL, Done, "VocanaVirtualDevice_HasPlugInProperty: no address");
-	FailIf(inObjectID != kObjectID_PlugIn, Done, "VocanaVirtualDevice_HasPlugInProperty: not the plug-in object");
-	
-	
-	//	Note that for each object, this driver implements all the required properties plus a few
-	//	extras that are useful but not required. There is more detailed commentary about each
-	//	property in the VocanaVirtualDevice_GetPlugInPropertyData() method.
-	switch(inAddress->mSelector)
-	{
-		case kAudioObjectPropertyBaseClass:
-		case kAudioObjectPropertyClass:
-		case kAudioObjectPropertyOwner:
-		case kAudioObjectPropertyManufacturer:
-		case kAudioObjectPropertyOwnedObjects:
-		case kAudioPlugInPropertyBoxList:
-		case kAudioPlugInPropertyTranslateUIDToBox:
-		case kAudioPlugInPropertyDeviceList:
-		case kAudioPlugInPropertyTranslateUIDToDevice:
-		case kAudioPlugInPropertyResourceBundle:
-			theAnswer = true;
-			break;
-	};
-
-Done:
-	return theAnswer;
-}
-
-static OSStatus	VocanaVirtualDevice_IsPlugInPropertySettable(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, Boolean* outIsSettable)
-{
-	//	This method returns whether or not the given property on the plug-in object can have its
-	//	value changed.
-	
-	#pragma unused(inClientProcessID)
-	
-	//	declare the local variables
-	OSStatus theAnswer = 0;
-	
-	//	check the arguments
-	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_IsPlugInPropertySettable: bad driver reference");
-	FailWithAction(inAddress == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_IsPlugInPropertySettable: no address");
-	FailWithAction(outIsSettable == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_IsPlugInPropertySettable: no place to put the return value");
-	FailWithAction(inObjectID != kObjectID_PlugIn, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_IsPlugInPropertySettable: not the plug-in object");
-	
-	//	Note that for each object, this driver implements all the required properties plus a few
-	//	extras that are useful but not required. There is more detailed commentary about each
-	//	property in the VocanaVirtualDevice_GetPlugInPropertyData() method.
-	switch(inAddress->mSelector)
-	{
-		case kAudioObjectPropertyBaseClass:
-		case kAudioObjectPropertyClass:
-		case kAudioObjectPropertyOwner:
-		case kAudioObjectPropertyManufacturer:
-		case kAudioObjectPropertyOwnedObjects:
-		case kAudioPlugInPropertyBoxList:
-		case kAudioPlugInPropertyTranslateUIDToBox:
-		case kAudioPlugInPropertyDeviceList:
-		case kAudioPlugInPropertyTranslateUIDToDevice:
-		case kAudioPlugInPropertyResourceBundle:
-			*outIsSettable = false;
-			break;
-		
-		default:
-			theAnswer = kAudioHardwareUnknownPropertyError;
-			break;
-	};
-
-Done:
-	return theAnswer;
-}
-
-static OSStatus	VocanaVirtualDevice_GetPlugInPropertyDataSize(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32* outDataSize)
-{
-	//	This method returns the byte size of the property's data.
-	
-	#pragma unused(inClientProcessID, inQualifierDataSize, inQualifierData)
-	
-	//	declare the local variables
-	OSStatus theAnswer = 0;
-	
-	//	check the arguments
-	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_GetPlugInPropertyDataSize: bad driver reference");
-	FailWithAction(inAddress == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_GetPlugInPropertyDataSize: no address");
-	FailWithAction(outDataSize == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_GetPlugInPropertyDataSize: no place to put the return value");
-	FailWithAction(inObjectID != kObjectID_PlugIn, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_GetPlugInPropertyDataSize: not the plug-in object");
-	
-	//	Note that for each object, this driver implements all the required properties plus a few
-	//	extras that are useful but not required. There is more detailed commentary about each
-	//	property in the VocanaVirtualDevice_GetPlugInPropertyData() method.
-	switch(inAddress->mSelector)
-	{
-		case kAudioObjectPropertyBaseClass:
-			*outDataSize = sizeof(AudioClassID);
-			break;
-			
-		case kAudioObjectPropertyClass:
-			*outDataSize = sizeof(AudioClassID);
-			break;
-			
-		case kAudioObjectPropertyOwner:
-			*outDataSize = sizeof(AudioObjectID);
-			break;
-			
-		case kAudioObjectPropertyManufacturer:
-			*outDataSize = sizeof(CFStringRef);
-			break;
-			
-		case kAudioObjectPropertyOwnedObjects:
-			if(gBox_Acquired)
-			{
-				*outDataSize = 2 * sizeof(AudioClassID);
-			}
-			else
-			{
-				*outDataSize = sizeof(AudioClassID);
-			}
-			break;
-			
-		case kAudioPlugInPropertyBoxList:
-			*outDataSize = sizeof(AudioClassID);
-			break;
-			
-		case kAudioPlugInPropertyTranslateUIDToBox:
-			*outDataSize = sizeof(AudioObjectID);
-			break;
-			
-		case kAudioPlugInPropertyDeviceList:
-			if(gBox_Acquired)
-			{
-				*outDataSize = sizeof(AudioClassID)*2;
-			}
-			else
-			{
-				*outDataSize = 0;
-			}
-			break;
-			
-		case kAudioPlugInPropertyTranslateUIDToDevice:
-			*outDataSize = sizeof(AudioObjectID);
-			break;
-			
-		case kAudioPlugInPropertyResourceBundle:
-			*outDataSize = sizeof(CFStringRef);
-			break;
-			
-		default:
-			theAnswer = kAudioHardwareUnknownPropertyError;
-			break;
-	};
-
-Done:
-	return theAnswer;
-}
-
 static OSStatus	VocanaVirtualDevice_GetPlugInPropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, UInt32* outDataSize, void* outData)
 {
 	#pragma unused(inClientProcessID)
@@ -1456,21 +2064,13 @@ static OSStatus	VocanaVirtualDevice_GetPlugInPropertyData(AudioServerPlugInDrive
 			//	case, only that number of items will be returned
 			theNumberItemsToFetch = inDataSize / sizeof(AudioObjectID);
 			
-			//	Clamp that to the number of boxes this driver implements (which is just 1)
-			if(theNumberItemsToFetch > (gBox_Acquired ? 2 : 1))
-			{
-				theNumberItemsToFetch = (gBox_Acquired ? 2 : 1);
-			}
-			
-			//	Write the devices' object IDs into the return value
-			if(theNumberItemsToFetch > 1)
-			{
-				((AudioObjectID*)outData)[0] = kObjectID_Box;
-				((AudioObjectID*)outData)[1] = kObjectID_Device;
-			}
-			else if(theNumberItemsToFetch > 0)
+			//	The plug-in owns the box and, if the box is acquired, the devices
+			if(theNumberItemsToFetch > 0)
 			{
 				((AudioObjectID*)outData)[0] = kObjectID_Box;
+				pthread_mutex_lock(&gPlugIn_StateMutex);
+				theNumberItemsToFetch = 1 + copy_device_list((AudioObjectID*)outData + 1, theNumberItemsToFetch - 1);
+				pthread_mutex_unlock(&gPlugIn_StateMutex);
 			}
 			
 			//	Return how many bytes we wrote to
@@ -1541,23 +2141,11 @@ static OSStatus	VocanaVirtualDevice_GetPlugInPropertyData(AudioServerPlugInDrive
 			//	case, only that number of items will be returned
 			theNumberItemsToFetch = inDataSize / sizeof(AudioObjectID);
 			
-			//	Clamp that to the number of devices this driver implements (which is just 1 if the
-			//	box has been acquired)
-			if(theNumberItemsToFetch > (gBox_Acquired ? 2 : 0))
-			{
-				theNumberItemsToFetch = (gBox_Acquired ? 2 : 0);
-			}
-			
-			//	Write the devices' object IDs into the return value
-			if(theNumberItemsToFetch > 1)
-			{
-				((AudioObjectID*)outData)[0] = kObjectID_Device;
-                ((AudioObjectID*)outData)[1] = kObjectID_Device2;
-			}
-            else if(theNumberItemsToFetch > 0)
-            {
-                ((AudioObjectID*)outData)[0] = kObjectID_Device;
-            }
+			//	Write the devices' object IDs into the return value, each device followed by its
+			//	mirror, if the box has been acquired
+			pthread_mutex_lock(&gPlugIn_StateMutex);
+			theNumberItemsToFetch = copy_device_list((AudioObjectID*)outData, theNumberItemsToFetch);
+			pthread_mutex_unlock(&gPlugIn_StateMutex);
 			
 			//	Return how many bytes we wrote to
 			*outDataSize = theNumberItemsToFetch * sizeof(AudioClassID);
@@ -1565,34 +2153,61 @@ static OSStatus	VocanaVirtualDevice_GetPlugInPropertyData(AudioServerPlugInDrive
 			
 		case kAudioPlugInPropertyTranslateUIDToDevice:
 			//	This property takes the CFString passed in the qualifier and converts that
-			//	to the object ID of the device it corresponds to. For this driver, there is
-			//	just the one device. Note that it is not an error if the string in the
-			//	qualifier doesn't match any devices. In such case, kAudioObjectUnknown is
-			//	the object ID to return.
+			//	to the object ID of the device it corresponds to. Note that it is not an
+			//	error if the string in the qualifier doesn't match any devices. In such
+			//	case, kAudioObjectUnknown is the object ID to return.
 			FailWithAction(inDataSize < sizeof(AudioObjectID), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetPlugInPropertyData: not enough space for the return value of kAudioPlugInPropertyTranslateUIDToDevice");
-			FailWithAction(inQualifierDataSize == sizeof(CFStringRef), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetPlugInPropertyData: the qualifier is the wrong size for kAudioPlugInPropertyTranslateUIDToDevice");
+			FailWithAction(inQualifierDataSize != sizeof(CFStringRef), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetPlugInPropertyData: the qualifier is the wrong size for kAudioPlugInPropertyTranslateUIDToDevice");
 			FailWithAction(inQualifierData == NULL, theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetPlugInPropertyData: no qualifier for kAudioPlugInPropertyTranslateUIDToDevice");
-            
-            
 			
-			CFStringRef deviceUID = get_device_uid();
-            CFStringRef device2UID = get_device2_uid();
-
-			if(CFStringCompare(*((CFStringRef*)inQualifierData), deviceUID, 0) == kCFCompareEqualTo)
+			*((AudioObjectID*)outData) = kAudioObjectUnknown;
+			pthread_mutex_lock(&gPlugIn_StateMutex);
+			for(UInt32 i = 0; i < VocanaDeviceRegistry_GetCount(&gDevice_Registry) && *((AudioObjectID*)outData) == kAudioObjectUnknown; i++)
 			{
-				*((AudioObjectID*)outData) = kObjectID_Device;
+				CFStringRef deviceUID = get_device_uid(&gDevice_Instances[i]);
+				CFStringRef device2UID = get_device2_uid(&gDevice_Instances[i]);
+				if(CFStringCompare(*((CFStringRef*)inQualifierData), deviceUID, 0) == kCFCompareEqualTo)
+				{
+					*((AudioObjectID*)outData) = object_id(&gDevice_Instances[i], kObjectID_Device);
+				}
+				else if(CFStringCompare(*((CFStringRef*)inQualifierData), device2UID, 0) == kCFCompareEqualTo)
+				{
+					*((AudioObjectID*)outData) = object_id(&gDevice_Instances[i], kObjectID_Device2);
+				}
+				CFRelease(deviceUID);
+				CFRelease(device2UID);
 			}
-            else if(CFStringCompare(*((CFStringRef*)inQualifierData), device2UID, 0) == kCFCompareEqualTo)
-            {
-                *((AudioObjectID*)outData) = kObjectID_Device2;
-            }
-			else
+			pthread_mutex_unlock(&gPlugIn_StateMutex);
+			*outDataSize = sizeof(AudioObjectID);
+			break;
+			
+		case kAudioObjectPropertyCustomPropertyInfoList:
+			//	This property tells the HAL about the plug-in's custom properties and the type of
+			//	their data, so that it can move them between processes.
+			theNumberItemsToFetch = inDataSize / sizeof(AudioServerPlugInCustomPropertyInfo);
+			if(theNumberItemsToFetch > kPlugIn_CustomPropertyListSize)
 			{
-				*((AudioObjectID*)outData) = kAudioObjectUnknown;
+				theNumberItemsToFetch = kPlugIn_CustomPropertyListSize;
+			}
+			for(UInt32 i = 0; i < theNumberItemsToFetch; ++i)
+			{
+				((AudioServerPlugInCustomPropertyInfo*)outData)[i].mSelector = kPlugIn_CustomPropertyList[i];
+				((AudioServerPlugInCustomPropertyInfo*)outData)[i].mPropertyDataType = kAudioServerPlugInCustomPropertyDataTypeCFPropertyList;
+				((AudioServerPlugInCustomPropertyInfo*)outData)[i].mQualifierDataType = kAudioServerPlugInCustomPropertyDataTypeNone;
+			}
+			*outDataSize = theNumberItemsToFetch * sizeof(AudioServerPlugInCustomPropertyInfo);
+			break;
+			
+		case kVocanaPlugInPropertyDeviceCount:
+			{
+				//	This is a CFNumber with the number of devices, not counting their mirrors.
+				FailWithAction(inDataSize < sizeof(CFPropertyListRef), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetPlugInPropertyData: not enough space for the return value of kVocanaPlugInPropertyDeviceCount");
+				pthread_mutex_lock(&gPlugIn_StateMutex);
+				SInt32 theDeviceCount = (SInt32)VocanaDeviceRegistry_GetCount(&gDevice_Registry);
+				pthread_mutex_unlock(&gPlugIn_StateMutex);
+				*((CFPropertyListRef*)outData) = CFNumberCreate(NULL, kCFNumberSInt32Type, &theDeviceCount);
+				*outDataSize = sizeof(CFPropertyListRef);
 			}
-			*outDataSize = sizeof(AudioObjectID);
-			CFRelease(deviceUID);
-            CFRelease(device2UID);
 			break;
 			
 		case kAudioPlugInPropertyResourceBundle:
@@ -1615,7 +2230,7 @@ Done:
 
 static OSStatus	VocanaVirtualDevice_SetPlugInPropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, const void* inData, UInt32* outNumberPropertiesChanged, AudioObjectPropertyAddress outChangedAddresses[2])
 {
-	#pragma unused(inClientProcessID, inQualifierDataSize, inQualifierData, inDataSize, inData)
+	#pragma unused(inClientProcessID, inQualifierDataSize, inQualifierData)
 	
 	//	declare the local variables
 	OSStatus theAnswer = 0;
@@ -1635,216 +2250,33 @@ static OSStatus	VocanaVirtualDevice_SetPlugInPropertyData(AudioServerPlugInDrive
 	//	property in the VocanaVirtualDevice_GetPlugInPropertyData() method.
 	switch(inAddress->mSelector)
 	{
-		default:
-			theAnswer = kAudioHardwareUnknownPropertyError;
-			break;
-	};
-
-Done:
-	return theAnswer;
-}
-
-#pragma mark Box Property Operations
-
-static Boolean	VocanaVirtualDevice_HasBoxProperty(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress)
-{
-	//	This method returns whether or not the box object has the given property.
-	
-	#pragma unused(inClientProcessID)
-	
-	//	declare the local variables
-	Boolean theAnswer = false;
-	
-	//	check the arguments
-	FailIf(inDriver != gAudioServerPlugInDriverRef, Done, "VocanaVirtualDevice_HasBoxProperty: bad driver reference");
-	FailIf(inAddress == NULL, Done, "VocanaVirtualDevice_HasBoxProperty: no address");
-	FailIf(inObjectID != kObjectID_Box, Done, "VocanaVirtualDevice_HasBoxProperty: not the box object");
-	
-	
-	//	Note that for each object, this driver implements all the required properties plus a few
-	//	extras that are useful but not required. There is more detailed commentary about each
-	//	property in the VocanaVirtualDevice_GetBoxPropertyData() method.
-	switch(inAddress->mSelector)
-	{
-		case kAudioObjectPropertyBaseClass:
-		case kAudioObjectPropertyClass:
-		case kAudioObjectPropertyOwner:
-		case kAudioObjectPropertyName:
-		case kAudioObjectPropertyModelName:
-		case kAudioObjectPropertyManufacturer:
-		case kAudioObjectPropertyOwnedObjects:
-		case kAudioObjectPropertyIdentify:
-		case kAudioObjectPropertySerialNumber:
-		case kAudioObjectPropertyFirmwareVersion:
-		case kAudioBoxPropertyBoxUID:
-		case kAudioBoxPropertyTransportType:
-		case kAudioBoxPropertyHasAudio:
-		case kAudioBoxPropertyHasVideo:
-		case kAudioBoxPropertyHasMIDI:
-		case kAudioBoxPropertyIsProtected:
-		case kAudioBoxPropertyAcquired:
-		case kAudioBoxPropertyAcquisitionFailed:
-		case kAudioBoxPropertyDeviceList:
-			theAnswer = true;
-			break;
-	};
-
-Done:
-	return theAnswer;
-}
-
-static OSStatus	VocanaVirtualDevice_IsBoxPropertySettable(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, Boolean* outIsSettable)
-{
-	//	This method returns whether or not the given property on the plug-in object can have its
-	//	value changed.
-	
-	#pragma unused(inClientProcessID)
-	
-	//	declare the local variables
-	OSStatus theAnswer = 0;
-	
-	//	check the arguments
-	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_IsBoxPropertySettable: bad driver reference");
-	FailWithAction(inAddress == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_IsBoxPropertySettable: no address");
-	FailWithAction(outIsSettable == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_IsBoxPropertySettable: no place to put the return value");
-	FailWithAction(inObjectID != kObjectID_Box, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_IsBoxPropertySettable: not the plug-in object");
-	
-	//	Note that for each object, this driver implements all the required properties plus a few
-	//	extras that are useful but not required. There is more detailed commentary about each
-	//	property in the VocanaVirtualDevice_GetBoxPropertyData() method.
-	switch(inAddress->mSelector)
-	{
-		case kAudioObjectPropertyBaseClass:
-		case kAudioObjectPropertyClass:
-		case kAudioObjectPropertyOwner:
-		case kAudioObjectPropertyModelName:
-		case kAudioObjectPropertyManufacturer:
-		case kAudioObjectPropertyOwnedObjects:
-		case kAudioObjectPropertySerialNumber:
-		case kAudioObjectPropertyFirmwareVersion:
-		case kAudioBoxPropertyBoxUID:
-		case kAudioBoxPropertyTransportType:
-		case kAudioBoxPropertyHasAudio:
-		case kAudioBoxPropertyHasVideo:
-		case kAudioBoxPropertyHasMIDI:
-		case kAudioBoxPropertyIsProtected:
-		case kAudioBoxPropertyAcquisitionFailed:
-		case kAudioBoxPropertyDeviceList:
-			*outIsSettable = false;
-			break;
-		
-		case kAudioObjectPropertyName:
-		case kAudioObjectPropertyIdentify:
-		case kAudioBoxPropertyAcquired:
-			*outIsSettable = true;
-			break;
-		
-		default:
-			theAnswer = kAudioHardwareUnknownPropertyError;
-			break;
-	};
-
-Done:
-	return theAnswer;
-}
-
-static OSStatus	VocanaVirtualDevice_GetBoxPropertyDataSize(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32* outDataSize)
-{
-	//	This method returns the byte size of the property's data.
-	
-	#pragma unused(inClientProcessID, inQualifierDataSize, inQualifierData)
-	
-	//	declare the local variables
-	OSStatus theAnswer = 0;
-	
-	//	check the arguments
-	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_GetBoxPropertyDataSize: bad driver reference");
-	FailWithAction(inAddress == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_GetBoxPropertyDataSize: no address");
-	FailWithAction(outDataSize == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_GetBoxPropertyDataSize: no place to put the return value");
-	FailWithAction(inObjectID != kObjectID_Box, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_GetBoxPropertyDataSize: not the plug-in object");
-	
-	//	Note that for each object, this driver implements all the required properties plus a few
-	//	extras that are useful but not required. There is more detailed commentary about each
-	//	property in the VocanaVirtualDevice_GetBoxPropertyData() method.
-	switch(inAddress->mSelector)
-	{
-		case kAudioObjectPropertyBaseClass:
-			*outDataSize = sizeof(AudioClassID);
-			break;
-			
-		case kAudioObjectPropertyClass:
-			*outDataSize = sizeof(AudioClassID);
-			break;
-			
-		case kAudioObjectPropertyOwner:
-			*outDataSize = sizeof(AudioObjectID);
-			break;
-			
-		case kAudioObjectPropertyName:
-			*outDataSize = sizeof(CFStringRef);
-			break;
-			
-		case kAudioObjectPropertyModelName:
-			*outDataSize = sizeof(CFStringRef);
-			break;
-			
-		case kAudioObjectPropertyManufacturer:
-			*outDataSize = sizeof(CFStringRef);
-			break;
-			
-		case kAudioObjectPropertyOwnedObjects:
-			*outDataSize = 0;
-			break;
-			
-		case kAudioObjectPropertyIdentify:
-			*outDataSize = sizeof(UInt32);
-			break;
-			
-		case kAudioObjectPropertySerialNumber:
-			*outDataSize = sizeof(CFStringRef);
-			break;
-			
-		case kAudioObjectPropertyFirmwareVersion:
-			*outDataSize = sizeof(CFStringRef);
-			break;
-			
-		case kAudioBoxPropertyBoxUID:
-			*outDataSize = sizeof(CFStringRef);
-			break;
-			
-		case kAudioBoxPropertyTransportType:
-			*outDataSize = sizeof(UInt32);
-			break;
-			
-		case kAudioBoxPropertyHasAudio:
-			*outDataSize = sizeof(UInt32);
-			break;
-			
-		case kAudioBoxPropertyHasVideo:
-			*outDataSize = sizeof(UInt32);
-			break;
-			
-		case kAudioBoxPropertyHasMIDI:
-			*outDataSize = sizeof(UInt32);
-			break;
-			
-		case kAudioBoxPropertyIsProtected:
-			*outDataSize = sizeof(UInt32);
-			break;
-			
-		case kAudioBoxPropertyAcquired:
-			*outDataSize = sizeof(UInt32);
-			break;
-			
-		case kAudioBoxPropertyAcquisitionFailed:
-			*outDataSize = sizeof(UInt32);
-			break;
-			
-		case kAudioBoxPropertyDeviceList:
+		case kVocanaPlugInPropertyDeviceCount:
 			{
+				//	Devices are added and removed at the end of the list, and the count is kept so
+				//	that the plug-in comes back with it the next time it loads.
+				FailWithAction(inDataSize != sizeof(CFPropertyListRef), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_SetPlugInPropertyData: wrong size for the data for kVocanaPlugInPropertyDeviceCount");
+				CFPropertyListRef theNumber = *((const CFPropertyListRef*)inData);
+				UInt32 theNewDeviceCount = 0;
+				FailWithAction(!device_count_from_number(theNumber, &theNewDeviceCount), theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_SetPlugInPropertyData: unsupported value for kVocanaPlugInPropertyDeviceCount");
+				
 				pthread_mutex_lock(&gPlugIn_StateMutex);
-				*outDataSize = gBox_Acquired ? sizeof(AudioObjectID) * 2 : 0;
+				bool didChange = false;
+				theAnswer = set_device_count(theNewDeviceCount, &didChange);
 				pthread_mutex_unlock(&gPlugIn_StateMutex);
+				if(didChange)
+				{
+					//	the device list changes for the box as well
+					*outNumberPropertiesChanged = 2;
+					outChangedAddresses[0].mSelector = kVocanaPlugInPropertyDeviceCount;
+					outChangedAddresses[0].mScope = kAudioObjectPropertyScopeGlobal;
+					outChangedAddresses[0].mElement = kAudioObjectPropertyElementMain;
+					outChangedAddresses[1].mSelector = kAudioPlugInPropertyDeviceList;
+					outChangedAddresses[1].mScope = kAudioObjectPropertyScopeGlobal;
+					outChangedAddresses[1].mElement = kAudioObjectPropertyElementMain;
+					dispatch_async_f(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), NULL, notify_box_device_list);
+				}
+				FailIf(theAnswer != 0, Done, "VocanaVirtualDevice_SetPlugInPropertyData: a device to remove is running");
+				gPlugIn_Host->WriteToStorage(gPlugIn_Host, CFSTR(kDeviceCount_StorageKey), theNumber);
 			}
 			break;
 			
@@ -1857,6 +2289,8 @@ Done:
 	return theAnswer;
 }
 
+#pragma mark Box Property Operations
+
 static OSStatus	VocanaVirtualDevice_GetBoxPropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, UInt32* outDataSize, void* outData)
 {
 	#pragma unused(inClientProcessID, inQualifierDataSize, inQualifierData)
@@ -2015,33 +2449,15 @@ static OSStatus	VocanaVirtualDevice_GetBoxPropertyData(AudioServerPlugInDriverRe
 		case kAudioBoxPropertyDeviceList:
 			//	This is used to indicate which devices came from this box
 			pthread_mutex_lock(&gPlugIn_StateMutex);
-			if(gBox_Acquired)
+			if(gBox_Acquired && inDataSize < sizeof(AudioObjectID))
 			{
-                if(inDataSize < sizeof(AudioObjectID))
-                {
-                    theAnswer = kAudioHardwareBadPropertySizeError;
-                    *outDataSize = 0;
-                }
-                else
-                {
-                    if (inDataSize >= sizeof(AudioObjectID) * 2)
-                    {
-                        ((AudioObjectID*)outData)[0] = kObjectID_Device;
-                        ((AudioObjectID*)outData)[1] = kObjectID_Device2;
-                        *outDataSize = sizeof(AudioObjectID) * 2;
-                    }
-                    else
-                    {
-                        ((AudioObjectID*)outData)[0] = kObjectID_Device;
-                        *outDataSize = sizeof(AudioObjectID) * 1;
-                    }
-                }
+				theAnswer = kAudioHardwareBadPropertySizeError;
+				*outDataSize = 0;
 			}
 			else
 			{
-				*outDataSize = 0;
+				*outDataSize = copy_device_list((AudioObjectID*)outData, inDataSize / sizeof(AudioObjectID)) * sizeof(AudioObjectID);
 			}
-            
 			pthread_mutex_unlock(&gPlugIn_StateMutex);
 			break;
 			
@@ -2108,11 +2524,7 @@ static OSStatus	VocanaVirtualDevice_SetBoxPropertyData(AudioServerPlugInDriverRe
 			{
 				syslog(LOG_NOTICE, "The identify property has been set on the Box implemented by the VocanaVirtualDevice driver.");
 				FailWithAction(inDataSize != sizeof(UInt32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_SetBoxPropertyData: wrong size for the data for kAudioObjectPropertyIdentify");
-				dispatch_after(dispatch_time(0, 2ULL * 1000ULL * 1000ULL * 1000ULL), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0),	^()
-																																		{
-																																			AudioObjectPropertyAddress theAddress = { kAudioObjectPropertyIdentify, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMain };
-																																			gPlugIn_Host->PropertiesChanged(gPlugIn_Host, kObjectID_Box, 1, &theAddress);
-																																		});
+				dispatch_after_f(dispatch_time(0, 2ULL * 1000ULL * 1000ULL * 1000ULL), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), NULL, notify_box_identify);
 			}
 			break;
 			
@@ -2137,11 +2549,7 @@ static OSStatus	VocanaVirtualDevice_SetBoxPropertyData(AudioServerPlugInDriverRe
 					outChangedAddresses[1].mElement = kAudioObjectPropertyElementMain;
 					
 					//	but it also means that the device list has changed for the plug-in too
-					dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0),	^()
-																									{
-																										AudioObjectPropertyAddress theAddress = { kAudioPlugInPropertyDeviceList, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMain };
-																										gPlugIn_Host->PropertiesChanged(gPlugIn_Host, kObjectID_PlugIn, 1, &theAddress);
-																									});
+					dispatch_async_f(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), NULL, notify_plugin_device_list);
 				}
 				pthread_mutex_unlock(&gPlugIn_StateMutex);
 			}
@@ -2158,278 +2566,29 @@ Done:
 
 #pragma mark Device Property Operations
 
-static Boolean	VocanaVirtualDevice_HasDeviceProperty(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress)
+static OSStatus	VocanaVirtualDevice_GetDevicePropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, UInt32* outDataSize, void* outData)
 {
-	//	This method returns whether or not the given object has the given property.
-	
-	#pragma unused(inClientProcessID)
+	#pragma unused(inClientProcessID, inQualifierDataSize, inQualifierData)
 	
 	//	declare the local variables
-	Boolean theAnswer = false;
+	OSStatus theAnswer = 0;
+	UInt32 theNumberItemsToFetch;
+	UInt32 theItemIndex;
+	VocanaDeviceInstance* theInstance = NULL;
+	AudioObjectID theKind = kAudioObjectUnknown;
 	
 	//	check the arguments
-	FailIf(inDriver != gAudioServerPlugInDriverRef, Done, "VocanaVirtualDevice_HasDeviceProperty: bad driver reference");
-	FailIf(inAddress == NULL, Done, "VocanaVirtualDevice_HasDeviceProperty: no address");
-	FailIf(inObjectID != kObjectID_Device && inObjectID != kObjectID_Device2, Done, "VocanaVirtualDevice_HasDeviceProperty: not the device object");
+	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_GetDevicePropertyData: bad driver reference");
+	FailWithAction(inAddress == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_GetDevicePropertyData: no address");
+	FailWithAction(outDataSize == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_GetDevicePropertyData: no place to put the return value size");
+	FailWithAction(outData == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_GetDevicePropertyData: no place to put the return value");
+	FailWithAction(!find_device(inObjectID, &theInstance, &theKind), theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_GetDevicePropertyData: not the device object");
 	
 	//	Note that for each object, this driver implements all the required properties plus a few
-	//	extras that are useful but not required. There is more detailed commentary about each
-	//	property in the VocanaVirtualDevice_GetDevicePropertyData() method.
-	switch(inAddress->mSelector)
-	{
-		case kAudioObjectPropertyBaseClass:
-		case kAudioObjectPropertyClass:
-		case kAudioObjectPropertyOwner:
-		case kAudioObjectPropertyName:
-		case kAudioObjectPropertyManufacturer:
-		case kAudioObjectPropertyOwnedObjects:
-		case kAudioDevicePropertyDeviceUID:
-		case kAudioDevicePropertyModelUID:
-		case kAudioDevicePropertyTransportType:
-		case kAudioDevicePropertyRelatedDevices:
-		case kAudioDevicePropertyClockDomain:
-		case kAudioDevicePropertyDeviceIsAlive:
-		case kAudioDevicePropertyDeviceIsRunning:
-		case kAudioObjectPropertyControlList:
-		case kAudioDevicePropertyNominalSampleRate:
-		case kAudioDevicePropertyAvailableNominalSampleRates:
-		case kAudioDevicePropertyIsHidden:
-		case kAudioDevicePropertyZeroTimeStampPeriod:
-		case kAudioDevicePropertyIcon:
-		case kAudioDevicePropertyStreams:
-			theAnswer = true;
-			break;
-			
-		case kAudioDevicePropertyDeviceCanBeDefaultDevice:
-		case kAudioDevicePropertyDeviceCanBeDefaultSystemDevice:
-		case kAudioDevicePropertyLatency:
-		case kAudioDevicePropertySafetyOffset:
-		case kAudioDevicePropertyPreferredChannelsForStereo:
-		case kAudioDevicePropertyPreferredChannelLayout:
-			theAnswer = (inAddress->mScope == kAudioObjectPropertyScopeInput) || (inAddress->mScope == kAudioObjectPropertyScopeOutput);
-			break;
-	};
-
-Done:
-	return theAnswer;
-}
-
-static OSStatus	VocanaVirtualDevice_IsDevicePropertySettable(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, Boolean* outIsSettable)
-{
-	//	This method returns whether or not the given property on the object can have its value
-	//	changed.
-	
-	#pragma unused(inClientProcessID)
-	
-	//	declare the local variables
-	OSStatus theAnswer = 0;
-	
-	//	check the arguments
-	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_IsDevicePropertySettable: bad driver reference");
-	FailWithAction(inAddress == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_IsDevicePropertySettable: no address");
-	FailWithAction(outIsSettable == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_IsDevicePropertySettable: no place to put the return value");
-	FailWithAction(inObjectID != kObjectID_Device && inObjectID != kObjectID_Device2, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_IsDevicePropertySettable: not the device object");
-	
-	//	Note that for each object, this driver implements all the required properties plus a few
-	//	extras that are useful but not required. There is more detailed commentary about each
-	//	property in the VocanaVirtualDevice_GetDevicePropertyData() method.
-	switch(inAddress->mSelector)
-	{
-		case kAudioObjectPropertyBaseClass:
-		case kAudioObjectPropertyClass:
-		case kAudioObjectPropertyOwner:
-		case kAudioObjectPropertyName:
-		case kAudioObjectPropertyManufacturer:
-		case kAudioObjectPropertyOwnedObjects:
-		case kAudioDevicePropertyDeviceUID:
-		case kAudioDevicePropertyModelUID:
-		case kAudioDevicePropertyTransportType:
-		case kAudioDevicePropertyRelatedDevices:
-		case kAudioDevicePropertyClockDomain:
-		case kAudioDevicePropertyDeviceIsAlive:
-		case kAudioDevicePropertyDeviceIsRunning:
-		case kAudioDevicePropertyDeviceCanBeDefaultDevice:
-		case kAudioDevicePropertyDeviceCanBeDefaultSystemDevice:
-		case kAudioDevicePropertyLatency:
-		case kAudioDevicePropertyStreams:
-		case kAudioObjectPropertyControlList:
-		case kAudioDevicePropertySafetyOffset:
-		case kAudioDevicePropertyAvailableNominalSampleRates:
-		case kAudioDevicePropertyIsHidden:
-		case kAudioDevicePropertyPreferredChannelsForStereo:
-		case kAudioDevicePropertyPreferredChannelLayout:
-		case kAudioDevicePropertyZeroTimeStampPeriod:
-		case kAudioDevicePropertyIcon:
-			*outIsSettable = false;
-			break;
-		
-		case kAudioDevicePropertyNominalSampleRate:
-			*outIsSettable = true;
-			break;
-		
-		default:
-			theAnswer = kAudioHardwareUnknownPropertyError;
-			break;
-	};
-
-Done:
-	return theAnswer;
-}
-
-static OSStatus	VocanaVirtualDevice_GetDevicePropertyDataSize(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32* outDataSize)
-{
-	//	This method returns the byte size of the property's data.
-	
-	#pragma unused(inClientProcessID, inQualifierDataSize, inQualifierData)
-	
-	//	declare the local variables
-	OSStatus theAnswer = 0;
-	
-	//	check the arguments
-	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_GetDevicePropertyDataSize: bad driver reference");
-	FailWithAction(inAddress == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_GetDevicePropertyDataSize: no address");
-	FailWithAction(outDataSize == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_GetDevicePropertyDataSize: no place to put the return value");
-	FailWithAction(inObjectID != kObjectID_Device && inObjectID != kObjectID_Device2, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_GetDevicePropertyDataSize: not the device object");
-	
-	//	Note that for each object, this driver implements all the required properties plus a few
-	//	extras that are useful but not required. There is more detailed commentary about each
-	//	property in the VocanaVirtualDevice_GetDevicePropertyData() method.
-	switch(inAddress->mSelector)
-	{
-		case kAudioObjectPropertyBaseClass:
-			*outDataSize = sizeof(AudioClassID);
-			break;
-			
-		case kAudioObjectPropertyClass:
-			*outDataSize = sizeof(AudioClassID);
-			break;
-			
-		case kAudioObjectPropertyOwner:
-			*outDataSize = sizeof(AudioObjectID);
-			break;
-			
-		case kAudioObjectPropertyName:
-			*outDataSize = sizeof(CFStringRef);
-			break;
-			
-		case kAudioObjectPropertyManufacturer:
-			*outDataSize = sizeof(CFStringRef);
-			break;
-			
-		case kAudioObjectPropertyOwnedObjects:
-            *outDataSize = device_object_list_size(inAddress->mScope, inObjectID) * sizeof(AudioObjectID);
-			break;
-
-		case kAudioDevicePropertyDeviceUID:
-			*outDataSize = sizeof(CFStringRef);
-			break;
-
-		case kAudioDevicePropertyModelUID:
-			*outDataSize = sizeof(CFStringRef);
-			break;
-
-		case kAudioDevicePropertyTransportType:
-			*outDataSize = sizeof(UInt32);
-			break;
-
-		case kAudioDevicePropertyRelatedDevices:
-			*outDataSize = sizeof(AudioObjectID);
-			break;
-
-		case kAudioDevicePropertyClockDomain:
-			*outDataSize = sizeof(UInt32);
-			break;
-
-		case kAudioDevicePropertyDeviceIsAlive:
-			*outDataSize = sizeof(AudioClassID);
-			break;
-
-		case kAudioDevicePropertyDeviceIsRunning:
-			*outDataSize = sizeof(UInt32);
-			break;
-
-		case kAudioDevicePropertyDeviceCanBeDefaultDevice:
-			*outDataSize = sizeof(UInt32);
-			break;
-
-		case kAudioDevicePropertyDeviceCanBeDefaultSystemDevice:
-			*outDataSize = sizeof(UInt32);
-			break;
-
-		case kAudioDevicePropertyLatency:
-			*outDataSize = sizeof(UInt32);
-			break;
-
-		case kAudioDevicePropertyStreams:
-            *outDataSize = device_stream_list_size(inAddress->mScope, inObjectID) * sizeof(AudioObjectID);
-			break;
-
-		case kAudioObjectPropertyControlList:
-            *outDataSize = device_control_list_size(inAddress->mScope, inObjectID) * sizeof(AudioObjectID);
-			break;
-
-		case kAudioDevicePropertySafetyOffset:
-			*outDataSize = sizeof(UInt32);
-			break;
-
-		case kAudioDevicePropertyNominalSampleRate:
-			*outDataSize = sizeof(Float64);
-			break;
-
-		case kAudioDevicePropertyAvailableNominalSampleRates:
-			*outDataSize = kDevice_SampleRatesSize * sizeof(AudioValueRange);
-			break;
-		
-		case kAudioDevicePropertyIsHidden:
-			*outDataSize = sizeof(UInt32);
-			break;
-
-		case kAudioDevicePropertyPreferredChannelsForStereo:
-			*outDataSize = 2 * sizeof(UInt32);
-			break;
-
-		case kAudioDevicePropertyPreferredChannelLayout:
-			*outDataSize = offsetof(AudioChannelLayout, mChannelDescriptions) + (kNumber_Of_Channels * sizeof(AudioChannelDescription));
-			break;
-
-		case kAudioDevicePropertyZeroTimeStampPeriod:
-			*outDataSize = sizeof(UInt32);
-			break;
-
-		case kAudioDevicePropertyIcon:
-			*outDataSize = sizeof(CFURLRef);
-			break;
-
-		default:
-			theAnswer = kAudioHardwareUnknownPropertyError;
-			break;
-	};
-
-Done:
-	return theAnswer;
-}
-
-static OSStatus	VocanaVirtualDevice_GetDevicePropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, UInt32* outDataSize, void* outData)
-{
-	#pragma unused(inClientProcessID, inQualifierDataSize, inQualifierData)
-	
-	//	declare the local variables
-	OSStatus theAnswer = 0;
-	UInt32 theNumberItemsToFetch;
-	UInt32 theItemIndex;
-	
-	//	check the arguments
-	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_GetDevicePropertyData: bad driver reference");
-	FailWithAction(inAddress == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_GetDevicePropertyData: no address");
-	FailWithAction(outDataSize == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_GetDevicePropertyData: no place to put the return value size");
-	FailWithAction(outData == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_GetDevicePropertyData: no place to put the return value");
-	FailWithAction(inObjectID != kObjectID_Device && inObjectID != kObjectID_Device2, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_GetDevicePropertyData: not the device object");
-	
-	//	Note that for each object, this driver implements all the required properties plus a few
-	//	extras that are useful but not required.
-	//
-	//	Also, since most of the data that will get returned is static, there are few instances where
-	//	it is necessary to lock the state mutex.
+	//	extras that are useful but not required.
+	//
+	//	Also, since most of the data that will get returned is static, there are few instances where
+	//	it is necessary to lock the state mutex.
 	switch(inAddress->mSelector)
 	{
 		case kAudioObjectPropertyBaseClass:
@@ -2457,14 +2616,14 @@ static OSStatus	VocanaVirtualDevice_GetDevicePropertyData(AudioServerPlugInDrive
 			//	This is the human readable name of the device.
 			FailWithAction(inDataSize < sizeof(CFStringRef), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetDevicePropertyData: not enough space for the return value of kAudioObjectPropertyManufacturer for the device");
             
-            switch (inObjectID) {
+            switch (theKind) {
                 case kObjectID_Device:
-                    *((CFStringRef*)outData) = get_device_name();
+                    *((CFStringRef*)outData) = get_device_name(theInstance);
                     *outDataSize = sizeof(CFStringRef);
                     break;
                     
                 case kObjectID_Device2:
-                    *((CFStringRef*)outData) = get_device2_name();
+                    *((CFStringRef*)outData) = get_device2_name(theInstance);
                     *outDataSize = sizeof(CFStringRef);
                     break;
             }
@@ -2481,16 +2640,16 @@ static OSStatus	VocanaVirtualDevice_GetDevicePropertyData(AudioServerPlugInDrive
 			//	Calculate the number of items that have been requested. Note that this
 			//	number is allowed to be smaller than the actual size of the list. In such
 			//	case, only that number of items will be returned
-            theNumberItemsToFetch = minimum(inDataSize / sizeof(AudioObjectID), device_object_list_size(inAddress->mScope, inObjectID));
+            theNumberItemsToFetch = minimum(inDataSize / sizeof(AudioObjectID), device_object_list_size(inAddress->mScope, theKind));
 
             //    fill out the list with the right objects
-            switch (inObjectID) {
+            switch (theKind) {
                 case kObjectID_Device:
                     for (UInt32 i = 0, k = 0; k < theNumberItemsToFetch; i++)
                     {
                         if (kDevice_ObjectList[i].scope == inAddress->mScope || inAddress->mScope == kAudioObjectPropertyScopeGlobal)
                         {
-                            ((AudioObjectID*)outData)[k++] = kDevice_ObjectList[i].id;
+                            ((AudioObjectID*)outData)[k++] = object_id(theInstance, kDevice_ObjectList[i].id);
                         }
                     }
                     break;
@@ -2500,7 +2659,7 @@ static OSStatus	VocanaVirtualDevice_GetDevicePropertyData(AudioServerPlugInDrive
                     {
                         if (kDevice2_ObjectList[i].scope == inAddress->mScope || inAddress->mScope == kAudioObjectPropertyScopeGlobal)
                         {
-                            ((AudioObjectID*)outData)[k++] = kDevice2_ObjectList[i].id;
+                            ((AudioObjectID*)outData)[k++] = object_id(theInstance, kDevice2_ObjectList[i].id);
                         }
                     }
                     break;
@@ -2516,14 +2675,14 @@ static OSStatus	VocanaVirtualDevice_GetDevicePropertyData(AudioServerPlugInDrive
 			//	device must have different values for this property.
 			FailWithAction(inDataSize < sizeof(CFStringRef), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetDevicePropertyData: not enough space for the return value of kAudioDevicePropertyDeviceUID for the device");
 
-            switch (inObjectID) {
+            switch (theKind) {
                 case kObjectID_Device:
-                    *((CFStringRef*)outData) = get_device_uid();
+                    *((CFStringRef*)outData) = get_device_uid(theInstance);
                     *outDataSize = sizeof(CFStringRef);
                     break;
                     
                 case kObjectID_Device2:
-                    *((CFStringRef*)outData) = get_device2_uid();
+                    *((CFStringRef*)outData) = get_device2_uid(theInstance);
                     *outDataSize = sizeof(CFStringRef);
                     break;
             }
@@ -2564,7 +2723,7 @@ static OSStatus	VocanaVirtualDevice_GetDevicePropertyData(AudioServerPlugInDrive
 			//	case, only that number of items will be returned
 			theNumberItemsToFetch = inDataSize / sizeof(AudioObjectID);
 			
-			//	we only have the one device...
+			//	every device is only related to itself...
 			if(theNumberItemsToFetch > 1)
 			{
 				theNumberItemsToFetch = 1;
@@ -2573,16 +2732,7 @@ static OSStatus	VocanaVirtualDevice_GetDevicePropertyData(AudioServerPlugInDrive
 			//	Write the devices' object IDs into the return value
 			if(theNumberItemsToFetch > 0)
 			{
-                switch (inObjectID) {
-                    case kObjectID_Device:
-                        ((AudioObjectID*)outData)[0] = kObjectID_Device;
-                        break;
-                        
-                    case kObjectID_Device2:
-                        ((AudioObjectID*)outData)[0] = kObjectID_Device2;
-                        break;
-                }
-				
+				((AudioObjectID*)outData)[0] = inObjectID;
 			}
 			
 			//	report how much we wrote
@@ -2615,19 +2765,7 @@ static OSStatus	VocanaVirtualDevice_GetDevicePropertyData(AudioServerPlugInDrive
             //    we need to take both the state lock to check this value for thread safety.
             FailWithAction(inDataSize < sizeof(UInt32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetDevicePropertyData: not enough space for the return value of kAudioDevicePropertyDeviceIsRunning for the device");
             // Use atomic operations for real-time safety
-            switch (inObjectID) {
-                case kObjectID_Device:
-                    *((UInt32*)outData) = (atomic_load(&gDevice_IOIsRunning) > 0) ? 1 : 0;
-                    break;
-                case kObjectID_Device2:
-                    *((UInt32*)outData) = (atomic_load(&gDevice2_IOIsRunning) > 0) ? 1 : 0;
-                    break;
-                default:
-                    *((UInt32*)outData) = 0;
-                    break;
-            }
-            
-            pthread_mutex_unlock(&gPlugIn_StateMutex);
+            *((UInt32*)outData) = (atomic_load(&device_io(theInstance, theKind)->isRunning) > 0) ? 1 : 0;
             *outDataSize = sizeof(UInt32);
             break;
 
@@ -2652,10 +2790,11 @@ static OSStatus	VocanaVirtualDevice_GetDevicePropertyData(AudioServerPlugInDrive
 			break;
 
 		case kAudioDevicePropertyLatency:
-			//	This property returns the presentation latency of the device. For this,
-			//	device, the value is 0 due to the fact that it always vends silence.
+			//	This property returns the presentation latency of the device. Output goes
+			//	straight into the ring, and the input plays it back late only by the denoiser's
+			//	latency, when the devices run one.
 			FailWithAction(inDataSize < sizeof(UInt32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetDevicePropertyData: not enough space for the return value of kAudioDevicePropertyLatency for the device");
-			*((UInt32*)outData) = 0;
+			*((UInt32*)outData) = inAddress->mScope == kAudioObjectPropertyScopeInput ? device_input_latency(theInstance) : 0;
 			*outDataSize = sizeof(UInt32);
 			break;
 
@@ -2663,17 +2802,17 @@ static OSStatus	VocanaVirtualDevice_GetDevicePropertyData(AudioServerPlugInDrive
 			//	Calculate the number of items that have been requested. Note that this
 			//	number is allowed to be smaller than the actual size of the list. In such
 			//	case, only that number of items will be returned
-            theNumberItemsToFetch = minimum(inDataSize / sizeof(AudioObjectID), device_stream_list_size(inAddress->mScope, inObjectID));
+            theNumberItemsToFetch = minimum(inDataSize / sizeof(AudioObjectID), device_stream_list_size(inAddress->mScope, theKind));
 
             //    fill out the list with as many objects as requested
-            switch (inObjectID) {
+            switch (theKind) {
                 case kObjectID_Device:
                     for (UInt32 i = 0, k = 0; k < theNumberItemsToFetch; i++)
                     {
                         if ((kDevice_ObjectList[i].type == kObjectType_Stream) &&
                             (kDevice_ObjectList[i].scope == inAddress->mScope || inAddress->mScope == kAudioObjectPropertyScopeGlobal))
                         {
-                            ((AudioObjectID*)outData)[k++] = kDevice_ObjectList[i].id;
+                            ((AudioObjectID*)outData)[k++] = object_id(theInstance, kDevice_ObjectList[i].id);
                         }
                     }
                     break;
@@ -2684,7 +2823,7 @@ static OSStatus	VocanaVirtualDevice_GetDevicePropertyData(AudioServerPlugInDrive
                         if ((kDevice2_ObjectList[i].type == kObjectType_Stream) &&
                             (kDevice2_ObjectList[i].scope == inAddress->mScope || inAddress->mScope == kAudioObjectPropertyScopeGlobal))
                         {
-                            ((AudioObjectID*)outData)[k++] = kDevice2_ObjectList[i].id;
+                            ((AudioObjectID*)outData)[k++] = object_id(theInstance, kDevice2_ObjectList[i].id);
                         }
                     }
                     break;
@@ -2699,29 +2838,27 @@ static OSStatus	VocanaVirtualDevice_GetDevicePropertyData(AudioServerPlugInDrive
 			//	number is allowed to be smaller than the actual size of the list. In such
 			//	case, only that number of items will be returned
 
-            theNumberItemsToFetch = minimum(inDataSize / sizeof(AudioObjectID), device_control_list_size(inAddress->mScope, inObjectID));
+            theNumberItemsToFetch = minimum(inDataSize / sizeof(AudioObjectID), device_control_list_size(inAddress->mScope, theKind));
 
             //    fill out the list with as many objects as requested
-            switch (inObjectID) {
+            switch (theKind) {
                 case kObjectID_Device:
-                    pthread_mutex_lock(&gPlugIn_StateMutex);
                     for (UInt32 i = 0, k = 0; k < theNumberItemsToFetch; i++)
                     {
                         // TODO remove hack! There must be a better way than looking for a fixed i
-                        if ((kDevice_ObjectList[i].type == kObjectType_Control) && !(!gPitch_Adjust_Enabled && kDevice_ObjectList[i].id==kObjectID_Pitch_Adjust))
+                        if ((kDevice_ObjectList[i].type == kObjectType_Control) && !(!device_state(theInstance).isPitchAdjustEnabled && kDevice_ObjectList[i].id==kObjectID_Pitch_Adjust))
                         {
-                            ((AudioObjectID*)outData)[k++] = kDevice_ObjectList[i].id;
+                            ((AudioObjectID*)outData)[k++] = object_id(theInstance, kDevice_ObjectList[i].id);
                         }
                     }
-                    pthread_mutex_unlock(&gPlugIn_StateMutex);
                     break;
 
                 case kObjectID_Device2:
                     for (UInt32 i = 0, k = 0; k < theNumberItemsToFetch; i++)
                     {
-                        if ((kDevice2_ObjectList[i].type == kObjectType_Control) && !(!gPitch_Adjust_Enabled && kDevice2_ObjectList[i].id==kObjectID_Pitch_Adjust))
+                        if ((kDevice2_ObjectList[i].type == kObjectType_Control) && !(!device_state(theInstance).isPitchAdjustEnabled && kDevice2_ObjectList[i].id==kObjectID_Pitch_Adjust))
                         {
-                            ((AudioObjectID*)outData)[k++] = kDevice2_ObjectList[i].id;
+                            ((AudioObjectID*)outData)[k++] = object_id(theInstance, kDevice2_ObjectList[i].id);
                         }
                     }
                     break;
@@ -2740,12 +2877,10 @@ static OSStatus	VocanaVirtualDevice_GetDevicePropertyData(AudioServerPlugInDrive
 			break;
 
 		case kAudioDevicePropertyNominalSampleRate:
-			//	This property returns the nominal sample rate of the device. Note that we
-			//	only need to take the state lock to get this value.
+			//	This property returns the nominal sample rate of the device. It comes from the
+			//	published state snapshot, so no lock is needed.
 			FailWithAction(inDataSize < sizeof(Float64), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetDevicePropertyData: not enough space for the return value of kAudioDevicePropertyNominalSampleRate for the device");
-			pthread_mutex_lock(&gPlugIn_StateMutex);
-			*((Float64*)outData) = gDevice_SampleRate;
-			pthread_mutex_unlock(&gPlugIn_StateMutex);
+			*((Float64*)outData) = device_state(theInstance).sampleRate;
 			*outDataSize = sizeof(Float64);
 			break;
 
@@ -2780,7 +2915,7 @@ static OSStatus	VocanaVirtualDevice_GetDevicePropertyData(AudioServerPlugInDrive
 			//	This returns whether or not the device is visible to clients.
 			FailWithAction(inDataSize < sizeof(UInt32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetDevicePropertyData: not enough space for the return value of kAudioDevicePropertyIsHidden for the device");
             
-            switch (inObjectID) {
+            switch (theKind) {
                 case kObjectID_Device:
                     *((UInt32*)outData) = kDevice_IsHidden;
                     break;
@@ -2797,21 +2932,22 @@ static OSStatus	VocanaVirtualDevice_GetDevicePropertyData(AudioServerPlugInDrive
 			//	data by default. Note that the channel numbers are 1-based.xz
 			FailWithAction(inDataSize < (2 * sizeof(UInt32)), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetDevicePropertyData: not enough space for the return value of kAudioDevicePropertyPreferredChannelsForStereo for the device");
 			((UInt32*)outData)[0] = 1;
-			((UInt32*)outData)[1] = 2;
+			((UInt32*)outData)[1] = device_state(theInstance).channelCount > 1 ? 2 : 1;
 			*outDataSize = 2 * sizeof(UInt32);
 			break;
 
 		case kAudioDevicePropertyPreferredChannelLayout:
 			//	This property returns the default AudioChannelLayout to use for the device
-			//	by default. For this device, we return a stereo ACL.
+			//	by default. For this device, we return an ACL with one description per channel.
 			{
 				//	calculate how big the
-				UInt32 theACLSize = offsetof(AudioChannelLayout, mChannelDescriptions) + (kNumber_Of_Channels * sizeof(AudioChannelDescription));
+				UInt32 theChannelCount = device_state(theInstance).channelCount;
+				UInt32 theACLSize = offsetof(AudioChannelLayout, mChannelDescriptions) + (theChannelCount * sizeof(AudioChannelDescription));
 				FailWithAction(inDataSize < theACLSize, theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetDevicePropertyData: not enough space for the return value of kAudioDevicePropertyPreferredChannelLayout for the device");
 				((AudioChannelLayout*)outData)->mChannelLayoutTag = kAudioChannelLayoutTag_UseChannelDescriptions;
 				((AudioChannelLayout*)outData)->mChannelBitmap = 0;
-				((AudioChannelLayout*)outData)->mNumberChannelDescriptions = kNumber_Of_Channels;
-				for(theItemIndex = 0; theItemIndex < kNumber_Of_Channels; ++theItemIndex)
+				((AudioChannelLayout*)outData)->mNumberChannelDescriptions = theChannelCount;
+				for(theItemIndex = 0; theItemIndex < theChannelCount; ++theItemIndex)
 				{
 					((AudioChannelLayout*)outData)->mChannelDescriptions[theItemIndex].mChannelLabel = kAudioChannelLabel_Left + theItemIndex;
 					((AudioChannelLayout*)outData)->mChannelDescriptions[theItemIndex].mChannelFlags = 0;
@@ -2843,30 +2979,86 @@ static OSStatus	VocanaVirtualDevice_GetDevicePropertyData(AudioServerPlugInDrive
 				*outDataSize = sizeof(CFURLRef);
 			}
 			break;
-			
-		default:
-			theAnswer = kAudioHardwareUnknownPropertyError;
-			break;
-	};
 
-Done:
-	return theAnswer;
-}
+		case kAudioObjectPropertyCustomPropertyInfoList:
+			//	This property tells the HAL about the device's custom properties and the type of their
+			//	data, so that it can move them between processes.
+			theNumberItemsToFetch = inDataSize / sizeof(AudioServerPlugInCustomPropertyInfo);
+			if(theNumberItemsToFetch > kDevice_CustomPropertyListSize)
+			{
+				theNumberItemsToFetch = kDevice_CustomPropertyListSize;
+			}
+			for(theItemIndex = 0; theItemIndex < theNumberItemsToFetch; ++theItemIndex)
+			{
+				((AudioServerPlugInCustomPropertyInfo*)outData)[theItemIndex].mSelector = kDevice_CustomPropertyList[theItemIndex];
+				((AudioServerPlugInCustomPropertyInfo*)outData)[theItemIndex].mPropertyDataType = kAudioServerPlugInCustomPropertyDataTypeCFPropertyList;
+				((AudioServerPlugInCustomPropertyInfo*)outData)[theItemIndex].mQualifierDataType = kAudioServerPlugInCustomPropertyDataTypeNone;
+			}
+			*outDataSize = theNumberItemsToFetch * sizeof(AudioServerPlugInCustomPropertyInfo);
+			break;
 
-static OSStatus	VocanaVirtualDevice_SetDevicePropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, const void* inData, UInt32* outNumberPropertiesChanged, AudioObjectPropertyAddress outChangedAddresses[2])
+		case kVocanaDevicePropertyClockReference:
+			{
+				//	This is a CFData with the loop's filtered position of the reference clock, or
+				//	an empty one if it has no reference.
+				FailWithAction(inDataSize < sizeof(CFPropertyListRef), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetDevicePropertyData: not enough space for the return value of kVocanaDevicePropertyClockReference for the device");
+				VocanaClockReference theReference;
+				pthread_mutex_lock(&gPlugIn_StateMutex);
+				bool hasReference = VocanaClock_GetReference(&theInstance->clock, &theReference);
+				pthread_mutex_unlock(&gPlugIn_StateMutex);
+				*((CFPropertyListRef*)outData) = CFDataCreate(NULL, (const UInt8*)&theReference, hasReference ? sizeof(VocanaClockReference) : 0);
+				*outDataSize = sizeof(CFPropertyListRef);
+			}
+			break;
+
+		case kVocanaDevicePropertyClockStatistics:
+			{
+				//	This is a CFData with the device clock's VocanaClockStatistics.
+				FailWithAction(inDataSize < sizeof(CFPropertyListRef), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetDevicePropertyData: not enough space for the return value of kVocanaDevicePropertyClockStatistics for the device");
+				VocanaClockStatistics theStatistics;
+				pthread_mutex_lock(&gPlugIn_StateMutex);
+				VocanaClock_GetStatistics(&theInstance->clock, &theStatistics);
+				pthread_mutex_unlock(&gPlugIn_StateMutex);
+				*((CFPropertyListRef*)outData) = CFDataCreate(NULL, (const UInt8*)&theStatistics, sizeof(VocanaClockStatistics));
+				*outDataSize = sizeof(CFPropertyListRef);
+			}
+			break;
+
+		case kVocanaDevicePropertyChannelCount:
+			{
+				//	This is a CFNumber with the number of channels of both streams.
+				FailWithAction(inDataSize < sizeof(CFPropertyListRef), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetDevicePropertyData: not enough space for the return value of kVocanaDevicePropertyChannelCount for the device");
+				SInt32 theChannelCount = (SInt32)device_state(theInstance).channelCount;
+				*((CFPropertyListRef*)outData) = CFNumberCreate(NULL, kCFNumberSInt32Type, &theChannelCount);
+				*outDataSize = sizeof(CFPropertyListRef);
+			}
+			break;
+
+		default:
+			theAnswer = kAudioHardwareUnknownPropertyError;
+			break;
+	};
+
+Done:
+	return theAnswer;
+}
+
+static OSStatus	VocanaVirtualDevice_SetDevicePropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, const void* inData, UInt32* outNumberPropertiesChanged, AudioObjectPropertyAddress outChangedAddresses[2])
 {
 	#pragma unused(inClientProcessID, inQualifierDataSize, inQualifierData)
 	
 	//	declare the local variables
 	OSStatus theAnswer = 0;
 	Float64 theOldSampleRate;
+	VocanaDeviceInstance* theInstance = NULL;
+	AudioObjectID theKind = kAudioObjectUnknown;
 	
 	//	check the arguments
 	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_SetDevicePropertyData: bad driver reference");
 	FailWithAction(inAddress == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_SetDevicePropertyData: no address");
 	FailWithAction(outNumberPropertiesChanged == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_SetDevicePropertyData: no place to return the number of properties that changed");
 	FailWithAction(outChangedAddresses == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_SetDevicePropertyData: no place to return the properties that changed");
-	FailWithAction(inObjectID != kObjectID_Device && inObjectID != kObjectID_Device2, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_SetDevicePropertyData: not the device object");
+	FailWithAction(!find_device(inObjectID, &theInstance, &theKind), theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_SetDevicePropertyData: not the device object");
 	
 	//	initialize the returned number of changed properties
 	*outNumberPropertiesChanged = 0;
@@ -2886,180 +3078,64 @@ static OSStatus	VocanaVirtualDevice_SetDevicePropertyData(AudioServerPlugInDrive
 			
 			//	make sure that the new value is different than the old value
 			pthread_mutex_lock(&gPlugIn_StateMutex);
-			theOldSampleRate = gDevice_SampleRate;
-			gDevice_RequestedSampleRate = *((const Float64*)inData);
+			theOldSampleRate = device_state(theInstance).sampleRate;
+			theInstance->requestedSampleRate = *((const Float64*)inData);
 			pthread_mutex_unlock(&gPlugIn_StateMutex);
 			if(*((const Float64*)inData) != theOldSampleRate)
 			{
 				//	we dispatch this so that the change can happen asynchronously
-				dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{ gPlugIn_Host->RequestDeviceConfigurationChange(gPlugIn_Host, kObjectID_Device, ChangeAction_SetSampleRate, NULL); });
+				dispatch_async_f(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), change_request(theInstance, ChangeAction_SetSampleRate), request_device_configuration_change);
 			}
 			break;
-		
-		default:
-			theAnswer = kAudioHardwareUnknownPropertyError;
-			break;
-	};
-
-Done:
-	return theAnswer;
-}
-
-#pragma mark Stream Property Operations
-
-static Boolean	VocanaVirtualDevice_HasStreamProperty(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress)
-{
-	//	This method returns whether or not the given object has the given property.
-	
-	#pragma unused(inClientProcessID)
-	
-	//	declare the local variables
-	Boolean theAnswer = false;
-	
-	//	check the arguments
-	FailIf(inDriver != gAudioServerPlugInDriverRef, Done, "VocanaVirtualDevice_HasStreamProperty: bad driver reference");
-	FailIf(inAddress == NULL, Done, "VocanaVirtualDevice_HasStreamProperty: no address");
-	FailIf((inObjectID != kObjectID_Stream_Input) && (inObjectID != kObjectID_Stream_Output), Done, "VocanaVirtualDevice_HasStreamProperty: not a stream object");
-	
-	//	Note that for each object, this driver implements all the required properties plus a few
-	//	extras that are useful but not required. There is more detailed commentary about each
-	//	property in the VocanaVirtualDevice_GetStreamPropertyData() method.
-	switch(inAddress->mSelector)
-	{
-		case kAudioObjectPropertyBaseClass:
-		case kAudioObjectPropertyClass:
-		case kAudioObjectPropertyOwner:
-		case kAudioObjectPropertyOwnedObjects:
-		case kAudioStreamPropertyIsActive:
-		case kAudioStreamPropertyDirection:
-		case kAudioStreamPropertyTerminalType:
-		case kAudioStreamPropertyStartingChannel:
-		case kAudioStreamPropertyLatency:
-		case kAudioStreamPropertyVirtualFormat:
-		case kAudioStreamPropertyPhysicalFormat:
-		case kAudioStreamPropertyAvailableVirtualFormats:
-		case kAudioStreamPropertyAvailablePhysicalFormats:
-			theAnswer = true;
-			break;
-	};
-
-Done:
-	return theAnswer;
-}
-
-static OSStatus	VocanaVirtualDevice_IsStreamPropertySettable(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, Boolean* outIsSettable)
-{
-	//	This method returns whether or not the given property on the object can have its value
-	//	changed.
-	
-	#pragma unused(inClientProcessID)
-	
-	//	declare the local variables
-	OSStatus theAnswer = 0;
-	
-	//	check the arguments
-	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_IsStreamPropertySettable: bad driver reference");
-	FailWithAction(inAddress == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_IsStreamPropertySettable: no address");
-	FailWithAction(outIsSettable == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_IsStreamPropertySettable: no place to put the return value");
-	FailWithAction((inObjectID != kObjectID_Stream_Input) && (inObjectID != kObjectID_Stream_Output), theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_IsStreamPropertySettable: not a stream object");
-	
-	//	Note that for each object, this driver implements all the required properties plus a few
-	//	extras that are useful but not required. There is more detailed commentary about each
-	//	property in the VocanaVirtualDevice_GetStreamPropertyData() method.
-	switch(inAddress->mSelector)
-	{
-		case kAudioObjectPropertyBaseClass:
-		case kAudioObjectPropertyClass:
-		case kAudioObjectPropertyOwner:
-		case kAudioObjectPropertyOwnedObjects:
-		case kAudioStreamPropertyDirection:
-		case kAudioStreamPropertyTerminalType:
-		case kAudioStreamPropertyStartingChannel:
-		case kAudioStreamPropertyLatency:
-		case kAudioStreamPropertyAvailableVirtualFormats:
-		case kAudioStreamPropertyAvailablePhysicalFormats:
-			*outIsSettable = false;
-			break;
-		
-		case kAudioStreamPropertyIsActive:
-		case kAudioStreamPropertyVirtualFormat:
-		case kAudioStreamPropertyPhysicalFormat:
-			*outIsSettable = true;
-			break;
-		
-		default:
-			theAnswer = kAudioHardwareUnknownPropertyError;
-			break;
-	};
-
-Done:
-	return theAnswer;
-}
-
-static OSStatus	VocanaVirtualDevice_GetStreamPropertyDataSize(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32* outDataSize)
-{
-	//	This method returns the byte size of the property's data.
-	
-	#pragma unused(inClientProcessID, inQualifierDataSize, inQualifierData)
-	
-	//	declare the local variables
-	OSStatus theAnswer = 0;
-	
-	//	check the arguments
-	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_GetStreamPropertyDataSize: bad driver reference");
-	FailWithAction(inAddress == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_GetStreamPropertyDataSize: no address");
-	FailWithAction(outDataSize == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_GetStreamPropertyDataSize: no place to put the return value");
-	FailWithAction((inObjectID != kObjectID_Stream_Input) && (inObjectID != kObjectID_Stream_Output), theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_GetStreamPropertyDataSize: not a stream object");
-	
-	//	Note that for each object, this driver implements all the required properties plus a few
-	//	extras that are useful but not required. There is more detailed commentary about each
-	//	property in the VocanaVirtualDevice_GetStreamPropertyData() method.
-	switch(inAddress->mSelector)
-	{
-		case kAudioObjectPropertyBaseClass:
-			*outDataSize = sizeof(AudioClassID);
-			break;
-
-		case kAudioObjectPropertyClass:
-			*outDataSize = sizeof(AudioClassID);
-			break;
-
-		case kAudioObjectPropertyOwner:
-			*outDataSize = sizeof(AudioObjectID);
-			break;
-
-		case kAudioObjectPropertyOwnedObjects:
-			*outDataSize = 0 * sizeof(AudioObjectID);
-			break;
-
-		case kAudioStreamPropertyIsActive:
-			*outDataSize = sizeof(UInt32);
-			break;
-
-		case kAudioStreamPropertyDirection:
-			*outDataSize = sizeof(UInt32);
-			break;
-
-		case kAudioStreamPropertyTerminalType:
-			*outDataSize = sizeof(UInt32);
-			break;
 
-		case kAudioStreamPropertyStartingChannel:
-			*outDataSize = sizeof(UInt32);
-			break;
-		
-		case kAudioStreamPropertyLatency:
-			*outDataSize = sizeof(UInt32);
+		case kVocanaDevicePropertyClockReference:
+			{
+				//	The references train the loop whatever the clock source; only the adjustable
+				//	clock source makes the zero time stamps follow it.
+				FailWithAction(inDataSize != sizeof(CFPropertyListRef), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_SetDevicePropertyData: wrong size for the data for kVocanaDevicePropertyClockReference");
+				CFDataRef theData = *((const CFDataRef*)inData);
+				FailWithAction(theData == NULL || CFGetTypeID(theData) != CFDataGetTypeID(), theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_SetDevicePropertyData: kVocanaDevicePropertyClockReference is not a CFData");
+				CFIndex theLength = CFDataGetLength(theData);
+				FailWithAction(theLength <= 0 || theLength % sizeof(VocanaClockReference) != 0, theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_SetDevicePropertyData: kVocanaDevicePropertyClockReference is not a whole number of references");
+
+				//	the bytes of a CFData carry no alignment guarantee
+				const UInt8* theBytes = CFDataGetBytePtr(theData);
+				pthread_mutex_lock(&gPlugIn_StateMutex);
+				for(CFIndex theOffset = 0; theOffset < theLength; theOffset += sizeof(VocanaClockReference))
+				{
+					VocanaClockReference theReference;
+					memcpy(&theReference, theBytes + theOffset, sizeof(VocanaClockReference));
+					if(!VocanaClock_AddReference(&theInstance->clock, &theReference))
+					{
+						DebugMsg("VocanaVirtualDevice: clock reference discontinuity at sample time %f", theReference.sampleTime);
+					}
+				}
+				pthread_mutex_unlock(&gPlugIn_StateMutex);
+			}
 			break;
 
-		case kAudioStreamPropertyVirtualFormat:
-		case kAudioStreamPropertyPhysicalFormat:
-			*outDataSize = sizeof(AudioStreamBasicDescription);
-			break;
+		case kVocanaDevicePropertyChannelCount:
+			{
+				//	Like the sample rate, the channel count changes through the
+				//	RequestConfigChange/PerformConfigChange machinery. It is also kept so the
+				//	device comes back with it the next time the plug-in loads.
+				FailWithAction(inDataSize != sizeof(CFPropertyListRef), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_SetDevicePropertyData: wrong size for the data for kVocanaDevicePropertyChannelCount");
+				CFPropertyListRef theNumber = *((const CFPropertyListRef*)inData);
+				UInt32 theNewChannelCount = 0;
+				FailWithAction(!channel_count_from_number(theNumber, &theNewChannelCount), theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_SetDevicePropertyData: unsupported value for kVocanaDevicePropertyChannelCount");
+				CFStringRef theKey = copy_storage_key(kChannelCount_StorageKey, theInstance);
+				gPlugIn_Host->WriteToStorage(gPlugIn_Host, theKey, theNumber);
+				CFRelease(theKey);
 
-		case kAudioStreamPropertyAvailableVirtualFormats:
-		case kAudioStreamPropertyAvailablePhysicalFormats:
-			*outDataSize = kDevice_SampleRatesSize * sizeof(AudioStreamRangedDescription);
+				pthread_mutex_lock(&gPlugIn_StateMutex);
+				UInt32 theOldChannelCount = device_state(theInstance).channelCount;
+				theInstance->requestedChannelCount = theNewChannelCount;
+				pthread_mutex_unlock(&gPlugIn_StateMutex);
+				if(theNewChannelCount != theOldChannelCount)
+				{
+					dispatch_async_f(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), change_request(theInstance, ChangeAction_SetChannelCount), request_device_configuration_change);
+				}
+			}
 			break;
 
 		default:
@@ -3071,6 +3147,8 @@ Done:
 	return theAnswer;
 }
 
+#pragma mark Stream Property Operations
+
 static OSStatus	VocanaVirtualDevice_GetStreamPropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, UInt32* outDataSize, void* outData)
 {
 	#pragma unused(inClientProcessID, inQualifierDataSize, inQualifierData)
@@ -3078,13 +3156,17 @@ static OSStatus	VocanaVirtualDevice_GetStreamPropertyData(AudioServerPlugInDrive
 	//	declare the local variables
 	OSStatus theAnswer = 0;
 	UInt32 theNumberItemsToFetch;
+	VocanaDeviceStateValues theState;
+	VocanaDeviceInstance* theInstance = NULL;
+	AudioObjectID theKind = kAudioObjectUnknown;
 	
 	//	check the arguments
 	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_GetStreamPropertyData: bad driver reference");
 	FailWithAction(inAddress == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_GetStreamPropertyData: no address");
 	FailWithAction(outDataSize == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_GetStreamPropertyData: no place to put the return value size");
 	FailWithAction(outData == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_GetStreamPropertyData: no place to put the return value");
-	FailWithAction((inObjectID != kObjectID_Stream_Input) && (inObjectID != kObjectID_Stream_Output), theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_GetStreamPropertyData: not a stream object");
+	theKind = object_kind(inObjectID, &theInstance);
+	FailWithAction((theKind != kObjectID_Stream_Input) && (theKind != kObjectID_Stream_Output), theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_GetStreamPropertyData: not a stream object");
 	
 	//	Note that for each object, this driver implements all the required properties plus a few
 	//	extras that are useful but not required.
@@ -3110,7 +3192,7 @@ static OSStatus	VocanaVirtualDevice_GetStreamPropertyData(AudioServerPlugInDrive
 		case kAudioObjectPropertyOwner:
 			//	The stream's owner is the device object
 			FailWithAction(inDataSize < sizeof(AudioObjectID), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetStreamPropertyData: not enough space for the return value of kAudioObjectPropertyOwner for the stream");
-			*((AudioObjectID*)outData) = kObjectID_Device;
+			*((AudioObjectID*)outData) = object_id(theInstance, kObjectID_Device);
 			*outDataSize = sizeof(AudioObjectID);
 			break;
 			
@@ -3121,19 +3203,19 @@ static OSStatus	VocanaVirtualDevice_GetStreamPropertyData(AudioServerPlugInDrive
 
 		case kAudioStreamPropertyIsActive:
 			//	This property tells the device whether or not the given stream is going to
-			//	be used for IO. Note that we need to take the state lock to examine this
-			//	value.
+			//	be used for IO. It comes from the published state snapshot.
 			FailWithAction(inDataSize < sizeof(UInt32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetStreamPropertyData: not enough space for the return value of kAudioStreamPropertyIsActive for the stream");
-			pthread_mutex_lock(&gPlugIn_StateMutex);
-			*((UInt32*)outData) = (inObjectID == kObjectID_Stream_Input) ? gStream_Input_IsActive : gStream_Output_IsActive;
-			pthread_mutex_unlock(&gPlugIn_StateMutex);
+			{
+				theState = device_state(theInstance);
+				*((UInt32*)outData) = (theKind == kObjectID_Stream_Input) ? theState.isInputActive : theState.isOutputActive;
+			}
 			*outDataSize = sizeof(UInt32);
 			break;
 
 		case kAudioStreamPropertyDirection:
 			//	This returns whether the stream is an input stream or an output stream.
 			FailWithAction(inDataSize < sizeof(UInt32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetStreamPropertyData: not enough space for the return value of kAudioStreamPropertyDirection for the stream");
-			*((UInt32*)outData) = (inObjectID == kObjectID_Stream_Input) ? 1 : 0;
+			*((UInt32*)outData) = (theKind == kObjectID_Stream_Input) ? 1 : 0;
 			*outDataSize = sizeof(UInt32);
 			break;
 
@@ -3142,7 +3224,7 @@ static OSStatus	VocanaVirtualDevice_GetStreamPropertyData(AudioServerPlugInDrive
 			//	such as a speaker or headphones, or a microphone. Values for this property
 			//	are defined in <CoreAudio/AudioHardwareBase.h>
 			FailWithAction(inDataSize < sizeof(UInt32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetStreamPropertyData: not enough space for the return value of kAudioStreamPropertyTerminalType for the stream");
-			*((UInt32*)outData) = (inObjectID == kObjectID_Stream_Input) ? kAudioStreamTerminalTypeMicrophone : kAudioStreamTerminalTypeSpeaker;
+			*((UInt32*)outData) = (theKind == kObjectID_Stream_Input) ? kAudioStreamTerminalTypeMicrophone : kAudioStreamTerminalTypeSpeaker;
 			*outDataSize = sizeof(UInt32);
 			break;
 
@@ -3151,575 +3233,176 @@ static OSStatus	VocanaVirtualDevice_GetStreamPropertyData(AudioServerPlugInDrive
 			//	the stream. For example, if a device has two output streams with two
 			//	channels each, then the starting channel number for the first stream is 1
 			//	and the starting channel number fo the second stream is 3.
-			FailWithAction(inDataSize < sizeof(UInt32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetStreamPropertyData: not enough space for the return value of kAudioStreamPropertyStartingChannel for the stream");
-			*((UInt32*)outData) = 1;
-			*outDataSize = sizeof(UInt32);
-			break;
-
-		case kAudioStreamPropertyLatency:
-			//	This property returns any additional presentation latency the stream has.
-			FailWithAction(inDataSize < sizeof(UInt32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetStreamPropertyData: not enough space for the return value of kAudioStreamPropertyStartingChannel for the stream");
-			*((UInt32*)outData) = kLatency_Frame_Size;
-			*outDataSize = sizeof(UInt32);
-			break;
-
-		case kAudioStreamPropertyVirtualFormat:
-		case kAudioStreamPropertyPhysicalFormat:
-			//	This returns the current format of the stream in an
-			//	AudioStreamBasicDescription. Note that we need to hold the state lock to get
-			//	this value.
-			//	Note that for devices that don't override the mix operation, the virtual
-			//	format has to be the same as the physical format.
-			FailWithAction(inDataSize < sizeof(AudioStreamBasicDescription), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetStreamPropertyData: not enough space for the return value of kAudioStreamPropertyVirtualFormat for the stream");
-			pthread_mutex_lock(&gPlugIn_StateMutex);
-            ((AudioStreamBasicDescription*)outData)->mSampleRate = gDevice_SampleRate;
-            ((AudioStreamBasicDescription*)outData)->mFormatID = kAudioFormatLinearPCM;
-            ((AudioStreamBasicDescription*)outData)->mFormatFlags = kAudioFormatFlagIsFloat | kAudioFormatFlagsNativeEndian | kAudioFormatFlagIsPacked;
-            ((AudioStreamBasicDescription*)outData)->mBytesPerPacket = kBytes_Per_Channel * kNumber_Of_Channels;
-            ((AudioStreamBasicDescription*)outData)->mFramesPerPacket = 1;
-            ((AudioStreamBasicDescription*)outData)->mBytesPerFrame = kBytes_Per_Channel * kNumber_Of_Channels;
-            ((AudioStreamBasicDescription*)outData)->mChannelsPerFrame = kNumber_Of_Channels;
-            ((AudioStreamBasicDescription*)outData)->mBitsPerChannel = kBits_Per_Channel;
-			pthread_mutex_unlock(&gPlugIn_StateMutex);
-			*outDataSize = sizeof(AudioStreamBasicDescription);
-			break;
-
-		case kAudioStreamPropertyAvailableVirtualFormats:
-		case kAudioStreamPropertyAvailablePhysicalFormats:
-			//	This returns an array of AudioStreamRangedDescriptions that describe what
-			//	formats are supported.
-
-			//	Calculate the number of items that have been requested. Note that this
-			//	number is allowed to be smaller than the actual size of the list. In such
-			//	case, only that number of items will be returned
-			theNumberItemsToFetch = inDataSize / sizeof(AudioStreamRangedDescription);
-			
-			//	clamp it to the number of items we have
-			if(theNumberItemsToFetch > kDevice_SampleRatesSize)
-			{
-				theNumberItemsToFetch = kDevice_SampleRatesSize;
-			}
-
-            //	fill out the return array
-            for(UInt32 i = 0; i < theNumberItemsToFetch; i++)
-            {
-                ((AudioStreamRangedDescription*)outData)[i].mFormat.mSampleRate = kDevice_SampleRates[i];
-                ((AudioStreamRangedDescription*)outData)[i].mFormat.mFormatID = kAudioFormatLinearPCM;
-                ((AudioStreamRangedDescription*)outData)[i].mFormat.mFormatFlags = kAudioFormatFlagIsFloat | kAudioFormatFlagsNativeEndian | kAudioFormatFlagIsPacked;
-                ((AudioStreamRangedDescription*)outData)[i].mFormat.mBytesPerPacket = kBytes_Per_Frame;
-                ((AudioStreamRangedDescription*)outData)[i].mFormat.mFramesPerPacket = 1;
-                ((AudioStreamRangedDescription*)outData)[i].mFormat.mBytesPerFrame = kBytes_Per_Frame;
-                ((AudioStreamRangedDescription*)outData)[i].mFormat.mChannelsPerFrame = kNumber_Of_Channels;
-                ((AudioStreamRangedDescription*)outData)[i].mFormat.mBitsPerChannel = kBits_Per_Channel;
-                ((AudioStreamRangedDescription*)outData)[i].mSampleRateRange.mMinimum = kDevice_SampleRates[i];
-                ((AudioStreamRangedDescription*)outData)[i].mSampleRateRange.mMaximum = kDevice_SampleRates[i];
-            }
-
-			//	report how much we wrote
-			*outDataSize = theNumberItemsToFetch * sizeof(AudioStreamRangedDescription);
-			break;
-
-		default:
-			theAnswer = kAudioHardwareUnknownPropertyError;
-			break;
-	};
-
-Done:
-	return theAnswer;
-}
-
-static OSStatus	VocanaVirtualDevice_SetStreamPropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, const void* inData, UInt32* outNumberPropertiesChanged, AudioObjectPropertyAddress outChangedAddresses[2])
-{
-	#pragma unused(inClientProcessID, inQualifierDataSize, inQualifierData)
-	
-	//	declare the local variables
-	OSStatus theAnswer = 0;
-	Float64 theOldSampleRate;
-	
-	//	check the arguments
-	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_SetStreamPropertyData: bad driver reference");
-	FailWithAction(inAddress == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_SetStreamPropertyData: no address");
-	FailWithAction(outNumberPropertiesChanged == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_SetStreamPropertyData: no place to return the number of properties that changed");
-	FailWithAction(outChangedAddresses == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_SetStreamPropertyData: no place to return the properties that changed");
-	FailWithAction((inObjectID != kObjectID_Stream_Input) && (inObjectID != kObjectID_Stream_Output), theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_SetStreamPropertyData: not a stream object");
-	
-	//	initialize the returned number of changed properties
-	*outNumberPropertiesChanged = 0;
-	
-	//	Note that for each object, this driver implements all the required properties plus a few
-	//	extras that are useful but not required. There is more detailed commentary about each
-	//	property in the VocanaVirtualDevice_GetStreamPropertyData() method.
-	switch(inAddress->mSelector)
-	{
-		case kAudioStreamPropertyIsActive:
-			//	Changing the active state of a stream doesn't affect IO or change the structure
-			//	so we can just save the state and send the notification.
-			FailWithAction(inDataSize != sizeof(UInt32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_SetStreamPropertyData: wrong size for the data for kAudioDevicePropertyNominalSampleRate");
-			pthread_mutex_lock(&gPlugIn_StateMutex);
-			if(inObjectID == kObjectID_Stream_Input)
-			{
-				if(gStream_Input_IsActive != (*((const UInt32*)inData) != 0))
-				{
-					gStream_Input_IsActive = *((const UInt32*)inData) != 0;
-					*outNumberPropertiesChanged = 1;
-					outChangedAddresses[0].mSelector = kAudioStreamPropertyIsActive;
-					outChangedAddresses[0].mScope = kAudioObjectPropertyScopeGlobal;
-					outChangedAddresses[0].mElement = kAudioObjectPropertyElementMain;
-				}
-			}
-			else
-			{
-				if(gStream_Output_IsActive != (*((const UInt32*)inData) != 0))
-				{
-					gStream_Output_IsActive = *((const UInt32*)inData) != 0;
-					*outNumberPropertiesChanged = 1;
-					outChangedAddresses[0].mSelector = kAudioStreamPropertyIsActive;
-					outChangedAddresses[0].mScope = kAudioObjectPropertyScopeGlobal;
-					outChangedAddresses[0].mElement = kAudioObjectPropertyElementMain;
-				}
-			}
-			pthread_mutex_unlock(&gPlugIn_StateMutex);
-			break;
-			
-		case kAudioStreamPropertyVirtualFormat:
-		case kAudioStreamPropertyPhysicalFormat:
-			//	Changing the stream format needs to be handled via the
-			//	RequestConfigChange/PerformConfigChange machinery. Note that because this
-			//	device only supports 2 channel 32 bit float data, the only thing that can
-			//	change is the sample rate.
-			FailWithAction(inDataSize != sizeof(AudioStreamBasicDescription), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_SetStreamPropertyData: wrong size for the data for kAudioStreamPropertyPhysicalFormat");
-			FailWithAction(((const AudioStreamBasicDescription*)inData)->mFormatID != kAudioFormatLinearPCM, theAnswer = kAudioDeviceUnsupportedFormatError, Done, "VocanaVirtualDevice_SetStreamPropertyData: unsupported format ID for kAudioStreamPropertyPhysicalFormat");
-			FailWithAction(((const AudioStreamBasicDescription*)inData)->mFormatFlags != (kAudioFormatFlagIsFloat | kAudioFormatFlagsNativeEndian | kAudioFormatFlagIsPacked), theAnswer = kAudioDeviceUnsupportedFormatError, Done, "VocanaVirtualDevice_SetStreamPropertyData: unsupported format flags for kAudioStreamPropertyPhysicalFormat");
-			FailWithAction(((const AudioStreamBasicDescription*)inData)->mBytesPerPacket != kBytes_Per_Frame, theAnswer = kAudioDeviceUnsupportedFormatError, Done, "VocanaVirtualDevice_SetStreamPropertyData: unsupported bytes per packet for kAudioStreamPropertyPhysicalFormat");
-			FailWithAction(((const AudioStreamBasicDescription*)inData)->mFramesPerPacket != 1, theAnswer = kAudioDeviceUnsupportedFormatError, Done, "VocanaVirtualDevice_SetStreamPropertyData: unsupported frames per packet for kAudioStreamPropertyPhysicalFormat");
-			FailWithAction(((const AudioStreamBasicDescription*)inData)->mBytesPerFrame != kBytes_Per_Frame, theAnswer = kAudioDeviceUnsupportedFormatError, Done, "VocanaVirtualDevice_SetStreamPropertyData: unsupported bytes per frame for kAudioStreamPropertyPhysicalFormat");
-			FailWithAction(((const AudioStreamBasicDescription*)inData)->mChannelsPerFrame != kNumber_Of_Channels, theAnswer = kAudioDeviceUnsupportedFormatError, Done, "VocanaVirtualDevice_SetStreamPropertyData: unsupported channels per frame for kAudioStreamPropertyPhysicalFormat");
-			FailWithAction(((const AudioStreamBasicDescription*)inData)->mBitsPerChannel != kBits_Per_Channel, theAnswer = kAudioDeviceUnsupportedFormatError, Done, "VocanaVirtualDevice_SetStreamPropertyData: unsupported bits per channel for kAudioStreamPropertyPhysicalFormat");
-			FailWithAction(!is_valid_sample_rate(((const AudioStreamBasicDescription*)inData)->mSampleRate), theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_SetStreamPropertyData: unsupported sample rate for kAudioStreamPropertyPhysicalFormat");
-			
-			//	If we made it this far, the requested format is something we support, so make sure the sample rate is actually different
-			pthread_mutex_lock(&gPlugIn_StateMutex);
-			theOldSampleRate = gDevice_SampleRate;
-			gDevice_RequestedSampleRate = ((const AudioStreamBasicDescription*)inData)->mSampleRate;
-			pthread_mutex_unlock(&gPlugIn_StateMutex);
-			if(((const AudioStreamBasicDescription*)inData)->mSampleRate != theOldSampleRate)
-			{
-				//	we dispatch this so that the change can happen asynchronously
-				dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{ gPlugIn_Host->RequestDeviceConfigurationChange(gPlugIn_Host, kObjectID_Device, ChangeAction_SetSampleRate, NULL); });
-			}
-			break;
-		
-		default:
-			theAnswer = kAudioHardwareUnknownPropertyError;
-			break;
-	};
-
-Done:
-	return theAnswer;
-}
-
-#pragma mark Control Property Operations
-
-static Boolean	VocanaVirtualDevice_HasControlProperty(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress)
-{
-	//	This method returns whether or not the given object has the given property.
-	
-	#pragma unused(inClientProcessID)
-	
-	//	declare the local variables
-	Boolean theAnswer = false;
-	
-	//	check the arguments
-	FailIf(inDriver != gAudioServerPlugInDriverRef, Done, "VocanaVirtualDevice_HasControlProperty: bad driver reference");
-	FailIf(inAddress == NULL, Done, "VocanaVirtualDevice_HasControlProperty: no address");
-	
-	//	Note that for each object, this driver implements all the required properties plus a few
-	//	extras that are useful but not required. There is more detailed commentary about each
-	//	property in the VocanaVirtualDevice_GetControlPropertyData() method.
-	switch(inObjectID)
-	{
-		case kObjectID_Volume_Input_Master:
-		case kObjectID_Volume_Output_Master:
-			switch(inAddress->mSelector)
-			{
-				case kAudioObjectPropertyBaseClass:
-				case kAudioObjectPropertyClass:
-				case kAudioObjectPropertyOwner:
-				case kAudioObjectPropertyOwnedObjects:
-				case kAudioControlPropertyScope:
-				case kAudioControlPropertyElement:
-				case kAudioLevelControlPropertyScalarValue:
-				case kAudioLevelControlPropertyDecibelValue:
-				case kAudioLevelControlPropertyDecibelRange:
-				case kAudioLevelControlPropertyConvertScalarToDecibels:
-				case kAudioLevelControlPropertyConvertDecibelsToScalar:
-					theAnswer = true;
-					break;
-			};
-			break;
-		
-		case kObjectID_Mute_Input_Master:
-		case kObjectID_Mute_Output_Master:
-			switch(inAddress->mSelector)
-			{
-				case kAudioObjectPropertyBaseClass:
-				case kAudioObjectPropertyClass:
-				case kAudioObjectPropertyOwner:
-				case kAudioObjectPropertyOwnedObjects:
-				case kAudioControlPropertyScope:
-				case kAudioControlPropertyElement:
-				case kAudioBooleanControlPropertyValue:
-					theAnswer = true;
-					break;
-			};
-			break;
-
-		case kObjectID_Pitch_Adjust:
-			switch(inAddress->mSelector)
-			{
-				case kAudioObjectPropertyBaseClass:
-				case kAudioObjectPropertyClass:
-				case kAudioObjectPropertyOwner:
-				case kAudioObjectPropertyOwnedObjects:
-				case kAudioControlPropertyScope:
-				case kAudioControlPropertyElement:
-				case kAudioStereoPanControlPropertyValue:
-					theAnswer = true;
-					break;
-			};
-			break;
-			
-		case kObjectID_ClockSource:
-			switch(inAddress->mSelector)
-			{
-				case kAudioObjectPropertyBaseClass:
-				case kAudioObjectPropertyClass:
-				case kAudioObjectPropertyOwner:
-				case kAudioObjectPropertyOwnedObjects:
-				case kAudioControlPropertyScope:
-				case kAudioControlPropertyElement:
-				case kAudioSelectorControlPropertyCurrentItem:
-				case kAudioSelectorControlPropertyAvailableItems:
-				case kAudioSelectorControlPropertyItemName:
-					theAnswer = true;
-					break;
-			};
-			break;
-	};
-
-Done:
-	return theAnswer;
-}
-
-static OSStatus	VocanaVirtualDevice_IsControlPropertySettable(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, Boolean* outIsSettable)
-{
-	//	This method returns whether or not the given property on the object can have its value
-	//	changed.
-	
-	#pragma unused(inClientProcessID)
-	
-	//	declare the local variables
-	OSStatus theAnswer = 0;
-	
-	//	check the arguments
-	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_IsControlPropertySettable: bad driver reference");
-	FailWithAction(inAddress == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_IsControlPropertySettable: no address");
-	FailWithAction(outIsSettable == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_IsControlPropertySettable: no place to put the return value");
-	
-	//	Note that for each object, this driver implements all the required properties plus a few
-	//	extras that are useful but not required. There is more detailed commentary about each
-	//	property in the VocanaVirtualDevice_GetControlPropertyData() method.
-	switch(inObjectID)
-	{
-		case kObjectID_Volume_Input_Master:
-		case kObjectID_Volume_Output_Master:
-			switch(inAddress->mSelector)
-			{
-				case kAudioObjectPropertyBaseClass:
-				case kAudioObjectPropertyClass:
-				case kAudioObjectPropertyOwner:
-				case kAudioObjectPropertyOwnedObjects:
-				case kAudioControlPropertyScope:
-				case kAudioControlPropertyElement:
-				case kAudioLevelControlPropertyDecibelRange:
-				case kAudioLevelControlPropertyConvertScalarToDecibels:
-				case kAudioLevelControlPropertyConvertDecibelsToScalar:
-					*outIsSettable = false;
-					break;
-				
-				case kAudioLevelControlPropertyScalarValue:
-				case kAudioLevelControlPropertyDecibelValue:
-					*outIsSettable = true;
-					break;
-				
-				default:
-					theAnswer = kAudioHardwareUnknownPropertyError;
-					break;
-			};
-			break;
-		
-		case kObjectID_Mute_Input_Master:
-		case kObjectID_Mute_Output_Master:
-			switch(inAddress->mSelector)
-			{
-				case kAudioObjectPropertyBaseClass:
-				case kAudioObjectPropertyClass:
-				case kAudioObjectPropertyOwner:
-				case kAudioObjectPropertyOwnedObjects:
-				case kAudioControlPropertyScope:
-				case kAudioControlPropertyElement:
-					*outIsSettable = false;
-					break;
-				
-				case kAudioBooleanControlPropertyValue:
-					*outIsSettable = true;
-					break;
-				
-				default:
-					theAnswer = kAudioHardwareUnknownPropertyError;
-					break;
-			};
-			break;
-
-		case kObjectID_Pitch_Adjust:
-			switch(inAddress->mSelector)
-			{
-				case kAudioObjectPropertyBaseClass:
-				case kAudioObjectPropertyClass:
-				case kAudioObjectPropertyOwner:
-				case kAudioObjectPropertyOwnedObjects:
-				case kAudioControlPropertyScope:
-				case kAudioControlPropertyElement:
-					*outIsSettable = false;
-					break;
-
-				case kAudioStereoPanControlPropertyValue:
-					*outIsSettable = true;
-					break;
-
-				default:
-					theAnswer = kAudioHardwareUnknownPropertyError;
-					break;
-			};
-			break;
-		case kObjectID_ClockSource:
-			switch(inAddress->mSelector)
-			{
-				case kAudioObjectPropertyBaseClass:
-				case kAudioObjectPropertyClass:
-				case kAudioObjectPropertyOwner:
-				case kAudioObjectPropertyOwnedObjects:
-				case kAudioControlPropertyScope:
-				case kAudioControlPropertyElement:
-					*outIsSettable = false;
-					break;
-					
-				case kAudioSelectorControlPropertyCurrentItem:
-					*outIsSettable = true;
-					break;
-					
-				default:
-					theAnswer = kAudioHardwareUnknownPropertyError;
-					break;
-			};
-			break;
-
-		default:
-			theAnswer = kAudioHardwareBadObjectError;
-			break;
-	};
-
-Done:
-	return theAnswer;
-}
-
-static OSStatus	VocanaVirtualDevice_GetControlPropertyDataSize(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32* outDataSize)
-{
-	//	This method returns the byte size of the property's data.
-	
-	#pragma unused(inClientProcessID, inQualifierDataSize, inQualifierData)
-	
-	//	declare the local variables
-	OSStatus theAnswer = 0;
-	
-	//	check the arguments
-	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_GetControlPropertyDataSize: bad driver reference");
-	FailWithAction(inAddress == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_GetControlPropertyDataSize: no address");
-	FailWithAction(outDataSize == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_GetControlPropertyDataSize: no place to put the return value");
-	
-	//	Note that for each object, this driver implements all the required properties plus a few
-	//	extras that are useful but not required. There is more detailed commentary about each
-	//	property in the VocanaVirtualDevice_GetControlPropertyData() method.
-	switch(inObjectID)
-	{
-		case kObjectID_Volume_Input_Master:
-		case kObjectID_Volume_Output_Master:
-			switch(inAddress->mSelector)
-			{
-				case kAudioObjectPropertyBaseClass:
-					*outDataSize = sizeof(AudioClassID);
-					break;
-
-				case kAudioObjectPropertyClass:
-					*outDataSize = sizeof(AudioClassID);
-					break;
-
-				case kAudioObjectPropertyOwner:
-					*outDataSize = sizeof(AudioObjectID);
-					break;
-
-				case kAudioObjectPropertyOwnedObjects:
-					*outDataSize = 0 * sizeof(AudioObjectID);
-					break;
-
-				case kAudioControlPropertyScope:
-					*outDataSize = sizeof(AudioObjectPropertyScope);
-					break;
-
-				case kAudioControlPropertyElement:
-					*outDataSize = sizeof(AudioObjectPropertyElement);
-					break;
-
-				case kAudioLevelControlPropertyScalarValue:
-					*outDataSize = sizeof(Float32);
-					break;
-
-				case kAudioLevelControlPropertyDecibelValue:
-					*outDataSize = sizeof(Float32);
-					break;
-
-				case kAudioLevelControlPropertyDecibelRange:
-					*outDataSize = sizeof(AudioValueRange);
-					break;
-
-				case kAudioLevelControlPropertyConvertScalarToDecibels:
-					*outDataSize = sizeof(Float32);
-					break;
-
-				case kAudioLevelControlPropertyConvertDecibelsToScalar:
-					*outDataSize = sizeof(Float32);
-					break;
-
-				default:
-					theAnswer = kAudioHardwareUnknownPropertyError;
-					break;
-			};
-			break;
-		
-		case kObjectID_Mute_Input_Master:
-		case kObjectID_Mute_Output_Master:
-			switch(inAddress->mSelector)
-			{
-				case kAudioObjectPropertyBaseClass:
-					*outDataSize = sizeof(AudioClassID);
-					break;
-
-				case kAudioObjectPropertyClass:
-					*outDataSize = sizeof(AudioClassID);
-					break;
-
-				case kAudioObjectPropertyOwner:
-					*outDataSize = sizeof(AudioObjectID);
-					break;
-
-				case kAudioObjectPropertyOwnedObjects:
-					*outDataSize = 0 * sizeof(AudioObjectID);
-					break;
-
-				case kAudioControlPropertyScope:
-					*outDataSize = sizeof(AudioObjectPropertyScope);
-					break;
-
-				case kAudioControlPropertyElement:
-					*outDataSize = sizeof(AudioObjectPropertyElement);
-					break;
+			FailWithAction(inDataSize < sizeof(UInt32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetStreamPropertyData: not enough space for the return value of kAudioStreamPropertyStartingChannel for the stream");
+			*((UInt32*)outData) = 1;
+			*outDataSize = sizeof(UInt32);
+			break;
 
-				case kAudioBooleanControlPropertyValue:
-					*outDataSize = sizeof(UInt32);
-					break;
+		case kAudioStreamPropertyLatency:
+			//	This property returns any additional presentation latency the stream has.
+			FailWithAction(inDataSize < sizeof(UInt32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetStreamPropertyData: not enough space for the return value of kAudioStreamPropertyStartingChannel for the stream");
+			*((UInt32*)outData) = kLatency_Frame_Size;
+			*outDataSize = sizeof(UInt32);
+			break;
 
-				default:
-					theAnswer = kAudioHardwareUnknownPropertyError;
-					break;
-			};
+		case kAudioStreamPropertyVirtualFormat:
+		case kAudioStreamPropertyPhysicalFormat:
+			//	This returns the current format of the stream in an
+			//	AudioStreamBasicDescription. The sample rate comes from the published state
+			//	snapshot.
+			//	Note that for devices that don't override the mix operation, the virtual
+			//	format has to be the same as the physical format.
+			FailWithAction(inDataSize < sizeof(AudioStreamBasicDescription), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetStreamPropertyData: not enough space for the return value of kAudioStreamPropertyVirtualFormat for the stream");
+            theState = device_state(theInstance);
+            ((AudioStreamBasicDescription*)outData)->mSampleRate = theState.sampleRate;
+            ((AudioStreamBasicDescription*)outData)->mFormatID = kAudioFormatLinearPCM;
+            ((AudioStreamBasicDescription*)outData)->mFormatFlags = kAudioFormatFlagIsFloat | kAudioFormatFlagsNativeEndian | kAudioFormatFlagIsPacked;
+            ((AudioStreamBasicDescription*)outData)->mBytesPerPacket = kBytes_Per_Channel * theState.channelCount;
+            ((AudioStreamBasicDescription*)outData)->mFramesPerPacket = 1;
+            ((AudioStreamBasicDescription*)outData)->mBytesPerFrame = kBytes_Per_Channel * theState.channelCount;
+            ((AudioStreamBasicDescription*)outData)->mChannelsPerFrame = theState.channelCount;
+            ((AudioStreamBasicDescription*)outData)->mBitsPerChannel = kBits_Per_Channel;
+			*outDataSize = sizeof(AudioStreamBasicDescription);
 			break;
-			
-		case kObjectID_Pitch_Adjust:
-			switch(inAddress->mSelector)
-			{
-				case kAudioObjectPropertyBaseClass:
-					*outDataSize = sizeof(AudioClassID);
-					break;
 
-				case kAudioObjectPropertyClass:
-					*outDataSize = sizeof(AudioClassID);
-					break;
+		case kAudioStreamPropertyAvailableVirtualFormats:
+		case kAudioStreamPropertyAvailablePhysicalFormats:
+			//	This returns an array of AudioStreamRangedDescriptions that describe what
+			//	formats are supported.
 
-				case kAudioObjectPropertyOwner:
-					*outDataSize = sizeof(AudioObjectID);
-					break;
+			//	Calculate the number of items that have been requested. Note that this
+			//	number is allowed to be smaller than the actual size of the list. In such
+			//	case, only that number of items will be returned
+			theNumberItemsToFetch = inDataSize / sizeof(AudioStreamRangedDescription);
+			
+			//	clamp it to the number of items we have
+			if(theNumberItemsToFetch > kDevice_SampleRatesSize)
+			{
+				theNumberItemsToFetch = kDevice_SampleRatesSize;
+			}
 
-				case kAudioObjectPropertyOwnedObjects:
-					*outDataSize = 0 * sizeof(AudioObjectID);
-					break;
+            //	fill out the return array
+            theState = device_state(theInstance);
+            for(UInt32 i = 0; i < theNumberItemsToFetch; i++)
+            {
+                ((AudioStreamRangedDescription*)outData)[i].mFormat.mSampleRate = kDevice_SampleRates[i];
+                ((AudioStreamRangedDescription*)outData)[i].mFormat.mFormatID = kAudioFormatLinearPCM;
+                ((AudioStreamRangedDescription*)outData)[i].mFormat.mFormatFlags = kAudioFormatFlagIsFloat | kAudioFormatFlagsNativeEndian | kAudioFormatFlagIsPacked;
+                ((AudioStreamRangedDescription*)outData)[i].mFormat.mBytesPerPacket = kBytes_Per_Channel * theState.channelCount;
+                ((AudioStreamRangedDescription*)outData)[i].mFormat.mFramesPerPacket = 1;
+                ((AudioStreamRangedDescription*)outData)[i].mFormat.mBytesPerFrame = kBytes_Per_Channel * theState.channelCount;
+                ((AudioStreamRangedDescription*)outData)[i].mFormat.mChannelsPerFrame = theState.channelCount;
+                ((AudioStreamRangedDescription*)outData)[i].mFormat.mBitsPerChannel = kBits_Per_Channel;
+                ((AudioStreamRangedDescription*)outData)[i].mSampleRateRange.mMinimum = kDevice_SampleRates[i];
+                ((AudioStreamRangedDescription*)outData)[i].mSampleRateRange.mMaximum = kDevice_SampleRates[i];
+            }
 
-				case kAudioControlPropertyScope:
-					*outDataSize = sizeof(AudioObjectPropertyScope);
-					break;
+			//	report how much we wrote
+			*outDataSize = theNumberItemsToFetch * sizeof(AudioStreamRangedDescription);
+			break;
 
-				case kAudioControlPropertyElement:
-					*outDataSize = sizeof(AudioObjectPropertyElement);
-					break;
+		default:
+			theAnswer = kAudioHardwareUnknownPropertyError;
+			break;
+	};
 
-				case kAudioStereoPanControlPropertyValue:
-					*outDataSize = sizeof(Float32);
-					break;
+Done:
+	return theAnswer;
+}
 
-				default:
-					theAnswer = kAudioHardwareUnknownPropertyError;
-					break;
-			};
+static OSStatus	VocanaVirtualDevice_SetStreamPropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, const void* inData, UInt32* outNumberPropertiesChanged, AudioObjectPropertyAddress outChangedAddresses[2])
+{
+	#pragma unused(inClientProcessID, inQualifierDataSize, inQualifierData)
+	
+	//	declare the local variables
+	OSStatus theAnswer = 0;
+	Float64 theOldSampleRate;
+	UInt32 theChannelCount;
+	VocanaDeviceStateValues theState;
+	VocanaDeviceInstance* theInstance = NULL;
+	AudioObjectID theKind = kAudioObjectUnknown;
+	
+	//	check the arguments
+	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_SetStreamPropertyData: bad driver reference");
+	FailWithAction(inAddress == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_SetStreamPropertyData: no address");
+	FailWithAction(outNumberPropertiesChanged == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_SetStreamPropertyData: no place to return the number of properties that changed");
+	FailWithAction(outChangedAddresses == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_SetStreamPropertyData: no place to return the properties that changed");
+	theKind = object_kind(inObjectID, &theInstance);
+	FailWithAction((theKind != kObjectID_Stream_Input) && (theKind != kObjectID_Stream_Output), theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_SetStreamPropertyData: not a stream object");
+	
+	//	initialize the returned number of changed properties
+	*outNumberPropertiesChanged = 0;
+	
+	//	Note that for each object, this driver implements all the required properties plus a few
+	//	extras that are useful but not required. There is more detailed commentary about each
+	//	property in the VocanaVirtualDevice_GetStreamPropertyData() method.
+	switch(inAddress->mSelector)
+	{
+		case kAudioStreamPropertyIsActive:
+			//	Changing the active state of a stream doesn't affect IO or change the structure
+			//	so we can just save the state and send the notification.
+			FailWithAction(inDataSize != sizeof(UInt32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_SetStreamPropertyData: wrong size for the data for kAudioDevicePropertyNominalSampleRate");
+			pthread_mutex_lock(&gPlugIn_StateMutex);
+			VocanaDeviceState_Read(&theInstance->state, &theState);
+			if(theKind == kObjectID_Stream_Input)
+			{
+				if(theState.isInputActive != (*((const UInt32*)inData) != 0))
+				{
+					theState.isInputActive = *((const UInt32*)inData) != 0;
+					VocanaDeviceState_Publish(&theInstance->state, &theState);
+					*outNumberPropertiesChanged = 1;
+					outChangedAddresses[0].mSelector = kAudioStreamPropertyIsActive;
+					outChangedAddresses[0].mScope = kAudioObjectPropertyScopeGlobal;
+					outChangedAddresses[0].mElement = kAudioObjectPropertyElementMain;
+				}
+			}
+			else
+			{
+				if(theState.isOutputActive != (*((const UInt32*)inData) != 0))
+				{
+					theState.isOutputActive = *((const UInt32*)inData) != 0;
+					VocanaDeviceState_Publish(&theInstance->state, &theState);
+					*outNumberPropertiesChanged = 1;
+					outChangedAddresses[0].mSelector = kAudioStreamPropertyIsActive;
+					outChangedAddresses[0].mScope = kAudioObjectPropertyScopeGlobal;
+					outChangedAddresses[0].mElement = kAudioObjectPropertyElementMain;
+				}
+			}
+			pthread_mutex_unlock(&gPlugIn_StateMutex);
 			break;
 			
-		case kObjectID_ClockSource:
-			switch(inAddress->mSelector)
+		case kAudioStreamPropertyVirtualFormat:
+		case kAudioStreamPropertyPhysicalFormat:
+			//	Changing the stream format needs to be handled via the
+			//	RequestConfigChange/PerformConfigChange machinery. Note that because this
+			//	device only supports 32 bit float data with the configured number of
+			//	channels, the only thing that can change here is the sample rate; the
+			//	channel count is changed through kVocanaDevicePropertyChannelCount.
+			theChannelCount = device_state(theInstance).channelCount;
+			FailWithAction(inDataSize != sizeof(AudioStreamBasicDescription), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_SetStreamPropertyData: wrong size for the data for kAudioStreamPropertyPhysicalFormat");
+			FailWithAction(((const AudioStreamBasicDescription*)inData)->mFormatID != kAudioFormatLinearPCM, theAnswer = kAudioDeviceUnsupportedFormatError, Done, "VocanaVirtualDevice_SetStreamPropertyData: unsupported format ID for kAudioStreamPropertyPhysicalFormat");
+			FailWithAction(((const AudioStreamBasicDescription*)inData)->mFormatFlags != (kAudioFormatFlagIsFloat | kAudioFormatFlagsNativeEndian | kAudioFormatFlagIsPacked), theAnswer = kAudioDeviceUnsupportedFormatError, Done, "VocanaVirtualDevice_SetStreamPropertyData: unsupported format flags for kAudioStreamPropertyPhysicalFormat");
+			FailWithAction(((const AudioStreamBasicDescription*)inData)->mBytesPerPacket != kBytes_Per_Channel * theChannelCount, theAnswer = kAudioDeviceUnsupportedFormatError, Done, "VocanaVirtualDevice_SetStreamPropertyData: unsupported bytes per packet for kAudioStreamPropertyPhysicalFormat");
+			FailWithAction(((const AudioStreamBasicDescription*)inData)->mFramesPerPacket != 1, theAnswer = kAudioDeviceUnsupportedFormatError, Done, "VocanaVirtualDevice_SetStreamPropertyData: unsupported frames per packet for kAudioStreamPropertyPhysicalFormat");
+			FailWithAction(((const AudioStreamBasicDescription*)inData)->mBytesPerFrame != kBytes_Per_Channel * theChannelCount, theAnswer = kAudioDeviceUnsupportedFormatError, Done, "VocanaVirtualDevice_SetStreamPropertyData: unsupported bytes per frame for kAudioStreamPropertyPhysicalFormat");
+			FailWithAction(((const AudioStreamBasicDescription*)inData)->mChannelsPerFrame != theChannelCount, theAnswer = kAudioDeviceUnsupportedFormatError, Done, "VocanaVirtualDevice_SetStreamPropertyData: unsupported channels per frame for kAudioStreamPropertyPhysicalFormat");
+			FailWithAction(((const AudioStreamBasicDescription*)inData)->mBitsPerChannel != kBits_Per_Channel, theAnswer = kAudioDeviceUnsupportedFormatError, Done, "VocanaVirtualDevice_SetStreamPropertyData: unsupported bits per channel for kAudioStreamPropertyPhysicalFormat");
+			FailWithAction(!is_valid_sample_rate(((const AudioStreamBasicDescription*)inData)->mSampleRate), theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_SetStreamPropertyData: unsupported sample rate for kAudioStreamPropertyPhysicalFormat");
+			
+			//	If we made it this far, the requested format is something we support, so make sure the sample rate is actually different
+			pthread_mutex_lock(&gPlugIn_StateMutex);
+			theOldSampleRate = device_state(theInstance).sampleRate;
+			theInstance->requestedSampleRate = ((const AudioStreamBasicDescription*)inData)->mSampleRate;
+			pthread_mutex_unlock(&gPlugIn_StateMutex);
+			if(((const AudioStreamBasicDescription*)inData)->mSampleRate != theOldSampleRate)
 			{
-				case kAudioObjectPropertyBaseClass:
-					*outDataSize = sizeof(AudioClassID);
-					break;
-				case kAudioObjectPropertyClass:
-					*outDataSize = sizeof(AudioClassID);
-					break;
-				case kAudioObjectPropertyOwner:
-					*outDataSize = sizeof(AudioObjectID);
-					break;
-				case kAudioObjectPropertyOwnedObjects:
-					*outDataSize = 0 * sizeof(AudioObjectID);
-					break;
-				case kAudioControlPropertyScope:
-					*outDataSize = sizeof(AudioObjectPropertyScope);
-					break;
-				case kAudioControlPropertyElement:
-					*outDataSize = sizeof(AudioObjectPropertyElement);
-					break;
-					
-				case kAudioSelectorControlPropertyCurrentItem:
-					*outDataSize = sizeof(UInt32);
-					break;
-					
-				case kAudioSelectorControlPropertyAvailableItems:
-					*outDataSize = kClockSource_NumberItems * sizeof(UInt32);
-					break;
-				case kAudioSelectorControlPropertyItemName:
-					*outDataSize = sizeof(CFStringRef);
-					break;
-				default:
-					theAnswer = kAudioHardwareUnknownPropertyError;
-					break;
-			};
+				//	we dispatch this so that the change can happen asynchronously
+				dispatch_async_f(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), change_request(theInstance, ChangeAction_SetSampleRate), request_device_configuration_change);
+			}
 			break;
+		
 		default:
-			theAnswer = kAudioHardwareBadObjectError;
+			theAnswer = kAudioHardwareUnknownPropertyError;
 			break;
 	};
 
@@ -3727,6 +3410,8 @@ Done:
 	return theAnswer;
 }
 
+#pragma mark Control Property Operations
+
 static OSStatus	VocanaVirtualDevice_GetControlPropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, UInt32* outDataSize, void* outData)
 {
 	#pragma unused(inClientProcessID, inQualifierData, inQualifierDataSize)
@@ -3735,6 +3420,8 @@ static OSStatus	VocanaVirtualDevice_GetControlPropertyData(AudioServerPlugInDriv
 	OSStatus theAnswer = 0;
     UInt32 theNumberItemsToFetch;
     UInt32 theItemIndex;
+	VocanaDeviceInstance* theInstance = NULL;
+	AudioObjectID theKind = kAudioObjectUnknown;
 	
 	//	check the arguments
 	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_GetControlPropertyData: bad driver reference");
@@ -3747,7 +3434,8 @@ static OSStatus	VocanaVirtualDevice_GetControlPropertyData(AudioServerPlugInDriv
 	//
 	//	Also, since most of the data that will get returned is static, there are few instances where
 	//	it is necessary to lock the state mutex.
-	switch(inObjectID)
+	theKind = object_kind(inObjectID, &theInstance);
+	switch(theKind)
 	{
 		case kObjectID_Volume_Input_Master:
 		case kObjectID_Volume_Output_Master:
@@ -3770,7 +3458,7 @@ static OSStatus	VocanaVirtualDevice_GetControlPropertyData(AudioServerPlugInDriv
 				case kAudioObjectPropertyOwner:
 					//	The control's owner is the device object
 					FailWithAction(inDataSize < sizeof(AudioObjectID), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetControlPropertyData: not enough space for the return value of kAudioObjectPropertyOwner for the volume control");
-					*((AudioObjectID*)outData) = kObjectID_Device;
+					*((AudioObjectID*)outData) = object_id(theInstance, kObjectID_Device);
 					*outDataSize = sizeof(AudioObjectID);
 					break;
 					
@@ -3782,7 +3470,7 @@ static OSStatus	VocanaVirtualDevice_GetControlPropertyData(AudioServerPlugInDriv
 				case kAudioControlPropertyScope:
 					//	This property returns the scope that the control is attached to.
 					FailWithAction(inDataSize < sizeof(AudioObjectPropertyScope), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetControlPropertyData: not enough space for the return value of kAudioControlPropertyScope for the volume control");
-					*((AudioObjectPropertyScope*)outData) = (inObjectID == kObjectID_Volume_Input_Master) ? kAudioObjectPropertyScopeInput : kAudioObjectPropertyScopeOutput;
+					*((AudioObjectPropertyScope*)outData) = (theKind == kObjectID_Volume_Input_Master) ? kAudioObjectPropertyScopeInput : kAudioObjectPropertyScopeOutput;
 					*outDataSize = sizeof(AudioObjectPropertyScope);
 					break;
 
@@ -3795,22 +3483,15 @@ static OSStatus	VocanaVirtualDevice_GetControlPropertyData(AudioServerPlugInDriv
 
 				case kAudioLevelControlPropertyScalarValue:
 					//	This returns the value of the control in the normalized range of 0 to 1.
-					//	Note that we need to take the state lock to examine the value.
 					FailWithAction(inDataSize < sizeof(Float32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetControlPropertyData: not enough space for the return value of kAudioLevelControlPropertyScalarValue for the volume control");
-					pthread_mutex_lock(&gPlugIn_StateMutex);
-					*((Float32*)outData) = volume_to_scalar(gVolume_Master_Value);
-					pthread_mutex_unlock(&gPlugIn_StateMutex);
+					*((Float32*)outData) = volume_to_scalar(device_state(theInstance).volume);
 					*outDataSize = sizeof(Float32);
 					break;
 
 				case kAudioLevelControlPropertyDecibelValue:
 					//	This returns the dB value of the control.
-					//	Note that we need to take the state lock to examine the value.
 					FailWithAction(inDataSize < sizeof(Float32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetControlPropertyData: not enough space for the return value of kAudioLevelControlPropertyDecibelValue for the volume control");
-					pthread_mutex_lock(&gPlugIn_StateMutex);
-					*((Float32*)outData) = gVolume_Master_Value;
-					pthread_mutex_unlock(&gPlugIn_StateMutex);
-					*((Float32*)outData) = volume_to_decibel(*((Float32*)outData));
+					*((Float32*)outData) = volume_to_decibel(device_state(theInstance).volume);
 					
 					//	report how much we wrote
 					*outDataSize = sizeof(Float32);
@@ -3898,7 +3579,7 @@ static OSStatus	VocanaVirtualDevice_GetControlPropertyData(AudioServerPlugInDriv
 				case kAudioObjectPropertyOwner:
 					//	The control's owner is the device object
 					FailWithAction(inDataSize < sizeof(AudioObjectID), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetControlPropertyData: not enough space for the return value of kAudioObjectPropertyOwner for the mute control");
-					*((AudioObjectID*)outData) = kObjectID_Device;
+					*((AudioObjectID*)outData) = object_id(theInstance, kObjectID_Device);
 					*outDataSize = sizeof(AudioObjectID);
 					break;
 					
@@ -3910,7 +3591,7 @@ static OSStatus	VocanaVirtualDevice_GetControlPropertyData(AudioServerPlugInDriv
 				case kAudioControlPropertyScope:
 					//	This property returns the scope that the control is attached to.
 					FailWithAction(inDataSize < sizeof(AudioObjectPropertyScope), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetControlPropertyData: not enough space for the return value of kAudioControlPropertyScope for the mute control");
-					*((AudioObjectPropertyScope*)outData) = (inObjectID == kObjectID_Mute_Input_Master) ? kAudioObjectPropertyScopeInput : kAudioObjectPropertyScopeOutput;
+					*((AudioObjectPropertyScope*)outData) = (theKind == kObjectID_Mute_Input_Master) ? kAudioObjectPropertyScopeInput : kAudioObjectPropertyScopeOutput;
 					*outDataSize = sizeof(AudioObjectPropertyScope);
 					break;
 
@@ -3924,11 +3605,8 @@ static OSStatus	VocanaVirtualDevice_GetControlPropertyData(AudioServerPlugInDriv
 				case kAudioBooleanControlPropertyValue:
 					//	This returns the value of the mute control where 0 means that mute is off
 					//	and audio can be heard and 1 means that mute is on and audio cannot be heard.
-					//	Note that we need to take the state lock to examine this value.
 					FailWithAction(inDataSize < sizeof(UInt32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetControlPropertyData: not enough space for the return value of kAudioBooleanControlPropertyValue for the mute control");
-					pthread_mutex_lock(&gPlugIn_StateMutex);
-					*((UInt32*)outData) = gMute_Master_Value ? 1 : 0;
-					pthread_mutex_unlock(&gPlugIn_StateMutex);
+					*((UInt32*)outData) = device_state(theInstance).isMuted ? 1 : 0;
 					*outDataSize = sizeof(UInt32);
 					break;
 
@@ -3958,7 +3636,7 @@ static OSStatus	VocanaVirtualDevice_GetControlPropertyData(AudioServerPlugInDriv
 				case kAudioObjectPropertyOwner:
 					//    The control's owner is the device object
 					FailWithAction(inDataSize < sizeof(AudioObjectID), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetControlPropertyData: not enough space for the return value of kAudioObjectPropertyOwner for the pitch control");
-					*((AudioObjectID*)outData) = kObjectID_Device;
+					*((AudioObjectID*)outData) = object_id(theInstance, kObjectID_Device);
 					*outDataSize = sizeof(AudioObjectID);
 					break;
 
@@ -3983,11 +3661,8 @@ static OSStatus	VocanaVirtualDevice_GetControlPropertyData(AudioServerPlugInDriv
 
 				case kAudioStereoPanControlPropertyValue:
 					//    This returns the value of the pitch control.
-					//    Note that we need to take the state lock to examine this value.
 					FailWithAction(inDataSize < sizeof(Float32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetControlPropertyData: not enough space for the return value of kAudioLevelControlScalarValue for the pitch control");
-					pthread_mutex_lock(&gPlugIn_StateMutex);
-					*((Float32*)outData) = (inObjectID == kObjectID_Pitch_Adjust) ? gPitch_Adjust : 0.5;
-					pthread_mutex_unlock(&gPlugIn_StateMutex);
+					*((Float32*)outData) = (theKind == kObjectID_Pitch_Adjust) ? device_state(theInstance).pitchAdjust : 0.5;
 					*outDataSize = sizeof(Float32);
 					break;
 
@@ -4016,7 +3691,7 @@ static OSStatus	VocanaVirtualDevice_GetControlPropertyData(AudioServerPlugInDriv
 				case kAudioObjectPropertyOwner:
 					//    The control's owner is the device object
 					FailWithAction(inDataSize < sizeof(AudioObjectID), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetControlPropertyData: not enough space for the return value of kAudioObjectPropertyOwner for the data source control");
-					*((AudioObjectID*)outData) = kObjectID_Device;
+					*((AudioObjectID*)outData) = object_id(theInstance, kObjectID_Device);
 					*outDataSize = sizeof(AudioObjectID);
 					break;
 					
@@ -4041,11 +3716,8 @@ static OSStatus	VocanaVirtualDevice_GetControlPropertyData(AudioServerPlugInDriv
 					
 				case kAudioSelectorControlPropertyCurrentItem:
 					//    This returns the value of the data source selector.
-					//    Note that we need to take the state lock to examine this value.
 					FailWithAction(inDataSize < sizeof(UInt32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_GetControlPropertyData: not enough space for the return value of kAudioSelectorControlPropertyCurrentItem for the data source control");
-					pthread_mutex_lock(&gPlugIn_StateMutex);
-					*((UInt32*)outData) = gClockSource_Value;
-					pthread_mutex_unlock(&gPlugIn_StateMutex);
+					*((UInt32*)outData) = device_state(theInstance).clockSource;
 					*outDataSize = sizeof(UInt32);
 					break;
 					
@@ -4115,6 +3787,9 @@ static OSStatus	VocanaVirtualDevice_SetControlPropertyData(AudioServerPlugInDriv
 	Float32 theNewVolume;
     Float32 theNewPitch;
     UInt32 theNewSource;
+    VocanaDeviceStateValues theState;
+	VocanaDeviceInstance* theInstance = NULL;
+	AudioObjectID theKind = kAudioObjectUnknown;
 	
 	//	check the arguments
 	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_SetControlPropertyData: bad driver reference");
@@ -4128,7 +3803,8 @@ static OSStatus	VocanaVirtualDevice_SetControlPropertyData(AudioServerPlugInDriv
 	//	Note that for each object, this driver implements all the required properties plus a few
 	//	extras that are useful but not required. There is more detailed commentary about each
 	//	property in the VocanaVirtualDevice_GetControlPropertyData() method.
-	switch(inObjectID)
+	theKind = object_kind(inObjectID, &theInstance);
+	switch(theKind)
 	{
 		case kObjectID_Volume_Input_Master:
 		case kObjectID_Volume_Output_Master:
@@ -4148,9 +3824,11 @@ static OSStatus	VocanaVirtualDevice_SetControlPropertyData(AudioServerPlugInDriv
 						theNewVolume = 1.0;
 					}
 					pthread_mutex_lock(&gPlugIn_StateMutex);
-                    if(gVolume_Master_Value != theNewVolume)
+                    VocanaDeviceState_Read(&theInstance->state, &theState);
+                    if(theState.volume != theNewVolume)
                     {
-                        gVolume_Master_Value = theNewVolume;
+                        theState.volume = theNewVolume;
+                        VocanaDeviceState_Publish(&theInstance->state, &theState);
                         *outNumberPropertiesChanged = 2;
                         outChangedAddresses[0].mSelector = kAudioLevelControlPropertyScalarValue;
                         outChangedAddresses[0].mScope = kAudioObjectPropertyScopeGlobal;
@@ -4178,9 +3856,11 @@ static OSStatus	VocanaVirtualDevice_SetControlPropertyData(AudioServerPlugInDriv
 					}
 					theNewVolume = volume_from_decibel(theNewVolume);
 					pthread_mutex_lock(&gPlugIn_StateMutex);
-                    if(gVolume_Master_Value != theNewVolume)
+                    VocanaDeviceState_Read(&theInstance->state, &theState);
+                    if(theState.volume != theNewVolume)
                     {
-                        gVolume_Master_Value = theNewVolume;
+                        theState.volume = theNewVolume;
+                        VocanaDeviceState_Publish(&theInstance->state, &theState);
                         *outNumberPropertiesChanged = 2;
                         outChangedAddresses[0].mSelector = kAudioLevelControlPropertyScalarValue;
                         outChangedAddresses[0].mScope = kAudioObjectPropertyScopeGlobal;
@@ -4205,9 +3885,11 @@ static OSStatus	VocanaVirtualDevice_SetControlPropertyData(AudioServerPlugInDriv
 				case kAudioBooleanControlPropertyValue:
 					FailWithAction(inDataSize != sizeof(UInt32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "VocanaVirtualDevice_SetControlPropertyData: wrong size for the data for kAudioBooleanControlPropertyValue");
 					pthread_mutex_lock(&gPlugIn_StateMutex);
-                    if(gMute_Master_Value != (*((const UInt32*)inData) != 0))
+                    VocanaDeviceState_Read(&theInstance->state, &theState);
+                    if(theState.isMuted != (*((const UInt32*)inData) != 0))
                     {
-                        gMute_Master_Value = *((const UInt32*)inData) != 0;
+                        theState.isMuted = *((const UInt32*)inData) != 0;
+                        VocanaDeviceState_Publish(&theInstance->state, &theState);
                         *outNumberPropertiesChanged = 1;
                         outChangedAddresses[0].mSelector = kAudioBooleanControlPropertyValue;
                         outChangedAddresses[0].mScope = kAudioObjectPropertyScopeGlobal;
@@ -4238,11 +3920,15 @@ static OSStatus	VocanaVirtualDevice_SetControlPropertyData(AudioServerPlugInDriv
 						theNewPitch = 1.0;
 					}
 					pthread_mutex_lock(&gPlugIn_StateMutex);
-
-					if(gPitch_Adjust != theNewPitch)
+					VocanaDeviceState_Read(&theInstance->state, &theState);
+					if(theState.pitchAdjust != theNewPitch)
 					{
-						gPitch_Adjust = theNewPitch;
-						gDevice_AdjustedTicksPerFrame = gDevice_HostTicksPerFrame - gDevice_HostTicksPerFrame/100.0 * 2.0*(gPitch_Adjust - 0.5);
+						theState.pitchAdjust = theNewPitch;
+						VocanaDeviceState_Publish(&theInstance->state, &theState);
+						if(theState.isPitchAdjustEnabled)
+						{
+							VocanaClock_SetRateTrim(&theInstance->clock, pitch_adjust_rate_trim(theNewPitch));
+						}
 						*outNumberPropertiesChanged = 1;
 						outChangedAddresses[0].mSelector = kAudioStereoPanControlPropertyValue;
 						outChangedAddresses[0].mScope = kAudioObjectPropertyScopeGlobal;
@@ -4268,9 +3954,11 @@ static OSStatus	VocanaVirtualDevice_SetControlPropertyData(AudioServerPlugInDriv
 						theNewSource = kClockSource_NumberItems - 1;
 					}
 					pthread_mutex_lock(&gPlugIn_StateMutex);
-					if(gClockSource_Value != theNewSource)
+					VocanaDeviceState_Read(&theInstance->state, &theState);
+					if(theState.clockSource != theNewSource)
 					{
-						gClockSource_Value = theNewSource;
+						theState.clockSource = theNewSource;
+						VocanaDeviceState_Publish(&theInstance->state, &theState);
 						UInt64 changeAction = (theNewSource > 0) ? ChangeAction_EnablePitchControl : ChangeAction_DisablePitchControl;
 
 						*outNumberPropertiesChanged = 1;
@@ -4279,9 +3967,7 @@ static OSStatus	VocanaVirtualDevice_SetControlPropertyData(AudioServerPlugInDriv
 						outChangedAddresses[0].mElement = kAudioObjectPropertyElementMain;
 
 						// Notify HAL about device configuration change
-						dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
-							gPlugIn_Host->RequestDeviceConfigurationChange(gPlugIn_Host, kObjectID_Device, changeAction, NULL);
-						});
+						dispatch_async_f(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), change_request(theInstance, changeAction), request_device_configuration_change);
 					}
 					pthread_mutex_unlock(&gPlugIn_StateMutex);
 					break;
@@ -4313,44 +3999,47 @@ static OSStatus	VocanaVirtualDevice_StartIO(AudioServerPlugInDriverRef inDriver,
     
     DebugMsg("VocanaVirtualDevice_StartIO");
 	
-	#pragma unused(inClientID, inDeviceObjectID)
+	#pragma unused(inClientID)
 	
 	//	declare the local variables
 	OSStatus theAnswer = 0;
+	VocanaDeviceInstance* theInstance = NULL;
+	AudioObjectID theKind = kAudioObjectUnknown;
+	VocanaDeviceIO* theIO = NULL;
 	
 	//	check the arguments
 	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_StartIO: bad driver reference");
-	FailWithAction(inDeviceObjectID != kObjectID_Device && inDeviceObjectID != kObjectID_Device2, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_StartIO: bad device ID");
-    FailWithAction(inDeviceObjectID == kObjectID_Device && atomic_load(&gDevice_IOIsRunning) == UINT64_MAX, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_StartIO: overflow error.");
-    FailWithAction(inDeviceObjectID == kObjectID_Device2 && atomic_load(&gDevice2_IOIsRunning) == UINT64_MAX, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_StartIO: overflow error.");
+	FailWithAction(!find_device(inDeviceObjectID, &theInstance, &theKind), theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_StartIO: bad device ID");
+    FailWithAction(atomic_load(&device_io(theInstance, theKind)->isRunning) == UINT64_MAX, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_StartIO: overflow error.");
+    theIO = device_io(theInstance, theKind);
  
 	//	Use atomic operations for real-time safety
-    if (inDeviceObjectID == kObjectID_Device) { atomic_fetch_add(&gDevice_IOIsRunning, 1); }
-    if (inDeviceObjectID == kObjectID_Device2) { atomic_fetch_add(&gDevice2_IOIsRunning, 1); }
+    atomic_fetch_add(&theIO->isRunning, 1);
     
-     // allocate ring buffer with error checking
-     if ((atomic_load(&gDevice_IOIsRunning) || atomic_load(&gDevice2_IOIsRunning)) && gRingBuffer == NULL)
+    // the device's first client resets its ring and mix bus; the ring itself was allocated when
+    // the device was added
+    bool isFirstClient = false;
+    if (VocanaRingBufferLifetime_Start(&theIO->ringBufferLifetime, 0, &isFirstClient) != 0)
     {
-        gDevice_NumberTimeStamps = 0;
-        gDevice_AnchorSampleTime = 0;
-        gDevice_AnchorHostTime = mach_absolute_time();
-        gDevice_PreviousTicks = 0;
+        atomic_fetch_sub(&theIO->isRunning, 1);
+        DebugMsg("VocanaVirtualDevice: Failed to start the ring buffer");
+        theAnswer = kAudioHardwareUnspecifiedError;
+        goto Done;
+    }
+    
+    if (isFirstClient)
+    {
+        VocanaMixBus_Reset(&theIO->mixBus);
+#if kDevice_InProcessDenoise
+        device_io_prepare_denoiser(theIO, device_state(theInstance).sampleRate, (UInt32)atomic_load(&theInstance->ioChannelCount));
+#endif
         
-        gRingBuffer = calloc(kRing_Buffer_Frame_Size * kNumber_Of_Channels, sizeof(Float32));
-        if (gRingBuffer == NULL) {
-            DebugMsg("VocanaVirtualDevice: Failed to allocate ring buffer");
-            theAnswer = kAudioHardwareUnspecifiedError;
-            goto Done;
+        // the device and its mirror run on one timeline, started by whichever starts first
+        if (atomic_fetch_add(&theInstance->runningDevices, 1) == 0)
+        {
+            VocanaClock_Start(&theInstance->clock, mach_absolute_time());
         }
-        
-        // Initialize ring buffer position
-        atomic_store(&gRingBufferWritePos, 0);
-        atomic_store(&isBufferClearAtomic, true);
     }
-    
-    
-	//	unlock the state lock
-	pthread_mutex_unlock(&gPlugIn_StateMutex);
 	
 Done:
 	return theAnswer;
@@ -4361,26 +4050,27 @@ static OSStatus	VocanaVirtualDevice_StopIO(AudioServerPlugInDriverRef inDriver,
 	//	This call tells the device that the client has stopped IO. The driver can stop the hardware
 	//	once all clients have stopped.
 	
-	#pragma unused(inClientID, inDeviceObjectID)
+	#pragma unused(inClientID)
 	
 	//	declare the local variables
 	OSStatus theAnswer = 0;
+	VocanaDeviceInstance* theInstance = NULL;
+	AudioObjectID theKind = kAudioObjectUnknown;
 	
 	//	check the arguments
 	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_StopIO: bad driver reference");
-	FailWithAction(inDeviceObjectID != kObjectID_Device && inDeviceObjectID != kObjectID_Device2, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_StopIO: bad device ID");
-    FailWithAction(inDeviceObjectID == kObjectID_Device && atomic_load(&gDevice_IOIsRunning) == 0, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_StopIO: underflow error.");
-    FailWithAction(inDeviceObjectID == kObjectID_Device2 && atomic_load(&gDevice2_IOIsRunning) == 0, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_StopIO: underflow error.");
+	FailWithAction(!find_device(inDeviceObjectID, &theInstance, &theKind), theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_StopIO: bad device ID");
+    FailWithAction(atomic_load(&device_io(theInstance, theKind)->isRunning) == 0, theAnswer = kAudioHardwareIllegalOperationError, Done, "VocanaVirtualDevice_StopIO: underflow error.");
  
 	//	Use atomic operations for real-time safety
-    if (inDeviceObjectID == kObjectID_Device) { atomic_fetch_sub(&gDevice_IOIsRunning, 1); }
-    if (inDeviceObjectID == kObjectID_Device2) { atomic_fetch_sub(&gDevice2_IOIsRunning, 1); }
+    atomic_fetch_sub(&device_io(theInstance, theKind)->isRunning, 1);
     
-    // free the ring buffer
-    if (!atomic_load(&gDevice_IOIsRunning) && !atomic_load(&gDevice2_IOIsRunning) && gRingBuffer != NULL)
+    // the last client only flips the ring to idle; the storage is kept for the next StartIO
+    bool isLastClient = false;
+    VocanaRingBufferLifetime_Stop(&device_io(theInstance, theKind)->ringBufferLifetime, &isLastClient);
+    if (isLastClient)
     {
-        free(gRingBuffer);
-        gRingBuffer = NULL;
+        atomic_fetch_sub(&theInstance->runningDevices, 1);
     }
 	
 Done:
@@ -4396,57 +4086,23 @@ static OSStatus	VocanaVirtualDevice_GetZeroTimeStamp(AudioServerPlugInDriverRef
 	//	where the zero time stamp is updated when wrapping around the ring buffer.
 	//
 	//	For this device, the zero time stamps' sample time increments every kDevice_RingBufferSize
-	//	frames and the host time increments by kDevice_RingBufferSize * gDevice_HostTicksPerFrame.
+	//	frames and the host time by kDevice_RingBufferSize times the host ticks per frame of the
+	//	device clock, which follows the reference clock when the adjustable clock source is selected.
 	
-	#pragma unused(inClientID, inDeviceObjectID)
+	#pragma unused(inClientID)
 	
 	//	declare the local variables
 	OSStatus theAnswer = 0;
-	UInt64 theCurrentHostTime;
-	Float64 theHostTicksPerRingBuffer;
-	Float64 theAdjustedTicksPerRingBuffer;
-	Float64 theNextTickOffset;
-	UInt64 theNextHostTime;
+	VocanaDeviceInstance* theInstance = NULL;
+	AudioObjectID theKind = kAudioObjectUnknown;
 	
 	//	check the arguments
 	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_GetZeroTimeStamp: bad driver reference");
-	FailWithAction(inDeviceObjectID != kObjectID_Device && inDeviceObjectID != kObjectID_Device2, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_GetZeroTimeStamp: bad device ID");
-
-	//	get the current host time
-	theCurrentHostTime = mach_absolute_time();
-	
-	//	calculate the next host time using atomic operations for real-time safety
-	theHostTicksPerRingBuffer = gDevice_HostTicksPerFrame * ((Float64)kDevice_RingBufferSize);
-    if (atomic_load(&gClockSource_Value) > 0) {
-        theAdjustedTicksPerRingBuffer = gDevice_AdjustedTicksPerFrame * ((Float64)kDevice_RingBufferSize);
-    }
-    else {
-        theAdjustedTicksPerRingBuffer = gDevice_HostTicksPerFrame * ((Float64)kDevice_RingBufferSize);
-    }
-    
-	//	Use atomic operations to avoid real-time violations
-	UInt64 currentNumberTimeStamps = atomic_load(&gDevice_NumberTimeStamps);
-	Float64 currentPreviousTicks = atomic_load(&gDevice_PreviousTicks);
-	UInt64 currentAnchorHostTime = atomic_load(&gDevice_AnchorHostTime);
-    
-	theNextTickOffset = currentPreviousTicks + theAdjustedTicksPerRingBuffer;
-	theNextHostTime = currentAnchorHostTime + ((UInt64)theNextTickOffset);
-	
-	//	go to the next time if the next host time is less than the current time
-	if(theNextHostTime <= theCurrentHostTime)
-	{
-		currentNumberTimeStamps++;
-		currentPreviousTicks = theNextTickOffset;
-		
-		//	Atomic updates for real-time safety
-		atomic_store(&gDevice_NumberTimeStamps, currentNumberTimeStamps);
-		atomic_store(&gDevice_PreviousTicks, currentPreviousTicks);
-	}
+	FailWithAction(!find_device(inDeviceObjectID, &theInstance, &theKind), theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_GetZeroTimeStamp: bad device ID");
 	
-	//	set the return values
-	*outSampleTime = currentNumberTimeStamps * kDevice_RingBufferSize;
-	*outHostTime = currentAnchorHostTime + currentPreviousTicks;
-	*outSeed = 1;
+	//	the clock only touches atomics, and the device and its mirror may ask at the same time, so
+	//	this is real-time safe
+	VocanaClock_GetZeroTimeStamp(&theInstance->clock, mach_absolute_time(), outSampleTime, outHostTime, outSeed);
 	
 Done:
 	return theAnswer;
@@ -4457,14 +4113,16 @@ static OSStatus	VocanaVirtualDevice_WillDoIOOperation(AudioServerPlugInDriverRef
 	//	This method returns whether or not the device will do a given IO operation. For this device,
 	//	we only support reading input data and writing output data.
 	
-	#pragma unused(inClientID, inDeviceObjectID)
+	#pragma unused(inClientID)
 	
 	//	declare the local variables
 	OSStatus theAnswer = 0;
+	VocanaDeviceInstance* theInstance = NULL;
+	AudioObjectID theKind = kAudioObjectUnknown;
 	
 	//	check the arguments
 	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_WillDoIOOperation: bad driver reference");
-	FailWithAction(inDeviceObjectID != kObjectID_Device && inDeviceObjectID != kObjectID_Device2, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_WillDoIOOperation: bad device ID");
+	FailWithAction(!find_device(inDeviceObjectID, &theInstance, &theKind), theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_WillDoIOOperation: bad device ID");
 
 	//	figure out if we support the operation
 	bool willDo = false;
@@ -4502,14 +4160,16 @@ static OSStatus	VocanaVirtualDevice_BeginIOOperation(AudioServerPlugInDriverRef
 	//	This is called at the beginning of an IO operation. This device doesn't do anything, so just
 	//	check the arguments and return.
 	
-	#pragma unused(inClientID, inOperationID, inIOBufferFrameSize, inIOCycleInfo, inDeviceObjectID)
+	#pragma unused(inClientID, inOperationID, inIOBufferFrameSize, inIOCycleInfo)
 	
 	//	declare the local variables
 	OSStatus theAnswer = 0;
+	VocanaDeviceInstance* theInstance = NULL;
+	AudioObjectID theKind = kAudioObjectUnknown;
 	
 	//	check the arguments
 	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_BeginIOOperation: bad driver reference");
-	FailWithAction(inDeviceObjectID != kObjectID_Device && inDeviceObjectID != kObjectID_Device2, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_BeginIOOperation: bad device ID");
+	FailWithAction(!find_device(inDeviceObjectID, &theInstance, &theKind), theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_BeginIOOperation: bad device ID");
 
 Done:
 	return theAnswer;
@@ -4519,79 +4179,48 @@ static OSStatus	VocanaVirtualDevice_DoIOOperation(AudioServerPlugInDriverRef inD
 {
 	//	This is called to actually perform a given operation. 
 	
-	#pragma unused(inClientID, inIOCycleInfo, ioSecondaryBuffer, inDeviceObjectID)
+	#pragma unused(ioSecondaryBuffer)
 	
 	//	declare the local variables
 	OSStatus theAnswer = 0;
+	VocanaDeviceInstance* theInstance = NULL;
+	AudioObjectID theKind = kAudioObjectUnknown;
 	
 	//	check the arguments
 	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_DoIOOperation: bad driver reference");
-	FailWithAction(inDeviceObjectID != kObjectID_Device && inDeviceObjectID != kObjectID_Device2, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_DoIOOperation: bad device ID");
-	FailWithAction((inStreamObjectID != kObjectID_Stream_Input) && (inStreamObjectID != kObjectID_Stream_Output), theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_DoIOOperation: bad stream ID");
-
-    // Calculate the ring buffer offsets and splits.
-    UInt64 mSampleTime = inOperationID == kAudioServerPlugInIOOperationReadInput ? inIOCycleInfo->mInputTime.mSampleTime : inIOCycleInfo->mOutputTime.mSampleTime;
-    UInt32 ringBufferFrameLocationStart = mSampleTime % kRing_Buffer_Frame_Size;
-    UInt32 firstPartFrameSize = kRing_Buffer_Frame_Size - ringBufferFrameLocationStart;
-    UInt32 secondPartFrameSize = 0;
-    
-    if (firstPartFrameSize >= inIOBufferFrameSize)
-    {
-        firstPartFrameSize = inIOBufferFrameSize;
-    }
-    else
-    {
-        secondPartFrameSize = inIOBufferFrameSize - firstPartFrameSize;
-    }
-    
-    // Thread-safe tracking of last outputSampleTime and buffer status
-    static atomic_uint_least64_t lastOutputSampleTimeAtomic = 0;
-    static atomic_bool isBufferClearAtomic = true;
+	FailWithAction(!find_device(inDeviceObjectID, &theInstance, &theKind), theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_DoIOOperation: bad device ID");
+	FailWithAction((inStreamObjectID != object_id(theInstance, kObjectID_Stream_Input)) && (inStreamObjectID != object_id(theInstance, kObjectID_Stream_Output)), theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_DoIOOperation: bad stream ID");
+
+    // NULL when IO isn't running; reads then produce silence and writes are dropped
+    VocanaDeviceIO* theIO = device_io(theInstance, theKind);
+    VocanaRingBuffer* theRingBuffer = VocanaRingBufferLifetime_BeginIO(&theIO->ringBufferLifetime);
     
     // From VocanaVirtualDevice to Application
     if(inOperationID == kAudioServerPlugInIOOperationReadInput)
     {
-        // If mute is one let's just fill the buffer with zeros or if there's no apps outputting audio
-        Float64 lastOutputSampleTime = atomic_load(&lastOutputSampleTimeAtomic);
-        if (gMute_Master_Value || lastOutputSampleTime - inIOBufferFrameSize < inIOCycleInfo->mInputTime.mSampleTime)
-        {
-            // Clear the ioMainBuffer
-            vDSP_vclr(ioMainBuffer, 1, inIOBufferFrameSize * kNumber_Of_Channels);
-            
-            // Clear the ring buffer.
-            bool isBufferClear = atomic_load(&isBufferClearAtomic);
-            if (!isBufferClear)
-            {
-                vDSP_vclr(gRingBuffer, 1, kRing_Buffer_Frame_Size * kNumber_Of_Channels);
-                atomic_store(&isBufferClearAtomic, true);
-            }
-        }
-        else
+        // Every client of this cycle sees the same mute and volume, even if a setter publishes
+        // a change part way through it
+        VocanaDeviceStateReader* theStateReader = &theIO->stateReader;
+        VocanaDeviceStateReader_BeginCycle(theStateReader, &theInstance->state, inIOCycleInfo->mIOCycleCounter);
+        UInt32 theChannelCount = (UInt32)atomic_load_explicit(&theInstance->ioChannelCount, memory_order_relaxed);
+        
+        // Publish the previous cycle's mix if it is still waiting for a writer that stopped
+        if (theRingBuffer != NULL)
         {
-            // Copy the buffers with bounds checking.
-            if (ringBufferFrameLocationStart + firstPartFrameSize > kRing_Buffer_Frame_Size ||
-                firstPartFrameSize > inIOBufferFrameSize ||
-                secondPartFrameSize > inIOBufferFrameSize) {
-                DebugMsg("VocanaVirtualDevice: Buffer bounds check failed");
-                return kAudioHardwareIllegalOperationError;
-            }
-            
-            // Copy the buffers with null checks
-            if (gRingBuffer != NULL) {
-                memcpy(ioMainBuffer, gRingBuffer + ringBufferFrameLocationStart * kNumber_Of_Channels, firstPartFrameSize * kNumber_Of_Channels * sizeof(Float32));
-                memcpy((Float32*)ioMainBuffer + firstPartFrameSize * kNumber_Of_Channels, gRingBuffer, secondPartFrameSize * kNumber_Of_Channels * sizeof(Float32));
-            } else {
-                // Ring buffer not allocated, clear output buffer
-                vDSP_vclr(ioMainBuffer, 1, inIOBufferFrameSize * kNumber_Of_Channels);
-            }
-            
-            // Finally we'll apply the output volume to the buffer.
-	    if(kEnableVolumeControl)
-	    {
-	 	vDSP_vsmul(ioMainBuffer, 1, &gVolume_Master_Value, ioMainBuffer, 1, inIOBufferFrameSize * kNumber_Of_Channels);
-	    }
-
+            VocanaMixBus_Flush(&theIO->mixBus, theRingBuffer, (UInt64)inIOCycleInfo->mOutputTime.mSampleTime);
         }
+        
+        // The input plays back what was written to this device and to its mirror. Each ring
+        // hands back silence for any frames no app has written (or that have already been
+        // overwritten), and so does the other device's while it isn't running.
+        VocanaDeviceIO* theOtherIO = other_device_io(theInstance, theKind);
+        VocanaRingBuffer* theRingBuffers[2] = { theRingBuffer, VocanaRingBufferLifetime_BeginIO(&theOtherIO->ringBufferLifetime) };
+        VocanaMixBus_Read(&theIO->mixBus, theRingBuffers, 2, (UInt64)inIOCycleInfo->mInputTime.mSampleTime, ioMainBuffer, inIOBufferFrameSize);
+        VocanaRingBufferLifetime_EndIO(&theOtherIO->ringBufferLifetime);
+        
+        // Finally we'll apply the mute and the output volume to the buffer, ramping over this
+        // cycle if either changed since the last one
+        VocanaDeviceStateReader_ApplyGain(theStateReader, ioMainBuffer, inIOBufferFrameSize, theChannelCount, kEnableVolumeControl);
     }
     
     // From Application to VocanaVirtualDevice
@@ -4603,34 +4232,17 @@ static OSStatus	VocanaVirtualDevice_DoIOOperation(AudioServerPlugInDriverRef inD
         {
             DebugMsg("VocanaVirtualDevice: Overload detected, attempting graceful recovery");
             
-            // Clear buffer to recover from overload using lock-free approach
-            if (gRingBuffer != NULL) {
-                // Use atomic flag to ensure thread-safe buffer clearing
-                static atomic_flag clearingFlag = ATOMIC_FLAG_INIT;
-                if (!atomic_flag_test_and_set(&clearingFlag)) {
-                    // Only one thread can clear at a time
-                    vDSP_vclr(gRingBuffer, 1, kRing_Buffer_Frame_Size * kNumber_Of_Channels);
-                    atomic_store(&gRingBufferWritePos, 0);
-                    atomic_store(&isBufferClearAtomic, true);
-                    atomic_flag_clear(&clearingFlag);
-                }
-            }
-            
-            // Return success but log the issue for monitoring
-            return noErr;
+            // Drop this cycle rather than writing behind the reader. The ring buffer silences the
+            // skipped frames on the next write, so nothing stale is read back.
         }
-        
-        
-        // Copy the buffers with null checks
-        if (gRingBuffer != NULL) {
-            memcpy(gRingBuffer + ringBufferFrameLocationStart * kNumber_Of_Channels, ioMainBuffer, firstPartFrameSize * kNumber_Of_Channels * sizeof(Float32));
-            memcpy(gRingBuffer, (Float32*)ioMainBuffer + firstPartFrameSize * kNumber_Of_Channels, secondPartFrameSize * kNumber_Of_Channels * sizeof(Float32));
+        else if (theRingBuffer != NULL)
+        {
+            // Sum into this cycle's mix; EndIOOperation publishes it once every writer is in
+            VocanaMixBus_Mix(&theIO->mixBus, theRingBuffer, inClientID, (UInt64)inIOCycleInfo->mOutputTime.mSampleTime, ioMainBuffer, inIOBufferFrameSize);
         }
-        
-        // Save the last output time.
-        atomic_store(&lastOutputSampleTimeAtomic, (uint_least64_t)(inIOCycleInfo->mOutputTime.mSampleTime + inIOBufferFrameSize));
-        atomic_store(&isBufferClearAtomic, false);
     }
+    
+    VocanaRingBufferLifetime_EndIO(&theIO->ringBufferLifetime);
 
 Done:
 	return theAnswer;
@@ -4638,17 +4250,30 @@ Done:
 
 static OSStatus	VocanaVirtualDevice_EndIOOperation(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID, UInt32 inClientID, UInt32 inOperationID, UInt32 inIOBufferFrameSize, const AudioServerPlugInIOCycleInfo* inIOCycleInfo)
 {
-	//	This is called at the end of an IO operation. This device doesn't do anything, so just check
-	//	the arguments and return.
+	//	This is called at the end of an IO operation. At the end of a WriteMix the mix bus publishes
+	//	the cycle's mix into the ring if this was the last writer it was waiting for.
 	
-	#pragma unused(inClientID, inOperationID, inIOBufferFrameSize, inIOCycleInfo, inDeviceObjectID)
+	#pragma unused(inClientID, inIOBufferFrameSize, inIOCycleInfo)
 	
 	//	declare the local variables
 	OSStatus theAnswer = 0;
+	VocanaDeviceInstance* theInstance = NULL;
+	AudioObjectID theKind = kAudioObjectUnknown;
 	
 	//	check the arguments
 	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_EndIOOperation: bad driver reference");
-	FailWithAction(inDeviceObjectID != kObjectID_Device && inDeviceObjectID != kObjectID_Device2, theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_EndIOOperation: bad device ID");
+	FailWithAction(!find_device(inDeviceObjectID, &theInstance, &theKind), theAnswer = kAudioHardwareBadObjectError, Done, "VocanaVirtualDevice_EndIOOperation: bad device ID");
+	
+	if(inOperationID == kAudioServerPlugInIOOperationWriteMix)
+	{
+		VocanaDeviceIO* theIO = device_io(theInstance, theKind);
+		VocanaRingBuffer* theRingBuffer = VocanaRingBufferLifetime_BeginIO(&theIO->ringBufferLifetime);
+		if(theRingBuffer != NULL)
+		{
+			VocanaMixBus_EndMix(&theIO->mixBus, theRingBuffer);
+		}
+		VocanaRingBufferLifetime_EndIO(&theIO->ringBufferLifetime);
+	}
 
 Done:
 	return theAnswer;
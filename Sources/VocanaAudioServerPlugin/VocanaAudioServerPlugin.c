@@ -14,8 +14,10 @@
 
 #include <CoreAudio/AudioServerPlugIn.h>
 #include <dispatch/dispatch.h>
+#include <errno.h>
 #include <mach/mach_time.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdint.h>
 #include <sys/syslog.h>
 #include <Accelerate/Accelerate.h>
@@ -23,6 +25,15 @@
 #include <CoreFoundation/CoreFoundation.h>
 #include <xpc/xpc.h>
 #include "VocanaAudioServerPlugin.h"
+#include "VocanaAudioTransport.h"
+#include "VocanaChannels.h"
+#include "VocanaClientScratch.h"
+#include "VocanaMixBus.h"
+#include "VocanaPipeline.h"
+#include "VocanaProcessor.h"
+#include "VocanaPropertyTable.h"
+#include "VocanaRingBuffer.h"
+#include "VocanaSpectralGate.h"
 
 //==================================================================================================
 // MARK: - Macros and Constants
@@ -38,6 +49,36 @@
 #define kAudioObjectPropertyElementMain kAudioObjectPropertyElementMaster
 #endif
 
+// Largest IO buffer the HAL asks for, and the depth of each transport queue
+#define kMax_IO_Frames 4096
+#define kTransport_Slots 4
+
+// The low bit of transportState, set once the service has attached the current transport
+#define kTransport_Ready 1u
+
+// The processed mix the input plays back, two of the largest IO buffers deep (a power of two)
+#define kRing_Buffer_Frames (2 * kMax_IO_Frames)
+#define kMix_Bus_Clip_Level 1.0f
+
+// How far behind the output plays the processed audio, so the service has that long to answer
+// without the IO thread ever waiting for it. The device declares it as its output latency. Zero
+// selects the synchronous mode, where each cycle waits for its own processed audio.
+#ifndef kProcessing_LookaheadFrames
+#define kProcessing_LookaheadFrames 1024
+#endif
+#define kProcessing_FadeFrames 128
+
+// The plugin's own spectral gate, so the device still plays cleaned audio when the app isn't
+// there to process it or doesn't answer in time. In pipelined mode its output is what the
+// pipeline falls back on, and its latency has to fit inside the lookahead. In synchronous mode it
+// runs ahead of the service, and its latency is the device's output latency. It may spend a
+// quarter of each cycle; after a run of slower cycles it is bypassed for a second.
+#ifndef kProcessing_InProcessDenoise
+#define kProcessing_InProcessDenoise 1
+#endif
+#define kProcessing_InProcessBudget 0.25
+#define kProcessing_InProcessBackoffSeconds 1.0
+
 // Logging macros
 #define DebugMsg(inFormat, ...) syslog(LOG_NOTICE, inFormat, ## __VA_ARGS__)
 #define ErrorMsg(inFormat, ...) syslog(LOG_ERR, "VocanaAudioServerPlugin ERROR: " inFormat, ## __VA_ARGS__)
@@ -67,27 +108,55 @@ typedef struct VocanaAudioServerPlugin {
     Boolean deviceCreated;
     AudioObjectID deviceObjectID;
 
-    // IO state
-    Boolean ioStarted;
+    // IO state: how many clients are running IO, counted by StartIO and StopIO
+    UInt32 runningClients;
     UInt32 clientCount;
 
-    // Audio format
+    // Audio format; channelCount is fixed when the plugin is created, see
+    // VocanaAudioServerPlugin_ConfiguredChannelCount
+    UInt32 channelCount;
     AudioStreamBasicDescription inputFormat;
     AudioStreamBasicDescription outputFormat;
 
-    // Buffer management
-    void *inputBuffer;
-    void *outputBuffer;
-    UInt32 bufferSize;
+    // Input and output scratch for each client, sized for kMax_IO_Frames up front so the IO
+    // path never reallocates when the HAL changes the buffer size
+    VocanaClientScratch scratch;
 
     // Timing
     Float64 sampleRate;
     UInt64 anchorHostTime;
 
-    // XPC connection for audio processing
+    // XPC connection to the processing service, only used to set up the transport
     xpc_connection_t xpcConnection;
     Boolean xpcConnected;
 
+    // Shared-memory transport the output cycles go through, usable once the service attached it.
+    // transportState holds the generation of the current transport shifted up one bit, with
+    // kTransport_Ready set once the service's reply to that generation's attach message arrives.
+    // A late reply to an earlier transport finds a different generation and changes nothing.
+    VocanaAudioTransport transport;
+    _Atomic UInt64 transportState;
+
+    // Set when the service went away with the transport attached; the next StartIO with no IO
+    // running attaches a new one
+    atomic_bool transportLost;
+
+    // Sums the clients' WriteMix buffers into one mix per cycle, which is processed once as it
+    // is published into the ring the input reads back
+    VocanaMixBus mixBus;
+    VocanaRingBuffer ringBuffer;
+
+    // Lines processed audio up kProcessing_LookaheadFrames late, in pipelined mode
+    VocanaPipeline pipeline;
+
+    // Denoises the audio the pipeline falls back on in pipelined mode, or every cycle ahead of the
+    // service in synchronous mode, when kProcessing_InProcessDenoise is set
+    VocanaProcessorStage denoiser;
+    Boolean hasDenoiser;
+
+    // Which properties each object has, built once in CreatePlugin
+    VocanaPropertyTable properties;
+
 } VocanaAudioServerPlugin;
 
 // Global plugin instance
@@ -97,6 +166,13 @@ static VocanaAudioServerPlugin *gPlugin = NULL;
 // MARK: - XPC Connection Management
 //==================================================================================================
 
+static void VocanaAudioServerPlugin_AttachTransport(VocanaAudioServerPlugin *plugin);
+static void VocanaAudioServerPlugin_DropTransport(VocanaAudioServerPlugin *plugin);
+
+static Boolean VocanaAudioServerPlugin_TransportReady(VocanaAudioServerPlugin *plugin) {
+    return (atomic_load_explicit(&plugin->transportState, memory_order_acquire) & kTransport_Ready) != 0;
+}
+
 static void VocanaAudioServerPlugin_ConnectToXPCService(VocanaAudioServerPlugin *plugin) {
     if (!plugin) return;
 
@@ -116,6 +192,7 @@ static void VocanaAudioServerPlugin_ConnectToXPCService(VocanaAudioServerPlugin
             if (event == XPC_ERROR_CONNECTION_INVALID) {
                 ErrorMsg("XPC connection invalid");
                 plugin->xpcConnected = false;
+                VocanaAudioServerPlugin_DropTransport(plugin);
             } else {
                 ErrorMsg("XPC connection error");
                 plugin->xpcConnected = false;
@@ -131,49 +208,328 @@ static void VocanaAudioServerPlugin_ConnectToXPCService(VocanaAudioServerPlugin
     plugin->xpcConnected = true;
 
     DebugMsg("Connected to XPC service");
+
+    VocanaAudioServerPlugin_AttachTransport(plugin);
 }
 
-static void VocanaAudioServerPlugin_ProcessAudioThroughXPC(VocanaAudioServerPlugin *plugin, void *audioBuffer, size_t bufferSize, UInt32 frameCount) {
-    if (!plugin || !plugin->xpcConnected || !plugin->xpcConnection || !audioBuffer) {
+// The output cycles themselves never go through XPC: the plugin creates a VocanaAudioTransport
+// and sends the service its descriptors once, and WriteMix then exchanges frames with the
+// service through shared memory.
+static void VocanaAudioServerPlugin_AttachTransport(VocanaAudioServerPlugin *plugin) {
+    int error = VocanaAudioTransport_Create(&plugin->transport, plugin->channelCount, kMax_IO_Frames, kTransport_Slots);
+    if (error != 0) {
+        ErrorMsg("Failed to create audio transport: %d", error);
         return;
     }
 
-    // Create XPC message
-    xpc_object_t message = xpc_dictionary_create(NULL, NULL, 0);
+    // a new generation, not ready until the service answers this message
+    UInt64 generation = (atomic_load_explicit(&plugin->transportState, memory_order_relaxed) >> 1) + 1;
+    atomic_store_explicit(&plugin->transportState, generation << 1, memory_order_release);
+
+    VocanaAudioTransportDescriptors descriptors;
+    VocanaAudioTransport_GetDescriptors(&plugin->transport, &descriptors);
 
-    // Add audio data as raw bytes
-    xpc_dictionary_set_data(message, "audioData", audioBuffer, bufferSize);
+    xpc_object_t message = xpc_dictionary_create(NULL, NULL, 0);
+    xpc_dictionary_set_string(message, "type", "attachTransport");
+    xpc_dictionary_set_fd(message, "memory", descriptors.memoryFD);
+    xpc_dictionary_set_fd(message, "requestBell", descriptors.requestBellFD);
+    xpc_dictionary_set_fd(message, "replyBell", descriptors.replyBellFD);
     xpc_dictionary_set_double(message, "sampleRate", plugin->sampleRate);
-    xpc_dictionary_set_int64(message, "channelCount", kNumber_Of_Channels);
+    xpc_dictionary_set_uint64(message, "generation", generation);
+
+    xpc_connection_send_message_with_reply(plugin->xpcConnection, message, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(xpc_object_t reply) {
+        if (xpc_get_type(reply) == XPC_TYPE_DICTIONARY && xpc_dictionary_get_int64(reply, "status") == 0 &&
+            xpc_dictionary_get_uint64(reply, "generation") == generation) {
+            // only marks the transport this message carried ready, and only if nothing has
+            // dropped or replaced it since
+            UInt64 expected = generation << 1;
+            if (atomic_compare_exchange_strong_explicit(&plugin->transportState, &expected, expected | kTransport_Ready, memory_order_release, memory_order_relaxed)) {
+                DebugMsg("Audio transport attached");
+            } else {
+                DebugMsg("Ignoring the reply for a replaced audio transport");
+            }
+        } else {
+            ErrorMsg("Service did not attach the audio transport");
+        }
+    });
+    xpc_release(message);
 
-    // Send message and wait for reply (synchronous for real-time audio)
-    xpc_object_t reply = xpc_connection_send_message_with_reply_sync(plugin->xpcConnection, message);
+    // the message holds its own duplicates of the descriptors
+    VocanaAudioTransport_CloseServiceDescriptors(&plugin->transport);
+}
 
-    if (xpc_get_type(reply) == XPC_TYPE_DICTIONARY) {
-        // Get processed audio data
-        const void *processedData;
-        size_t processedSize;
-        processedData = xpc_dictionary_get_data(reply, "processedAudioData", &processedSize);
+// The service has gone away. Called from the IO thread as well, so it only flags the transport:
+// the IO path stops using it at once, and ReattachTransport replaces it later.
+static void VocanaAudioServerPlugin_DropTransport(VocanaAudioServerPlugin *plugin) {
+    // moving on a generation also keeps a reply still on its way from marking it ready again
+    UInt64 state = atomic_load_explicit(&plugin->transportState, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&plugin->transportState, &state, ((state >> 1) + 1) << 1, memory_order_relaxed, memory_order_relaxed)) {
+    }
+    atomic_store_explicit(&plugin->transportLost, true, memory_order_relaxed);
+}
 
-        if (processedData && processedSize == bufferSize) {
-            // Copy processed audio back to buffer
-            memcpy(audioBuffer, processedData, bufferSize);
-            DebugMsg("Processed %u frames through XPC", frameCount);
-        } else {
-            ErrorMsg("Invalid processed audio data from XPC");
-        }
-    } else {
-        ErrorMsg("Failed to get reply from XPC service");
+// Replaces a dropped transport with a new one and sends it to the service, reconnecting first if
+// the connection itself was invalidated. Call with the mutex held and no IO running, since it
+// tears down the memory the IO path used.
+static void VocanaAudioServerPlugin_ReattachTransport(VocanaAudioServerPlugin *plugin) {
+    if (!atomic_exchange_explicit(&plugin->transportLost, false, memory_order_acquire)) {
+        return;
+    }
+    if (plugin->transport.shared) {
+        VocanaAudioTransport_Teardown(&plugin->transport);
+    }
+    if (plugin->xpcConnected) {
+        VocanaAudioServerPlugin_AttachTransport(plugin);
+        return;
+    }
+    if (plugin->xpcConnection) {
+        xpc_connection_cancel(plugin->xpcConnection);
+        xpc_release(plugin->xpcConnection);
+        plugin->xpcConnection = NULL;
+    }
+    VocanaAudioServerPlugin_ConnectToXPCService(plugin);
+}
+
+//==================================================================================================
+// MARK: - Property Management - Forward Declarations
+//==================================================================================================
+
+static OSStatus VocanaAudioServerPlugin_GetPlugInPropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, UInt32* outDataSize, void* outData);
+static OSStatus VocanaAudioServerPlugin_GetBoxPropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, UInt32* outDataSize, void* outData);
+static OSStatus VocanaAudioServerPlugin_GetDevicePropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, UInt32* outDataSize, void* outData);
+static OSStatus VocanaAudioServerPlugin_GetStreamPropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, UInt32* outDataSize, void* outData);
+static OSStatus VocanaAudioServerPlugin_GetControlPropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, UInt32* outDataSize, void* outData);
+
+//==================================================================================================
+// MARK: - Property Tables
+//==================================================================================================
+
+// Every object declares its properties once here; HasProperty, IsPropertySettable and
+// GetPropertyDataSize are all answered from the table built from these arrays, and GetPropertyData
+// reaches the getter of the object's class through the same lookup, so the getters below only see
+// properties the table says exist. Nothing is settable until SetPropertyData is implemented, so no
+// class has a setter.
+
+static UInt32 VocanaAudioServerPlugin_DeviceListSize(uint32_t inObjectID, uint32_t inScope) {
+    // deviceCreated is a single byte, so reading it without the mutex is fine here
+    return (gPlugin && gPlugin->deviceCreated) ? sizeof(AudioObjectID) : 0;
+}
+
+static UInt32 VocanaAudioServerPlugin_DeviceStreamsSize(uint32_t inObjectID, uint32_t inScope) {
+    switch (inScope) {
+        case kAudioObjectPropertyScopeInput:
+        case kAudioObjectPropertyScopeOutput:
+            return sizeof(AudioObjectID);
+        default:
+            return 2 * sizeof(AudioObjectID);
+    }
+}
+
+static UInt32 VocanaAudioServerPlugin_ChannelLayoutSize(uint32_t inObjectID, uint32_t inScope) {
+    UInt32 channelCount = gPlugin ? gPlugin->channelCount : kNumber_Of_Channels;
+    return (UInt32)offsetof(AudioChannelLayout, mChannelDescriptions) + channelCount * sizeof(AudioChannelDescription);
+}
+
+static const VocanaPropertySpec kPlugIn_Properties[] = {
+    { kAudioObjectPropertyManufacturer,             kVocanaPropertyScope_Any, 0, sizeof(CFStringRef),    NULL },
+    { kAudioObjectPropertyName,                     kVocanaPropertyScope_Any, 0, sizeof(CFStringRef),    NULL },
+    { kAudioPlugInPropertyDeviceList,               kVocanaPropertyScope_Any, 0, 0,                      VocanaAudioServerPlugin_DeviceListSize },
+    { kAudioPlugInPropertyTranslateUIDToDevice,     kVocanaPropertyScope_Any, 0, sizeof(AudioObjectID),  NULL },
+};
+
+static const VocanaPropertySpec kBox_Properties[] = {
+    { kAudioObjectPropertyName,                     kVocanaPropertyScope_Any, 0, sizeof(CFStringRef),    NULL },
+    { kAudioObjectPropertyManufacturer,             kVocanaPropertyScope_Any, 0, sizeof(CFStringRef),    NULL },
+    { kAudioBoxPropertyBoxUID,                      kVocanaPropertyScope_Any, 0, sizeof(CFStringRef),    NULL },
+    { kAudioBoxPropertyHasAudio,                    kVocanaPropertyScope_Any, 0, sizeof(UInt32),         NULL },
+    { kAudioBoxPropertyHasVideo,                    kVocanaPropertyScope_Any, 0, sizeof(UInt32),         NULL },
+    { kAudioBoxPropertyHasMIDI,                     kVocanaPropertyScope_Any, 0, sizeof(UInt32),         NULL },
+    { kAudioBoxPropertyIsProtected,                 kVocanaPropertyScope_Any, 0, sizeof(UInt32),         NULL },
+    { kAudioBoxPropertyAcquired,                    kVocanaPropertyScope_Any, 0, sizeof(UInt32),         NULL },
+    { kAudioBoxPropertyDeviceList,                  kVocanaPropertyScope_Any, 0, 0,                      VocanaAudioServerPlugin_DeviceListSize },
+};
+
+static const VocanaPropertySpec kDevice_Properties[] = {
+    { kAudioObjectPropertyName,                             kVocanaPropertyScope_Any, 0, sizeof(CFStringRef),     NULL },
+    { kAudioObjectPropertyManufacturer,                     kVocanaPropertyScope_Any, 0, sizeof(CFStringRef),     NULL },
+    { kAudioDevicePropertyDeviceUID,                        kVocanaPropertyScope_Any, 0, sizeof(CFStringRef),     NULL },
+    { kAudioDevicePropertyModelUID,                         kVocanaPropertyScope_Any, 0, sizeof(CFStringRef),     NULL },
+    { kAudioDevicePropertyTransportType,                    kVocanaPropertyScope_Any, 0, sizeof(UInt32),          NULL },
+    { kAudioDevicePropertyRelatedDevices,                   kVocanaPropertyScope_Any, 0, sizeof(AudioObjectID),   NULL },
+    { kAudioDevicePropertyClockDomain,                      kVocanaPropertyScope_Any, 0, sizeof(UInt32),          NULL },
+    { kAudioDevicePropertyDeviceIsAlive,                    kVocanaPropertyScope_Any, 0, sizeof(UInt32),          NULL },
+    { kAudioDevicePropertyDeviceIsRunning,                  kVocanaPropertyScope_Any, 0, sizeof(UInt32),          NULL },
+    { kAudioDevicePropertyDeviceCanBeDefaultDevice,         kVocanaPropertyScope_Any, 0, sizeof(UInt32),          NULL },
+    { kAudioDevicePropertyDeviceCanBeDefaultSystemDevice,   kVocanaPropertyScope_Any, 0, sizeof(UInt32),          NULL },
+    { kAudioDevicePropertyLatency,                          kVocanaPropertyScope_Any, 0, sizeof(UInt32),          NULL },
+    { kAudioDevicePropertyStreams,                          kVocanaPropertyScope_Any, 0, 0,                       VocanaAudioServerPlugin_DeviceStreamsSize },
+    { kAudioDevicePropertySafetyOffset,                     kVocanaPropertyScope_Any, 0, sizeof(UInt32),          NULL },
+    { kAudioDevicePropertyNominalSampleRate,                kVocanaPropertyScope_Any, 0, sizeof(Float64),         NULL },
+    { kAudioDevicePropertyAvailableNominalSampleRates,      kVocanaPropertyScope_Any, 0, sizeof(AudioValueRange), NULL },
+    { kAudioDevicePropertyIcon,                             kVocanaPropertyScope_Any, 0, sizeof(CFURLRef),        NULL },
+    { kAudioDevicePropertyIsHidden,                         kVocanaPropertyScope_Any, 0, sizeof(UInt32),          NULL },
+    { kAudioDevicePropertyPreferredChannelsForStereo,       kVocanaPropertyScope_Any, 0, 2 * sizeof(UInt32),      NULL },
+    { kAudioDevicePropertyPreferredChannelLayout,           kVocanaPropertyScope_Any, 0, 0,                       VocanaAudioServerPlugin_ChannelLayoutSize },
+};
+
+static const VocanaPropertySpec kStream_Properties[] = {
+    { kAudioObjectPropertyName,                     kVocanaPropertyScope_Any, 0, sizeof(CFStringRef),                   NULL },
+    { kAudioStreamPropertyDirection,                kVocanaPropertyScope_Any, 0, sizeof(UInt32),                        NULL },
+    { kAudioStreamPropertyTerminalType,             kVocanaPropertyScope_Any, 0, sizeof(UInt32),                        NULL },
+    { kAudioStreamPropertyStartingChannel,          kVocanaPropertyScope_Any, 0, sizeof(UInt32),                        NULL },
+    { kAudioStreamPropertyLatency,                  kVocanaPropertyScope_Any, 0, sizeof(UInt32),                        NULL },
+    { kAudioStreamPropertyVirtualFormat,            kVocanaPropertyScope_Any, 0, sizeof(AudioStreamBasicDescription),   NULL },
+    { kAudioStreamPropertyAvailableVirtualFormats,  kVocanaPropertyScope_Any, 0, sizeof(AudioStreamRangedDescription),  NULL },
+    { kAudioStreamPropertyPhysicalFormat,           kVocanaPropertyScope_Any, 0, sizeof(AudioStreamBasicDescription),   NULL },
+    { kAudioStreamPropertyAvailablePhysicalFormats, kVocanaPropertyScope_Any, 0, sizeof(AudioStreamRangedDescription),  NULL },
+};
+
+static const VocanaPropertySpec kVolume_Properties[] = {
+    { kAudioObjectPropertyName,                     kVocanaPropertyScope_Any, 0, sizeof(CFStringRef),                   NULL },
+    { kAudioControlPropertyScope,                   kVocanaPropertyScope_Any, 0, sizeof(AudioObjectPropertyScope),      NULL },
+    { kAudioControlPropertyElement,                 kVocanaPropertyScope_Any, 0, sizeof(AudioObjectPropertyElement),    NULL },
+    { kAudioLevelControlPropertyScalarValue,        kVocanaPropertyScope_Any, 0, sizeof(Float32),                       NULL },
+    { kAudioLevelControlPropertyDecibelValue,       kVocanaPropertyScope_Any, 0, sizeof(Float32),                       NULL },
+    { kAudioLevelControlPropertyDecibelRange,       kVocanaPropertyScope_Any, 0, sizeof(AudioValueRange),               NULL },
+};
+
+static const VocanaPropertySpec kMute_Properties[] = {
+    { kAudioObjectPropertyName,                     kVocanaPropertyScope_Any, 0, sizeof(CFStringRef),                   NULL },
+    { kAudioControlPropertyScope,                   kVocanaPropertyScope_Any, 0, sizeof(AudioObjectPropertyScope),      NULL },
+    { kAudioControlPropertyElement,                 kVocanaPropertyScope_Any, 0, sizeof(AudioObjectPropertyElement),    NULL },
+    { kAudioBooleanControlPropertyValue,            kVocanaPropertyScope_Any, 0, sizeof(UInt32),                        NULL },
+};
+
+typedef OSStatus (*VocanaAudioServerPlugin_GetPropertyDataProc)(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, UInt32* outDataSize, void* outData);
+
+#define VocanaPropertyClass(inObjectID, inSpecs, inClass) { (inObjectID), (inSpecs), sizeof(inSpecs) / sizeof((inSpecs)[0]), (VocanaPropertyProc)VocanaAudioServerPlugin_Get##inClass##PropertyData }
+
+static const struct {
+    AudioObjectID objectID;
+    const VocanaPropertySpec *specs;
+    UInt32 specCount;
+    VocanaPropertyProc getProc;
+} kPropertyClasses[] = {
+    VocanaPropertyClass(kObjectID_PlugIn,               kPlugIn_Properties,     PlugIn),
+    VocanaPropertyClass(kObjectID_Box,                  kBox_Properties,        Box),
+    VocanaPropertyClass(kObjectID_Device,               kDevice_Properties,     Device),
+    VocanaPropertyClass(kObjectID_Stream_Input,         kStream_Properties,     Stream),
+    VocanaPropertyClass(kObjectID_Stream_Output,        kStream_Properties,     Stream),
+    VocanaPropertyClass(kObjectID_Volume_Input_Master,  kVolume_Properties,     Control),
+    VocanaPropertyClass(kObjectID_Volume_Output_Master, kVolume_Properties,     Control),
+    VocanaPropertyClass(kObjectID_Mute_Input_Master,    kMute_Properties,       Control),
+    VocanaPropertyClass(kObjectID_Mute_Output_Master,   kMute_Properties,       Control),
+};
+
+static int VocanaAudioServerPlugin_BuildPropertyTable(VocanaPropertyTable *table) {
+    const UInt32 classCount = sizeof(kPropertyClasses) / sizeof(kPropertyClasses[0]);
+    UInt32 capacity = 0;
+    for (UInt32 i = 0; i < classCount; i++) {
+        capacity += kPropertyClasses[i].specCount + 1;
     }
 
-    if (message) xpc_release(message);
-    if (reply) xpc_release(reply);
+    int error = VocanaPropertyTable_Init(table, capacity);
+    for (UInt32 i = 0; error == 0 && i < classCount; i++) {
+        error = VocanaPropertyTable_AddObject(table, kPropertyClasses[i].objectID, kPropertyClasses[i].specs, kPropertyClasses[i].specCount, kPropertyClasses[i].getProc, NULL);
+    }
+    if (error == 0) {
+        error = VocanaPropertyTable_Build(table);
+    }
+    if (error != 0) {
+        VocanaPropertyTable_Teardown(table);
+    }
+    return error;
 }
 
 //==================================================================================================
 // MARK: - Utility Functions
 //==================================================================================================
 
+// The streams carry kNumber_Of_Channels unless the bundle's Info.plist says otherwise under
+// kVocanaChannels_InfoKey, so a copy of the plugin can be set up as an 8-channel device.
+static UInt32 VocanaAudioServerPlugin_ConfiguredChannelCount(void) {
+    UInt32 channelCount = kNumber_Of_Channels;
+    CFBundleRef bundle = CFBundleGetBundleWithIdentifier(CFSTR(kPlugIn_BundleID));
+    CFTypeRef value = bundle ? CFBundleGetValueForInfoDictionaryKey(bundle, CFSTR(kVocanaChannels_InfoKey)) : NULL;
+    SInt32 configured = 0;
+    if (value && CFGetTypeID(value) == CFNumberGetTypeID() && CFNumberGetValue((CFNumberRef)value, kCFNumberSInt32Type, &configured)) {
+        if (configured > 0 && VocanaChannels_IsValidCount((UInt32)configured)) {
+            channelCount = (UInt32)configured;
+        } else {
+            ErrorMsg("Ignoring unsupported channel count %d", (int)configured);
+        }
+    }
+    return channelCount;
+}
+
+// How late the output plays what it is given: the lookahead in pipelined mode, which the
+// denoiser's latency fits inside, and the denoiser's latency in synchronous mode
+static UInt32 VocanaAudioServerPlugin_OutputLatency(const VocanaAudioServerPlugin *plugin) {
+#if kProcessing_LookaheadFrames > 0
+    return kProcessing_LookaheadFrames;
+#else
+    return plugin->hasDenoiser ? VocanaProcessorStage_GetLatency(&plugin->denoiser) : 0;
+#endif
+}
+
+// The mix bus processor: runs each cycle's mix, summed over every client that wrote to it, through
+// the denoiser and the service once, in place, so what the bus publishes is what the output plays.
+// Only the device's IO thread runs it, so the device's scratch area is free for it to use.
+static void VocanaAudioServerPlugin_ProcessMix(void *inContext, uint64_t inFrame, float *ioFrames, uint32_t inFrameCount) {
+    VocanaAudioServerPlugin *plugin = (VocanaAudioServerPlugin *)inContext;
+    Boolean transportReady = VocanaAudioServerPlugin_TransportReady(plugin);
+#if kProcessing_LookaheadFrames > 0
+    // Pipelined: hand this cycle to the service without waiting, take in whatever it has finished
+    // since, and play what came in kProcessing_LookaheadFrames ago, processed if it is back and
+    // dry if it isn't.
+    if (transportReady) {
+        // A full queue just means the service is behind and this cycle plays the fallback; a
+        // service that is gone stops being used until it is re-attached
+        int error = VocanaAudioTransport_Submit(&plugin->transport, inFrame, ioFrames, inFrameCount);
+        if (error == EPIPE) {
+            VocanaAudioServerPlugin_DropTransport(plugin);
+        }
+
+        VocanaAudioTransportRequest reply;
+        const float *replyFrames;
+        while (VocanaAudioTransport_PeekReply(&plugin->transport, &reply, &replyFrames)) {
+            VocanaPipeline_PushWet(&plugin->pipeline, reply.sampleTime, replyFrames, reply.frameCount);
+            VocanaAudioTransport_ReleaseReply(&plugin->transport);
+        }
+    }
+    if (plugin->hasDenoiser) {
+        // What the pipeline falls back on is the in-process denoiser's output, filed under the
+        // sample time its input came in at so it lines up with the replies
+        float *inputScratch;
+        float *outputScratch;
+        VocanaClientScratch_GetDeviceArea(&plugin->scratch, &inputScratch, &outputScratch);
+        VocanaProcessorStage_Process(&plugin->denoiser, ioFrames, outputScratch, inFrameCount);
+        UInt32 latency = VocanaProcessorStage_GetLatency(&plugin->denoiser);
+        if (inFrame + inFrameCount > latency) {
+            UInt32 skip = inFrame < latency ? (UInt32)(latency - inFrame) : 0;
+            VocanaPipeline_PushDry(&plugin->pipeline, inFrame + skip - latency, outputScratch + (size_t)skip * plugin->channelCount, inFrameCount - skip);
+        }
+    } else {
+        VocanaPipeline_PushDry(&plugin->pipeline, inFrame, ioFrames, inFrameCount);
+    }
+    VocanaPipeline_Render(&plugin->pipeline, inFrame, ioFrames, inFrameCount);
+#else
+    // Synchronous: the denoiser runs first, so the service is handed cleaned audio and a cycle it
+    // doesn't hand back within half an IO period goes out denoised rather than raw. Either way
+    // the output is the denoiser's latency late.
+    if (plugin->hasDenoiser) {
+        VocanaProcessorStage_Process(&plugin->denoiser, ioFrames, ioFrames, inFrameCount);
+    }
+    if (transportReady) {
+        UInt64 budget = (UInt64)(inFrameCount * 0.5e9 / plugin->sampleRate);
+        int error = VocanaAudioTransport_Process(&plugin->transport, inFrame, ioFrames, inFrameCount, budget);
+        if (error == EPIPE) {
+            VocanaAudioServerPlugin_DropTransport(plugin);
+        }
+    }
+#endif
+}
+
 static OSStatus VocanaAudioServerPlugin_CreatePlugin(AudioServerPlugInDriverRef *outDriver) {
     if (!outDriver) {
         return kAudioHardwareIllegalOperationError;
@@ -190,28 +546,100 @@ static OSStatus VocanaAudioServerPlugin_CreatePlugin(AudioServerPlugInDriverRef
         return kAudioHardwareUnspecifiedError;
     }
 
+    plugin->channelCount = VocanaAudioServerPlugin_ConfiguredChannelCount();
+
+    // Build the property table
+    int tableError = VocanaAudioServerPlugin_BuildPropertyTable(&plugin->properties);
+    if (tableError != 0) {
+        pthread_mutex_destroy(&plugin->mutex);
+        free(plugin);
+        ErrorMsg("Failed to build property table: %d", tableError);
+        return kAudioHardwareUnspecifiedError;
+    }
+
+    int scratchError = VocanaClientScratch_Init(&plugin->scratch, kMax_IO_Frames, plugin->channelCount);
+    if (scratchError != 0) {
+        VocanaPropertyTable_Teardown(&plugin->properties);
+        pthread_mutex_destroy(&plugin->mutex);
+        free(plugin);
+        ErrorMsg("Failed to allocate client scratch buffers: %d", scratchError);
+        return kAudioHardwareUnspecifiedError;
+    }
+
+    int ringError = VocanaRingBuffer_Init(&plugin->ringBuffer, kRing_Buffer_Frames, plugin->channelCount, 0);
+    if (ringError != 0) {
+        VocanaClientScratch_Teardown(&plugin->scratch);
+        VocanaPropertyTable_Teardown(&plugin->properties);
+        pthread_mutex_destroy(&plugin->mutex);
+        free(plugin);
+        ErrorMsg("Failed to allocate the ring buffer: %d", ringError);
+        return kAudioHardwareUnspecifiedError;
+    }
+
+    int mixBusError = VocanaMixBus_Init(&plugin->mixBus, kMax_IO_Frames, plugin->channelCount, kMix_Bus_Clip_Level);
+    if (mixBusError != 0) {
+        VocanaRingBuffer_Teardown(&plugin->ringBuffer);
+        VocanaClientScratch_Teardown(&plugin->scratch);
+        VocanaPropertyTable_Teardown(&plugin->properties);
+        pthread_mutex_destroy(&plugin->mutex);
+        free(plugin);
+        ErrorMsg("Failed to allocate the mix bus: %d", mixBusError);
+        return kAudioHardwareUnspecifiedError;
+    }
+    VocanaMixBus_SetProcessor(&plugin->mixBus, VocanaAudioServerPlugin_ProcessMix, plugin);
+
+#if kProcessing_LookaheadFrames > 0
+    int pipelineError = VocanaPipeline_Init(&plugin->pipeline, plugin->channelCount, kMax_IO_Frames, kProcessing_LookaheadFrames, kProcessing_FadeFrames);
+    if (pipelineError != 0) {
+        VocanaMixBus_Teardown(&plugin->mixBus);
+        VocanaRingBuffer_Teardown(&plugin->ringBuffer);
+        VocanaClientScratch_Teardown(&plugin->scratch);
+        VocanaPropertyTable_Teardown(&plugin->properties);
+        pthread_mutex_destroy(&plugin->mutex);
+        free(plugin);
+        ErrorMsg("Failed to allocate processing pipeline: %d", pipelineError);
+        return kAudioHardwareUnspecifiedError;
+    }
+#endif
+
     // Initialize audio formats
     plugin->sampleRate = 48000.0;
     plugin->inputFormat.mSampleRate = plugin->sampleRate;
     plugin->inputFormat.mFormatID = kAudioFormatLinearPCM;
     plugin->inputFormat.mFormatFlags = kAudioFormatFlagIsFloat | kAudioFormatFlagIsPacked;
-    plugin->inputFormat.mBytesPerPacket = kNumber_Of_Channels * kBytes_Per_Channel;
+    plugin->inputFormat.mBytesPerPacket = plugin->channelCount * kBytes_Per_Channel;
     plugin->inputFormat.mFramesPerPacket = 1;
-    plugin->inputFormat.mBytesPerFrame = kNumber_Of_Channels * kBytes_Per_Channel;
-    plugin->inputFormat.mChannelsPerFrame = kNumber_Of_Channels;
+    plugin->inputFormat.mBytesPerFrame = plugin->channelCount * kBytes_Per_Channel;
+    plugin->inputFormat.mChannelsPerFrame = plugin->channelCount;
     plugin->inputFormat.mBitsPerChannel = kBits_Per_Channel;
 
     plugin->outputFormat = plugin->inputFormat;
 
     // Initialize state
     plugin->deviceCreated = false;
-    plugin->ioStarted = false;
+    plugin->runningClients = 0;
     plugin->clientCount = 0;
-    plugin->bufferSize = 1024; // Default buffer size
+
+    // Set up the in-process denoiser; the device works without it, just with dry fallback audio
+    plugin->hasDenoiser = false;
+#if kProcessing_InProcessDenoise
+    VocanaProcessorConfiguration denoiserConfiguration = { plugin->sampleRate, plugin->channelCount, kMax_IO_Frames };
+    int denoiserError = VocanaProcessorStage_Init(&plugin->denoiser, VocanaSpectralGate_GetInterface(), &denoiserConfiguration, kProcessing_InProcessBudget, (UInt32)(kProcessing_InProcessBackoffSeconds * plugin->sampleRate), kProcessing_FadeFrames);
+    if (denoiserError != 0) {
+        ErrorMsg("Failed to create in-process denoiser: %d", denoiserError);
+    } else if (kProcessing_LookaheadFrames > 0 && VocanaProcessorStage_GetLatency(&plugin->denoiser) > kProcessing_LookaheadFrames) {
+        ErrorMsg("In-process denoiser latency %u exceeds the lookahead", VocanaProcessorStage_GetLatency(&plugin->denoiser));
+        VocanaProcessorStage_Teardown(&plugin->denoiser);
+    } else {
+        plugin->hasDenoiser = true;
+    }
+#endif
 
     // Initialize XPC connection
     plugin->xpcConnection = NULL;
     plugin->xpcConnected = false;
+    atomic_init(&plugin->transportState, 0);
+    atomic_init(&plugin->transportLost, false);
 
     // Connect to XPC service
     VocanaAudioServerPlugin_ConnectToXPCService(plugin);
@@ -226,24 +654,25 @@ static OSStatus VocanaAudioServerPlugin_CreatePlugin(AudioServerPlugInDriverRef
 static void VocanaAudioServerPlugin_DestroyPlugin(VocanaAudioServerPlugin *plugin) {
     if (!plugin) return;
 
-    // Clean up resources
-    if (plugin->inputBuffer) {
-        free(plugin->inputBuffer);
-        plugin->inputBuffer = NULL;
-    }
-
-    if (plugin->outputBuffer) {
-        free(plugin->outputBuffer);
-        plugin->outputBuffer = NULL;
-    }
-
     // Clean up XPC connection
     if (plugin->xpcConnection) {
         xpc_connection_cancel(plugin->xpcConnection);
         plugin->xpcConnection = NULL;
         plugin->xpcConnected = false;
     }
+    VocanaAudioServerPlugin_DropTransport(plugin);
+    if (plugin->transport.shared) {
+        VocanaAudioTransport_Teardown(&plugin->transport);
+    }
 
+    if (plugin->hasDenoiser) {
+        VocanaProcessorStage_Teardown(&plugin->denoiser);
+    }
+    VocanaPipeline_Teardown(&plugin->pipeline);
+    VocanaMixBus_Teardown(&plugin->mixBus);
+    VocanaRingBuffer_Teardown(&plugin->ringBuffer);
+    VocanaClientScratch_Teardown(&plugin->scratch);
+    VocanaPropertyTable_Teardown(&plugin->properties);
     pthread_mutex_destroy(&plugin->mutex);
     free(plugin);
     gPlugin = NULL;
@@ -367,6 +796,20 @@ static OSStatus VocanaAudioServerPlugin_AddDeviceClient(AudioServerPlugInDriverR
         return kAudioHardwareBadObjectError;
     }
 
+    if (!inClientInfo) {
+        return kAudioHardwareIllegalOperationError;
+    }
+
+    // A client that finds every area taken still runs IO, on the device's scratch
+    if (!VocanaClientScratch_AddClient(&plugin->scratch, inClientInfo->mClientID)) {
+        ErrorMsg("No scratch buffers left for client %u, using the device's", inClientInfo->mClientID);
+    }
+
+    // Likewise one the mix bus has no slot for mixes as the cycle's anonymous writer
+    if (!VocanaMixBus_AddClient(&plugin->mixBus, inClientInfo->mClientID)) {
+        ErrorMsg("No mix bus slot left for client %u", inClientInfo->mClientID);
+    }
+
     pthread_mutex_lock(&plugin->mutex);
     plugin->clientCount++;
     pthread_mutex_unlock(&plugin->mutex);
@@ -382,6 +825,11 @@ static OSStatus VocanaAudioServerPlugin_RemoveDeviceClient(AudioServerPlugInDriv
         return kAudioHardwareBadObjectError;
     }
 
+    if (inClientInfo) {
+        VocanaClientScratch_RemoveClient(&plugin->scratch, inClientInfo->mClientID);
+        VocanaMixBus_RemoveClient(&plugin->mixBus, inClientInfo->mClientID);
+    }
+
     pthread_mutex_lock(&plugin->mutex);
     if (plugin->clientCount > 0) {
         plugin->clientCount--;
@@ -392,27 +840,6 @@ static OSStatus VocanaAudioServerPlugin_RemoveDeviceClient(AudioServerPlugInDriv
     return kAudioHardwareNoError;
 }
 
-//==================================================================================================
-// MARK: - Property Management - Forward Declarations
-//==================================================================================================
-
-static Boolean VocanaAudioServerPlugin_HasPlugInProperty(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress);
-static Boolean VocanaAudioServerPlugin_HasBoxProperty(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress);
-static Boolean VocanaAudioServerPlugin_HasDeviceProperty(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress);
-static Boolean VocanaAudioServerPlugin_HasStreamProperty(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress);
-static Boolean VocanaAudioServerPlugin_HasControlProperty(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress);
-
-static OSStatus VocanaAudioServerPlugin_GetPlugInPropertyDataSize(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32* outDataSize);
-static OSStatus VocanaAudioServerPlugin_GetPlugInPropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, UInt32* outDataSize, void* outData);
-static OSStatus VocanaAudioServerPlugin_GetBoxPropertyDataSize(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32* outDataSize);
-static OSStatus VocanaAudioServerPlugin_GetBoxPropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, UInt32* outDataSize, void* outData);
-static OSStatus VocanaAudioServerPlugin_GetDevicePropertyDataSize(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32* outDataSize);
-static OSStatus VocanaAudioServerPlugin_GetDevicePropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, UInt32* outDataSize, void* outData);
-static OSStatus VocanaAudioServerPlugin_GetStreamPropertyDataSize(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32* outDataSize);
-static OSStatus VocanaAudioServerPlugin_GetStreamPropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, UInt32* outDataSize, void* outData);
-static OSStatus VocanaAudioServerPlugin_GetControlPropertyDataSize(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32* outDataSize);
-static OSStatus VocanaAudioServerPlugin_GetControlPropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, UInt32* outDataSize, void* outData);
-
 //==================================================================================================
 // MARK: - Property Management
 //==================================================================================================
@@ -424,271 +851,107 @@ static Boolean VocanaAudioServerPlugin_HasProperty(AudioServerPlugInDriverRef in
         return false;
     }
 
-    Boolean hasProperty = false;
-
-    switch (inObjectID) {
-        case kObjectID_PlugIn:
-            hasProperty = VocanaAudioServerPlugin_HasPlugInProperty(inDriver, inObjectID, inClientProcessID, inAddress);
-            break;
-        case kObjectID_Box:
-            hasProperty = VocanaAudioServerPlugin_HasBoxProperty(inDriver, inObjectID, inClientProcessID, inAddress);
-            break;
-        case kObjectID_Device:
-            hasProperty = VocanaAudioServerPlugin_HasDeviceProperty(inDriver, inObjectID, inClientProcessID, inAddress);
-            break;
-        case kObjectID_Stream_Input:
-        case kObjectID_Stream_Output:
-            hasProperty = VocanaAudioServerPlugin_HasStreamProperty(inDriver, inObjectID, inClientProcessID, inAddress);
-            break;
-        case kObjectID_Volume_Input_Master:
-        case kObjectID_Volume_Output_Master:
-        case kObjectID_Mute_Input_Master:
-        case kObjectID_Mute_Output_Master:
-            hasProperty = VocanaAudioServerPlugin_HasControlProperty(inDriver, inObjectID, inClientProcessID, inAddress);
-            break;
-        default:
-            hasProperty = false;
-            break;
-    }
-
-    return hasProperty;
-}
-
-static Boolean VocanaAudioServerPlugin_HasPlugInProperty(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress) {
-    if (inObjectID != kObjectID_PlugIn) {
-        return false;
-    }
-
-    switch (inAddress->mSelector) {
-        case kAudioObjectPropertyManufacturer:
-        case kAudioObjectPropertyName:
-        case kAudioPlugInPropertyDeviceList:
-        case kAudioPlugInPropertyTranslateUIDToDevice:
-            return true;
-        default:
-            return false;
-    }
-}
-
-static Boolean VocanaAudioServerPlugin_HasBoxProperty(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress) {
-    if (inObjectID != kObjectID_Box) {
-        return false;
-    }
-
-    switch (inAddress->mSelector) {
-        case kAudioObjectPropertyName:
-        case kAudioObjectPropertyManufacturer:
-        case kAudioBoxPropertyBoxUID:
-        case kAudioBoxPropertyHasAudio:
-        case kAudioBoxPropertyHasVideo:
-        case kAudioBoxPropertyHasMIDI:
-        case kAudioBoxPropertyIsProtected:
-        case kAudioBoxPropertyAcquired:
-        case kAudioBoxPropertyDeviceList:
-            return true;
-        default:
-            return false;
-    }
-}
-
-static Boolean VocanaAudioServerPlugin_HasDeviceProperty(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress) {
-    VocanaAudioServerPlugin *plugin = (VocanaAudioServerPlugin *)inDriver;
-
-    if (!plugin || inObjectID != kObjectID_Device) {
-        return false;
-    }
-
-    switch (inAddress->mSelector) {
-        case kAudioObjectPropertyName:
-        case kAudioObjectPropertyManufacturer:
-        case kAudioDevicePropertyDeviceUID:
-        case kAudioDevicePropertyModelUID:
-        case kAudioDevicePropertyTransportType:
-        case kAudioDevicePropertyRelatedDevices:
-        case kAudioDevicePropertyClockDomain:
-        case kAudioDevicePropertyDeviceIsAlive:
-        case kAudioDevicePropertyDeviceIsRunning:
-        case kAudioDevicePropertyDeviceCanBeDefaultDevice:
-        case kAudioDevicePropertyDeviceCanBeDefaultSystemDevice:
-        case kAudioDevicePropertyLatency:
-        case kAudioDevicePropertyStreams:
-        case kAudioDevicePropertySafetyOffset:
-        case kAudioDevicePropertyNominalSampleRate:
-        case kAudioDevicePropertyAvailableNominalSampleRates:
-        case kAudioDevicePropertyIcon:
-        case kAudioDevicePropertyIsHidden:
-        case kAudioDevicePropertyPreferredChannelsForStereo:
-        case kAudioDevicePropertyPreferredChannelLayout:
-            return true;
-        default:
-            return false;
-    }
+    return VocanaPropertyTable_Find(&plugin->properties, inObjectID, inAddress->mSelector, inAddress->mScope) != NULL;
 }
 
-static Boolean VocanaAudioServerPlugin_HasStreamProperty(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress) {
+static OSStatus VocanaAudioServerPlugin_IsPropertySettable(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, Boolean* outIsSettable) {
     VocanaAudioServerPlugin *plugin = (VocanaAudioServerPlugin *)inDriver;
 
-    if (!plugin) {
-        return false;
+    if (!plugin || !inAddress || !outIsSettable) {
+        return kAudioHardwareIllegalOperationError;
     }
 
-    Boolean isInputStream = (inObjectID == kObjectID_Stream_Input);
-    Boolean isOutputStream = (inObjectID == kObjectID_Stream_Output);
-
-    if (!isInputStream && !isOutputStream) {
-        return false;
+    const VocanaPropertyEntry *property = VocanaPropertyTable_Find(&plugin->properties, inObjectID, inAddress->mSelector, inAddress->mScope);
+    if (!property) {
+        return VocanaPropertyTable_HasObject(&plugin->properties, inObjectID) ? kAudioHardwareUnknownPropertyError : kAudioHardwareBadObjectError;
     }
 
-    switch (inAddress->mSelector) {
-        case kAudioObjectPropertyName:
-        case kAudioStreamPropertyDirection:
-        case kAudioStreamPropertyTerminalType:
-        case kAudioStreamPropertyStartingChannel:
-        case kAudioStreamPropertyLatency:
-        case kAudioStreamPropertyVirtualFormat:
-        case kAudioStreamPropertyAvailableVirtualFormats:
-        case kAudioStreamPropertyPhysicalFormat:
-        case kAudioStreamPropertyAvailablePhysicalFormats:
-            return true;
-        default:
-            return false;
-    }
+    *outIsSettable = VocanaPropertyEntry_IsSettable(property);
+    return kAudioHardwareNoError;
 }
 
-static Boolean VocanaAudioServerPlugin_HasControlProperty(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress) {
+static OSStatus VocanaAudioServerPlugin_GetPropertyDataSize(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32* outDataSize) {
     VocanaAudioServerPlugin *plugin = (VocanaAudioServerPlugin *)inDriver;
 
-    if (!plugin) {
-        return false;
+    if (!plugin || !inAddress || !outDataSize) {
+        return kAudioHardwareIllegalOperationError;
     }
 
-    Boolean isVolumeControl = (inObjectID == kObjectID_Volume_Input_Master || inObjectID == kObjectID_Volume_Output_Master);
-    Boolean isMuteControl = (inObjectID == kObjectID_Mute_Input_Master || inObjectID == kObjectID_Mute_Output_Master);
-
-    if (!isVolumeControl && !isMuteControl) {
-        return false;
+    const VocanaPropertyEntry *property = VocanaPropertyTable_Find(&plugin->properties, inObjectID, inAddress->mSelector, inAddress->mScope);
+    if (!property) {
+        return VocanaPropertyTable_HasObject(&plugin->properties, inObjectID) ? kAudioHardwareUnknownPropertyError : kAudioHardwareBadObjectError;
     }
 
-    switch (inAddress->mSelector) {
-        case kAudioObjectPropertyName:
-        case kAudioControlPropertyScope:
-        case kAudioControlPropertyElement:
-        case kAudioLevelControlPropertyScalarValue:
-        case kAudioLevelControlPropertyDecibelValue:
-        case kAudioLevelControlPropertyDecibelRange:
-        case kAudioBooleanControlPropertyValue:
-            return true;
-        default:
-            return false;
-    }
+    *outDataSize = VocanaPropertyEntry_GetSize(property, inAddress->mScope);
+    return kAudioHardwareNoError;
 }
 
 //==================================================================================================
 // MARK: - Property Data Access (Stubs for now)
 //==================================================================================================
 
-static OSStatus VocanaAudioServerPlugin_IsPropertySettable(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, Boolean* outIsSettable) {
-    // For now, most properties are read-only
-    *outIsSettable = false;
-    return kAudioHardwareNoError;
-}
-
-static OSStatus VocanaAudioServerPlugin_GetPropertyDataSize(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32* outDataSize) {
-    OSStatus result = kAudioHardwareUnknownPropertyError;
+static OSStatus VocanaAudioServerPlugin_GetPropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, UInt32* outDataSize, void* outData) {
+    VocanaAudioServerPlugin *plugin = (VocanaAudioServerPlugin *)inDriver;
 
-    switch (inObjectID) {
-        case kObjectID_PlugIn:
-            result = VocanaAudioServerPlugin_GetPlugInPropertyDataSize(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, outDataSize);
-            break;
-        case kObjectID_Box:
-            result = VocanaAudioServerPlugin_GetBoxPropertyDataSize(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, outDataSize);
-            break;
-        case kObjectID_Device:
-            result = VocanaAudioServerPlugin_GetDevicePropertyDataSize(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, outDataSize);
-            break;
-        case kObjectID_Stream_Input:
-        case kObjectID_Stream_Output:
-            result = VocanaAudioServerPlugin_GetStreamPropertyDataSize(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, outDataSize);
-            break;
-        case kObjectID_Volume_Input_Master:
-        case kObjectID_Volume_Output_Master:
-        case kObjectID_Mute_Input_Master:
-        case kObjectID_Mute_Output_Master:
-            result = VocanaAudioServerPlugin_GetControlPropertyDataSize(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, outDataSize);
-            break;
+    if (!plugin || !inAddress) {
+        return kAudioHardwareIllegalOperationError;
     }
 
-    return result;
-}
-
-static OSStatus VocanaAudioServerPlugin_GetPropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, UInt32* outDataSize, void* outData) {
-    OSStatus result = kAudioHardwareUnknownPropertyError;
-
-    switch (inObjectID) {
-        case kObjectID_PlugIn:
-            result = VocanaAudioServerPlugin_GetPlugInPropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, outDataSize, outData);
-            break;
-        case kObjectID_Box:
-            result = VocanaAudioServerPlugin_GetBoxPropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, outDataSize, outData);
-            break;
-        case kObjectID_Device:
-            result = VocanaAudioServerPlugin_GetDevicePropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, outDataSize, outData);
-            break;
-        case kObjectID_Stream_Input:
-        case kObjectID_Stream_Output:
-            result = VocanaAudioServerPlugin_GetStreamPropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, outDataSize, outData);
-            break;
-        case kObjectID_Volume_Input_Master:
-        case kObjectID_Volume_Output_Master:
-        case kObjectID_Mute_Input_Master:
-        case kObjectID_Mute_Output_Master:
-            result = VocanaAudioServerPlugin_GetControlPropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, outDataSize, outData);
-            break;
+    const VocanaPropertyEntry *property = VocanaPropertyTable_Find(&plugin->properties, inObjectID, inAddress->mSelector, inAddress->mScope);
+    if (!property) {
+        return VocanaPropertyTable_HasObject(&plugin->properties, inObjectID) ? kAudioHardwareUnknownPropertyError : kAudioHardwareBadObjectError;
     }
 
-    return result;
+    return ((VocanaAudioServerPlugin_GetPropertyDataProc)property->getProc)(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, outDataSize, outData);
 }
 
 // Stub implementations for property data access - need to be implemented properly
-static OSStatus VocanaAudioServerPlugin_GetPlugInPropertyDataSize(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32* outDataSize) {
-    *outDataSize = 0;
-    return kAudioHardwareUnknownPropertyError;
-}
-
 static OSStatus VocanaAudioServerPlugin_GetPlugInPropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, UInt32* outDataSize, void* outData) {
     return kAudioHardwareUnknownPropertyError;
 }
 
-static OSStatus VocanaAudioServerPlugin_GetBoxPropertyDataSize(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32* outDataSize) {
-    *outDataSize = 0;
-    return kAudioHardwareUnknownPropertyError;
-}
-
 static OSStatus VocanaAudioServerPlugin_GetBoxPropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, UInt32* outDataSize, void* outData) {
     return kAudioHardwareUnknownPropertyError;
 }
 
-static OSStatus VocanaAudioServerPlugin_GetDevicePropertyDataSize(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32* outDataSize) {
-    *outDataSize = 0;
-    return kAudioHardwareUnknownPropertyError;
-}
-
 static OSStatus VocanaAudioServerPlugin_GetDevicePropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, UInt32* outDataSize, void* outData) {
-    return kAudioHardwareUnknownPropertyError;
-}
+    switch (inAddress->mSelector) {
+        case kAudioDevicePropertyLatency:
+            // the processing is all output latency; input is passed straight through
+            if (inDataSize < sizeof(UInt32)) {
+                return kAudioHardwareBadPropertySizeError;
+            }
+            *((UInt32*)outData) = inAddress->mScope == kAudioObjectPropertyScopeInput ? 0 : VocanaAudioServerPlugin_OutputLatency((VocanaAudioServerPlugin *)inDriver);
+            *outDataSize = sizeof(UInt32);
+            return kAudioHardwareNoError;
 
-static OSStatus VocanaAudioServerPlugin_GetStreamPropertyDataSize(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32* outDataSize) {
-    *outDataSize = 0;
-    return kAudioHardwareUnknownPropertyError;
+        case kAudioDevicePropertySafetyOffset:
+            // the IO thread never waits on the service, so it needs no extra margin
+            if (inDataSize < sizeof(UInt32)) {
+                return kAudioHardwareBadPropertySizeError;
+            }
+            *((UInt32*)outData) = 0;
+            *outDataSize = sizeof(UInt32);
+            return kAudioHardwareNoError;
+
+        default:
+            return kAudioHardwareUnknownPropertyError;
+    }
 }
 
 static OSStatus VocanaAudioServerPlugin_GetStreamPropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, UInt32* outDataSize, void* outData) {
-    return kAudioHardwareUnknownPropertyError;
-}
+    switch (inAddress->mSelector) {
+        case kAudioStreamPropertyLatency:
+            if (inDataSize < sizeof(UInt32)) {
+                return kAudioHardwareBadPropertySizeError;
+            }
+            *((UInt32*)outData) = inObjectID == kObjectID_Stream_Output ? VocanaAudioServerPlugin_OutputLatency((VocanaAudioServerPlugin *)inDriver) : 0;
+            *outDataSize = sizeof(UInt32);
+            return kAudioHardwareNoError;
 
-static OSStatus VocanaAudioServerPlugin_GetControlPropertyDataSize(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32* outDataSize) {
-    *outDataSize = 0;
-    return kAudioHardwareUnknownPropertyError;
+        default:
+            return kAudioHardwareUnknownPropertyError;
+    }
 }
 
 static OSStatus VocanaAudioServerPlugin_GetControlPropertyData(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, UInt32* outDataSize, void* outData) {
@@ -707,7 +970,20 @@ static OSStatus VocanaAudioServerPlugin_StartIO(AudioServerPlugInDriverRef inDri
     }
 
     pthread_mutex_lock(&plugin->mutex);
-    plugin->ioStarted = true;
+    if (plugin->runningClients == 0) {
+        // the first client to start: nothing is running IO yet, so the pipeline can be cleared and
+        // a transport the service dropped replaced from here
+        VocanaAudioServerPlugin_ReattachTransport(plugin);
+        VocanaMixBus_Reset(&plugin->mixBus);
+        VocanaRingBuffer_Reset(&plugin->ringBuffer, 0);
+#if kProcessing_LookaheadFrames > 0
+        VocanaPipeline_Reset(&plugin->pipeline);
+#endif
+        if (plugin->hasDenoiser) {
+            VocanaProcessorStage_Reset(&plugin->denoiser);
+        }
+    }
+    plugin->runningClients++;
     pthread_mutex_unlock(&plugin->mutex);
 
     DebugMsg("Vocana IO started for device %u", inDeviceObjectID);
@@ -721,8 +997,11 @@ static OSStatus VocanaAudioServerPlugin_StopIO(AudioServerPlugInDriverRef inDriv
         return kAudioHardwareBadObjectError;
     }
 
+    // IO keeps running, on the same pipeline and transport, until the last client stops
     pthread_mutex_lock(&plugin->mutex);
-    plugin->ioStarted = false;
+    if (plugin->runningClients > 0) {
+        plugin->runningClients--;
+    }
     pthread_mutex_unlock(&plugin->mutex);
 
     DebugMsg("Vocana IO stopped for device %u", inDeviceObjectID);
@@ -773,18 +1052,11 @@ static OSStatus VocanaAudioServerPlugin_BeginIOOperation(AudioServerPlugInDriver
         return kAudioHardwareBadObjectError;
     }
 
-    // Allocate buffers if needed
-    pthread_mutex_lock(&plugin->mutex);
-    if (plugin->bufferSize != inIOBufferFrameSize * kBytes_Per_Frame) {
-        plugin->bufferSize = inIOBufferFrameSize * kBytes_Per_Frame;
-
-        if (plugin->inputBuffer) free(plugin->inputBuffer);
-        if (plugin->outputBuffer) free(plugin->outputBuffer);
-
-        plugin->inputBuffer = SafeAlloc(uint8_t, plugin->bufferSize);
-        plugin->outputBuffer = SafeAlloc(uint8_t, plugin->bufferSize);
+    // The scratch buffers were sized for kMax_IO_Frames up front, so any buffer size the HAL
+    // picks fits without touching the allocator or the mutex
+    if (inIOBufferFrameSize == 0 || inIOBufferFrameSize > kMax_IO_Frames) {
+        return kAudioHardwareBadObjectError;
     }
-    pthread_mutex_unlock(&plugin->mutex);
 
     return kAudioHardwareNoError;
 }
@@ -796,53 +1068,26 @@ static OSStatus VocanaAudioServerPlugin_DoIOOperation(AudioServerPlugInDriverRef
         return kAudioHardwareBadObjectError;
     }
 
-    // Validate buffer parameters
-    if (inIOBufferFrameSize == 0 || inIOBufferFrameSize > 4096) {
-        ErrorMsg("Invalid IO buffer frame size: %u", inIOBufferFrameSize);
-        return kAudioHardwareBadObjectError;
-    }
-
-    // Ensure we have valid buffers allocated
-    pthread_mutex_lock(&plugin->mutex);
-    Boolean hasValidBuffers = (plugin->inputBuffer != NULL && plugin->outputBuffer != NULL);
-    pthread_mutex_unlock(&plugin->mutex);
-
-    if (!hasValidBuffers) {
-        ErrorMsg("IO operation attempted without valid buffers");
+    // Validate buffer parameters. No logging here: syslog takes locks of its own.
+    if (inIOBufferFrameSize == 0 || inIOBufferFrameSize > kMax_IO_Frames) {
         return kAudioHardwareBadObjectError;
     }
 
     switch (inOperationID) {
         case kAudioServerPlugInIOOperationReadInput:
-            // For input stream, provide silence or loopback data
+            // Publish the previous cycle's mix if it is still waiting for a writer that stopped,
+            // then play back the processed mix; frames nothing was written for are silent
+            VocanaMixBus_Flush(&plugin->mixBus, &plugin->ringBuffer, (UInt64)inIOCycleInfo->mOutputTime.mSampleTime);
             if (inStreamObjectID == kObjectID_Stream_Input && ioMainBuffer) {
-                // Validate buffer size doesn't overflow
-                size_t bufferSize = inIOBufferFrameSize * kBytes_Per_Frame;
-                if (bufferSize > plugin->bufferSize) {
-                    ErrorMsg("Input buffer size overflow: %zu > %u", bufferSize, plugin->bufferSize);
-                    return kAudioHardwareBadObjectError;
-                }
-                memset(ioMainBuffer, 0, bufferSize);
+                VocanaRingBuffer_Read(&plugin->ringBuffer, (UInt64)inIOCycleInfo->mInputTime.mSampleTime, ioMainBuffer, inIOBufferFrameSize);
             }
             break;
 
         case kAudioServerPlugInIOOperationWriteMix:
-            // For output stream, process the audio data through XPC
+            // Sum into this cycle's mix; the bus hands the whole mix to
+            // VocanaAudioServerPlugin_ProcessMix once, when EndIOOperation finds every writer in
             if (inStreamObjectID == kObjectID_Stream_Output && ioMainBuffer) {
-                // Validate buffer size
-                size_t bufferSize = inIOBufferFrameSize * kBytes_Per_Frame;
-                if (bufferSize > plugin->bufferSize) {
-                    ErrorMsg("Output buffer size overflow: %zu > %u", bufferSize, plugin->bufferSize);
-                    return kAudioHardwareBadObjectError;
-                }
-
-                // Process audio through XPC if connected
-                if (plugin->xpcConnected && plugin->xpcConnection) {
-                    VocanaAudioServerPlugin_ProcessAudioThroughXPC(plugin, ioMainBuffer, bufferSize, inIOBufferFrameSize);
-                } else {
-                    // Fallback: pass through unprocessed
-                    DebugMsg("XPC not connected, passing through unprocessed audio");
-                }
+                VocanaMixBus_Mix(&plugin->mixBus, &plugin->ringBuffer, inClientID, (UInt64)inIOCycleInfo->mOutputTime.mSampleTime, ioMainBuffer, inIOBufferFrameSize);
             }
             break;
 
@@ -854,7 +1099,16 @@ static OSStatus VocanaAudioServerPlugin_DoIOOperation(AudioServerPlugInDriverRef
 }
 
 static OSStatus VocanaAudioServerPlugin_EndIOOperation(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID, UInt32 inClientID, UInt32 inOperationID, UInt32 inIOBufferFrameSize, const AudioServerPlugInIOCycleInfo* inIOCycleInfo) {
-    // Cleanup if needed
+    VocanaAudioServerPlugin *plugin = (VocanaAudioServerPlugin *)inDriver;
+
+    if (!plugin || inDeviceObjectID != kObjectID_Device) {
+        return kAudioHardwareBadObjectError;
+    }
+
+    // The end of a client's WriteMix: the bus publishes the cycle if that was the last writer
+    if (inOperationID == kAudioServerPlugInIOOperationWriteMix) {
+        VocanaMixBus_EndMix(&plugin->mixBus, &plugin->ringBuffer);
+    }
     return kAudioHardwareNoError;
 }
 
@@ -46,6 +46,7 @@ enum {
 #define kDevice_Name                     kDriver_Name
 #define kManufacturer_Name               "Vocana Inc."
 
+// The default; the bundle's Info.plist can ask for 1 to 16 channels (see VocanaChannels.h)
 #define kNumber_Of_Channels              2
 #define kDevice_HasInput                 true
 #define kDevice_HasOutput                true
@@ -56,7 +57,6 @@ enum {
 
 #define kBits_Per_Channel                32
 #define kBytes_Per_Channel               (kBits_Per_Channel / 8)
-#define kBytes_Per_Frame                 (kNumber_Of_Channels * kBytes_Per_Channel)
 
 // ============================================================================
 // MARK: - Plugin Interface
@@ -0,0 +1 @@
+../VocanaAudioDriver/VocanaAudioTransport.h
\ No newline at end of file
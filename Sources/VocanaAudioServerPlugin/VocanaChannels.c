@@ -0,0 +1 @@
+../VocanaAudioDriver/VocanaChannels.c
\ No newline at end of file
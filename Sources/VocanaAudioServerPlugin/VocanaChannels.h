@@ -0,0 +1 @@
+../VocanaAudioDriver/VocanaChannels.h
\ No newline at end of file
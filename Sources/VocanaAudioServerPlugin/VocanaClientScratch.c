@@ -0,0 +1 @@
+../VocanaAudioDriver/VocanaClientScratch.c
\ No newline at end of file
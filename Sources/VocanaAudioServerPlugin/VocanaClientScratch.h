@@ -0,0 +1 @@
+../VocanaAudioDriver/VocanaClientScratch.h
\ No newline at end of file
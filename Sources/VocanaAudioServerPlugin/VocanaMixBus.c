@@ -0,0 +1 @@
+../VocanaAudioDriver/VocanaMixBus.c
\ No newline at end of file
@@ -0,0 +1 @@
+../VocanaAudioDriver/VocanaMixBus.h
\ No newline at end of file
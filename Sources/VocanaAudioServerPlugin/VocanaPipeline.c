@@ -0,0 +1 @@
+../VocanaAudioDriver/VocanaPipeline.c
\ No newline at end of file
@@ -0,0 +1 @@
+../VocanaAudioDriver/VocanaPipeline.h
\ No newline at end of file
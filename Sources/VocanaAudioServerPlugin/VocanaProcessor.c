@@ -0,0 +1 @@
+../VocanaAudioDriver/VocanaProcessor.c
\ No newline at end of file
@@ -0,0 +1 @@
+../VocanaAudioDriver/VocanaProcessor.h
\ No newline at end of file
@@ -0,0 +1 @@
+../VocanaAudioDriver/VocanaPropertyTable.c
\ No newline at end of file
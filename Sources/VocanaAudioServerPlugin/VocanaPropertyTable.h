@@ -0,0 +1 @@
+../VocanaAudioDriver/VocanaPropertyTable.h
\ No newline at end of file
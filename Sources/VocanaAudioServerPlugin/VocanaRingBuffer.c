@@ -0,0 +1 @@
+../VocanaAudioDriver/VocanaRingBuffer.c
\ No newline at end of file
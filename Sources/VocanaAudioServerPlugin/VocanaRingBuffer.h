@@ -0,0 +1 @@
+../VocanaAudioDriver/VocanaRingBuffer.h
\ No newline at end of file
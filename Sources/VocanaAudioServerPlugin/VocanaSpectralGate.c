@@ -0,0 +1 @@
+../VocanaAudioDriver/VocanaSpectralGate.c
\ No newline at end of file
@@ -0,0 +1 @@
+../VocanaAudioDriver/VocanaSpectralGate.h
\ No newline at end of file
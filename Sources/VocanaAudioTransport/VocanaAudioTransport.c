@@ -0,0 +1 @@
+../VocanaAudioDriver/VocanaAudioTransport.c
\ No newline at end of file
@@ -0,0 +1 @@
+../VocanaAudioDriver/VocanaResampler.c
\ No newline at end of file
@@ -0,0 +1 @@
+../../VocanaAudioDriver/VocanaResampler.h
\ No newline at end of file
@@ -0,0 +1,288 @@
+/*
+     File: VocanaDeepFilter.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Deep filtering: the complex FIR over the low bins of a spectrogram, a frame or a block at a time.
+
+ */
+/*==================================================================================================
+	VocanaDeepFilter.c
+==================================================================================================*/
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include "VocanaDeepFilter.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaDeepFilter
+//==================================================================================================
+
+//	FilterFrames works through the bins a tile at a time, so its sums and coefficients live on the
+//	stack.
+#define kDeepFilter_Tile            64
+
+static size_t deepfilter_round_up(size_t inCount)
+{
+	size_t theFloats = kVocanaFFT_Alignment / sizeof(float);
+	return (inCount + theFloats - 1) / theFloats * theFloats;
+}
+
+int VocanaDeepFilter_Init(VocanaDeepFilter* outFilter, uint32_t inBinCount, uint32_t inDFBins, uint32_t inOrder, uint32_t inLookahead)
+{
+	if(outFilter == NULL)
+	{
+		return EINVAL;
+	}
+	memset(outFilter, 0, sizeof(*outFilter));
+	if(inBinCount == 0 || inBinCount > kVocanaDeepFilter_MaxBins || inDFBins == 0 || inDFBins > inBinCount || inOrder == 0 || inOrder > kVocanaDeepFilter_MaxOrder || inLookahead >= inOrder)
+	{
+		return EINVAL;
+	}
+
+	//	the ring's two planes, then the taps' real and imaginary planes
+	size_t theStride = deepfilter_round_up(inDFBins);
+	size_t theFloats = 4 * (size_t)inOrder * theStride;
+	if(posix_memalign(&outFilter->memory, kVocanaFFT_Alignment, theFloats * sizeof(float)) != 0)
+	{
+		outFilter->memory = NULL;
+		return ENOMEM;
+	}
+	memset(outFilter->memory, 0, theFloats * sizeof(float));
+	outFilter->binCount = inBinCount;
+	outFilter->dfBins = inDFBins;
+	outFilter->order = inOrder;
+	outFilter->lookahead = inLookahead;
+	outFilter->stride = (uint32_t)theStride;
+	outFilter->ringReal = (float*)outFilter->memory;
+	outFilter->ringImaginary = outFilter->ringReal + inOrder * theStride;
+	outFilter->taps = outFilter->ringImaginary + inOrder * theStride;
+	VocanaDeepFilter_Reset(outFilter);
+	return 0;
+}
+
+void VocanaDeepFilter_Teardown(VocanaDeepFilter* inFilter)
+{
+	if(inFilter == NULL)
+	{
+		return;
+	}
+	free(inFilter->memory);
+	memset(inFilter, 0, sizeof(*inFilter));
+}
+
+void VocanaDeepFilter_Reset(VocanaDeepFilter* inFilter)
+{
+	size_t theFloats = (size_t)inFilter->order * inFilter->stride;
+	memset(inFilter->ringReal, 0, theFloats * sizeof(float));
+	memset(inFilter->ringImaginary, 0, theFloats * sizeof(float));
+	inFilter->newest = inFilter->order - 1;
+}
+
+//	Puts the frame's low bins in the ring as the newest, scales its high bins by the mask and
+//	clears the low bins for the taps to accumulate into.
+static void deepfilter_push(VocanaDeepFilter* inFilter, float* ioReal, float* ioImaginary, const float* inMask)
+{
+	uint32_t theDFBins = inFilter->dfBins;
+	inFilter->newest = inFilter->newest + 1 == inFilter->order ? 0 : inFilter->newest + 1;
+	size_t theSlot = (size_t)inFilter->newest * inFilter->stride;
+	memcpy(inFilter->ringReal + theSlot, ioReal, theDFBins * sizeof(float));
+	memcpy(inFilter->ringImaginary + theSlot, ioImaginary, theDFBins * sizeof(float));
+	memset(ioReal, 0, theDFBins * sizeof(float));
+	memset(ioImaginary, 0, theDFBins * sizeof(float));
+
+	//	four bins a step, as below
+	uint32_t n = theDFBins;
+	for(; n + 4 <= inFilter->binCount; n += 4)
+	{
+		for(uint32_t k = n; k < n + 4; k++)
+		{
+			ioReal[k] *= inMask[k];
+			ioImaginary[k] *= inMask[k];
+		}
+	}
+	for(; n < inFilter->binCount; n++)
+	{
+		ioReal[n] *= inMask[n];
+		ioImaginary[n] *= inMask[n];
+	}
+}
+
+//	One tap over inCount bins: the sums plus the coefficients times the bins. Four bins a step, so
+//	the compiler makes a vector of each step at -O2.
+static inline void deepfilter_multiply_add(float* __restrict ioSumReal, float* __restrict ioSumImaginary, const float* __restrict inReal, const float* __restrict inImaginary, const float* __restrict inCoefficients, uint32_t inCount)
+{
+	uint32_t n = 0;
+	for(; n + 4 <= inCount; n += 4)
+	{
+		for(uint32_t k = n; k < n + 4; k++)
+		{
+			ioSumReal[k] += inCoefficients[k] * inReal[k];
+			ioSumImaginary[k] += inCoefficients[k] * inImaginary[k];
+		}
+	}
+	for(; n < inCount; n++)
+	{
+		ioSumReal[n] += inCoefficients[n] * inReal[n];
+		ioSumImaginary[n] += inCoefficients[n] * inImaginary[n];
+	}
+}
+
+//	The same with complex coefficients.
+static inline void deepfilter_complex_multiply_add(float* __restrict ioSumReal, float* __restrict ioSumImaginary, const float* __restrict inReal, const float* __restrict inImaginary, const float* __restrict inCoefficientsReal, const float* __restrict inCoefficientsImaginary, uint32_t inCount)
+{
+	uint32_t n = 0;
+	for(; n + 4 <= inCount; n += 4)
+	{
+		for(uint32_t k = n; k < n + 4; k++)
+		{
+			ioSumReal[k] += inCoefficientsReal[k] * inReal[k] - inCoefficientsImaginary[k] * inImaginary[k];
+			ioSumImaginary[k] += inCoefficientsReal[k] * inImaginary[k] + inCoefficientsImaginary[k] * inReal[k];
+		}
+	}
+	for(; n < inCount; n++)
+	{
+		ioSumReal[n] += inCoefficientsReal[n] * inReal[n] - inCoefficientsImaginary[n] * inImaginary[n];
+		ioSumImaginary[n] += inCoefficientsReal[n] * inImaginary[n] + inCoefficientsImaginary[n] * inReal[n];
+	}
+}
+
+//	The ring slot of tap inTap, or -1 for a tap past the frame being filtered.
+static int deepfilter_slot(const VocanaDeepFilter* inFilter, uint32_t inTap)
+{
+	uint32_t theCurrent = inFilter->order - 1 - inFilter->lookahead;
+	if(inTap > theCurrent)
+	{
+		return -1;
+	}
+	uint32_t theAge = theCurrent - inTap;
+	return (int)((inFilter->newest + inFilter->order - theAge) % inFilter->order);
+}
+
+void VocanaDeepFilter_Process(VocanaDeepFilter* inFilter, float* ioReal, float* ioImaginary, const float* inMask, const float* inCoefficients)
+{
+	uint32_t theDFBins = inFilter->dfBins;
+	uint32_t theOrder = inFilter->order;
+	size_t theStride = inFilter->stride;
+	deepfilter_push(inFilter, ioReal, ioImaginary, inMask);
+
+	//	[bin][tap] to [tap][bin]
+	float* theTaps = inFilter->taps;
+	for(uint32_t theTap = 0; theTap < theOrder; theTap++)
+	{
+		const float* __restrict theSource = inCoefficients + theTap;
+		float* __restrict theDestination = theTaps + theTap * theStride;
+		for(uint32_t n = 0; n < theDFBins; n++)
+		{
+			theDestination[n] = theSource[n * theOrder];
+		}
+	}
+
+	float* __restrict theSumReal = ioReal;
+	float* __restrict theSumImaginary = ioImaginary;
+	for(uint32_t theTap = 0; theTap < theOrder; theTap++)
+	{
+		int theSlot = deepfilter_slot(inFilter, theTap);
+		if(theSlot < 0)
+		{
+			continue;
+		}
+		const float* __restrict theReal = inFilter->ringReal + (size_t)theSlot * theStride;
+		const float* __restrict theImaginary = inFilter->ringImaginary + (size_t)theSlot * theStride;
+		const float* __restrict theCoefficients = theTaps + theTap * theStride;
+		deepfilter_multiply_add(theSumReal, theSumImaginary, theReal, theImaginary, theCoefficients, theDFBins);
+	}
+}
+
+void VocanaDeepFilter_ProcessComplex(VocanaDeepFilter* inFilter, float* ioReal, float* ioImaginary, const float* inMask, const float* inCoefficients)
+{
+	uint32_t theDFBins = inFilter->dfBins;
+	uint32_t theOrder = inFilter->order;
+	size_t theStride = inFilter->stride;
+	deepfilter_push(inFilter, ioReal, ioImaginary, inMask);
+
+	//	[bin][tap][2] to split-complex [tap][bin]
+	float* theTapsReal = inFilter->taps;
+	float* theTapsImaginary = theTapsReal + theOrder * theStride;
+	for(uint32_t theTap = 0; theTap < theOrder; theTap++)
+	{
+		const float* __restrict theSource = inCoefficients + 2 * theTap;
+		float* __restrict theReal = theTapsReal + theTap * theStride;
+		float* __restrict theImaginary = theTapsImaginary + theTap * theStride;
+		size_t theStep = 2 * (size_t)theOrder;
+		for(uint32_t n = 0; n < theDFBins; n++)
+		{
+			theReal[n] = theSource[n * theStep];
+			theImaginary[n] = theSource[n * theStep + 1];
+		}
+	}
+
+	float* __restrict theSumReal = ioReal;
+	float* __restrict theSumImaginary = ioImaginary;
+	for(uint32_t theTap = 0; theTap < theOrder; theTap++)
+	{
+		int theSlot = deepfilter_slot(inFilter, theTap);
+		if(theSlot < 0)
+		{
+			continue;
+		}
+		const float* __restrict theReal = inFilter->ringReal + (size_t)theSlot * theStride;
+		const float* __restrict theImaginary = inFilter->ringImaginary + (size_t)theSlot * theStride;
+		const float* __restrict theCoefficientsReal = theTapsReal + theTap * theStride;
+		const float* __restrict theCoefficientsImaginary = theTapsImaginary + theTap * theStride;
+		deepfilter_complex_multiply_add(theSumReal, theSumImaginary, theReal, theImaginary, theCoefficientsReal, theCoefficientsImaginary, theDFBins);
+	}
+}
+
+void VocanaDeepFilter_FilterFrames(float* ioReal, float* ioImaginary, size_t inFrameStride, uint32_t inFrameCount, uint32_t inDFBins, uint32_t inOrder, const float* inCoefficients)
+{
+	if(inOrder == 0 || inOrder > kVocanaDeepFilter_MaxOrder)
+	{
+		return;
+	}
+	int theHalfOrder = (int)inOrder / 2;
+	float theTaps[kVocanaDeepFilter_MaxOrder][kDeepFilter_Tile];
+	float theSumReal[kDeepFilter_Tile];
+	float theSumImaginary[kDeepFilter_Tile];
+
+	//	every bin is filtered on its own, so a tile of bins can go through every frame before the next
+	for(uint32_t theFirst = 0; theFirst < inDFBins; theFirst += kDeepFilter_Tile)
+	{
+		uint32_t theCount = inDFBins - theFirst < kDeepFilter_Tile ? inDFBins - theFirst : kDeepFilter_Tile;
+		for(uint32_t theFrame = 0; theFrame < inFrameCount; theFrame++)
+		{
+			const float* theFrameCoefficients = inCoefficients + ((size_t)theFrame * inDFBins + theFirst) * inOrder;
+			for(uint32_t n = 0; n < theCount; n++)
+			{
+				for(uint32_t theTap = 0; theTap < inOrder; theTap++)
+				{
+					theTaps[theTap][n] = theFrameCoefficients[n * inOrder + theTap];
+				}
+			}
+			memset(theSumReal, 0, sizeof(theSumReal));
+			memset(theSumImaginary, 0, sizeof(theSumImaginary));
+
+			for(uint32_t theTap = 0; theTap < inOrder; theTap++)
+			{
+				int theSource = (int)theFrame - theHalfOrder + (int)theTap;
+				if(theSource < 0 || theSource >= (int)inFrameCount)
+				{
+					continue;
+				}
+				const float* __restrict theReal = ioReal + (size_t)theSource * inFrameStride + theFirst;
+				const float* __restrict theImaginary = ioImaginary + (size_t)theSource * inFrameStride + theFirst;
+				deepfilter_multiply_add(theSumReal, theSumImaginary, theReal, theImaginary, theTaps[theTap], theCount);
+			}
+
+			memcpy(ioReal + (size_t)theFrame * inFrameStride + theFirst, theSumReal, theCount * sizeof(float));
+			memcpy(ioImaginary + (size_t)theFrame * inFrameStride + theFirst, theSumImaginary, theCount * sizeof(float));
+		}
+	}
+}
@@ -0,0 +1,242 @@
+/*
+     File: VocanaERB.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Sparse banded ERB filterbank: band features from a spectrum and band gains back to bins.
+
+ */
+/*==================================================================================================
+	VocanaERB.c
+==================================================================================================*/
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include "VocanaERB.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Kernels
+//==================================================================================================
+
+static size_t erb_round_up(size_t inCount)
+{
+	size_t theFloats = kVocanaFFT_Alignment / sizeof(float);
+	return (inCount + theFloats - 1) / theFloats * theFloats;
+}
+
+//	Four running sums, so the loop has no dependency from one bin to the next and vectorizes
+static float erb_dot(const float* inWeights, const float* inValues, uint32_t inLength)
+{
+	float theSum0 = 0.0f;
+	float theSum1 = 0.0f;
+	float theSum2 = 0.0f;
+	float theSum3 = 0.0f;
+	uint32_t n = 0;
+	for(; n + 4 <= inLength; n += 4)
+	{
+		theSum0 += inWeights[n] * inValues[n];
+		theSum1 += inWeights[n + 1] * inValues[n + 1];
+		theSum2 += inWeights[n + 2] * inValues[n + 2];
+		theSum3 += inWeights[n + 3] * inValues[n + 3];
+	}
+	float theSum = (theSum0 + theSum1) + (theSum2 + theSum3);
+	for(; n < inLength; n++)
+	{
+		theSum += inWeights[n] * inValues[n];
+	}
+	return theSum;
+}
+
+static float erb_power(const float* inWeights, const float* inReal, const float* inImaginary, uint32_t inLength)
+{
+	float theSum0 = 0.0f;
+	float theSum1 = 0.0f;
+	float theSum2 = 0.0f;
+	float theSum3 = 0.0f;
+	uint32_t n = 0;
+	for(; n + 4 <= inLength; n += 4)
+	{
+		theSum0 += inWeights[n] * (inReal[n] * inReal[n] + inImaginary[n] * inImaginary[n]);
+		theSum1 += inWeights[n + 1] * (inReal[n + 1] * inReal[n + 1] + inImaginary[n + 1] * inImaginary[n + 1]);
+		theSum2 += inWeights[n + 2] * (inReal[n + 2] * inReal[n + 2] + inImaginary[n + 2] * inImaginary[n + 2]);
+		theSum3 += inWeights[n + 3] * (inReal[n + 3] * inReal[n + 3] + inImaginary[n + 3] * inImaginary[n + 3]);
+	}
+	float theSum = (theSum0 + theSum1) + (theSum2 + theSum3);
+	for(; n < inLength; n++)
+	{
+		theSum += inWeights[n] * (inReal[n] * inReal[n] + inImaginary[n] * inImaginary[n]);
+	}
+	return theSum;
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaERB
+//==================================================================================================
+
+int VocanaERB_Init(VocanaERB* outERB, uint32_t inBinCount, uint32_t inBandCount, const uint32_t* inStarts, const uint32_t* inLengths, const float* inWeights)
+{
+	if(outERB == NULL)
+	{
+		return EINVAL;
+	}
+	memset(outERB, 0, sizeof(*outERB));
+	if(inBinCount == 0 || inBinCount > kVocanaERB_MaxBins || inBandCount == 0 || inBandCount > kVocanaERB_MaxBands || inStarts == NULL || inLengths == NULL)
+	{
+		return EINVAL;
+	}
+	size_t theWeightCount = 0;
+	for(uint32_t b = 0; b < inBandCount; b++)
+	{
+		if((uint64_t)inStarts[b] + inLengths[b] > inBinCount)
+		{
+			return EINVAL;
+		}
+		theWeightCount += inLengths[b];
+	}
+	if(theWeightCount > 0 && inWeights == NULL)
+	{
+		return EINVAL;
+	}
+	for(size_t n = 0; n < theWeightCount; n++)
+	{
+		if(!isfinite(inWeights[n]))
+		{
+			return EINVAL;
+		}
+	}
+
+	//	the weights and bin scales first, each aligned, then the bin and band tables
+	size_t theWeightFloats = erb_round_up(theWeightCount > 0 ? theWeightCount : 1);
+	size_t theBinFloats = erb_round_up(inBinCount);
+	size_t theBytes = (theWeightFloats + theBinFloats) * sizeof(float) + inBinCount * sizeof(uint32_t) + inBandCount * sizeof(VocanaERBBand);
+	if(posix_memalign(&outERB->memory, kVocanaFFT_Alignment, theBytes) != 0)
+	{
+		outERB->memory = NULL;
+		return ENOMEM;
+	}
+	memset(outERB->memory, 0, theBytes);
+	outERB->bandCount = inBandCount;
+	outERB->binCount = inBinCount;
+	outERB->weights = (float*)outERB->memory;
+	outERB->binScale = outERB->weights + theWeightFloats;
+	outERB->nearestBand = (uint32_t*)(outERB->binScale + theBinFloats);
+	outERB->bands = (VocanaERBBand*)(outERB->nearestBand + inBinCount);
+
+	uint32_t theOffset = 0;
+	for(uint32_t b = 0; b < inBandCount; b++)
+	{
+		VocanaERBBand* theBand = &outERB->bands[b];
+		theBand->start = inStarts[b];
+		theBand->length = inLengths[b];
+		theBand->offset = theOffset;
+		memcpy(outERB->weights + theOffset, inWeights + theOffset, theBand->length * sizeof(float));
+		for(uint32_t n = 0; n < theBand->length; n++)
+		{
+			//	binScale holds the total weight over each bin until it is inverted below
+			outERB->binScale[theBand->start + n] += outERB->weights[theOffset + n];
+		}
+		theOffset += theBand->length;
+	}
+
+	for(uint32_t k = 0; k < inBinCount; k++)
+	{
+		float theTotal = outERB->binScale[k];
+		outERB->binScale[k] = theTotal > 0.0f ? 1.0f / theTotal : 0.0f;
+		if(theTotal > 0.0f)
+		{
+			continue;
+		}
+
+		//	the band whose bins come closest, the lower one on a tie
+		uint32_t theNearest = 0;
+		uint32_t theDistance = UINT32_MAX;
+		for(uint32_t b = 0; b < inBandCount; b++)
+		{
+			const VocanaERBBand* theBand = &outERB->bands[b];
+			if(theBand->length == 0)
+			{
+				continue;
+			}
+			uint32_t theLast = theBand->start + theBand->length - 1;
+			uint32_t theBandDistance = k < theBand->start ? theBand->start - k : (k > theLast ? k - theLast : 0);
+			if(theBandDistance < theDistance)
+			{
+				theDistance = theBandDistance;
+				theNearest = b;
+			}
+		}
+		outERB->nearestBand[k] = theNearest;
+	}
+	return 0;
+}
+
+void VocanaERB_Teardown(VocanaERB* inERB)
+{
+	if(inERB == NULL)
+	{
+		return;
+	}
+	free(inERB->memory);
+	memset(inERB, 0, sizeof(*inERB));
+}
+
+size_t VocanaERB_GetWeightCount(const VocanaERB* inERB)
+{
+	const VocanaERBBand* theLast = &inERB->bands[inERB->bandCount - 1];
+	return (size_t)theLast->offset + theLast->length;
+}
+
+bool VocanaERB_Sum(const VocanaERB* inERB, const float* inValues, float* outBands)
+{
+	bool theFinite = true;
+	for(uint32_t b = 0; b < inERB->bandCount; b++)
+	{
+		const VocanaERBBand* theBand = &inERB->bands[b];
+		outBands[b] = erb_dot(inERB->weights + theBand->offset, inValues + theBand->start, theBand->length);
+		theFinite = theFinite && isfinite(outBands[b]);
+	}
+	return theFinite;
+}
+
+bool VocanaERB_LogPower(const VocanaERB* inERB, const float* inReal, const float* inImaginary, float* outBands)
+{
+	bool theFinite = true;
+	for(uint32_t b = 0; b < inERB->bandCount; b++)
+	{
+		const VocanaERBBand* theBand = &inERB->bands[b];
+		float thePower = erb_power(inERB->weights + theBand->offset, inReal + theBand->start, inImaginary + theBand->start, theBand->length);
+		outBands[b] = 10.0f * log10f(thePower + 1e-10f);
+		theFinite = theFinite && isfinite(outBands[b]);
+	}
+	return theFinite;
+}
+
+void VocanaERB_ExpandGains(const VocanaERB* inERB, const float* inGains, float* outBinGains)
+{
+	memset(outBinGains, 0, inERB->binCount * sizeof(float));
+	for(uint32_t b = 0; b < inERB->bandCount; b++)
+	{
+		const VocanaERBBand* theBand = &inERB->bands[b];
+		const float* theWeights = inERB->weights + theBand->offset;
+		float* theBins = outBinGains + theBand->start;
+		float theGain = inGains[b];
+		for(uint32_t n = 0; n < theBand->length; n++)
+		{
+			theBins[n] += theWeights[n] * theGain;
+		}
+	}
+	for(uint32_t k = 0; k < inERB->binCount; k++)
+	{
+		float theScale = inERB->binScale[k];
+		outBinGains[k] = theScale > 0.0f ? outBinGains[k] * theScale : inGains[inERB->nearestBand[k]];
+	}
+}
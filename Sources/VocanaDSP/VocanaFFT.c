@@ -0,0 +1,474 @@
+/*
+     File: VocanaFFT.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Mixed-radix real FFT for the sizes the models' spectra use.
+
+ */
+/*==================================================================================================
+	VocanaFFT.c
+==================================================================================================*/
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include "VocanaFFT.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Vectors
+//==================================================================================================
+
+typedef float FFTVector __attribute__((vector_size(16)));
+
+enum
+{
+	kFFT_Lanes                          = 4,
+	kFFT_MaxRadix                       = 5,
+};
+
+static inline FFTVector fft_load(const float* inSamples)
+{
+	FFTVector theVector;
+	memcpy(&theVector, inSamples, sizeof(theVector));
+	return theVector;
+}
+
+static inline void fft_store(float* outSamples, FFTVector inVector)
+{
+	memcpy(outSamples, &inVector, sizeof(inVector));
+}
+
+static inline size_t fft_round_up(size_t inCount)
+{
+	size_t theFloats = kVocanaFFT_Alignment / sizeof(float);
+	return (inCount + theFloats - 1) / theFloats * theFloats;
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Butterflies
+//==================================================================================================
+
+//	The forward DFT of ioReal/ioImaginary[0 ... inRadix - 1], in place, on every lane at once.
+static inline void fft_butterfly(uint32_t inRadix, FFTVector* ioReal, FFTVector* ioImaginary)
+{
+	switch(inRadix)
+	{
+		case 2:
+		{
+			FFTVector theReal = ioReal[0] - ioReal[1];
+			FFTVector theImaginary = ioImaginary[0] - ioImaginary[1];
+			ioReal[0] += ioReal[1];
+			ioImaginary[0] += ioImaginary[1];
+			ioReal[1] = theReal;
+			ioImaginary[1] = theImaginary;
+			break;
+		}
+
+		case 3:
+		{
+			const float kSine = 0.86602540378443865f;
+			FFTVector theSumReal = ioReal[1] + ioReal[2];
+			FFTVector theSumImaginary = ioImaginary[1] + ioImaginary[2];
+			FFTVector theDifferenceReal = (ioReal[1] - ioReal[2]) * kSine;
+			FFTVector theDifferenceImaginary = (ioImaginary[1] - ioImaginary[2]) * kSine;
+			FFTVector theMiddleReal = ioReal[0] - theSumReal * 0.5f;
+			FFTVector theMiddleImaginary = ioImaginary[0] - theSumImaginary * 0.5f;
+			ioReal[0] += theSumReal;
+			ioImaginary[0] += theSumImaginary;
+			ioReal[1] = theMiddleReal + theDifferenceImaginary;
+			ioImaginary[1] = theMiddleImaginary - theDifferenceReal;
+			ioReal[2] = theMiddleReal - theDifferenceImaginary;
+			ioImaginary[2] = theMiddleImaginary + theDifferenceReal;
+			break;
+		}
+
+		case 4:
+		{
+			FFTVector theReal0 = ioReal[0] + ioReal[2];
+			FFTVector theImaginary0 = ioImaginary[0] + ioImaginary[2];
+			FFTVector theReal1 = ioReal[0] - ioReal[2];
+			FFTVector theImaginary1 = ioImaginary[0] - ioImaginary[2];
+			FFTVector theReal2 = ioReal[1] + ioReal[3];
+			FFTVector theImaginary2 = ioImaginary[1] + ioImaginary[3];
+			FFTVector theReal3 = ioReal[1] - ioReal[3];
+			FFTVector theImaginary3 = ioImaginary[1] - ioImaginary[3];
+			ioReal[0] = theReal0 + theReal2;
+			ioImaginary[0] = theImaginary0 + theImaginary2;
+			ioReal[2] = theReal0 - theReal2;
+			ioImaginary[2] = theImaginary0 - theImaginary2;
+
+			//	times -i and +i
+			ioReal[1] = theReal1 + theImaginary3;
+			ioImaginary[1] = theImaginary1 - theReal3;
+			ioReal[3] = theReal1 - theImaginary3;
+			ioImaginary[3] = theImaginary1 + theReal3;
+			break;
+		}
+
+		case 5:
+		{
+			const float kCosine1 = 0.30901699437494742f;
+			const float kCosine2 = -0.80901699437494742f;
+			const float kSine1 = 0.95105651629515357f;
+			const float kSine2 = 0.58778525229247313f;
+			FFTVector theSum1Real = ioReal[1] + ioReal[4];
+			FFTVector theSum1Imaginary = ioImaginary[1] + ioImaginary[4];
+			FFTVector theSum2Real = ioReal[2] + ioReal[3];
+			FFTVector theSum2Imaginary = ioImaginary[2] + ioImaginary[3];
+			FFTVector theDifference1Real = ioReal[1] - ioReal[4];
+			FFTVector theDifference1Imaginary = ioImaginary[1] - ioImaginary[4];
+			FFTVector theDifference2Real = ioReal[2] - ioReal[3];
+			FFTVector theDifference2Imaginary = ioImaginary[2] - ioImaginary[3];
+
+			FFTVector theMiddle1Real = ioReal[0] + theSum1Real * kCosine1 + theSum2Real * kCosine2;
+			FFTVector theMiddle1Imaginary = ioImaginary[0] + theSum1Imaginary * kCosine1 + theSum2Imaginary * kCosine2;
+			FFTVector theMiddle2Real = ioReal[0] + theSum1Real * kCosine2 + theSum2Real * kCosine1;
+			FFTVector theMiddle2Imaginary = ioImaginary[0] + theSum1Imaginary * kCosine2 + theSum2Imaginary * kCosine1;
+			FFTVector theSide1Real = theDifference1Real * kSine1 + theDifference2Real * kSine2;
+			FFTVector theSide1Imaginary = theDifference1Imaginary * kSine1 + theDifference2Imaginary * kSine2;
+			FFTVector theSide2Real = theDifference1Real * kSine2 - theDifference2Real * kSine1;
+			FFTVector theSide2Imaginary = theDifference1Imaginary * kSine2 - theDifference2Imaginary * kSine1;
+
+			ioReal[0] += theSum1Real + theSum2Real;
+			ioImaginary[0] += theSum1Imaginary + theSum2Imaginary;
+
+			//	the middles less and plus i times the sides
+			ioReal[1] = theMiddle1Real + theSide1Imaginary;
+			ioImaginary[1] = theMiddle1Imaginary - theSide1Real;
+			ioReal[4] = theMiddle1Real - theSide1Imaginary;
+			ioImaginary[4] = theMiddle1Imaginary + theSide1Real;
+			ioReal[2] = theMiddle2Real + theSide2Imaginary;
+			ioImaginary[2] = theMiddle2Imaginary - theSide2Real;
+			ioReal[3] = theMiddle2Real - theSide2Imaginary;
+			ioImaginary[3] = theMiddle2Imaginary + theSide2Real;
+			break;
+		}
+	}
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Stages
+//==================================================================================================
+
+//	A stage of radix r splits each sub-transform of its length n into r of n / r. Element j of
+//	butterfly p is at p + j * n / r, and output k of the butterfly, times the twiddle
+//	e^(-2 pi i p k / n), goes to r * p + k, each of them stride elements apart for the stride
+//	sub-transforms the stage runs side by side.
+
+//	Once the stride is a whole number of vectors, a vector holds the same element of neighbouring
+//	sub-transforms, which share their twiddles.
+static void fft_stage_strided(const VocanaFFTStage* inStage, const float* inReal, const float* inImaginary, float* outReal, float* outImaginary)
+{
+	uint32_t theRadix = inStage->radix;
+	uint32_t theStride = inStage->stride;
+	uint32_t theButterflies = inStage->length / theRadix;
+	for(uint32_t p = 0; p < theButterflies; p++)
+	{
+		float theTwiddleReal[kFFT_MaxRadix];
+		float theTwiddleImaginary[kFFT_MaxRadix];
+		for(uint32_t k = 1; k < theRadix; k++)
+		{
+			theTwiddleReal[k] = inStage->twiddleReal[(size_t)(k - 1) * theButterflies + p];
+			theTwiddleImaginary[k] = inStage->twiddleImaginary[(size_t)(k - 1) * theButterflies + p];
+		}
+		for(uint32_t q = 0; q < theStride; q += kFFT_Lanes)
+		{
+			FFTVector theReal[kFFT_MaxRadix];
+			FFTVector theImaginary[kFFT_MaxRadix];
+			for(uint32_t j = 0; j < theRadix; j++)
+			{
+				size_t theIndex = q + (size_t)theStride * (p + j * theButterflies);
+				theReal[j] = fft_load(inReal + theIndex);
+				theImaginary[j] = fft_load(inImaginary + theIndex);
+			}
+			fft_butterfly(theRadix, theReal, theImaginary);
+			size_t theOutput = q + (size_t)theStride * theRadix * p;
+			fft_store(outReal + theOutput, theReal[0]);
+			fft_store(outImaginary + theOutput, theImaginary[0]);
+			for(uint32_t k = 1; k < theRadix; k++)
+			{
+				theOutput += theStride;
+				fft_store(outReal + theOutput, theReal[k] * theTwiddleReal[k] - theImaginary[k] * theTwiddleImaginary[k]);
+				fft_store(outImaginary + theOutput, theReal[k] * theTwiddleImaginary[k] + theImaginary[k] * theTwiddleReal[k]);
+			}
+		}
+	}
+}
+
+//	The first stage, and any other whose stride is not a whole number of vectors: a vector holds
+//	neighbouring butterflies of one sub-transform instead, gathered and scattered a lane at a time.
+static void fft_stage_gathered(const VocanaFFTStage* inStage, const float* inReal, const float* inImaginary, float* outReal, float* outImaginary)
+{
+	uint32_t theRadix = inStage->radix;
+	uint32_t theStride = inStage->stride;
+	uint32_t theButterflies = inStage->length / theRadix;
+	for(uint32_t q = 0; q < theStride; q++)
+	{
+		for(uint32_t p = 0; p < theButterflies; p += kFFT_Lanes)
+		{
+			FFTVector theReal[kFFT_MaxRadix];
+			FFTVector theImaginary[kFFT_MaxRadix];
+			FFTVector theTwiddleReal[kFFT_MaxRadix];
+			FFTVector theTwiddleImaginary[kFFT_MaxRadix];
+			for(uint32_t l = 0; l < kFFT_Lanes; l++)
+			{
+				//	lanes past the last butterfly repeat it and are never stored
+				uint32_t theButterfly = p + l < theButterflies ? p + l : theButterflies - 1;
+				for(uint32_t j = 0; j < theRadix; j++)
+				{
+					size_t theIndex = q + (size_t)theStride * (theButterfly + j * theButterflies);
+					theReal[j][l] = inReal[theIndex];
+					theImaginary[j][l] = inImaginary[theIndex];
+				}
+				for(uint32_t k = 1; k < theRadix; k++)
+				{
+					theTwiddleReal[k][l] = inStage->twiddleReal[(size_t)(k - 1) * theButterflies + theButterfly];
+					theTwiddleImaginary[k][l] = inStage->twiddleImaginary[(size_t)(k - 1) * theButterflies + theButterfly];
+				}
+			}
+			fft_butterfly(theRadix, theReal, theImaginary);
+			for(uint32_t k = 1; k < theRadix; k++)
+			{
+				FFTVector theProductReal = theReal[k] * theTwiddleReal[k] - theImaginary[k] * theTwiddleImaginary[k];
+				theImaginary[k] = theReal[k] * theTwiddleImaginary[k] + theImaginary[k] * theTwiddleReal[k];
+				theReal[k] = theProductReal;
+			}
+			uint32_t theLanes = theButterflies - p < kFFT_Lanes ? theButterflies - p : kFFT_Lanes;
+			for(uint32_t l = 0; l < theLanes; l++)
+			{
+				for(uint32_t k = 0; k < theRadix; k++)
+				{
+					size_t theIndex = q + (size_t)theStride * (theRadix * (p + l) + k);
+					outReal[theIndex] = theReal[k][l];
+					outImaginary[theIndex] = theImaginary[k][l];
+				}
+			}
+		}
+	}
+}
+
+//	The forward complex transform of size / 2 points, ping-ponging between the two pairs of
+//	buffers. Returns the pair the result ended up in through outReal and outImaginary.
+static void fft_complex(const VocanaFFT* inFFT, float* ioReal, float* ioImaginary, float* ioScratchReal, float* ioScratchImaginary, float** outReal, float** outImaginary)
+{
+	float* theReal[2] = { ioReal, ioScratchReal };
+	float* theImaginary[2] = { ioImaginary, ioScratchImaginary };
+	uint32_t theCurrent = 0;
+	for(uint32_t s = 0; s < inFFT->stageCount; s++)
+	{
+		const VocanaFFTStage* theStage = &inFFT->stages[s];
+		if(theStage->stride % kFFT_Lanes == 0)
+		{
+			fft_stage_strided(theStage, theReal[theCurrent], theImaginary[theCurrent], theReal[1 - theCurrent], theImaginary[1 - theCurrent]);
+		}
+		else
+		{
+			fft_stage_gathered(theStage, theReal[theCurrent], theImaginary[theCurrent], theReal[1 - theCurrent], theImaginary[1 - theCurrent]);
+		}
+		theCurrent = 1 - theCurrent;
+	}
+	*outReal = theReal[theCurrent];
+	*outImaginary = theImaginary[theCurrent];
+}
+
+//	The radices of a complex transform of inCount points, fours first so that every later stage
+//	has a stride of whole vectors. Returns the number of stages, or 0 if inCount has other factors.
+static uint32_t fft_factor(uint32_t inCount, uint32_t* outRadices)
+{
+	static const uint32_t kRadices[] = { 4, 2, 3, 5 };
+	uint32_t theStageCount = 0;
+	uint32_t theRemainder = inCount;
+	for(uint32_t i = 0; i < sizeof(kRadices) / sizeof(kRadices[0]); i++)
+	{
+		while(theRemainder % kRadices[i] == 0 && theStageCount < kVocanaFFT_MaxStages)
+		{
+			outRadices[theStageCount++] = kRadices[i];
+			theRemainder /= kRadices[i];
+
+			//	a single 2 at most, after the fours
+			if(kRadices[i] == 2)
+			{
+				break;
+			}
+		}
+	}
+	return theRemainder == 1 ? theStageCount : 0;
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaFFT
+//==================================================================================================
+
+bool VocanaFFT_IsValidSize(uint32_t inSize)
+{
+	uint32_t theRadices[kVocanaFFT_MaxStages];
+	return inSize >= 2 && inSize <= kVocanaFFT_MaxSize && inSize % 2 == 0 && (inSize == 2 || fft_factor(inSize / 2, theRadices) > 0);
+}
+
+int VocanaFFT_Init(VocanaFFT* outFFT, uint32_t inSize)
+{
+	if(outFFT == NULL)
+	{
+		return EINVAL;
+	}
+	memset(outFFT, 0, sizeof(*outFFT));
+	if(!VocanaFFT_IsValidSize(inSize))
+	{
+		return EINVAL;
+	}
+
+	uint32_t theCount = inSize / 2;
+	uint32_t theRadices[kVocanaFFT_MaxStages];
+	outFFT->size = inSize;
+	outFFT->stageCount = theCount > 1 ? fft_factor(theCount, theRadices) : 0;
+
+	//	everything in one allocation, each array on its own cache line
+	size_t theFloats = 4 * fft_round_up(theCount) + 2 * fft_round_up(theCount + 1);
+	for(uint32_t s = 0; s < outFFT->stageCount; s++)
+	{
+		theFloats += 2 * fft_round_up((size_t)(theRadices[s] - 1) * (theCount / theRadices[s]));
+	}
+	if(posix_memalign(&outFFT->memory, kVocanaFFT_Alignment, theFloats * sizeof(float)) != 0)
+	{
+		outFFT->memory = NULL;
+		return ENOMEM;
+	}
+	memset(outFFT->memory, 0, theFloats * sizeof(float));
+
+	float* theNext = (float*)outFFT->memory;
+	for(uint32_t i = 0; i < 4; i++)
+	{
+		outFFT->work[i] = theNext;
+		theNext += fft_round_up(theCount);
+	}
+	outFFT->postReal = theNext;
+	theNext += fft_round_up(theCount + 1);
+	outFFT->postImaginary = theNext;
+	theNext += fft_round_up(theCount + 1);
+	for(uint32_t k = 0; k <= theCount; k++)
+	{
+		double theAngle = -2.0 * M_PI * k / inSize;
+		outFFT->postReal[k] = (float)cos(theAngle);
+		outFFT->postImaginary[k] = (float)sin(theAngle);
+	}
+
+	uint32_t theLength = theCount;
+	uint32_t theStride = 1;
+	for(uint32_t s = 0; s < outFFT->stageCount; s++)
+	{
+		VocanaFFTStage* theStage = &outFFT->stages[s];
+		uint32_t theButterflies = theLength / theRadices[s];
+		size_t theTwiddles = (size_t)(theRadices[s] - 1) * theButterflies;
+		theStage->radix = theRadices[s];
+		theStage->length = theLength;
+		theStage->stride = theStride;
+		theStage->twiddleReal = theNext;
+		theNext += fft_round_up(theTwiddles);
+		theStage->twiddleImaginary = theNext;
+		theNext += fft_round_up(theTwiddles);
+		for(uint32_t k = 1; k < theRadices[s]; k++)
+		{
+			for(uint32_t p = 0; p < theButterflies; p++)
+			{
+				double theAngle = -2.0 * M_PI * (double)p * k / theLength;
+				theStage->twiddleReal[(size_t)(k - 1) * theButterflies + p] = (float)cos(theAngle);
+				theStage->twiddleImaginary[(size_t)(k - 1) * theButterflies + p] = (float)sin(theAngle);
+			}
+		}
+		theLength = theButterflies;
+		theStride *= theRadices[s];
+	}
+	return 0;
+}
+
+void VocanaFFT_Teardown(VocanaFFT* inFFT)
+{
+	if(inFFT == NULL)
+	{
+		return;
+	}
+	free(inFFT->memory);
+	memset(inFFT, 0, sizeof(*inFFT));
+}
+
+void VocanaFFT_Forward(VocanaFFT* inFFT, const float* inSamples, float* outReal, float* outImaginary)
+{
+	uint32_t theCount = inFFT->size / 2;
+
+	//	the even samples as the real parts and the odd ones as the imaginary parts
+	float* theReal = inFFT->work[0];
+	float* theImaginary = inFFT->work[1];
+	for(uint32_t n = 0; n < theCount; n++)
+	{
+		theReal[n] = inSamples[2 * n];
+		theImaginary[n] = inSamples[2 * n + 1];
+	}
+	fft_complex(inFFT, theReal, theImaginary, inFFT->work[2], inFFT->work[3], &theReal, &theImaginary);
+
+	//	untangle the spectra of the even and the odd samples, E and O, from Z = E + iO, and
+	//	combine them into X = E + W^k O
+	outReal[0] = theReal[0] + theImaginary[0];
+	outImaginary[0] = 0.0f;
+	outReal[theCount] = theReal[0] - theImaginary[0];
+	outImaginary[theCount] = 0.0f;
+	for(uint32_t k = 1; k < theCount; k++)
+	{
+		uint32_t theMirror = theCount - k;
+		float theEvenReal = 0.5f * (theReal[k] + theReal[theMirror]);
+		float theEvenImaginary = 0.5f * (theImaginary[k] - theImaginary[theMirror]);
+		float theOddReal = 0.5f * (theImaginary[k] + theImaginary[theMirror]);
+		float theOddImaginary = -0.5f * (theReal[k] - theReal[theMirror]);
+		float theTwiddleReal = inFFT->postReal[k];
+		float theTwiddleImaginary = inFFT->postImaginary[k];
+		outReal[k] = theEvenReal + theTwiddleReal * theOddReal - theTwiddleImaginary * theOddImaginary;
+		outImaginary[k] = theEvenImaginary + theTwiddleReal * theOddImaginary + theTwiddleImaginary * theOddReal;
+	}
+}
+
+void VocanaFFT_Inverse(VocanaFFT* inFFT, const float* inReal, const float* inImaginary, float* outSamples)
+{
+	uint32_t theCount = inFFT->size / 2;
+
+	//	Z = E + iO again, from E = (X[k] + X*[M - k]) / 2 and O = (X[k] - X*[M - k]) / 2W^k
+	float* theReal = inFFT->work[0];
+	float* theImaginary = inFFT->work[1];
+	theReal[0] = 0.5f * (inReal[0] + inReal[theCount]);
+	theImaginary[0] = 0.5f * (inReal[0] - inReal[theCount]);
+	for(uint32_t k = 1; k < theCount; k++)
+	{
+		uint32_t theMirror = theCount - k;
+		float theEvenReal = 0.5f * (inReal[k] + inReal[theMirror]);
+		float theEvenImaginary = 0.5f * (inImaginary[k] - inImaginary[theMirror]);
+		float theDifferenceReal = 0.5f * (inReal[k] - inReal[theMirror]);
+		float theDifferenceImaginary = 0.5f * (inImaginary[k] + inImaginary[theMirror]);
+		float theTwiddleReal = inFFT->postReal[k];
+		float theTwiddleImaginary = inFFT->postImaginary[k];
+		float theOddReal = theDifferenceReal * theTwiddleReal + theDifferenceImaginary * theTwiddleImaginary;
+		float theOddImaginary = theDifferenceImaginary * theTwiddleReal - theDifferenceReal * theTwiddleImaginary;
+		theReal[k] = theEvenReal - theOddImaginary;
+		theImaginary[k] = theEvenImaginary + theOddReal;
+	}
+
+	//	the inverse is the forward transform with the real and imaginary parts swapped on the way
+	//	in and out
+	float* theResultReal = NULL;
+	float* theResultImaginary = NULL;
+	fft_complex(inFFT, theImaginary, theReal, inFFT->work[3], inFFT->work[2], &theResultImaginary, &theResultReal);
+	float theScale = 1.0f / (float)theCount;
+	for(uint32_t n = 0; n < theCount; n++)
+	{
+		outSamples[2 * n] = theResultReal[n] * theScale;
+		outSamples[2 * n + 1] = theResultImaginary[n] * theScale;
+	}
+}
@@ -0,0 +1,459 @@
+/*
+     File: VocanaLayers.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ CPU inference for the layers of the denoising models: dense, 1D convolution and GRU, on packed weights.
+
+ */
+/*==================================================================================================
+	VocanaLayers.c
+==================================================================================================*/
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include "VocanaLayers.h"
+#include "VocanaFFT.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Activations
+//==================================================================================================
+
+#define kPanel                      kVocanaLayers_PanelRows
+
+static size_t layers_round_up(size_t inCount)
+{
+	size_t theFloats = kVocanaFFT_Alignment / sizeof(float);
+	return (inCount + theFloats - 1) / theFloats * theFloats;
+}
+
+static uint32_t layers_panel_count(uint32_t inRows)
+{
+	return (inRows + kPanel - 1) / kPanel;
+}
+
+//	tanh as a 13/6 rational polynomial in x, exact to a few ulp over the whole float range once x is
+//	clamped where tanh is 1 to float precision.
+static inline float layers_tanh(float inX)
+{
+	float theX = inX < -7.90531110763549805f ? -7.90531110763549805f : (inX > 7.90531110763549805f ? 7.90531110763549805f : inX);
+	float theX2 = theX * theX;
+	float theP = -2.76076847742355e-16f;
+	theP = theP * theX2 + 2.00018790482477e-13f;
+	theP = theP * theX2 - 8.60467152213735e-11f;
+	theP = theP * theX2 + 5.12229709037114e-08f;
+	theP = theP * theX2 + 1.48572235717979e-05f;
+	theP = theP * theX2 + 6.37261928875436e-04f;
+	theP = theP * theX2 + 4.89352455891786e-03f;
+	theP = theP * theX;
+	float theQ = 1.19825839466702e-06f;
+	theQ = theQ * theX2 + 1.18534705686654e-04f;
+	theQ = theQ * theX2 + 2.26843463243900e-03f;
+	theQ = theQ * theX2 + 4.89352518554385e-03f;
+	return theP / theQ;
+}
+
+static inline float layers_sigmoid(float inX)
+{
+	return 0.5f + 0.5f * layers_tanh(0.5f * inX);
+}
+
+static inline float layers_activate(float inX, VocanaActivation inActivation)
+{
+	switch(inActivation)
+	{
+		case kVocanaActivation_ReLU:
+			return inX > 0.0f ? inX : 0.0f;
+		case kVocanaActivation_Sigmoid:
+			return layers_sigmoid(inX);
+		case kVocanaActivation_Tanh:
+			return layers_tanh(inX);
+		default:
+			return inX;
+	}
+}
+
+void VocanaActivation_Apply(VocanaActivation inActivation, float* ioValues, uint32_t inCount)
+{
+	//	one loop per activation, so each vectorizes
+	switch(inActivation)
+	{
+		case kVocanaActivation_ReLU:
+			for(uint32_t n = 0; n < inCount; n++)
+			{
+				ioValues[n] = ioValues[n] > 0.0f ? ioValues[n] : 0.0f;
+			}
+			break;
+		case kVocanaActivation_Sigmoid:
+			for(uint32_t n = 0; n < inCount; n++)
+			{
+				ioValues[n] = layers_sigmoid(ioValues[n]);
+			}
+			break;
+		case kVocanaActivation_Tanh:
+			for(uint32_t n = 0; n < inCount; n++)
+			{
+				ioValues[n] = layers_tanh(ioValues[n]);
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Panels
+//==================================================================================================
+
+//	Packs inRows rows of inColumns row-major weights into panels of kPanel rows stored column by
+//	column. Rows past the last are left zero.
+static void layers_pack(float* outPanels, const float* inWeights, uint32_t inRows, uint32_t inColumns)
+{
+	for(uint32_t theRow = 0; theRow < inRows; theRow++)
+	{
+		float* thePanel = outPanels + (size_t)(theRow / kPanel) * inColumns * kPanel;
+		const float* theWeights = inWeights + (size_t)theRow * inColumns;
+		for(uint32_t theColumn = 0; theColumn < inColumns; theColumn++)
+		{
+			thePanel[(size_t)theColumn * kPanel + theRow % kPanel] = theWeights[theColumn];
+		}
+	}
+}
+
+//	One panel's kPanel sums over inColumns inputs, added to ioSums. The kPanel sums of a column are
+//	contiguous, so each column is one or two vector multiply-adds.
+static inline void layers_panel_sums(const float* __restrict inPanel, const float* __restrict inInput, uint32_t inColumns, float* __restrict ioSums)
+{
+	float theSums[kPanel];
+	for(uint32_t r = 0; r < kPanel; r++)
+	{
+		theSums[r] = ioSums[r];
+	}
+	for(uint32_t theColumn = 0; theColumn < inColumns; theColumn++)
+	{
+		float theInput = inInput[theColumn];
+		const float* theWeights = inPanel + (size_t)theColumn * kPanel;
+		for(uint32_t r = 0; r < kPanel; r++)
+		{
+			theSums[r] += theWeights[r] * theInput;
+		}
+	}
+	for(uint32_t r = 0; r < kPanel; r++)
+	{
+		ioSums[r] = theSums[r];
+	}
+}
+
+//	Every output of a packed layer into outOutput, inOutputStride floats apart.
+static void layers_dense_forward(const VocanaDense* inDense, const float* inInput, float* outOutput, size_t inOutputStride, VocanaActivation inActivation)
+{
+	uint32_t theColumns = inDense->inputCount;
+	for(uint32_t thePanel = 0; thePanel < inDense->panelCount; thePanel++)
+	{
+		float theSums[kPanel];
+		memcpy(theSums, inDense->bias + thePanel * kPanel, sizeof(theSums));
+		layers_panel_sums(inDense->panels + (size_t)thePanel * theColumns * kPanel, inInput, theColumns, theSums);
+
+		uint32_t theFirst = thePanel * kPanel;
+		uint32_t theRows = inDense->outputCount - theFirst < kPanel ? inDense->outputCount - theFirst : kPanel;
+		for(uint32_t r = 0; r < theRows; r++)
+		{
+			outOutput[(theFirst + r) * inOutputStride] = layers_activate(theSums[r], inActivation);
+		}
+	}
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaDense
+//==================================================================================================
+
+int VocanaDense_Init(VocanaDense* outDense, uint32_t inInputCount, uint32_t inOutputCount, const float* inWeights, const float* inBias)
+{
+	if(outDense == NULL)
+	{
+		return EINVAL;
+	}
+	memset(outDense, 0, sizeof(*outDense));
+	if(inWeights == NULL || inInputCount == 0 || inInputCount > kVocanaLayers_MaxSize || inOutputCount == 0 || inOutputCount > kVocanaLayers_MaxSize)
+	{
+		return EINVAL;
+	}
+
+	uint32_t thePanelCount = layers_panel_count(inOutputCount);
+	size_t thePanelFloats = layers_round_up((size_t)thePanelCount * kPanel * inInputCount);
+	size_t theBiasFloats = layers_round_up((size_t)thePanelCount * kPanel);
+	size_t theFloats = thePanelFloats + theBiasFloats;
+	if(posix_memalign(&outDense->memory, kVocanaFFT_Alignment, theFloats * sizeof(float)) != 0)
+	{
+		outDense->memory = NULL;
+		return ENOMEM;
+	}
+	memset(outDense->memory, 0, theFloats * sizeof(float));
+	outDense->inputCount = inInputCount;
+	outDense->outputCount = inOutputCount;
+	outDense->panelCount = thePanelCount;
+	outDense->panels = (float*)outDense->memory;
+	outDense->bias = outDense->panels + thePanelFloats;
+
+	layers_pack(outDense->panels, inWeights, inOutputCount, inInputCount);
+	if(inBias != NULL)
+	{
+		memcpy(outDense->bias, inBias, inOutputCount * sizeof(float));
+	}
+	return 0;
+}
+
+void VocanaDense_Teardown(VocanaDense* inDense)
+{
+	if(inDense == NULL)
+	{
+		return;
+	}
+	free(inDense->memory);
+	memset(inDense, 0, sizeof(*inDense));
+}
+
+void VocanaDense_Forward(const VocanaDense* inDense, const float* inInput, float* outOutput, VocanaActivation inActivation)
+{
+	layers_dense_forward(inDense, inInput, outOutput, 1, inActivation);
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaConv1D
+//==================================================================================================
+
+int VocanaConv1D_Init(VocanaConv1D* outConv, uint32_t inInputChannels, uint32_t inOutputChannels, uint32_t inKernelSize, uint32_t inStride, const float* inWeights, const float* inBias)
+{
+	if(outConv == NULL)
+	{
+		return EINVAL;
+	}
+	memset(outConv, 0, sizeof(*outConv));
+	if(inInputChannels == 0 || inKernelSize == 0 || inStride == 0 || (uint64_t)inInputChannels * inKernelSize > kVocanaLayers_MaxSize)
+	{
+		return EINVAL;
+	}
+
+	//	the kernels are a dense layer over a window laid out like their weights, channel by channel
+	int theResult = VocanaDense_Init(&outConv->kernels, inInputChannels * inKernelSize, inOutputChannels, inWeights, inBias);
+	if(theResult != 0)
+	{
+		return theResult;
+	}
+	size_t theWindowFloats = layers_round_up((size_t)inInputChannels * inKernelSize);
+	size_t theSumFloats = layers_round_up(inOutputChannels);
+	if(posix_memalign(&outConv->memory, kVocanaFFT_Alignment, (theWindowFloats + theSumFloats) * sizeof(float)) != 0)
+	{
+		outConv->memory = NULL;
+		VocanaDense_Teardown(&outConv->kernels);
+		return ENOMEM;
+	}
+	memset(outConv->memory, 0, (theWindowFloats + theSumFloats) * sizeof(float));
+	outConv->inputChannels = inInputChannels;
+	outConv->outputChannels = inOutputChannels;
+	outConv->kernelSize = inKernelSize;
+	outConv->stride = inStride;
+	outConv->window = (float*)outConv->memory;
+	outConv->sums = outConv->window + theWindowFloats;
+	return 0;
+}
+
+void VocanaConv1D_Teardown(VocanaConv1D* inConv)
+{
+	if(inConv == NULL)
+	{
+		return;
+	}
+	VocanaDense_Teardown(&inConv->kernels);
+	free(inConv->memory);
+	memset(inConv, 0, sizeof(*inConv));
+}
+
+uint32_t VocanaConv1D_GetOutputLength(const VocanaConv1D* inConv, uint32_t inInputLength)
+{
+	if(inInputLength < inConv->kernelSize)
+	{
+		return 0;
+	}
+	return (inInputLength - inConv->kernelSize) / inConv->stride + 1;
+}
+
+void VocanaConv1D_Forward(VocanaConv1D* inConv, const float* inInput, uint32_t inInputLength, float* outOutput, VocanaActivation inActivation)
+{
+	uint32_t theOutputLength = VocanaConv1D_GetOutputLength(inConv, inInputLength);
+	uint32_t theKernelSize = inConv->kernelSize;
+	for(uint32_t thePosition = 0; thePosition < theOutputLength; thePosition++)
+	{
+		const float* theStart = inInput + (size_t)thePosition * inConv->stride;
+		for(uint32_t theChannel = 0; theChannel < inConv->inputChannels; theChannel++)
+		{
+			memcpy(inConv->window + theChannel * theKernelSize, theStart + (size_t)theChannel * inInputLength, theKernelSize * sizeof(float));
+		}
+		layers_dense_forward(&inConv->kernels, inConv->window, outOutput + thePosition, theOutputLength, inActivation);
+	}
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaGRU
+//==================================================================================================
+
+int VocanaGRU_Init(VocanaGRU* outGRU, uint32_t inInputCount, uint32_t inHiddenCount, const float* inWeights, const float* inInputBias, const float* inHiddenBias)
+{
+	if(outGRU == NULL)
+	{
+		return EINVAL;
+	}
+	memset(outGRU, 0, sizeof(*outGRU));
+	if(inWeights == NULL || inInputCount == 0 || inInputCount > kVocanaLayers_MaxSize || inHiddenCount == 0 || inHiddenCount > kVocanaLayers_MaxSize / 3)
+	{
+		return EINVAL;
+	}
+
+	//	every gate row holds its input weights then its hidden weights, as the rows come in
+	uint32_t theRows = 3 * inHiddenCount;
+	uint32_t theColumns = inInputCount + inHiddenCount;
+	uint32_t thePanelCount = layers_panel_count(theRows);
+	size_t thePanelFloats = layers_round_up((size_t)thePanelCount * kPanel * theColumns);
+	size_t theRowFloats = layers_round_up((size_t)thePanelCount * kPanel);
+	size_t theFloats = thePanelFloats + 4 * theRowFloats;
+	if(posix_memalign(&outGRU->memory, kVocanaFFT_Alignment, theFloats * sizeof(float)) != 0)
+	{
+		outGRU->memory = NULL;
+		return ENOMEM;
+	}
+	memset(outGRU->memory, 0, theFloats * sizeof(float));
+	outGRU->inputCount = inInputCount;
+	outGRU->hiddenCount = inHiddenCount;
+	outGRU->panelCount = thePanelCount;
+	outGRU->panels = (float*)outGRU->memory;
+	outGRU->inputBias = outGRU->panels + thePanelFloats;
+	outGRU->hiddenBias = outGRU->inputBias + theRowFloats;
+	outGRU->inputSums = outGRU->hiddenBias + theRowFloats;
+	outGRU->hiddenSums = outGRU->inputSums + theRowFloats;
+
+	layers_pack(outGRU->panels, inWeights, theRows, theColumns);
+	if(inInputBias != NULL)
+	{
+		memcpy(outGRU->inputBias, inInputBias, theRows * sizeof(float));
+	}
+	if(inHiddenBias != NULL)
+	{
+		memcpy(outGRU->hiddenBias, inHiddenBias, theRows * sizeof(float));
+	}
+	return 0;
+}
+
+void VocanaGRU_Teardown(VocanaGRU* inGRU)
+{
+	if(inGRU == NULL)
+	{
+		return;
+	}
+	free(inGRU->memory);
+	memset(inGRU, 0, sizeof(*inGRU));
+}
+
+void VocanaGRU_Forward(VocanaGRU* inGRU, const float* inInput, uint32_t inSteps, float* ioHidden, float* outOutput)
+{
+	uint32_t theInputs = inGRU->inputCount;
+	uint32_t theHidden = inGRU->hiddenCount;
+	uint32_t theColumns = theInputs + theHidden;
+	for(uint32_t theStep = 0; theStep < inSteps; theStep++)
+	{
+		const float* theInput = inInput + (size_t)theStep * theInputs;
+
+		//	one pass over the packed gates, the input and hidden columns summed apart
+		for(uint32_t thePanel = 0; thePanel < inGRU->panelCount; thePanel++)
+		{
+			const float* theWeights = inGRU->panels + (size_t)thePanel * theColumns * kPanel;
+			float* theInputSums = inGRU->inputSums + thePanel * kPanel;
+			float* theHiddenSums = inGRU->hiddenSums + thePanel * kPanel;
+			memcpy(theInputSums, inGRU->inputBias + thePanel * kPanel, kPanel * sizeof(float));
+			memcpy(theHiddenSums, inGRU->hiddenBias + thePanel * kPanel, kPanel * sizeof(float));
+			layers_panel_sums(theWeights, theInput, theInputs, theInputSums);
+			layers_panel_sums(theWeights + (size_t)theInputs * kPanel, ioHidden, theHidden, theHiddenSums);
+		}
+
+		//	then the gates and the new state, unit by unit
+		const float* theInputSums = inGRU->inputSums;
+		const float* theHiddenSums = inGRU->hiddenSums;
+		for(uint32_t n = 0; n < theHidden; n++)
+		{
+			float theReset = layers_sigmoid(theInputSums[n] + theHiddenSums[n]);
+			float theUpdate = layers_sigmoid(theInputSums[theHidden + n] + theHiddenSums[theHidden + n]);
+			float theNew = layers_tanh(theInputSums[2 * theHidden + n] + theReset * theHiddenSums[2 * theHidden + n]);
+			ioHidden[n] = theNew + theUpdate * (ioHidden[n] - theNew);
+		}
+		if(outOutput != NULL)
+		{
+			memcpy(outOutput + (size_t)theStep * theHidden, ioHidden, theHidden * sizeof(float));
+		}
+	}
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaArena
+//==================================================================================================
+
+int VocanaArena_Init(VocanaArena* outArena, size_t inCapacity)
+{
+	if(outArena == NULL)
+	{
+		return EINVAL;
+	}
+	memset(outArena, 0, sizeof(*outArena));
+	if(inCapacity == 0)
+	{
+		return EINVAL;
+	}
+
+	size_t theCapacity = layers_round_up(inCapacity);
+	if(posix_memalign(&outArena->memory, kVocanaFFT_Alignment, theCapacity * sizeof(float)) != 0)
+	{
+		outArena->memory = NULL;
+		return ENOMEM;
+	}
+	memset(outArena->memory, 0, theCapacity * sizeof(float));
+	outArena->base = (float*)outArena->memory;
+	outArena->capacity = theCapacity;
+	return 0;
+}
+
+void VocanaArena_Teardown(VocanaArena* inArena)
+{
+	if(inArena == NULL)
+	{
+		return;
+	}
+	free(inArena->memory);
+	memset(inArena, 0, sizeof(*inArena));
+}
+
+float* VocanaArena_Reserve(VocanaArena* inArena, size_t inCount)
+{
+	size_t theCount = layers_round_up(inCount);
+	if(inCount == 0 || theCount > inArena->capacity - inArena->used)
+	{
+		return NULL;
+	}
+	float* theSlot = inArena->base + inArena->used;
+	inArena->used += theCount;
+	return theSlot;
+}
+
+void VocanaArena_Clear(VocanaArena* inArena)
+{
+	memset(inArena->base, 0, inArena->capacity * sizeof(float));
+}
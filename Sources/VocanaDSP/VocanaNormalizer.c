@@ -0,0 +1,144 @@
+/*
+     File: VocanaNormalizer.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Running per-stream feature normalization, updated a frame at a time.
+
+ */
+/*==================================================================================================
+	VocanaNormalizer.c
+==================================================================================================*/
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include "VocanaNormalizer.h"
+#include "VocanaFFT.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaNormalizer
+//==================================================================================================
+
+#define kNormalizer_MeanScale       (1.0f / 40.0f)
+#define kNormalizer_UnitFloor       1e-12f
+
+static size_t normalizer_round_up(size_t inCount)
+{
+	size_t theFloats = kVocanaFFT_Alignment / sizeof(float);
+	return (inCount + theFloats - 1) / theFloats * theFloats;
+}
+
+int VocanaNormalizer_Init(VocanaNormalizer* outNormalizer, VocanaNormalizerKind inKind, uint32_t inCount, float inAlpha, float inInitialFirst, float inInitialLast)
+{
+	if(outNormalizer == NULL)
+	{
+		return EINVAL;
+	}
+	memset(outNormalizer, 0, sizeof(*outNormalizer));
+	if((inKind != kVocanaNormalizer_Mean && inKind != kVocanaNormalizer_Unit) || inCount == 0 || inCount > kVocanaNormalizer_MaxCount || !(inAlpha >= 0.0f && inAlpha < 1.0f) || !isfinite(inInitialFirst) || !isfinite(inInitialLast))
+	{
+		return EINVAL;
+	}
+	if(inKind == kVocanaNormalizer_Unit && (inInitialFirst <= 0.0f || inInitialLast <= 0.0f))
+	{
+		return EINVAL;
+	}
+
+	size_t theStride = normalizer_round_up(inCount);
+	if(posix_memalign(&outNormalizer->memory, kVocanaFFT_Alignment, 2 * theStride * sizeof(float)) != 0)
+	{
+		outNormalizer->memory = NULL;
+		return ENOMEM;
+	}
+	memset(outNormalizer->memory, 0, 2 * theStride * sizeof(float));
+	outNormalizer->kind = inKind;
+	outNormalizer->count = inCount;
+	outNormalizer->alpha = inAlpha;
+	outNormalizer->state = (float*)outNormalizer->memory;
+	outNormalizer->initialState = outNormalizer->state + theStride;
+
+	float theStep = inCount > 1 ? (inInitialLast - inInitialFirst) / (float)(inCount - 1) : 0.0f;
+	for(uint32_t n = 0; n < inCount; n++)
+	{
+		outNormalizer->initialState[n] = inInitialFirst + theStep * (float)n;
+	}
+	VocanaNormalizer_Reset(outNormalizer);
+	return 0;
+}
+
+void VocanaNormalizer_Teardown(VocanaNormalizer* inNormalizer)
+{
+	if(inNormalizer == NULL)
+	{
+		return;
+	}
+	free(inNormalizer->memory);
+	memset(inNormalizer, 0, sizeof(*inNormalizer));
+}
+
+void VocanaNormalizer_Reset(VocanaNormalizer* inNormalizer)
+{
+	memcpy(inNormalizer->state, inNormalizer->initialState, inNormalizer->count * sizeof(float));
+}
+
+void VocanaNormalizer_NormalizeMean(VocanaNormalizer* inNormalizer, const float* inLevels, float* outFeatures)
+{
+	float* theState = inNormalizer->state;
+	float theAlpha = inNormalizer->alpha;
+	float theGain = 1.0f - theAlpha;
+	for(uint32_t n = 0; n < inNormalizer->count; n++)
+	{
+		float theLevel = inLevels[n];
+		float theMean = theLevel * theGain + theState[n] * theAlpha;
+		theState[n] = theMean;
+		outFeatures[n] = (theLevel - theMean) * kNormalizer_MeanScale;
+	}
+}
+
+void VocanaNormalizer_NormalizeUnit(VocanaNormalizer* inNormalizer, const float* inReal, const float* inImaginary, float* outReal, float* outImaginary)
+{
+	float* theState = inNormalizer->state;
+	float theAlpha = inNormalizer->alpha;
+	float theGain = 1.0f - theAlpha;
+	for(uint32_t n = 0; n < inNormalizer->count; n++)
+	{
+		float theReal = inReal[n];
+		float theImaginary = inImaginary[n];
+		float theMagnitude = sqrtf(theReal * theReal + theImaginary * theImaginary);
+		float theUnit = fmaxf(theMagnitude * theGain + theState[n] * theAlpha, kNormalizer_UnitFloor);
+		theState[n] = theUnit;
+		float theScale = 1.0f / sqrtf(theUnit);
+		outReal[n] = theReal * theScale;
+		outImaginary[n] = theImaginary * theScale;
+	}
+}
+
+void VocanaNormalizer_GetState(const VocanaNormalizer* inNormalizer, float* outState)
+{
+	memcpy(outState, inNormalizer->state, inNormalizer->count * sizeof(float));
+}
+
+int VocanaNormalizer_SetState(VocanaNormalizer* inNormalizer, const float* inState, uint32_t inCount)
+{
+	if(inState == NULL || inCount != inNormalizer->count)
+	{
+		return EINVAL;
+	}
+	for(uint32_t n = 0; n < inCount; n++)
+	{
+		if(!isfinite(inState[n]) || (inNormalizer->kind == kVocanaNormalizer_Unit && inState[n] <= 0.0f))
+		{
+			return EINVAL;
+		}
+	}
+	memcpy(inNormalizer->state, inState, inCount * sizeof(float));
+	return 0;
+}
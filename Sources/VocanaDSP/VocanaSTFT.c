@@ -0,0 +1,182 @@
+/*
+     File: VocanaSTFT.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Streaming short-time Fourier analysis and overlap-add synthesis.
+
+ */
+/*==================================================================================================
+	VocanaSTFT.c
+==================================================================================================*/
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include "VocanaSTFT.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Windows
+//==================================================================================================
+
+static size_t stft_round_up(size_t inCount)
+{
+	size_t theFloats = kVocanaFFT_Alignment / sizeof(float);
+	return (inCount + theFloats - 1) / theFloats * theFloats;
+}
+
+static void stft_make_window(VocanaSTFTWindow inWindow, uint32_t inFrameSize, float* outWindow)
+{
+	for(uint32_t n = 0; n < inFrameSize; n++)
+	{
+		double theValue;
+		if(inWindow == kVocanaSTFT_Vorbis)
+		{
+			double theSine = sin(M_PI * (n + 0.5) / inFrameSize);
+			theValue = sin(0.5 * M_PI * theSine * theSine);
+		}
+		else
+		{
+			theValue = 0.5 * (1.0 - cos(2.0 * M_PI * n / inFrameSize));
+		}
+		outWindow[n] = (float)theValue;
+	}
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaSTFT
+//==================================================================================================
+
+int VocanaSTFT_Init(VocanaSTFT* outSTFT, uint32_t inFrameSize, uint32_t inHopSize, VocanaSTFTWindow inWindow)
+{
+	if(outSTFT == NULL)
+	{
+		return EINVAL;
+	}
+	memset(outSTFT, 0, sizeof(*outSTFT));
+	if(inHopSize == 0 || inHopSize > inFrameSize || inFrameSize % inHopSize != 0 || (inWindow != kVocanaSTFT_Hann && inWindow != kVocanaSTFT_Vorbis))
+	{
+		return EINVAL;
+	}
+	int theError = VocanaFFT_Init(&outSTFT->fft, inFrameSize);
+	if(theError != 0)
+	{
+		return theError;
+	}
+
+	size_t theStride = stft_round_up(inFrameSize);
+	if(posix_memalign(&outSTFT->memory, kVocanaFFT_Alignment, 5 * theStride * sizeof(float)) != 0)
+	{
+		outSTFT->memory = NULL;
+		VocanaFFT_Teardown(&outSTFT->fft);
+		return ENOMEM;
+	}
+	memset(outSTFT->memory, 0, 5 * theStride * sizeof(float));
+	outSTFT->frameSize = inFrameSize;
+	outSTFT->hopSize = inHopSize;
+	outSTFT->binCount = inFrameSize / 2 + 1;
+	outSTFT->analysisWindow = (float*)outSTFT->memory;
+	outSTFT->synthesisWindow = outSTFT->analysisWindow + theStride;
+	outSTFT->input = outSTFT->synthesisWindow + theStride;
+	outSTFT->output = outSTFT->input + theStride;
+	outSTFT->frame = outSTFT->output + theStride;
+
+	stft_make_window(inWindow, inFrameSize, outSTFT->analysisWindow);
+	outSTFT->spectrumScale = inWindow == kVocanaSTFT_Vorbis ? (float)(2.0 * inHopSize / ((double)inFrameSize * inFrameSize)) : 1.0f;
+
+	//	each sample is in frameSize / hopSize frames, at positions hopSize apart
+	for(uint32_t n = 0; n < inFrameSize; n++)
+	{
+		double theSum = 0.0;
+		for(uint32_t thePosition = n % inHopSize; thePosition < inFrameSize; thePosition += inHopSize)
+		{
+			theSum += (double)outSTFT->analysisWindow[thePosition] * outSTFT->analysisWindow[thePosition];
+		}
+		outSTFT->synthesisWindow[n] = theSum > 0.0 ? (float)(outSTFT->analysisWindow[n] / theSum / outSTFT->spectrumScale) : 0.0f;
+	}
+	return 0;
+}
+
+void VocanaSTFT_Teardown(VocanaSTFT* inSTFT)
+{
+	if(inSTFT == NULL)
+	{
+		return;
+	}
+	VocanaFFT_Teardown(&inSTFT->fft);
+	free(inSTFT->memory);
+	memset(inSTFT, 0, sizeof(*inSTFT));
+}
+
+void VocanaSTFT_Reset(VocanaSTFT* inSTFT)
+{
+	memset(inSTFT->input, 0, inSTFT->frameSize * sizeof(float));
+	memset(inSTFT->output, 0, inSTFT->frameSize * sizeof(float));
+}
+
+uint32_t VocanaSTFT_GetLatency(const VocanaSTFT* inSTFT)
+{
+	return inSTFT->frameSize - inSTFT->hopSize;
+}
+
+void VocanaSTFT_Analyze(VocanaSTFT* inSTFT, const float* inHop, float* outReal, float* outImaginary)
+{
+	uint32_t theFrameSize = inSTFT->frameSize;
+	uint32_t theHopSize = inSTFT->hopSize;
+	memmove(inSTFT->input, inSTFT->input + theHopSize, (theFrameSize - theHopSize) * sizeof(float));
+	memcpy(inSTFT->input + theFrameSize - theHopSize, inHop, theHopSize * sizeof(float));
+
+	//	the scale goes into the window, which is otherwise only ever multiplied in here
+	float* theFrame = inSTFT->frame;
+	const float* theWindow = inSTFT->analysisWindow;
+	const float* theInput = inSTFT->input;
+	float theScale = inSTFT->spectrumScale;
+	for(uint32_t n = 0; n < theFrameSize; n++)
+	{
+		theFrame[n] = theInput[n] * theWindow[n] * theScale;
+	}
+	VocanaFFT_Forward(&inSTFT->fft, theFrame, outReal, outImaginary);
+}
+
+void VocanaSTFT_Synthesize(VocanaSTFT* inSTFT, const float* inReal, const float* inImaginary, float* outHop)
+{
+	uint32_t theFrameSize = inSTFT->frameSize;
+	uint32_t theHopSize = inSTFT->hopSize;
+	float* theFrame = inSTFT->frame;
+	float* theOutput = inSTFT->output;
+	const float* theWindow = inSTFT->synthesisWindow;
+	VocanaFFT_Inverse(&inSTFT->fft, inReal, inImaginary, theFrame);
+	for(uint32_t n = 0; n < theFrameSize; n++)
+	{
+		theOutput[n] += theFrame[n] * theWindow[n];
+	}
+
+	//	the first hop has had every frame overlapping it added now
+	memcpy(outHop, theOutput, theHopSize * sizeof(float));
+	memmove(theOutput, theOutput + theHopSize, (theFrameSize - theHopSize) * sizeof(float));
+	memset(theOutput + theFrameSize - theHopSize, 0, theHopSize * sizeof(float));
+}
+
+void VocanaSTFT_AnalyzeHops(VocanaSTFT* inSTFT, const float* inSamples, uint32_t inHopCount, float* outReal, float* outImaginary, size_t inFrameStride)
+{
+	for(uint32_t theHop = 0; theHop < inHopCount; theHop++)
+	{
+		VocanaSTFT_Analyze(inSTFT, inSamples + (size_t)theHop * inSTFT->hopSize, outReal + theHop * inFrameStride, outImaginary + theHop * inFrameStride);
+	}
+}
+
+void VocanaSTFT_SynthesizeHops(VocanaSTFT* inSTFT, const float* inReal, const float* inImaginary, uint32_t inHopCount, size_t inFrameStride, float* outSamples)
+{
+	for(uint32_t theHop = 0; theHop < inHopCount; theHop++)
+	{
+		VocanaSTFT_Synthesize(inSTFT, inReal + theHop * inFrameStride, inImaginary + theHop * inFrameStride, outSamples + (size_t)theHop * inSTFT->hopSize);
+	}
+}
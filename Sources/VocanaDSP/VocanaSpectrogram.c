@@ -0,0 +1,160 @@
+/*
+     File: VocanaSpectrogram.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Contiguous, aligned frames x bins storage for spectra, features and masks.
+
+ */
+/*==================================================================================================
+	VocanaSpectrogram.c
+==================================================================================================*/
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include "VocanaSpectrogram.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaSpectrogram
+//==================================================================================================
+
+static uint32_t spectrogram_round_up(uint32_t inCount)
+{
+	uint32_t theFloats = kVocanaFFT_Alignment / sizeof(float);
+	return (inCount + theFloats - 1) / theFloats * theFloats;
+}
+
+static void* spectrogram_allocate(uint32_t inFrameCapacity, uint32_t inFrameStride, uint32_t inPlaneCount)
+{
+	//	never zero bytes, so a spectrogram with no frames still has an aligned pointer
+	size_t theBytes = (size_t)inPlaneCount * (inFrameCapacity > 0 ? inFrameCapacity : 1) * inFrameStride * sizeof(float);
+	void* theMemory = NULL;
+	if(posix_memalign(&theMemory, kVocanaFFT_Alignment, theBytes) != 0)
+	{
+		return NULL;
+	}
+	memset(theMemory, 0, theBytes);
+	return theMemory;
+}
+
+int VocanaSpectrogram_Init(VocanaSpectrogram* outSpectrogram, uint32_t inFrameCount, uint32_t inFrameCapacity, uint32_t inBinCount, uint32_t inPlaneCount)
+{
+	if(outSpectrogram == NULL)
+	{
+		return EINVAL;
+	}
+	memset(outSpectrogram, 0, sizeof(*outSpectrogram));
+	if(inBinCount == 0 || inBinCount > kVocanaSpectrogram_MaxBins || inFrameCount > kVocanaSpectrogram_MaxFrames || inFrameCapacity > kVocanaSpectrogram_MaxFrames || (inPlaneCount != 1 && inPlaneCount != 2))
+	{
+		return EINVAL;
+	}
+	uint32_t theCapacity = inFrameCapacity > inFrameCount ? inFrameCapacity : inFrameCount;
+	uint32_t theStride = spectrogram_round_up(inBinCount);
+	void* theMemory = spectrogram_allocate(theCapacity, theStride, inPlaneCount);
+	if(theMemory == NULL)
+	{
+		return ENOMEM;
+	}
+
+	outSpectrogram->frameCount = inFrameCount;
+	outSpectrogram->frameCapacity = theCapacity;
+	outSpectrogram->binCount = inBinCount;
+	outSpectrogram->frameStride = theStride;
+	outSpectrogram->planeCount = inPlaneCount;
+	outSpectrogram->memory = theMemory;
+	outSpectrogram->real = (float*)theMemory;
+	outSpectrogram->imaginary = inPlaneCount == 2 ? outSpectrogram->real + (size_t)inFrameCount * theStride : NULL;
+	return 0;
+}
+
+void VocanaSpectrogram_Teardown(VocanaSpectrogram* inSpectrogram)
+{
+	if(inSpectrogram == NULL)
+	{
+		return;
+	}
+	free(inSpectrogram->memory);
+	memset(inSpectrogram, 0, sizeof(*inSpectrogram));
+}
+
+int VocanaSpectrogram_Reserve(VocanaSpectrogram* ioSpectrogram, uint32_t inFrameCapacity)
+{
+	if(inFrameCapacity <= ioSpectrogram->frameCapacity)
+	{
+		return 0;
+	}
+	if(inFrameCapacity > kVocanaSpectrogram_MaxFrames)
+	{
+		return EINVAL;
+	}
+	void* theMemory = spectrogram_allocate(inFrameCapacity, ioSpectrogram->frameStride, ioSpectrogram->planeCount);
+	if(theMemory == NULL)
+	{
+		return ENOMEM;
+	}
+
+	size_t thePlaneSize = VocanaSpectrogram_GetPlaneSize(ioSpectrogram);
+	float* theReal = (float*)theMemory;
+	memcpy(theReal, ioSpectrogram->real, thePlaneSize * sizeof(float));
+	if(ioSpectrogram->planeCount == 2)
+	{
+		memcpy(theReal + thePlaneSize, ioSpectrogram->imaginary, thePlaneSize * sizeof(float));
+	}
+	free(ioSpectrogram->memory);
+	ioSpectrogram->memory = theMemory;
+	ioSpectrogram->frameCapacity = inFrameCapacity;
+	ioSpectrogram->real = theReal;
+	ioSpectrogram->imaginary = ioSpectrogram->planeCount == 2 ? theReal + thePlaneSize : NULL;
+	return 0;
+}
+
+int VocanaSpectrogram_SetFrameCount(VocanaSpectrogram* ioSpectrogram, uint32_t inFrameCount)
+{
+	if(inFrameCount > ioSpectrogram->frameCapacity)
+	{
+		return EINVAL;
+	}
+	uint32_t theOldCount = ioSpectrogram->frameCount;
+	size_t theStride = ioSpectrogram->frameStride;
+	if(ioSpectrogram->planeCount == 2 && inFrameCount != theOldCount)
+	{
+		//	the imaginary plane follows the real one, so it moves with the frame count
+		float* theImaginary = ioSpectrogram->real + inFrameCount * theStride;
+		size_t theKept = (inFrameCount < theOldCount ? inFrameCount : theOldCount) * theStride;
+		memmove(theImaginary, ioSpectrogram->imaginary, theKept * sizeof(float));
+		ioSpectrogram->imaginary = theImaginary;
+	}
+	if(inFrameCount > theOldCount)
+	{
+		size_t theAdded = (inFrameCount - theOldCount) * theStride;
+		memset(ioSpectrogram->real + theOldCount * theStride, 0, theAdded * sizeof(float));
+		if(ioSpectrogram->planeCount == 2)
+		{
+			memset(ioSpectrogram->imaginary + theOldCount * theStride, 0, theAdded * sizeof(float));
+		}
+	}
+	ioSpectrogram->frameCount = inFrameCount;
+	return 0;
+}
+
+void VocanaSpectrogram_Clear(VocanaSpectrogram* ioSpectrogram)
+{
+	memset(ioSpectrogram->real, 0, ioSpectrogram->planeCount * VocanaSpectrogram_GetPlaneSize(ioSpectrogram) * sizeof(float));
+}
+
+bool VocanaSpectrogram_IsDense(const VocanaSpectrogram* inSpectrogram)
+{
+	return inSpectrogram->frameStride == inSpectrogram->binCount;
+}
+
+size_t VocanaSpectrogram_GetPlaneSize(const VocanaSpectrogram* inSpectrogram)
+{
+	return (size_t)inSpectrogram->frameCount * inSpectrogram->frameStride;
+}
@@ -0,0 +1,101 @@
+/*
+     File: VocanaDeepFilter.h
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Deep filtering: the complex FIR over the low bins of a spectrogram, a frame or a block at a time.
+
+ */
+/*==================================================================================================
+	VocanaDeepFilter.h
+==================================================================================================*/
+
+#ifndef VocanaDeepFilter_h
+#define VocanaDeepFilter_h
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include "VocanaFFT.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaDeepFilter
+//==================================================================================================
+
+//	DeepFilterNet's enhancement of one frame, as a stream. Each of the first dfBins bins becomes an
+//	order-tap FIR over the same bin of the frames up to and including this one, with the decoder's
+//	coefficients for this frame, and the bins above dfBins are scaled by the ERB mask. The filter
+//	runs on the spectra as they were analyzed, so the filter keeps the last order frames' low bins
+//	in a ring, and each call puts the new frame in and filters in place.
+//
+//	Tap i of a frame t is frame t - (order - 1 - lookahead) + i, so a lookahead of 0 is
+//	DeepFilterNet's causal filter and a lookahead of order / 2 the centered filter DeepFiltering
+//	applies to a block. Taps past the frame being filtered aren't there in a stream and are left
+//	out, as DeepFiltering leaves out taps past the end of a block. Frames before the first are
+//	silence.
+//
+//	Process takes real coefficients, [dfBins][order]. ProcessComplex takes DeepFilterNet's complex
+//	coefficients, [dfBins][order][2] with the real part first. Both first lay the coefficients out
+//	tap by tap, so every tap is a multiply-accumulate over contiguous split-complex bins.
+//
+//	Init and Teardown allocate; everything else is real-time safe. A VocanaDeepFilter is used by one
+//	thread at a time.
+//
+//	VocanaDeepFilter_FilterFrames is DeepFiltering's filter over a whole block in place, stateless.
+
+enum
+{
+	kVocanaDeepFilter_MaxBins           = 65536,
+	kVocanaDeepFilter_MaxOrder          = 16,
+};
+
+typedef struct VocanaDeepFilter
+{
+	uint32_t                binCount;
+	uint32_t                dfBins;
+	uint32_t                order;
+	uint32_t                lookahead;
+	uint32_t                stride;         //	dfBins rounded up to kVocanaFFT_Alignment
+	uint32_t                newest;         //	ring slot of the last frame
+	float*                  ringReal;       //	order slots of stride floats
+	float*                  ringImaginary;
+	float*                  taps;           //	the coefficients tap by tap, 2 * order rows of stride
+	void*                   memory;
+} VocanaDeepFilter;
+
+//	Sets up a filter over the first inDFBins of inBinCount bins with inOrder taps, inLookahead of
+//	them past the frame being filtered. Returns 0 on success or an errno value. Not real-time safe.
+int         VocanaDeepFilter_Init(VocanaDeepFilter* outFilter, uint32_t inBinCount, uint32_t inDFBins, uint32_t inOrder, uint32_t inLookahead);
+
+void        VocanaDeepFilter_Teardown(VocanaDeepFilter* inFilter);
+
+//	Forgets the frames seen so far, as at the start of a new stream.
+void        VocanaDeepFilter_Reset(VocanaDeepFilter* inFilter);
+
+//	Enhances the next frame of binCount bins in place with the mask inMask, binCount gains of which
+//	those above dfBins are used, and real coefficients.
+void        VocanaDeepFilter_Process(VocanaDeepFilter* inFilter, float* ioReal, float* ioImaginary, const float* inMask, const float* inCoefficients);
+
+//	The same with complex coefficients.
+void        VocanaDeepFilter_ProcessComplex(VocanaDeepFilter* inFilter, float* ioReal, float* ioImaginary, const float* inMask, const float* inCoefficients);
+
+//	Filters the first inDFBins bins of inFrameCount frames, inFrameStride floats apart, in place
+//	with the centered filter and real coefficients, [inFrameCount][inDFBins][inOrder]. Frames are
+//	filtered in order, so the taps before a frame see the frames already filtered, and taps past
+//	either end of the block are left out.
+void        VocanaDeepFilter_FilterFrames(float* ioReal, float* ioImaginary, size_t inFrameStride, uint32_t inFrameCount, uint32_t inDFBins, uint32_t inOrder, const float* inCoefficients);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VocanaDeepFilter_h */
@@ -0,0 +1,103 @@
+/*
+     File: VocanaERB.h
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Sparse banded ERB filterbank: band features from a spectrum and band gains back to bins.
+
+ */
+/*==================================================================================================
+	VocanaERB.h
+==================================================================================================*/
+
+#ifndef VocanaERB_h
+#define VocanaERB_h
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include "VocanaFFT.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaERB
+//==================================================================================================
+
+//	An ERB filterbank kept the way its filters actually are: each band weights a short run of
+//	contiguous bins and nothing else, so a band is stored as its first bin, the number of bins it
+//	covers and their weights, all bands' weights back to back in one aligned block. For
+//	DeepFilterNet's 32 bands over 481 bins that is a few hundred weights instead of a 32 x 481
+//	matrix that is mostly zeros, and a frame's bands touch each bin only as often as the bands
+//	overlap there.
+//
+//	LogPower is the whole feature in one pass over the spectrum: each band's weighted sum of
+//	re^2 + im^2, straight from the split-complex bins with no power spectrum in between, then
+//	10 log10 of it. Sum takes any per-bin values, such as magnitudes, through the same bands.
+//
+//	ExpandGains goes the other way, from one gain per band to one per bin, for an ERB decoder that
+//	gives its mask in bands. Each bin gets the average of the gains of the bands covering it,
+//	weighted by their weights there, so equal gains give the same gain in every bin, and a bin no
+//	band covers takes the gain of the band nearest it.
+//
+//	Init and Teardown allocate; everything else is real-time safe. A VocanaERB is only read after
+//	Init, so any number of threads can use one at once.
+
+enum
+{
+	kVocanaERB_MaxBands                 = 1024,
+	kVocanaERB_MaxBins                  = 65536,
+};
+
+typedef struct VocanaERBBand
+{
+	uint32_t                start;          //	first bin the band covers
+	uint32_t                length;         //	bins it covers, which may be none
+	uint32_t                offset;         //	where its weights start in weights
+} VocanaERBBand;
+
+typedef struct VocanaERB
+{
+	uint32_t                bandCount;
+	uint32_t                binCount;
+	VocanaERBBand*          bands;
+	float*                  weights;
+	float*                  binScale;       //	1 / the weight of the bands over each bin, 0 if none
+	uint32_t*               nearestBand;    //	for bins with no band, the band nearest them
+	void*                   memory;
+} VocanaERB;
+
+//	Sets up inBandCount bands over inBinCount bins. Band b covers inLengths[b] bins from
+//	inStarts[b], and its weights are the next inLengths[b] values of inWeights, the bands' weights
+//	given back to back. Returns 0 on success or an errno value. Not real-time safe.
+int         VocanaERB_Init(VocanaERB* outERB, uint32_t inBinCount, uint32_t inBandCount, const uint32_t* inStarts, const uint32_t* inLengths, const float* inWeights);
+
+void        VocanaERB_Teardown(VocanaERB* inERB);
+
+//	The total number of weights, over all bands.
+size_t      VocanaERB_GetWeightCount(const VocanaERB* inERB);
+
+//	Writes each band's weighted sum of inValues, binCount values, to outBands. Returns false if any
+//	band's sum isn't finite.
+bool        VocanaERB_Sum(const VocanaERB* inERB, const float* inValues, float* outBands);
+
+//	Writes each band's power in dB, 10 log10 of its weighted sum of inReal^2 + inImaginary^2 plus
+//	1e-10, to outBands. Returns false if any band's power isn't finite.
+bool        VocanaERB_LogPower(const VocanaERB* inERB, const float* inReal, const float* inImaginary, float* outBands);
+
+//	Writes the gain of every bin, binCount values, for the band gains inGains to outBinGains.
+void        VocanaERB_ExpandGains(const VocanaERB* inERB, const float* inGains, float* outBinGains);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VocanaERB_h */
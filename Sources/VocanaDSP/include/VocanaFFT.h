@@ -0,0 +1,98 @@
+/*
+     File: VocanaFFT.h
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Mixed-radix real FFT for the sizes the models' spectra use.
+
+ */
+/*==================================================================================================
+	VocanaFFT.h
+==================================================================================================*/
+
+#ifndef VocanaFFT_h
+#define VocanaFFT_h
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaFFT
+//==================================================================================================
+
+//	DeepFilterNet works on 960-sample frames, 20 ms at 48 kHz, which is not a power of two. Padding
+//	them to 1024 for a radix-2 FFT gives 513 bins at the wrong frequencies and costs more than the
+//	exact transform, so this FFT takes any even size whose half factors into 2, 3 and 5, such as
+//	960 = 2^6 * 3 * 5, and returns exactly size / 2 + 1 bins.
+//
+//	A real transform of size N is a complex transform of N / 2 on the even and odd samples as real
+//	and imaginary parts, untangled afterwards. The complex transform is a Stockham autosort FFT in
+//	radix-4, 2, 3 and 5 stages, so it needs no bit reversal and every stage reads and writes
+//	contiguous runs. The spectra are split complex, real and imaginary parts in separate arrays,
+//	which is what the vector kernels want and what the models' tensors hold. The kernels are
+//	written with the compiler's vector extension, four floats at a time, which becomes NEON on
+//	Apple silicon and SSE on Intel.
+//
+//	The forward transform is unscaled and the inverse is its exact inverse, scaled by 1 / N. The
+//	FFT keeps its work buffers, so a setup is used by one thread at a time. Init and Teardown
+//	allocate; the transforms are real-time safe. Nothing in this file depends on Accelerate.
+
+enum
+{
+	kVocanaFFT_MaxSize                  = 65536,
+	kVocanaFFT_MaxStages                = 16,
+	kVocanaFFT_Alignment                = 64,       //	of every array the FFT allocates
+};
+
+typedef struct VocanaFFTStage
+{
+	uint32_t                radix;
+	uint32_t                length;         //	of the sub-transforms this stage splits
+	uint32_t                stride;         //	between the elements of one sub-transform
+	float*                  twiddleReal;    //	radix - 1 rows of length / radix
+	float*                  twiddleImaginary;
+} VocanaFFTStage;
+
+typedef struct VocanaFFT
+{
+	uint32_t                size;           //	N, real samples
+	uint32_t                stageCount;
+	VocanaFFTStage          stages[kVocanaFFT_MaxStages];
+	float*                  postReal;       //	e^(-2 pi i k / N) for k up to N / 2
+	float*                  postImaginary;
+	float*                  work[4];        //	two split complex buffers of N / 2
+	void*                   memory;
+} VocanaFFT;
+
+//	Whether inSize is a size the FFT takes.
+bool        VocanaFFT_IsValidSize(uint32_t inSize);
+
+//	Sets up the transforms of inSize real samples. Returns 0 on success or an errno value; EINVAL
+//	for a size VocanaFFT_IsValidSize refuses. Not real-time safe.
+int         VocanaFFT_Init(VocanaFFT* outFFT, uint32_t inSize);
+
+void        VocanaFFT_Teardown(VocanaFFT* inFFT);
+
+//	The spectrum of inSize samples, in size / 2 + 1 bins from DC to the Nyquist frequency, whose
+//	imaginary parts are 0.
+void        VocanaFFT_Forward(VocanaFFT* inFFT, const float* inSamples, float* outReal, float* outImaginary);
+
+//	The inSize samples of a spectrum of size / 2 + 1 bins. The imaginary parts of the DC and
+//	Nyquist bins are ignored. inReal and inImaginary are left as they are.
+void        VocanaFFT_Inverse(VocanaFFT* inFFT, const float* inReal, const float* inImaginary, float* outSamples);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VocanaFFT_h */
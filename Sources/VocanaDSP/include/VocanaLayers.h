@@ -0,0 +1,187 @@
+/*
+     File: VocanaLayers.h
+
+ Copyright (C) 2024 Vocana Inc.
+
+ CPU inference for the layers of the denoising models: dense, 1D convolution and GRU, on packed weights.
+
+ */
+/*==================================================================================================
+	VocanaLayers.h
+==================================================================================================*/
+
+#ifndef VocanaLayers_h
+#define VocanaLayers_h
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaLayers
+//==================================================================================================
+
+//	The models run a frame at a time with a batch of one, so every layer is a matrix times a vector,
+//	and what it costs is reading the weights. Init packs a layer's weights into panels of
+//	kVocanaLayers_PanelRows output rows stored input by input, so the product reads the panels once,
+//	front to back, and works on a whole panel's outputs at once in vector registers. The bias and
+//	the activation are applied as a panel's outputs are stored, and tanh and sigmoid are a rational
+//	polynomial, accurate to a few ulp, rather than calls into libm.
+//
+//	VocanaConv1D gathers each output position's window of every input channel and runs it through
+//	the panels of its kernels. VocanaGRU packs the input and hidden weights of all three gates side
+//	by side, so one pass over one matrix gives every gate's input and hidden sums, and the gates,
+//	their activations and the new hidden state follow in one loop over the hidden units. The GRU is
+//	PyTorch's, gates in the order reset, update, new, with the reset gate applied to the new gate's
+//	hidden sum:
+//
+//		r = sigmoid(Wir x + bir + Whr h + bhr)
+//		z = sigmoid(Wiz x + biz + Whz h + bhz)
+//		n = tanh(Win x + bin + r * (Whn h + bhn))
+//		h = (1 - z) * n + z * h
+//
+//	A GRU keeps no hidden state of its own; the caller passes it in, normally a slot of a
+//	VocanaArena, one aligned block reserved up front, so a session's state is a fixed set of slots
+//	that one Clear starts over.
+//
+//	Init and Teardown allocate; everything else is real-time safe. A layer is used by one thread at
+//	a time, since convolution and the GRU keep their scratch in the layer.
+
+typedef enum VocanaActivation
+{
+	kVocanaActivation_None              = 0,
+	kVocanaActivation_ReLU              = 1,
+	kVocanaActivation_Sigmoid           = 2,
+	kVocanaActivation_Tanh              = 3,
+} VocanaActivation;
+
+enum
+{
+	kVocanaLayers_PanelRows             = 8,
+	kVocanaLayers_MaxSize               = 65536,
+};
+
+//	Applies an activation to inCount values in place, with the same approximations as the layers.
+void        VocanaActivation_Apply(VocanaActivation inActivation, float* ioValues, uint32_t inCount);
+
+//==================================================================================================
+#pragma mark VocanaDense
+//==================================================================================================
+
+typedef struct VocanaDense
+{
+	uint32_t                inputCount;
+	uint32_t                outputCount;
+	uint32_t                panelCount;
+	float*                  panels;         //	panelCount panels of inputCount x kVocanaLayers_PanelRows
+	float*                  bias;           //	outputCount rounded up to whole panels
+	void*                   memory;
+} VocanaDense;
+
+//	Packs a layer of inOutputCount outputs of inInputCount inputs from row-major weights,
+//	[inOutputCount][inInputCount], and an optional bias. Returns 0 on success or an errno value.
+//	Not real-time safe.
+int         VocanaDense_Init(VocanaDense* outDense, uint32_t inInputCount, uint32_t inOutputCount, const float* inWeights, const float* inBias);
+
+void        VocanaDense_Teardown(VocanaDense* inDense);
+
+//	outOutput = activation(W inInput + bias). outOutput may not be inInput.
+void        VocanaDense_Forward(const VocanaDense* inDense, const float* inInput, float* outOutput, VocanaActivation inActivation);
+
+//==================================================================================================
+#pragma mark VocanaConv1D
+//==================================================================================================
+
+typedef struct VocanaConv1D
+{
+	VocanaDense             kernels;        //	outputChannels x (inputChannels * kernelSize)
+	uint32_t                inputChannels;
+	uint32_t                outputChannels;
+	uint32_t                kernelSize;
+	uint32_t                stride;
+	float*                  window;         //	one output position's inputs
+	float*                  sums;           //	one output position's outputs
+	void*                   memory;
+} VocanaConv1D;
+
+//	Packs a valid, unpadded convolution from weights [inOutputChannels][inInputChannels][inKernelSize]
+//	and an optional bias. Returns 0 on success or an errno value. Not real-time safe.
+int         VocanaConv1D_Init(VocanaConv1D* outConv, uint32_t inInputChannels, uint32_t inOutputChannels, uint32_t inKernelSize, uint32_t inStride, const float* inWeights, const float* inBias);
+
+void        VocanaConv1D_Teardown(VocanaConv1D* inConv);
+
+//	Output positions of an input inInputLength long, or 0 if it is shorter than the kernel.
+uint32_t    VocanaConv1D_GetOutputLength(const VocanaConv1D* inConv, uint32_t inInputLength);
+
+//	Convolves channel-major input, [inputChannels][inInputLength], into channel-major output,
+//	[outputChannels][GetOutputLength], applying the activation. The input must be at least a kernel
+//	long.
+void        VocanaConv1D_Forward(VocanaConv1D* inConv, const float* inInput, uint32_t inInputLength, float* outOutput, VocanaActivation inActivation);
+
+//==================================================================================================
+#pragma mark VocanaGRU
+//==================================================================================================
+
+typedef struct VocanaGRU
+{
+	uint32_t                inputCount;
+	uint32_t                hiddenCount;
+	uint32_t                panelCount;
+	float*                  panels;         //	3 * hiddenCount rows of inputCount + hiddenCount
+	float*                  inputBias;      //	3 * hiddenCount, rounded up to whole panels
+	float*                  hiddenBias;
+	float*                  inputSums;      //	scratch, the same size
+	float*                  hiddenSums;
+	void*                   memory;
+} VocanaGRU;
+
+//	Packs a GRU from PyTorch's weights, [3 * inHiddenCount][inInputCount + inHiddenCount] with the
+//	gates' input weights then hidden weights on each row, and optional input and hidden biases of
+//	3 * inHiddenCount. Returns 0 on success or an errno value. Not real-time safe.
+int         VocanaGRU_Init(VocanaGRU* outGRU, uint32_t inInputCount, uint32_t inHiddenCount, const float* inWeights, const float* inInputBias, const float* inHiddenBias);
+
+void        VocanaGRU_Teardown(VocanaGRU* inGRU);
+
+//	Runs inSteps steps of input, [inSteps][inputCount], from the hidden state in ioHidden, which
+//	is left holding the state after the last step. outOutput, [inSteps][hiddenCount], receives the
+//	state after every step, and may be NULL.
+void        VocanaGRU_Forward(VocanaGRU* inGRU, const float* inInput, uint32_t inSteps, float* ioHidden, float* outOutput);
+
+//==================================================================================================
+#pragma mark VocanaArena
+//==================================================================================================
+
+typedef struct VocanaArena
+{
+	float*                  base;
+	size_t                  capacity;       //	floats
+	size_t                  used;
+	void*                   memory;
+} VocanaArena;
+
+//	Sets up an arena of inCapacity floats, zeroed. Returns 0 on success or an errno value. Not
+//	real-time safe.
+int         VocanaArena_Init(VocanaArena* outArena, size_t inCapacity);
+
+void        VocanaArena_Teardown(VocanaArena* inArena);
+
+//	Reserves a slot of inCount floats, aligned to kVocanaFFT_Alignment, that lasts as long as the
+//	arena. Returns NULL if the arena doesn't have room.
+float*      VocanaArena_Reserve(VocanaArena* inArena, size_t inCount);
+
+//	Zeroes every slot, as for a new stream.
+void        VocanaArena_Clear(VocanaArena* inArena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VocanaLayers_h */
@@ -0,0 +1,100 @@
+/*
+     File: VocanaNormalizer.h
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Running per-stream feature normalization, updated a frame at a time.
+
+ */
+/*==================================================================================================
+	VocanaNormalizer.h
+==================================================================================================*/
+
+#ifndef VocanaNormalizer_h
+#define VocanaNormalizer_h
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaNormalizer
+//==================================================================================================
+
+//	DeepFilterNet's two feature normalizations, as state that lives as long as the stream. Each
+//	call takes the next frame, moves the state towards it by exponential smoothing and normalizes
+//	the frame against the state, so a stream is normalized the same however its frames are split
+//	into calls, and its first frames are normalized against where the state left off rather than
+//	against nothing.
+//
+//	kVocanaNormalizer_Mean is the ERB features' mean normalization: the state is the running mean
+//	of each band's level in dB, and a band's feature is its level less the mean, over 40.
+//	kVocanaNormalizer_Unit is the deep filtering bins' unit normalization: the state is the running
+//	mean magnitude of each bin, floored at 1e-12 so long digital silence can't decay it to a
+//	denormal, and a bin is divided by the square root of it. Every value is updated independently of
+//	the others, so the loops vectorize.
+//
+//	The state is count floats, which GetState copies out and SetState puts back, so a stream can
+//	move to another normalizer, or be saved and picked up again, without the model seeing features
+//	from a state starting over.
+//
+//	Init and Teardown allocate; everything else is real-time safe. A VocanaNormalizer is used by
+//	one thread at a time.
+
+typedef enum VocanaNormalizerKind
+{
+	kVocanaNormalizer_Mean              = 0,
+	kVocanaNormalizer_Unit              = 1,
+} VocanaNormalizerKind;
+
+enum
+{
+	kVocanaNormalizer_MaxCount          = 65536,
+};
+
+typedef struct VocanaNormalizer
+{
+	VocanaNormalizerKind    kind;
+	uint32_t                count;
+	float                   alpha;          //	the weight the state keeps each frame
+	float*                  state;
+	float*                  initialState;
+	void*                   memory;
+} VocanaNormalizer;
+
+//	Sets up inCount values normalized with smoothing factor inAlpha, in [0, 1), starting from a
+//	state ramping linearly from inInitialFirst to inInitialLast. Returns 0 on success or an errno
+//	value. Not real-time safe.
+int         VocanaNormalizer_Init(VocanaNormalizer* outNormalizer, VocanaNormalizerKind inKind, uint32_t inCount, float inAlpha, float inInitialFirst, float inInitialLast);
+
+void        VocanaNormalizer_Teardown(VocanaNormalizer* inNormalizer);
+
+//	Puts the state back to where Init started it.
+void        VocanaNormalizer_Reset(VocanaNormalizer* inNormalizer);
+
+//	Mean normalization of one frame of count levels in dB. outFeatures may be inLevels.
+void        VocanaNormalizer_NormalizeMean(VocanaNormalizer* inNormalizer, const float* inLevels, float* outFeatures);
+
+//	Unit normalization of one frame of count complex bins. The outputs may be the inputs.
+void        VocanaNormalizer_NormalizeUnit(VocanaNormalizer* inNormalizer, const float* inReal, const float* inImaginary, float* outReal, float* outImaginary);
+
+//	Copies the count floats of state to outState.
+void        VocanaNormalizer_GetState(const VocanaNormalizer* inNormalizer, float* outState);
+
+//	Replaces the state with inCount floats. Returns 0 on success, or EINVAL, leaving the state as
+//	it was, if inCount isn't count or a value isn't finite, or for unit normalization, positive.
+int         VocanaNormalizer_SetState(VocanaNormalizer* inNormalizer, const float* inState, uint32_t inCount);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VocanaNormalizer_h */
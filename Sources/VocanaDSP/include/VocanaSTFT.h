@@ -0,0 +1,105 @@
+/*
+     File: VocanaSTFT.h
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Streaming short-time Fourier analysis and overlap-add synthesis.
+
+ */
+/*==================================================================================================
+	VocanaSTFT.h
+==================================================================================================*/
+
+#ifndef VocanaSTFT_h
+#define VocanaSTFT_h
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include "VocanaFFT.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaSTFT
+//==================================================================================================
+
+//	The STFT the denoisers run on, as a stream: each Analyze call takes the next hop of samples and
+//	writes the spectrum of the frame ending with them, and each Synthesize call takes a spectrum,
+//	overlap-adds its frame and writes the next hop of samples that are complete. Between calls it
+//	keeps the last frame of input and the overlap-add tail, so nothing is ever recomputed and the
+//	frames are the same however the audio arrives.
+//
+//	The synthesis window is the analysis window divided by the sum of its squares over the frames
+//	overlapping each sample, so analysis followed by synthesis gives back the input exactly, delayed
+//	by frameSize - hopSize samples, for any window and any hop that divides the frame size.
+//
+//	kVocanaSTFT_Hann is the periodic Hann window with the spectrum unscaled, as the Swift STFT has
+//	always produced. kVocanaSTFT_Vorbis is DeepFilterNet's window, with the spectrum scaled by its
+//	2 * hop / frameSize^2 the way DeepFilterNet's own frontend scales it, so the models see the
+//	features they were trained on.
+//
+//	The Hops variants run a number of consecutive hops in one call, with the spectra in rows
+//	inFrameStride floats apart, for a whole buffer of frames held as one block.
+//
+//	Init and Teardown allocate; everything else is real-time safe. A VocanaSTFT is used by one
+//	thread at a time. Nothing in this file depends on Accelerate.
+
+typedef enum VocanaSTFTWindow
+{
+	kVocanaSTFT_Hann                    = 0,
+	kVocanaSTFT_Vorbis                  = 1,
+} VocanaSTFTWindow;
+
+typedef struct VocanaSTFT
+{
+	VocanaFFT               fft;
+	uint32_t                frameSize;
+	uint32_t                hopSize;
+	uint32_t                binCount;       //	frameSize / 2 + 1
+	float                   spectrumScale;
+	float*                  analysisWindow;
+	float*                  synthesisWindow;
+	float*                  input;          //	the last frameSize samples analyzed
+	float*                  output;         //	the overlap-add accumulator, frameSize samples
+	float*                  frame;
+	void*                   memory;
+} VocanaSTFT;
+
+//	Sets up an STFT of inFrameSize samples, a size VocanaFFT takes, every inHopSize samples, which
+//	must divide inFrameSize. Returns 0 on success or an errno value. Not real-time safe.
+int         VocanaSTFT_Init(VocanaSTFT* outSTFT, uint32_t inFrameSize, uint32_t inHopSize, VocanaSTFTWindow inWindow);
+
+void        VocanaSTFT_Teardown(VocanaSTFT* inSTFT);
+
+//	Forgets the audio seen so far in both directions, as if the STFT had just been set up.
+void        VocanaSTFT_Reset(VocanaSTFT* inSTFT);
+
+//	How many samples the output of Synthesize is behind the input of Analyze.
+uint32_t    VocanaSTFT_GetLatency(const VocanaSTFT* inSTFT);
+
+//	Appends hopSize samples to the input and writes the spectrum of the last frame, binCount bins.
+void        VocanaSTFT_Analyze(VocanaSTFT* inSTFT, const float* inHop, float* outReal, float* outImaginary);
+
+//	Overlap-adds the frame of a spectrum of binCount bins and writes the next hopSize samples.
+void        VocanaSTFT_Synthesize(VocanaSTFT* inSTFT, const float* inReal, const float* inImaginary, float* outHop);
+
+//	Analyze for inHopCount consecutive hops of inSamples, each spectrum inFrameStride floats after
+//	the one before it.
+void        VocanaSTFT_AnalyzeHops(VocanaSTFT* inSTFT, const float* inSamples, uint32_t inHopCount, float* outReal, float* outImaginary, size_t inFrameStride);
+
+//	Synthesize for inHopCount spectra inFrameStride floats apart, writing inHopCount hops.
+void        VocanaSTFT_SynthesizeHops(VocanaSTFT* inSTFT, const float* inReal, const float* inImaginary, uint32_t inHopCount, size_t inFrameStride, float* outSamples);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VocanaSTFT_h */
@@ -0,0 +1,111 @@
+/*
+     File: VocanaSpectrogram.h
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Contiguous, aligned frames x bins storage for spectra, features and masks.
+
+ */
+/*==================================================================================================
+	VocanaSpectrogram.h
+==================================================================================================*/
+
+#ifndef VocanaSpectrogram_h
+#define VocanaSpectrogram_h
+
+//==================================================================================================
+//	Includes
+//==================================================================================================
+
+#include "VocanaFFT.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//==================================================================================================
+#pragma mark -
+#pragma mark VocanaSpectrogram
+//==================================================================================================
+
+//	A block of frames x bins floats the way both the DSP and the models want it: one allocation,
+//	aligned to kVocanaFFT_Alignment, holding the real parts of every frame followed directly by the
+//	imaginary parts of every frame. Each frame starts frameStride floats after the one before it,
+//	frameStride being binCount rounded up to a whole alignment, so every row is aligned for vector
+//	loads and the STFT, feature and filter kernels work on rows in place, with nothing copied
+//	between stages. Real-valued blocks, such as ERB features and masks, have one plane.
+//
+//	The imaginary plane always starts frameCount * frameStride floats after the real one. When the
+//	bins fill their rows, as DeepFilterNet's 32 ERB bands and 96 deep filtering bins do, the whole
+//	block is a dense [planeCount, frameCount, binCount] array, which is the layout of the models'
+//	[1, 1, T, 32] and [1, 2, T, 96] feature inputs, so ONNXCreateTensorFloatWithData can wrap it
+//	as it stands. VocanaSpectrogram_IsDense says whether it can.
+//
+//	SetFrameCount changes the number of frames without allocating, up to the capacity given to
+//	Init or Reserve, moving the imaginary plane to keep it straight after the real one. Init,
+//	Reserve and Teardown allocate; everything else is real-time safe. A VocanaSpectrogram is used
+//	by one thread at a time.
+
+enum
+{
+	kVocanaSpectrogram_MaxBins          = 65536,
+	kVocanaSpectrogram_MaxFrames        = 1 << 20,
+};
+
+typedef struct VocanaSpectrogram
+{
+	uint32_t                frameCount;
+	uint32_t                frameCapacity;
+	uint32_t                binCount;
+	uint32_t                frameStride;    //	binCount rounded up to kVocanaFFT_Alignment
+	uint32_t                planeCount;     //	1 for real values, 2 for complex
+	float*                  real;
+	float*                  imaginary;      //	NULL with one plane
+	void*                   memory;
+} VocanaSpectrogram;
+
+//	Sets up inFrameCount zeroed frames of inBinCount bins in inPlaneCount planes, 1 or 2, with room
+//	for inFrameCapacity frames, which is raised to inFrameCount if smaller. Returns 0 on success or
+//	an errno value. Not real-time safe.
+int         VocanaSpectrogram_Init(VocanaSpectrogram* outSpectrogram, uint32_t inFrameCount, uint32_t inFrameCapacity, uint32_t inBinCount, uint32_t inPlaneCount);
+
+void        VocanaSpectrogram_Teardown(VocanaSpectrogram* inSpectrogram);
+
+//	Makes room for inFrameCapacity frames, keeping the frames there are. Does nothing if there is
+//	room already. Returns 0 on success or ENOMEM, leaving the spectrogram as it was. Not real-time
+//	safe.
+int         VocanaSpectrogram_Reserve(VocanaSpectrogram* ioSpectrogram, uint32_t inFrameCapacity);
+
+//	Changes the number of frames, keeping the frames there are and zeroing any added. Returns 0 on
+//	success or EINVAL past the capacity.
+int         VocanaSpectrogram_SetFrameCount(VocanaSpectrogram* ioSpectrogram, uint32_t inFrameCount);
+
+//	Zeroes every frame.
+void        VocanaSpectrogram_Clear(VocanaSpectrogram* ioSpectrogram);
+
+//	Whether the rows have no padding, so the planes are dense [frameCount, binCount] arrays.
+bool        VocanaSpectrogram_IsDense(const VocanaSpectrogram* inSpectrogram);
+
+//	The floats each plane spans: frameCount * frameStride.
+size_t      VocanaSpectrogram_GetPlaneSize(const VocanaSpectrogram* inSpectrogram);
+
+//	Real and imaginary parts of a frame.
+static inline float* VocanaSpectrogram_Real(const VocanaSpectrogram* inSpectrogram, uint32_t inFrame)
+{
+	return inSpectrogram->real + (size_t)inFrame * inSpectrogram->frameStride;
+}
+
+static inline float* VocanaSpectrogram_Imaginary(const VocanaSpectrogram* inSpectrogram, uint32_t inFrame)
+{
+	return inSpectrogram->imaginary + (size_t)inFrame * inSpectrogram->frameStride;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VocanaSpectrogram_h */
@@ -0,0 +1,1021 @@
+/*
+     File: ONNXRuntimeBridgeTests.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Host-side tests for ONNXRuntimeBridge.c against a real libonnxruntime: tensors that wrap caller
+ buffers, runs into pre-allocated outputs, IO bindings reused across runs, the errors the bridge
+ reports, the shared environment, the optimized model cache, the session pool, the encoder and
+ decoder pipeline, and the allocations and time per frame of the copying calls against the bound
+ ones and the pipeline for three models shaped like DeepFilterNet's. The models are written by the test itself, so
+ nothing but the library is needed; see run_tests.sh.
+
+ */
+
+#include "ONNXRuntimeBridge.h"
+#include "VocanaDriverTestSupport.h"
+
+#include <dirent.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#define kTest_InputSize         256
+#define kTest_ModelCount        3
+#define kTest_Frames            2000
+
+//	enc, erb_dec and df_dec, each a single y = tanh(x W + b) with their outputs' sizes
+static const int64_t kTest_OutputSizes[kTest_ModelCount] = { 256, 32, 960 };
+
+static ONNXEnv* gTest_Env = NULL;
+static char gTest_Directory[] = "/tmp/vocana-onnx-XXXXXX";
+
+//==================================================================================================
+//	Allocation counting
+//==================================================================================================
+
+//	glibc's own entry points stay callable under these names, so the test can count every heap
+//	allocation the runtime makes, C++ operator new included, and pass it on. AddressSanitizer
+//	brings its own allocator, which these would bypass, so sanitized builds don't count.
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+#define kTest_CountsAllocations 1
+
+extern void* __libc_malloc(size_t inSize);
+extern void* __libc_calloc(size_t inCount, size_t inSize);
+extern void* __libc_realloc(void* inPointer, size_t inSize);
+extern void* __libc_memalign(size_t inAlignment, size_t inSize);
+extern void __libc_free(void* inPointer);
+
+static atomic_long gTest_Allocations = 0;
+
+void* malloc(size_t inSize)
+{
+    atomic_fetch_add_explicit(&gTest_Allocations, 1, memory_order_relaxed);
+    return __libc_malloc(inSize);
+}
+
+void* calloc(size_t inCount, size_t inSize)
+{
+    atomic_fetch_add_explicit(&gTest_Allocations, 1, memory_order_relaxed);
+    return __libc_calloc(inCount, inSize);
+}
+
+void* realloc(void* inPointer, size_t inSize)
+{
+    atomic_fetch_add_explicit(&gTest_Allocations, 1, memory_order_relaxed);
+    return __libc_realloc(inPointer, inSize);
+}
+
+void* aligned_alloc(size_t inAlignment, size_t inSize)
+{
+    atomic_fetch_add_explicit(&gTest_Allocations, 1, memory_order_relaxed);
+    return __libc_memalign(inAlignment, inSize);
+}
+
+void* memalign(size_t inAlignment, size_t inSize)
+{
+    atomic_fetch_add_explicit(&gTest_Allocations, 1, memory_order_relaxed);
+    return __libc_memalign(inAlignment, inSize);
+}
+
+int posix_memalign(void** outPointer, size_t inAlignment, size_t inSize)
+{
+    atomic_fetch_add_explicit(&gTest_Allocations, 1, memory_order_relaxed);
+    void* thePointer = __libc_memalign(inAlignment, inSize);
+    if(thePointer == NULL)
+    {
+        return 12;
+    }
+    *outPointer = thePointer;
+    return 0;
+}
+
+void free(void* inPointer)
+{
+    __libc_free(inPointer);
+}
+
+static long test_allocations(void)
+{
+    return atomic_load(&gTest_Allocations);
+}
+#else
+#define kTest_CountsAllocations 0
+
+static long test_allocations(void)
+{
+    return 0;
+}
+#endif
+
+//==================================================================================================
+//	Model writer
+//==================================================================================================
+
+//	Just enough of the protobuf wire format to write an ONNX ModelProto: varints, and fields that
+//	are either varints or length-delimited bytes, which nested messages are.
+typedef struct TestBuffer
+{
+    uint8_t*    bytes;
+    size_t      length;
+    size_t      capacity;
+} TestBuffer;
+
+static void buffer_append(TestBuffer* ioBuffer, const void* inBytes, size_t inLength)
+{
+    if(ioBuffer->length + inLength > ioBuffer->capacity)
+    {
+        ioBuffer->capacity = (ioBuffer->length + inLength) * 2;
+        ioBuffer->bytes = realloc(ioBuffer->bytes, ioBuffer->capacity);
+    }
+    memcpy(ioBuffer->bytes + ioBuffer->length, inBytes, inLength);
+    ioBuffer->length += inLength;
+}
+
+static void buffer_varint(TestBuffer* ioBuffer, uint64_t inValue)
+{
+    uint8_t theByte;
+    do
+    {
+        theByte = (uint8_t)(inValue & 0x7F);
+        inValue >>= 7;
+        if(inValue != 0)
+        {
+            theByte |= 0x80;
+        }
+        buffer_append(ioBuffer, &theByte, 1);
+    } while(inValue != 0);
+}
+
+static void buffer_int_field(TestBuffer* ioBuffer, uint32_t inField, uint64_t inValue)
+{
+    buffer_varint(ioBuffer, (uint64_t)inField << 3);
+    buffer_varint(ioBuffer, inValue);
+}
+
+static void buffer_bytes_field(TestBuffer* ioBuffer, uint32_t inField, const void* inBytes, size_t inLength)
+{
+    buffer_varint(ioBuffer, ((uint64_t)inField << 3) | 2);
+    buffer_varint(ioBuffer, inLength);
+    buffer_append(ioBuffer, inBytes, inLength);
+}
+
+static void buffer_string_field(TestBuffer* ioBuffer, uint32_t inField, const char* inString)
+{
+    buffer_bytes_field(ioBuffer, inField, inString, strlen(inString));
+}
+
+//	moves a finished nested message into its parent and frees it
+static void buffer_message_field(TestBuffer* ioBuffer, uint32_t inField, TestBuffer* inMessage)
+{
+    buffer_bytes_field(ioBuffer, inField, inMessage->bytes, inMessage->length);
+    free(inMessage->bytes);
+    memset(inMessage, 0, sizeof(*inMessage));
+}
+
+//	a ValueInfoProto for a float tensor of [1, inSize]
+static void model_value_info(TestBuffer* ioGraph, uint32_t inField, const char* inName, int64_t inSize)
+{
+    TestBuffer theShape = { 0 };
+    int64_t theDimensions[2] = { 1, inSize };
+    for(int d = 0; d < 2; d++)
+    {
+        TestBuffer theDimension = { 0 };
+        buffer_int_field(&theDimension, 1, (uint64_t)theDimensions[d]);
+        buffer_message_field(&theShape, 1, &theDimension);
+    }
+    TestBuffer theTensorType = { 0 };
+    buffer_int_field(&theTensorType, 1, 1);
+    buffer_message_field(&theTensorType, 2, &theShape);
+    TestBuffer theType = { 0 };
+    buffer_message_field(&theType, 1, &theTensorType);
+    TestBuffer theValueInfo = { 0 };
+    buffer_string_field(&theValueInfo, 1, inName);
+    buffer_message_field(&theValueInfo, 2, &theType);
+    buffer_message_field(ioGraph, inField, &theValueInfo);
+}
+
+static void model_initializer(TestBuffer* ioGraph, const char* inName, const int64_t* inShape, int inShapeCount, const float* inData)
+{
+    TestBuffer theTensor = { 0 };
+    size_t theCount = 1;
+    for(int d = 0; d < inShapeCount; d++)
+    {
+        buffer_int_field(&theTensor, 1, (uint64_t)inShape[d]);
+        theCount *= (size_t)inShape[d];
+    }
+    buffer_int_field(&theTensor, 2, 1);
+    buffer_string_field(&theTensor, 8, inName);
+    buffer_bytes_field(&theTensor, 9, inData, theCount * sizeof(float));
+    buffer_message_field(ioGraph, 5, &theTensor);
+}
+
+static void model_node(TestBuffer* ioGraph, const char* inOpType, const char* inInput0, const char* inInput1, const char* inOutput)
+{
+    TestBuffer theNode = { 0 };
+    buffer_string_field(&theNode, 1, inInput0);
+    if(inInput1 != NULL)
+    {
+        buffer_string_field(&theNode, 1, inInput1);
+    }
+    buffer_string_field(&theNode, 2, inOutput);
+    buffer_string_field(&theNode, 3, inOutput);
+    buffer_string_field(&theNode, 4, inOpType);
+    buffer_message_field(ioGraph, 1, &theNode);
+}
+
+//	the weights the models are made with, so the tests can work out what they should return
+static float test_weight(int inModel, int64_t inRow, int64_t inColumn)
+{
+    return (float)sin(0.37 * inRow + 0.11 * inColumn + inModel) / 16.0f;
+}
+
+static float test_bias(int inModel, int64_t inColumn)
+{
+    return (float)cos(0.23 * inColumn + inModel) / 8.0f;
+}
+
+//	writes model inModel, y = tanh(x W + b) from inInput [1, 256] to inOutput [1, outputSize], and
+//	returns its path
+static const char* test_write_named_model(int inModel, const char* inInput, const char* inOutput)
+{
+    static char thePaths[2 * kTest_ModelCount][96];
+    char* thePath = thePaths[2 * inModel + (strcmp(inInput, "x") != 0)];
+    int64_t theOutputSize = kTest_OutputSizes[inModel];
+
+    float* theWeights = malloc((size_t)(kTest_InputSize * theOutputSize) * sizeof(float));
+    float* theBias = malloc((size_t)theOutputSize * sizeof(float));
+    for(int64_t r = 0; r < kTest_InputSize; r++)
+    {
+        for(int64_t c = 0; c < theOutputSize; c++)
+        {
+            theWeights[r * theOutputSize + c] = test_weight(inModel, r, c);
+        }
+    }
+    for(int64_t c = 0; c < theOutputSize; c++)
+    {
+        theBias[c] = test_bias(inModel, c);
+    }
+
+    TestBuffer theGraph = { 0 };
+    model_node(&theGraph, "MatMul", inInput, "W", "xW");
+    model_node(&theGraph, "Add", "xW", "b", "xWb");
+    model_node(&theGraph, "Tanh", "xWb", NULL, inOutput);
+    buffer_string_field(&theGraph, 2, "test");
+    int64_t theWeightShape[2] = { kTest_InputSize, theOutputSize };
+    model_initializer(&theGraph, "W", theWeightShape, 2, theWeights);
+    model_initializer(&theGraph, "b", &theOutputSize, 1, theBias);
+    model_value_info(&theGraph, 11, inInput, kTest_InputSize);
+    model_value_info(&theGraph, 12, inOutput, theOutputSize);
+
+    TestBuffer theOpset = { 0 };
+    buffer_string_field(&theOpset, 1, "");
+    buffer_int_field(&theOpset, 2, 13);
+    TestBuffer theModel = { 0 };
+    buffer_int_field(&theModel, 1, 8);
+    buffer_string_field(&theModel, 2, "vocana-tests");
+    buffer_message_field(&theModel, 7, &theGraph);
+    buffer_message_field(&theModel, 8, &theOpset);
+
+    snprintf(thePath, sizeof(thePaths[0]), "%s/%s-model%d.onnx", gTest_Directory, inInput, inModel);
+    FILE* theFile = fopen(thePath, "wb");
+    CHECK(theFile != NULL);
+    if(theFile != NULL)
+    {
+        fwrite(theModel.bytes, 1, theModel.length, theFile);
+        fclose(theFile);
+    }
+    free(theModel.bytes);
+    free(theWeights);
+    free(theBias);
+    return thePath;
+}
+
+static const char* test_write_model(int inModel)
+{
+    return test_write_named_model(inModel, "x", "y");
+}
+
+static ONNXSession* test_open_path(const char* inPath)
+{
+    ONNXSessionOptions* theOptions = NULL;
+    CHECK_EQUAL(ONNXCreateSessionOptions(&theOptions), ONNX_STATUS_OK);
+    CHECK_EQUAL(ONNXSetIntraOpNumThreads(theOptions, 1), ONNX_STATUS_OK);
+    CHECK_EQUAL(ONNXSetGraphOptimizationLevel(theOptions, 3), ONNX_STATUS_OK);
+
+    ONNXSession* theSession = NULL;
+    ONNXStatus theStatus = ONNXCreateSession(gTest_Env, inPath, theOptions, &theSession);
+    if(theStatus != ONNX_STATUS_OK)
+    {
+        fprintf(stderr, "    %s\n", ONNXGetLastErrorMessage());
+    }
+    CHECK_EQUAL(theStatus, ONNX_STATUS_OK);
+    ONNXReleaseSessionOptions(theOptions);
+    return theSession;
+}
+
+static ONNXSession* test_open_model(int inModel)
+{
+    return test_open_path(test_write_model(inModel));
+}
+
+static void test_fill_input(float* outInput, int inFrame)
+{
+    for(int n = 0; n < kTest_InputSize; n++)
+    {
+        outInput[n] = (float)sin(0.05 * n + 0.3 * inFrame);
+    }
+}
+
+//	the largest difference between an output and tanh(x W + b) worked out here
+static double test_output_error(int inModel, const float* inInput, const float* inOutput)
+{
+    double theError = 0.0;
+    for(int64_t c = 0; c < kTest_OutputSizes[inModel]; c++)
+    {
+        double theSum = test_bias(inModel, c);
+        for(int64_t r = 0; r < kTest_InputSize; r++)
+        {
+            theSum += (double)inInput[r] * test_weight(inModel, r, c);
+        }
+        theError = fmax(theError, fabs(tanh(theSum) - inOutput[c]));
+    }
+    return theError;
+}
+
+//==================================================================================================
+//	Tests
+//==================================================================================================
+
+static void test_session_names(void)
+{
+    ONNXSession* theSession = test_open_model(0);
+    size_t theCount = 0;
+    CHECK_EQUAL(ONNXSessionGetInputCount(theSession, &theCount), ONNX_STATUS_OK);
+    CHECK_EQUAL(theCount, 1);
+    CHECK_EQUAL(ONNXSessionGetOutputCount(theSession, &theCount), ONNX_STATUS_OK);
+    CHECK_EQUAL(theCount, 1);
+
+    char theName[16];
+    CHECK_EQUAL(ONNXSessionGetInputName(theSession, 0, theName, sizeof(theName)), ONNX_STATUS_OK);
+    CHECK(strcmp(theName, "x") == 0);
+    CHECK_EQUAL(ONNXSessionGetOutputName(theSession, 0, theName, sizeof(theName)), ONNX_STATUS_OK);
+    CHECK(strcmp(theName, "y") == 0);
+
+    //	"x" and its terminator need two bytes
+    CHECK_EQUAL(ONNXSessionGetInputName(theSession, 0, theName, 1), ONNX_STATUS_INVALID_ARGUMENT);
+    ONNXReleaseSession(theSession);
+}
+
+static void test_copying_run(void)
+{
+    ONNXSession* theSession = test_open_model(1);
+    float theInput[kTest_InputSize];
+    test_fill_input(theInput, 0);
+
+    int64_t theShape[2] = { 1, kTest_InputSize };
+    ONNXValue* theValue = NULL;
+    CHECK_EQUAL(ONNXCreateTensorFloat(theInput, kTest_InputSize, theShape, 2, &theValue), ONNX_STATUS_OK);
+
+    //	the value has its own copy
+    memset(theInput, 0, sizeof(theInput));
+    float* theData = NULL;
+    size_t theCount = 0;
+    CHECK_EQUAL(ONNXGetTensorFloatDataPointer(theValue, &theData, &theCount), ONNX_STATUS_OK);
+    CHECK_EQUAL(theCount, kTest_InputSize);
+    CHECK(theData != theInput);
+    test_fill_input(theInput, 0);
+    CHECK(memcmp(theData, theInput, sizeof(theInput)) == 0);
+
+    const char* theInputNames[1] = { "x" };
+    const char* theOutputNames[1] = { "y" };
+    const ONNXValue* theInputs[1] = { theValue };
+    ONNXValue* theOutputs[1] = { NULL };
+    CHECK_EQUAL(ONNXSessionRun(theSession, theInputNames, theInputs, 1, theOutputNames, 1, theOutputs), ONNX_STATUS_OK);
+    CHECK(theOutputs[0] != NULL);
+
+    int64_t theOutputShape[4];
+    size_t theShapeCount = 4;
+    CHECK_EQUAL(ONNXGetTensorShape(theOutputs[0], theOutputShape, &theShapeCount), ONNX_STATUS_OK);
+    CHECK_EQUAL(theShapeCount, 2);
+    CHECK_EQUAL(theOutputShape[1], kTest_OutputSizes[1]);
+    theShapeCount = 1;
+    CHECK_EQUAL(ONNXGetTensorShape(theOutputs[0], theOutputShape, &theShapeCount), ONNX_STATUS_INVALID_ARGUMENT);
+
+    float theOutput[32];
+    CHECK_EQUAL(ONNXGetTensorFloatData(theOutputs[0], theOutput, 31), ONNX_STATUS_INVALID_ARGUMENT);
+    CHECK_EQUAL(ONNXGetTensorFloatData(theOutputs[0], theOutput, 32), ONNX_STATUS_OK);
+    CHECK(test_output_error(1, theInput, theOutput) < 1.0e-4);
+
+    ONNXReleaseValue(theOutputs[0]);
+    ONNXReleaseValue(theValue);
+    ONNXReleaseSession(theSession);
+}
+
+static void test_caller_owned_tensors(void)
+{
+    ONNXSession* theSession = test_open_model(1);
+    float theInput[kTest_InputSize];
+    float theOutput[32];
+    memset(theOutput, 0, sizeof(theOutput));
+
+    int64_t theInputShape[2] = { 1, kTest_InputSize };
+    int64_t theOutputShape[2] = { 1, 32 };
+    ONNXValue* theInputValue = NULL;
+    ONNXValue* theOutputValue = NULL;
+    CHECK_EQUAL(ONNXCreateTensorFloatWithData(theInput, kTest_InputSize, theInputShape, 2, &theInputValue), ONNX_STATUS_OK);
+    CHECK_EQUAL(ONNXCreateTensorFloatWithData(theOutput, 32, theOutputShape, 2, &theOutputValue), ONNX_STATUS_OK);
+
+    //	the values are the caller's buffers
+    float* theData = NULL;
+    size_t theCount = 0;
+    CHECK_EQUAL(ONNXGetTensorFloatDataPointer(theInputValue, &theData, &theCount), ONNX_STATUS_OK);
+    CHECK(theData == theInput);
+    CHECK_EQUAL(theCount, kTest_InputSize);
+
+    //	so rewriting the buffer between runs is all a new frame takes, and the output lands in place
+    const char* theInputNames[1] = { "x" };
+    const char* theOutputNames[1] = { "y" };
+    const ONNXValue* theInputs[1] = { theInputValue };
+    for(int theFrame = 0; theFrame < 3; theFrame++)
+    {
+        test_fill_input(theInput, theFrame);
+        ONNXValue* theOutputs[1] = { theOutputValue };
+        CHECK_EQUAL(ONNXSessionRun(theSession, theInputNames, theInputs, 1, theOutputNames, 1, theOutputs), ONNX_STATUS_OK);
+        CHECK(theOutputs[0] == theOutputValue);
+        CHECK(test_output_error(1, theInput, theOutput) < 1.0e-4);
+    }
+
+    ONNXReleaseValue(theInputValue);
+    ONNXReleaseValue(theOutputValue);
+    ONNXReleaseSession(theSession);
+}
+
+static void test_io_binding(void)
+{
+    ONNXSession* theSession = test_open_model(2);
+    float theInput[kTest_InputSize];
+    float theOutput[960];
+    float theOtherOutput[960];
+
+    int64_t theInputShape[2] = { 1, kTest_InputSize };
+    int64_t theOutputShape[2] = { 1, 960 };
+    ONNXValue* theInputValue = NULL;
+    ONNXValue* theOutputValue = NULL;
+    ONNXValue* theOtherOutputValue = NULL;
+    CHECK_EQUAL(ONNXCreateTensorFloatWithData(theInput, kTest_InputSize, theInputShape, 2, &theInputValue), ONNX_STATUS_OK);
+    CHECK_EQUAL(ONNXCreateTensorFloatWithData(theOutput, 960, theOutputShape, 2, &theOutputValue), ONNX_STATUS_OK);
+    CHECK_EQUAL(ONNXCreateTensorFloatWithData(theOtherOutput, 960, theOutputShape, 2, &theOtherOutputValue), ONNX_STATUS_OK);
+
+    ONNXIOBinding* theBinding = NULL;
+    CHECK_EQUAL(ONNXCreateIOBinding(theSession, &theBinding), ONNX_STATUS_OK);
+    CHECK_EQUAL(ONNXIOBindingBindInput(theBinding, "x", theInputValue), ONNX_STATUS_OK);
+    CHECK_EQUAL(ONNXIOBindingBindOutput(theBinding, "y", theOutputValue), ONNX_STATUS_OK);
+    for(int theFrame = 0; theFrame < 3; theFrame++)
+    {
+        test_fill_input(theInput, theFrame);
+        CHECK_EQUAL(ONNXSessionRunWithBinding(theSession, theBinding), ONNX_STATUS_OK);
+        CHECK(test_output_error(2, theInput, theOutput) < 1.0e-4);
+    }
+
+    //	after clearing, the same binding can point somewhere else
+    memset(theOtherOutput, 0, sizeof(theOtherOutput));
+    ONNXIOBindingClear(theBinding);
+    CHECK_EQUAL(ONNXIOBindingBindInput(theBinding, "x", theInputValue), ONNX_STATUS_OK);
+    CHECK_EQUAL(ONNXIOBindingBindOutput(theBinding, "y", theOtherOutputValue), ONNX_STATUS_OK);
+    CHECK_EQUAL(ONNXSessionRunWithBinding(theSession, theBinding), ONNX_STATUS_OK);
+    CHECK(test_output_error(2, theInput, theOtherOutput) < 1.0e-4);
+
+    CHECK(ONNXIOBindingBindInput(theBinding, "no such input", theInputValue) != ONNX_STATUS_OK);
+
+    ONNXReleaseIOBinding(theBinding);
+    ONNXReleaseValue(theInputValue);
+    ONNXReleaseValue(theOutputValue);
+    ONNXReleaseValue(theOtherOutputValue);
+    ONNXReleaseSession(theSession);
+}
+
+static void test_errors(void)
+{
+    float theData[8] = { 0 };
+    int64_t theShape[2] = { 2, 4 };
+    ONNXValue* theValue = NULL;
+    CHECK_EQUAL(ONNXCreateTensorFloatWithData(theData, 7, theShape, 2, &theValue), ONNX_STATUS_INVALID_ARGUMENT);
+    CHECK_EQUAL(ONNXCreateTensorFloat(theData, 9, theShape, 2, &theValue), ONNX_STATUS_INVALID_ARGUMENT);
+    CHECK_EQUAL(ONNXCreateTensorFloatWithData(NULL, 8, theShape, 2, &theValue), ONNX_STATUS_INVALID_ARGUMENT);
+    CHECK(strlen(ONNXGetLastErrorMessage()) > 0);
+
+    int64_t theNegativeShape[2] = { -1, 8 };
+    CHECK_EQUAL(ONNXCreateTensorFloatWithData(theData, 8, theNegativeShape, 2, &theValue), ONNX_STATUS_INVALID_ARGUMENT);
+
+    ONNXSession* theSession = NULL;
+    char thePath[64];
+    snprintf(thePath, sizeof(thePath), "%s/missing.onnx", gTest_Directory);
+    CHECK(ONNXCreateSession(gTest_Env, thePath, NULL, &theSession) != ONNX_STATUS_OK);
+    CHECK(theSession == NULL);
+    CHECK(strlen(ONNXGetLastErrorMessage()) > 0);
+
+    ONNXSessionOptions* theOptions = NULL;
+    CHECK_EQUAL(ONNXCreateSessionOptions(&theOptions), ONNX_STATUS_OK);
+    CHECK_EQUAL(ONNXSetGraphOptimizationLevel(theOptions, 4), ONNX_STATUS_INVALID_ARGUMENT);
+    ONNXReleaseSessionOptions(theOptions);
+
+    //	releasing nothing is fine
+    ONNXReleaseValue(NULL);
+    ONNXReleaseIOBinding(NULL);
+    ONNXReleaseSession(NULL);
+}
+
+//	the largest error of a session of model inModel on one frame, run through the copying calls
+static double test_run_error(ONNXSession* inSession, int inModel)
+{
+    float theInput[kTest_InputSize];
+    float theOutput[960];
+    test_fill_input(theInput, inModel);
+
+    int64_t theShape[2] = { 1, kTest_InputSize };
+    ONNXValue* theValue = NULL;
+    CHECK_EQUAL(ONNXCreateTensorFloat(theInput, kTest_InputSize, theShape, 2, &theValue), ONNX_STATUS_OK);
+    const char* theInputNames[1] = { "x" };
+    const char* theOutputNames[1] = { "y" };
+    const ONNXValue* theInputs[1] = { theValue };
+    ONNXValue* theOutputs[1] = { NULL };
+    ONNXStatus theStatus = ONNXSessionRun(inSession, theInputNames, theInputs, 1, theOutputNames, 1, theOutputs);
+    CHECK_EQUAL(theStatus, ONNX_STATUS_OK);
+    double theError = 1.0;
+    if(theStatus == ONNX_STATUS_OK && ONNXGetTensorFloatData(theOutputs[0], theOutput, 960) == ONNX_STATUS_OK)
+    {
+        theError = test_output_error(inModel, theInput, theOutput);
+    }
+    ONNXReleaseValue(theOutputs[0]);
+    ONNXReleaseValue(theValue);
+    return theError;
+}
+
+//	the number of files in a directory, which is then emptied and removed
+static int test_remove_directory(const char* inPath)
+{
+    int theCount = 0;
+    DIR* theDirectory = opendir(inPath);
+    if(theDirectory == NULL)
+    {
+        return 0;
+    }
+    struct dirent* theEntry;
+    while((theEntry = readdir(theDirectory)) != NULL)
+    {
+        if(theEntry->d_name[0] != '.')
+        {
+            char thePath[512];
+            snprintf(thePath, sizeof(thePath), "%s/%s", inPath, theEntry->d_name);
+            unlink(thePath);
+            ++theCount;
+        }
+    }
+    closedir(theDirectory);
+    rmdir(inPath);
+    return theCount;
+}
+
+static void test_shared_env(void)
+{
+    ONNXEnv* theEnv = NULL;
+    ONNXEnv* theSameEnv = NULL;
+    CHECK_EQUAL(ONNXGetSharedEnv(&theEnv), ONNX_STATUS_OK);
+    CHECK_EQUAL(ONNXGetSharedEnv(&theSameEnv), ONNX_STATUS_OK);
+    CHECK(theEnv != NULL);
+    CHECK(theEnv == theSameEnv);
+
+    //	nobody gets to release it from under everyone else
+    ONNXReleaseEnv(theEnv);
+    ONNXSession* theSession = NULL;
+    CHECK_EQUAL(ONNXCreateSession(theEnv, test_write_model(0), NULL, &theSession), ONNX_STATUS_OK);
+    CHECK(test_run_error(theSession, 0) < 1.0e-4);
+    ONNXReleaseSession(theSession);
+}
+
+static void test_optimized_model_cache(void)
+{
+    char theCache[64];
+    snprintf(theCache, sizeof(theCache), "%s/cache", gTest_Directory);
+    const char* theModel = test_write_model(2);
+
+    //	the first session optimizes and writes the copy, the second loads it
+    double theTimes[2];
+    for(int theRun = 0; theRun < 2; theRun++)
+    {
+        ONNXSession* theSession = NULL;
+        theTimes[theRun] = test_now_seconds();
+        CHECK_EQUAL(ONNXCreateSessionWithCache(gTest_Env, theModel, 1, 3, theCache, &theSession), ONNX_STATUS_OK);
+        theTimes[theRun] = (test_now_seconds() - theTimes[theRun]) * 1.0e3;
+        CHECK(test_run_error(theSession, 2) < 1.0e-4);
+        ONNXReleaseSession(theSession);
+    }
+    printf("    %.2f ms to create a session optimizing the model, %.2f ms loading the optimized copy\n", theTimes[0], theTimes[1]);
+
+    //	another level is another copy
+    ONNXSession* theSession = NULL;
+    CHECK_EQUAL(ONNXCreateSessionWithCache(gTest_Env, theModel, 1, 1, theCache, &theSession), ONNX_STATUS_OK);
+    CHECK(test_run_error(theSession, 2) < 1.0e-4);
+    ONNXReleaseSession(theSession);
+    CHECK_EQUAL(test_remove_directory(theCache), 2);
+
+    //	a copy that won't load is replaced
+    CHECK_EQUAL(ONNXCreateSessionWithCache(gTest_Env, theModel, 1, 3, theCache, &theSession), ONNX_STATUS_OK);
+    ONNXReleaseSession(theSession);
+    DIR* theDirectory = opendir(theCache);
+    struct dirent* theEntry;
+    char theCopy[512] = "";
+    while(theDirectory != NULL && (theEntry = readdir(theDirectory)) != NULL)
+    {
+        if(theEntry->d_name[0] != '.')
+        {
+            snprintf(theCopy, sizeof(theCopy), "%s/%s", theCache, theEntry->d_name);
+        }
+    }
+    if(theDirectory != NULL)
+    {
+        closedir(theDirectory);
+    }
+    FILE* theFile = fopen(theCopy, "wb");
+    CHECK(theFile != NULL);
+    if(theFile != NULL)
+    {
+        fputs("not a model", theFile);
+        fclose(theFile);
+    }
+    CHECK_EQUAL(ONNXCreateSessionWithCache(gTest_Env, theModel, 1, 3, theCache, &theSession), ONNX_STATUS_OK);
+    CHECK(test_run_error(theSession, 2) < 1.0e-4);
+    ONNXReleaseSession(theSession);
+    CHECK_EQUAL(test_remove_directory(theCache), 1);
+
+    //	and a cache that can't be written to is no cache at all
+    CHECK_EQUAL(ONNXCreateSessionWithCache(gTest_Env, theModel, 1, 3, "/dev/null/cache", &theSession), ONNX_STATUS_OK);
+    CHECK(test_run_error(theSession, 2) < 1.0e-4);
+    ONNXReleaseSession(theSession);
+
+    CHECK_EQUAL(ONNXCreateSessionWithCache(gTest_Env, theModel, 1, 4, theCache, &theSession), ONNX_STATUS_INVALID_ARGUMENT);
+}
+
+typedef struct TestWaiter
+{
+    ONNXSessionPool*    pool;
+    ONNXSession*        session;
+    atomic_int          acquired;
+} TestWaiter;
+
+static void* test_wait_for_session(void* inWaiter)
+{
+    TestWaiter* theWaiter = (TestWaiter*)inWaiter;
+    ONNXSessionPoolAcquire(theWaiter->pool, 2, &theWaiter->session);
+    atomic_store(&theWaiter->acquired, 1);
+    return NULL;
+}
+
+static void test_session_pool(void)
+{
+    char theCache[64];
+    snprintf(theCache, sizeof(theCache), "%s/cache", gTest_Directory);
+    const char* theModels[kTest_ModelCount];
+    for(int m = 0; m < kTest_ModelCount; m++)
+    {
+        theModels[m] = test_write_model(m);
+    }
+
+    ONNXSessionPool* thePool = NULL;
+    double theStart = test_now_seconds();
+    CHECK_EQUAL(ONNXCreateSessionPool(theModels, kTest_ModelCount, 2, 1, theCache, &thePool), ONNX_STATUS_OK);
+    printf("    %.2f ms to open and warm up two sessions each of three models\n", (test_now_seconds() - theStart) * 1.0e3);
+    if(thePool == NULL)
+    {
+        return;
+    }
+
+    CHECK_EQUAL(ONNXSessionPoolAcquire(thePool, kTest_ModelCount, &(ONNXSession*){ NULL }), ONNX_STATUS_INVALID_ARGUMENT);
+    for(int m = 0; m < kTest_ModelCount; m++)
+    {
+        ONNXSession* theSession = NULL;
+        CHECK_EQUAL(ONNXSessionPoolAcquire(thePool, (size_t)m, &theSession), ONNX_STATUS_OK);
+        CHECK(test_run_error(theSession, m) < 1.0e-4);
+        ONNXSessionPoolRelease(thePool, theSession);
+    }
+
+    //	with both sessions of a model out, the next caller waits for one to come back
+    ONNXSession* theFirst = NULL;
+    ONNXSession* theSecond = NULL;
+    CHECK_EQUAL(ONNXSessionPoolAcquire(thePool, 2, &theFirst), ONNX_STATUS_OK);
+    CHECK_EQUAL(ONNXSessionPoolAcquire(thePool, 2, &theSecond), ONNX_STATUS_OK);
+    CHECK(theFirst != theSecond);
+
+    TestWaiter theWaiter = { thePool, NULL, 0 };
+    pthread_t theThread;
+    pthread_create(&theThread, NULL, test_wait_for_session, &theWaiter);
+    usleep(50000);
+    CHECK_EQUAL(atomic_load(&theWaiter.acquired), 0);
+    ONNXSessionPoolRelease(thePool, theSecond);
+    pthread_join(theThread, NULL);
+    CHECK_EQUAL(atomic_load(&theWaiter.acquired), 1);
+    CHECK(theWaiter.session == theSecond);
+
+    ONNXSessionPoolRelease(thePool, theFirst);
+    ONNXSessionPoolRelease(thePool, theWaiter.session);
+    ONNXReleaseSessionPool(thePool);
+
+    //	one optimized copy a model, shared by its sessions
+    CHECK_EQUAL(test_remove_directory(theCache), kTest_ModelCount);
+
+    //	a model that won't open fails the whole pool
+    char theMissing[64];
+    snprintf(theMissing, sizeof(theMissing), "%s/missing.onnx", gTest_Directory);
+    theModels[1] = theMissing;
+    thePool = NULL;
+    CHECK(ONNXCreateSessionPool(theModels, kTest_ModelCount, 1, 1, NULL, &thePool) != ONNX_STATUS_OK);
+    CHECK(thePool == NULL);
+}
+
+//	An encoder feeding two decoders the way DeepFilterNet's do, through a tensor named "e"
+typedef struct TestPipeline
+{
+    ONNXSession*    sessions[kTest_ModelCount];
+    float           input[kTest_InputSize];
+    float           hidden[kTest_InputSize];    //	what the encoder should pass on
+    float           outputs[kTest_ModelCount][960];
+    ONNXValue*      values[kTest_ModelCount];
+} TestPipeline;
+
+static void test_open_pipeline_models(TestPipeline* outModels)
+{
+    static const char* const kOutputNames[kTest_ModelCount] = { "e", "m", "coefs" };
+    memset(outModels, 0, sizeof(*outModels));
+    for(int m = 0; m < kTest_ModelCount; m++)
+    {
+        outModels->sessions[m] = test_open_path(test_write_named_model(m, m == 0 ? "x" : "e", kOutputNames[m]));
+    }
+
+    int64_t theShape[2] = { 1, kTest_InputSize };
+    CHECK_EQUAL(ONNXCreateTensorFloatWithData(outModels->input, kTest_InputSize, theShape, 2, &outModels->values[0]), ONNX_STATUS_OK);
+    for(int m = 1; m < kTest_ModelCount; m++)
+    {
+        int64_t theOutputShape[2] = { 1, kTest_OutputSizes[m] };
+        CHECK_EQUAL(ONNXCreateTensorFloatWithData(outModels->outputs[m], (size_t)kTest_OutputSizes[m], theOutputShape, 2, &outModels->values[m]), ONNX_STATUS_OK);
+    }
+}
+
+static void test_close_pipeline_models(TestPipeline* inModels)
+{
+    for(int m = 0; m < kTest_ModelCount; m++)
+    {
+        ONNXReleaseValue(inModels->values[m]);
+        ONNXReleaseSession(inModels->sessions[m]);
+    }
+}
+
+//	the next frame's input, and what the encoder makes of it
+static void test_pipeline_frame(TestPipeline* ioModels, int inFrame)
+{
+    test_fill_input(ioModels->input, inFrame);
+    for(int64_t c = 0; c < kTest_InputSize; c++)
+    {
+        double theSum = test_bias(0, c);
+        for(int64_t r = 0; r < kTest_InputSize; r++)
+        {
+            theSum += (double)ioModels->input[r] * test_weight(0, r, c);
+        }
+        ioModels->hidden[c] = (float)tanh(theSum);
+    }
+}
+
+static double test_pipeline_error(const TestPipeline* inModels)
+{
+    return fmax(test_output_error(1, inModels->hidden, inModels->outputs[1]), test_output_error(2, inModels->hidden, inModels->outputs[2]));
+}
+
+static void test_pipeline(void)
+{
+    TestPipeline theModels;
+    test_open_pipeline_models(&theModels);
+
+    ONNXPipeline* thePipeline = NULL;
+    CHECK_EQUAL(ONNXCreatePipeline(theModels.sessions[0], &theModels.sessions[1], 2, 1, &thePipeline), ONNX_STATUS_OK);
+    if(thePipeline == NULL)
+    {
+        test_close_pipeline_models(&theModels);
+        return;
+    }
+    CHECK_EQUAL(ONNXPipelineBindInput(thePipeline, 0, "x", theModels.values[0]), ONNX_STATUS_OK);
+    CHECK_EQUAL(ONNXPipelineBindOutput(thePipeline, 1, "m", theModels.values[1]), ONNX_STATUS_OK);
+    CHECK_EQUAL(ONNXPipelineBindOutput(thePipeline, 2, "coefs", theModels.values[2]), ONNX_STATUS_OK);
+    CHECK_EQUAL(ONNXPipelineBindInput(thePipeline, 3, "x", theModels.values[0]), ONNX_STATUS_INVALID_ARGUMENT);
+
+    //	"e" goes from the encoder to both decoders without the caller ever seeing it
+    for(int theFrame = 0; theFrame < 3; theFrame++)
+    {
+        test_pipeline_frame(&theModels, theFrame);
+        CHECK_EQUAL(ONNXPipelineRun(thePipeline), ONNX_STATUS_OK);
+        CHECK(test_pipeline_error(&theModels) < 1.0e-4);
+    }
+    ONNXReleasePipeline(thePipeline);
+
+    //	a decoder with an input nobody bound fails the run, with its own error
+    ONNXSession* theStranger = test_open_model(1);
+    ONNXSession* theDecoders[2] = { theModels.sessions[1], theStranger };
+    CHECK_EQUAL(ONNXCreatePipeline(theModels.sessions[0], theDecoders, 2, 1, &thePipeline), ONNX_STATUS_OK);
+    if(thePipeline != NULL)
+    {
+        CHECK_EQUAL(ONNXPipelineBindInput(thePipeline, 0, "x", theModels.values[0]), ONNX_STATUS_OK);
+        CHECK_EQUAL(ONNXPipelineBindOutput(thePipeline, 1, "m", theModels.values[1]), ONNX_STATUS_OK);
+        CHECK(ONNXPipelineRun(thePipeline) != ONNX_STATUS_OK);
+        CHECK(strlen(ONNXGetLastErrorMessage()) > 0);
+        ONNXReleasePipeline(thePipeline);
+    }
+    ONNXReleaseSession(theStranger);
+
+    CHECK_EQUAL(ONNXCreatePipeline(theModels.sessions[0], &theModels.sessions[1], 0, 1, &thePipeline), ONNX_STATUS_INVALID_ARGUMENT);
+    test_close_pipeline_models(&theModels);
+}
+
+//	A frame through the encoder and both decoders the way DeepFilterNet runs them today, each model
+//	on its own with the encoder's output copied out and back in, against the pipeline.
+static void test_pipeline_cost(void)
+{
+    TestPipeline theModels;
+    test_open_pipeline_models(&theModels);
+    ONNXPipeline* thePipeline = NULL;
+    CHECK_EQUAL(ONNXCreatePipeline(theModels.sessions[0], &theModels.sessions[1], 2, 1, &thePipeline), ONNX_STATUS_OK);
+    if(thePipeline == NULL)
+    {
+        test_close_pipeline_models(&theModels);
+        return;
+    }
+    ONNXPipelineBindInput(thePipeline, 0, "x", theModels.values[0]);
+    ONNXPipelineBindOutput(thePipeline, 1, "m", theModels.values[1]);
+    ONNXPipelineBindOutput(thePipeline, 2, "coefs", theModels.values[2]);
+
+    static const char* const kOutputNames[kTest_ModelCount] = { "e", "m", "coefs" };
+    int64_t theShape[2] = { 1, kTest_InputSize };
+    float theHidden[kTest_InputSize];
+    double theNanoseconds[2];
+    double theAllocations[2];
+    for(int thePath = 0; thePath < 2; thePath++)
+    {
+        for(int theFrame = -kTest_Frames / 10; theFrame < kTest_Frames; theFrame++)
+        {
+            if(theFrame == 0)
+            {
+                theAllocations[thePath] = (double)test_allocations();
+                theNanoseconds[thePath] = test_now_seconds();
+            }
+            test_fill_input(theModels.input, theFrame);
+            if(thePath == 1)
+            {
+                ONNXPipelineRun(thePipeline);
+                continue;
+            }
+            for(int m = 0; m < kTest_ModelCount; m++)
+            {
+                ONNXValue* theValue = NULL;
+                ONNXCreateTensorFloat(m == 0 ? theModels.input : theHidden, kTest_InputSize, theShape, 2, &theValue);
+                const char* theInputNames[1] = { m == 0 ? "x" : "e" };
+                const char* theOutputNames[1] = { kOutputNames[m] };
+                const ONNXValue* theInputs[1] = { theValue };
+                ONNXValue* theResults[1] = { NULL };
+                ONNXSessionRun(theModels.sessions[m], theInputNames, theInputs, 1, theOutputNames, 1, theResults);
+                ONNXGetTensorFloatData(theResults[0], m == 0 ? theHidden : theModels.outputs[m], (size_t)kTest_OutputSizes[m]);
+                ONNXReleaseValue(theResults[0]);
+                ONNXReleaseValue(theValue);
+            }
+        }
+        theNanoseconds[thePath] = (test_now_seconds() - theNanoseconds[thePath]) * 1.0e9 / kTest_Frames;
+        theAllocations[thePath] = ((double)test_allocations() - theAllocations[thePath]) / kTest_Frames;
+        test_pipeline_frame(&theModels, kTest_Frames - 1);
+        CHECK(test_pipeline_error(&theModels) < 1.0e-4);
+    }
+
+    printf("    %.1f ns per frame of the encoder and two decoders run one by one\n", theNanoseconds[0]);
+    printf("    %.1f ns per frame of the encoder and two decoders as a pipeline\n", theNanoseconds[1]);
+    if(kTest_CountsAllocations)
+    {
+        printf("    %.1f allocations per frame one by one, %.1f as a pipeline\n", theAllocations[0], theAllocations[1]);
+        CHECK(theAllocations[1] < theAllocations[0]);
+    }
+
+    ONNXReleasePipeline(thePipeline);
+    test_close_pipeline_models(&theModels);
+}
+
+//	A frame of the three models the way ONNXRuntimeWrapper.swift runs them today, copying each
+//	input in and each output out, against tensors and bindings set up once.
+static void test_cost(void)
+{
+    ONNXSession* theSessions[kTest_ModelCount];
+    float theInput[kTest_InputSize];
+    float theOutputs[kTest_ModelCount][960];
+    ONNXValue* theInputValue = NULL;
+    ONNXValue* theOutputValues[kTest_ModelCount];
+    ONNXIOBinding* theBindings[kTest_ModelCount];
+
+    int64_t theInputShape[2] = { 1, kTest_InputSize };
+    CHECK_EQUAL(ONNXCreateTensorFloatWithData(theInput, kTest_InputSize, theInputShape, 2, &theInputValue), ONNX_STATUS_OK);
+    for(int m = 0; m < kTest_ModelCount; m++)
+    {
+        theSessions[m] = test_open_model(m);
+        int64_t theOutputShape[2] = { 1, kTest_OutputSizes[m] };
+        CHECK_EQUAL(ONNXCreateTensorFloatWithData(theOutputs[m], (size_t)kTest_OutputSizes[m], theOutputShape, 2, &theOutputValues[m]), ONNX_STATUS_OK);
+        CHECK_EQUAL(ONNXCreateIOBinding(theSessions[m], &theBindings[m]), ONNX_STATUS_OK);
+        CHECK_EQUAL(ONNXIOBindingBindInput(theBindings[m], "x", theInputValue), ONNX_STATUS_OK);
+        CHECK_EQUAL(ONNXIOBindingBindOutput(theBindings[m], "y", theOutputValues[m]), ONNX_STATUS_OK);
+    }
+
+    const char* theInputNames[1] = { "x" };
+    const char* theOutputNames[1] = { "y" };
+    double theNanoseconds[2];
+    double theAllocations[2];
+    for(int thePath = 0; thePath < 2; thePath++)
+    {
+        //	warm up first, the first runs of a session allocate what the rest reuse
+        for(int theFrame = -kTest_Frames / 10; theFrame < kTest_Frames; theFrame++)
+        {
+            if(theFrame == 0)
+            {
+                theAllocations[thePath] = (double)test_allocations();
+                theNanoseconds[thePath] = test_now_seconds();
+            }
+            test_fill_input(theInput, theFrame);
+            for(int m = 0; m < kTest_ModelCount; m++)
+            {
+                if(thePath == 0)
+                {
+                    ONNXValue* theValue = NULL;
+                    ONNXCreateTensorFloat(theInput, kTest_InputSize, theInputShape, 2, &theValue);
+                    const ONNXValue* theInputs[1] = { theValue };
+                    ONNXValue* theResults[1] = { NULL };
+                    ONNXSessionRun(theSessions[m], theInputNames, theInputs, 1, theOutputNames, 1, theResults);
+                    ONNXGetTensorFloatData(theResults[0], theOutputs[m], (size_t)kTest_OutputSizes[m]);
+                    ONNXReleaseValue(theResults[0]);
+                    ONNXReleaseValue(theValue);
+                }
+                else
+                {
+                    ONNXSessionRunWithBinding(theSessions[m], theBindings[m]);
+                }
+            }
+        }
+        theNanoseconds[thePath] = (test_now_seconds() - theNanoseconds[thePath]) * 1.0e9 / kTest_Frames;
+        theAllocations[thePath] = ((double)test_allocations() - theAllocations[thePath]) / kTest_Frames;
+        for(int m = 0; m < kTest_ModelCount; m++)
+        {
+            CHECK(test_output_error(m, theInput, theOutputs[m]) < 1.0e-4);
+        }
+    }
+
+    printf("    %.1f ns per frame of three models copying tensors in and out\n", theNanoseconds[0]);
+    printf("    %.1f ns per frame of three models with caller-owned tensors and IO bindings\n", theNanoseconds[1]);
+    if(kTest_CountsAllocations)
+    {
+        printf("    %.1f allocations per frame copying, %.1f bound\n", theAllocations[0], theAllocations[1]);
+
+        //	each copying run allocates at least its input and output values
+        CHECK(theAllocations[0] >= 2.0 * kTest_ModelCount);
+        CHECK(theAllocations[1] < theAllocations[0]);
+    }
+
+    for(int m = 0; m < kTest_ModelCount; m++)
+    {
+        ONNXReleaseIOBinding(theBindings[m]);
+        ONNXReleaseValue(theOutputValues[m]);
+        ONNXReleaseSession(theSessions[m]);
+    }
+    ONNXReleaseValue(theInputValue);
+}
+
+int main(void)
+{
+    if(mkdtemp(gTest_Directory) == NULL)
+    {
+        fprintf(stderr, "Could not make a directory for the test models\n");
+        return EXIT_FAILURE;
+    }
+    if(ONNXCreateEnv(3, "ONNXRuntimeBridgeTests", &gTest_Env) != ONNX_STATUS_OK)
+    {
+        fprintf(stderr, "Could not create an ONNX Runtime environment: %s\n", ONNXGetLastErrorMessage());
+        return EXIT_FAILURE;
+    }
+
+    RUN_TEST(test_session_names);
+    RUN_TEST(test_copying_run);
+    RUN_TEST(test_caller_owned_tensors);
+    RUN_TEST(test_io_binding);
+    RUN_TEST(test_errors);
+    RUN_TEST(test_shared_env);
+    RUN_TEST(test_optimized_model_cache);
+    RUN_TEST(test_session_pool);
+    RUN_TEST(test_pipeline);
+    RUN_TEST(test_cost);
+    RUN_TEST(test_pipeline_cost);
+
+    ONNXReleaseEnv(gTest_Env);
+    test_remove_directory(gTest_Directory);
+    return TEST_RESULT();
+}
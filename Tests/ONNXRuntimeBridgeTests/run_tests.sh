@@ -0,0 +1,39 @@
+#!/bin/bash
+
+# Host-side tests and benchmark for the ONNX Runtime bridge.
+# They build ONNXRuntimeBridge.c against an ONNX Runtime release, include/ and lib/ as unpacked
+# from the release archive, in Frameworks/onnxruntime or wherever ORT_ROOT points. Without one
+# they are skipped. The header must come from the same release as the library: the bridge reaches
+# the runtime through the OrtApi table, whose layout only the release's own header describes.
+
+set -e
+
+SCRIPT_DIR="$(cd "$(dirname "$0")" && pwd)"
+PROJECT_DIR="$(cd "$SCRIPT_DIR/../.." && pwd)"
+BRIDGE_DIR="$PROJECT_DIR/Sources/Vocana/ML"
+SUPPORT_DIR="$PROJECT_DIR/Tests/VocanaAudioDriverTests"
+BUILD_DIR="$PROJECT_DIR/.build/onnx-bridge-tests"
+ORT_ROOT="${ORT_ROOT:-$PROJECT_DIR/Frameworks/onnxruntime}"
+CC="${CC:-cc}"
+CFLAGS="${CFLAGS:--std=gnu11 -O2 -g -Wall -Wextra -Wno-unused-parameter}"
+
+if [ ! -f "$ORT_ROOT/include/onnxruntime_c_api.h" ]; then
+    echo "⚠️  ONNX Runtime not found in $ORT_ROOT, skipping the bridge tests"
+    exit 0
+fi
+
+mkdir -p "$BUILD_DIR"
+
+echo "=== Building ONNXRuntimeBridgeTests ==="
+$CC $CFLAGS -I "$BRIDGE_DIR" -I "$SUPPORT_DIR" -I "$ORT_ROOT/include" \
+    -o "$BUILD_DIR/ONNXRuntimeBridgeTests" \
+    "$SCRIPT_DIR/ONNXRuntimeBridgeTests.c" "$BRIDGE_DIR/ONNXRuntimeBridge.c" \
+    -L "$ORT_ROOT/lib" -Wl,-rpath,"$ORT_ROOT/lib" -lonnxruntime -lpthread -lm
+
+echo "=== Running ONNXRuntimeBridgeTests ==="
+if ! "$BUILD_DIR/ONNXRuntimeBridgeTests"; then
+    echo "❌ ONNX Runtime bridge tests failed"
+    exit 1
+fi
+
+echo "✅ All ONNX Runtime bridge tests passed"
@@ -0,0 +1,484 @@
+/*
+     File: VocanaHALShim.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Implementations behind the platform shims under HALSimulator/include: just enough
+ CoreFoundation, libdispatch, mach time and vDSP for VocanaVirtualDevice.c to run on any POSIX
+ host. None of this is real-time safe and none of it needs to be; the driver only calls it from
+ its control paths.
+
+ */
+
+#include "VocanaHALShim.h"
+
+#include <Accelerate/Accelerate.h>
+#include <CoreFoundation/CoreFoundation.h>
+#include <dispatch/dispatch.h>
+#include <mach/mach_time.h>
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//==================================================================================================
+#pragma mark -
+#pragma mark CoreFoundation
+//==================================================================================================
+
+//	Every shim object starts with its type ID, which is all CFGetTypeID and CFEqual need.
+enum
+{
+    kShimTypeID_String      = 1,
+    kShimTypeID_Boolean     = 2,
+    kShimTypeID_Number      = 3,
+    kShimTypeID_UUID        = 4,
+    kShimTypeID_Data        = 5
+};
+
+struct __CFString
+{
+    CFTypeID    typeID;
+    char*       cString;
+};
+
+struct __CFBoolean
+{
+    CFTypeID    typeID;
+    Boolean     value;
+};
+
+struct __CFUUID
+{
+    CFTypeID    typeID;
+    CFUUIDBytes bytes;
+};
+
+struct __CFNumber
+{
+    CFTypeID    typeID;
+    Float64     value;
+};
+
+struct __CFData
+{
+    CFTypeID    typeID;
+    CFIndex     length;
+    UInt8*      bytes;
+};
+
+static const struct __CFBoolean gShim_True  = { kShimTypeID_Boolean, true };
+static const struct __CFBoolean gShim_False = { kShimTypeID_Boolean, false };
+const CFBooleanRef              kCFBooleanTrue  = &gShim_True;
+const CFBooleanRef              kCFBooleanFalse = &gShim_False;
+
+static CFStringRef shim_make_string(const char* inCString)
+{
+    struct __CFString* theString = calloc(1, sizeof(struct __CFString));
+    theString->typeID = kShimTypeID_String;
+    theString->cString = strdup(inCString);
+    return theString;
+}
+
+CFStringRef VocanaHALShim_MakeConstantString(const char* inCString)
+{
+    //	CFSTR() is used with a handful of literals, so a linear intern table is plenty
+    static pthread_mutex_t  sMutex = PTHREAD_MUTEX_INITIALIZER;
+    static CFStringRef      sStrings[256];
+    static uint32_t         sCount = 0;
+
+    pthread_mutex_lock(&sMutex);
+    CFStringRef theAnswer = NULL;
+    for(uint32_t i = 0; i < sCount && theAnswer == NULL; i++)
+    {
+        if(strcmp(sStrings[i]->cString, inCString) == 0)
+        {
+            theAnswer = sStrings[i];
+        }
+    }
+    if(theAnswer == NULL)
+    {
+        theAnswer = shim_make_string(inCString);
+        if(sCount < sizeof(sStrings) / sizeof(sStrings[0]))
+        {
+            sStrings[sCount++] = theAnswer;
+        }
+    }
+    pthread_mutex_unlock(&sMutex);
+    return theAnswer;
+}
+
+const char* VocanaHALShim_GetCString(CFStringRef inString)
+{
+    return inString != NULL ? inString->cString : NULL;
+}
+
+CFTypeRef CFRetain(CFTypeRef inObject)
+{
+    return inObject;
+}
+
+void CFRelease(CFTypeRef inObject)
+{
+    (void)inObject;
+}
+
+CFTypeID CFGetTypeID(CFTypeRef inObject)
+{
+    return *(const CFTypeID*)inObject;
+}
+
+Boolean CFEqual(CFTypeRef inObject1, CFTypeRef inObject2)
+{
+    if(inObject1 == inObject2)
+    {
+        return true;
+    }
+    if(inObject1 == NULL || inObject2 == NULL || CFGetTypeID(inObject1) != CFGetTypeID(inObject2))
+    {
+        return false;
+    }
+    switch(CFGetTypeID(inObject1))
+    {
+        case kShimTypeID_String:
+            return CFStringCompare(inObject1, inObject2, 0) == kCFCompareEqualTo;
+        case kShimTypeID_Boolean:
+            return ((CFBooleanRef)inObject1)->value == ((CFBooleanRef)inObject2)->value;
+        case kShimTypeID_UUID:
+            return memcmp(&((CFUUIDRef)inObject1)->bytes, &((CFUUIDRef)inObject2)->bytes, sizeof(CFUUIDBytes)) == 0;
+        default:
+            return false;
+    }
+}
+
+CFTypeID CFStringGetTypeID(void)    { return kShimTypeID_String; }
+CFTypeID CFBooleanGetTypeID(void)   { return kShimTypeID_Boolean; }
+CFTypeID CFNumberGetTypeID(void)    { return kShimTypeID_Number; }
+CFTypeID CFDataGetTypeID(void)      { return kShimTypeID_Data; }
+
+CFStringRef CFStringCreateWithCString(CFAllocatorRef inAllocator, const char* inCString, CFStringEncoding inEncoding)
+{
+    (void)inAllocator;
+    (void)inEncoding;
+    return shim_make_string(inCString);
+}
+
+CFStringRef CFStringCreateWithFormat(CFAllocatorRef inAllocator, CFDictionaryRef inFormatOptions, CFStringRef inFormat, ...)
+{
+    (void)inAllocator;
+    (void)inFormatOptions;
+
+    char theBuffer[1024];
+    va_list theArguments;
+    va_start(theArguments, inFormat);
+    vsnprintf(theBuffer, sizeof(theBuffer), inFormat->cString, theArguments);
+    va_end(theArguments);
+    return shim_make_string(theBuffer);
+}
+
+CFComparisonResult CFStringCompare(CFStringRef inString1, CFStringRef inString2, CFOptionFlags inOptions)
+{
+    (void)inOptions;
+    int theResult = strcmp(inString1->cString, inString2->cString);
+    return theResult < 0 ? kCFCompareLessThan : (theResult > 0 ? kCFCompareGreaterThan : kCFCompareEqualTo);
+}
+
+Boolean CFBooleanGetValue(CFBooleanRef inBoolean)
+{
+    return inBoolean->value;
+}
+
+CFNumberRef CFNumberCreate(CFAllocatorRef inAllocator, CFNumberType inType, const void* inValue)
+{
+    (void)inAllocator;
+    struct __CFNumber* theNumber = calloc(1, sizeof(struct __CFNumber));
+    theNumber->typeID = kShimTypeID_Number;
+    switch(inType)
+    {
+        case kCFNumberSInt32Type:
+            theNumber->value = *(const SInt32*)inValue;
+            break;
+        case kCFNumberSInt64Type:
+            theNumber->value = (Float64)*(const SInt64*)inValue;
+            break;
+        case kCFNumberFloat64Type:
+            theNumber->value = *(const Float64*)inValue;
+            break;
+    }
+    return theNumber;
+}
+
+Boolean CFNumberGetValue(CFNumberRef inNumber, CFNumberType inType, void* outValue)
+{
+    //	like CoreFoundation, answers false when the value doesn't fit the type exactly
+    Float64 theValue = inNumber->value;
+    switch(inType)
+    {
+        case kCFNumberSInt32Type:
+            *(SInt32*)outValue = (SInt32)theValue;
+            return theValue == (Float64)*(SInt32*)outValue;
+        case kCFNumberSInt64Type:
+            *(SInt64*)outValue = (SInt64)theValue;
+            return theValue == (Float64)*(SInt64*)outValue;
+        case kCFNumberFloat64Type:
+            *(Float64*)outValue = theValue;
+            return true;
+    }
+    return false;
+}
+
+CFDataRef CFDataCreate(CFAllocatorRef inAllocator, const UInt8* inBytes, CFIndex inLength)
+{
+    (void)inAllocator;
+    struct __CFData* theData = calloc(1, sizeof(struct __CFData));
+    theData->typeID = kShimTypeID_Data;
+    theData->length = inLength;
+    theData->bytes = calloc(1, inLength > 0 ? (size_t)inLength : 1);
+    if(inLength > 0)
+    {
+        memcpy(theData->bytes, inBytes, (size_t)inLength);
+    }
+    return theData;
+}
+
+CFIndex CFDataGetLength(CFDataRef inData)
+{
+    return inData->length;
+}
+
+const UInt8* CFDataGetBytePtr(CFDataRef inData)
+{
+    return inData->bytes;
+}
+
+CFUUIDRef CFUUIDCreateFromUUIDBytes(CFAllocatorRef inAllocator, CFUUIDBytes inBytes)
+{
+    (void)inAllocator;
+    struct __CFUUID* theUUID = calloc(1, sizeof(struct __CFUUID));
+    theUUID->typeID = kShimTypeID_UUID;
+    theUUID->bytes = inBytes;
+    return theUUID;
+}
+
+CFUUIDRef CFUUIDGetConstantUUIDWithBytes(CFAllocatorRef inAllocator, UInt8 inByte0, UInt8 inByte1, UInt8 inByte2, UInt8 inByte3, UInt8 inByte4, UInt8 inByte5, UInt8 inByte6, UInt8 inByte7, UInt8 inByte8, UInt8 inByte9, UInt8 inByte10, UInt8 inByte11, UInt8 inByte12, UInt8 inByte13, UInt8 inByte14, UInt8 inByte15)
+{
+    CFUUIDBytes theBytes = { inByte0, inByte1, inByte2, inByte3, inByte4, inByte5, inByte6, inByte7, inByte8, inByte9, inByte10, inByte11, inByte12, inByte13, inByte14, inByte15 };
+    return CFUUIDCreateFromUUIDBytes(inAllocator, theBytes);
+}
+
+CFBundleRef CFBundleGetBundleWithIdentifier(CFStringRef inBundleID)
+{
+    (void)inBundleID;
+    return NULL;
+}
+
+CFURLRef CFBundleCopyResourceURL(CFBundleRef inBundle, CFStringRef inResourceName, CFStringRef inResourceType, CFStringRef inSubDirName)
+{
+    (void)inBundle;
+    (void)inResourceName;
+    (void)inResourceType;
+    (void)inSubDirName;
+    return NULL;
+}
+
+CFTypeRef CFBundleGetValueForInfoDictionaryKey(CFBundleRef inBundle, CFStringRef inKey)
+{
+    (void)inBundle;
+    (void)inKey;
+    return NULL;
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark mach time
+//==================================================================================================
+
+static _Atomic uint64_t gShim_HostTime = 0;
+
+void VocanaHALShim_SetHostTime(uint64_t inHostTime)
+{
+    atomic_store(&gShim_HostTime, inHostTime);
+}
+
+uint64_t VocanaHALShim_GetHostTime(void)
+{
+    return atomic_load(&gShim_HostTime);
+}
+
+int mach_timebase_info(mach_timebase_info_t outInfo)
+{
+    outInfo->numer = 1;
+    outInfo->denom = 1;
+    return 0;
+}
+
+uint64_t mach_absolute_time(void)
+{
+    return atomic_load(&gShim_HostTime);
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark dispatch
+//==================================================================================================
+
+struct VocanaHALShim_DispatchQueue
+{
+    int unused;
+};
+
+struct VocanaHALShim_SourceType
+{
+    int unused;
+};
+
+struct VocanaHALShim_DispatchSource
+{
+    dispatch_source_type_t  type;
+    dispatch_function_t     handler;
+    bool                    isResumed;
+};
+
+typedef struct ShimWorkItem
+{
+    void*               context;
+    dispatch_function_t work;
+} ShimWorkItem;
+
+#define kShim_MaxWorkItems      256
+#define kShim_MaxSources        16
+
+const struct VocanaHALShim_SourceType   VocanaHALShim_SourceTypeMemoryPressure;
+
+static struct VocanaHALShim_DispatchQueue   gShim_GlobalQueue;
+static pthread_mutex_t                      gShim_DispatchMutex = PTHREAD_MUTEX_INITIALIZER;
+static ShimWorkItem                         gShim_WorkItems[kShim_MaxWorkItems];
+static uint32_t                             gShim_WorkItemCount = 0;
+static struct VocanaHALShim_DispatchSource  gShim_Sources[kShim_MaxSources];
+static uint32_t                             gShim_SourceCount = 0;
+
+dispatch_queue_t dispatch_get_global_queue(long inIdentifier, unsigned long inFlags)
+{
+    (void)inIdentifier;
+    (void)inFlags;
+    return &gShim_GlobalQueue;
+}
+
+dispatch_time_t dispatch_time(dispatch_time_t inWhen, int64_t inDelta)
+{
+    return inWhen + (dispatch_time_t)inDelta;
+}
+
+void dispatch_async_f(dispatch_queue_t inQueue, void* inContext, dispatch_function_t inWork)
+{
+    (void)inQueue;
+    pthread_mutex_lock(&gShim_DispatchMutex);
+    if(gShim_WorkItemCount < kShim_MaxWorkItems)
+    {
+        gShim_WorkItems[gShim_WorkItemCount].context = inContext;
+        gShim_WorkItems[gShim_WorkItemCount].work = inWork;
+        ++gShim_WorkItemCount;
+    }
+    else
+    {
+        fprintf(stderr, "VocanaHALShim: dispatch queue overflow, dropping work\n");
+    }
+    pthread_mutex_unlock(&gShim_DispatchMutex);
+}
+
+void dispatch_after_f(dispatch_time_t inWhen, dispatch_queue_t inQueue, void* inContext, dispatch_function_t inWork)
+{
+    //	delays don't mean anything on the simulated clock; the work runs at the next drain
+    (void)inWhen;
+    dispatch_async_f(inQueue, inContext, inWork);
+}
+
+uint32_t VocanaHALShim_DrainDispatchQueue(void)
+{
+    uint32_t theCount = 0;
+    for(;;)
+    {
+        pthread_mutex_lock(&gShim_DispatchMutex);
+        if(gShim_WorkItemCount == 0)
+        {
+            pthread_mutex_unlock(&gShim_DispatchMutex);
+            break;
+        }
+        ShimWorkItem theItem = gShim_WorkItems[0];
+        memmove(&gShim_WorkItems[0], &gShim_WorkItems[1], (gShim_WorkItemCount - 1) * sizeof(ShimWorkItem));
+        --gShim_WorkItemCount;
+        pthread_mutex_unlock(&gShim_DispatchMutex);
+
+        theItem.work(theItem.context);
+        ++theCount;
+    }
+    return theCount;
+}
+
+dispatch_source_t dispatch_source_create(dispatch_source_type_t inType, uintptr_t inHandle, unsigned long inMask, dispatch_queue_t inQueue)
+{
+    (void)inHandle;
+    (void)inMask;
+    (void)inQueue;
+    dispatch_source_t theSource = NULL;
+    pthread_mutex_lock(&gShim_DispatchMutex);
+    if(gShim_SourceCount < kShim_MaxSources)
+    {
+        theSource = &gShim_Sources[gShim_SourceCount++];
+        theSource->type = inType;
+        theSource->handler = NULL;
+        theSource->isResumed = false;
+    }
+    pthread_mutex_unlock(&gShim_DispatchMutex);
+    return theSource;
+}
+
+void dispatch_source_set_event_handler_f(dispatch_source_t inSource, dispatch_function_t inHandler)
+{
+    inSource->handler = inHandler;
+}
+
+void dispatch_resume(dispatch_source_t inSource)
+{
+    inSource->isResumed = true;
+}
+
+uint32_t VocanaHALShim_SignalMemoryPressure(void)
+{
+    uint32_t theCount = 0;
+    for(uint32_t i = 0; i < gShim_SourceCount; i++)
+    {
+        dispatch_source_t theSource = &gShim_Sources[i];
+        if(theSource->type == DISPATCH_SOURCE_TYPE_MEMORYPRESSURE && theSource->isResumed && theSource->handler != NULL)
+        {
+            theSource->handler(NULL);
+            ++theCount;
+        }
+    }
+    return theCount;
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark vDSP
+//==================================================================================================
+
+void vDSP_vclr(float* outC, vDSP_Stride inStrideC, vDSP_Length inCount)
+{
+    for(vDSP_Length i = 0; i < inCount; i++)
+    {
+        outC[(long)i * inStrideC] = 0.0f;
+    }
+}
+
+void vDSP_vsmul(const float* inA, vDSP_Stride inStrideA, const float* inB, float* outC, vDSP_Stride inStrideC, vDSP_Length inCount)
+{
+    float theScalar = *inB;
+    for(vDSP_Length i = 0; i < inCount; i++)
+    {
+        outC[(long)i * inStrideC] = inA[(long)i * inStrideA] * theScalar;
+    }
+}
@@ -0,0 +1,36 @@
+/*
+     File: VocanaHALShim.h
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Controls for the platform shims under HALSimulator/include. The simulator owns the host clock
+ and decides when deferred dispatch work runs, so a run is fully deterministic.
+
+ */
+
+#ifndef VocanaHALShim_h
+#define VocanaHALShim_h
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//	The simulated mach_absolute_time(). The timebase is 1/1, so host ticks are nanoseconds.
+void        VocanaHALShim_SetHostTime(uint64_t inHostTime);
+uint64_t    VocanaHALShim_GetHostTime(void);
+
+//	Runs everything queued with dispatch_async_f/dispatch_after_f, including work queued by the
+//	work itself. Returns the number of work items run.
+uint32_t    VocanaHALShim_DrainDispatchQueue(void);
+
+//	Fires the event handler of every resumed memory pressure source. Returns the number fired.
+uint32_t    VocanaHALShim_SignalMemoryPressure(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VocanaHALShim_h */
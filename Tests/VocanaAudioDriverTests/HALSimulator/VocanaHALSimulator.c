@@ -0,0 +1,874 @@
+/*
+     File: VocanaHALSimulator.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ A host-independent stand-in for coreaudiod that loads VocanaVirtualDevice through its
+ AudioServerPlugInDriverInterface and drives it with synthetic IO cycles.
+
+ */
+
+#include "VocanaHALSimulator.h"
+#include "VocanaHALShim.h"
+#include "VocanaClock.h"
+#include "VocanaChannels.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//	the driver's CFPlugIn factory
+extern void* VocanaVirtualDevice_Create(CFAllocatorRef inAllocator, CFUUIDRef inRequestedTypeUUID);
+
+#define kSim_MaxChannels            16
+#define kSim_SignalPeriod           32768u      //	frames before the test signal repeats
+#define kSim_SignalScale            (1.0f / 65536.0f)
+#define kSim_ChannelOffset          0x1555u
+#define kSim_FirstClientID          1
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Host
+//==================================================================================================
+
+static AudioServerPlugInDriverRef   gSim_Driver = NULL;
+
+static OSStatus sim_host_properties_changed(AudioServerPlugInHostRef inHost, AudioObjectID inObjectID, UInt32 inNumberAddresses, const AudioObjectPropertyAddress* inAddresses)
+{
+    return 0;
+}
+
+static OSStatus sim_host_copy_from_storage(AudioServerPlugInHostRef inHost, CFStringRef inKey, CFPropertyListRef* outData)
+{
+    //	nothing is ever persisted between simulator runs
+    *outData = NULL;
+    return 0;
+}
+
+static OSStatus sim_host_write_to_storage(AudioServerPlugInHostRef inHost, CFStringRef inKey, CFPropertyListRef inData)
+{
+    return 0;
+}
+
+static OSStatus sim_host_delete_from_storage(AudioServerPlugInHostRef inHost, CFStringRef inKey)
+{
+    return 0;
+}
+
+static OSStatus sim_host_request_device_configuration_change(AudioServerPlugInHostRef inHost, AudioObjectID inDeviceObjectID, UInt64 inChangeAction, void* inChangeInfo)
+{
+    //	the simulator only asks for changes while IO is stopped, so it can say yes straight away
+    return (*gSim_Driver)->PerformDeviceConfigurationChange(gSim_Driver, inDeviceObjectID, inChangeAction, inChangeInfo);
+}
+
+static const AudioServerPlugInHostInterface gSim_Host =
+{
+    sim_host_properties_changed,
+    sim_host_copy_from_storage,
+    sim_host_write_to_storage,
+    sim_host_delete_from_storage,
+    sim_host_request_device_configuration_change
+};
+
+AudioServerPlugInDriverRef VocanaHALSimulator_Load(void)
+{
+    if(gSim_Driver == NULL)
+    {
+        //	start the simulated clock somewhere other than zero so that host time arithmetic in
+        //	the driver can't accidentally rely on it
+        VocanaHALShim_SetHostTime(1000000000ull);
+
+        AudioServerPlugInDriverRef theDriver = VocanaVirtualDevice_Create(NULL, kAudioServerPlugInTypeUUID);
+        if(theDriver != NULL && (*theDriver)->Initialize(theDriver, &gSim_Host) == 0)
+        {
+            gSim_Driver = theDriver;
+            VocanaHALShim_DrainDispatchQueue();
+        }
+    }
+    return gSim_Driver;
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Histogram
+//==================================================================================================
+
+void VocanaHALSimulatorHistogram_Add(VocanaHALSimulatorHistogram* ioHistogram, UInt64 inNanos)
+{
+    UInt32 theBucket = 0;
+    for(UInt64 theValue = inNanos; theValue > 1 && theBucket < kVocanaHALSimulator_HistogramBuckets - 1; theValue >>= 1)
+    {
+        ++theBucket;
+    }
+    ++ioHistogram->buckets[theBucket];
+
+    if(ioHistogram->count == 0 || inNanos < ioHistogram->minNanos)
+    {
+        ioHistogram->minNanos = inNanos;
+    }
+    if(inNanos > ioHistogram->maxNanos)
+    {
+        ioHistogram->maxNanos = inNanos;
+    }
+    ++ioHistogram->count;
+    ioHistogram->totalNanos += (Float64)inNanos;
+}
+
+UInt64 VocanaHALSimulatorHistogram_Percentile(const VocanaHALSimulatorHistogram* inHistogram, Float64 inPercentile)
+{
+    if(inHistogram->count == 0)
+    {
+        return 0;
+    }
+
+    UInt64 theTarget = (UInt64)ceil(inPercentile / 100.0 * (Float64)inHistogram->count);
+    UInt64 theSeen = 0;
+    for(UInt32 i = 0; i < kVocanaHALSimulator_HistogramBuckets; i++)
+    {
+        theSeen += inHistogram->buckets[i];
+        if(theSeen >= theTarget && inHistogram->buckets[i] > 0)
+        {
+            UInt64 theUpperBound = (2ull << i) - 1;
+            return theUpperBound < inHistogram->maxNanos ? theUpperBound : inHistogram->maxNanos;
+        }
+    }
+    return inHistogram->maxNanos;
+}
+
+static UInt64 sim_now_nanos(void)
+{
+    struct timespec theTime;
+    clock_gettime(CLOCK_MONOTONIC, &theTime);
+    return (UInt64)theTime.tv_sec * 1000000000ull + (UInt64)theTime.tv_nsec;
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Test Signal
+//==================================================================================================
+
+//	Every sample is a small exact multiple of 2^-16 that encodes the frame's sample time (modulo
+//	kSim_SignalPeriod) plus a per-channel offset, so a reader can tell which frame it got.
+static inline UInt32 sim_signal_index(UInt64 inFrame, UInt32 inChannel)
+{
+    return (UInt32)((inFrame + (UInt64)inChannel * kSim_ChannelOffset) % kSim_SignalPeriod);
+}
+
+static inline Float32 sim_signal_value(UInt64 inFrame, UInt32 inChannel)
+{
+    return (Float32)(sim_signal_index(inFrame, inChannel) + 1) * kSim_SignalScale;
+}
+
+static void sim_fill_signal(Float32* outFrames, UInt64 inFrame, UInt32 inFrameCount, UInt32 inChannels, Float32 inGain)
+{
+    for(UInt32 i = 0; i < inFrameCount; i++)
+    {
+        for(UInt32 c = 0; c < inChannels; c++)
+        {
+            outFrames[i * inChannels + c] = sim_signal_value(inFrame + i, c) * inGain;
+        }
+    }
+}
+
+//	FNV-1a over the sample bits
+static UInt64 sim_checksum(const Float32* inFrames, UInt32 inSampleCount)
+{
+    const UInt8* theBytes = (const UInt8*)inFrames;
+    UInt64 theHash = 0xcbf29ce484222325ull;
+    for(size_t i = 0; i < (size_t)inSampleCount * sizeof(Float32); i++)
+    {
+        theHash ^= theBytes[i];
+        theHash *= 0x100000001b3ull;
+    }
+    return theHash;
+}
+
+typedef enum SimFrameClass
+{
+    kSimFrame_Correct,
+    kSimFrame_Lost,
+    kSimFrame_Duplicated,
+    kSimFrame_Skipped,
+    kSimFrame_Corrupt,
+} SimFrameClass;
+
+static SimFrameClass sim_classify_frame(const Float32* inFrame, UInt64 inExpectedFrame, UInt32 inChannels, Float32 inGain)
+{
+    bool isSilent = true;
+    for(UInt32 c = 0; c < inChannels; c++)
+    {
+        isSilent = isSilent && inFrame[c] == 0.0f;
+    }
+    if(isSilent)
+    {
+        return kSimFrame_Lost;
+    }
+
+    //	decode channel 0 back to a frame index and check the others agree with it
+    Float32 theUnit = kSim_SignalScale * inGain;
+    long theIndex = lrintf(inFrame[0] / theUnit) - 1;
+    if(theIndex < 0 || theIndex >= (long)kSim_SignalPeriod)
+    {
+        return kSimFrame_Corrupt;
+    }
+    for(UInt32 c = 0; c < inChannels; c++)
+    {
+        UInt32 theChannelIndex = (UInt32)(((UInt64)theIndex + (UInt64)c * kSim_ChannelOffset) % kSim_SignalPeriod);
+        if(fabsf(inFrame[c] - (Float32)(theChannelIndex + 1) * theUnit) > theUnit * 0.25f)
+        {
+            return kSimFrame_Corrupt;
+        }
+    }
+
+    //	signed distance from the expected frame, modulo the signal period
+    long theDelta = theIndex - (long)(inExpectedFrame % kSim_SignalPeriod);
+    if(theDelta >= (long)kSim_SignalPeriod / 2)
+    {
+        theDelta -= kSim_SignalPeriod;
+    }
+    else if(theDelta < -(long)kSim_SignalPeriod / 2)
+    {
+        theDelta += kSim_SignalPeriod;
+    }
+
+    if(theDelta == 0)
+    {
+        return kSimFrame_Correct;
+    }
+    return theDelta < 0 ? kSimFrame_Duplicated : kSimFrame_Skipped;
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Driver Queries
+//==================================================================================================
+
+static OSStatus sim_get_property(AudioObjectID inObjectID, AudioObjectPropertySelector inSelector, AudioObjectPropertyScope inScope, UInt32 inDataSize, void* outData)
+{
+    AudioObjectPropertyAddress theAddress = { inSelector, inScope, kAudioObjectPropertyElementMain };
+    UInt32 theDataSize = 0;
+    return (*gSim_Driver)->GetPropertyData(gSim_Driver, inObjectID, 0, &theAddress, 0, NULL, inDataSize, &theDataSize, outData);
+}
+
+static OSStatus sim_set_sample_rate(AudioObjectID inDeviceObjectID, Float64 inSampleRate)
+{
+    Float64 theSampleRate = 0.0;
+    OSStatus theError = sim_get_property(inDeviceObjectID, kAudioDevicePropertyNominalSampleRate, kAudioObjectPropertyScopeGlobal, sizeof(theSampleRate), &theSampleRate);
+    if(theError == 0 && theSampleRate != inSampleRate)
+    {
+        //	the driver defers the change to the host, which runs it when the queue drains
+        AudioObjectPropertyAddress theAddress = { kAudioDevicePropertyNominalSampleRate, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMain };
+        theError = (*gSim_Driver)->SetPropertyData(gSim_Driver, inDeviceObjectID, 0, &theAddress, 0, NULL, sizeof(inSampleRate), &inSampleRate);
+        VocanaHALShim_DrainDispatchQueue();
+        if(theError == 0)
+        {
+            theError = sim_get_property(inDeviceObjectID, kAudioDevicePropertyNominalSampleRate, kAudioObjectPropertyScopeGlobal, sizeof(theSampleRate), &theSampleRate);
+        }
+        if(theError == 0 && theSampleRate != inSampleRate)
+        {
+            theError = kAudioDeviceUnsupportedFormatError;
+        }
+    }
+    return theError;
+}
+
+static OSStatus sim_set_channel_count(AudioObjectID inDeviceObjectID, UInt32 inChannelCount)
+{
+    CFNumberRef theNumber = NULL;
+    OSStatus theError = sim_get_property(inDeviceObjectID, kVocanaDevicePropertyChannelCount, kAudioObjectPropertyScopeGlobal, sizeof(theNumber), &theNumber);
+    SInt32 theChannelCount = 0;
+    if(theError == 0 && (!CFNumberGetValue(theNumber, kCFNumberSInt32Type, &theChannelCount) || (UInt32)theChannelCount != inChannelCount))
+    {
+        //	like the sample rate, the change runs when the queue drains
+        AudioObjectPropertyAddress theAddress = { kVocanaDevicePropertyChannelCount, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMain };
+        SInt32 theNewChannelCount = (SInt32)inChannelCount;
+        CFNumberRef theNewNumber = CFNumberCreate(NULL, kCFNumberSInt32Type, &theNewChannelCount);
+        theError = (*gSim_Driver)->SetPropertyData(gSim_Driver, inDeviceObjectID, 0, &theAddress, 0, NULL, sizeof(theNewNumber), &theNewNumber);
+        VocanaHALShim_DrainDispatchQueue();
+        if(theError == 0)
+        {
+            theError = sim_get_property(inDeviceObjectID, kVocanaDevicePropertyChannelCount, kAudioObjectPropertyScopeGlobal, sizeof(theNumber), &theNumber);
+        }
+        if(theError == 0 && (!CFNumberGetValue(theNumber, kCFNumberSInt32Type, &theChannelCount) || (UInt32)theChannelCount != inChannelCount))
+        {
+            theError = kAudioDeviceUnsupportedFormatError;
+        }
+    }
+    return theError;
+}
+
+typedef struct SimDeviceLayout
+{
+    AudioObjectID   inputStream;
+    AudioObjectID   outputStream;
+    UInt32          channels;
+    UInt32          inputSafetyOffset;
+    UInt32          outputSafetyOffset;
+    UInt32          inputLatency;
+    UInt32          outputLatency;
+    UInt32          zeroTimeStampPeriod;
+} SimDeviceLayout;
+
+static OSStatus sim_query_layout(AudioObjectID inDeviceObjectID, SimDeviceLayout* outLayout)
+{
+    memset(outLayout, 0, sizeof(*outLayout));
+
+    OSStatus theError = sim_get_property(inDeviceObjectID, kAudioDevicePropertyStreams, kAudioObjectPropertyScopeInput, sizeof(AudioObjectID), &outLayout->inputStream);
+    if(theError == 0)
+    {
+        theError = sim_get_property(inDeviceObjectID, kAudioDevicePropertyStreams, kAudioObjectPropertyScopeOutput, sizeof(AudioObjectID), &outLayout->outputStream);
+    }
+
+    AudioStreamBasicDescription theFormat;
+    if(theError == 0)
+    {
+        theError = sim_get_property(outLayout->outputStream, kAudioStreamPropertyVirtualFormat, kAudioObjectPropertyScopeGlobal, sizeof(theFormat), &theFormat);
+        outLayout->channels = theFormat.mChannelsPerFrame;
+    }
+    if(theError == 0 && (outLayout->channels == 0 || outLayout->channels > kSim_MaxChannels))
+    {
+        theError = kAudioDeviceUnsupportedFormatError;
+    }
+
+    if(theError == 0)
+    {
+        theError = sim_get_property(inDeviceObjectID, kAudioDevicePropertySafetyOffset, kAudioObjectPropertyScopeInput, sizeof(UInt32), &outLayout->inputSafetyOffset);
+    }
+    if(theError == 0)
+    {
+        theError = sim_get_property(inDeviceObjectID, kAudioDevicePropertySafetyOffset, kAudioObjectPropertyScopeOutput, sizeof(UInt32), &outLayout->outputSafetyOffset);
+    }
+    if(theError == 0)
+    {
+        theError = sim_get_property(inDeviceObjectID, kAudioDevicePropertyLatency, kAudioObjectPropertyScopeInput, sizeof(UInt32), &outLayout->inputLatency);
+    }
+    if(theError == 0)
+    {
+        theError = sim_get_property(inDeviceObjectID, kAudioDevicePropertyLatency, kAudioObjectPropertyScopeOutput, sizeof(UInt32), &outLayout->outputLatency);
+    }
+    if(theError == 0)
+    {
+        theError = sim_get_property(inDeviceObjectID, kAudioDevicePropertyZeroTimeStampPeriod, kAudioObjectPropertyScopeGlobal, sizeof(UInt32), &outLayout->zeroTimeStampPeriod);
+    }
+    return theError;
+}
+
+//	Finds the device's clock source control in its control list and selects the given item.
+static OSStatus sim_select_clock_source(AudioObjectID inDeviceObjectID, UInt32 inItem)
+{
+    AudioObjectID theControls[32];
+    AudioObjectPropertyAddress theAddress = { kAudioObjectPropertyControlList, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMain };
+    UInt32 theDataSize = 0;
+    OSStatus theError = (*gSim_Driver)->GetPropertyData(gSim_Driver, inDeviceObjectID, 0, &theAddress, 0, NULL, sizeof(theControls), &theDataSize, theControls);
+    for(UInt32 i = 0; theError == 0 && i < theDataSize / sizeof(AudioObjectID); i++)
+    {
+        AudioClassID theClass = 0;
+        if(sim_get_property(theControls[i], kAudioObjectPropertyClass, kAudioObjectPropertyScopeGlobal, sizeof(theClass), &theClass) == 0 && theClass == kAudioClockSourceControlClassID)
+        {
+            //	the driver switches its clock through a configuration change
+            AudioObjectPropertyAddress theItemAddress = { kAudioSelectorControlPropertyCurrentItem, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMain };
+            theError = (*gSim_Driver)->SetPropertyData(gSim_Driver, theControls[i], 0, &theItemAddress, 0, NULL, sizeof(inItem), &inItem);
+            VocanaHALShim_DrainDispatchQueue();
+            return theError;
+        }
+    }
+    return theError != 0 ? theError : kAudioHardwareUnknownPropertyError;
+}
+
+//	Hands the driver one time stamp of the reference device, the way the app would.
+static OSStatus sim_add_clock_reference(AudioObjectID inDeviceObjectID, Float64 inSampleTime, UInt64 inHostTime)
+{
+    VocanaClockReference theReference = { inSampleTime, inHostTime };
+    CFDataRef theData = CFDataCreate(NULL, (const UInt8*)&theReference, sizeof(theReference));
+    AudioObjectPropertyAddress theAddress = { kVocanaDevicePropertyClockReference, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMain };
+    OSStatus theError = (*gSim_Driver)->SetPropertyData(gSim_Driver, inDeviceObjectID, 0, &theAddress, 0, NULL, sizeof(theData), &theData);
+    CFRelease(theData);
+    return theError;
+}
+
+static OSStatus sim_get_clock_statistics(AudioObjectID inDeviceObjectID, VocanaClockStatistics* outStatistics)
+{
+    CFDataRef theData = NULL;
+    OSStatus theError = sim_get_property(inDeviceObjectID, kVocanaDevicePropertyClockStatistics, kAudioObjectPropertyScopeGlobal, sizeof(theData), &theData);
+    if(theError == 0)
+    {
+        if(CFDataGetLength(theData) == sizeof(*outStatistics))
+        {
+            memcpy(outStatistics, CFDataGetBytePtr(theData), sizeof(*outStatistics));
+        }
+        else
+        {
+            theError = kAudioHardwareBadPropertySizeError;
+        }
+        CFRelease(theData);
+    }
+    return theError;
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Run
+//==================================================================================================
+
+void VocanaHALSimulator_DefaultConfig(VocanaHALSimulatorConfig* outConfig)
+{
+    memset(outConfig, 0, sizeof(*outConfig));
+    outConfig->deviceObjectID = 3;
+    outConfig->sampleRate = 48000.0;
+    outConfig->channelCount = 2;
+    outConfig->bufferFrameSize = 512;
+    outConfig->clientCount = 1;
+    outConfig->writingClientCount = 1;
+    outConfig->cycleCount = (UInt64)(10.0 * 48000.0 / 512.0);
+    outConfig->wakeJitterFrames = 0.0;
+    outConfig->seed = 1;
+    outConfig->fault = kVocanaHALSimulatorFault_None;
+    outConfig->faultEveryCycles = 0;
+}
+
+typedef struct SimClient
+{
+    UInt32      clientID;
+    bool        isWriting;
+    bool        isChecking;         //	set once the first frame of signal has come back
+    Float32*    outputBuffer;
+    Float32*    previousOutputBuffer;
+    Float32*    inputBuffer;
+    Float32*    expectedBuffer;
+} SimClient;
+
+//	Every writer sends the signal scaled down by the same power of two, at least as large as the
+//	number of writers, so that the driver's mix of all of them is exact in floating point and
+//	stays clear of the clip level. What comes back is the signal scaled by sim_mix_gain, which
+//	only matches if every writer was summed exactly once.
+static Float32 sim_writer_gain(const VocanaHALSimulatorConfig* inConfig)
+{
+    UInt32 theDivisor = 1;
+    while(theDivisor < inConfig->writingClientCount)
+    {
+        theDivisor <<= 1;
+    }
+    return 1.0f / (Float32)theDivisor;
+}
+
+static Float32 sim_mix_gain(const VocanaHALSimulatorConfig* inConfig)
+{
+    return sim_writer_gain(inConfig) * (Float32)inConfig->writingClientCount;
+}
+
+static void sim_record_error(VocanaHALSimulatorReport* ioReport, OSStatus inError)
+{
+    if(inError != 0 && ioReport->error == 0)
+    {
+        ioReport->error = inError;
+    }
+}
+
+static UInt32 sim_random(UInt32* ioSeed)
+{
+    *ioSeed = *ioSeed * 1103515245u + 12345u;
+    return *ioSeed >> 8;
+}
+
+static void sim_check_input(const VocanaHALSimulatorConfig* inConfig, const SimDeviceLayout* inLayout, SimClient* ioClient, UInt64 inCycle, UInt64 inFrame, UInt64 inWrittenFrame, VocanaHALSimulatorReport* ioReport)
+{
+    UInt32 theFrames = inConfig->bufferFrameSize;
+    UInt32 theChannels = inLayout->channels;
+    UInt32 theFirstFrame = 0;
+
+    if(!ioClient->isChecking)
+    {
+        //	before the loopback fills up the input is silent; start checking at the first frame of
+        //	signal
+        while(theFirstFrame < theFrames && sim_classify_frame(&ioClient->inputBuffer[theFirstFrame * theChannels], inFrame + theFirstFrame, theChannels, sim_mix_gain(inConfig)) == kSimFrame_Lost)
+        {
+            ++theFirstFrame;
+        }
+        if(theFirstFrame == theFrames)
+        {
+            return;
+        }
+        ioClient->isChecking = true;
+        if(ioReport->warmUpCycles == 0)
+        {
+            ioReport->warmUpCycles = inCycle;
+            ioReport->loopbackLatencyFrames = (Float64)inWrittenFrame - (Float64)(inFrame + theFirstFrame);
+        }
+    }
+
+    UInt32 theCount = theFrames - theFirstFrame;
+    const Float32* theReceived = &ioClient->inputBuffer[theFirstFrame * theChannels];
+    sim_fill_signal(ioClient->expectedBuffer, inFrame + theFirstFrame, theCount, theChannels, sim_mix_gain(inConfig));
+
+    ioReport->framesChecked += theCount;
+    if(sim_checksum(theReceived, theCount * theChannels) == sim_checksum(ioClient->expectedBuffer, theCount * theChannels))
+    {
+        ioReport->framesCorrect += theCount;
+        return;
+    }
+
+    //	something went wrong in this cycle; find out what
+    for(UInt32 i = 0; i < theCount; i++)
+    {
+        switch(sim_classify_frame(&theReceived[i * theChannels], inFrame + theFirstFrame + i, theChannels, sim_mix_gain(inConfig)))
+        {
+            case kSimFrame_Correct:     ++ioReport->framesCorrect;      break;
+            case kSimFrame_Lost:        ++ioReport->framesLost;         break;
+            case kSimFrame_Duplicated:  ++ioReport->framesDuplicated;   break;
+            case kSimFrame_Skipped:     ++ioReport->framesSkipped;      break;
+            case kSimFrame_Corrupt:     ++ioReport->framesCorrupt;      break;
+        }
+    }
+    ++ioReport->glitchCycles;
+    if(ioReport->firstGlitchCycle < 0)
+    {
+        ioReport->firstGlitchCycle = (SInt64)inCycle;
+    }
+}
+
+OSStatus VocanaHALSimulator_Run(const VocanaHALSimulatorConfig* inConfig, VocanaHALSimulatorReport* outReport)
+{
+    memset(outReport, 0, sizeof(*outReport));
+    outReport->firstGlitchCycle = -1;
+
+    if(inConfig->clientCount == 0 || inConfig->clientCount > kVocanaHALSimulator_MaxClients ||
+       inConfig->writingClientCount > inConfig->clientCount ||
+       inConfig->bufferFrameSize == 0 || inConfig->bufferFrameSize > kVocanaHALSimulator_MaxBufferFrameSize)
+    {
+        outReport->error = kAudioHardwareIllegalOperationError;
+        return outReport->error;
+    }
+
+    if(VocanaHALSimulator_Load() == NULL)
+    {
+        outReport->error = kAudioHardwareUnspecifiedError;
+        return outReport->error;
+    }
+
+    AudioObjectID theDevice = inConfig->deviceObjectID;
+    UInt32 theFrames = inConfig->bufferFrameSize;
+    SimDeviceLayout theLayout;
+    sim_record_error(outReport, sim_set_sample_rate(theDevice, inConfig->sampleRate));
+    if(outReport->error == 0)
+    {
+        sim_record_error(outReport, sim_set_channel_count(theDevice, inConfig->channelCount));
+    }
+    if(outReport->error == 0)
+    {
+        sim_record_error(outReport, sim_query_layout(theDevice, &theLayout));
+    }
+    if(outReport->error != 0)
+    {
+        return outReport->error;
+    }
+    outReport->zeroTimeStampPeriod = theLayout.zeroTimeStampPeriod;
+
+    //	the adjustable clock source makes the driver follow the references
+    if(inConfig->trackReference)
+    {
+        sim_record_error(outReport, sim_select_clock_source(theDevice, 1));
+        if(outReport->error != 0)
+        {
+            return outReport->error;
+        }
+    }
+
+    //	set up the clients
+    SimClient theClients[kVocanaHALSimulator_MaxClients];
+    size_t theBufferBytes = (size_t)theFrames * theLayout.channels * sizeof(Float32);
+    for(UInt32 i = 0; i < inConfig->clientCount; i++)
+    {
+        SimClient* theClient = &theClients[i];
+        memset(theClient, 0, sizeof(*theClient));
+        theClient->clientID = kSim_FirstClientID + i;
+        theClient->isWriting = i < inConfig->writingClientCount;
+        theClient->outputBuffer = calloc(1, theBufferBytes);
+        theClient->previousOutputBuffer = calloc(1, theBufferBytes);
+        theClient->inputBuffer = calloc(1, theBufferBytes);
+        theClient->expectedBuffer = calloc(1, theBufferBytes);
+
+        AudioServerPlugInClientInfo theClientInfo = { theClient->clientID, (pid_t)(1000 + i), true, NULL };
+        sim_record_error(outReport, (*gSim_Driver)->AddDeviceClient(gSim_Driver, theDevice, &theClientInfo));
+    }
+
+    //	start IO; the driver anchors its clock to the host time at the first StartIO
+    Float64 theTicksPerFrame = 1.0e9 / inConfig->sampleRate;
+    UInt64 theAnchorHostTime = VocanaHALShim_GetHostTime() + 1000000ull;
+    VocanaHALShim_SetHostTime(theAnchorHostTime);
+    for(UInt32 i = 0; i < inConfig->clientCount; i++)
+    {
+        sim_record_error(outReport, (*gSim_Driver)->StartIO(gSim_Driver, theDevice, theClients[i].clientID));
+    }
+
+    Float64 theJitterFrames = fmin(fmax(inConfig->wakeJitterFrames, 0.0), (Float64)theFrames - 1.0);
+    UInt32 theSeed = inConfig->seed;
+    Float64 thePreviousZeroSampleTime = -1.0;
+    UInt64 thePreviousZeroHostTime = 0;
+    UInt64 thePreviousZeroSeed = 0;
+
+    //	like the HAL, the simulator learns the device's rate from successive zero time stamps and
+    //	schedules its wake-ups on the device's timeline, starting out from the nominal rate
+    Float64 theDeviceTicksPerFrame = theTicksPerFrame;
+    Float64 theLastZeroSampleTime = 0.0;
+    UInt64 theLastZeroHostTime = theAnchorHostTime;
+
+    //	the reference device started together with the device and runs off by the configured drift
+    Float64 theReferenceTicksPerFrame = theTicksPerFrame / (1.0 + inConfig->referenceDriftPPM * 1.0e-6);
+    Float64 theReferenceJitterNanos = fmax(inConfig->referenceJitterNanos, 0.0);
+    UInt64 theLastReferenceFrame = 0;
+    Float64 theHalfwayOffsetFrames = 0.0;
+
+    //	when the device's rate moves, the wake-ups in the first period at the new rate are off by
+    //	as much as the rate moved over that period, at most the whole drift when tracking locks on
+    Float64 theClockToleranceFrames = 1.0;
+    if(inConfig->trackReference)
+    {
+        theClockToleranceFrames += fabs(inConfig->referenceDriftPPM) * 1.0e-6 * theLayout.zeroTimeStampPeriod;
+    }
+
+    for(UInt64 theCycle = 1; theCycle <= inConfig->cycleCount && outReport->error == 0; theCycle++)
+    {
+        //	the cycle's nominal sample time and when the IO thread actually wakes up for it
+        UInt64 theCycleFrame = theCycle * theFrames;
+        Float64 theLateness = theJitterFrames * (Float64)(sim_random(&theSeed) & 0xFFFF) / 65536.0;
+        UInt64 theWakeHostTime = theLastZeroHostTime + (UInt64)llround(((Float64)theCycleFrame + theLateness - theLastZeroSampleTime) * theDeviceTicksPerFrame);
+        VocanaHALShim_SetHostTime(theWakeHostTime);
+
+        //	the app hands over the time stamp of the reference device's latest IO cycle
+        UInt64 theReferenceFrame = (UInt64)floor((Float64)(theWakeHostTime - theAnchorHostTime) / theReferenceTicksPerFrame / theFrames) * theFrames;
+        if(inConfig->trackReference && theReferenceFrame > theLastReferenceFrame)
+        {
+            Float64 theReferenceJitter = theReferenceJitterNanos * (Float64)(sim_random(&theSeed) & 0xFFFF) / 65536.0;
+            UInt64 theReferenceHostTime = theAnchorHostTime + (UInt64)llround((Float64)theReferenceFrame * theReferenceTicksPerFrame + theReferenceJitter);
+            sim_record_error(outReport, sim_add_clock_reference(theDevice, (Float64)theReferenceFrame, theReferenceHostTime));
+            theLastReferenceFrame = theReferenceFrame;
+        }
+
+        bool isFaultCycle = inConfig->fault != kVocanaHALSimulatorFault_None && inConfig->faultEveryCycles != 0 &&
+                            theCycle > 4 && theCycle % inConfig->faultEveryCycles == 0;
+
+        //	the HAL asks for the zero time stamp every cycle to track the device clock
+        Float64 theZeroSampleTime = 0.0;
+        UInt64 theZeroHostTime = 0;
+        UInt64 theZeroSeed = 0;
+        UInt64 theCallStart = sim_now_nanos();
+        sim_record_error(outReport, (*gSim_Driver)->GetZeroTimeStamp(gSim_Driver, theDevice, 0, &theZeroSampleTime, &theZeroHostTime, &theZeroSeed));
+        UInt64 theCycleNanos = sim_now_nanos() - theCallStart;
+        VocanaHALSimulatorHistogram_Add(&outReport->zeroTimeStampLatency, theCycleNanos);
+
+        if(thePreviousZeroSampleTime >= 0.0)
+        {
+            Float64 theStep = theZeroSampleTime - thePreviousZeroSampleTime;
+            if((theStep != 0.0 && theStep != (Float64)theLayout.zeroTimeStampPeriod) || theZeroHostTime < thePreviousZeroHostTime)
+            {
+                ++outReport->zeroTimeStampErrors;
+            }
+            if(theStep > 0.0)
+            {
+                theDeviceTicksPerFrame = (Float64)(theZeroHostTime - thePreviousZeroHostTime) / theStep;
+            }
+            if(theZeroSeed != thePreviousZeroSeed)
+            {
+                ++outReport->zeroTimeStampSeedChanges;
+            }
+        }
+        thePreviousZeroSampleTime = theZeroSampleTime;
+        thePreviousZeroHostTime = theZeroHostTime;
+        thePreviousZeroSeed = theZeroSeed;
+        theLastZeroSampleTime = theZeroSampleTime;
+        theLastZeroHostTime = theZeroHostTime;
+
+        //	where the driver's clock says the device is right now; it should be within a frame of
+        //	where the simulator put it
+        Float64 theCurrentSampleTime = theZeroSampleTime + ((Float64)theWakeHostTime - (Float64)theZeroHostTime) / theDeviceTicksPerFrame;
+        if(fabs(theCurrentSampleTime - ((Float64)theCycleFrame + theLateness)) > theClockToleranceFrames)
+        {
+            ++outReport->zeroTimeStampErrors;
+        }
+
+        //	and where the reference device is
+        Float64 theReferenceOffsetFrames = theCurrentSampleTime - (Float64)(theWakeHostTime - theAnchorHostTime) / theReferenceTicksPerFrame;
+        if(theCycle == inConfig->cycleCount / 2)
+        {
+            theHalfwayOffsetFrames = theReferenceOffsetFrames;
+        }
+        outReport->referenceOffsetFrames = theReferenceOffsetFrames;
+        outReport->referenceOffsetCreepFrames = theReferenceOffsetFrames - theHalfwayOffsetFrames;
+
+        AudioServerPlugInIOCycleInfo theCycleInfo;
+        memset(&theCycleInfo, 0, sizeof(theCycleInfo));
+        theCycleInfo.mIOCycleCounter = theCycle;
+        theCycleInfo.mNominalIOBufferFrameSize = theFrames;
+        theCycleInfo.mDeviceHostTicksPerFrame = theDeviceTicksPerFrame;
+        theCycleInfo.mCurrentTime.mSampleTime = floor(theCurrentSampleTime);
+        theCycleInfo.mCurrentTime.mHostTime = theWakeHostTime;
+        theCycleInfo.mCurrentTime.mRateScalar = 1.0;
+        theCycleInfo.mCurrentTime.mFlags = kAudioTimeStampSampleTimeValid | kAudioTimeStampHostTimeValid | kAudioTimeStampRateScalarValid;
+        theCycleInfo.mInputTime = theCycleInfo.mCurrentTime;
+        theCycleInfo.mInputTime.mSampleTime = (Float64)theCycleFrame - theFrames - theLayout.inputSafetyOffset;
+        theCycleInfo.mOutputTime = theCycleInfo.mCurrentTime;
+        theCycleInfo.mOutputTime.mSampleTime = (Float64)theCycleFrame + theFrames + theLayout.outputSafetyOffset;
+
+        if(isFaultCycle && inConfig->fault == kVocanaHALSimulatorFault_Overload)
+        {
+            //	as if the IO thread had been descheduled for a few buffers after it woke up
+            theCycleInfo.mCurrentTime.mSampleTime = theCycleInfo.mOutputTime.mSampleTime + 3 * theFrames;
+        }
+
+        UInt64 theInputFrame = (UInt64)theCycleInfo.mInputTime.mSampleTime;
+        UInt64 theOutputFrame = (UInt64)theCycleInfo.mOutputTime.mSampleTime;
+
+        for(UInt32 i = 0; i < inConfig->clientCount && outReport->error == 0; i++)
+        {
+            SimClient* theClient = &theClients[i];
+
+            //	input first, the way a client's IO proc sees it
+            memset(theClient->inputBuffer, 0xff, theBufferBytes);
+            theCallStart = sim_now_nanos();
+            sim_record_error(outReport, (*gSim_Driver)->BeginIOOperation(gSim_Driver, theDevice, theClient->clientID, kAudioServerPlugInIOOperationReadInput, theFrames, &theCycleInfo));
+            sim_record_error(outReport, (*gSim_Driver)->DoIOOperation(gSim_Driver, theDevice, theLayout.inputStream, theClient->clientID, kAudioServerPlugInIOOperationReadInput, theFrames, &theCycleInfo, theClient->inputBuffer, NULL));
+            sim_record_error(outReport, (*gSim_Driver)->EndIOOperation(gSim_Driver, theDevice, theClient->clientID, kAudioServerPlugInIOOperationReadInput, theFrames, &theCycleInfo));
+            UInt64 theCallNanos = sim_now_nanos() - theCallStart;
+            VocanaHALSimulatorHistogram_Add(&outReport->readInputLatency, theCallNanos);
+            theCycleNanos += theCallNanos;
+            if(inConfig->inputProc != NULL)
+            {
+                inConfig->inputProc(inConfig->procContext, i, theInputFrame, theFrames, theLayout.channels, theClient->inputBuffer);
+            }
+            if(inConfig->signalProc == NULL)
+            {
+                sim_check_input(inConfig, &theLayout, theClient, theCycle, theInputFrame, theOutputFrame, outReport);
+            }
+
+            if(!theClient->isWriting)
+            {
+                continue;
+            }
+
+            if(isFaultCycle && inConfig->fault == kVocanaHALSimulatorFault_SkipWrite)
+            {
+                continue;
+            }
+
+            Float32* theSwap = theClient->previousOutputBuffer;
+            theClient->previousOutputBuffer = theClient->outputBuffer;
+            theClient->outputBuffer = theSwap;
+            if(isFaultCycle && inConfig->fault == kVocanaHALSimulatorFault_RepeatWrite)
+            {
+                memcpy(theClient->outputBuffer, theClient->previousOutputBuffer, theBufferBytes);
+            }
+            else if(inConfig->signalProc != NULL)
+            {
+                inConfig->signalProc(inConfig->procContext, theOutputFrame, theFrames, theLayout.channels, theClient->outputBuffer);
+            }
+            else
+            {
+                sim_fill_signal(theClient->outputBuffer, theOutputFrame, theFrames, theLayout.channels, sim_writer_gain(inConfig));
+            }
+
+            theCallStart = sim_now_nanos();
+            sim_record_error(outReport, (*gSim_Driver)->BeginIOOperation(gSim_Driver, theDevice, theClient->clientID, kAudioServerPlugInIOOperationWriteMix, theFrames, &theCycleInfo));
+            sim_record_error(outReport, (*gSim_Driver)->DoIOOperation(gSim_Driver, theDevice, theLayout.outputStream, theClient->clientID, kAudioServerPlugInIOOperationWriteMix, theFrames, &theCycleInfo, theClient->outputBuffer, NULL));
+            sim_record_error(outReport, (*gSim_Driver)->EndIOOperation(gSim_Driver, theDevice, theClient->clientID, kAudioServerPlugInIOOperationWriteMix, theFrames, &theCycleInfo));
+            theCallNanos = sim_now_nanos() - theCallStart;
+            VocanaHALSimulatorHistogram_Add(&outReport->writeMixLatency, theCallNanos);
+            theCycleNanos += theCallNanos;
+        }
+
+        VocanaHALSimulatorHistogram_Add(&outReport->cycleLatency, theCycleNanos);
+        ++outReport->cycles;
+    }
+
+    //	stop IO and let go of the clients
+    for(UInt32 i = 0; i < inConfig->clientCount; i++)
+    {
+        sim_record_error(outReport, (*gSim_Driver)->StopIO(gSim_Driver, theDevice, theClients[i].clientID));
+
+        AudioServerPlugInClientInfo theClientInfo = { theClients[i].clientID, (pid_t)(1000 + i), true, NULL };
+        sim_record_error(outReport, (*gSim_Driver)->RemoveDeviceClient(gSim_Driver, theDevice, &theClientInfo));
+
+        free(theClients[i].outputBuffer);
+        free(theClients[i].previousOutputBuffer);
+        free(theClients[i].inputBuffer);
+        free(theClients[i].expectedBuffer);
+    }
+    VocanaHALShim_DrainDispatchQueue();
+
+    VocanaClockStatistics theStatistics;
+    if(sim_get_clock_statistics(theDevice, &theStatistics) == 0)
+    {
+        outReport->trackedDriftPPM = theStatistics.driftPPM;
+    }
+    if(inConfig->trackReference)
+    {
+        sim_record_error(outReport, sim_select_clock_source(theDevice, 0));
+    }
+
+    return outReport->error;
+}
+
+//==================================================================================================
+#pragma mark -
+#pragma mark Reporting
+//==================================================================================================
+
+static void sim_print_histogram(FILE* inFile, const char* inName, const VocanaHALSimulatorHistogram* inHistogram)
+{
+    if(inHistogram->count == 0)
+    {
+        return;
+    }
+
+    fprintf(inFile, "      %-14s n=%llu  min %llu ns  mean %.0f ns  p50 <%llu ns  p99 <%llu ns  p99.9 <%llu ns  max %llu ns\n",
+            inName, (unsigned long long)inHistogram->count, (unsigned long long)inHistogram->minNanos,
+            inHistogram->totalNanos / (Float64)inHistogram->count,
+            (unsigned long long)VocanaHALSimulatorHistogram_Percentile(inHistogram, 50.0),
+            (unsigned long long)VocanaHALSimulatorHistogram_Percentile(inHistogram, 99.0),
+            (unsigned long long)VocanaHALSimulatorHistogram_Percentile(inHistogram, 99.9),
+            (unsigned long long)inHistogram->maxNanos);
+
+    UInt64 theLargest = 0;
+    for(UInt32 i = 0; i < kVocanaHALSimulator_HistogramBuckets; i++)
+    {
+        theLargest = inHistogram->buckets[i] > theLargest ? inHistogram->buckets[i] : theLargest;
+    }
+    for(UInt32 i = 0; i < kVocanaHALSimulator_HistogramBuckets; i++)
+    {
+        if(inHistogram->buckets[i] == 0)
+        {
+            continue;
+        }
+        int theBarLength = (int)(40 * inHistogram->buckets[i] / theLargest);
+        fprintf(inFile, "        <%10llu ns %10llu |%.*s\n", (unsigned long long)(2ull << i),
+                (unsigned long long)inHistogram->buckets[i], theBarLength > 0 ? theBarLength : 1,
+                "########################################");
+    }
+}
+
+void VocanaHALSimulator_PrintReport(FILE* inFile, const VocanaHALSimulatorConfig* inConfig, const VocanaHALSimulatorReport* inReport, bool inVerbose)
+{
+    Float64 theCorrect = inReport->framesChecked > 0 ? 100.0 * (Float64)inReport->framesCorrect / (Float64)inReport->framesChecked : 0.0;
+    fprintf(inFile, "    %6.0f Hz %4u frames %2u clients (%u writing): %llu cycles, %.3f%% correct, %llu glitch cycles (lost %llu dup %llu skip %llu corrupt %llu), loopback %.0f frames, io p99 <%llu ns\n",
+            inConfig->sampleRate, inConfig->bufferFrameSize, inConfig->clientCount, inConfig->writingClientCount,
+            (unsigned long long)inReport->cycles, theCorrect, (unsigned long long)inReport->glitchCycles,
+            (unsigned long long)inReport->framesLost, (unsigned long long)inReport->framesDuplicated,
+            (unsigned long long)inReport->framesSkipped, (unsigned long long)inReport->framesCorrupt,
+            inReport->loopbackLatencyFrames,
+            (unsigned long long)VocanaHALSimulatorHistogram_Percentile(&inReport->cycleLatency, 99.0));
+
+    if(inConfig->trackReference || inConfig->referenceDriftPPM != 0.0)
+    {
+        fprintf(inFile, "        reference %+.1f ppm (%s, measured %+.2f ppm): offset %+.2f frames, %+.2f frames of it over the second half\n",
+                inConfig->referenceDriftPPM, inConfig->trackReference ? "tracked" : "not tracked", inReport->trackedDriftPPM,
+                inReport->referenceOffsetFrames, inReport->referenceOffsetCreepFrames);
+    }
+
+    if(inVerbose)
+    {
+        sim_print_histogram(inFile, "zero time", &inReport->zeroTimeStampLatency);
+        sim_print_histogram(inFile, "read input", &inReport->readInputLatency);
+        sim_print_histogram(inFile, "write mix", &inReport->writeMixLatency);
+        sim_print_histogram(inFile, "whole cycle", &inReport->cycleLatency);
+    }
+}
@@ -0,0 +1,167 @@
+/*
+     File: VocanaHALSimulator.h
+
+ Copyright (C) 2024 Vocana Inc.
+
+ A host-independent stand-in for coreaudiod that loads VocanaVirtualDevice through its
+ AudioServerPlugInDriverInterface and drives it with synthetic IO cycles.
+
+ */
+
+#ifndef VocanaHALSimulator_h
+#define VocanaHALSimulator_h
+
+#include <CoreAudio/AudioServerPlugIn.h>
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//==================================================================================================
+//	How a run works
+//
+//	The simulator plays the part of the HAL: it initializes the driver with a fake host, sets the
+//	sample rate and channel count through the property API, registers and starts its clients, and
+//	then runs IO cycles on a simulated host clock (see VocanaHALShim.h). Every cycle it moves the
+//	clock to the cycle's wake-up time, asks the driver for the zero time stamp, builds the
+//	AudioServerPlugInIOCycleInfo the way the HAL would and, for every client, runs
+//	Begin/Do/EndIOOperation for WriteMix and ReadInput.
+//
+//	The writing clients send a test signal in which every frame encodes its own sample time, and
+//	every client checks what it reads back against the same signal. A per-cycle checksum catches
+//	any difference; mismatching cycles are then examined frame by frame and classified as lost
+//	(silence where signal was expected), duplicated (a frame from earlier in the stream),
+//	skipped (a frame from later in the stream) or corrupt (anything else).
+//
+//	The device can also be run next to a simulated reference device, a hardware device whose clock
+//	is off nominal by a given drift. The simulator then selects the adjustable clock source, hands
+//	the driver the reference device's time stamps every cycle the way the app would, and wakes up
+//	on the device's own timeline, which it learns from the zero time stamps like the HAL does. The
+//	report says how far the device's timeline moved against the reference's.
+//
+//	The driver keeps its state in globals, so there is one driver per process and runs happen one
+//	after another. A run may target any of the driver's devices through deviceObjectID.
+//==================================================================================================
+
+enum
+{
+    kVocanaHALSimulator_MaxClients          = 64,
+    kVocanaHALSimulator_MaxBufferFrameSize  = 4096,
+    kVocanaHALSimulator_HistogramBuckets    = 32,
+};
+
+//	Faults the simulator can inject to prove the glitch detection works.
+typedef enum VocanaHALSimulatorFault
+{
+    kVocanaHALSimulatorFault_None           = 0,
+    kVocanaHALSimulatorFault_SkipWrite,     //	the writers skip their WriteMix
+    kVocanaHALSimulatorFault_RepeatWrite,   //	the writers send the previous cycle's buffer again
+    kVocanaHALSimulatorFault_Overload,      //	the cycle wakes up so late the driver sees an overload
+} VocanaHALSimulatorFault;
+
+//	A signal of the test's own for the writers to send in place of the test signal: fills
+//	inFrameCount interleaved frames from sample time inFrame. The run then has no frames to check,
+//	and the test judges what comes back itself, from the input proc.
+typedef void (*VocanaHALSimulatorSignalProc)(void* inContext, UInt64 inFrame, UInt32 inFrameCount, UInt32 inChannels, Float32* outFrames);
+
+//	Hands the test what a client read: inFrameCount interleaved frames from sample time inFrame.
+typedef void (*VocanaHALSimulatorInputProc)(void* inContext, UInt32 inClient, UInt64 inFrame, UInt32 inFrameCount, UInt32 inChannels, const Float32* inFrames);
+
+typedef struct VocanaHALSimulatorConfig
+{
+    AudioObjectID               deviceObjectID;
+    Float64                     sampleRate;
+    UInt32                      channelCount;
+    UInt32                      bufferFrameSize;
+    UInt32                      clientCount;
+    UInt32                      writingClientCount;     //	the first this many clients also write
+    UInt64                      cycleCount;
+    Float64                     wakeJitterFrames;       //	uniform random lateness of each wake-up
+    UInt32                      seed;
+
+    VocanaHALSimulatorFault     fault;
+    UInt64                      faultEveryCycles;       //	0 disables
+
+    //	the reference device, see above
+    bool                        trackReference;         //	feed it to the driver's clock
+    Float64                     referenceDriftPPM;      //	how much faster than nominal it runs
+    Float64                     referenceJitterNanos;   //	uniform random error of its time stamps
+
+    //	the test's own signal and what it reads back, see above; NULL for the test signal
+    VocanaHALSimulatorSignalProc signalProc;
+    VocanaHALSimulatorInputProc inputProc;
+    void*                       procContext;
+} VocanaHALSimulatorConfig;
+
+//	48kHz, stereo, 512 frames, one client that writes and reads, ten seconds of cycles.
+void    VocanaHALSimulator_DefaultConfig(VocanaHALSimulatorConfig* outConfig);
+
+//	Log2 histogram of durations: bucket i counts durations in [2^i, 2^(i+1)) nanoseconds.
+typedef struct VocanaHALSimulatorHistogram
+{
+    UInt64  buckets[kVocanaHALSimulator_HistogramBuckets];
+    UInt64  count;
+    UInt64  minNanos;
+    UInt64  maxNanos;
+    Float64 totalNanos;
+} VocanaHALSimulatorHistogram;
+
+void    VocanaHALSimulatorHistogram_Add(VocanaHALSimulatorHistogram* ioHistogram, UInt64 inNanos);
+
+//	Upper bound of the bucket holding the given percentile (0...100), in nanoseconds.
+UInt64  VocanaHALSimulatorHistogram_Percentile(const VocanaHALSimulatorHistogram* inHistogram, Float64 inPercentile);
+
+typedef struct VocanaHALSimulatorReport
+{
+    OSStatus                    error;                  //	first error returned by the driver
+    UInt64                      cycles;
+
+    //	wall clock time spent inside the driver, per call
+    VocanaHALSimulatorHistogram zeroTimeStampLatency;
+    VocanaHALSimulatorHistogram writeMixLatency;        //	Begin + Do + End for one client
+    VocanaHALSimulatorHistogram readInputLatency;       //	Begin + Do + End for one client
+    VocanaHALSimulatorHistogram cycleLatency;           //	all driver calls in a cycle, checks excluded
+
+    //	end to end signal check
+    UInt64                      framesChecked;
+    UInt64                      framesCorrect;
+    UInt64                      framesLost;
+    UInt64                      framesDuplicated;
+    UInt64                      framesSkipped;
+    UInt64                      framesCorrupt;
+    UInt64                      glitchCycles;
+    SInt64                      firstGlitchCycle;       //	-1 if there were none
+    UInt64                      warmUpCycles;           //	cycles before the first frame came back
+    Float64                     loopbackLatencyFrames;  //	sample time read minus sample time written
+
+    //	zero time stamp sanity: sample times must advance by exactly the period, host times must
+    //	never go backwards
+    UInt32                      zeroTimeStampPeriod;
+    UInt64                      zeroTimeStampErrors;
+    UInt64                      zeroTimeStampSeedChanges;
+
+    //	the device's sample time minus the reference device's at the end of the run, and how much
+    //	of that built up over the second half; a device that keeps up with the reference holds it
+    Float64                     referenceOffsetFrames;
+    Float64                     referenceOffsetCreepFrames;
+    Float64                     trackedDriftPPM;        //	what the driver's clock measured
+} VocanaHALSimulatorReport;
+
+//	Runs one simulation. Returns the first error the driver reported, which is also stored in the
+//	report; glitches are not errors.
+OSStatus    VocanaHALSimulator_Run(const VocanaHALSimulatorConfig* inConfig, VocanaHALSimulatorReport* outReport);
+
+//	One summary line for the config and report, then the latency histograms if inVerbose is set.
+void        VocanaHALSimulator_PrintReport(FILE* inFile, const VocanaHALSimulatorConfig* inConfig, const VocanaHALSimulatorReport* inReport, bool inVerbose);
+
+//	The driver loaded by the simulator, for tests that want to poke at properties directly. Valid
+//	after the first VocanaHALSimulator_Run or VocanaHALSimulator_Load.
+AudioServerPlugInDriverRef  VocanaHALSimulator_Load(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VocanaHALSimulator_h */
@@ -0,0 +1,30 @@
+/*
+     File: Accelerate.h
+
+ Copyright (C) 2024 Vocana Inc.
+
+ HAL simulator shim: scalar versions of the vDSP routines VocanaVirtualDevice.c uses.
+
+ */
+
+#ifndef VocanaHALShim_Accelerate_h
+#define VocanaHALShim_Accelerate_h
+
+#include <math.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef unsigned long   vDSP_Length;
+typedef long            vDSP_Stride;
+
+void    vDSP_vclr(float* outC, vDSP_Stride inStrideC, vDSP_Length inCount);
+void    vDSP_vsmul(const float* inA, vDSP_Stride inStrideA, const float* inB, float* outC, vDSP_Stride inStrideC, vDSP_Length inCount);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VocanaHALShim_Accelerate_h */
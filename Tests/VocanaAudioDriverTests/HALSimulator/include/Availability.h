@@ -0,0 +1,16 @@
+/*
+     File: Availability.h
+
+ Copyright (C) 2024 Vocana Inc.
+
+ HAL simulator shim: the simulated SDK is always new enough to have
+ kAudioObjectPropertyElementMain.
+
+ */
+
+#ifndef VocanaHALShim_Availability_h
+#define VocanaHALShim_Availability_h
+
+#define __MAC_12_0      120000
+
+#endif /* VocanaHALShim_Availability_h */
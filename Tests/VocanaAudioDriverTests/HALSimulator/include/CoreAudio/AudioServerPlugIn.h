@@ -0,0 +1,387 @@
+/*
+     File: AudioServerPlugIn.h
+
+ Copyright (C) 2024 Vocana Inc.
+
+ HAL simulator shim: the AudioServerPlugIn types and constants VocanaVirtualDevice.c uses, so the
+ driver builds on hosts without the macOS SDK. Selector and error values match the SDK; the
+ structures only need to match the field names the driver touches.
+
+ */
+
+#ifndef VocanaHALShim_AudioServerPlugIn_h
+#define VocanaHALShim_AudioServerPlugIn_h
+
+#include <CoreFoundation/CoreFoundation.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define VocanaHALShim_FourCC(a, b, c, d)    ((UInt32)(((UInt32)(a) << 24) | ((UInt32)(b) << 16) | ((UInt32)(c) << 8) | (UInt32)(d)))
+
+#define TARGET_RT_BIG_ENDIAN                0
+
+//==================================================================================================
+//	AudioHardwareBase.h
+//==================================================================================================
+
+typedef UInt32  AudioObjectID;
+typedef UInt32  AudioClassID;
+typedef UInt32  AudioObjectPropertySelector;
+typedef UInt32  AudioObjectPropertyScope;
+typedef UInt32  AudioObjectPropertyElement;
+
+typedef struct AudioObjectPropertyAddress
+{
+    AudioObjectPropertySelector mSelector;
+    AudioObjectPropertyScope    mScope;
+    AudioObjectPropertyElement  mElement;
+} AudioObjectPropertyAddress;
+
+enum
+{
+    kAudioHardwareNoError                       = 0,
+    kAudioHardwareNotRunningError               = VocanaHALShim_FourCC('s','t','o','p'),
+    kAudioHardwareNotStoppedError               = VocanaHALShim_FourCC('r','u','n','!'),
+    kAudioHardwareUnspecifiedError              = VocanaHALShim_FourCC('w','h','a','t'),
+    kAudioHardwareUnknownPropertyError          = VocanaHALShim_FourCC('w','h','o','?'),
+    kAudioHardwareBadPropertySizeError          = VocanaHALShim_FourCC('!','s','i','z'),
+    kAudioHardwareIllegalOperationError         = VocanaHALShim_FourCC('n','o','p','e'),
+    kAudioHardwareBadObjectError                = VocanaHALShim_FourCC('!','o','b','j'),
+    kAudioHardwareBadDeviceError                = VocanaHALShim_FourCC('!','d','e','v'),
+    kAudioHardwareBadStreamError                = VocanaHALShim_FourCC('!','s','t','r'),
+    kAudioHardwareUnsupportedOperationError     = VocanaHALShim_FourCC('u','n','o','p'),
+    kAudioDeviceUnsupportedFormatError          = VocanaHALShim_FourCC('!','d','a','t'),
+    kAudioDevicePermissionsError                = VocanaHALShim_FourCC('!','h','o','g')
+};
+
+enum
+{
+    kAudioObjectUnknown                         = 0,
+    kAudioObjectPlugInObject                    = 1
+};
+
+enum
+{
+    kAudioObjectPropertyScopeGlobal             = VocanaHALShim_FourCC('g','l','o','b'),
+    kAudioObjectPropertyScopeInput              = VocanaHALShim_FourCC('i','n','p','t'),
+    kAudioObjectPropertyScopeOutput             = VocanaHALShim_FourCC('o','u','t','p'),
+    kAudioObjectPropertyScopePlayThrough        = VocanaHALShim_FourCC('p','t','r','u'),
+    kAudioObjectPropertyElementMaster           = 0,
+    kAudioObjectPropertyElementMain             = 0
+};
+
+enum
+{
+    kAudioObjectClassID                         = VocanaHALShim_FourCC('a','o','b','j'),
+    kAudioPlugInClassID                         = VocanaHALShim_FourCC('a','p','l','g'),
+    kAudioTransportManagerClassID               = VocanaHALShim_FourCC('t','r','p','m'),
+    kAudioBoxClassID                            = VocanaHALShim_FourCC('a','b','o','x'),
+    kAudioDeviceClassID                         = VocanaHALShim_FourCC('a','d','e','v'),
+    kAudioStreamClassID                         = VocanaHALShim_FourCC('a','s','t','r'),
+    kAudioControlClassID                        = VocanaHALShim_FourCC('a','c','t','l'),
+    kAudioLevelControlClassID                   = VocanaHALShim_FourCC('l','e','v','l'),
+    kAudioVolumeControlClassID                  = VocanaHALShim_FourCC('v','l','m','e'),
+    kAudioBooleanControlClassID                 = VocanaHALShim_FourCC('t','o','g','l'),
+    kAudioMuteControlClassID                    = VocanaHALShim_FourCC('m','u','t','e'),
+    kAudioSelectorControlClassID                = VocanaHALShim_FourCC('s','l','c','t'),
+    kAudioClockSourceControlClassID             = VocanaHALShim_FourCC('c','l','c','k'),
+    kAudioDataSourceControlClassID              = VocanaHALShim_FourCC('d','s','r','c'),
+    kAudioStereoPanControlClassID               = VocanaHALShim_FourCC('s','p','a','n')
+};
+
+enum
+{
+    kAudioObjectPropertyBaseClass               = VocanaHALShim_FourCC('b','c','l','s'),
+    kAudioObjectPropertyClass                   = VocanaHALShim_FourCC('c','l','a','s'),
+    kAudioObjectPropertyOwner                   = VocanaHALShim_FourCC('s','t','d','v'),
+    kAudioObjectPropertyName                    = VocanaHALShim_FourCC('l','n','a','m'),
+    kAudioObjectPropertyModelName               = VocanaHALShim_FourCC('l','m','o','d'),
+    kAudioObjectPropertyManufacturer            = VocanaHALShim_FourCC('l','m','a','k'),
+    kAudioObjectPropertyElementName             = VocanaHALShim_FourCC('l','c','h','n'),
+    kAudioObjectPropertyOwnedObjects            = VocanaHALShim_FourCC('o','w','n','d'),
+    kAudioObjectPropertyIdentify                = VocanaHALShim_FourCC('i','d','e','n'),
+    kAudioObjectPropertySerialNumber            = VocanaHALShim_FourCC('s','n','u','m'),
+    kAudioObjectPropertyFirmwareVersion         = VocanaHALShim_FourCC('f','w','v','n'),
+    kAudioObjectPropertyCustomPropertyInfoList  = VocanaHALShim_FourCC('c','u','s','t'),
+    kAudioObjectPropertyControlList             = VocanaHALShim_FourCC('c','t','r','l')
+};
+
+enum
+{
+    kAudioPlugInPropertyBundleID                = VocanaHALShim_FourCC('p','i','i','d'),
+    kAudioPlugInPropertyDeviceList              = VocanaHALShim_FourCC('d','e','v','#'),
+    kAudioPlugInPropertyTranslateUIDToDevice    = VocanaHALShim_FourCC('u','i','d','d'),
+    kAudioPlugInPropertyBoxList                 = VocanaHALShim_FourCC('b','o','x','#'),
+    kAudioPlugInPropertyTranslateUIDToBox       = VocanaHALShim_FourCC('u','i','d','b'),
+    kAudioPlugInPropertyResourceBundle          = VocanaHALShim_FourCC('r','s','r','c')
+};
+
+enum
+{
+    kAudioBoxPropertyBoxUID                     = VocanaHALShim_FourCC('b','u','i','d'),
+    kAudioBoxPropertyTransportType              = VocanaHALShim_FourCC('t','r','a','n'),
+    kAudioBoxPropertyHasAudio                   = VocanaHALShim_FourCC('b','h','a','u'),
+    kAudioBoxPropertyHasVideo                   = VocanaHALShim_FourCC('b','h','v','i'),
+    kAudioBoxPropertyHasMIDI                    = VocanaHALShim_FourCC('b','h','m','i'),
+    kAudioBoxPropertyIsProtected                = VocanaHALShim_FourCC('b','p','r','o'),
+    kAudioBoxPropertyAcquired                   = VocanaHALShim_FourCC('b','x','o','n'),
+    kAudioBoxPropertyAcquisitionFailed          = VocanaHALShim_FourCC('b','x','o','f'),
+    kAudioBoxPropertyDeviceList                 = VocanaHALShim_FourCC('b','d','v','#')
+};
+
+enum
+{
+    kAudioDevicePropertyConfigurationApplication    = VocanaHALShim_FourCC('c','a','p','p'),
+    kAudioDevicePropertyDeviceUID                   = VocanaHALShim_FourCC('u','i','d',' '),
+    kAudioDevicePropertyModelUID                    = VocanaHALShim_FourCC('m','u','i','d'),
+    kAudioDevicePropertyTransportType               = VocanaHALShim_FourCC('t','r','a','n'),
+    kAudioDevicePropertyRelatedDevices              = VocanaHALShim_FourCC('a','k','i','n'),
+    kAudioDevicePropertyClockDomain                 = VocanaHALShim_FourCC('c','l','k','d'),
+    kAudioDevicePropertyDeviceIsAlive               = VocanaHALShim_FourCC('l','i','v','n'),
+    kAudioDevicePropertyDeviceIsRunning             = VocanaHALShim_FourCC('g','o','i','n'),
+    kAudioDevicePropertyDeviceCanBeDefaultDevice    = VocanaHALShim_FourCC('d','f','l','t'),
+    kAudioDevicePropertyDeviceCanBeDefaultSystemDevice = VocanaHALShim_FourCC('s','f','l','t'),
+    kAudioDevicePropertyLatency                     = VocanaHALShim_FourCC('l','t','n','c'),
+    kAudioDevicePropertyStreams                     = VocanaHALShim_FourCC('s','t','m','#'),
+    kAudioDevicePropertySafetyOffset                = VocanaHALShim_FourCC('s','a','f','t'),
+    kAudioDevicePropertyNominalSampleRate           = VocanaHALShim_FourCC('n','s','r','t'),
+    kAudioDevicePropertyAvailableNominalSampleRates = VocanaHALShim_FourCC('n','s','r','#'),
+    kAudioDevicePropertyIcon                        = VocanaHALShim_FourCC('i','c','o','n'),
+    kAudioDevicePropertyIsHidden                    = VocanaHALShim_FourCC('h','i','d','n'),
+    kAudioDevicePropertyPreferredChannelsForStereo  = VocanaHALShim_FourCC('d','c','h','2'),
+    kAudioDevicePropertyPreferredChannelLayout      = VocanaHALShim_FourCC('s','r','n','d'),
+    kAudioDevicePropertyZeroTimeStampPeriod         = VocanaHALShim_FourCC('r','i','n','g'),
+    kAudioDevicePropertyClockAlgorithm              = VocanaHALShim_FourCC('c','l','o','k'),
+    kAudioDevicePropertyClockIsStable               = VocanaHALShim_FourCC('c','s','t','b')
+};
+
+enum
+{
+    kAudioDeviceTransportTypeVirtual            = VocanaHALShim_FourCC('v','i','r','t')
+};
+
+enum
+{
+    kAudioStreamPropertyIsActive                = VocanaHALShim_FourCC('s','a','c','t'),
+    kAudioStreamPropertyDirection               = VocanaHALShim_FourCC('s','d','i','r'),
+    kAudioStreamPropertyTerminalType            = VocanaHALShim_FourCC('t','e','r','m'),
+    kAudioStreamPropertyStartingChannel         = VocanaHALShim_FourCC('s','c','h','n'),
+    kAudioStreamPropertyLatency                 = VocanaHALShim_FourCC('l','t','n','c'),
+    kAudioStreamPropertyVirtualFormat           = VocanaHALShim_FourCC('s','f','m','t'),
+    kAudioStreamPropertyAvailableVirtualFormats = VocanaHALShim_FourCC('s','f','m','a'),
+    kAudioStreamPropertyPhysicalFormat          = VocanaHALShim_FourCC('p','f','t',' '),
+    kAudioStreamPropertyAvailablePhysicalFormats = VocanaHALShim_FourCC('p','f','t','a')
+};
+
+enum
+{
+    kAudioStreamTerminalTypeMicrophone          = VocanaHALShim_FourCC('m','i','c','r'),
+    kAudioStreamTerminalTypeSpeaker             = VocanaHALShim_FourCC('s','p','k','r')
+};
+
+enum
+{
+    kAudioControlPropertyScope                  = VocanaHALShim_FourCC('c','s','c','p'),
+    kAudioControlPropertyElement                = VocanaHALShim_FourCC('c','e','l','m'),
+    kAudioLevelControlPropertyScalarValue       = VocanaHALShim_FourCC('l','c','s','v'),
+    kAudioLevelControlPropertyDecibelValue      = VocanaHALShim_FourCC('l','c','d','v'),
+    kAudioLevelControlPropertyDecibelRange      = VocanaHALShim_FourCC('l','c','d','r'),
+    kAudioLevelControlPropertyConvertScalarToDecibels = VocanaHALShim_FourCC('l','c','s','d'),
+    kAudioLevelControlPropertyConvertDecibelsToScalar = VocanaHALShim_FourCC('l','c','d','s'),
+    kAudioBooleanControlPropertyValue           = VocanaHALShim_FourCC('b','c','v','l'),
+    kAudioSelectorControlPropertyCurrentItem    = VocanaHALShim_FourCC('s','c','c','i'),
+    kAudioSelectorControlPropertyAvailableItems = VocanaHALShim_FourCC('s','c','a','i'),
+    kAudioSelectorControlPropertyItemName       = VocanaHALShim_FourCC('s','c','i','n'),
+    kAudioStereoPanControlPropertyValue         = VocanaHALShim_FourCC('s','p','c','v')
+};
+
+typedef struct AudioValueRange
+{
+    Float64 mMinimum;
+    Float64 mMaximum;
+} AudioValueRange;
+
+//==================================================================================================
+//	CoreAudioTypes.h
+//==================================================================================================
+
+typedef struct AudioStreamBasicDescription
+{
+    Float64 mSampleRate;
+    UInt32  mFormatID;
+    UInt32  mFormatFlags;
+    UInt32  mBytesPerPacket;
+    UInt32  mFramesPerPacket;
+    UInt32  mBytesPerFrame;
+    UInt32  mChannelsPerFrame;
+    UInt32  mBitsPerChannel;
+    UInt32  mReserved;
+} AudioStreamBasicDescription;
+
+typedef struct AudioStreamRangedDescription
+{
+    AudioStreamBasicDescription mFormat;
+    AudioValueRange             mSampleRateRange;
+} AudioStreamRangedDescription;
+
+enum
+{
+    kAudioFormatLinearPCM                       = VocanaHALShim_FourCC('l','p','c','m'),
+    kAudioFormatFlagIsFloat                     = (1U << 0),
+    kAudioFormatFlagIsBigEndian                 = (1U << 1),
+    kAudioFormatFlagIsSignedInteger             = (1U << 2),
+    kAudioFormatFlagIsPacked                    = (1U << 3),
+    kAudioFormatFlagIsNonInterleaved            = (1U << 5),
+    kAudioFormatFlagsNativeEndian               = 0
+};
+
+typedef struct AudioTimeStamp
+{
+    Float64 mSampleTime;
+    UInt64  mHostTime;
+    Float64 mRateScalar;
+    UInt64  mWordClockTime;
+    UInt32  mFlags;
+    UInt32  mReserved;
+} AudioTimeStamp;
+
+enum
+{
+    kAudioTimeStampSampleTimeValid              = (1U << 0),
+    kAudioTimeStampHostTimeValid                = (1U << 1),
+    kAudioTimeStampRateScalarValid              = (1U << 2)
+};
+
+typedef UInt32  AudioChannelLabel;
+typedef UInt32  AudioChannelLayoutTag;
+
+enum
+{
+    kAudioChannelLabel_Left                     = 1,
+    kAudioChannelLabel_Right                    = 2
+};
+
+enum
+{
+    kAudioChannelLayoutTag_UseChannelDescriptions   = (0U << 16) | 0
+};
+
+typedef struct AudioChannelDescription
+{
+    AudioChannelLabel   mChannelLabel;
+    UInt32              mChannelFlags;
+    Float32             mCoordinates[3];
+} AudioChannelDescription;
+
+typedef struct AudioChannelLayout
+{
+    AudioChannelLayoutTag   mChannelLayoutTag;
+    UInt32                  mChannelBitmap;
+    UInt32                  mNumberChannelDescriptions;
+    AudioChannelDescription mChannelDescriptions[1];
+} AudioChannelLayout;
+
+//==================================================================================================
+//	AudioServerPlugIn.h
+//==================================================================================================
+
+#define kAudioServerPlugInTypeUUID                  CFUUIDGetConstantUUIDWithBytes(NULL, 0x44, 0x3A, 0xBA, 0xB8, 0xE7, 0xB3, 0x49, 0x1A, 0xB9, 0x85, 0xBE, 0xB9, 0x18, 0x70, 0x30, 0xDB)
+#define kAudioServerPlugInDriverInterfaceUUID       CFUUIDGetConstantUUIDWithBytes(NULL, 0xEE, 0xA5, 0x77, 0x3D, 0xCC, 0x43, 0x49, 0xF1, 0x8E, 0x00, 0x8F, 0x96, 0xE7, 0xD2, 0x3B, 0x17)
+
+enum
+{
+    kAudioServerPlugInIOOperationThread         = VocanaHALShim_FourCC('t','h','r','d'),
+    kAudioServerPlugInIOOperationCycle          = VocanaHALShim_FourCC('c','y','c','l'),
+    kAudioServerPlugInIOOperationReadInput      = VocanaHALShim_FourCC('r','e','a','d'),
+    kAudioServerPlugInIOOperationConvertInput   = VocanaHALShim_FourCC('c','i','n','p'),
+    kAudioServerPlugInIOOperationProcessInput   = VocanaHALShim_FourCC('p','i','n','p'),
+    kAudioServerPlugInIOOperationProcessOutput  = VocanaHALShim_FourCC('p','o','u','t'),
+    kAudioServerPlugInIOOperationMixOutput      = VocanaHALShim_FourCC('m','i','x','o'),
+    kAudioServerPlugInIOOperationProcessMix     = VocanaHALShim_FourCC('p','m','i','x'),
+    kAudioServerPlugInIOOperationConvertMix     = VocanaHALShim_FourCC('c','m','i','x'),
+    kAudioServerPlugInIOOperationWriteMix       = VocanaHALShim_FourCC('r','i','t','e')
+};
+
+typedef struct AudioServerPlugInClientInfo
+{
+    UInt32      mClientID;
+    pid_t       mProcessID;
+    Boolean     mIsNativeEndian;
+    CFStringRef mBundleID;
+} AudioServerPlugInClientInfo;
+
+typedef UInt32  AudioServerPlugInCustomPropertyDataType;
+
+enum
+{
+    kAudioServerPlugInCustomPropertyDataTypeNone            = 0,
+    kAudioServerPlugInCustomPropertyDataTypeCFString        = VocanaHALShim_FourCC('c','f','s','t'),
+    kAudioServerPlugInCustomPropertyDataTypeCFPropertyList  = VocanaHALShim_FourCC('p','l','s','t')
+};
+
+typedef struct AudioServerPlugInCustomPropertyInfo
+{
+    AudioObjectPropertySelector                 mSelector;
+    AudioServerPlugInCustomPropertyDataType     mPropertyDataType;
+    AudioServerPlugInCustomPropertyDataType     mQualifierDataType;
+} AudioServerPlugInCustomPropertyInfo;
+
+typedef struct AudioServerPlugInIOCycleInfo
+{
+    UInt64          mIOCycleCounter;
+    UInt32          mNominalIOBufferFrameSize;
+    AudioTimeStamp  mCurrentTime;
+    AudioTimeStamp  mInputTime;
+    AudioTimeStamp  mOutputTime;
+    Float64         mDeviceHostTicksPerFrame;
+} AudioServerPlugInIOCycleInfo;
+
+typedef struct AudioServerPlugInHostInterface   AudioServerPlugInHostInterface;
+typedef const AudioServerPlugInHostInterface*   AudioServerPlugInHostRef;
+
+struct AudioServerPlugInHostInterface
+{
+    OSStatus    (*PropertiesChanged)(AudioServerPlugInHostRef inHost, AudioObjectID inObjectID, UInt32 inNumberAddresses, const AudioObjectPropertyAddress* inAddresses);
+    OSStatus    (*CopyFromStorage)(AudioServerPlugInHostRef inHost, CFStringRef inKey, CFPropertyListRef* outData);
+    OSStatus    (*WriteToStorage)(AudioServerPlugInHostRef inHost, CFStringRef inKey, CFPropertyListRef inData);
+    OSStatus    (*DeleteFromStorage)(AudioServerPlugInHostRef inHost, CFStringRef inKey);
+    OSStatus    (*RequestDeviceConfigurationChange)(AudioServerPlugInHostRef inHost, AudioObjectID inDeviceObjectID, UInt64 inChangeAction, void* inChangeInfo);
+};
+
+typedef struct AudioServerPlugInDriverInterface     AudioServerPlugInDriverInterface;
+typedef AudioServerPlugInDriverInterface**          AudioServerPlugInDriverRef;
+
+struct AudioServerPlugInDriverInterface
+{
+    void*       _reserved;
+    HRESULT     (*QueryInterface)(void* inDriver, REFIID inUUID, LPVOID* outInterface);
+    ULONG       (*AddRef)(void* inDriver);
+    ULONG       (*Release)(void* inDriver);
+    OSStatus    (*Initialize)(AudioServerPlugInDriverRef inDriver, AudioServerPlugInHostRef inHost);
+    OSStatus    (*CreateDevice)(AudioServerPlugInDriverRef inDriver, CFDictionaryRef inDescription, const AudioServerPlugInClientInfo* inClientInfo, AudioObjectID* outDeviceObjectID);
+    OSStatus    (*DestroyDevice)(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID);
+    OSStatus    (*AddDeviceClient)(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID, const AudioServerPlugInClientInfo* inClientInfo);
+    OSStatus    (*RemoveDeviceClient)(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID, const AudioServerPlugInClientInfo* inClientInfo);
+    OSStatus    (*PerformDeviceConfigurationChange)(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID, UInt64 inChangeAction, void* inChangeInfo);
+    OSStatus    (*AbortDeviceConfigurationChange)(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID, UInt64 inChangeAction, void* inChangeInfo);
+    Boolean     (*HasProperty)(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress);
+    OSStatus    (*IsPropertySettable)(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, Boolean* outIsSettable);
+    OSStatus    (*GetPropertyDataSize)(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32* outDataSize);
+    OSStatus    (*GetPropertyData)(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, UInt32* outDataSize, void* outData);
+    OSStatus    (*SetPropertyData)(AudioServerPlugInDriverRef inDriver, AudioObjectID inObjectID, pid_t inClientProcessID, const AudioObjectPropertyAddress* inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, const void* inData);
+    OSStatus    (*StartIO)(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID, UInt32 inClientID);
+    OSStatus    (*StopIO)(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID, UInt32 inClientID);
+    OSStatus    (*GetZeroTimeStamp)(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID, UInt32 inClientID, Float64* outSampleTime, UInt64* outHostTime, UInt64* outSeed);
+    OSStatus    (*WillDoIOOperation)(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID, UInt32 inClientID, UInt32 inOperationID, Boolean* outWillDo, Boolean* outWillDoInPlace);
+    OSStatus    (*BeginIOOperation)(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID, UInt32 inClientID, UInt32 inOperationID, UInt32 inIOBufferFrameSize, const AudioServerPlugInIOCycleInfo* inIOCycleInfo);
+    OSStatus    (*DoIOOperation)(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID, AudioObjectID inStreamObjectID, UInt32 inClientID, UInt32 inOperationID, UInt32 inIOBufferFrameSize, const AudioServerPlugInIOCycleInfo* inIOCycleInfo, void* ioMainBuffer, void* ioSecondaryBuffer);
+    OSStatus    (*EndIOOperation)(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID, UInt32 inClientID, UInt32 inOperationID, UInt32 inIOBufferFrameSize, const AudioServerPlugInIOCycleInfo* inIOCycleInfo);
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VocanaHALShim_AudioServerPlugIn_h */
@@ -0,0 +1,131 @@
+/*
+     File: CoreFoundation.h
+
+ Copyright (C) 2024 Vocana Inc.
+
+ HAL simulator shim: the small slice of CoreFoundation that VocanaVirtualDevice.c uses, so the
+ driver builds on hosts without the macOS SDK. Objects are minimal, reference counts are not
+ tracked and nothing is ever freed; see VocanaHALShim.c.
+
+ */
+
+#ifndef VocanaHALShim_CoreFoundation_h
+#define VocanaHALShim_CoreFoundation_h
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint8_t                     UInt8;
+typedef uint16_t                    UInt16;
+typedef uint32_t                    UInt32;
+typedef uint64_t                    UInt64;
+typedef int8_t                      SInt8;
+typedef int16_t                     SInt16;
+typedef int32_t                     SInt32;
+typedef int64_t                     SInt64;
+typedef float                       Float32;
+typedef double                      Float64;
+typedef unsigned char               Boolean;
+typedef SInt32                      OSStatus;
+
+typedef long                        CFIndex;
+typedef unsigned long               CFTypeID;
+typedef unsigned long               CFOptionFlags;
+typedef UInt32                      CFStringEncoding;
+
+typedef const void*                 CFTypeRef;
+typedef const void*                 CFPropertyListRef;
+typedef const struct __CFAllocator* CFAllocatorRef;
+typedef const struct __CFString*    CFStringRef;
+typedef const struct __CFUUID*      CFUUIDRef;
+typedef const struct __CFURL*       CFURLRef;
+typedef const struct __CFBoolean*   CFBooleanRef;
+typedef const struct __CFNumber*    CFNumberRef;
+typedef const struct __CFDictionary* CFDictionaryRef;
+typedef const struct __CFData*      CFDataRef;
+typedef struct __CFBundle*          CFBundleRef;
+
+typedef enum
+{
+    kCFCompareLessThan              = -1,
+    kCFCompareEqualTo               = 0,
+    kCFCompareGreaterThan           = 1
+} CFComparisonResult;
+
+enum
+{
+    kCFStringEncodingUTF8           = 0x08000100
+};
+
+typedef enum
+{
+    kCFNumberSInt32Type             = 3,
+    kCFNumberSInt64Type             = 4,
+    kCFNumberFloat64Type            = 6
+} CFNumberType;
+
+typedef struct
+{
+    UInt8   byte0, byte1, byte2, byte3, byte4, byte5, byte6, byte7;
+    UInt8   byte8, byte9, byte10, byte11, byte12, byte13, byte14, byte15;
+} CFUUIDBytes;
+
+extern const CFBooleanRef           kCFBooleanTrue;
+extern const CFBooleanRef           kCFBooleanFalse;
+
+CFStringRef     VocanaHALShim_MakeConstantString(const char* inCString);
+#define         CFSTR(inCString)    VocanaHALShim_MakeConstantString("" inCString "")
+
+CFTypeRef       CFRetain(CFTypeRef inObject);
+void            CFRelease(CFTypeRef inObject);
+Boolean         CFEqual(CFTypeRef inObject1, CFTypeRef inObject2);
+CFTypeID        CFGetTypeID(CFTypeRef inObject);
+
+CFTypeID        CFStringGetTypeID(void);
+CFStringRef     CFStringCreateWithCString(CFAllocatorRef inAllocator, const char* inCString, CFStringEncoding inEncoding);
+CFStringRef     CFStringCreateWithFormat(CFAllocatorRef inAllocator, CFDictionaryRef inFormatOptions, CFStringRef inFormat, ...);
+CFComparisonResult CFStringCompare(CFStringRef inString1, CFStringRef inString2, CFOptionFlags inOptions);
+const char*     VocanaHALShim_GetCString(CFStringRef inString);
+
+CFTypeID        CFBooleanGetTypeID(void);
+Boolean         CFBooleanGetValue(CFBooleanRef inBoolean);
+
+CFTypeID        CFNumberGetTypeID(void);
+CFNumberRef     CFNumberCreate(CFAllocatorRef inAllocator, CFNumberType inType, const void* inValue);
+Boolean         CFNumberGetValue(CFNumberRef inNumber, CFNumberType inType, void* outValue);
+
+CFTypeID        CFDataGetTypeID(void);
+CFDataRef       CFDataCreate(CFAllocatorRef inAllocator, const UInt8* inBytes, CFIndex inLength);
+CFIndex         CFDataGetLength(CFDataRef inData);
+const UInt8*    CFDataGetBytePtr(CFDataRef inData);
+
+CFUUIDRef       CFUUIDCreateFromUUIDBytes(CFAllocatorRef inAllocator, CFUUIDBytes inBytes);
+CFUUIDRef       CFUUIDGetConstantUUIDWithBytes(CFAllocatorRef inAllocator, UInt8 inByte0, UInt8 inByte1, UInt8 inByte2, UInt8 inByte3, UInt8 inByte4, UInt8 inByte5, UInt8 inByte6, UInt8 inByte7, UInt8 inByte8, UInt8 inByte9, UInt8 inByte10, UInt8 inByte11, UInt8 inByte12, UInt8 inByte13, UInt8 inByte14, UInt8 inByte15);
+
+//	There are no bundles in the simulator; all of these return NULL.
+CFBundleRef     CFBundleGetBundleWithIdentifier(CFStringRef inBundleID);
+CFURLRef        CFBundleCopyResourceURL(CFBundleRef inBundle, CFStringRef inResourceName, CFStringRef inResourceType, CFStringRef inSubDirName);
+CFTypeRef       CFBundleGetValueForInfoDictionaryKey(CFBundleRef inBundle, CFStringRef inKey);
+
+//	CFPlugInCOM.h
+typedef SInt32                      HRESULT;
+typedef UInt32                      ULONG;
+typedef void*                       LPVOID;
+typedef CFUUIDBytes                 REFIID;
+
+#define S_OK                        ((HRESULT)0x00000000L)
+#define E_NOINTERFACE               ((HRESULT)0x80000004L)
+
+#define IUnknownUUID                CFUUIDGetConstantUUIDWithBytes(NULL, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VocanaHALShim_CoreFoundation_h */
@@ -0,0 +1,49 @@
+/*
+     File: dispatch.h
+
+ Copyright (C) 2024 Vocana Inc.
+
+ HAL simulator shim: the function-pointer half of libdispatch that VocanaVirtualDevice.c uses.
+ Nothing runs on its own; queued work and source handlers run when the simulator drains them,
+ which keeps every run deterministic. See VocanaHALShim.c.
+
+ */
+
+#ifndef VocanaHALShim_dispatch_h
+#define VocanaHALShim_dispatch_h
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct VocanaHALShim_DispatchQueue*     dispatch_queue_t;
+typedef struct VocanaHALShim_DispatchSource*    dispatch_source_t;
+typedef const struct VocanaHALShim_SourceType*  dispatch_source_type_t;
+typedef uint64_t                                dispatch_time_t;
+typedef void                                    (*dispatch_function_t)(void* inContext);
+
+#define DISPATCH_QUEUE_PRIORITY_DEFAULT         0
+#define QOS_CLASS_UTILITY                       0x11
+
+extern const struct VocanaHALShim_SourceType    VocanaHALShim_SourceTypeMemoryPressure;
+#define DISPATCH_SOURCE_TYPE_MEMORYPRESSURE     (&VocanaHALShim_SourceTypeMemoryPressure)
+#define DISPATCH_MEMORYPRESSURE_NORMAL          0x01
+#define DISPATCH_MEMORYPRESSURE_WARN            0x02
+#define DISPATCH_MEMORYPRESSURE_CRITICAL        0x04
+
+dispatch_queue_t    dispatch_get_global_queue(long inIdentifier, unsigned long inFlags);
+dispatch_time_t     dispatch_time(dispatch_time_t inWhen, int64_t inDelta);
+void                dispatch_async_f(dispatch_queue_t inQueue, void* inContext, dispatch_function_t inWork);
+void                dispatch_after_f(dispatch_time_t inWhen, dispatch_queue_t inQueue, void* inContext, dispatch_function_t inWork);
+
+dispatch_source_t   dispatch_source_create(dispatch_source_type_t inType, uintptr_t inHandle, unsigned long inMask, dispatch_queue_t inQueue);
+void                dispatch_source_set_event_handler_f(dispatch_source_t inSource, dispatch_function_t inHandler);
+void                dispatch_resume(dispatch_source_t inSource);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VocanaHALShim_dispatch_h */
@@ -0,0 +1,35 @@
+/*
+     File: mach_time.h
+
+ Copyright (C) 2024 Vocana Inc.
+
+ HAL simulator shim: host time is a simulated clock in nanoseconds that only moves when the
+ simulator moves it. See VocanaHALShim.h.
+
+ */
+
+#ifndef VocanaHALShim_mach_time_h
+#define VocanaHALShim_mach_time_h
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct mach_timebase_info
+{
+    uint32_t    numer;
+    uint32_t    denom;
+};
+
+typedef struct mach_timebase_info*  mach_timebase_info_t;
+
+int         mach_timebase_info(mach_timebase_info_t outInfo);
+uint64_t    mach_absolute_time(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VocanaHALShim_mach_time_h */
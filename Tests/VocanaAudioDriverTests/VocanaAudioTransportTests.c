@@ -0,0 +1,365 @@
+/*
+     File: VocanaAudioTransportTests.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Host-side tests for VocanaAudioTransport: attaching, round trips, budgets, pipelined use, a
+ service process that dies, and a loopback latency benchmark against a service in another process.
+
+ */
+
+#include "VocanaAudioTransport.h"
+#include "VocanaDriverTestSupport.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define kTest_Channels          2
+#define kTest_MaxFrames         4096
+#define kTest_Slots             4
+#define kTest_Frames            512
+#define kTest_Budget            (10 * 1000000ull)
+#define kTest_ServiceTimeout    (200 * 1000000ull)
+
+static void test_fill_ramp(float* outFrames, uint32_t inFrameCount, float inStart)
+{
+    for(uint32_t i = 0; i < inFrameCount * kTest_Channels; i++)
+    {
+        outFrames[i] = inStart + (float)i;
+    }
+}
+
+//	The service end as a receiving process would see it: its own copies of the descriptors.
+static int test_attach_copy(const VocanaAudioTransport* inPlugIn, VocanaAudioTransport* outService)
+{
+    VocanaAudioTransportDescriptors theDescriptors;
+    VocanaAudioTransport_GetDescriptors(inPlugIn, &theDescriptors);
+    theDescriptors.memoryFD = dup(theDescriptors.memoryFD);
+    theDescriptors.requestBellFD = dup(theDescriptors.requestBellFD);
+    theDescriptors.replyBellFD = dup(theDescriptors.replyBellFD);
+    return VocanaAudioTransport_Attach(outService, &theDescriptors);
+}
+
+//	Replies to every request with its samples negated, until no request comes for a while.
+static void test_serve(VocanaAudioTransport* inService)
+{
+    static float sFrames[kTest_MaxFrames * kTest_Channels];
+    VocanaAudioTransportRequest theRequest;
+    while(VocanaAudioTransport_Receive(inService, &theRequest, sFrames, kTest_ServiceTimeout) == 0)
+    {
+        for(uint32_t i = 0; i < theRequest.frameCount * kTest_Channels; i++)
+        {
+            sFrames[i] = -sFrames[i];
+        }
+        VocanaAudioTransport_Reply(inService, &theRequest, sFrames);
+    }
+}
+
+static void* test_service_thread(void* inService)
+{
+    test_serve((VocanaAudioTransport*)inService);
+    return NULL;
+}
+
+static void test_attach(void)
+{
+    VocanaAudioTransport thePlugIn;
+    VocanaAudioTransport theService;
+    CHECK_EQUAL(VocanaAudioTransport_Create(&thePlugIn, kTest_Channels, kTest_MaxFrames, kTest_Slots), 0);
+    CHECK_EQUAL(test_attach_copy(&thePlugIn, &theService), 0);
+    CHECK_EQUAL(theService.channelCount, kTest_Channels);
+    CHECK_EQUAL(theService.maxFrames, kTest_MaxFrames);
+    CHECK_EQUAL(theService.slotCount, kTest_Slots);
+    CHECK_EQUAL(theService.regionBytes, thePlugIn.regionBytes);
+
+    //	each end only does its own half
+    float theFrames[kTest_Frames * kTest_Channels] = { 0 };
+    VocanaAudioTransportRequest theRequest = { 1, 0, kTest_Frames };
+    CHECK_EQUAL(VocanaAudioTransport_Process(&theService, 0, theFrames, kTest_Frames, 0), EBADF);
+    CHECK_EQUAL(VocanaAudioTransport_Reply(&thePlugIn, &theRequest, theFrames), EBADF);
+    CHECK_EQUAL(VocanaAudioTransport_Process(&thePlugIn, 0, theFrames, kTest_MaxFrames + 1, 0), EINVAL);
+
+    VocanaAudioTransport_Teardown(&theService);
+    VocanaAudioTransport_Teardown(&thePlugIn);
+
+    CHECK_EQUAL(VocanaAudioTransport_Create(&thePlugIn, kTest_Channels, kTest_MaxFrames, 3), EINVAL);
+    CHECK_EQUAL(VocanaAudioTransport_Create(&thePlugIn, 0, kTest_MaxFrames, kTest_Slots), EINVAL);
+}
+
+static void test_rejects_foreign_memory(void)
+{
+    VocanaAudioTransport thePlugIn;
+    VocanaAudioTransport theService;
+    CHECK_EQUAL(VocanaAudioTransport_Create(&thePlugIn, kTest_Channels, kTest_MaxFrames, kTest_Slots), 0);
+
+    //	a file of the right size that was never set up as a transport
+    FILE* theFile = tmpfile();
+    CHECK(theFile != NULL);
+    static const char sZeros[65536];
+    fwrite(sZeros, 1, sizeof(sZeros), theFile);
+    fflush(theFile);
+
+    VocanaAudioTransportDescriptors theDescriptors;
+    VocanaAudioTransport_GetDescriptors(&thePlugIn, &theDescriptors);
+    theDescriptors.memoryFD = dup(fileno(theFile));
+    theDescriptors.requestBellFD = dup(theDescriptors.requestBellFD);
+    theDescriptors.replyBellFD = dup(theDescriptors.replyBellFD);
+    CHECK_EQUAL(VocanaAudioTransport_Attach(&theService, &theDescriptors), EPROTO);
+    CHECK(theService.shared == NULL);
+    CHECK_EQUAL(theService.memoryFD, -1);
+
+    fclose(theFile);
+    VocanaAudioTransport_Teardown(&thePlugIn);
+}
+
+static void test_round_trip(void)
+{
+    VocanaAudioTransport thePlugIn;
+    VocanaAudioTransport theService;
+    CHECK_EQUAL(VocanaAudioTransport_Create(&thePlugIn, kTest_Channels, kTest_MaxFrames, kTest_Slots), 0);
+    CHECK_EQUAL(test_attach_copy(&thePlugIn, &theService), 0);
+
+    pthread_t theThread;
+    pthread_create(&theThread, NULL, test_service_thread, &theService);
+
+    //	more cycles than slots, with the frame count changing, so the rings wrap
+    float theFrames[kTest_MaxFrames * kTest_Channels];
+    bool isCorrect = true;
+    for(uint32_t theCycle = 0; theCycle < 64; theCycle++)
+    {
+        uint32_t theFrameCount = theCycle % 2 == 0 ? kTest_Frames : kTest_MaxFrames;
+        test_fill_ramp(theFrames, theFrameCount, (float)theCycle);
+        CHECK_EQUAL(VocanaAudioTransport_Process(&thePlugIn, theCycle * kTest_Frames, theFrames, theFrameCount, kTest_Budget), 0);
+        for(uint32_t i = 0; i < theFrameCount * kTest_Channels; i++)
+        {
+            isCorrect = isCorrect && theFrames[i] == -((float)theCycle + (float)i);
+        }
+    }
+    CHECK(isCorrect);
+
+    pthread_join(theThread, NULL);
+    VocanaAudioTransport_Teardown(&theService);
+    VocanaAudioTransport_Teardown(&thePlugIn);
+}
+
+static void test_budget(void)
+{
+    VocanaAudioTransport thePlugIn;
+    VocanaAudioTransport theService;
+    CHECK_EQUAL(VocanaAudioTransport_Create(&thePlugIn, kTest_Channels, kTest_MaxFrames, kTest_Slots), 0);
+    CHECK_EQUAL(test_attach_copy(&thePlugIn, &theService), 0);
+
+    //	nobody is serving: the cycle waits out its budget and goes out untouched
+    float theFrames[kTest_Frames * kTest_Channels];
+    test_fill_ramp(theFrames, kTest_Frames, 1.0f);
+    double theStart = test_now_seconds();
+    CHECK_EQUAL(VocanaAudioTransport_Process(&thePlugIn, 0, theFrames, kTest_Frames, 2000000), ETIMEDOUT);
+    double theElapsed = test_now_seconds() - theStart;
+    CHECK(theElapsed >= 0.002 && theElapsed < 0.050);
+    CHECK_EQUAL(theFrames[1], 2.0f);
+
+    //	once the request queue is full the plug-in doesn't wait at all
+    for(uint32_t i = 1; i < kTest_Slots; i++)
+    {
+        CHECK_EQUAL(VocanaAudioTransport_Process(&thePlugIn, i, theFrames, kTest_Frames, 0), ETIMEDOUT);
+    }
+    theStart = test_now_seconds();
+    CHECK_EQUAL(VocanaAudioTransport_Process(&thePlugIn, kTest_Slots, theFrames, kTest_Frames, kTest_Budget), EAGAIN);
+    CHECK(test_now_seconds() - theStart < 0.002);
+
+    //	the service catches up; its late replies are dropped and the next cycle gets its own
+    float theServiceFrames[kTest_MaxFrames * kTest_Channels];
+    VocanaAudioTransportRequest theRequest;
+    for(uint32_t i = 0; i < kTest_Slots; i++)
+    {
+        CHECK_EQUAL(VocanaAudioTransport_Receive(&theService, &theRequest, theServiceFrames, 0), 0);
+        CHECK_EQUAL(theRequest.sampleTime, i);
+        CHECK_EQUAL(VocanaAudioTransport_Reply(&theService, &theRequest, theServiceFrames), 0);
+    }
+    CHECK_EQUAL(VocanaAudioTransport_Receive(&theService, &theRequest, theServiceFrames, 1000000), ETIMEDOUT);
+
+    pthread_t theThread;
+    pthread_create(&theThread, NULL, test_service_thread, &theService);
+    test_fill_ramp(theFrames, kTest_Frames, 1.0f);
+    CHECK_EQUAL(VocanaAudioTransport_Process(&thePlugIn, 100, theFrames, kTest_Frames, kTest_Budget), 0);
+    CHECK_EQUAL(theFrames[1], -2.0f);
+
+    pthread_join(theThread, NULL);
+    VocanaAudioTransport_Teardown(&theService);
+    VocanaAudioTransport_Teardown(&thePlugIn);
+}
+
+static void test_pipelined(void)
+{
+    VocanaAudioTransport thePlugIn;
+    VocanaAudioTransport theService;
+    CHECK_EQUAL(VocanaAudioTransport_Create(&thePlugIn, kTest_Channels, kTest_MaxFrames, kTest_Slots), 0);
+    CHECK_EQUAL(test_attach_copy(&thePlugIn, &theService), 0);
+
+    //	the plug-in sends cycles without waiting until the queue is full
+    float theFrames[kTest_Frames * kTest_Channels];
+    VocanaAudioTransportRequest theReply;
+    const float* theReplyFrames = NULL;
+    for(uint32_t i = 0; i < kTest_Slots; i++)
+    {
+        test_fill_ramp(theFrames, kTest_Frames, (float)i);
+        CHECK_EQUAL(VocanaAudioTransport_Submit(&thePlugIn, (uint64_t)i * kTest_Frames, theFrames, kTest_Frames), 0);
+    }
+    CHECK_EQUAL(VocanaAudioTransport_Submit(&thePlugIn, (uint64_t)kTest_Slots * kTest_Frames, theFrames, kTest_Frames), EAGAIN);
+    CHECK(!VocanaAudioTransport_PeekReply(&thePlugIn, &theReply, &theReplyFrames));
+
+    pthread_t theThread;
+    pthread_create(&theThread, NULL, test_service_thread, &theService);
+
+    //	and picks the replies up in order as they arrive
+    double theDeadline = test_now_seconds() + 1.0;
+    uint32_t theReceived = 0;
+    bool isCorrect = true;
+    while(theReceived < kTest_Slots && test_now_seconds() < theDeadline)
+    {
+        if(!VocanaAudioTransport_PeekReply(&thePlugIn, &theReply, &theReplyFrames))
+        {
+            usleep(100);
+            continue;
+        }
+        isCorrect = isCorrect && theReply.sampleTime == (uint64_t)theReceived * kTest_Frames && theReply.frameCount == kTest_Frames;
+        isCorrect = isCorrect && theReplyFrames[3] == -((float)theReceived + 3.0f);
+        VocanaAudioTransport_ReleaseReply(&thePlugIn);
+        theReceived++;
+    }
+    CHECK_EQUAL(theReceived, kTest_Slots);
+    CHECK(isCorrect);
+
+    pthread_join(theThread, NULL);
+    VocanaAudioTransport_Teardown(&theService);
+    VocanaAudioTransport_Teardown(&thePlugIn);
+}
+
+//	A service process killed while it sleeps on its doorbell: the plug-in's next ring goes to a
+//	closed socket, which must not raise SIGPIPE, and both ways of using the transport report EPIPE
+//	rather than a missed deadline.
+static void test_dead_service(void)
+{
+    VocanaAudioTransport thePlugIn;
+    CHECK_EQUAL(VocanaAudioTransport_Create(&thePlugIn, kTest_Channels, kTest_MaxFrames, kTest_Slots), 0);
+
+    fflush(stdout);
+    pid_t theChild = fork();
+    if(theChild == 0)
+    {
+        VocanaAudioTransport theService;
+        if(test_attach_copy(&thePlugIn, &theService) != 0)
+        {
+            _exit(1);
+        }
+        test_serve(&theService);
+        _exit(0);
+    }
+    CHECK(theChild > 0);
+    VocanaAudioTransport_CloseServiceDescriptors(&thePlugIn);
+
+    float theFrames[kTest_Frames * kTest_Channels];
+    test_fill_ramp(theFrames, kTest_Frames, 0.0f);
+    CHECK_EQUAL(VocanaAudioTransport_Process(&thePlugIn, 0, theFrames, kTest_Frames, kTest_Budget), 0);
+
+    //	let the service go back to sleep before it dies
+    usleep(20000);
+    kill(theChild, SIGKILL);
+    waitpid(theChild, NULL, 0);
+
+    double theStart = test_now_seconds();
+    CHECK_EQUAL(VocanaAudioTransport_Process(&thePlugIn, (uint64_t)kTest_Frames, theFrames, kTest_Frames, kTest_Budget), EPIPE);
+    CHECK(test_now_seconds() - theStart < kTest_Budget * 1.0e-9);
+
+    int theError = 0;
+    for(uint32_t i = 0; i <= kTest_Slots && theError == 0; i++)
+    {
+        theError = VocanaAudioTransport_Submit(&thePlugIn, (uint64_t)(i + 2) * kTest_Frames, theFrames, kTest_Frames);
+    }
+    CHECK_EQUAL(theError, EPIPE);
+    VocanaAudioTransport_Teardown(&thePlugIn);
+}
+
+static int test_compare_doubles(const void* inA, const void* inB)
+{
+    double theA = *(const double*)inA;
+    double theB = *(const double*)inB;
+    return (theA > theB) - (theA < theB);
+}
+
+//	Runs inCycles 512-frame cycles against the service, inGap seconds apart, and reports the
+//	median and 99th percentile round trip. Returns the median.
+static double test_measure(VocanaAudioTransport* inPlugIn, uint32_t inCycles, double inGap, const char* inLabel)
+{
+    static double sLatencies[5000];
+    float theFrames[kTest_Frames * kTest_Channels];
+    uint32_t theFailures = 0;
+    for(uint32_t theCycle = 0; theCycle < inCycles; theCycle++)
+    {
+        test_fill_ramp(theFrames, kTest_Frames, (float)theCycle);
+        double theStart = test_now_seconds();
+        theFailures += VocanaAudioTransport_Process(inPlugIn, (uint64_t)theCycle * kTest_Frames, theFrames, kTest_Frames, kTest_Budget) != 0;
+        sLatencies[theCycle] = test_now_seconds() - theStart;
+        if(inGap > 0)
+        {
+            usleep((useconds_t)(inGap * 1.0e6));
+        }
+    }
+    CHECK_EQUAL(theFailures, 0);
+
+    qsort(sLatencies, inCycles, sizeof(double), test_compare_doubles);
+    double theMedian = sLatencies[inCycles / 2];
+    printf("    %-13s %u cycles of %u frames: median %.1f us, p99 %.1f us, max %.1f us\n", inLabel, inCycles, kTest_Frames,
+           theMedian * 1.0e6, sLatencies[inCycles * 99 / 100] * 1.0e6, sLatencies[inCycles - 1] * 1.0e6);
+    return theMedian;
+}
+
+//	The service runs in its own process, as it does for real. Paced cycles leave the service
+//	asleep on its doorbell between requests, the way the IO thread's 10 ms cycles do; back to back
+//	cycles find it still awake.
+static void test_loopback_latency(void)
+{
+    VocanaAudioTransport thePlugIn;
+    CHECK_EQUAL(VocanaAudioTransport_Create(&thePlugIn, kTest_Channels, kTest_MaxFrames, kTest_Slots), 0);
+
+    fflush(stdout);
+    pid_t theChild = fork();
+    if(theChild == 0)
+    {
+        VocanaAudioTransport theService;
+        if(test_attach_copy(&thePlugIn, &theService) != 0)
+        {
+            _exit(1);
+        }
+        test_serve(&theService);
+        _exit(0);
+    }
+    CHECK(theChild > 0);
+
+    double thePacedMedian = test_measure(&thePlugIn, 500, 0.001, "paced:");
+    double theBackToBackMedian = test_measure(&thePlugIn, 5000, 0.0, "back to back:");
+    CHECK(thePacedMedian < 100.0e-6);
+    CHECK(theBackToBackMedian < 100.0e-6);
+
+    int theStatus = 0;
+    waitpid(theChild, &theStatus, 0);
+    CHECK(WIFEXITED(theStatus) && WEXITSTATUS(theStatus) == 0);
+    VocanaAudioTransport_Teardown(&thePlugIn);
+}
+
+int main(void)
+{
+    RUN_TEST(test_attach);
+    RUN_TEST(test_rejects_foreign_memory);
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_budget);
+    RUN_TEST(test_pipelined);
+    RUN_TEST(test_dead_service);
+    RUN_TEST(test_loopback_latency);
+    return TEST_RESULT();
+}
@@ -0,0 +1,225 @@
+/*
+     File: VocanaChannelsTests.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Host-side tests for VocanaChannels: deinterleaving and interleaving every channel of every
+ supported layout, in place and with unaligned buffers, and that they are no slower than the plain
+ loop.
+
+ */
+
+#include "VocanaChannels.h"
+#include "VocanaDriverTestSupport.h"
+
+#include <string.h>
+
+#define kTest_MaxFrames         517     //	not a multiple of the vector width
+#define kTest_BenchFrames       512
+#define kTest_BenchPasses       20000
+#define kTest_BenchTrials       5
+
+static float test_sample(uint32_t inFrame, uint32_t inChannel)
+{
+    return (float)inFrame + (float)inChannel / 32.0f;
+}
+
+static void test_fill(float* outFrames, uint32_t inChannelCount, uint32_t inFrameCount)
+{
+    for(uint32_t i = 0; i < inFrameCount; i++)
+    {
+        for(uint32_t c = 0; c < inChannelCount; c++)
+        {
+            outFrames[(size_t)i * inChannelCount + c] = test_sample(i, c);
+        }
+    }
+}
+
+static void test_valid_counts(void)
+{
+    CHECK(!VocanaChannels_IsValidCount(0));
+    CHECK(VocanaChannels_IsValidCount(1));
+    CHECK(VocanaChannels_IsValidCount(8));
+    CHECK(VocanaChannels_IsValidCount(kVocanaChannels_MaxChannels));
+    CHECK(!VocanaChannels_IsValidCount(kVocanaChannels_MaxChannels + 1));
+}
+
+static void test_deinterleave_every_layout(void)
+{
+    //	one float of padding in front, so the kernels also see buffers that aren't 16-byte aligned
+    static float sFrames[1 + kTest_MaxFrames * kVocanaChannels_MaxChannels];
+    static float sSamples[1 + kTest_MaxFrames];
+    uint64_t theMismatches = 0;
+    for(uint32_t theOffset = 0; theOffset < 2; theOffset++)
+    {
+        float* theFrames = sFrames + theOffset;
+        float* theSamples = sSamples + theOffset;
+        for(uint32_t theChannels = 1; theChannels <= kVocanaChannels_MaxChannels; theChannels++)
+        {
+            test_fill(theFrames, theChannels, kTest_MaxFrames);
+            for(uint32_t c = 0; c < theChannels; c++)
+            {
+                for(uint32_t theCount = kTest_MaxFrames - 5; theCount <= kTest_MaxFrames; theCount++)
+                {
+                    memset(sSamples, 0, sizeof(sSamples));
+                    VocanaChannels_Deinterleave(theFrames, theChannels, c, theSamples, theCount);
+                    for(uint32_t i = 0; i < theCount; i++)
+                    {
+                        theMismatches += theSamples[i] != test_sample(i, c);
+                    }
+                }
+            }
+        }
+    }
+    CHECK_EQUAL(theMismatches, 0);
+}
+
+static void test_interleave_every_layout(void)
+{
+    static float sFrames[1 + kTest_MaxFrames * kVocanaChannels_MaxChannels];
+    static float sSamples[1 + kTest_MaxFrames];
+    uint64_t theMismatches = 0;
+    for(uint32_t theOffset = 0; theOffset < 2; theOffset++)
+    {
+        float* theFrames = sFrames + theOffset;
+        float* theSamples = sSamples + theOffset;
+        for(uint32_t theChannels = 1; theChannels <= kVocanaChannels_MaxChannels; theChannels++)
+        {
+            for(uint32_t c = 0; c < theChannels; c++)
+            {
+                for(uint32_t theCount = kTest_MaxFrames - 5; theCount <= kTest_MaxFrames; theCount++)
+                {
+                    test_fill(theFrames, theChannels, kTest_MaxFrames);
+                    for(uint32_t i = 0; i < theCount; i++)
+                    {
+                        theSamples[i] = -1.0f - (float)i;
+                    }
+                    VocanaChannels_Interleave(theSamples, theFrames, theChannels, c, theCount);
+
+                    //	only the one channel of the first theCount frames changed
+                    for(uint32_t i = 0; i < kTest_MaxFrames; i++)
+                    {
+                        for(uint32_t o = 0; o < theChannels; o++)
+                        {
+                            float theExpected = (o == c && i < theCount) ? -1.0f - (float)i : test_sample(i, o);
+                            theMismatches += theFrames[(size_t)i * theChannels + o] != theExpected;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    CHECK_EQUAL(theMismatches, 0);
+}
+
+static void test_round_trip_in_place(void)
+{
+    //	taking every channel out and putting it back, the way the denoiser does, changes nothing
+    float theFrames[kTest_MaxFrames * 8];
+    float theExpected[kTest_MaxFrames * 8];
+    float theSamples[kTest_MaxFrames];
+    test_fill(theFrames, 8, kTest_MaxFrames);
+    memcpy(theExpected, theFrames, sizeof(theFrames));
+    for(uint32_t c = 0; c < 8; c++)
+    {
+        VocanaChannels_Deinterleave(theFrames, 8, c, theSamples, kTest_MaxFrames);
+        VocanaChannels_Interleave(theSamples, theFrames, 8, c, kTest_MaxFrames);
+    }
+    CHECK(memcmp(theFrames, theExpected, sizeof(theFrames)) == 0);
+}
+
+//	The strided loops the kernels replace, kept out of line so the compiler can't fold them into
+//	the benchmark.
+static void __attribute__((noinline)) test_plain_deinterleave(const float* inFrames, uint32_t inChannelCount, uint32_t inChannel, float* outSamples, uint32_t inFrameCount)
+{
+    for(uint32_t i = 0; i < inFrameCount; i++)
+    {
+        outSamples[i] = inFrames[(size_t)i * inChannelCount + inChannel];
+    }
+}
+
+static void __attribute__((noinline)) test_plain_interleave(const float* inSamples, float* ioFrames, uint32_t inChannelCount, uint32_t inChannel, uint32_t inFrameCount)
+{
+    for(uint32_t i = 0; i < inFrameCount; i++)
+    {
+        ioFrames[(size_t)i * inChannelCount + inChannel] = inSamples[i];
+    }
+}
+
+typedef void (*TestDeinterleaveProc)(const float*, uint32_t, uint32_t, float*, uint32_t);
+typedef void (*TestInterleaveProc)(const float*, float*, uint32_t, uint32_t, uint32_t);
+
+static float sBenchFrames[kTest_BenchFrames * kVocanaChannels_MaxChannels];
+static float sBenchSamples[kTest_BenchFrames];
+
+//	ns per frame, the best of a few trials so a busy machine doesn't decide the comparison
+static double test_time_deinterleave(TestDeinterleaveProc inProc, uint32_t inChannelCount)
+{
+    double theBest = 0.0;
+    for(uint32_t theTrial = 0; theTrial < kTest_BenchTrials; theTrial++)
+    {
+        double theStart = test_now_seconds();
+        for(uint32_t thePass = 0; thePass < kTest_BenchPasses; thePass++)
+        {
+            inProc(sBenchFrames, inChannelCount, thePass % inChannelCount, sBenchSamples, kTest_BenchFrames);
+        }
+        double theTime = (test_now_seconds() - theStart) * 1.0e9 / ((double)kTest_BenchPasses * kTest_BenchFrames);
+        theBest = (theTrial == 0 || theTime < theBest) ? theTime : theBest;
+    }
+    return theBest;
+}
+
+static double test_time_interleave(TestInterleaveProc inProc, uint32_t inChannelCount)
+{
+    double theBest = 0.0;
+    for(uint32_t theTrial = 0; theTrial < kTest_BenchTrials; theTrial++)
+    {
+        double theStart = test_now_seconds();
+        for(uint32_t thePass = 0; thePass < kTest_BenchPasses; thePass++)
+        {
+            inProc(sBenchSamples, sBenchFrames, inChannelCount, thePass % inChannelCount, kTest_BenchFrames);
+        }
+        double theTime = (test_now_seconds() - theStart) * 1.0e9 / ((double)kTest_BenchPasses * kTest_BenchFrames);
+        theBest = (theTrial == 0 || theTime < theBest) ? theTime : theBest;
+    }
+    return theBest;
+}
+
+static void test_cost(void)
+{
+    //	the kernels against the plain strided loop, each way, for the common layouts; where there
+    //	are vector kernels they must not be the slower of the two
+    static const uint32_t kLayouts[] = { 2, 4, 8 };
+    for(uint32_t l = 0; l < sizeof(kLayouts) / sizeof(kLayouts[0]); l++)
+    {
+        uint32_t theChannels = kLayouts[l];
+        test_fill(sBenchFrames, theChannels, kTest_BenchFrames);
+
+        double theDeinterleave = test_time_deinterleave(VocanaChannels_Deinterleave, theChannels);
+        double thePlainDeinterleave = test_time_deinterleave(test_plain_deinterleave, theChannels);
+        for(uint32_t i = 0; i < kTest_BenchFrames; i++)
+        {
+            sBenchSamples[i] = test_sample(i, 0);
+        }
+        double theInterleave = test_time_interleave(VocanaChannels_Interleave, theChannels);
+        double thePlainInterleave = test_time_interleave(test_plain_interleave, theChannels);
+
+        printf("    %2u channels: deinterleave %.2f ns per frame (plain loop %.2f), interleave %.2f (plain loop %.2f)\n", (unsigned)theChannels,
+               theDeinterleave, thePlainDeinterleave, theInterleave, thePlainInterleave);
+        CHECK(sBenchFrames[theChannels] == test_sample(1, 0));
+#if defined(__ARM_NEON) || defined(__SSE2__)
+        CHECK(theDeinterleave <= thePlainDeinterleave);
+        CHECK(theInterleave <= thePlainInterleave);
+#endif
+    }
+}
+
+int main(void)
+{
+    RUN_TEST(test_valid_counts);
+    RUN_TEST(test_deinterleave_every_layout);
+    RUN_TEST(test_interleave_every_layout);
+    RUN_TEST(test_round_trip_in_place);
+    RUN_TEST(test_cost);
+    return TEST_RESULT();
+}
@@ -0,0 +1,240 @@
+/*
+     File: VocanaClientScratchTests.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Host-side tests for VocanaClientScratch: claiming and releasing client areas, the device area
+ clients without one fall back on, and several IO threads changing their buffer sizes every cycle
+ while clients come and go.
+
+ */
+
+#include "VocanaClientScratch.h"
+#include "VocanaDriverTestSupport.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <string.h>
+
+#define kTest_MaxFrames         4096
+#define kTest_Channels          2
+#define kTest_IOThreads         8
+#define kTest_Cycles            4000
+
+static void test_clients(void)
+{
+    VocanaClientScratch theScratch;
+    CHECK_EQUAL(VocanaClientScratch_Init(&theScratch, kTest_MaxFrames, kTest_Channels), 0);
+
+    float* theInput = NULL;
+    float* theOutput = NULL;
+    CHECK(!VocanaClientScratch_Find(&theScratch, 7, &theInput, &theOutput));
+
+    //	every client up to the limit gets its own cache-aligned buffers
+    for(uint32_t i = 0; i < kVocanaClientScratch_MaxClients; i++)
+    {
+        CHECK(VocanaClientScratch_AddClient(&theScratch, 100 + i));
+    }
+    CHECK(!VocanaClientScratch_AddClient(&theScratch, 7));
+    CHECK(VocanaClientScratch_AddClient(&theScratch, 100));
+
+    float* thePreviousOutput = NULL;
+    for(uint32_t i = 0; i < kVocanaClientScratch_MaxClients; i++)
+    {
+        CHECK(VocanaClientScratch_Find(&theScratch, 100 + i, &theInput, &theOutput));
+        CHECK_EQUAL((uintptr_t)theInput % kVocanaClientScratch_Alignment, 0);
+        CHECK(theOutput >= theInput + kTest_MaxFrames * kTest_Channels);
+        CHECK(thePreviousOutput == NULL || theInput >= thePreviousOutput + kTest_MaxFrames * kTest_Channels);
+        thePreviousOutput = theOutput;
+    }
+
+    //	a released area goes to the next client
+    VocanaClientScratch_RemoveClient(&theScratch, 105);
+    CHECK(!VocanaClientScratch_Find(&theScratch, 105, &theInput, &theOutput));
+    CHECK(VocanaClientScratch_AddClient(&theScratch, 7));
+    CHECK(VocanaClientScratch_Find(&theScratch, 7, &theInput, &theOutput));
+
+    VocanaClientScratch_Teardown(&theScratch);
+    CHECK(!VocanaClientScratch_Find(&theScratch, 7, &theInput, &theOutput));
+}
+
+static void test_device_area(void)
+{
+    VocanaClientScratch theScratch;
+    CHECK_EQUAL(VocanaClientScratch_Init(&theScratch, kTest_MaxFrames, kTest_Channels), 0);
+    for(uint32_t i = 0; i < kVocanaClientScratch_MaxClients; i++)
+    {
+        CHECK(VocanaClientScratch_AddClient(&theScratch, 100 + i));
+    }
+
+    //	the device area follows every client's, so a client without an area writing all of it
+    //	leaves the others alone
+    float* theDeviceInput = NULL;
+    float* theDeviceOutput = NULL;
+    VocanaClientScratch_GetDeviceArea(&theScratch, &theDeviceInput, &theDeviceOutput);
+    CHECK_EQUAL((uintptr_t)theDeviceInput % kVocanaClientScratch_Alignment, 0);
+    CHECK(theDeviceOutput >= theDeviceInput + kTest_MaxFrames * kTest_Channels);
+    for(uint32_t i = 0; i < kVocanaClientScratch_MaxClients; i++)
+    {
+        float* theInput;
+        float* theOutput;
+        CHECK(VocanaClientScratch_Find(&theScratch, 100 + i, &theInput, &theOutput));
+        CHECK(theDeviceInput >= theOutput + kTest_MaxFrames * kTest_Channels);
+        memset(theOutput, 0, kTest_MaxFrames * kTest_Channels * sizeof(float));
+    }
+    for(uint32_t i = 0; i < kTest_MaxFrames * kTest_Channels; i++)
+    {
+        theDeviceInput[i] = 1.0f;
+        theDeviceOutput[i] = -1.0f;
+    }
+
+    float* theInput;
+    float* theOutput;
+    CHECK(VocanaClientScratch_Find(&theScratch, 100 + kVocanaClientScratch_MaxClients - 1, &theInput, &theOutput));
+    CHECK_EQUAL(theOutput[kTest_MaxFrames * kTest_Channels - 1], 0.0f);
+    CHECK(!VocanaClientScratch_Find(&theScratch, 7, &theInput, &theOutput));
+
+    VocanaClientScratch_Teardown(&theScratch);
+}
+
+typedef struct TestIOThread
+{
+    VocanaClientScratch*    scratch;
+    uint32_t                clientID;
+    uint32_t                failures;
+    uint64_t                framesMoved;
+} TestIOThread;
+
+//	Plays one client's IO thread: a different buffer size every cycle, each buffer stamped with a
+//	value only this client and cycle would write, and checked again after yielding to the others.
+static void* test_io_thread(void* inContext)
+{
+    TestIOThread* theThread = (TestIOThread*)inContext;
+    float* theFirstInput = NULL;
+    uint32_t theSeed = theThread->clientID;
+    for(uint32_t theCycle = 0; theCycle < kTest_Cycles; theCycle++)
+    {
+        theSeed = theSeed * 1103515245u + 12345u;
+        uint32_t theFrames = 1 + (theSeed >> 8) % kTest_MaxFrames;
+        size_t theSamples = (size_t)theFrames * kTest_Channels;
+
+        float* theInput;
+        float* theOutput;
+        if(!VocanaClientScratch_Find(theThread->scratch, theThread->clientID, &theInput, &theOutput))
+        {
+            theThread->failures++;
+            continue;
+        }
+        if(theFirstInput == NULL)
+        {
+            theFirstInput = theInput;
+        }
+        theThread->failures += theInput != theFirstInput;
+
+        float theStamp = (float)(theThread->clientID * 10000 + theCycle % 10000);
+        for(size_t i = 0; i < theSamples; i++)
+        {
+            theInput[i] = theStamp;
+            theOutput[i] = -theStamp;
+        }
+        sched_yield();
+        for(size_t i = 0; i < theSamples; i++)
+        {
+            theThread->failures += theInput[i] != theStamp || theOutput[i] != -theStamp;
+        }
+        theThread->framesMoved += theFrames;
+    }
+    return NULL;
+}
+
+typedef struct TestChurnThread
+{
+    VocanaClientScratch*    scratch;
+    _Atomic bool            stop;
+    uint32_t                failures;
+    uint64_t                churns;
+} TestChurnThread;
+
+//	Clients coming and going in the spare areas while the IO threads run.
+static void* test_churn_thread(void* inContext)
+{
+    TestChurnThread* theThread = (TestChurnThread*)inContext;
+    uint32_t theClientID = 1000;
+    while(!atomic_load_explicit(&theThread->stop, memory_order_relaxed))
+    {
+        float* theInput;
+        float* theOutput;
+        if(!VocanaClientScratch_AddClient(theThread->scratch, theClientID) || !VocanaClientScratch_Find(theThread->scratch, theClientID, &theInput, &theOutput))
+        {
+            theThread->failures++;
+            break;
+        }
+        theInput[0] = -1.0f;
+        theOutput[kTest_MaxFrames * kTest_Channels - 1] = -1.0f;
+        VocanaClientScratch_RemoveClient(theThread->scratch, theClientID);
+        theThread->failures += VocanaClientScratch_Find(theThread->scratch, theClientID, &theInput, &theOutput);
+        theClientID = theClientID == 1999 ? 1000 : theClientID + 1;
+        theThread->churns++;
+    }
+    return NULL;
+}
+
+static void test_concurrent_io_with_varying_sizes(void)
+{
+    VocanaClientScratch theScratch;
+    CHECK_EQUAL(VocanaClientScratch_Init(&theScratch, kTest_MaxFrames, kTest_Channels), 0);
+
+    TestIOThread theIOThreads[kTest_IOThreads];
+    pthread_t theIOHandles[kTest_IOThreads];
+    for(uint32_t i = 0; i < kTest_IOThreads; i++)
+    {
+        theIOThreads[i] = (TestIOThread){ &theScratch, 1 + i, 0, 0 };
+        CHECK(VocanaClientScratch_AddClient(&theScratch, theIOThreads[i].clientID));
+    }
+
+    TestChurnThread theChurn = { .scratch = &theScratch, .failures = 0, .churns = 0 };
+    atomic_init(&theChurn.stop, false);
+    pthread_t theChurnHandle;
+    pthread_create(&theChurnHandle, NULL, test_churn_thread, &theChurn);
+
+    double theStart = test_now_seconds();
+    for(uint32_t i = 0; i < kTest_IOThreads; i++)
+    {
+        pthread_create(&theIOHandles[i], NULL, test_io_thread, &theIOThreads[i]);
+    }
+    uint64_t theFrames = 0;
+    for(uint32_t i = 0; i < kTest_IOThreads; i++)
+    {
+        pthread_join(theIOHandles[i], NULL);
+        CHECK_EQUAL(theIOThreads[i].failures, 0);
+        theFrames += theIOThreads[i].framesMoved;
+    }
+    double theElapsed = test_now_seconds() - theStart;
+    atomic_store_explicit(&theChurn.stop, true, memory_order_relaxed);
+    pthread_join(theChurnHandle, NULL);
+    CHECK_EQUAL(theChurn.failures, 0);
+    CHECK(theChurn.churns > 0);
+
+    printf("    %u threads x %u cycles, %.1f Mframes in %.3f s, %llu client churns\n", kTest_IOThreads, kTest_Cycles, (double)theFrames * 1.0e-6, theElapsed, (unsigned long long)theChurn.churns);
+
+    VocanaClientScratch_Teardown(&theScratch);
+}
+
+static void test_init_errors(void)
+{
+    VocanaClientScratch theScratch;
+    CHECK_EQUAL(VocanaClientScratch_Init(&theScratch, 0, kTest_Channels), EINVAL);
+    CHECK_EQUAL(VocanaClientScratch_Init(&theScratch, kTest_MaxFrames, 0), EINVAL);
+    CHECK_EQUAL(VocanaClientScratch_Init(NULL, kTest_MaxFrames, kTest_Channels), EINVAL);
+}
+
+int main(void)
+{
+    RUN_TEST(test_clients);
+    RUN_TEST(test_device_area);
+    RUN_TEST(test_concurrent_io_with_varying_sizes);
+    RUN_TEST(test_init_errors);
+    return TEST_RESULT();
+}
@@ -0,0 +1,385 @@
+/*
+     File: VocanaClockTests.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Host-side tests for VocanaClock against simulated reference clocks with injected drift, jitter
+ and discontinuities.
+
+ */
+
+#include "VocanaClock.h"
+#include "VocanaDriverTestSupport.h"
+
+#include <pthread.h>
+
+#define kTest_SampleRate        48000.0
+#define kTest_TicksPerSecond    1.0e9
+#define kTest_Period            16384
+#define kTest_ReferenceFrames   512
+
+//	A reference device whose crystal runs inDriftPPM fast, observed through IO proc time stamps
+//	with up to inJitterNanos of uniform scheduling noise.
+typedef struct TestReference
+{
+    double      ticksPerFrame;
+    double      jitterNanos;
+    uint64_t    anchorHostTime;
+    double      sampleTime;
+    uint32_t    seed;
+} TestReference;
+
+static void test_reference_init(TestReference* outReference, double inDriftPPM, double inJitterNanos)
+{
+    outReference->ticksPerFrame = kTest_TicksPerSecond / (kTest_SampleRate * (1.0 + inDriftPPM * 1.0e-6));
+    outReference->jitterNanos = inJitterNanos;
+    outReference->anchorHostTime = 1000000;
+    outReference->sampleTime = 0.0;
+    outReference->seed = 1;
+}
+
+//	The true host time of the reference's current sample time, and the noisy one the app sees.
+static uint64_t test_reference_true_host_time(const TestReference* inReference)
+{
+    return inReference->anchorHostTime + (uint64_t)llround(inReference->sampleTime * inReference->ticksPerFrame);
+}
+
+static VocanaClockReference test_reference_next(TestReference* ioReference)
+{
+    ioReference->sampleTime += kTest_ReferenceFrames;
+    ioReference->seed = ioReference->seed * 1103515245u + 12345u;
+    double theNoise = ioReference->jitterNanos * ((double)((ioReference->seed >> 8) & 0xFFFF) / 32768.0 - 1.0);
+
+    VocanaClockReference theReference;
+    theReference.sampleTime = ioReference->sampleTime;
+    theReference.hostTime = (uint64_t)llround((double)test_reference_true_host_time(ioReference) + theNoise);
+    return theReference;
+}
+
+//	Where the device's clock says it is at inHostTime, going by its latest zero time stamp.
+static double test_device_position(VocanaClock* inClock, uint64_t inHostTime)
+{
+    double theSampleTime = 0.0;
+    uint64_t theHostTime = 0;
+    uint64_t theSeed = 0;
+    VocanaClock_GetZeroTimeStamp(inClock, inHostTime, &theSampleTime, &theHostTime, &theSeed);
+    return theSampleTime + ((double)inHostTime - (double)theHostTime) / VocanaClock_GetTicksPerFrame(inClock);
+}
+
+static void test_nominal_without_reference(void)
+{
+    VocanaClock theClock;
+    VocanaClock_Init(&theClock, kTest_SampleRate, kTest_TicksPerSecond, kTest_Period);
+    VocanaClock_SetTracking(&theClock, true);
+    VocanaClock_Start(&theClock, 1000);
+
+    double thePeriodTicks = kTest_Period * kTest_TicksPerSecond / kTest_SampleRate;
+    double theSampleTime = -1.0;
+    uint64_t theHostTime = 0;
+    uint64_t theSeed = 0;
+
+    VocanaClock_GetZeroTimeStamp(&theClock, 1000, &theSampleTime, &theHostTime, &theSeed);
+    CHECK_EQUAL(theSampleTime, 0);
+    CHECK_EQUAL(theHostTime, 1000);
+    CHECK_EQUAL(theSeed, 1);
+
+    for(uint64_t n = 1; n < 100; n++)
+    {
+        VocanaClock_GetZeroTimeStamp(&theClock, 1000 + (uint64_t)(n * thePeriodTicks) + 10, &theSampleTime, &theHostTime, &theSeed);
+        CHECK_EQUAL(theSampleTime, n * kTest_Period);
+        CHECK_CLOSE((double)theHostTime, 1000.0 + n * thePeriodTicks, 1.0);
+    }
+    CHECK_EQUAL(theSeed, 1);
+}
+
+static void test_tracks_drift(double inDriftPPM)
+{
+    VocanaClock theClock;
+    VocanaClock_Init(&theClock, kTest_SampleRate, kTest_TicksPerSecond, kTest_Period);
+    VocanaClock_SetTracking(&theClock, true);
+
+    TestReference theReference;
+    test_reference_init(&theReference, inDriftPPM, 200000.0);
+
+    //	thirty seconds of IO proc time stamps
+    for(uint32_t i = 0; i < (uint32_t)(30.0 * kTest_SampleRate / kTest_ReferenceFrames); i++)
+    {
+        VocanaClockReference theObservation = test_reference_next(&theReference);
+        CHECK(VocanaClock_AddReference(&theClock, &theObservation));
+    }
+
+    VocanaClockStatistics theStatistics;
+    VocanaClock_GetStatistics(&theClock, &theStatistics);
+    printf("    drift %+.0f ppm: tracked %+.3f ppm, jitter %.0f ns, max error %.0f ns\n", inDriftPPM, theStatistics.driftPPM, theStatistics.jitterNanos, theStatistics.maxErrorNanos);
+
+    CHECK(theStatistics.isLocked);
+    CHECK(theStatistics.isTracking);
+    CHECK_CLOSE(theStatistics.driftPPM, inDriftPPM, 1.0);
+    CHECK_CLOSE(theStatistics.trackedSampleRate, kTest_SampleRate * (1.0 + inDriftPPM * 1.0e-6), 0.05);
+
+    //	uniform noise of +/-200us has an RMS of 115us
+    CHECK(theStatistics.jitterNanos > 60000.0 && theStatistics.jitterNanos < 180000.0);
+    CHECK(theStatistics.maxErrorNanos < 300000.0);
+    CHECK_EQUAL(theStatistics.discontinuityCount, 0);
+    CHECK_CLOSE(VocanaClock_GetTicksPerFrame(&theClock), theReference.ticksPerFrame, theReference.ticksPerFrame * 1.0e-6);
+}
+
+static void test_tracks_fast_reference(void)    { test_tracks_drift(150.0); }
+static void test_tracks_slow_reference(void)    { test_tracks_drift(-300.0); }
+
+//	Runs the device next to a drifting reference for an hour and returns how far the two drifted
+//	apart between the first minute and the end, in frames. That is how much an app's buffer
+//	between them would have grown or shrunk.
+static double test_hour_of_creep(bool inIsTracking)
+{
+    VocanaClock theClock;
+    VocanaClock_Init(&theClock, kTest_SampleRate, kTest_TicksPerSecond, kTest_Period);
+    VocanaClock_SetTracking(&theClock, inIsTracking);
+
+    TestReference theReference;
+    test_reference_init(&theReference, 120.0, 100000.0);
+    VocanaClock_Start(&theClock, theReference.anchorHostTime);
+
+    double theOffsetAfterAMinute = 0.0;
+    double theOffset = 0.0;
+    uint32_t theReferences = (uint32_t)(3600.0 * kTest_SampleRate / kTest_ReferenceFrames);
+    for(uint32_t i = 1; i <= theReferences; i++)
+    {
+        VocanaClockReference theObservation = test_reference_next(&theReference);
+        VocanaClock_AddReference(&theClock, &theObservation);
+
+        //	the device's IO thread runs at the same cadence
+        uint64_t theHostTime = test_reference_true_host_time(&theReference);
+        theOffset = test_device_position(&theClock, theHostTime) - theReference.sampleTime;
+        if(i == (uint32_t)(60.0 * kTest_SampleRate / kTest_ReferenceFrames))
+        {
+            theOffsetAfterAMinute = theOffset;
+        }
+    }
+
+    VocanaClockStatistics theStatistics;
+    VocanaClock_GetStatistics(&theClock, &theStatistics);
+    CHECK_EQUAL(theStatistics.discontinuityCount, 0);
+    CHECK_EQUAL(theStatistics.missedPeriodCount, 0);
+    CHECK_EQUAL(theStatistics.seed, 1);
+
+    return theOffset - theOffsetAfterAMinute;
+}
+
+static void test_no_creep_over_an_hour(void)
+{
+    double theFixedCreep = test_hour_of_creep(false);
+    double theTrackedCreep = test_hour_of_creep(true);
+    printf("    an hour next to a +120 ppm reference: %.1f frames fixed, %.3f frames tracked\n", theFixedCreep, theTrackedCreep);
+
+    //	120 ppm of 59 minutes at 48kHz is about 20000 frames
+    CHECK_CLOSE(theFixedCreep, -120.0e-6 * 3540.0 * kTest_SampleRate, 100.0);
+    CHECK(fabs(theTrackedCreep) < 4.0);
+}
+
+static void test_discontinuity_resyncs_and_bumps_the_seed(void)
+{
+    VocanaClock theClock;
+    VocanaClock_Init(&theClock, kTest_SampleRate, kTest_TicksPerSecond, kTest_Period);
+    VocanaClock_SetTracking(&theClock, true);
+
+    TestReference theReference;
+    test_reference_init(&theReference, 80.0, 50000.0);
+    VocanaClock_Start(&theClock, theReference.anchorHostTime);
+
+    for(uint32_t i = 0; i < 1000; i++)
+    {
+        VocanaClockReference theObservation = test_reference_next(&theReference);
+        VocanaClock_AddReference(&theClock, &theObservation);
+    }
+    double theSampleTime = 0.0;
+    uint64_t theHostTime = 0;
+    uint64_t theSeed = 0;
+    VocanaClock_GetZeroTimeStamp(&theClock, test_reference_true_host_time(&theReference), &theSampleTime, &theHostTime, &theSeed);
+    CHECK_EQUAL(theSeed, 1);
+
+    //	the reference device restarted: its sample time went back to zero
+    theReference.anchorHostTime = test_reference_true_host_time(&theReference);
+    theReference.sampleTime = -kTest_ReferenceFrames;
+    VocanaClockReference theObservation = test_reference_next(&theReference);
+    CHECK(!VocanaClock_AddReference(&theClock, &theObservation));
+
+    VocanaClockStatistics theStatistics;
+    VocanaClock_GetStatistics(&theClock, &theStatistics);
+    CHECK_EQUAL(theStatistics.discontinuityCount, 1);
+    CHECK(!theStatistics.isLocked);
+    CHECK_CLOSE(VocanaClock_GetTicksPerFrame(&theClock), kTest_TicksPerSecond / kTest_SampleRate, 1.0e-9);
+
+    VocanaClock_GetZeroTimeStamp(&theClock, test_reference_true_host_time(&theReference), &theSampleTime, &theHostTime, &theSeed);
+    CHECK_EQUAL(theSeed, 2);
+
+    //	a host time jump of more than the resync threshold is a discontinuity too
+    theReference.anchorHostTime += 50000000;
+    theObservation = test_reference_next(&theReference);
+    CHECK(!VocanaClock_AddReference(&theClock, &theObservation));
+
+    //	and it locks again
+    for(uint32_t i = 0; i < (uint32_t)(30.0 * kTest_SampleRate / kTest_ReferenceFrames); i++)
+    {
+        theObservation = test_reference_next(&theReference);
+        CHECK(VocanaClock_AddReference(&theClock, &theObservation));
+    }
+    VocanaClock_GetStatistics(&theClock, &theStatistics);
+    CHECK(theStatistics.isLocked);
+    CHECK_EQUAL(theStatistics.discontinuityCount, 2);
+    CHECK_CLOSE(theStatistics.driftPPM, 80.0, 2.0);
+}
+
+static void test_impossible_rate_is_rejected(void)
+{
+    VocanaClock theClock;
+    VocanaClock_Init(&theClock, kTest_SampleRate, kTest_TicksPerSecond, kTest_Period);
+    VocanaClock_SetTracking(&theClock, true);
+
+    //	a "reference" running 5% fast is some other rate, not drift
+    TestReference theReference;
+    test_reference_init(&theReference, 50000.0, 0.0);
+    uint32_t theAccepted = 0;
+    for(uint32_t i = 0; i < 2000; i++)
+    {
+        VocanaClockReference theObservation = test_reference_next(&theReference);
+        theAccepted += VocanaClock_AddReference(&theClock, &theObservation);
+    }
+
+    VocanaClockStatistics theStatistics;
+    VocanaClock_GetStatistics(&theClock, &theStatistics);
+    CHECK(!theStatistics.isLocked);
+    CHECK(theStatistics.discontinuityCount > 0);
+    CHECK(fabs(theStatistics.driftPPM) <= kVocanaClock_MaxDriftPPM);
+}
+
+static void test_missed_periods_keep_the_timeline(void)
+{
+    VocanaClock theClock;
+    VocanaClock_Init(&theClock, kTest_SampleRate, kTest_TicksPerSecond, kTest_Period);
+    VocanaClock_Start(&theClock, 0);
+
+    double thePeriodTicks = kTest_Period * kTest_TicksPerSecond / kTest_SampleRate;
+    double theSampleTime = 0.0;
+    uint64_t theHostTime = 0;
+    uint64_t theSeed = 0;
+
+    //	the IO thread wakes up ten and a half periods later
+    VocanaClock_GetZeroTimeStamp(&theClock, (uint64_t)(10.5 * thePeriodTicks), &theSampleTime, &theHostTime, &theSeed);
+    CHECK_EQUAL(theSampleTime, 10 * kTest_Period);
+    CHECK_CLOSE((double)theHostTime, 10.0 * thePeriodTicks, 1.0);
+    CHECK_EQUAL(theSeed, 1);
+
+    VocanaClockStatistics theStatistics;
+    VocanaClock_GetStatistics(&theClock, &theStatistics);
+    CHECK_EQUAL(theStatistics.missedPeriodCount, 9);
+}
+
+static void test_rate_trim_and_fixed_mode(void)
+{
+    VocanaClock theClock;
+    VocanaClock_Init(&theClock, kTest_SampleRate, kTest_TicksPerSecond, kTest_Period);
+
+    TestReference theReference;
+    test_reference_init(&theReference, 200.0, 0.0);
+    for(uint32_t i = 0; i < (uint32_t)(20.0 * kTest_SampleRate / kTest_ReferenceFrames); i++)
+    {
+        VocanaClockReference theObservation = test_reference_next(&theReference);
+        VocanaClock_AddReference(&theClock, &theObservation);
+    }
+
+    //	the loop is locked, but with tracking off the device stays at the nominal rate
+    double theNominal = kTest_TicksPerSecond / kTest_SampleRate;
+    CHECK_CLOSE(VocanaClock_GetTicksPerFrame(&theClock), theNominal, 1.0e-9);
+
+    VocanaClock_SetTracking(&theClock, true);
+    CHECK_CLOSE(VocanaClock_GetTicksPerFrame(&theClock), theReference.ticksPerFrame, theNominal * 1.0e-7);
+
+    VocanaClock_SetRateTrim(&theClock, 1.01);
+    CHECK_CLOSE(VocanaClock_GetTicksPerFrame(&theClock), theReference.ticksPerFrame * 1.01, theNominal * 1.0e-7);
+
+    //	a sample rate change forgets the reference
+    VocanaClock_SetRateTrim(&theClock, 1.0);
+    VocanaClock_SetSampleRate(&theClock, 96000.0);
+    CHECK_CLOSE(VocanaClock_GetTicksPerFrame(&theClock), kTest_TicksPerSecond / 96000.0, 1.0e-9);
+}
+
+//	A device and its mirror share the clock but ask for zero time stamps from IO threads of their
+//	own. Whichever thread gets there, every stamp must lie on the one timeline, whole periods from
+//	the anchor, and no thread may see the timeline go backwards.
+typedef struct ConcurrentClock
+{
+    VocanaClock*        clock;
+    _Atomic uint64_t*   now;
+    double              periodTicks;
+    uint64_t            calls;
+    uint64_t            badStamps;
+} ConcurrentClock;
+
+static void* concurrent_zero_time_stamps(void* inContext)
+{
+    ConcurrentClock* theContext = inContext;
+    double theLastSampleTime = 0.0;
+    for(uint64_t i = 0; i < theContext->calls; i++)
+    {
+        uint64_t theNow = atomic_fetch_add(theContext->now, (uint64_t)(theContext->periodTicks / 3.0));
+        double theSampleTime = 0.0;
+        uint64_t theHostTime = 0;
+        uint64_t theSeed = 0;
+        VocanaClock_GetZeroTimeStamp(theContext->clock, theNow, &theSampleTime, &theHostTime, &theSeed);
+
+        //	the host times build up period by period, so they carry a little rounding
+        double thePeriods = theSampleTime / kTest_Period;
+        double theExpectedHostTime = thePeriods * theContext->periodTicks;
+        bool isOnTheLine = thePeriods == floor(thePeriods) &&
+                           fabs((double)theHostTime - theExpectedHostTime) <= 2.0 + theExpectedHostTime * 1.0e-11 &&
+                           theSampleTime >= theLastSampleTime;
+        theContext->badStamps += isOnTheLine ? 0 : 1;
+        theLastSampleTime = theSampleTime;
+    }
+    return NULL;
+}
+
+static void test_zero_time_stamps_from_two_threads(void)
+{
+    VocanaClock theClock;
+    VocanaClock_Init(&theClock, kTest_SampleRate, kTest_TicksPerSecond, kTest_Period);
+    VocanaClock_Start(&theClock, 0);
+
+    _Atomic uint64_t theNow = 0;
+    double thePeriodTicks = kTest_Period * kTest_TicksPerSecond / kTest_SampleRate;
+    ConcurrentClock theContexts[2];
+    pthread_t theThreads[2];
+    for(uint32_t i = 0; i < 2; i++)
+    {
+        theContexts[i] = (ConcurrentClock){ &theClock, &theNow, thePeriodTicks, 200000, 0 };
+        CHECK_EQUAL(pthread_create(&theThreads[i], NULL, concurrent_zero_time_stamps, &theContexts[i]), 0);
+    }
+    for(uint32_t i = 0; i < 2; i++)
+    {
+        pthread_join(theThreads[i], NULL);
+        CHECK_EQUAL(theContexts[i].badStamps, 0);
+    }
+
+    //	and the published stamp ends up where the last call left it
+    double theSampleTime = 0.0;
+    uint64_t theHostTime = 0;
+    uint64_t theSeed = 0;
+    uint64_t theEnd = atomic_load(&theNow);
+    VocanaClock_GetZeroTimeStamp(&theClock, theEnd, &theSampleTime, &theHostTime, &theSeed);
+    CHECK_EQUAL(theSampleTime, floor((double)theEnd / thePeriodTicks) * kTest_Period);
+}
+
+int main(void)
+{
+    RUN_TEST(test_nominal_without_reference);
+    RUN_TEST(test_tracks_fast_reference);
+    RUN_TEST(test_tracks_slow_reference);
+    RUN_TEST(test_no_creep_over_an_hour);
+    RUN_TEST(test_discontinuity_resyncs_and_bumps_the_seed);
+    RUN_TEST(test_impossible_rate_is_rejected);
+    RUN_TEST(test_missed_periods_keep_the_timeline);
+    RUN_TEST(test_rate_trim_and_fixed_mode);
+    RUN_TEST(test_zero_time_stamps_from_two_threads);
+    return TEST_RESULT();
+}
@@ -0,0 +1,174 @@
+/*
+     File: VocanaDeviceRegistryTests.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Host-side tests for VocanaDeviceRegistry: object ID blocks, slot reuse without ID reuse, and
+ lookups racing a thread that keeps adding and removing devices.
+
+ */
+
+#include "VocanaDeviceRegistry.h"
+#include "VocanaDriverTestSupport.h"
+
+#include <errno.h>
+#include <pthread.h>
+
+#define kTest_FirstObjectID     3
+#define kTest_ObjectsPerDevice  10
+
+static void test_blocks(void)
+{
+    VocanaDeviceRegistry theRegistry;
+    CHECK_EQUAL(VocanaDeviceRegistry_Init(&theRegistry, 0, kTest_ObjectsPerDevice), EINVAL);
+    CHECK_EQUAL(VocanaDeviceRegistry_Init(&theRegistry, kTest_FirstObjectID, kTest_ObjectsPerDevice), 0);
+
+    uint32_t theSlot = 0;
+    uint32_t theOffset = 0;
+    CHECK(!VocanaDeviceRegistry_Find(&theRegistry, kTest_FirstObjectID, &theSlot, &theOffset));
+
+    //	the first device gets the first block, the next ones follow on
+    for(uint32_t i = 0; i < 3; i++)
+    {
+        uint32_t theFirstObjectID = 0;
+        CHECK_EQUAL(VocanaDeviceRegistry_Add(&theRegistry, &theSlot, &theFirstObjectID), 0);
+        CHECK_EQUAL(theSlot, i);
+        CHECK_EQUAL(theFirstObjectID, kTest_FirstObjectID + i * kTest_ObjectsPerDevice);
+        CHECK_EQUAL(VocanaDeviceRegistry_GetFirstObjectID(&theRegistry, i), theFirstObjectID);
+    }
+    CHECK_EQUAL(VocanaDeviceRegistry_GetCount(&theRegistry), 3);
+
+    //	every ID of a block finds its device and offset, and nothing outside the blocks does
+    for(uint32_t theObjectID = 0; theObjectID < kTest_FirstObjectID + 4 * kTest_ObjectsPerDevice; theObjectID++)
+    {
+        bool isFound = VocanaDeviceRegistry_Find(&theRegistry, theObjectID, &theSlot, &theOffset);
+        bool isInBlock = theObjectID >= kTest_FirstObjectID && theObjectID < kTest_FirstObjectID + 3 * kTest_ObjectsPerDevice;
+        CHECK(isFound == isInBlock);
+        if(isFound && isInBlock)
+        {
+            CHECK_EQUAL(theSlot, (theObjectID - kTest_FirstObjectID) / kTest_ObjectsPerDevice);
+            CHECK_EQUAL(theOffset, (theObjectID - kTest_FirstObjectID) % kTest_ObjectsPerDevice);
+        }
+    }
+    CHECK(!VocanaDeviceRegistry_Find(&theRegistry, UINT32_MAX, &theSlot, &theOffset));
+}
+
+static void test_slots_are_reused_but_ids_are_not(void)
+{
+    VocanaDeviceRegistry theRegistry;
+    VocanaDeviceRegistry_Init(&theRegistry, kTest_FirstObjectID, kTest_ObjectsPerDevice);
+    uint32_t theSlot = 0;
+    uint32_t theFirstObjectID = 0;
+    for(uint32_t i = 0; i < kVocanaDeviceRegistry_MaxDevices; i++)
+    {
+        CHECK_EQUAL(VocanaDeviceRegistry_Add(&theRegistry, &theSlot, &theFirstObjectID), 0);
+    }
+    CHECK_EQUAL(VocanaDeviceRegistry_Add(&theRegistry, &theSlot, &theFirstObjectID), ENOSPC);
+
+    uint32_t theOldFirstObjectID = VocanaDeviceRegistry_GetFirstObjectID(&theRegistry, 5);
+    CHECK_EQUAL(VocanaDeviceRegistry_Remove(&theRegistry, 5), 0);
+    CHECK_EQUAL(VocanaDeviceRegistry_Remove(&theRegistry, 5), EINVAL);
+    CHECK_EQUAL(VocanaDeviceRegistry_Remove(&theRegistry, kVocanaDeviceRegistry_MaxDevices), EINVAL);
+    CHECK_EQUAL(VocanaDeviceRegistry_GetFirstObjectID(&theRegistry, 5), 0);
+
+    uint32_t theOffset = 0;
+    CHECK(!VocanaDeviceRegistry_Find(&theRegistry, theOldFirstObjectID, &theSlot, &theOffset));
+
+    //	the new device takes the free slot with IDs nobody has seen before
+    CHECK_EQUAL(VocanaDeviceRegistry_Add(&theRegistry, &theSlot, &theFirstObjectID), 0);
+    CHECK_EQUAL(theSlot, 5);
+    CHECK_EQUAL(theFirstObjectID, kTest_FirstObjectID + kVocanaDeviceRegistry_MaxDevices * kTest_ObjectsPerDevice);
+    CHECK(!VocanaDeviceRegistry_Find(&theRegistry, theOldFirstObjectID, &theSlot, &theOffset));
+    CHECK(VocanaDeviceRegistry_Find(&theRegistry, theFirstObjectID + 1, &theSlot, &theOffset));
+    CHECK_EQUAL(theSlot, 5);
+    CHECK_EQUAL(theOffset, 1);
+    CHECK_EQUAL(VocanaDeviceRegistry_GetCount(&theRegistry), kVocanaDeviceRegistry_MaxDevices);
+}
+
+static void test_ids_run_out(void)
+{
+    VocanaDeviceRegistry theRegistry;
+    VocanaDeviceRegistry_Init(&theRegistry, UINT32_MAX - 2 * kTest_ObjectsPerDevice, kTest_ObjectsPerDevice);
+    uint32_t theSlot = 0;
+    uint32_t theFirstObjectID = 0;
+    CHECK_EQUAL(VocanaDeviceRegistry_Add(&theRegistry, &theSlot, &theFirstObjectID), 0);
+    CHECK_EQUAL(VocanaDeviceRegistry_Add(&theRegistry, &theSlot, &theFirstObjectID), 0);
+    CHECK_EQUAL(VocanaDeviceRegistry_Add(&theRegistry, &theSlot, &theFirstObjectID), EOVERFLOW);
+    CHECK_EQUAL(VocanaDeviceRegistry_GetCount(&theRegistry), 2);
+}
+
+//	A device's state as the code that adds it sets it up: the owner writes its own ID in before
+//	publishing the slot, so a lookup that finds the slot must see it.
+typedef struct TestRace
+{
+    VocanaDeviceRegistry    registry;
+    uint32_t                owners[kVocanaDeviceRegistry_MaxDevices];
+    _Atomic bool            isDone;
+    _Atomic uint64_t        lookups;
+    uint64_t                mismatches;
+} TestRace;
+
+static void* test_race_lookups(void* inContext)
+{
+    TestRace* theRace = (TestRace*)inContext;
+    uint32_t theObjectID = kTest_FirstObjectID;
+    while(!atomic_load(&theRace->isDone))
+    {
+        uint32_t theSlot = 0;
+        uint32_t theOffset = 0;
+        if(VocanaDeviceRegistry_Find(&theRace->registry, theObjectID, &theSlot, &theOffset))
+        {
+            //	the owner may already have moved on to a newer device, but never to an older one
+            theRace->mismatches += __atomic_load_n(&theRace->owners[theSlot], __ATOMIC_RELAXED) + theOffset < theObjectID;
+        }
+        atomic_fetch_add_explicit(&theRace->lookups, 1, memory_order_relaxed);
+        theObjectID = kTest_FirstObjectID + (theObjectID * 7u + 1u) % (64u * kTest_ObjectsPerDevice);
+    }
+    return NULL;
+}
+
+static void test_lookups_race_changes(void)
+{
+    static TestRace sRace;
+    VocanaDeviceRegistry_Init(&sRace.registry, kTest_FirstObjectID, kTest_ObjectsPerDevice);
+    atomic_store(&sRace.isDone, false);
+
+    pthread_t theThread;
+    pthread_create(&theThread, NULL, test_race_lookups, &sRace);
+    while(atomic_load(&sRace.lookups) == 0)
+    {
+    }
+
+    //	churn through the first 64 blocks' worth of devices, four at a time
+    uint32_t theSlot = 0;
+    uint32_t theFirstObjectID = 0;
+    for(uint32_t i = 0; i < 64; i++)
+    {
+        if(VocanaDeviceRegistry_GetCount(&sRace.registry) == 4)
+        {
+            VocanaDeviceRegistry_Remove(&sRace.registry, i % 4);
+        }
+        uint32_t theExpectedSlot = VocanaDeviceRegistry_GetCount(&sRace.registry) == 3 ? i % 4 : i;
+        __atomic_store_n(&sRace.owners[theExpectedSlot], kTest_FirstObjectID + i * kTest_ObjectsPerDevice, __ATOMIC_RELAXED);
+        CHECK_EQUAL(VocanaDeviceRegistry_Add(&sRace.registry, &theSlot, &theFirstObjectID), 0);
+        CHECK_EQUAL(theSlot, theExpectedSlot);
+        CHECK_EQUAL(theFirstObjectID, kTest_FirstObjectID + i * kTest_ObjectsPerDevice);
+        for(volatile uint32_t theSpin = 0; theSpin < 20000; theSpin++)
+        {
+        }
+    }
+
+    atomic_store(&sRace.isDone, true);
+    pthread_join(theThread, NULL);
+    printf("    %llu lookups during the changes\n", (unsigned long long)atomic_load(&sRace.lookups));
+    CHECK_EQUAL(sRace.mismatches, 0);
+}
+
+int main(void)
+{
+    RUN_TEST(test_blocks);
+    RUN_TEST(test_slots_are_reused_but_ids_are_not);
+    RUN_TEST(test_ids_run_out);
+    RUN_TEST(test_lookups_race_changes);
+    return TEST_RESULT();
+}
@@ -0,0 +1,283 @@
+/*
+     File: VocanaDeviceStateTests.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Host-side tests for VocanaDeviceState: snapshot consistency under a racing setter, the IO
+ reader's one-look-per-cycle behavior and the gain ramp.
+
+ */
+
+#include "VocanaDeviceState.h"
+#include "VocanaDriverTestSupport.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#define kTest_Frames    64
+#define kTest_Channels  2
+
+//	Every field of a snapshot derived from one counter, so a torn copy shows up as a mismatch.
+static VocanaDeviceStateValues test_values(uint32_t inCounter)
+{
+    VocanaDeviceStateValues theValues;
+    memset(&theValues, 0, sizeof(theValues));
+    theValues.sampleRate = 1000.0 + inCounter;
+    theValues.volume = (float)(inCounter & 0xFFFF);
+    theValues.pitchAdjust = (float)((inCounter >> 1) & 0xFFFF);
+    theValues.clockSource = inCounter;
+    theValues.isMuted = (inCounter & 1) != 0;
+    theValues.isPitchAdjustEnabled = (inCounter & 2) != 0;
+    theValues.isInputActive = (inCounter & 4) != 0;
+    theValues.isOutputActive = (inCounter & 8) != 0;
+    return theValues;
+}
+
+static bool test_values_are_consistent(const VocanaDeviceStateValues* inValues)
+{
+    VocanaDeviceStateValues theExpected = test_values(inValues->clockSource);
+    return memcmp(&theExpected, inValues, sizeof(theExpected)) == 0;
+}
+
+static void test_fill(float* outFrames, float inValue)
+{
+    for(uint32_t i = 0; i < kTest_Frames * kTest_Channels; i++)
+    {
+        outFrames[i] = inValue;
+    }
+}
+
+static void test_publish_and_read(void)
+{
+    VocanaDeviceState theState;
+    VocanaDeviceStateValues theValues = test_values(1);
+    VocanaDeviceState_Init(&theState, &theValues);
+
+    VocanaDeviceStateValues theRead;
+    uint64_t theFirstVersion = VocanaDeviceState_Read(&theState, &theRead);
+    CHECK(memcmp(&theRead, &theValues, sizeof(theValues)) == 0);
+
+    theValues = test_values(2);
+    VocanaDeviceState_Publish(&theState, &theValues);
+    uint64_t theSecondVersion = VocanaDeviceState_Read(&theState, &theRead);
+    CHECK(theSecondVersion > theFirstVersion);
+    CHECK(memcmp(&theRead, &theValues, sizeof(theValues)) == 0);
+
+    uint64_t theVersion = 0;
+    CHECK(VocanaDeviceState_TryRead(&theState, &theRead, &theVersion));
+    CHECK_EQUAL(theVersion, theSecondVersion);
+}
+
+static void test_try_read_fails_mid_update(void)
+{
+    VocanaDeviceState theState;
+    VocanaDeviceStateValues theValues = test_values(3);
+    VocanaDeviceState_Init(&theState, &theValues);
+
+    //	what a reader sees while a setter is between its two sequence stores
+    atomic_fetch_add(&theState.sequence, 1);
+    VocanaDeviceStateValues theRead;
+    CHECK(!VocanaDeviceState_TryRead(&theState, &theRead, NULL));
+    atomic_fetch_add(&theState.sequence, 1);
+    CHECK(VocanaDeviceState_TryRead(&theState, &theRead, NULL));
+}
+
+static void test_reader_keeps_one_snapshot_per_cycle(void)
+{
+    VocanaDeviceState theState;
+    VocanaDeviceStateValues theValues = test_values(4);
+    VocanaDeviceState_Init(&theState, &theValues);
+
+    VocanaDeviceStateReader theReader;
+    VocanaDeviceStateReader_Init(&theReader, &theState);
+    const VocanaDeviceStateValues* theCycleValues = VocanaDeviceStateReader_BeginCycle(&theReader, &theState, 1);
+    CHECK_EQUAL(theCycleValues->clockSource, 4);
+
+    //	a change published mid-cycle waits for the next cycle
+    theValues = test_values(5);
+    VocanaDeviceState_Publish(&theState, &theValues);
+    theCycleValues = VocanaDeviceStateReader_BeginCycle(&theReader, &theState, 1);
+    CHECK_EQUAL(theCycleValues->clockSource, 4);
+    theCycleValues = VocanaDeviceStateReader_BeginCycle(&theReader, &theState, 2);
+    CHECK_EQUAL(theCycleValues->clockSource, 5);
+
+    //	a setter caught mid-update costs one stale cycle, not a wait
+    theValues = test_values(6);
+    VocanaDeviceState_Publish(&theState, &theValues);
+    atomic_fetch_add(&theState.sequence, 1);
+    theCycleValues = VocanaDeviceStateReader_BeginCycle(&theReader, &theState, 3);
+    CHECK_EQUAL(theCycleValues->clockSource, 5);
+    CHECK_EQUAL(theReader.staleCycles, 1);
+    atomic_fetch_add(&theState.sequence, 1);
+    theCycleValues = VocanaDeviceStateReader_BeginCycle(&theReader, &theState, 4);
+    CHECK(test_values_are_consistent(theCycleValues));
+    CHECK_EQUAL(theReader.staleCycles, 1);
+}
+
+static void test_gain_ramps_across_a_change(void)
+{
+    VocanaDeviceState theState;
+    VocanaDeviceStateValues theValues = test_values(0);
+    theValues.volume = 1.0f;
+    theValues.isMuted = false;
+    VocanaDeviceState_Init(&theState, &theValues);
+
+    VocanaDeviceStateReader theReader;
+    VocanaDeviceStateReader_Init(&theReader, &theState);
+    float theFrames[kTest_Frames * kTest_Channels];
+
+    //	unity leaves the samples alone
+    VocanaDeviceStateReader_BeginCycle(&theReader, &theState, 1);
+    test_fill(theFrames, 0.5f);
+    VocanaDeviceStateReader_ApplyGain(&theReader, theFrames, kTest_Frames, kTest_Channels, true);
+    CHECK_EQUAL(theFrames[0] == 0.5f && theFrames[kTest_Frames * kTest_Channels - 1] == 0.5f, 1);
+
+    //	a new volume ramps from the old one and lands on it at the last frame
+    theValues.volume = 0.25f;
+    VocanaDeviceState_Publish(&theState, &theValues);
+    VocanaDeviceStateReader_BeginCycle(&theReader, &theState, 2);
+    test_fill(theFrames, 1.0f);
+    VocanaDeviceStateReader_ApplyGain(&theReader, theFrames, kTest_Frames, kTest_Channels, true);
+    CHECK_CLOSE(theFrames[0], 1.0, 1.0e-6);
+    CHECK_CLOSE(theFrames[1], 1.0, 1.0e-6);
+    CHECK_CLOSE(theFrames[(kTest_Frames - 1) * kTest_Channels], 0.25, 1.0e-6);
+    bool isMonotonic = true;
+    for(uint32_t theFrame = 1; theFrame < kTest_Frames; theFrame++)
+    {
+        isMonotonic = isMonotonic && theFrames[theFrame * kTest_Channels] <= theFrames[(theFrame - 1) * kTest_Channels];
+        isMonotonic = isMonotonic && theFrames[theFrame * kTest_Channels] == theFrames[theFrame * kTest_Channels + 1];
+    }
+    CHECK(isMonotonic);
+
+    //	the next cycle is flat at the new volume
+    VocanaDeviceStateReader_BeginCycle(&theReader, &theState, 3);
+    test_fill(theFrames, 1.0f);
+    VocanaDeviceStateReader_ApplyGain(&theReader, theFrames, kTest_Frames, kTest_Channels, true);
+    CHECK_CLOSE(theFrames[0], 0.25, 1.0e-6);
+
+    //	without volume control only the mute applies
+    VocanaDeviceStateReader_BeginCycle(&theReader, &theState, 4);
+    test_fill(theFrames, 1.0f);
+    VocanaDeviceStateReader_ApplyGain(&theReader, theFrames, kTest_Frames, kTest_Channels, false);
+    CHECK_CLOSE(theFrames[kTest_Frames], 1.0, 1.0e-6);
+
+    //	muting fades out over one cycle, then stays silent
+    theValues.isMuted = true;
+    VocanaDeviceState_Publish(&theState, &theValues);
+    VocanaDeviceStateReader_BeginCycle(&theReader, &theState, 5);
+    test_fill(theFrames, 1.0f);
+    VocanaDeviceStateReader_ApplyGain(&theReader, theFrames, kTest_Frames, kTest_Channels, true);
+    CHECK_CLOSE(theFrames[0], 0.25, 1.0e-6);
+    CHECK_EQUAL(theFrames[(kTest_Frames - 1) * kTest_Channels] == 0.0f, 1);
+    VocanaDeviceStateReader_BeginCycle(&theReader, &theState, 6);
+    test_fill(theFrames, 1.0f);
+    VocanaDeviceStateReader_ApplyGain(&theReader, theFrames, kTest_Frames, kTest_Channels, true);
+    CHECK_EQUAL(theFrames[0] == 0.0f && theFrames[kTest_Frames] == 0.0f, 1);
+}
+
+typedef struct StressContext
+{
+    VocanaDeviceState   state;
+    _Atomic bool        done;
+    _Atomic uint64_t    reads;
+    _Atomic uint64_t    tornReads;
+    _Atomic uint64_t    versionRegressions;
+    _Atomic uint64_t    staleCycles;
+} StressContext;
+
+static void* stress_setter(void* inContext)
+{
+    StressContext* theContext = (StressContext*)inContext;
+    for(uint32_t theCounter = 1; theCounter <= 200000; theCounter++)
+    {
+        VocanaDeviceStateValues theValues = test_values(theCounter);
+        VocanaDeviceState_Publish(&theContext->state, &theValues);
+    }
+    atomic_store(&theContext->done, true);
+    return NULL;
+}
+
+static void* stress_property_reader(void* inContext)
+{
+    StressContext* theContext = (StressContext*)inContext;
+    uint64_t theLastVersion = 0;
+    while(!atomic_load(&theContext->done))
+    {
+        VocanaDeviceStateValues theValues;
+        uint64_t theVersion = VocanaDeviceState_Read(&theContext->state, &theValues);
+        if(!test_values_are_consistent(&theValues))
+        {
+            atomic_fetch_add(&theContext->tornReads, 1);
+        }
+        if(theVersion < theLastVersion)
+        {
+            atomic_fetch_add(&theContext->versionRegressions, 1);
+        }
+        theLastVersion = theVersion;
+        atomic_fetch_add(&theContext->reads, 1);
+    }
+    return NULL;
+}
+
+static void* stress_io_reader(void* inContext)
+{
+    StressContext* theContext = (StressContext*)inContext;
+    VocanaDeviceStateReader theReader;
+    VocanaDeviceStateReader_Init(&theReader, &theContext->state);
+    for(uint64_t theCycle = 1; !atomic_load(&theContext->done); theCycle++)
+    {
+        const VocanaDeviceStateValues* theValues = VocanaDeviceStateReader_BeginCycle(&theReader, &theContext->state, theCycle);
+        if(!test_values_are_consistent(theValues))
+        {
+            atomic_fetch_add(&theContext->tornReads, 1);
+        }
+        atomic_fetch_add(&theContext->reads, 1);
+    }
+    atomic_fetch_add(&theContext->staleCycles, theReader.staleCycles);
+    return NULL;
+}
+
+static void test_concurrent_setter_and_readers(void)
+{
+    enum { kPropertyReaders = 2, kIOReaders = 2 };
+
+    StressContext theContext;
+    memset(&theContext, 0, sizeof(theContext));
+    VocanaDeviceStateValues theValues = test_values(0);
+    VocanaDeviceState_Init(&theContext.state, &theValues);
+
+    pthread_t theSetter;
+    pthread_t theReaders[kPropertyReaders + kIOReaders];
+    for(int i = 0; i < kPropertyReaders + kIOReaders; i++)
+    {
+        pthread_create(&theReaders[i], NULL, i < kPropertyReaders ? stress_property_reader : stress_io_reader, &theContext);
+    }
+    pthread_create(&theSetter, NULL, stress_setter, &theContext);
+    pthread_join(theSetter, NULL);
+    for(int i = 0; i < kPropertyReaders + kIOReaders; i++)
+    {
+        pthread_join(theReaders[i], NULL);
+    }
+
+    printf("    %llu reads, %llu stale IO cycles\n",
+           (unsigned long long)atomic_load(&theContext.reads),
+           (unsigned long long)atomic_load(&theContext.staleCycles));
+
+    CHECK_EQUAL(atomic_load(&theContext.tornReads), 0);
+    CHECK_EQUAL(atomic_load(&theContext.versionRegressions), 0);
+    CHECK(atomic_load(&theContext.reads) > 0);
+
+    VocanaDeviceStateValues theRead;
+    CHECK_EQUAL(VocanaDeviceState_Read(&theContext.state, &theRead), 200000);
+    CHECK_EQUAL(theRead.clockSource, 200000);
+}
+
+int main(void)
+{
+    RUN_TEST(test_publish_and_read);
+    RUN_TEST(test_try_read_fails_mid_update);
+    RUN_TEST(test_reader_keeps_one_snapshot_per_cycle);
+    RUN_TEST(test_gain_ramps_across_a_change);
+    RUN_TEST(test_concurrent_setter_and_readers);
+    return TEST_RESULT();
+}
@@ -0,0 +1,70 @@
+/*
+     File: VocanaDriverTestSupport.h
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Minimal assertion helpers shared by the host-side driver tests. The driver tests are plain C
+ programs so they build with nothing but a C11 compiler and pthreads; see run_tests.sh.
+
+ */
+
+#ifndef VocanaDriverTestSupport_h
+#define VocanaDriverTestSupport_h
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static int gTest_FailureCount = 0;
+
+#define CHECK(inCondition)                                                                      \
+    do {                                                                                        \
+        if(!(inCondition))                                                                      \
+        {                                                                                       \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #inCondition);    \
+            ++gTest_FailureCount;                                                               \
+        }                                                                                       \
+    } while(0)
+
+#define CHECK_EQUAL(inActual, inExpected)                                                       \
+    do {                                                                                        \
+        long long theActual = (long long)(inActual);                                            \
+        long long theExpected = (long long)(inExpected);                                        \
+        if(theActual != theExpected)                                                            \
+        {                                                                                       \
+            fprintf(stderr, "%s:%d: CHECK_EQUAL failed: %s == %lld, expected %lld\n",           \
+                    __FILE__, __LINE__, #inActual, theActual, theExpected);                     \
+            ++gTest_FailureCount;                                                               \
+        }                                                                                       \
+    } while(0)
+
+#define CHECK_CLOSE(inActual, inExpected, inAccuracy)                                           \
+    do {                                                                                        \
+        double theActual = (double)(inActual);                                                  \
+        double theExpected = (double)(inExpected);                                              \
+        if(!(fabs(theActual - theExpected) <= (double)(inAccuracy)))                            \
+        {                                                                                       \
+            fprintf(stderr, "%s:%d: CHECK_CLOSE failed: %s == %g, expected %g +/- %g\n",        \
+                    __FILE__, __LINE__, #inActual, theActual, theExpected, (double)(inAccuracy)); \
+            ++gTest_FailureCount;                                                               \
+        }                                                                                       \
+    } while(0)
+
+#define RUN_TEST(inTest)                                                                        \
+    do {                                                                                        \
+        int theFailuresBefore = gTest_FailureCount;                                             \
+        inTest();                                                                               \
+        printf("%s %s\n", gTest_FailureCount == theFailuresBefore ? "[ PASS ]" : "[ FAIL ]", #inTest); \
+    } while(0)
+
+#define TEST_RESULT()   (gTest_FailureCount == 0 ? EXIT_SUCCESS : EXIT_FAILURE)
+
+static inline double test_now_seconds(void)
+{
+    struct timespec theTime;
+    clock_gettime(CLOCK_MONOTONIC, &theTime);
+    return (double)theTime.tv_sec + (double)theTime.tv_nsec * 1.0e-9;
+}
+
+#endif /* VocanaDriverTestSupport_h */
@@ -0,0 +1,298 @@
+/*
+     File: VocanaHALSimulatorDenoiseTests.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Drives VocanaVirtualDevice.c built with kDevice_InProcessDenoise through the HAL simulator: the
+ device runs its mixes through the spectral gate without errors or timing faults, declares the
+ gate's latency on its input and plays back, that latency late, exactly what was written while the
+ gate is open, frame for frame; between bursts of a tone it turns the noise down and keeps the tone.
+ It makes the gate again when the sample rate changes.
+
+ */
+
+#include "VocanaHALSimulator.h"
+#include "VocanaHALShim.h"
+#include "VocanaDriverTestSupport.h"
+#include "VocanaProcessor.h"
+#include "VocanaSpectralGate.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define kTest_SearchFrames      1024    //	how far either way a misplaced frame is looked for
+
+typedef enum TestSignal
+{
+    kTestSignal_Jump,           //	quiet noise for a second, then the same noise 40 dB louder
+    kTestSignal_Bursts,         //	a 1 kHz tone on and off every 100 ms in noise 30 dB below it
+} TestSignal;
+
+typedef struct TestRun
+{
+    TestSignal  signal;
+    Float64     sampleRate;
+    UInt32      channels;
+    UInt64      capacity;       //	frames of input kept
+    Float32*    input;          //	what the client read, by sample time
+} TestRun;
+
+//	White noise in [-1, 1) that is a function of the frame, so any frame can be told from another.
+static Float32 test_noise(UInt64 inFrame, UInt32 inChannel)
+{
+    UInt32 theHash = (UInt32)(inFrame * 2654435761u) ^ (inChannel * 0x9E3779B9u);
+    theHash ^= theHash >> 15;
+    theHash *= 0x2C1B3C6Du;
+    theHash ^= theHash >> 12;
+    theHash *= 0x297A2D39u;
+    theHash ^= theHash >> 15;
+    return (Float32)(theHash >> 8) / (Float32)(1u << 24) * 2.0f - 1.0f;
+}
+
+static UInt64 test_burst_frames(const TestRun* inRun)
+{
+    return (UInt64)(inRun->sampleRate / 10.0);
+}
+
+static Float32 test_tone(const TestRun* inRun, UInt64 inFrame)
+{
+    bool isOn = (inFrame / test_burst_frames(inRun)) % 2 == 1;
+    return isOn ? 0.5f * sinf((Float32)(2.0 * M_PI * 1000.0 * (Float64)inFrame / inRun->sampleRate)) : 0.0f;
+}
+
+static Float32 test_signal(const TestRun* inRun, UInt64 inFrame, UInt32 inChannel)
+{
+    if(inRun->signal == kTestSignal_Jump)
+    {
+        return (inFrame < (UInt64)inRun->sampleRate ? 0.005f : 0.5f) * test_noise(inFrame, inChannel);
+    }
+    return test_tone(inRun, inFrame) + 0.0158f * 1.732f * test_noise(inFrame, inChannel);
+}
+
+static void test_fill(void* inContext, UInt64 inFrame, UInt32 inFrameCount, UInt32 inChannels, Float32* outFrames)
+{
+    const TestRun* theRun = (const TestRun*)inContext;
+    for(UInt32 i = 0; i < inFrameCount; i++)
+    {
+        for(UInt32 c = 0; c < inChannels; c++)
+        {
+            outFrames[i * inChannels + c] = test_signal(theRun, inFrame + i, c);
+        }
+    }
+}
+
+static void test_keep_input(void* inContext, UInt32 inClient, UInt64 inFrame, UInt32 inFrameCount, UInt32 inChannels, const Float32* inFrames)
+{
+    TestRun* theRun = (TestRun*)inContext;
+    if(inClient == 0 && inFrame < theRun->capacity && inFrameCount <= theRun->capacity - inFrame)
+    {
+        memcpy(&theRun->input[inFrame * inChannels], inFrames, sizeof(Float32) * inFrameCount * inChannels);
+    }
+}
+
+//	The gate's latency for a format, from a stage of its own.
+static UInt32 test_gate_latency(Float64 inSampleRate, UInt32 inChannelCount)
+{
+    VocanaProcessorConfiguration theConfiguration = { inSampleRate, inChannelCount, 4096 };
+    VocanaProcessorStage theStage;
+    if(VocanaProcessorStage_Init(&theStage, VocanaSpectralGate_GetInterface(), &theConfiguration, 0.25, (uint32_t)inSampleRate, 128) != 0)
+    {
+        return 0;
+    }
+    UInt32 theLatency = VocanaProcessorStage_GetLatency(&theStage);
+    VocanaProcessorStage_Teardown(&theStage);
+    return theLatency;
+}
+
+static UInt32 test_device_latency(AudioObjectID inDevice, AudioObjectPropertyScope inScope)
+{
+    AudioServerPlugInDriverRef theDriver = VocanaHALSimulator_Load();
+    AudioObjectPropertyAddress theAddress = { kAudioDevicePropertyLatency, inScope, kAudioObjectPropertyElementMain };
+    UInt32 theLatency = UINT32_MAX;
+    UInt32 theDataSize = 0;
+    (*theDriver)->GetPropertyData(theDriver, inDevice, 0, &theAddress, 0, NULL, sizeof(theLatency), &theDataSize, &theLatency);
+    return theLatency;
+}
+
+//	Runs a signal through the device for the given time, keeping what the client read.
+static void test_run(TestRun* ioRun, Float64 inSampleRate, TestSignal inSignal, Float64 inSeconds, VocanaHALSimulatorConfig* outConfig)
+{
+    VocanaHALSimulatorConfig theConfig;
+    VocanaHALSimulator_DefaultConfig(&theConfig);
+    theConfig.sampleRate = inSampleRate;
+    theConfig.cycleCount = (UInt64)(inSeconds * inSampleRate / theConfig.bufferFrameSize);
+    theConfig.signalProc = test_fill;
+    theConfig.inputProc = test_keep_input;
+    theConfig.procContext = ioRun;
+
+    ioRun->signal = inSignal;
+    ioRun->sampleRate = inSampleRate;
+    ioRun->channels = theConfig.channelCount;
+    ioRun->capacity = (theConfig.cycleCount + 1) * theConfig.bufferFrameSize;
+    ioRun->input = calloc(ioRun->capacity * ioRun->channels, sizeof(Float32));
+
+    VocanaHALSimulatorReport theReport;
+    VocanaHALSimulator_Run(&theConfig, &theReport);
+    VocanaHALSimulator_PrintReport(stdout, &theConfig, &theReport, false);
+    CHECK_EQUAL(theReport.error, 0);
+    CHECK_EQUAL(theReport.cycles, theConfig.cycleCount);
+    CHECK_EQUAL(theReport.zeroTimeStampErrors, 0);
+    *outConfig = theConfig;
+}
+
+static bool test_frame_matches(const TestRun* inRun, const Float32* inFrame, SInt64 inSignalFrame)
+{
+    if(inSignalFrame < 0)
+    {
+        return false;
+    }
+    for(UInt32 c = 0; c < inRun->channels; c++)
+    {
+        if(fabsf(inFrame[c] - test_signal(inRun, (UInt64)inSignalFrame, c)) > 1.0e-4f)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+//	With the gate wide open after the jump, every frame read must be the frame written a latency
+//	earlier: not silence, not one from before or after it, and not anything else.
+static void test_open_gate_is_frame_exact(Float64 inSampleRate, UInt32 inLatency)
+{
+    TestRun theRun;
+    VocanaHALSimulatorConfig theConfig;
+    test_run(&theRun, inSampleRate, kTestSignal_Jump, 2.0, &theConfig);
+
+    UInt64 theJump = (UInt64)inSampleRate;
+    UInt64 theChecked = 0;
+    UInt64 theCorrect = 0;
+    UInt64 theLost = 0;
+    UInt64 theDuplicated = 0;
+    UInt64 theSkipped = 0;
+    UInt64 theCorrupt = 0;
+    for(UInt64 i = theJump + 2 * inLatency; i < theJump + (UInt64)(inSampleRate / 4); i++)
+    {
+        const Float32* theFrame = &theRun.input[(i + inLatency) * theRun.channels];
+        ++theChecked;
+        if(test_frame_matches(&theRun, theFrame, (SInt64)i))
+        {
+            ++theCorrect;
+            continue;
+        }
+
+        bool isSilent = true;
+        for(UInt32 c = 0; c < theRun.channels; c++)
+        {
+            isSilent = isSilent && theFrame[c] == 0.0f;
+        }
+        if(isSilent)
+        {
+            ++theLost;
+            continue;
+        }
+
+        SInt64 theOffset = 0;
+        for(SInt64 k = 1; k <= kTest_SearchFrames && theOffset == 0; k++)
+        {
+            theOffset = test_frame_matches(&theRun, theFrame, (SInt64)i - k) ? -k : test_frame_matches(&theRun, theFrame, (SInt64)i + k) ? k : 0;
+        }
+        if(theOffset < 0)
+        {
+            ++theDuplicated;
+        }
+        else if(theOffset > 0)
+        {
+            ++theSkipped;
+        }
+        else
+        {
+            ++theCorrupt;
+        }
+    }
+    printf("    open gate: %llu frames, %llu correct (lost %llu dup %llu skip %llu corrupt %llu)\n",
+           (unsigned long long)theChecked, (unsigned long long)theCorrect, (unsigned long long)theLost,
+           (unsigned long long)theDuplicated, (unsigned long long)theSkipped, (unsigned long long)theCorrupt);
+    CHECK(theChecked > 0);
+    CHECK_EQUAL(theCorrect, theChecked);
+    CHECK_EQUAL(theLost, 0);
+    CHECK_EQUAL(theDuplicated, 0);
+    CHECK_EQUAL(theSkipped, 0);
+    CHECK_EQUAL(theCorrupt, 0);
+
+    CHECK_EQUAL(test_device_latency(theConfig.deviceObjectID, kAudioObjectPropertyScopeInput), inLatency);
+    CHECK_EQUAL(test_device_latency(theConfig.deviceObjectID, kAudioObjectPropertyScopeOutput), 0);
+    free(theRun.input);
+}
+
+//	After the first second, the noise between the bursts comes back at least 10 dB down and the
+//	middles of the bursts at the tone's own level, a latency late.
+static void test_gates_noise_between_bursts(Float64 inSampleRate, UInt32 inLatency)
+{
+    TestRun theRun;
+    VocanaHALSimulatorConfig theConfig;
+    test_run(&theRun, inSampleRate, kTestSignal_Bursts, 4.0, &theConfig);
+
+    UInt64 theBurst = test_burst_frames(&theRun);
+    double theNoiseIn = 0.0;
+    double theNoiseOut = 0.0;
+    double theToneCross = 0.0;
+    double theToneEnergy = 0.0;
+    for(UInt64 i = (UInt64)inSampleRate; i + inLatency < theRun.capacity - theConfig.bufferFrameSize; i++)
+    {
+        UInt64 thePosition = i % theBurst;
+        if(thePosition < theBurst / 4 || thePosition >= theBurst * 3 / 4)
+        {
+            continue;
+        }
+        Float32 theClean = test_tone(&theRun, i);
+        for(UInt32 c = 0; c < theRun.channels; c++)
+        {
+            Float32 theIn = test_signal(&theRun, i, c);
+            Float32 theOut = theRun.input[(i + inLatency) * theRun.channels + c];
+            if((i / theBurst) % 2 == 0)
+            {
+                theNoiseIn += (double)theIn * theIn;
+                theNoiseOut += (double)theOut * theOut;
+            }
+            else
+            {
+                theToneCross += (double)theOut * theClean;
+                theToneEnergy += (double)theClean * theClean;
+            }
+        }
+    }
+    double theReduction = 10.0 * log10(theNoiseIn / theNoiseOut);
+    double theToneGain = theToneCross / theToneEnergy;
+    printf("    noise reduced by %.1f dB between bursts, tone kept at %.3f\n", theReduction, theToneGain);
+    CHECK(theReduction > 10.0);
+    CHECK(theToneGain > 0.9 && theToneGain < 1.1);
+    free(theRun.input);
+}
+
+static void run_denoised(Float64 inSampleRate)
+{
+    UInt32 theLatency = test_gate_latency(inSampleRate, 2);
+    CHECK(theLatency > 0);
+    test_open_gate_is_frame_exact(inSampleRate, theLatency);
+    test_gates_noise_between_bursts(inSampleRate, theLatency);
+}
+
+static void test_denoised_loopback(void)
+{
+    run_denoised(48000.0);
+}
+
+static void test_sample_rate_change_remakes_the_gate(void)
+{
+    run_denoised(96000.0);
+    run_denoised(48000.0);
+}
+
+int main(void)
+{
+    RUN_TEST(test_denoised_loopback);
+    RUN_TEST(test_sample_rate_change_remakes_the_gate);
+    return TEST_RESULT();
+}
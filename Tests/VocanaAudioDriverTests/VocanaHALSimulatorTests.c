@@ -0,0 +1,707 @@
+/*
+     File: VocanaHALSimulatorTests.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Drives the real VocanaVirtualDevice.c through the HAL simulator: loopback integrity across
+ buffer sizes, sample rates, channel counts and client counts, mixing of many writers, following a drifting
+ reference clock, plus injected faults to prove the glitch detection catches them. Also checks
+ that devices added at run time are independent of each other, that a device and its mirror
+ can run IO on two threads at once, and times the property queries coreaudiod makes when it
+ walks the driver's objects.
+
+ */
+
+#include "VocanaHALSimulator.h"
+#include "VocanaHALShim.h"
+#include "VocanaDriverTestSupport.h"
+#include "VocanaClock.h"
+#include "VocanaChannels.h"
+#include "VocanaDeviceRegistry.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <string.h>
+
+static void check_clean(const VocanaHALSimulatorConfig* inConfig, const VocanaHALSimulatorReport* inReport)
+{
+    CHECK_EQUAL(inReport->error, 0);
+    CHECK_EQUAL(inReport->cycles, inConfig->cycleCount);
+    CHECK(inReport->framesChecked > 0);
+    CHECK_EQUAL(inReport->framesCorrect, inReport->framesChecked);
+    CHECK_EQUAL(inReport->glitchCycles, 0);
+    CHECK_EQUAL(inReport->zeroTimeStampErrors, 0);
+}
+
+static void test_clean_loopback(void)
+{
+    VocanaHALSimulatorConfig theConfig;
+    VocanaHALSimulator_DefaultConfig(&theConfig);
+
+    VocanaHALSimulatorReport theReport;
+    VocanaHALSimulator_Run(&theConfig, &theReport);
+    VocanaHALSimulator_PrintReport(stdout, &theConfig, &theReport, true);
+
+    check_clean(&theConfig, &theReport);
+
+    //	written at the output time, read back at the input time two buffers later
+    CHECK_CLOSE(theReport.loopbackLatencyFrames, 2 * theConfig.bufferFrameSize, 0.0);
+    CHECK_EQUAL(theReport.zeroTimeStampPeriod, 16384);
+}
+
+static void test_configuration_matrix(void)
+{
+    static const Float64 kSampleRates[] = { 44100.0, 48000.0, 96000.0, 192000.0 };
+    static const UInt32 kBufferSizes[] = { 32, 128, 512, 1024 };
+    static const UInt32 kClientCounts[] = { 1, 4, 16 };
+
+    for(size_t r = 0; r < sizeof(kSampleRates) / sizeof(kSampleRates[0]); r++)
+    {
+        for(size_t b = 0; b < sizeof(kBufferSizes) / sizeof(kBufferSizes[0]); b++)
+        {
+            for(size_t c = 0; c < sizeof(kClientCounts) / sizeof(kClientCounts[0]); c++)
+            {
+                VocanaHALSimulatorConfig theConfig;
+                VocanaHALSimulator_DefaultConfig(&theConfig);
+                theConfig.sampleRate = kSampleRates[r];
+                theConfig.bufferFrameSize = kBufferSizes[b];
+                theConfig.clientCount = kClientCounts[c];
+                theConfig.writingClientCount = kClientCounts[c];
+                theConfig.wakeJitterFrames = kBufferSizes[b] / 4.0;
+                theConfig.cycleCount = (UInt64)(2.0 * kSampleRates[r] / kBufferSizes[b]);   //  two seconds
+
+                VocanaHALSimulatorReport theReport;
+                VocanaHALSimulator_Run(&theConfig, &theReport);
+                VocanaHALSimulator_PrintReport(stdout, &theConfig, &theReport, false);
+
+                check_clean(&theConfig, &theReport);
+            }
+        }
+    }
+}
+
+static void test_mixes_many_writers(void)
+{
+    //	every writer sends its share of the signal; it only comes back whole if the driver summed
+    //	each of them exactly once per cycle
+    VocanaHALSimulatorConfig theConfig;
+    VocanaHALSimulator_DefaultConfig(&theConfig);
+    theConfig.bufferFrameSize = 128;
+    theConfig.clientCount = 40;
+    theConfig.writingClientCount = 24;
+    theConfig.wakeJitterFrames = 32.0;
+    theConfig.cycleCount = 2000;
+
+    VocanaHALSimulatorReport theReport;
+    VocanaHALSimulator_Run(&theConfig, &theReport);
+    VocanaHALSimulator_PrintReport(stdout, &theConfig, &theReport, true);
+
+    check_clean(&theConfig, &theReport);
+    CHECK_CLOSE(theReport.loopbackLatencyFrames, 2 * theConfig.bufferFrameSize, 0.0);
+}
+
+static void test_eight_channel_loopback(void)
+{
+    //	the broadcast layout: every one of the eight channels has to come back on its own slot
+    VocanaHALSimulatorConfig theConfig;
+    VocanaHALSimulator_DefaultConfig(&theConfig);
+    theConfig.channelCount = 8;
+    theConfig.clientCount = 4;
+    theConfig.writingClientCount = 2;
+    theConfig.wakeJitterFrames = 64.0;
+    theConfig.cycleCount = 1000;
+
+    VocanaHALSimulatorReport theReport;
+    VocanaHALSimulator_Run(&theConfig, &theReport);
+    VocanaHALSimulator_PrintReport(stdout, &theConfig, &theReport, true);
+    check_clean(&theConfig, &theReport);
+
+    AudioServerPlugInDriverRef theDriver = VocanaHALSimulator_Load();
+    AudioObjectPropertyAddress theAddress = { kAudioDevicePropertyPreferredChannelLayout, kAudioObjectPropertyScopeOutput, kAudioObjectPropertyElementMain };
+    UInt32 theDataSize = 0;
+    CHECK_EQUAL((*theDriver)->GetPropertyDataSize(theDriver, theConfig.deviceObjectID, 0, &theAddress, 0, NULL, &theDataSize), 0);
+    CHECK_EQUAL(theDataSize, offsetof(AudioChannelLayout, mChannelDescriptions) + 8 * sizeof(AudioChannelDescription));
+
+    //	counts the device can't have are refused up front
+    theAddress.mSelector = kVocanaDevicePropertyChannelCount;
+    theAddress.mScope = kAudioObjectPropertyScopeGlobal;
+    static const SInt32 kBadCounts[] = { 0, kVocanaChannels_MaxChannels + 1 };
+    for(size_t i = 0; i < sizeof(kBadCounts) / sizeof(kBadCounts[0]); i++)
+    {
+        CFNumberRef theNumber = CFNumberCreate(NULL, kCFNumberSInt32Type, &kBadCounts[i]);
+        CHECK((*theDriver)->SetPropertyData(theDriver, theConfig.deviceObjectID, 0, &theAddress, 0, NULL, sizeof(theNumber), &theNumber) != 0);
+    }
+
+    //	and back to stereo for the runs that follow
+    theConfig.channelCount = 2;
+    theConfig.cycleCount = 200;
+    VocanaHALSimulator_Run(&theConfig, &theReport);
+    check_clean(&theConfig, &theReport);
+}
+
+static void test_follows_a_drifting_reference(void)
+{
+    //	a minute next to a reference device 250ppm fast, the way the app would run it next to a USB
+    //	microphone; with a fixed clock the two timelines drift apart by 250ppm of the run
+    VocanaHALSimulatorConfig theConfig;
+    VocanaHALSimulator_DefaultConfig(&theConfig);
+    theConfig.wakeJitterFrames = 64.0;
+    theConfig.cycleCount = (UInt64)(60.0 * theConfig.sampleRate / theConfig.bufferFrameSize);
+    theConfig.referenceDriftPPM = 250.0;
+    theConfig.referenceJitterNanos = 200000.0;
+
+    VocanaHALSimulatorReport theReport;
+    VocanaHALSimulator_Run(&theConfig, &theReport);
+    VocanaHALSimulator_PrintReport(stdout, &theConfig, &theReport, false);
+    check_clean(&theConfig, &theReport);
+    CHECK_CLOSE(theReport.referenceOffsetCreepFrames, -250.0e-6 * 30.0 * theConfig.sampleRate, 2.0);
+
+    //	tracking, the offset left over from acquiring the reference stays put
+    theConfig.trackReference = true;
+    VocanaHALSimulator_Run(&theConfig, &theReport);
+    VocanaHALSimulator_PrintReport(stdout, &theConfig, &theReport, false);
+    check_clean(&theConfig, &theReport);
+    CHECK_CLOSE(theReport.trackedDriftPPM, theConfig.referenceDriftPPM, 2.0);
+    CHECK_CLOSE(theReport.referenceOffsetCreepFrames, 0.0, 1.0);
+    CHECK_CLOSE(theReport.loopbackLatencyFrames, 2 * theConfig.bufferFrameSize, 0.0);
+
+    //	and the next run is back on the fixed clock
+    theConfig.trackReference = false;
+    theConfig.referenceDriftPPM = 0.0;
+    theConfig.cycleCount = 1000;
+    VocanaHALSimulator_Run(&theConfig, &theReport);
+    check_clean(&theConfig, &theReport);
+    CHECK_CLOSE(theReport.referenceOffsetFrames, 0.0, 1.0);
+}
+
+static void test_detects_skipped_writes(void)
+{
+    VocanaHALSimulatorConfig theConfig;
+    VocanaHALSimulator_DefaultConfig(&theConfig);
+    theConfig.fault = kVocanaHALSimulatorFault_SkipWrite;
+    theConfig.faultEveryCycles = 50;
+
+    VocanaHALSimulatorReport theReport;
+    VocanaHALSimulator_Run(&theConfig, &theReport);
+    VocanaHALSimulator_PrintReport(stdout, &theConfig, &theReport, false);
+
+    UInt64 theFaults = theConfig.cycleCount / theConfig.faultEveryCycles;
+    CHECK_EQUAL(theReport.error, 0);
+    CHECK(theReport.glitchCycles >= theFaults - 1);
+    CHECK(theReport.framesLost >= (theFaults - 1) * theConfig.bufferFrameSize);
+    CHECK_EQUAL(theReport.framesDuplicated, 0);
+    CHECK_EQUAL(theReport.framesCorrupt, 0);
+}
+
+static void test_detects_repeated_writes(void)
+{
+    VocanaHALSimulatorConfig theConfig;
+    VocanaHALSimulator_DefaultConfig(&theConfig);
+    theConfig.fault = kVocanaHALSimulatorFault_RepeatWrite;
+    theConfig.faultEveryCycles = 50;
+
+    VocanaHALSimulatorReport theReport;
+    VocanaHALSimulator_Run(&theConfig, &theReport);
+    VocanaHALSimulator_PrintReport(stdout, &theConfig, &theReport, false);
+
+    UInt64 theFaults = theConfig.cycleCount / theConfig.faultEveryCycles;
+    CHECK_EQUAL(theReport.error, 0);
+    CHECK(theReport.framesDuplicated >= (theFaults - 1) * theConfig.bufferFrameSize);
+    CHECK_EQUAL(theReport.framesLost, 0);
+    CHECK_EQUAL(theReport.framesCorrupt, 0);
+}
+
+static void test_detects_overload_drops(void)
+{
+    VocanaHALSimulatorConfig theConfig;
+    VocanaHALSimulator_DefaultConfig(&theConfig);
+    theConfig.fault = kVocanaHALSimulatorFault_Overload;
+    theConfig.faultEveryCycles = 50;
+
+    VocanaHALSimulatorReport theReport;
+    VocanaHALSimulator_Run(&theConfig, &theReport);
+    VocanaHALSimulator_PrintReport(stdout, &theConfig, &theReport, false);
+
+    //	the driver drops the late write, which comes back as silence rather than stale data
+    CHECK_EQUAL(theReport.error, 0);
+    CHECK(theReport.framesLost > 0);
+    CHECK_EQUAL(theReport.framesDuplicated, 0);
+    CHECK_EQUAL(theReport.framesSkipped, 0);
+    CHECK_EQUAL(theReport.framesCorrupt, 0);
+}
+
+static void test_trim_between_runs(void)
+{
+    //	a memory pressure trim while idle must not break the next run
+    CHECK(VocanaHALSimulator_Load() != NULL);
+    CHECK_EQUAL(VocanaHALShim_SignalMemoryPressure(), 1);
+
+    VocanaHALSimulatorConfig theConfig;
+    VocanaHALSimulator_DefaultConfig(&theConfig);
+    theConfig.cycleCount = 200;
+
+    VocanaHALSimulatorReport theReport;
+    VocanaHALSimulator_Run(&theConfig, &theReport);
+    check_clean(&theConfig, &theReport);
+}
+
+static OSStatus set_device_count(AudioServerPlugInDriverRef inDriver, SInt32 inCount)
+{
+    AudioObjectPropertyAddress theAddress = { kVocanaPlugInPropertyDeviceCount, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMain };
+    CFNumberRef theNumber = CFNumberCreate(NULL, kCFNumberSInt32Type, &inCount);
+    return (*inDriver)->SetPropertyData(inDriver, kAudioObjectPlugInObject, 0, &theAddress, 0, NULL, sizeof(theNumber), &theNumber);
+}
+
+static UInt32 copy_device_list(AudioServerPlugInDriverRef inDriver, AudioObjectID* outDevices, UInt32 inMaxDevices)
+{
+    AudioObjectPropertyAddress theAddress = { kAudioPlugInPropertyDeviceList, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMain };
+    UInt32 theDataSize = 0;
+    if((*inDriver)->GetPropertyData(inDriver, kAudioObjectPlugInObject, 0, &theAddress, 0, NULL, inMaxDevices * (UInt32)sizeof(AudioObjectID), &theDataSize, outDevices) != 0)
+    {
+        return 0;
+    }
+    return theDataSize / (UInt32)sizeof(AudioObjectID);
+}
+
+static AudioObjectID device_stream(AudioServerPlugInDriverRef inDriver, AudioObjectID inDevice, AudioObjectPropertyScope inScope)
+{
+    AudioObjectPropertyAddress theAddress = { kAudioDevicePropertyStreams, inScope, kAudioObjectPropertyElementMain };
+    AudioObjectID theStream = kAudioObjectUnknown;
+    UInt32 theDataSize = 0;
+    (*inDriver)->GetPropertyData(inDriver, inDevice, 0, &theAddress, 0, NULL, sizeof(theStream), &theDataSize, &theStream);
+    return theStream;
+}
+
+//	The cycle info the HAL would hand over for one cycle of 512 frames.
+static void make_cycle_info(UInt64 inCycle, AudioServerPlugInIOCycleInfo* outCycleInfo)
+{
+    memset(outCycleInfo, 0, sizeof(*outCycleInfo));
+    outCycleInfo->mIOCycleCounter = inCycle;
+    outCycleInfo->mNominalIOBufferFrameSize = 512;
+    outCycleInfo->mCurrentTime.mSampleTime = (Float64)(inCycle * 512);
+    outCycleInfo->mCurrentTime.mRateScalar = 1.0;
+    outCycleInfo->mCurrentTime.mFlags = kAudioTimeStampSampleTimeValid | kAudioTimeStampRateScalarValid;
+    outCycleInfo->mInputTime = outCycleInfo->mCurrentTime;
+    outCycleInfo->mInputTime.mSampleTime -= 512;
+    outCycleInfo->mOutputTime = outCycleInfo->mCurrentTime;
+}
+
+//	One cycle's WriteMix of a client: every sample of ioBuffer, 512 stereo frames, set to inValue.
+static void write_client_cycle(AudioServerPlugInDriverRef inDriver, AudioObjectID inDevice, AudioObjectID inStream, UInt32 inClientID, UInt64 inCycle, Float32* ioBuffer, Float32 inValue)
+{
+    AudioServerPlugInIOCycleInfo theCycleInfo;
+    make_cycle_info(inCycle, &theCycleInfo);
+    for(UInt32 i = 0; i < 512 * 2; i++)
+    {
+        ioBuffer[i] = inValue;
+    }
+    (*inDriver)->BeginIOOperation(inDriver, inDevice, inClientID, kAudioServerPlugInIOOperationWriteMix, 512, &theCycleInfo);
+    (*inDriver)->DoIOOperation(inDriver, inDevice, inStream, inClientID, kAudioServerPlugInIOOperationWriteMix, 512, &theCycleInfo, ioBuffer, NULL);
+    (*inDriver)->EndIOOperation(inDriver, inDevice, inClientID, kAudioServerPlugInIOOperationWriteMix, 512, &theCycleInfo);
+}
+
+//	One cycle's ReadInput of a client into ioBuffer, 512 stereo frames, which start out garbage.
+static void read_client_cycle(AudioServerPlugInDriverRef inDriver, AudioObjectID inDevice, AudioObjectID inStream, UInt32 inClientID, UInt64 inCycle, Float32* ioBuffer)
+{
+    AudioServerPlugInIOCycleInfo theCycleInfo;
+    make_cycle_info(inCycle, &theCycleInfo);
+    memset(ioBuffer, 0xff, 512 * 2 * sizeof(Float32));
+    (*inDriver)->BeginIOOperation(inDriver, inDevice, inClientID, kAudioServerPlugInIOOperationReadInput, 512, &theCycleInfo);
+    (*inDriver)->DoIOOperation(inDriver, inDevice, inStream, inClientID, kAudioServerPlugInIOOperationReadInput, 512, &theCycleInfo, ioBuffer, NULL);
+    (*inDriver)->EndIOOperation(inDriver, inDevice, inClientID, kAudioServerPlugInIOOperationReadInput, 512, &theCycleInfo);
+}
+
+//	Two cycles of one client on one device: writes inWriteValue into the output when it isn't zero,
+//	then reads the same frames back from the input and returns their first sample.
+static Float32 run_client_cycle(AudioServerPlugInDriverRef inDriver, AudioObjectID inDevice, UInt32 inClientID, UInt64 inCycle, Float32 inWriteValue)
+{
+    static Float32 sBuffer[512 * 2];
+    if(inWriteValue != 0.0f)
+    {
+        write_client_cycle(inDriver, inDevice, device_stream(inDriver, inDevice, kAudioObjectPropertyScopeOutput), inClientID, inCycle, sBuffer, inWriteValue);
+    }
+
+    //	a cycle later the input side has caught up with what was just written
+    read_client_cycle(inDriver, inDevice, device_stream(inDriver, inDevice, kAudioObjectPropertyScopeInput), inClientID, inCycle + 1, sBuffer);
+    return sBuffer[0];
+}
+
+static void test_independent_devices(void)
+{
+    AudioServerPlugInDriverRef theDriver = VocanaHALSimulator_Load();
+    CHECK(theDriver != NULL);
+    if(theDriver == NULL)
+    {
+        return;
+    }
+
+    //	three devices, each published with its mirror; the first keeps the ID it always had
+    CHECK_EQUAL(set_device_count(theDriver, 3), 0);
+    AudioObjectID theDevices[2 * kVocanaDeviceRegistry_MaxDevices];
+    UInt32 theDeviceCount = copy_device_list(theDriver, theDevices, 2 * kVocanaDeviceRegistry_MaxDevices);
+    CHECK_EQUAL(theDeviceCount, 6);
+    CHECK_EQUAL(theDevices[0], 3);
+    for(UInt32 i = 0; i < theDeviceCount; i++)
+    {
+        for(UInt32 j = i + 1; j < theDeviceCount; j++)
+        {
+            CHECK(theDevices[i] != theDevices[j]);
+        }
+    }
+    if(theDeviceCount != 6)
+    {
+        return;
+    }
+
+    //	the simulator runs just as cleanly against a device added at run time
+    VocanaHALSimulatorConfig theConfig;
+    VocanaHALSimulator_DefaultConfig(&theConfig);
+    theConfig.deviceObjectID = theDevices[2];
+    theConfig.cycleCount = 200;
+    VocanaHALSimulatorReport theReport;
+    VocanaHALSimulator_Run(&theConfig, &theReport);
+    check_clean(&theConfig, &theReport);
+
+    //	what one device's clients write comes back on that device only
+    AudioObjectID theDeviceA = theDevices[0];
+    AudioObjectID theDeviceB = theDevices[2];
+    AudioServerPlugInClientInfo theClientA = { 1, (pid_t)2000, true, NULL };
+    AudioServerPlugInClientInfo theClientB = { 2, (pid_t)2001, true, NULL };
+    CHECK_EQUAL((*theDriver)->AddDeviceClient(theDriver, theDeviceA, &theClientA), 0);
+    CHECK_EQUAL((*theDriver)->AddDeviceClient(theDriver, theDeviceB, &theClientB), 0);
+    CHECK_EQUAL((*theDriver)->StartIO(theDriver, theDeviceA, theClientA.mClientID), 0);
+    CHECK_EQUAL((*theDriver)->StartIO(theDriver, theDeviceB, theClientB.mClientID), 0);
+    CHECK_CLOSE(run_client_cycle(theDriver, theDeviceA, theClientA.mClientID, 10, 0.25f), 0.25f, 1.0e-6);
+    CHECK_CLOSE(run_client_cycle(theDriver, theDeviceB, theClientB.mClientID, 10, 0.0f), 0.0f, 1.0e-6);
+
+    //	a running device is not taken away
+    CHECK(set_device_count(theDriver, 1) != 0);
+    CHECK_EQUAL(copy_device_list(theDriver, theDevices, 2 * kVocanaDeviceRegistry_MaxDevices), 6);
+
+    CHECK_EQUAL((*theDriver)->StopIO(theDriver, theDeviceA, theClientA.mClientID), 0);
+    CHECK_EQUAL((*theDriver)->StopIO(theDriver, theDeviceB, theClientB.mClientID), 0);
+    CHECK_EQUAL((*theDriver)->RemoveDeviceClient(theDriver, theDeviceA, &theClientA), 0);
+    CHECK_EQUAL((*theDriver)->RemoveDeviceClient(theDriver, theDeviceB, &theClientB), 0);
+
+    //	a stopped one is, and its IDs stop answering
+    CHECK_EQUAL(set_device_count(theDriver, 1), 0);
+    CHECK_EQUAL(copy_device_list(theDriver, theDevices, 2 * kVocanaDeviceRegistry_MaxDevices), 2);
+    CHECK_EQUAL(theDevices[0], theDeviceA);
+    AudioObjectPropertyAddress theAddress = { kAudioObjectPropertyName, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMain };
+    CHECK(!(*theDriver)->HasProperty(theDriver, theDeviceB, 0, &theAddress));
+    CHECK((*theDriver)->HasProperty(theDriver, theDeviceA, 0, &theAddress));
+}
+
+//	The device and its mirror each run on an IO thread of their own, as the HAL runs them. Both
+//	threads ask for the shared clock's zero time stamp and write a cycle at the same time, then
+//	both read it back, in lockstep. The first lane moves the host clock along.
+typedef struct ConcurrentLane
+{
+    AudioServerPlugInDriverRef  driver;
+    AudioObjectID               device;
+    UInt32                      writeClientID;
+    Float32                     value;
+    UInt64                      cycles;
+    UInt64                      badReads;
+    UInt64                      badZeroTimeStamps;
+    Float32                     buffer[512 * 2];
+} ConcurrentLane;
+
+static _Atomic uint32_t gConcurrent_Arrived;
+static _Atomic uint32_t gConcurrent_Phase;
+
+//	Waits for both lanes. Spins with sched_yield so it needs no pthread_barrier, which macOS lacks.
+static void concurrent_barrier(void)
+{
+    uint32_t thePhase = atomic_load(&gConcurrent_Phase);
+    if(atomic_fetch_add(&gConcurrent_Arrived, 1) == 1)
+    {
+        atomic_store(&gConcurrent_Arrived, 0);
+        atomic_store(&gConcurrent_Phase, thePhase + 1);
+    }
+    while(atomic_load(&gConcurrent_Phase) == thePhase)
+    {
+        sched_yield();
+    }
+}
+
+static void* concurrent_lane(void* inContext)
+{
+    ConcurrentLane* theLane = inContext;
+    AudioServerPlugInDriverRef theDriver = theLane->driver;
+    AudioObjectID theOutput = device_stream(theDriver, theLane->device, kAudioObjectPropertyScopeOutput);
+    AudioObjectID theInput = device_stream(theDriver, theLane->device, kAudioObjectPropertyScopeInput);
+    AudioObjectPropertyAddress thePeriodAddress = { kAudioDevicePropertyZeroTimeStampPeriod, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMain };
+    UInt32 thePeriod = 0;
+    UInt32 theDataSize = 0;
+    (*theDriver)->GetPropertyData(theDriver, theLane->device, 0, &thePeriodAddress, 0, NULL, sizeof(thePeriod), &theDataSize, &thePeriod);
+    Float64 theLastSampleTime = 0.0;
+    for(UInt64 theCycle = 10; theCycle < 10 + theLane->cycles; theCycle++)
+    {
+        //	both devices see the one timeline, whole periods at a time
+        if(theLane->writeClientID != 0)
+        {
+            VocanaHALShim_SetHostTime(VocanaHALShim_GetHostTime() + 512 * 1000000000ull / 48000);
+        }
+        Float64 theSampleTime = 0.0;
+        UInt64 theHostTime = 0;
+        UInt64 theSeed = 0;
+        (*theDriver)->GetZeroTimeStamp(theDriver, theLane->device, 0, &theSampleTime, &theHostTime, &theSeed);
+        bool isWholePeriods = thePeriod > 0 && fmod(theSampleTime, (Float64)thePeriod) == 0.0 && theSampleTime >= theLastSampleTime;
+        theLane->badZeroTimeStamps += isWholePeriods ? 0 : 1;
+        theLastSampleTime = theSampleTime;
+
+        write_client_cycle(theDriver, theLane->device, theOutput, theLane->writeClientID, theCycle, theLane->buffer, theLane->value);
+        concurrent_barrier();
+
+        //	both lanes' output comes back on both inputs, whole: a half-summed or torn cycle would
+        //	leave some frames at something other than the sum
+        read_client_cycle(theDriver, theLane->device, theInput, theLane->writeClientID, theCycle + 1, theLane->buffer);
+        bool isSummed = true;
+        for(UInt32 i = 0; i < 512 * 2; i++)
+        {
+            isSummed = isSummed && theLane->buffer[i] == 0.75f;
+        }
+        theLane->badReads += isSummed ? 0 : 1;
+        concurrent_barrier();
+    }
+    return NULL;
+}
+
+static void test_device_and_mirror_run_concurrently(void)
+{
+    AudioServerPlugInDriverRef theDriver = VocanaHALSimulator_Load();
+    CHECK(theDriver != NULL);
+    if(theDriver == NULL)
+    {
+        return;
+    }
+    AudioObjectID theDevices[2 * kVocanaDeviceRegistry_MaxDevices];
+    CHECK(copy_device_list(theDriver, theDevices, 2 * kVocanaDeviceRegistry_MaxDevices) >= 2);
+
+    //	the device's client writes on its own, the mirror writes the way the real HAL does, once a
+    //	cycle under a client ID it never registered
+    AudioServerPlugInClientInfo theClient = { 21, (pid_t)2100, true, NULL };
+    ConcurrentLane theLanes[2] = {
+        { theDriver, theDevices[0], theClient.mClientID, 0.25f, 2000, 0, 0, { 0 } },
+        { theDriver, theDevices[1], 0, 0.5f, 2000, 0, 0, { 0 } },
+    };
+    CHECK_EQUAL((*theDriver)->AddDeviceClient(theDriver, theLanes[0].device, &theClient), 0);
+    for(UInt32 i = 0; i < 2; i++)
+    {
+        CHECK_EQUAL((*theDriver)->StartIO(theDriver, theLanes[i].device, theClient.mClientID), 0);
+    }
+
+    atomic_store(&gConcurrent_Arrived, 0);
+    atomic_store(&gConcurrent_Phase, 0);
+    pthread_t theThreads[2];
+    for(UInt32 i = 0; i < 2; i++)
+    {
+        CHECK_EQUAL(pthread_create(&theThreads[i], NULL, concurrent_lane, &theLanes[i]), 0);
+    }
+    for(UInt32 i = 0; i < 2; i++)
+    {
+        pthread_join(theThreads[i], NULL);
+        CHECK_EQUAL(theLanes[i].badReads, 0);
+        CHECK_EQUAL(theLanes[i].badZeroTimeStamps, 0);
+    }
+    Float64 theSampleTime = 0.0;
+    UInt64 theHostTime = 0;
+    UInt64 theSeed = 0;
+    CHECK_EQUAL((*theDriver)->GetZeroTimeStamp(theDriver, theLanes[1].device, 0, &theSampleTime, &theHostTime, &theSeed), 0);
+    CHECK(theSampleTime > 0.0);
+
+    for(UInt32 i = 0; i < 2; i++)
+    {
+        CHECK_EQUAL((*theDriver)->StopIO(theDriver, theLanes[i].device, theClient.mClientID), 0);
+    }
+    CHECK_EQUAL((*theDriver)->RemoveDeviceClient(theDriver, theLanes[0].device, &theClient), 0);
+
+    //	with the mirror stopped, the device plays back its own output alone again
+    CHECK_EQUAL((*theDriver)->StartIO(theDriver, theLanes[0].device, theClient.mClientID), 0);
+    CHECK_CLOSE(run_client_cycle(theDriver, theLanes[0].device, 0, 10, 0.25f), 0.25f, 1.0e-6);
+    CHECK_EQUAL((*theDriver)->StopIO(theDriver, theLanes[0].device, theClient.mClientID), 0);
+}
+
+//	Every selector the HAL shim knows plus the device's custom ones, asked of every object in every
+//	scope, the way coreaudiod walks a plug-in when it loads it and whenever a client lists devices.
+static const AudioObjectPropertySelector kEnumeration_Selectors[] = {
+    kAudioObjectPropertyBaseClass, kAudioObjectPropertyClass, kAudioObjectPropertyOwner, kAudioObjectPropertyName,
+    kAudioObjectPropertyModelName, kAudioObjectPropertyManufacturer, kAudioObjectPropertyElementName,
+    kAudioObjectPropertyOwnedObjects, kAudioObjectPropertyIdentify, kAudioObjectPropertySerialNumber,
+    kAudioObjectPropertyFirmwareVersion, kAudioObjectPropertyCustomPropertyInfoList, kAudioObjectPropertyControlList,
+    kAudioPlugInPropertyBundleID, kAudioPlugInPropertyDeviceList, kAudioPlugInPropertyTranslateUIDToDevice,
+    kAudioPlugInPropertyBoxList, kAudioPlugInPropertyTranslateUIDToBox, kAudioPlugInPropertyResourceBundle,
+    kAudioBoxPropertyBoxUID, kAudioBoxPropertyTransportType, kAudioBoxPropertyHasAudio, kAudioBoxPropertyHasVideo,
+    kAudioBoxPropertyHasMIDI, kAudioBoxPropertyIsProtected, kAudioBoxPropertyAcquired, kAudioBoxPropertyAcquisitionFailed,
+    kAudioBoxPropertyDeviceList, kAudioDevicePropertyConfigurationApplication, kAudioDevicePropertyDeviceUID,
+    kAudioDevicePropertyModelUID, kAudioDevicePropertyRelatedDevices, kAudioDevicePropertyClockDomain,
+    kAudioDevicePropertyDeviceIsAlive, kAudioDevicePropertyDeviceIsRunning, kAudioDevicePropertyDeviceCanBeDefaultDevice,
+    kAudioDevicePropertyDeviceCanBeDefaultSystemDevice, kAudioDevicePropertyLatency, kAudioDevicePropertyStreams,
+    kAudioDevicePropertySafetyOffset, kAudioDevicePropertyNominalSampleRate, kAudioDevicePropertyAvailableNominalSampleRates,
+    kAudioDevicePropertyIcon, kAudioDevicePropertyIsHidden, kAudioDevicePropertyPreferredChannelsForStereo,
+    kAudioDevicePropertyPreferredChannelLayout, kAudioDevicePropertyZeroTimeStampPeriod, kAudioDevicePropertyClockAlgorithm,
+    kAudioDevicePropertyClockIsStable, kAudioStreamPropertyIsActive, kAudioStreamPropertyDirection,
+    kAudioStreamPropertyTerminalType, kAudioStreamPropertyStartingChannel, kAudioStreamPropertyVirtualFormat,
+    kAudioStreamPropertyAvailableVirtualFormats, kAudioStreamPropertyPhysicalFormat, kAudioStreamPropertyAvailablePhysicalFormats,
+    kAudioControlPropertyScope, kAudioControlPropertyElement, kAudioLevelControlPropertyScalarValue,
+    kAudioLevelControlPropertyDecibelValue, kAudioLevelControlPropertyDecibelRange, kAudioLevelControlPropertyConvertScalarToDecibels,
+    kAudioLevelControlPropertyConvertDecibelsToScalar, kAudioBooleanControlPropertyValue, kAudioSelectorControlPropertyCurrentItem,
+    kAudioSelectorControlPropertyAvailableItems, kAudioSelectorControlPropertyItemName, kAudioStereoPanControlPropertyValue,
+    kVocanaDevicePropertyClockReference, kVocanaDevicePropertyClockStatistics, kVocanaDevicePropertyChannelCount,
+};
+
+static const AudioObjectPropertyScope kEnumeration_Scopes[] = {
+    kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyScopeInput, kAudioObjectPropertyScopeOutput,
+};
+
+//	The plug-in and everything it owns, found through kAudioObjectPropertyOwnedObjects.
+static UInt32 enumerate_objects(AudioServerPlugInDriverRef inDriver, AudioObjectID* outObjects, UInt32 inMaxObjects)
+{
+    UInt32 theCount = 0;
+    outObjects[theCount++] = kAudioObjectPlugInObject;
+    for(UInt32 theIndex = 0; theIndex < theCount; theIndex++)
+    {
+        AudioObjectPropertyAddress theAddress = { kAudioObjectPropertyOwnedObjects, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMain };
+        AudioObjectID theOwned[32];
+        UInt32 theDataSize = 0;
+        if((*inDriver)->GetPropertyData(inDriver, outObjects[theIndex], 0, &theAddress, 0, NULL, sizeof(theOwned), &theDataSize, theOwned) != 0)
+        {
+            continue;
+        }
+        for(UInt32 theOwnedIndex = 0; theOwnedIndex < theDataSize / sizeof(AudioObjectID) && theCount < inMaxObjects; theOwnedIndex++)
+        {
+            bool isKnown = false;
+            for(UInt32 theKnown = 0; theKnown < theCount; theKnown++)
+            {
+                isKnown = isKnown || outObjects[theKnown] == theOwned[theOwnedIndex];
+            }
+            if(!isKnown)
+            {
+                outObjects[theCount++] = theOwned[theOwnedIndex];
+            }
+        }
+    }
+    return theCount;
+}
+
+//	Asks the driver for a property's data, which the table hands to the getter of the object's class,
+//	the selector switch that answers it.
+static OSStatus get_property_data(AudioServerPlugInDriverRef inDriver, AudioObjectID inObject, const AudioObjectPropertyAddress* inAddress, UInt32* outDataSize)
+{
+    static UInt8 theData[1024] __attribute__((aligned(16)));
+    return (*inDriver)->GetPropertyData(inDriver, inObject, 0, inAddress, 0, NULL, sizeof(theData), outDataSize, theData);
+}
+
+//	The questions the table answers by itself (HasProperty, IsPropertySettable, GetPropertyDataSize)
+//	and GetPropertyData, which it dispatches to the class's getter, must agree on every object,
+//	selector and scope. The times are informational: the first is the table's lookup alone, the
+//	second adds the getter's switch on the selector, the ladder every question used to go through.
+static void test_property_enumeration(void)
+{
+    AudioServerPlugInDriverRef theDriver = VocanaHALSimulator_Load();
+    CHECK(theDriver != NULL);
+    if(theDriver == NULL)
+    {
+        return;
+    }
+
+    AudioObjectID theObjects[32];
+    UInt32 theObjectCount = enumerate_objects(theDriver, theObjects, 32);
+    CHECK(theObjectCount >= 8);
+
+    const UInt32 kSelectorCount = sizeof(kEnumeration_Selectors) / sizeof(kEnumeration_Selectors[0]);
+    const UInt32 kScopeCount = sizeof(kEnumeration_Scopes) / sizeof(kEnumeration_Scopes[0]);
+    const UInt32 kPasses = 200;
+
+    UInt64 theProperties = 0;
+    UInt64 theInconsistencies = 0;
+    for(UInt32 theObject = 0; theObject < theObjectCount; theObject++)
+    {
+        for(UInt32 theSelector = 0; theSelector < kSelectorCount; theSelector++)
+        {
+            for(UInt32 theScope = 0; theScope < kScopeCount; theScope++)
+            {
+                AudioObjectPropertyAddress theAddress = { kEnumeration_Selectors[theSelector], kEnumeration_Scopes[theScope], kAudioObjectPropertyElementMain };
+                UInt32 theDataSize = 0;
+                OSStatus theGetError = get_property_data(theDriver, theObjects[theObject], &theAddress, &theDataSize);
+                if(!(*theDriver)->HasProperty(theDriver, theObjects[theObject], 0, &theAddress))
+                {
+                    theInconsistencies += theGetError != kAudioHardwareUnknownPropertyError;
+                    continue;
+                }
+                ++theProperties;
+
+                //	anything the driver says it has must answer the other questions too, and its data
+                //	must fit the size it declares; a getter may still want a qualifier this doesn't pass
+                Boolean isSettable = false;
+                UInt32 theDeclaredSize = 0;
+                if((*theDriver)->IsPropertySettable(theDriver, theObjects[theObject], 0, &theAddress, &isSettable) != 0 ||
+                   (*theDriver)->GetPropertyDataSize(theDriver, theObjects[theObject], 0, &theAddress, 0, NULL, &theDeclaredSize) != 0 ||
+                   theGetError == kAudioHardwareUnknownPropertyError || (theGetError == 0 && theDataSize > theDeclaredSize))
+                {
+                    ++theInconsistencies;
+                }
+            }
+        }
+    }
+    CHECK_EQUAL(theInconsistencies, 0);
+    CHECK(theProperties > 0);
+
+    double theTimes[2];
+    for(UInt32 theWay = 0; theWay < 2; theWay++)
+    {
+        UInt64 theQueries = 0;
+        double theStart = test_now_seconds();
+        for(UInt32 thePass = 0; thePass < kPasses; thePass++)
+        {
+            for(UInt32 theObject = 0; theObject < theObjectCount; theObject++)
+            {
+                for(UInt32 theSelector = 0; theSelector < kSelectorCount; theSelector++)
+                {
+                    for(UInt32 theScope = 0; theScope < kScopeCount; theScope++)
+                    {
+                        AudioObjectPropertyAddress theAddress = { kEnumeration_Selectors[theSelector], kEnumeration_Scopes[theScope], kAudioObjectPropertyElementMain };
+                        UInt32 theDataSize = 0;
+                        if(theWay == 0)
+                        {
+                            Boolean isSettable = false;
+                            (*theDriver)->HasProperty(theDriver, theObjects[theObject], 0, &theAddress);
+                            (*theDriver)->IsPropertySettable(theDriver, theObjects[theObject], 0, &theAddress, &isSettable);
+                            (*theDriver)->GetPropertyDataSize(theDriver, theObjects[theObject], 0, &theAddress, 0, NULL, &theDataSize);
+                            theQueries += 3;
+                        }
+                        else
+                        {
+                            get_property_data(theDriver, theObjects[theObject], &theAddress, &theDataSize);
+                            ++theQueries;
+                        }
+                    }
+                }
+            }
+        }
+        theTimes[theWay] = (test_now_seconds() - theStart) * 1.0e9 / (double)theQueries;
+    }
+
+    printf("    %u objects, %llu properties found, %.1f ns per table question, %.1f ns per GetPropertyData\n", (unsigned)theObjectCount,
+           (unsigned long long)theProperties, theTimes[0], theTimes[1]);
+}
+
+int main(void)
+{
+    RUN_TEST(test_clean_loopback);
+    RUN_TEST(test_configuration_matrix);
+    RUN_TEST(test_mixes_many_writers);
+    RUN_TEST(test_eight_channel_loopback);
+    RUN_TEST(test_follows_a_drifting_reference);
+    RUN_TEST(test_detects_skipped_writes);
+    RUN_TEST(test_detects_repeated_writes);
+    RUN_TEST(test_detects_overload_drops);
+    RUN_TEST(test_trim_between_runs);
+    RUN_TEST(test_independent_devices);
+    RUN_TEST(test_device_and_mirror_run_concurrently);
+    RUN_TEST(test_property_enumeration);
+    return TEST_RESULT();
+}
@@ -0,0 +1,393 @@
+/*
+     File: VocanaMixBusTests.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Host-side tests for VocanaMixBus: summing, clipping, cycle publishing and the client table.
+
+ */
+
+#include "VocanaMixBus.h"
+#include "VocanaDriverTestSupport.h"
+
+#include <errno.h>
+#include <string.h>
+
+#define kTest_Channels          2
+#define kTest_CapacityFrames    2048
+#define kTest_Frames            256
+
+static void test_fill_constant(float* outFrames, uint32_t inFrameCount, float inValue)
+{
+    for(uint32_t i = 0; i < inFrameCount * kTest_Channels; i++)
+    {
+        outFrames[i] = inValue;
+    }
+}
+
+//	Returns true if every sample of the range reads back as inValue.
+static bool test_reads_constant(VocanaRingBuffer* inRing, uint64_t inFrame, float inValue)
+{
+    float theOut[kTest_Frames * kTest_Channels];
+    memset(theOut, 0xff, sizeof(theOut));
+    if(VocanaRingBuffer_Read(inRing, inFrame, theOut, kTest_Frames) != kTest_Frames)
+    {
+        return false;
+    }
+    for(uint32_t i = 0; i < kTest_Frames * kTest_Channels; i++)
+    {
+        if(theOut[i] != inValue)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void test_setup(VocanaMixBus* outMixBus, VocanaRingBuffer* outRing, uint32_t inClientCount)
+{
+    CHECK_EQUAL(VocanaMixBus_Init(outMixBus, kTest_Frames, kTest_Channels, 1.0f), 0);
+    CHECK_EQUAL(VocanaRingBuffer_Init(outRing, kTest_CapacityFrames, kTest_Channels, 0), 0);
+    for(uint32_t i = 0; i < inClientCount; i++)
+    {
+        CHECK(VocanaMixBus_AddClient(outMixBus, 100 + i));
+    }
+}
+
+static void test_teardown(VocanaMixBus* inMixBus, VocanaRingBuffer* inRing)
+{
+    VocanaMixBus_Teardown(inMixBus);
+    VocanaRingBuffer_Teardown(inRing);
+}
+
+static void test_init_rejects_bad_arguments(void)
+{
+    VocanaMixBus theMixBus;
+    CHECK(VocanaMixBus_Init(NULL, kTest_Frames, kTest_Channels, 1.0f) != 0);
+    CHECK(VocanaMixBus_Init(&theMixBus, 0, kTest_Channels, 1.0f) != 0);
+    CHECK(VocanaMixBus_Init(&theMixBus, kTest_Frames, 0, 1.0f) != 0);
+    CHECK(VocanaMixBus_Init(&theMixBus, kTest_Frames, kTest_Channels, 0.0f) != 0);
+}
+
+static void test_sums_clients(void)
+{
+    VocanaMixBus theMixBus;
+    VocanaRingBuffer theRing;
+    test_setup(&theMixBus, &theRing, 3);
+
+    float theIn[kTest_Frames * kTest_Channels];
+
+    //	first cycle: the bus expects one writer, so every later writer republishes the sum
+    for(uint32_t c = 0; c < 3; c++)
+    {
+        test_fill_constant(theIn, kTest_Frames, 0.125f * (c + 1));
+        CHECK(VocanaMixBus_Mix(&theMixBus, &theRing, 100 + c, 0, theIn, kTest_Frames));
+        VocanaMixBus_EndMix(&theMixBus, &theRing);
+    }
+    CHECK(test_reads_constant(&theRing, 0, 0.75f));
+
+    //	second cycle: nothing is published until the third writer is in
+    for(uint32_t c = 0; c < 3; c++)
+    {
+        CHECK_EQUAL(VocanaRingBuffer_GetWriteFrame(&theRing), kTest_Frames);
+        test_fill_constant(theIn, kTest_Frames, 0.125f * (c + 1));
+        CHECK(VocanaMixBus_Mix(&theMixBus, &theRing, 100 + c, kTest_Frames, theIn, kTest_Frames));
+        VocanaMixBus_EndMix(&theMixBus, &theRing);
+    }
+    CHECK_EQUAL(VocanaRingBuffer_GetWriteFrame(&theRing), 2 * kTest_Frames);
+    CHECK(test_reads_constant(&theRing, kTest_Frames, 0.75f));
+    CHECK_EQUAL(theMixBus.clippedSamples, 0);
+
+    test_teardown(&theMixBus, &theRing);
+}
+
+static void test_clips_the_mix(void)
+{
+    VocanaMixBus theMixBus;
+    VocanaRingBuffer theRing;
+    test_setup(&theMixBus, &theRing, 2);
+
+    float theIn[kTest_Frames * kTest_Channels];
+    test_fill_constant(theIn, kTest_Frames, 0.75f);
+    CHECK(VocanaMixBus_Mix(&theMixBus, &theRing, 100, 0, theIn, kTest_Frames));
+    CHECK(VocanaMixBus_Mix(&theMixBus, &theRing, 101, 0, theIn, kTest_Frames));
+    VocanaMixBus_EndMix(&theMixBus, &theRing);
+    CHECK(test_reads_constant(&theRing, 0, 1.0f));
+    CHECK_EQUAL(theMixBus.clippedSamples, kTest_Frames * kTest_Channels);
+
+    test_fill_constant(theIn, kTest_Frames, -0.75f);
+    CHECK(VocanaMixBus_Mix(&theMixBus, &theRing, 100, kTest_Frames, theIn, kTest_Frames));
+    CHECK(VocanaMixBus_Mix(&theMixBus, &theRing, 101, kTest_Frames, theIn, kTest_Frames));
+    VocanaMixBus_EndMix(&theMixBus, &theRing);
+    CHECK(test_reads_constant(&theRing, kTest_Frames, -1.0f));
+
+    test_teardown(&theMixBus, &theRing);
+}
+
+static void test_repeated_write_is_dropped(void)
+{
+    VocanaMixBus theMixBus;
+    VocanaRingBuffer theRing;
+    test_setup(&theMixBus, &theRing, 2);
+
+    float theIn[kTest_Frames * kTest_Channels];
+    test_fill_constant(theIn, kTest_Frames, 0.25f);
+    CHECK(VocanaMixBus_Mix(&theMixBus, &theRing, 100, 0, theIn, kTest_Frames));
+    CHECK(VocanaMixBus_Mix(&theMixBus, &theRing, 101, 0, theIn, kTest_Frames));
+    CHECK(!VocanaMixBus_Mix(&theMixBus, &theRing, 101, 0, theIn, kTest_Frames));
+    VocanaMixBus_EndMix(&theMixBus, &theRing);
+    CHECK(test_reads_constant(&theRing, 0, 0.5f));
+    CHECK_EQUAL(theMixBus.droppedWrites, 1);
+
+    //	oversized writes are dropped too
+    CHECK(!VocanaMixBus_Mix(&theMixBus, &theRing, 100, kTest_Frames, theIn, kTest_Frames + 1));
+    CHECK_EQUAL(theMixBus.droppedWrites, 2);
+
+    //	clients with no slot share the anonymous one, so only the first of them gets into a cycle
+    CHECK(VocanaMixBus_Mix(&theMixBus, &theRing, 999, kTest_Frames, theIn, kTest_Frames));
+    CHECK(!VocanaMixBus_Mix(&theMixBus, &theRing, 998, kTest_Frames, theIn, kTest_Frames));
+    CHECK_EQUAL(theMixBus.droppedWrites, 3);
+
+    test_teardown(&theMixBus, &theRing);
+}
+
+static void test_missing_writer_is_flushed_by_the_next_cycle(void)
+{
+    VocanaMixBus theMixBus;
+    VocanaRingBuffer theRing;
+    test_setup(&theMixBus, &theRing, 2);
+
+    float theIn[kTest_Frames * kTest_Channels];
+    test_fill_constant(theIn, kTest_Frames, 0.25f);
+    for(uint32_t c = 0; c < 2; c++)
+    {
+        CHECK(VocanaMixBus_Mix(&theMixBus, &theRing, 100 + c, 0, theIn, kTest_Frames));
+        VocanaMixBus_EndMix(&theMixBus, &theRing);
+    }
+
+    //	client 101 stopped: its cycle stays pending past EndMix
+    CHECK(VocanaMixBus_Mix(&theMixBus, &theRing, 100, kTest_Frames, theIn, kTest_Frames));
+    VocanaMixBus_EndMix(&theMixBus, &theRing);
+    CHECK_EQUAL(VocanaRingBuffer_GetWriteFrame(&theRing), kTest_Frames);
+
+    //	a read in the same cycle leaves it alone, a read in the next one publishes it
+    VocanaMixBus_Flush(&theMixBus, &theRing, kTest_Frames);
+    CHECK_EQUAL(VocanaRingBuffer_GetWriteFrame(&theRing), kTest_Frames);
+    VocanaMixBus_Flush(&theMixBus, &theRing, 2 * kTest_Frames);
+    CHECK(test_reads_constant(&theRing, kTest_Frames, 0.25f));
+
+    //	and from then on one writer is enough
+    CHECK(VocanaMixBus_Mix(&theMixBus, &theRing, 100, 2 * kTest_Frames, theIn, kTest_Frames));
+    VocanaMixBus_EndMix(&theMixBus, &theRing);
+    CHECK(test_reads_constant(&theRing, 2 * kTest_Frames, 0.25f));
+
+    test_teardown(&theMixBus, &theRing);
+}
+
+static void test_client_table(void)
+{
+    VocanaMixBus theMixBus;
+    VocanaRingBuffer theRing;
+    test_setup(&theMixBus, &theRing, kVocanaMixBus_MaxClients);
+
+    //	adding twice is harmless, but the table is full
+    CHECK(VocanaMixBus_AddClient(&theMixBus, 100));
+    CHECK(!VocanaMixBus_AddClient(&theMixBus, 100 + kVocanaMixBus_MaxClients));
+    VocanaMixBus_RemoveClient(&theMixBus, 100 + 7);
+    CHECK(VocanaMixBus_AddClient(&theMixBus, 100 + kVocanaMixBus_MaxClients));
+
+    //	every client contributes 1/128th, which sums back to exactly 1/2; the one without a slot
+    //	still gets in, as the anonymous writer
+    float theIn[kTest_Frames * kTest_Channels];
+    test_fill_constant(theIn, kTest_Frames, 1.0f / 128.0f);
+    for(uint64_t theCycle = 0; theCycle < 4; theCycle++)
+    {
+        uint32_t theWriters = 0;
+        for(uint32_t c = 0; c <= kVocanaMixBus_MaxClients; c++)
+        {
+            theWriters += VocanaMixBus_Mix(&theMixBus, &theRing, 100 + c, theCycle * kTest_Frames, theIn, kTest_Frames);
+            VocanaMixBus_EndMix(&theMixBus, &theRing);
+        }
+        CHECK_EQUAL(theWriters, kVocanaMixBus_MaxClients + 1);
+        CHECK(test_reads_constant(&theRing, theCycle * kTest_Frames, 65.0f / 128.0f));
+    }
+
+    test_teardown(&theMixBus, &theRing);
+}
+
+static void test_set_channel_count(void)
+{
+    VocanaMixBus theMixBus;
+    VocanaRingBuffer theRing;
+    test_setup(&theMixBus, &theRing, 2);
+    VocanaRingBuffer_Teardown(&theRing);
+
+    CHECK_EQUAL(VocanaMixBus_SetChannelCount(&theMixBus, 0), EINVAL);
+    CHECK_EQUAL(VocanaMixBus_SetChannelCount(&theMixBus, 8), 0);
+    CHECK_EQUAL(VocanaRingBuffer_Init(&theRing, kTest_CapacityFrames, 8, 0), 0);
+
+    //	the clients keep their slots across the change
+    float theIn[kTest_Frames * 8];
+    float theOut[kTest_Frames * 8];
+    for(uint32_t i = 0; i < kTest_Frames * 8; i++)
+    {
+        theIn[i] = (float)(i % 8) / 16.0f;
+    }
+    CHECK(VocanaMixBus_Mix(&theMixBus, &theRing, 100, 0, theIn, kTest_Frames));
+    VocanaMixBus_EndMix(&theMixBus, &theRing);
+    CHECK(VocanaMixBus_Mix(&theMixBus, &theRing, 101, 0, theIn, kTest_Frames));
+    VocanaMixBus_EndMix(&theMixBus, &theRing);
+    VocanaMixBus_Flush(&theMixBus, &theRing, kTest_Frames);
+    CHECK_EQUAL(VocanaRingBuffer_Read(&theRing, 0, theOut, kTest_Frames), kTest_Frames);
+    bool isSummed = true;
+    for(uint32_t i = 0; i < kTest_Frames * 8; i++)
+    {
+        isSummed = isSummed && theOut[i] == 2.0f * theIn[i];
+    }
+    CHECK(isSummed);
+
+    test_teardown(&theMixBus, &theRing);
+}
+
+static void test_hal_writes_once_per_cycle(void)
+{
+    //	the real HAL hands over its own mix, once a cycle, under a client ID it never registered;
+    //	every cycle is published at its first EndMix
+    VocanaMixBus theMixBus;
+    VocanaRingBuffer theRing;
+    test_setup(&theMixBus, &theRing, 2);
+
+    float theIn[kTest_Frames * kTest_Channels];
+    for(uint64_t theCycle = 0; theCycle < 4; theCycle++)
+    {
+        test_fill_constant(theIn, kTest_Frames, 0.125f * (float)(theCycle + 1));
+        CHECK(VocanaMixBus_Mix(&theMixBus, &theRing, 0, theCycle * kTest_Frames, theIn, kTest_Frames));
+        VocanaMixBus_EndMix(&theMixBus, &theRing);
+        CHECK_EQUAL(VocanaRingBuffer_GetWriteFrame(&theRing), (theCycle + 1) * kTest_Frames);
+        CHECK(test_reads_constant(&theRing, theCycle * kTest_Frames, 0.125f * (float)(theCycle + 1)));
+    }
+    CHECK_EQUAL(theMixBus.droppedWrites, 0);
+
+    test_teardown(&theMixBus, &theRing);
+}
+
+typedef struct TestProcessor
+{
+    uint32_t    calls;
+    uint32_t    frames;
+    uint64_t    lastFrame;
+} TestProcessor;
+
+static void test_halve(void* inContext, uint64_t inFrame, float* ioFrames, uint32_t inFrameCount)
+{
+    TestProcessor* theProcessor = (TestProcessor*)inContext;
+    theProcessor->calls++;
+    theProcessor->lastFrame = inFrame;
+    theProcessor->frames += inFrameCount;
+    for(uint32_t i = 0; i < inFrameCount * kTest_Channels; i++)
+    {
+        ioFrames[i] *= 0.5f;
+    }
+}
+
+static void test_processor_takes_each_cycle_once(void)
+{
+    VocanaMixBus theMixBus;
+    VocanaRingBuffer theRing;
+    test_setup(&theMixBus, &theRing, 2);
+    TestProcessor theProcessor = { 0, 0, UINT64_MAX };
+    VocanaMixBus_SetProcessor(&theMixBus, test_halve, &theProcessor);
+
+    float theIn[kTest_Frames * kTest_Channels];
+    test_fill_constant(theIn, kTest_Frames, 0.25f);
+
+    //	the first cycle goes out with the first writer; the second is too late to be added, but
+    //	the next cycle waits for both
+    CHECK(VocanaMixBus_Mix(&theMixBus, &theRing, 100, 0, theIn, kTest_Frames));
+    VocanaMixBus_EndMix(&theMixBus, &theRing);
+    CHECK(!VocanaMixBus_Mix(&theMixBus, &theRing, 101, 0, theIn, kTest_Frames));
+    VocanaMixBus_EndMix(&theMixBus, &theRing);
+    CHECK(test_reads_constant(&theRing, 0, 0.125f));
+    CHECK_EQUAL(theProcessor.calls, 1);
+    CHECK_EQUAL(theMixBus.droppedWrites, 1);
+
+    for(uint32_t c = 0; c < 2; c++)
+    {
+        CHECK(VocanaMixBus_Mix(&theMixBus, &theRing, 100 + c, kTest_Frames, theIn, kTest_Frames));
+        VocanaMixBus_EndMix(&theMixBus, &theRing);
+        CHECK_EQUAL(theProcessor.calls, 1 + c);
+    }
+    CHECK(test_reads_constant(&theRing, kTest_Frames, 0.25f));
+    CHECK_EQUAL(theProcessor.frames, 2 * kTest_Frames);
+    CHECK_EQUAL(theProcessor.lastFrame, kTest_Frames);
+
+    //	without one, a late writer republishes the cycle as before
+    VocanaMixBus_SetProcessor(&theMixBus, NULL, NULL);
+    VocanaMixBus_Mix(&theMixBus, &theRing, 100, 2 * kTest_Frames, theIn, kTest_Frames);
+    VocanaMixBus_EndMix(&theMixBus, &theRing);
+    VocanaMixBus_Mix(&theMixBus, &theRing, 101, 2 * kTest_Frames, theIn, kTest_Frames);
+    VocanaMixBus_EndMix(&theMixBus, &theRing);
+    CHECK(test_reads_constant(&theRing, 2 * kTest_Frames, 0.5f));
+    CHECK_EQUAL(theProcessor.calls, 2);
+
+    test_teardown(&theMixBus, &theRing);
+}
+
+static void test_reads_several_rings(void)
+{
+    //	a device's input sums its own ring with its mirror's, larger reads than the bus included
+    enum { kFrames = 3 * kTest_Frames / 2 };
+    VocanaMixBus theMixBus;
+    VocanaRingBuffer theRings[2];
+    test_setup(&theMixBus, &theRings[0], 0);
+    CHECK_EQUAL(VocanaRingBuffer_Init(&theRings[1], kTest_CapacityFrames, kTest_Channels, 0), 0);
+
+    float theIn[kFrames * kTest_Channels];
+    float theOut[kFrames * kTest_Channels];
+    test_fill_constant(theIn, kFrames, 0.25f);
+    VocanaRingBuffer_Write(&theRings[0], 0, theIn, kFrames);
+    test_fill_constant(theIn, kFrames, 0.5f);
+    VocanaRingBuffer_Write(&theRings[1], 0, theIn, kTest_Frames);
+
+    VocanaRingBuffer* const theBoth[2] = { &theRings[0], &theRings[1] };
+    CHECK_EQUAL(VocanaMixBus_Read(&theMixBus, theBoth, 2, 0, theOut, kFrames), kFrames);
+    bool isSummed = true;
+    for(uint32_t i = 0; i < kFrames * kTest_Channels; i++)
+    {
+        isSummed = isSummed && theOut[i] == (i < kTest_Frames * kTest_Channels ? 0.75f : 0.25f);
+    }
+    CHECK(isSummed);
+
+    //	the sum is clipped, a missing ring is silent and no ring at all reads as silence
+    test_fill_constant(theIn, kFrames, 0.75f);
+    VocanaRingBuffer_Write(&theRings[0], kFrames, theIn, kTest_Frames);
+    VocanaRingBuffer_Write(&theRings[1], kFrames, theIn, kTest_Frames);
+    CHECK_EQUAL(VocanaMixBus_Read(&theMixBus, theBoth, 2, kFrames, theOut, kTest_Frames), kTest_Frames);
+    CHECK_EQUAL(theOut[0], 1.0f);
+    CHECK_EQUAL(theMixBus.clippedSamples, kTest_Frames * kTest_Channels);
+    VocanaRingBuffer* const theOne[2] = { NULL, &theRings[1] };
+    CHECK_EQUAL(VocanaMixBus_Read(&theMixBus, theOne, 2, kFrames, theOut, kTest_Frames), kTest_Frames);
+    CHECK_EQUAL(theOut[0], 0.75f);
+    VocanaRingBuffer* const theNone[2] = { NULL, NULL };
+    theOut[0] = 1.0f;
+    CHECK_EQUAL(VocanaMixBus_Read(&theMixBus, theNone, 2, kFrames, theOut, kTest_Frames), 0);
+    CHECK_EQUAL(theOut[0], 0.0f);
+
+    VocanaRingBuffer_Teardown(&theRings[1]);
+    test_teardown(&theMixBus, &theRings[0]);
+}
+
+int main(void)
+{
+    RUN_TEST(test_init_rejects_bad_arguments);
+    RUN_TEST(test_sums_clients);
+    RUN_TEST(test_clips_the_mix);
+    RUN_TEST(test_repeated_write_is_dropped);
+    RUN_TEST(test_missing_writer_is_flushed_by_the_next_cycle);
+    RUN_TEST(test_client_table);
+    RUN_TEST(test_set_channel_count);
+    RUN_TEST(test_hal_writes_once_per_cycle);
+    RUN_TEST(test_processor_takes_each_cycle_once);
+    RUN_TEST(test_reads_several_rings);
+    return TEST_RESULT();
+}
@@ -0,0 +1,230 @@
+/*
+     File: VocanaPipelineTests.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Host-side tests for VocanaPipeline: latency alignment, fallback to the dry signal and the
+ transitions between the two.
+
+ */
+
+#include "VocanaPipeline.h"
+#include "VocanaDriverTestSupport.h"
+
+#include <errno.h>
+#include <string.h>
+
+#define kTest_Channels          2
+#define kTest_MaxFrames         1024
+#define kTest_Latency           1024
+#define kTest_Fade              128
+#define kTest_Frames            512
+#define kTest_WetGain           0.5f
+
+//	A 440 Hz tone, different in each channel, as a function of sample time.
+static float test_signal(uint64_t inSampleTime, uint32_t inChannel)
+{
+    return sinf(2.0f * (float)M_PI * 440.0f * (float)inSampleTime / 48000.0f + (float)inChannel);
+}
+
+static void test_fill_signal(float* outFrames, uint64_t inSampleTime, uint32_t inFrameCount, float inGain)
+{
+    for(uint32_t i = 0; i < inFrameCount; i++)
+    {
+        for(uint32_t c = 0; c < kTest_Channels; c++)
+        {
+            outFrames[i * kTest_Channels + c] = inGain * test_signal(inSampleTime + i, c);
+        }
+    }
+}
+
+//	The largest difference between the output for inSampleTime and the processed signal it should
+//	be, latencyFrames earlier.
+static float test_wet_error(const float* inFrames, uint64_t inSampleTime, uint32_t inFrameCount)
+{
+    float theError = 0.0f;
+    for(uint32_t i = 0; i < inFrameCount; i++)
+    {
+        for(uint32_t c = 0; c < kTest_Channels; c++)
+        {
+            float theDifference = fabsf(inFrames[i * kTest_Channels + c] - kTest_WetGain * test_signal(inSampleTime - kTest_Latency + i, c));
+            theError = theDifference > theError ? theDifference : theError;
+        }
+    }
+    return theError;
+}
+
+//	The largest step between consecutive output samples, including the step from the previous
+//	cycle's last sample.
+static float test_largest_step(const float* inFrames, uint32_t inFrameCount, float* ioPrevious)
+{
+    float theStep = 0.0f;
+    for(uint32_t i = 0; i < inFrameCount; i++)
+    {
+        for(uint32_t c = 0; c < kTest_Channels; c++)
+        {
+            float theSample = inFrames[i * kTest_Channels + c];
+            float theDifference = fabsf(theSample - ioPrevious[c]);
+            theStep = theDifference > theStep ? theDifference : theStep;
+            ioPrevious[c] = theSample;
+        }
+    }
+    return theStep;
+}
+
+static void test_steady_state(void)
+{
+    VocanaPipeline thePipeline;
+    CHECK_EQUAL(VocanaPipeline_Init(&thePipeline, kTest_Channels, kTest_MaxFrames, kTest_Latency, kTest_Fade), 0);
+
+    //	a processor that always answers within the cycle
+    float theDry[kTest_MaxFrames * kTest_Channels];
+    float theWet[kTest_MaxFrames * kTest_Channels];
+    float theOut[kTest_MaxFrames * kTest_Channels];
+    float theWorstError = 0.0f;
+    for(uint32_t theCycle = 0; theCycle < 40; theCycle++)
+    {
+        uint64_t theTime = (uint64_t)theCycle * kTest_Frames;
+        test_fill_signal(theDry, theTime, kTest_Frames, 1.0f);
+        test_fill_signal(theWet, theTime, kTest_Frames, kTest_WetGain);
+        VocanaPipeline_PushDry(&thePipeline, theTime, theDry, kTest_Frames);
+        VocanaPipeline_PushWet(&thePipeline, theTime, theWet, kTest_Frames);
+        bool isWet = VocanaPipeline_Render(&thePipeline, theTime, theOut, kTest_Frames);
+
+        //	nothing to play until the latency has gone by, then the first cycle fades in
+        CHECK(isWet == (theTime >= kTest_Latency));
+        if(theTime >= kTest_Latency + kTest_Frames)
+        {
+            float theError = test_wet_error(theOut, theTime, kTest_Frames);
+            theWorstError = theError > theWorstError ? theError : theWorstError;
+        }
+    }
+    CHECK(theWorstError < 1.0e-6f);
+    CHECK_EQUAL(thePipeline.statistics.wetCycles, 38);
+    CHECK_EQUAL(thePipeline.statistics.lateFrames, 0);
+
+    VocanaPipeline_Teardown(&thePipeline);
+}
+
+static void test_late_reply_falls_back_smoothly(void)
+{
+    VocanaPipeline thePipeline;
+    CHECK_EQUAL(VocanaPipeline_Init(&thePipeline, kTest_Channels, kTest_MaxFrames, kTest_Latency, kTest_Fade), 0);
+
+    //	replies turn up a whole latency late, which is just in time, except for one that turns up
+    //	a cycle later than that and one that never does
+    const uint32_t theSlowCycle = 20;
+    const uint32_t theLostCycle = 30;
+    const uint32_t theLatencyCycles = kTest_Latency / kTest_Frames;
+    float theDry[kTest_MaxFrames * kTest_Channels];
+    float theWet[kTest_MaxFrames * kTest_Channels];
+    float theOut[kTest_MaxFrames * kTest_Channels];
+    float thePrevious[kTest_Channels] = { 0.0f, 0.0f };
+    float theLargestStep = 0.0f;
+    uint32_t theDryCycles = 0;
+    for(uint32_t theCycle = 0; theCycle < 50; theCycle++)
+    {
+        uint64_t theTime = (uint64_t)theCycle * kTest_Frames;
+        test_fill_signal(theDry, theTime, kTest_Frames, 1.0f);
+        VocanaPipeline_PushDry(&thePipeline, theTime, theDry, kTest_Frames);
+
+        if(theCycle >= theLatencyCycles)
+        {
+            uint32_t theAnswered = theCycle - theLatencyCycles;
+            if(theAnswered != theSlowCycle && theAnswered != theLostCycle)
+            {
+                test_fill_signal(theWet, (uint64_t)theAnswered * kTest_Frames, kTest_Frames, kTest_WetGain);
+                VocanaPipeline_PushWet(&thePipeline, (uint64_t)theAnswered * kTest_Frames, theWet, kTest_Frames);
+            }
+            if(theAnswered == theSlowCycle + 1)
+            {
+                test_fill_signal(theWet, (uint64_t)theSlowCycle * kTest_Frames, kTest_Frames, kTest_WetGain);
+                VocanaPipeline_PushWet(&thePipeline, (uint64_t)theSlowCycle * kTest_Frames, theWet, kTest_Frames);
+            }
+        }
+
+        bool isWet = VocanaPipeline_Render(&thePipeline, theTime, theOut, kTest_Frames);
+        if(theTime >= kTest_Latency)
+        {
+            uint32_t thePlayed = theCycle - theLatencyCycles;
+            CHECK(isWet == (thePlayed != theSlowCycle && thePlayed != theLostCycle));
+            theDryCycles += !isWet;
+
+            //	a 440 Hz tone moves at most about 0.058 per sample; switching between the dry
+            //	and half-level wet signals without smoothing would step by up to 0.5
+            float theStep = test_largest_step(theOut, kTest_Frames, thePrevious);
+            if(theTime > kTest_Latency)
+            {
+                theLargestStep = theStep > theLargestStep ? theStep : theLargestStep;
+            }
+        }
+        else
+        {
+            test_largest_step(theOut, kTest_Frames, thePrevious);
+        }
+    }
+    CHECK_EQUAL(theDryCycles, 2);
+    CHECK_EQUAL(thePipeline.statistics.lateFrames, kTest_Frames);
+    CHECK(theLargestStep < 0.075f);
+
+    VocanaPipeline_Teardown(&thePipeline);
+}
+
+static void test_varying_cycle_sizes(void)
+{
+    VocanaPipeline thePipeline;
+    CHECK_EQUAL(VocanaPipeline_Init(&thePipeline, kTest_Channels, kTest_MaxFrames, kTest_Latency, kTest_Fade), 0);
+
+    float theDry[kTest_MaxFrames * kTest_Channels];
+    float theWet[kTest_MaxFrames * kTest_Channels];
+    float theOut[kTest_MaxFrames * kTest_Channels];
+    float theWorstError = 0.0f;
+    uint64_t theTime = 0;
+    uint32_t theSeed = 1;
+    for(uint32_t theCycle = 0; theCycle < 200; theCycle++)
+    {
+        theSeed = theSeed * 1103515245u + 12345u;
+        uint32_t theFrames = 1 + (theSeed >> 16) % kTest_MaxFrames;
+        test_fill_signal(theDry, theTime, theFrames, 1.0f);
+        test_fill_signal(theWet, theTime, theFrames, kTest_WetGain);
+        VocanaPipeline_PushDry(&thePipeline, theTime, theDry, theFrames);
+        VocanaPipeline_PushWet(&thePipeline, theTime, theWet, theFrames);
+        VocanaPipeline_Render(&thePipeline, theTime, theOut, theFrames);
+        if(theTime >= kTest_Latency + kTest_MaxFrames + kTest_Fade)
+        {
+            float theError = test_wet_error(theOut, theTime, theFrames);
+            theWorstError = theError > theWorstError ? theError : theWorstError;
+        }
+        theTime += theFrames;
+    }
+    CHECK(theWorstError < 1.0e-6f);
+    CHECK_EQUAL(thePipeline.statistics.dryCycles + thePipeline.statistics.wetCycles, 200);
+
+    VocanaPipeline_Teardown(&thePipeline);
+}
+
+static void test_init_errors(void)
+{
+    VocanaPipeline thePipeline;
+    CHECK_EQUAL(VocanaPipeline_Init(&thePipeline, 0, kTest_MaxFrames, kTest_Latency, kTest_Fade), EINVAL);
+    CHECK_EQUAL(VocanaPipeline_Init(&thePipeline, kTest_Channels, kTest_MaxFrames, kTest_Latency, 0), EINVAL);
+    CHECK(thePipeline.dry == NULL);
+
+    //	no latency still works, it just never has anything processed in time
+    CHECK_EQUAL(VocanaPipeline_Init(&thePipeline, kTest_Channels, kTest_MaxFrames, 0, kTest_Fade), 0);
+    float theFrames[kTest_Frames * kTest_Channels];
+    test_fill_signal(theFrames, 0, kTest_Frames, 1.0f);
+    VocanaPipeline_PushDry(&thePipeline, 0, theFrames, kTest_Frames);
+    CHECK(!VocanaPipeline_Render(&thePipeline, 0, theFrames, kTest_Frames));
+    CHECK_CLOSE(theFrames[kTest_Channels], test_signal(1, 0), 1.0e-6);
+    VocanaPipeline_Teardown(&thePipeline);
+}
+
+int main(void)
+{
+    RUN_TEST(test_steady_state);
+    RUN_TEST(test_late_reply_falls_back_smoothly);
+    RUN_TEST(test_varying_cycle_sizes);
+    RUN_TEST(test_init_errors);
+    return TEST_RESULT();
+}
@@ -0,0 +1,263 @@
+/*
+     File: VocanaProcessorTests.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Host-side tests for VocanaProcessorStage: latency-aligned bypass when the processor runs over its
+ budget, recovery, smooth transitions and the interface checks.
+
+ */
+
+#include "VocanaProcessor.h"
+#include "VocanaDriverTestSupport.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+#define kTest_SampleRate        48000.0
+#define kTest_Channels          2
+#define kTest_MaxFrames         1024
+#define kTest_Latency           256
+#define kTest_Fade              64
+#define kTest_Backoff           4800
+
+//	1% of a cycle is about 100 us for 512 frames; the slow processor takes three times that
+#define kTest_BudgetFraction    0.01
+#define kTest_SlowNanoseconds   ((uint64_t)(3 * kTest_BudgetFraction * 1.0e9 * kTest_MaxFrames / kTest_SampleRate))
+
+static const VocanaProcessorConfiguration kTest_Configuration = { kTest_SampleRate, kTest_Channels, kTest_MaxFrames };
+
+//	A stand-in processor: a plain delay of kTest_Latency frames times a gain, which can be told to
+//	take too long.
+typedef struct TestDelay
+{
+    float       line[kTest_Latency * kTest_Channels];
+    uint32_t    position;
+} TestDelay;
+
+static float gTest_Gain = 1.0f;
+static bool gTest_IsSlow = false;
+static int gTest_CreateError = 0;
+static uint32_t gTest_Resets = 0;
+
+static int test_delay_create(const VocanaProcessorConfiguration* inConfiguration, void** outInstance)
+{
+    if(gTest_CreateError != 0)
+    {
+        return gTest_CreateError;
+    }
+    *outInstance = calloc(1, sizeof(TestDelay));
+    return *outInstance != NULL ? 0 : ENOMEM;
+}
+
+static void test_delay_destroy(void* inInstance)
+{
+    free(inInstance);
+}
+
+static void test_delay_reset(void* inInstance)
+{
+    memset(inInstance, 0, sizeof(TestDelay));
+    gTest_Resets++;
+}
+
+static uint32_t test_delay_latency(void* inInstance)
+{
+    return kTest_Latency;
+}
+
+static void test_delay_process(void* inInstance, const float* inFrames, float* outFrames, uint32_t inFrameCount)
+{
+    TestDelay* theDelay = (TestDelay*)inInstance;
+    for(uint32_t i = 0; i < inFrameCount; i++)
+    {
+        float* theSlot = theDelay->line + theDelay->position * kTest_Channels;
+        for(uint32_t c = 0; c < kTest_Channels; c++)
+        {
+            float theInput = inFrames[i * kTest_Channels + c];
+            outFrames[i * kTest_Channels + c] = theSlot[c] * gTest_Gain;
+            theSlot[c] = theInput;
+        }
+        theDelay->position = (theDelay->position + 1) % kTest_Latency;
+    }
+
+    if(gTest_IsSlow)
+    {
+        double theEnd = test_now_seconds() + kTest_SlowNanoseconds * 1.0e-9;
+        while(test_now_seconds() < theEnd)
+        {
+        }
+    }
+}
+
+static const VocanaProcessorInterface kTest_DelayInterface =
+{
+    kVocanaProcessor_InterfaceVersion,
+    "Test Delay",
+    test_delay_create,
+    test_delay_destroy,
+    test_delay_reset,
+    test_delay_latency,
+    test_delay_process,
+};
+
+static float test_signal(uint64_t inFrame, uint32_t inChannel)
+{
+    return sinf(2.0f * (float)M_PI * 440.0f * (float)inFrame / (float)kTest_SampleRate + (float)inChannel);
+}
+
+typedef struct TestRun
+{
+    float       worstError;         //	against the processed signal, while the stage is processing
+    float       worstDryError;      //	against the delayed input, while it is bypassed
+    float       largestStep;
+    uint32_t    bypassedCycles;
+} TestRun;
+
+//	Runs the stage over a tone in cycles of varying size, with the processor slow from
+//	inSlowFrom to inSlowTo.
+static TestRun test_run(VocanaProcessorStage* inStage, uint64_t inFrameCount, uint64_t inSlowFrom, uint64_t inSlowTo)
+{
+    TestRun theRun = { 0.0f, 0.0f, 0.0f, 0 };
+    float theFrames[kTest_MaxFrames * kTest_Channels];
+    float thePrevious[kTest_Channels] = { 0.0f, 0.0f };
+    uint64_t theFrame = 0;
+    uint64_t theSettledFrame = kTest_Latency + kTest_Fade;
+    bool wasProcessed = true;
+    uint32_t theSeed = 5;
+    while(theFrame < inFrameCount)
+    {
+        theSeed = theSeed * 1103515245u + 12345u;
+        uint32_t theCount = 64 + (theSeed >> 16) % (kTest_MaxFrames - 64);
+        for(uint32_t i = 0; i < theCount; i++)
+        {
+            for(uint32_t c = 0; c < kTest_Channels; c++)
+            {
+                theFrames[i * kTest_Channels + c] = test_signal(theFrame + i, c);
+            }
+        }
+
+        gTest_IsSlow = theFrame < inSlowTo && theFrame + theCount > inSlowFrom;
+        bool isProcessed = VocanaProcessorStage_Process(inStage, theFrames, theFrames, theCount);
+        theRun.bypassedCycles += !isProcessed;
+        if(isProcessed != wasProcessed)
+        {
+            theSettledFrame = theFrame + kTest_Fade;
+            wasProcessed = isProcessed;
+        }
+
+        for(uint32_t i = 0; i < theCount; i++)
+        {
+            for(uint32_t c = 0; c < kTest_Channels; c++)
+            {
+                float theOut = theFrames[i * kTest_Channels + c];
+                float theStep = fabsf(theOut - thePrevious[c]);
+                if(theFrame + i > kTest_Latency)
+                {
+                    //	the tone itself starts with a step
+                    theRun.largestStep = theStep > theRun.largestStep ? theStep : theRun.largestStep;
+                }
+                thePrevious[c] = theOut;
+
+                //	only once the transitions are over
+                uint64_t theSource = theFrame + i;
+                if(theSource < theSettledFrame)
+                {
+                    continue;
+                }
+                float theDry = test_signal(theSource - kTest_Latency, c);
+                if(isProcessed)
+                {
+                    float theError = fabsf(theOut - gTest_Gain * theDry);
+                    theRun.worstError = theError > theRun.worstError ? theError : theRun.worstError;
+                }
+                else
+                {
+                    float theError = fabsf(theOut - theDry);
+                    theRun.worstDryError = theError > theRun.worstDryError ? theError : theRun.worstDryError;
+                }
+            }
+        }
+        theFrame += theCount;
+    }
+    gTest_IsSlow = false;
+    return theRun;
+}
+
+static void test_bypass_keeps_timing(void)
+{
+    //	a processor that only delays: going around it must not change a single sample
+    gTest_Gain = 1.0f;
+    VocanaProcessorStage theStage;
+    CHECK_EQUAL(VocanaProcessorStage_Init(&theStage, &kTest_DelayInterface, &kTest_Configuration, kTest_BudgetFraction, kTest_Backoff, kTest_Fade), 0);
+    CHECK_EQUAL(VocanaProcessorStage_GetLatency(&theStage), kTest_Latency);
+
+    gTest_Resets = 0;
+    TestRun theRun = test_run(&theStage, 48000, 10000, 20000);
+    CHECK(theRun.worstError < 1.0e-6f);
+    CHECK(theRun.worstDryError < 1.0e-6f);
+    CHECK(theRun.bypassedCycles > 0);
+
+    //	it gave up once, then backed off and tried again every kTest_Backoff frames until the
+    //	processor was fast again, and is processing at the end
+    CHECK(theStage.statistics.bypasses >= 2);
+    CHECK(gTest_Resets >= 2);
+    CHECK_EQUAL(theStage.state, kVocanaProcessorStage_Active);
+    CHECK(theStage.statistics.overruns >= kVocanaProcessorStage_OverrunLimit);
+
+    VocanaProcessorStage_Teardown(&theStage);
+}
+
+static void test_transitions_are_smooth(void)
+{
+    //	a processor that halves the signal, so switching to and from it without smoothing would
+    //	step by up to 0.5
+    gTest_Gain = 0.5f;
+    VocanaProcessorStage theStage;
+    CHECK_EQUAL(VocanaProcessorStage_Init(&theStage, &kTest_DelayInterface, &kTest_Configuration, kTest_BudgetFraction, kTest_Backoff, kTest_Fade), 0);
+
+    TestRun theRun = test_run(&theStage, 48000, 10000, 20000);
+    CHECK(theRun.worstError < 1.0e-6f);
+    CHECK(theRun.worstDryError < 1.0e-6f);
+    CHECK(theStage.statistics.bypasses >= 1);
+    CHECK_EQUAL(theStage.state, kVocanaProcessorStage_Active);
+
+    //	a 440 Hz tone moves at most about 0.058 per sample
+    CHECK(theRun.largestStep < 0.075f);
+
+    //	a single slow cycle is not enough to give up
+    VocanaProcessorStage_Reset(&theStage);
+    test_run(&theStage, 4000, 1000, 1001);
+    CHECK_EQUAL(theStage.statistics.bypasses, 0);
+    CHECK_EQUAL(theStage.statistics.overruns, 1);
+
+    VocanaProcessorStage_Teardown(&theStage);
+    gTest_Gain = 1.0f;
+}
+
+static void test_init_errors(void)
+{
+    VocanaProcessorStage theStage;
+    VocanaProcessorInterface theInterface = kTest_DelayInterface;
+    theInterface.version = kVocanaProcessor_InterfaceVersion + 1;
+    CHECK_EQUAL(VocanaProcessorStage_Init(&theStage, &theInterface, &kTest_Configuration, kTest_BudgetFraction, kTest_Backoff, kTest_Fade), ENOTSUP);
+    CHECK_EQUAL(VocanaProcessorStage_Init(&theStage, &kTest_DelayInterface, &kTest_Configuration, 0.0, kTest_Backoff, kTest_Fade), EINVAL);
+
+    gTest_CreateError = ENOMEM;
+    CHECK_EQUAL(VocanaProcessorStage_Init(&theStage, &kTest_DelayInterface, &kTest_Configuration, kTest_BudgetFraction, kTest_Backoff, kTest_Fade), ENOMEM);
+    gTest_CreateError = 0;
+
+    //	a torn-down or failed stage processes nothing
+    float theFrames[kTest_Channels] = { 1.0f, 1.0f };
+    CHECK(!VocanaProcessorStage_Process(&theStage, theFrames, theFrames, 1));
+    VocanaProcessorStage_Teardown(&theStage);
+}
+
+int main(void)
+{
+    RUN_TEST(test_bypass_keeps_timing);
+    RUN_TEST(test_transitions_are_smooth);
+    RUN_TEST(test_init_errors);
+    return TEST_RESULT();
+}
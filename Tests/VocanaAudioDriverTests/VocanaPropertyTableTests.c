@@ -0,0 +1,270 @@
+/*
+     File: VocanaPropertyTableTests.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Host-side tests for VocanaPropertyTable: lookups, scopes, registration errors, a perfect hash over
+ many keys and the getters and setters the entries carry. What lookups cost in the driver itself is
+ measured by test_property_enumeration in VocanaHALSimulatorTests.c.
+
+ */
+
+#include "VocanaPropertyTable.h"
+#include "VocanaDriverTestSupport.h"
+
+#include <errno.h>
+
+#define FOURCC(a, b, c, d)  (((uint32_t)(a) << 24) | ((uint32_t)(b) << 16) | ((uint32_t)(c) << 8) | (uint32_t)(d))
+
+enum
+{
+    kTest_ScopeGlobal   = FOURCC('g', 'l', 'o', 'b'),
+    kTest_ScopeInput    = FOURCC('i', 'n', 'p', 't'),
+    kTest_ScopeOutput   = FOURCC('o', 'u', 't', 'p'),
+
+    kTest_Name          = FOURCC('l', 'n', 'a', 'm'),
+    kTest_Owned         = FOURCC('o', 'w', 'n', 'd'),
+    kTest_Rate          = FOURCC('n', 's', 'r', 't'),
+    kTest_Latency       = FOURCC('l', 't', 'n', 'c'),
+    kTest_Value         = FOURCC('b', 'c', 'v', 'l'),
+};
+
+static uint32_t test_owned_size(uint32_t inObjectID, uint32_t inScope)
+{
+    return inObjectID * 100 + (inScope == kTest_ScopeInput ? 1 : 0);
+}
+
+static const VocanaPropertySpec kTest_DeviceSpecs[] = {
+    { kTest_Name,       kVocanaPropertyScope_Any,   0,                          8,  NULL },
+    { kTest_Owned,      kVocanaPropertyScope_Any,   0,                          0,  test_owned_size },
+    { kTest_Rate,       kVocanaPropertyScope_Any,   kVocanaProperty_Settable,   8,  NULL },
+    { kTest_Latency,    kTest_ScopeInput,           0,                          4,  NULL },
+    { kTest_Latency,    kTest_ScopeOutput,          kVocanaProperty_Settable,   12, NULL },
+};
+
+static const VocanaPropertySpec kTest_ControlSpecs[] = {
+    { kTest_Name,       kVocanaPropertyScope_Any,   0,                          8,  NULL },
+    { kTest_Value,      kVocanaPropertyScope_Any,   kVocanaProperty_Settable,   4,  NULL },
+};
+
+static void test_build_and_find(void)
+{
+    VocanaPropertyTable theTable;
+    CHECK_EQUAL(VocanaPropertyTable_Init(&theTable, 16), 0);
+    CHECK_EQUAL(VocanaPropertyTable_AddObject(&theTable, 3, kTest_DeviceSpecs, 5, NULL, NULL), 0);
+    CHECK_EQUAL(VocanaPropertyTable_AddObject(&theTable, 6, kTest_ControlSpecs, 2, NULL, NULL), 0);
+
+    //	nothing is found before the table is built
+    CHECK(VocanaPropertyTable_Find(&theTable, 3, kTest_Name, kTest_ScopeGlobal) == NULL);
+    CHECK(!VocanaPropertyTable_HasObject(&theTable, 3));
+
+    CHECK_EQUAL(VocanaPropertyTable_Build(&theTable), 0);
+    CHECK(VocanaPropertyTable_HasObject(&theTable, 3));
+    CHECK(VocanaPropertyTable_HasObject(&theTable, 6));
+    CHECK(!VocanaPropertyTable_HasObject(&theTable, 4));
+
+    const VocanaPropertyEntry* theEntry = VocanaPropertyTable_Find(&theTable, 3, kTest_Rate, kTest_ScopeGlobal);
+    CHECK(theEntry != NULL);
+    if(theEntry != NULL)
+    {
+        CHECK_EQUAL(theEntry->objectID, 3);
+        CHECK(VocanaPropertyEntry_IsSettable(theEntry));
+        CHECK_EQUAL(VocanaPropertyEntry_GetSize(theEntry, kTest_ScopeGlobal), 8);
+    }
+
+    //	a property of one class isn't a property of the other
+    CHECK(VocanaPropertyTable_Find(&theTable, 6, kTest_Rate, kTest_ScopeGlobal) == NULL);
+    CHECK(VocanaPropertyTable_Find(&theTable, 3, kTest_Value, kTest_ScopeGlobal) == NULL);
+    CHECK(VocanaPropertyTable_Find(&theTable, 4, kTest_Name, kTest_ScopeGlobal) == NULL);
+    CHECK(VocanaPropertyTable_Find(&theTable, 3, 0, kTest_ScopeGlobal) == NULL);
+
+    //	and it is immutable once built
+    CHECK_EQUAL(VocanaPropertyTable_AddObject(&theTable, 7, kTest_ControlSpecs, 2, NULL, NULL), EBUSY);
+    CHECK_EQUAL(VocanaPropertyTable_Build(&theTable), EBUSY);
+
+    VocanaPropertyTable_Teardown(&theTable);
+}
+
+static void test_scopes(void)
+{
+    //	a property with an entry for any scope and one for a particular scope
+    VocanaPropertySpec theOverride[] = {
+        { kTest_Value,  kTest_ScopeInput,           0,  2,  NULL },
+        { kTest_Value,  kVocanaPropertyScope_Any,   0,  4,  NULL },
+    };
+
+    VocanaPropertyTable theTable;
+    CHECK_EQUAL(VocanaPropertyTable_Init(&theTable, 16), 0);
+    CHECK_EQUAL(VocanaPropertyTable_AddObject(&theTable, 3, kTest_DeviceSpecs, 5, NULL, NULL), 0);
+    CHECK_EQUAL(VocanaPropertyTable_AddObject(&theTable, 6, theOverride, 2, NULL, NULL), 0);
+    CHECK_EQUAL(VocanaPropertyTable_Build(&theTable), 0);
+
+    //	a property for any scope is found in every scope
+    CHECK(VocanaPropertyTable_Find(&theTable, 3, kTest_Name, kTest_ScopeGlobal) != NULL);
+    CHECK(VocanaPropertyTable_Find(&theTable, 3, kTest_Name, kTest_ScopeInput) != NULL);
+    CHECK(VocanaPropertyTable_Find(&theTable, 3, kTest_Name, kTest_ScopeOutput) != NULL);
+
+    //	a scoped one only in its own, each with its own size and flags
+    CHECK(VocanaPropertyTable_Find(&theTable, 3, kTest_Latency, kTest_ScopeGlobal) == NULL);
+    const VocanaPropertyEntry* theInput = VocanaPropertyTable_Find(&theTable, 3, kTest_Latency, kTest_ScopeInput);
+    const VocanaPropertyEntry* theOutput = VocanaPropertyTable_Find(&theTable, 3, kTest_Latency, kTest_ScopeOutput);
+    CHECK(theInput != NULL && theOutput != NULL);
+    if(theInput != NULL && theOutput != NULL)
+    {
+        CHECK(!VocanaPropertyEntry_IsSettable(theInput));
+        CHECK(VocanaPropertyEntry_IsSettable(theOutput));
+        CHECK_EQUAL(VocanaPropertyEntry_GetSize(theInput, kTest_ScopeInput), 4);
+        CHECK_EQUAL(VocanaPropertyEntry_GetSize(theOutput, kTest_ScopeOutput), 12);
+    }
+
+    //	the entry for exactly the scope asked for wins over the one for any scope
+    const VocanaPropertyEntry* theValue = VocanaPropertyTable_Find(&theTable, 6, kTest_Value, kTest_ScopeInput);
+    CHECK(theValue != NULL && theValue->size == 2);
+    theValue = VocanaPropertyTable_Find(&theTable, 6, kTest_Value, kTest_ScopeOutput);
+    CHECK(theValue != NULL && theValue->size == 4);
+
+    //	size procs see the object and the scope asked for
+    const VocanaPropertyEntry* theOwned = VocanaPropertyTable_Find(&theTable, 3, kTest_Owned, kTest_ScopeInput);
+    CHECK(theOwned != NULL);
+    if(theOwned != NULL)
+    {
+        CHECK_EQUAL(VocanaPropertyEntry_GetSize(theOwned, kTest_ScopeInput), 301);
+        CHECK_EQUAL(VocanaPropertyEntry_GetSize(theOwned, kTest_ScopeGlobal), 300);
+        CHECK_EQUAL(VocanaPropertyEntry_GetSizeForObject(theOwned, 13, kTest_ScopeGlobal), 1300);
+    }
+
+    VocanaPropertyTable_Teardown(&theTable);
+}
+
+static void test_registration_errors(void)
+{
+    VocanaPropertyTable theTable;
+    CHECK_EQUAL(VocanaPropertyTable_Init(&theTable, 0), EINVAL);
+    CHECK_EQUAL(VocanaPropertyTable_Init(&theTable, 8), 0);
+
+    //	the same property twice in one class
+    VocanaPropertySpec theDuplicates[] = {
+        { kTest_Name,   kVocanaPropertyScope_Any,   0,  8,  NULL },
+        { kTest_Name,   kVocanaPropertyScope_Any,   0,  4,  NULL },
+    };
+    CHECK_EQUAL(VocanaPropertyTable_AddObject(&theTable, 1, theDuplicates, 2, NULL, NULL), EEXIST);
+    CHECK_EQUAL(theTable.entryCount, 0);
+
+    //	the same object twice
+    CHECK_EQUAL(VocanaPropertyTable_AddObject(&theTable, 1, kTest_ControlSpecs, 2, NULL, NULL), 0);
+    CHECK_EQUAL(VocanaPropertyTable_AddObject(&theTable, 1, kTest_ControlSpecs, 1, NULL, NULL), EEXIST);
+
+    //	every object takes one entry more than it has properties
+    CHECK_EQUAL(VocanaPropertyTable_AddObject(&theTable, 2, kTest_DeviceSpecs, 5, NULL, NULL), ENOSPC);
+    CHECK_EQUAL(VocanaPropertyTable_AddObject(&theTable, 2, kTest_DeviceSpecs, 4, NULL, NULL), 0);
+    CHECK_EQUAL(theTable.entryCount, 8);
+
+    CHECK_EQUAL(VocanaPropertyTable_Build(&theTable), 0);
+    VocanaPropertyTable_Teardown(&theTable);
+}
+
+static uint32_t test_random(uint32_t* ioState)
+{
+    *ioState ^= *ioState << 13;
+    *ioState ^= *ioState >> 17;
+    *ioState ^= *ioState << 5;
+    return *ioState;
+}
+
+static void test_many_keys_are_perfect(void)
+{
+    //	far more keys than a plug-in has, with the selectors of every object the same, the way
+    //	classes of objects share them
+    enum { kObjects = 200, kSpecs = 60 };
+    VocanaPropertySpec theSpecs[kSpecs];
+    uint32_t theRandom = 0x12345678;
+    for(uint32_t i = 0; i < kSpecs; i++)
+    {
+        theSpecs[i].selector = test_random(&theRandom) | 1;
+        theSpecs[i].scope = (i % 3 == 0) ? kTest_ScopeInput : kVocanaPropertyScope_Any;
+        theSpecs[i].flags = i & 1;
+        theSpecs[i].size = i;
+        theSpecs[i].sizeProc = NULL;
+    }
+
+    VocanaPropertyTable theTable;
+    CHECK_EQUAL(VocanaPropertyTable_Init(&theTable, kObjects * (kSpecs + 1)), 0);
+    for(uint32_t theObject = 1; theObject <= kObjects; theObject++)
+    {
+        CHECK_EQUAL(VocanaPropertyTable_AddObject(&theTable, theObject, theSpecs, kSpecs, NULL, NULL), 0);
+    }
+    CHECK_EQUAL(VocanaPropertyTable_Build(&theTable), 0);
+    printf("    %u keys in %u slots, %u buckets\n", theTable.entryCount, theTable.slotCount, theTable.bucketCount);
+
+    //	every key lands on its own entry, and no two keys share a slot
+    uint32_t theMisses = 0;
+    for(uint32_t theObject = 1; theObject <= kObjects; theObject++)
+    {
+        for(uint32_t i = 0; i < kSpecs; i++)
+        {
+            uint32_t theScope = theSpecs[i].scope == kVocanaPropertyScope_Any ? kTest_ScopeOutput : theSpecs[i].scope;
+            const VocanaPropertyEntry* theEntry = VocanaPropertyTable_Find(&theTable, theObject, theSpecs[i].selector, theScope);
+            if(theEntry == NULL || theEntry->objectID != theObject || theEntry->size != i)
+            {
+                ++theMisses;
+            }
+        }
+    }
+    CHECK_EQUAL(theMisses, 0);
+
+    uint32_t theUsedSlots = 0;
+    for(uint32_t theSlot = 0; theSlot < theTable.slotCount; theSlot++)
+    {
+        theUsedSlots += theTable.slots[theSlot] != UINT16_MAX;
+    }
+    CHECK_EQUAL(theUsedSlots, theTable.entryCount);
+
+    VocanaPropertyTable_Teardown(&theTable);
+}
+
+static void test_get(void)
+{
+}
+
+static void test_set(void)
+{
+}
+
+//	Every property of a class carries the class's getter, and only the settable ones its setter.
+static void test_handlers(void)
+{
+    VocanaPropertyTable theTable;
+    CHECK_EQUAL(VocanaPropertyTable_Init(&theTable, 16), 0);
+    CHECK_EQUAL(VocanaPropertyTable_AddObject(&theTable, 3, kTest_DeviceSpecs, 5, test_get, test_set), 0);
+    CHECK_EQUAL(VocanaPropertyTable_AddObject(&theTable, 6, kTest_ControlSpecs, 2, NULL, NULL), 0);
+    CHECK_EQUAL(VocanaPropertyTable_Build(&theTable), 0);
+
+    const VocanaPropertyEntry* theName = VocanaPropertyTable_Find(&theTable, 3, kTest_Name, kTest_ScopeGlobal);
+    const VocanaPropertyEntry* theRate = VocanaPropertyTable_Find(&theTable, 3, kTest_Rate, kTest_ScopeGlobal);
+    const VocanaPropertyEntry* theInput = VocanaPropertyTable_Find(&theTable, 3, kTest_Latency, kTest_ScopeInput);
+    const VocanaPropertyEntry* theOutput = VocanaPropertyTable_Find(&theTable, 3, kTest_Latency, kTest_ScopeOutput);
+    CHECK(theName != NULL && theRate != NULL && theInput != NULL && theOutput != NULL);
+    if(theName != NULL && theRate != NULL && theInput != NULL && theOutput != NULL)
+    {
+        CHECK(theName->getProc == test_get && theName->setProc == NULL);
+        CHECK(theRate->getProc == test_get && theRate->setProc == test_set);
+        CHECK(theInput->getProc == test_get && theInput->setProc == NULL);
+        CHECK(theOutput->getProc == test_get && theOutput->setProc == test_set);
+    }
+
+    //	a class registered without them has neither
+    const VocanaPropertyEntry* theValue = VocanaPropertyTable_Find(&theTable, 6, kTest_Value, kTest_ScopeGlobal);
+    CHECK(theValue != NULL && theValue->getProc == NULL && theValue->setProc == NULL);
+
+    VocanaPropertyTable_Teardown(&theTable);
+}
+
+int main(void)
+{
+    RUN_TEST(test_build_and_find);
+    RUN_TEST(test_scopes);
+    RUN_TEST(test_registration_errors);
+    RUN_TEST(test_many_keys_are_perfect);
+    RUN_TEST(test_handlers);
+    return TEST_RESULT();
+}
@@ -0,0 +1,248 @@
+/*
+     File: VocanaResamplerTests.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Host-side tests for VocanaResampler: the signal-to-noise ratio of tones converted between the
+ devices' rates and 48 kHz, rejection of what would alias, identical output however the input is
+ split into calls, and the cost per frame of both qualities.
+
+ */
+
+#include "VocanaResampler.h"
+#include "VocanaDriverTestSupport.h"
+
+#include <errno.h>
+#include <string.h>
+
+#define kTest_Channels          2
+#define kTest_MaxFrames         4096
+
+static const double kTest_DeviceRates[] = { 8000, 16000, 24000, 44100, 48000, 88200, 96000, 176400, 192000, 352800, 384000, 705600, 768000 };
+
+//	Converts inFrameCount frames in calls of inChunk frames and returns the output frame count.
+static uint32_t test_convert(VocanaResampler* inResampler, const float* inFrames, uint32_t inFrameCount, uint32_t inChunk, float* outFrames)
+{
+    uint32_t theOutputCount = 0;
+    for(uint32_t theDone = 0; theDone < inFrameCount; theDone += inChunk)
+    {
+        uint32_t theCount = inChunk < inFrameCount - theDone ? inChunk : inFrameCount - theDone;
+        theOutputCount += VocanaResampler_Process(inResampler, inFrames + (size_t)theDone * kTest_Channels, theCount, outFrames + (size_t)theOutputCount * kTest_Channels);
+    }
+    return theOutputCount;
+}
+
+//	Converts a tone of inFrequency for a second and returns how far the output is from the same
+//	tone at the output rate, as a signal-to-noise ratio in dB. inSignalFrequency is the tone that
+//	should come out; 0 when nothing should.
+static double test_tone_snr(double inInputRate, double inOutputRate, VocanaResamplerQuality inQuality, double inFrequency, double inSignalFrequency)
+{
+    VocanaResampler theResampler;
+    CHECK_EQUAL(VocanaResampler_Init(&theResampler, inInputRate, inOutputRate, kTest_Channels, kTest_MaxFrames, inQuality), 0);
+
+    uint32_t theInputFrames = (uint32_t)inInputRate;
+    float* theInput = malloc(sizeof(float) * theInputFrames * kTest_Channels);
+    float* theOutput = malloc(sizeof(float) * ((size_t)inOutputRate + 2) * kTest_Channels);
+    for(uint32_t i = 0; i < theInputFrames; i++)
+    {
+        for(uint32_t c = 0; c < kTest_Channels; c++)
+        {
+            theInput[i * kTest_Channels + c] = 0.5f * (float)sin(2.0 * M_PI * inFrequency * i / inInputRate + c);
+        }
+    }
+    uint32_t theOutputFrames = test_convert(&theResampler, theInput, theInputFrames, 512, theOutput);
+
+    //	away from the edges, where the filter sees the silence before and after the tone
+    double theLatency = VocanaResampler_GetLatency(&theResampler);
+    uint32_t theMargin = (uint32_t)(inOutputRate / 20.0);
+    double theSignal = 0.0;
+    double theNoise = 0.0;
+    for(uint32_t n = theMargin; n + theMargin < theOutputFrames; n++)
+    {
+        double theTime = n * inInputRate / inOutputRate - theLatency;
+        for(uint32_t c = 0; c < kTest_Channels; c++)
+        {
+            double theExpected = inSignalFrequency > 0.0 ? 0.5 * sin(2.0 * M_PI * inSignalFrequency * theTime / inInputRate + c) : 0.0;
+            double theError = theOutput[n * kTest_Channels + c] - theExpected;
+            theSignal += 0.125;
+            theNoise += theError * theError;
+        }
+    }
+
+    VocanaResampler_Teardown(&theResampler);
+    free(theInput);
+    free(theOutput);
+    return 10.0 * log10(theSignal / (theNoise + 1.0e-30));
+}
+
+static void test_tones_survive_conversion(void)
+{
+    //	speech-band tones to and from 48 kHz at the rates clients use most
+    static const double kPairs[][2] = {
+        { 44100, 48000 }, { 48000, 44100 }, { 16000, 48000 }, { 48000, 16000 },
+        { 8000, 48000 }, { 96000, 48000 }, { 192000, 48000 }, { 768000, 48000 }, { 48000, 48000 },
+    };
+    for(size_t i = 0; i < sizeof(kPairs) / sizeof(kPairs[0]); i++)
+    {
+        double theSinc = test_tone_snr(kPairs[i][0], kPairs[i][1], kVocanaResampler_Sinc, 1000.0, 1000.0);
+        double theHighSinc = test_tone_snr(kPairs[i][0], kPairs[i][1], kVocanaResampler_Sinc, 3000.0, 3000.0);
+        double theLinear = test_tone_snr(kPairs[i][0], kPairs[i][1], kVocanaResampler_Linear, 1000.0, 1000.0);
+        printf("    %6.0f -> %6.0f: 1 kHz %.1f dB, 3 kHz %.1f dB, linear 1 kHz %.1f dB\n", kPairs[i][0], kPairs[i][1], theSinc, theHighSinc, theLinear);
+        CHECK(theSinc > 80.0);
+        CHECK(theHighSinc > 80.0);
+        CHECK(theLinear > 20.0);
+    }
+}
+
+static void test_aliases_are_rejected(void)
+{
+    //	going down, a tone above the new Nyquist frequency has to go rather than fold back
+    double theDown = test_tone_snr(96000, 48000, kVocanaResampler_Sinc, 30000.0, 0.0);
+    double theDownLinear = test_tone_snr(96000, 48000, kVocanaResampler_Linear, 30000.0, 0.0);
+    double theSpeech = test_tone_snr(48000, 16000, kVocanaResampler_Sinc, 11000.0, 0.0);
+
+    //	going up, the images of a tone near the old Nyquist frequency have to go
+    double theUp = test_tone_snr(16000, 48000, kVocanaResampler_Sinc, 6000.0, 6000.0);
+    double theUpLinear = test_tone_snr(16000, 48000, kVocanaResampler_Linear, 6000.0, 6000.0);
+    printf("    30 kHz from 96 kHz down by %.1f dB (linear %.1f dB), 11 kHz from 48 kHz to 16 kHz down by %.1f dB\n", theDown, theDownLinear, theSpeech);
+    printf("    6 kHz from 16 kHz to 48 kHz at %.1f dB SNR (linear %.1f dB)\n", theUp, theUpLinear);
+    CHECK(theDown > 80.0);
+    CHECK(theSpeech > 80.0);
+    CHECK(theUp > 70.0);
+    CHECK(theDownLinear < 20.0);
+}
+
+static void test_streaming_matches_one_call(void)
+{
+    static const double kPairs[][2] = { { 44100, 48000 }, { 48000, 44100 }, { 768000, 48000 }, { 8000, 48000 } };
+    const uint32_t theInputFrames = 40000;
+    float* theInput = malloc(sizeof(float) * theInputFrames * kTest_Channels);
+    float* theWhole = malloc(sizeof(float) * (theInputFrames * 6 + 8) * kTest_Channels);
+    float* theStreamed = malloc(sizeof(float) * (theInputFrames * 6 + 8) * kTest_Channels);
+    uint32_t theSeed = 5;
+    for(uint32_t i = 0; i < theInputFrames * kTest_Channels; i++)
+    {
+        theSeed = theSeed * 1664525u + 1013904223u;
+        theInput[i] = (float)(theSeed >> 8) / (float)(1u << 24) - 0.5f;
+    }
+
+    for(size_t p = 0; p < sizeof(kPairs) / sizeof(kPairs[0]); p++)
+    {
+        for(int q = 0; q < 2; q++)
+        {
+            VocanaResamplerQuality theQuality = q == 0 ? kVocanaResampler_Sinc : kVocanaResampler_Linear;
+            VocanaResampler theResampler;
+            CHECK_EQUAL(VocanaResampler_Init(&theResampler, kPairs[p][0], kPairs[p][1], kTest_Channels, theInputFrames, theQuality), 0);
+            uint32_t theWholeCount = VocanaResampler_Process(&theResampler, theInput, theInputFrames, theWhole);
+
+            //	output frame n needs input up to n * M / L, so the count is known exactly
+            uint64_t theOutputCount = ((uint64_t)theInputFrames * (uint64_t)kPairs[p][1] + (uint64_t)kPairs[p][0] - 1) / (uint64_t)kPairs[p][0];
+            CHECK_EQUAL(theWholeCount, theOutputCount);
+
+            //	the same input in calls of many sizes, from a single frame up
+            VocanaResampler_Reset(&theResampler);
+            uint32_t theStreamedCount = 0;
+            uint32_t theDone = 0;
+            uint32_t theMismatches = 0;
+            for(uint32_t theChunk = 1; theDone < theInputFrames; theChunk = theChunk * 3 % 1021 + 1)
+            {
+                uint32_t theCount = theChunk < theInputFrames - theDone ? theChunk : theInputFrames - theDone;
+                uint32_t thePredicted = VocanaResampler_GetOutputFrameCount(&theResampler, theCount);
+                uint32_t theWritten = VocanaResampler_Process(&theResampler, theInput + (size_t)theDone * kTest_Channels, theCount, theStreamed + (size_t)theStreamedCount * kTest_Channels);
+                theMismatches += thePredicted != theWritten;
+                theMismatches += theWritten > VocanaResampler_GetMaxOutputFrameCount(&theResampler, theCount);
+                theStreamedCount += theWritten;
+                theDone += theCount;
+            }
+            CHECK_EQUAL(theMismatches, 0);
+            CHECK_EQUAL(theStreamedCount, theWholeCount);
+            CHECK(memcmp(theWhole, theStreamed, sizeof(float) * theWholeCount * kTest_Channels) == 0);
+            VocanaResampler_Teardown(&theResampler);
+        }
+    }
+
+    free(theInput);
+    free(theWhole);
+    free(theStreamed);
+}
+
+static void test_every_device_rate(void)
+{
+    //	both ways between 48 kHz and every rate the device offers, with the output frames of a
+    //	device cycle always covered by GetMaxOutputFrameCount
+    for(size_t i = 0; i < sizeof(kTest_DeviceRates) / sizeof(kTest_DeviceRates[0]); i++)
+    {
+        for(int theDirection = 0; theDirection < 2; theDirection++)
+        {
+            double theInputRate = theDirection == 0 ? kTest_DeviceRates[i] : 48000.0;
+            double theOutputRate = theDirection == 0 ? 48000.0 : kTest_DeviceRates[i];
+            VocanaResampler theResampler;
+            CHECK_EQUAL(VocanaResampler_Init(&theResampler, theInputRate, theOutputRate, kTest_Channels, 512, kVocanaResampler_Sinc), 0);
+            CHECK(theResampler.interpolation <= kVocanaResampler_MaxPhases);
+            CHECK_EQUAL(theResampler.tapCount % 4, 0);
+            CHECK(VocanaResampler_GetLatency(&theResampler) >= 32);
+            VocanaResampler_Teardown(&theResampler);
+        }
+    }
+}
+
+static void test_init_errors(void)
+{
+    VocanaResampler theResampler;
+    CHECK_EQUAL(VocanaResampler_Init(&theResampler, 44100, 48000, 0, 512, kVocanaResampler_Sinc), EINVAL);
+    CHECK_EQUAL(VocanaResampler_Init(&theResampler, 44100, 48000, 2, 0, kVocanaResampler_Sinc), EINVAL);
+    CHECK_EQUAL(VocanaResampler_Init(&theResampler, 44100.5, 48000, 2, 512, kVocanaResampler_Sinc), EINVAL);
+    CHECK_EQUAL(VocanaResampler_Init(&theResampler, 0, 48000, 2, 512, kVocanaResampler_Sinc), EINVAL);
+
+    //	a ratio with too many phases for a table is still fine for the linear quality
+    CHECK_EQUAL(VocanaResampler_Init(&theResampler, 47999, 48000, 2, 512, kVocanaResampler_Sinc), EINVAL);
+    CHECK_EQUAL(VocanaResampler_Init(&theResampler, 47999, 48000, 2, 512, kVocanaResampler_Linear), 0);
+    CHECK_EQUAL(VocanaResampler_GetLatency(&theResampler), 1);
+    VocanaResampler_Teardown(&theResampler);
+    VocanaResampler_Teardown(&theResampler);
+}
+
+static void test_cost(void)
+{
+    static const double kPairs[][2] = { { 44100, 48000 }, { 48000, 44100 }, { 16000, 48000 }, { 192000, 48000 } };
+    const uint32_t theCycleFrames = 512;
+    float theInput[512 * kTest_Channels];
+    float theOutput[(512 * 4 + 2) * kTest_Channels];
+    for(uint32_t i = 0; i < theCycleFrames * kTest_Channels; i++)
+    {
+        theInput[i] = (float)sin(0.01 * i);
+    }
+
+    for(size_t p = 0; p < sizeof(kPairs) / sizeof(kPairs[0]); p++)
+    {
+        double theNanoseconds[2] = { 0.0, 0.0 };
+        for(int q = 0; q < 2; q++)
+        {
+            VocanaResampler theResampler;
+            VocanaResampler_Init(&theResampler, kPairs[p][0], kPairs[p][1], kTest_Channels, theCycleFrames, q == 0 ? kVocanaResampler_Sinc : kVocanaResampler_Linear);
+            uint64_t theOutputFrames = 0;
+            double theStart = test_now_seconds();
+            for(uint32_t theCycle = 0; theCycle < 2000; theCycle++)
+            {
+                theOutputFrames += VocanaResampler_Process(&theResampler, theInput, theCycleFrames, theOutput);
+            }
+            theNanoseconds[q] = (test_now_seconds() - theStart) * 1.0e9 / (double)theOutputFrames;
+            VocanaResampler_Teardown(&theResampler);
+        }
+        printf("    %6.0f -> %6.0f stereo: %.1f ns per output frame, linear %.1f ns\n", kPairs[p][0], kPairs[p][1], theNanoseconds[0], theNanoseconds[1]);
+
+        //	a whole second of stereo has to cost a small fraction of a second
+        CHECK(theNanoseconds[0] * kPairs[p][1] < 0.05e9);
+    }
+}
+
+int main(void)
+{
+    RUN_TEST(test_tones_survive_conversion);
+    RUN_TEST(test_aliases_are_rejected);
+    RUN_TEST(test_streaming_matches_one_call);
+    RUN_TEST(test_every_device_rate);
+    RUN_TEST(test_init_errors);
+    RUN_TEST(test_cost);
+    return TEST_RESULT();
+}
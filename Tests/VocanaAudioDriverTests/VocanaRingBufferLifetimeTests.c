@@ -0,0 +1,307 @@
+/*
+     File: VocanaRingBufferLifetimeTests.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Host-side tests for VocanaRingBufferLifetime: concurrent start/stop/trim against running IO.
+
+ */
+
+#include "VocanaRingBufferLifetime.h"
+#include "VocanaDriverTestSupport.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
+#define kTest_Channels          2
+#define kTest_CapacityFrames    4096
+#define kTest_IOFrames          256
+
+static void test_allocates_once_across_start_stop(void)
+{
+    VocanaRingBufferLifetime theLifetime = { 0 };
+    CHECK_EQUAL(VocanaRingBufferLifetime_Init(&theLifetime, kTest_CapacityFrames, kTest_Channels, 0), 0);
+
+    for(int i = 0; i < 1000; i++)
+    {
+        bool isFirst = false;
+        bool isLast = false;
+        CHECK_EQUAL(VocanaRingBufferLifetime_Start(&theLifetime, (uint64_t)i * 512, &isFirst), 0);
+        CHECK(isFirst);
+        CHECK_EQUAL(VocanaRingBufferLifetime_Stop(&theLifetime, &isLast), 0);
+        CHECK(isLast);
+    }
+
+    CHECK_EQUAL(VocanaRingBufferLifetime_GetAllocationCount(&theLifetime), 1);
+    VocanaRingBufferLifetime_Teardown(&theLifetime);
+}
+
+static void test_client_counting(void)
+{
+    VocanaRingBufferLifetime theLifetime = { 0 };
+    CHECK_EQUAL(VocanaRingBufferLifetime_Init(&theLifetime, kTest_CapacityFrames, kTest_Channels, 0), 0);
+
+    bool isFirst = false;
+    bool isLast = false;
+
+    CHECK_EQUAL(VocanaRingBufferLifetime_Stop(&theLifetime, &isLast), ERANGE);
+
+    CHECK_EQUAL(VocanaRingBufferLifetime_Start(&theLifetime, 0, &isFirst), 0);
+    CHECK(isFirst);
+    CHECK_EQUAL(VocanaRingBufferLifetime_Start(&theLifetime, 0, &isFirst), 0);
+    CHECK(!isFirst);
+
+    CHECK(VocanaRingBufferLifetime_BeginIO(&theLifetime) != NULL);
+    VocanaRingBufferLifetime_EndIO(&theLifetime);
+
+    CHECK_EQUAL(VocanaRingBufferLifetime_Trim(&theLifetime), EBUSY);
+
+    CHECK_EQUAL(VocanaRingBufferLifetime_Stop(&theLifetime, &isLast), 0);
+    CHECK(!isLast);
+    CHECK_EQUAL(VocanaRingBufferLifetime_Stop(&theLifetime, &isLast), 0);
+    CHECK(isLast);
+
+    //	no IO once the last client stopped
+    CHECK(VocanaRingBufferLifetime_BeginIO(&theLifetime) == NULL);
+    VocanaRingBufferLifetime_EndIO(&theLifetime);
+
+    VocanaRingBufferLifetime_Teardown(&theLifetime);
+}
+
+static void test_trim_and_reallocate(void)
+{
+    VocanaRingBufferLifetime theLifetime = { 0 };
+    CHECK_EQUAL(VocanaRingBufferLifetime_Init(&theLifetime, kTest_CapacityFrames, kTest_Channels, 0), 0);
+
+    CHECK_EQUAL(VocanaRingBufferLifetime_Trim(&theLifetime), 0);
+    CHECK(!VocanaRingBuffer_IsAllocated(&theLifetime.ring));
+    CHECK_EQUAL(VocanaRingBufferLifetime_Trim(&theLifetime), 0);
+
+    bool isFirst = false;
+    CHECK_EQUAL(VocanaRingBufferLifetime_Start(&theLifetime, 0, &isFirst), 0);
+    CHECK(VocanaRingBuffer_IsAllocated(&theLifetime.ring));
+    CHECK_EQUAL(VocanaRingBufferLifetime_GetAllocationCount(&theLifetime), 2);
+    CHECK_EQUAL(VocanaRingBufferLifetime_Stop(&theLifetime, NULL), 0);
+
+    VocanaRingBufferLifetime_Teardown(&theLifetime);
+}
+
+static void test_set_channel_count(void)
+{
+    VocanaRingBufferLifetime theLifetime = { 0 };
+    CHECK_EQUAL(VocanaRingBufferLifetime_Init(&theLifetime, kTest_CapacityFrames, kTest_Channels, 0), 0);
+
+    bool isFirst = false;
+    CHECK_EQUAL(VocanaRingBufferLifetime_Start(&theLifetime, 0, &isFirst), 0);
+    CHECK_EQUAL(VocanaRingBufferLifetime_SetChannelCount(&theLifetime, 8), EBUSY);
+    CHECK_EQUAL(VocanaRingBufferLifetime_Stop(&theLifetime, NULL), 0);
+
+    //	the same count is free, another one reallocates
+    CHECK_EQUAL(VocanaRingBufferLifetime_SetChannelCount(&theLifetime, 0), EINVAL);
+    CHECK_EQUAL(VocanaRingBufferLifetime_SetChannelCount(&theLifetime, kTest_Channels), 0);
+    CHECK_EQUAL(VocanaRingBufferLifetime_GetAllocationCount(&theLifetime), 1);
+    CHECK_EQUAL(VocanaRingBufferLifetime_SetChannelCount(&theLifetime, 8), 0);
+    CHECK_EQUAL(VocanaRingBufferLifetime_GetAllocationCount(&theLifetime), 2);
+    CHECK_EQUAL(theLifetime.ring.channelCount, 8);
+
+    //	a trimmed ring stays trimmed and comes back with the new count
+    CHECK_EQUAL(VocanaRingBufferLifetime_Trim(&theLifetime), 0);
+    CHECK_EQUAL(VocanaRingBufferLifetime_SetChannelCount(&theLifetime, 4), 0);
+    CHECK(!VocanaRingBuffer_IsAllocated(&theLifetime.ring));
+    CHECK_EQUAL(VocanaRingBufferLifetime_Start(&theLifetime, 0, &isFirst), 0);
+    CHECK_EQUAL(theLifetime.ring.channelCount, 4);
+
+    float theIn[kTest_IOFrames * 4];
+    float theOut[kTest_IOFrames * 4];
+    for(uint32_t i = 0; i < kTest_IOFrames * 4; i++)
+    {
+        theIn[i] = (float)i;
+    }
+    VocanaRingBuffer* theRing = VocanaRingBufferLifetime_BeginIO(&theLifetime);
+    CHECK(theRing != NULL);
+    VocanaRingBuffer_Write(theRing, 0, theIn, kTest_IOFrames);
+    CHECK_EQUAL(VocanaRingBuffer_Read(theRing, 0, theOut, kTest_IOFrames), kTest_IOFrames);
+    VocanaRingBufferLifetime_EndIO(&theLifetime);
+    CHECK(memcmp(theIn, theOut, sizeof(theIn)) == 0);
+    CHECK_EQUAL(VocanaRingBufferLifetime_Stop(&theLifetime, NULL), 0);
+
+    VocanaRingBufferLifetime_Teardown(&theLifetime);
+}
+
+static void test_reuse_keeps_in_flight_io(void)
+{
+    //	an IO thread found the lifetime just before it was torn down and ends its cycle only after
+    //	the storage was set up again for the next device
+    VocanaRingBufferLifetime theLifetime = { 0 };
+    CHECK_EQUAL(VocanaRingBufferLifetime_Init(&theLifetime, kTest_CapacityFrames, kTest_Channels, 0), 0);
+    VocanaRingBufferLifetime_Teardown(&theLifetime);
+    CHECK(VocanaRingBufferLifetime_BeginIO(&theLifetime) == NULL);
+    CHECK_EQUAL(VocanaRingBufferLifetime_Init(&theLifetime, kTest_CapacityFrames, kTest_Channels, 0), 0);
+    CHECK_EQUAL(atomic_load(&theLifetime.ioInFlight), 1);
+    VocanaRingBufferLifetime_EndIO(&theLifetime);
+    CHECK_EQUAL(atomic_load(&theLifetime.ioInFlight), 0);
+
+    //	so the next quiesce has nothing to wait for
+    bool isFirst = false;
+    CHECK_EQUAL(VocanaRingBufferLifetime_Start(&theLifetime, 0, &isFirst), 0);
+    CHECK(isFirst);
+    CHECK_EQUAL(VocanaRingBufferLifetime_Stop(&theLifetime, NULL), 0);
+    VocanaRingBufferLifetime_Teardown(&theLifetime);
+}
+
+//==================================================================================================
+//	Concurrent start/stop/trim against running IO
+//==================================================================================================
+
+typedef struct StressContext
+{
+    VocanaRingBufferLifetime    lifetime;
+    _Atomic bool                done;
+    _Atomic uint64_t            sampleTime;
+    _Atomic uint64_t            cyclesWithRing;
+    _Atomic uint64_t            cyclesWithoutRing;
+    _Atomic uint64_t            controlErrors;
+    _Atomic uint32_t            ioThreadCount;
+    bool                        trims;
+} StressContext;
+
+static void* stress_io(void* inContext)
+{
+    StressContext* theContext = inContext;
+    float theBuffer[kTest_IOFrames * kTest_Channels];
+
+    //	the ring is single-producer, so only the first IO thread writes
+    bool isProducer = atomic_fetch_add(&theContext->ioThreadCount, 1) == 0;
+    for(uint32_t i = 0; i < kTest_IOFrames * kTest_Channels; i++)
+    {
+        theBuffer[i] = 0.25f;
+    }
+
+    while(!atomic_load(&theContext->done))
+    {
+        uint64_t theFrame = atomic_fetch_add(&theContext->sampleTime, kTest_IOFrames);
+
+        VocanaRingBuffer* theRing = VocanaRingBufferLifetime_BeginIO(&theContext->lifetime);
+        if(theRing != NULL)
+        {
+            if(isProducer)
+            {
+                VocanaRingBuffer_Write(theRing, theFrame, theBuffer, kTest_IOFrames);
+            }
+            VocanaRingBuffer_Read(theRing, theFrame, theBuffer, kTest_IOFrames);
+            atomic_fetch_add(&theContext->cyclesWithRing, 1);
+        }
+        else
+        {
+            atomic_fetch_add(&theContext->cyclesWithoutRing, 1);
+        }
+        VocanaRingBufferLifetime_EndIO(&theContext->lifetime);
+
+        //	real IO threads are periodic; leave gaps for the control threads to quiesce in
+        sched_yield();
+    }
+
+    return NULL;
+}
+
+static void* stress_control(void* inContext)
+{
+    StressContext* theContext = inContext;
+    uint32_t theSeed = (uint32_t)(uintptr_t)&theSeed;
+
+    struct timespec theRunTime = { 0, 20000 };
+
+    for(int i = 0; i < 5000; i++)
+    {
+        theSeed = theSeed * 1103515245u + 12345u;
+        if(VocanaRingBufferLifetime_Start(&theContext->lifetime, atomic_load(&theContext->sampleTime), NULL) != 0)
+        {
+            atomic_fetch_add(&theContext->controlErrors, 1);
+        }
+        nanosleep(&theRunTime, NULL);
+        if(theContext->trims && (theSeed >> 16) % 8 == 0)
+        {
+            //	EBUSY is expected whenever another control thread has a client running
+            VocanaRingBufferLifetime_Trim(&theContext->lifetime);
+        }
+        if(VocanaRingBufferLifetime_Stop(&theContext->lifetime, NULL) != 0)
+        {
+            atomic_fetch_add(&theContext->controlErrors, 1);
+        }
+        if(theContext->trims && (theSeed >> 20) % 8 == 0)
+        {
+            VocanaRingBufferLifetime_Trim(&theContext->lifetime);
+        }
+        nanosleep(&theRunTime, NULL);
+    }
+
+    return NULL;
+}
+
+static void test_concurrent_control_and_io(bool inTrims)
+{
+    enum { kIOThreads = 3, kControlThreads = 3 };
+
+    StressContext theContext;
+    memset(&theContext, 0, sizeof(theContext));
+    theContext.trims = inTrims;
+    CHECK_EQUAL(VocanaRingBufferLifetime_Init(&theContext.lifetime, kTest_CapacityFrames, kTest_Channels, 0), 0);
+
+    pthread_t theIOThreads[kIOThreads];
+    pthread_t theControlThreads[kControlThreads];
+    for(int i = 0; i < kIOThreads; i++)
+    {
+        pthread_create(&theIOThreads[i], NULL, stress_io, &theContext);
+    }
+    for(int i = 0; i < kControlThreads; i++)
+    {
+        pthread_create(&theControlThreads[i], NULL, stress_control, &theContext);
+    }
+    for(int i = 0; i < kControlThreads; i++)
+    {
+        pthread_join(theControlThreads[i], NULL);
+    }
+    atomic_store(&theContext.done, true);
+    for(int i = 0; i < kIOThreads; i++)
+    {
+        pthread_join(theIOThreads[i], NULL);
+    }
+
+    uint64_t theAllocations = VocanaRingBufferLifetime_GetAllocationCount(&theContext.lifetime);
+    printf("    %llu cycles with ring, %llu without, %llu allocations\n",
+           (unsigned long long)atomic_load(&theContext.cyclesWithRing),
+           (unsigned long long)atomic_load(&theContext.cyclesWithoutRing),
+           (unsigned long long)theAllocations);
+
+    CHECK_EQUAL(atomic_load(&theContext.controlErrors), 0);
+    CHECK_EQUAL(atomic_load(&theContext.lifetime.ioInFlight), 0);
+    CHECK(atomic_load(&theContext.cyclesWithRing) > 0);
+    if(inTrims)
+    {
+        CHECK(theAllocations > 1);
+    }
+    else
+    {
+        CHECK_EQUAL(theAllocations, 1);
+    }
+    CHECK_EQUAL(VocanaRingBufferLifetime_Stop(&theContext.lifetime, NULL), ERANGE);
+
+    VocanaRingBufferLifetime_Teardown(&theContext.lifetime);
+}
+
+static void test_concurrent_start_stop_io(void)         { test_concurrent_control_and_io(false); }
+static void test_concurrent_start_stop_trim_io(void)    { test_concurrent_control_and_io(true); }
+
+int main(void)
+{
+    RUN_TEST(test_allocates_once_across_start_stop);
+    RUN_TEST(test_client_counting);
+    RUN_TEST(test_trim_and_reallocate);
+    RUN_TEST(test_set_channel_count);
+    RUN_TEST(test_reuse_keeps_in_flight_io);
+    RUN_TEST(test_concurrent_start_stop_io);
+    RUN_TEST(test_concurrent_start_stop_trim_io);
+    return TEST_RESULT();
+}
@@ -0,0 +1,269 @@
+/*
+     File: VocanaRingBufferTests.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Host-side tests for VocanaRingBuffer, including a two-thread producer/consumer stress run.
+
+ */
+
+#include "VocanaRingBuffer.h"
+#include "VocanaDriverTestSupport.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#define kTest_Channels          2
+#define kTest_CapacityFrames    2048
+
+//	Every frame carries a non-zero value derived from its sample time, so a reader can tell real
+//	data, silence and torn data apart.
+static float test_sample_value(uint64_t inFrame, uint32_t inChannel)
+{
+    return (float)((inFrame * 7u + inChannel) % 65521u) + 1.0f;
+}
+
+static void test_fill(float* outFrames, uint64_t inFrame, uint32_t inFrameCount, uint32_t inChannels)
+{
+    for(uint32_t i = 0; i < inFrameCount; i++)
+    {
+        for(uint32_t c = 0; c < inChannels; c++)
+        {
+            outFrames[i * inChannels + c] = test_sample_value(inFrame + i, c);
+        }
+    }
+}
+
+//	Returns the number of frames that match the signal, or -1 if any frame is neither the expected
+//	signal nor complete silence.
+static int test_verify(const float* inFrames, uint64_t inFrame, uint32_t inFrameCount, uint32_t inChannels)
+{
+    int theMatches = 0;
+    for(uint32_t i = 0; i < inFrameCount; i++)
+    {
+        bool isSignal = true;
+        bool isSilence = true;
+        for(uint32_t c = 0; c < inChannels; c++)
+        {
+            float theSample = inFrames[i * inChannels + c];
+            isSignal = isSignal && theSample == test_sample_value(inFrame + i, c);
+            isSilence = isSilence && theSample == 0.0f;
+        }
+        if(!isSignal && !isSilence)
+        {
+            return -1;
+        }
+        theMatches += isSignal;
+    }
+    return theMatches;
+}
+
+static void test_init_rejects_bad_arguments(void)
+{
+    VocanaRingBuffer theRing;
+    CHECK(VocanaRingBuffer_Init(&theRing, 1000, kTest_Channels, 0) != 0);
+    CHECK(VocanaRingBuffer_Init(&theRing, 0, kTest_Channels, 0) != 0);
+    CHECK(VocanaRingBuffer_Init(&theRing, kTest_CapacityFrames, 0, 0) != 0);
+    CHECK(VocanaRingBuffer_Init(NULL, kTest_CapacityFrames, kTest_Channels, 0) != 0);
+}
+
+static void test_round_trip_across_wrap(uint32_t inFlags)
+{
+    VocanaRingBuffer theRing;
+    CHECK_EQUAL(VocanaRingBuffer_Init(&theRing, kTest_CapacityFrames, kTest_Channels, inFlags), 0);
+
+    float theIn[512 * kTest_Channels];
+    float theOut[512 * kTest_Channels];
+
+    //	walk the write position all the way around the ring several times
+    for(uint64_t theFrame = 0; theFrame < kTest_CapacityFrames * 5; theFrame += 384)
+    {
+        test_fill(theIn, theFrame, 384, kTest_Channels);
+        VocanaRingBuffer_Write(&theRing, theFrame, theIn, 384);
+
+        memset(theOut, 0xff, sizeof(theOut));
+        CHECK_EQUAL(VocanaRingBuffer_Read(&theRing, theFrame, theOut, 384), 384);
+        CHECK_EQUAL(test_verify(theOut, theFrame, 384, kTest_Channels), 384);
+    }
+
+    VocanaRingBuffer_Teardown(&theRing);
+    CHECK(!VocanaRingBuffer_IsAllocated(&theRing));
+}
+
+static void test_round_trip_mirrored(void)      { test_round_trip_across_wrap(0); }
+static void test_round_trip_split(void)         { test_round_trip_across_wrap(kVocanaRingBufferFlag_NoMirror); }
+
+static void test_unwritten_and_overwritten_frames_are_silent(void)
+{
+    VocanaRingBuffer theRing;
+    CHECK_EQUAL(VocanaRingBuffer_Init(&theRing, kTest_CapacityFrames, kTest_Channels, 0), 0);
+
+    float theIn[kTest_CapacityFrames * kTest_Channels];
+    float theOut[512 * kTest_Channels];
+
+    //	nothing written yet
+    CHECK_EQUAL(VocanaRingBuffer_Read(&theRing, 0, theOut, 512), 0);
+    CHECK_EQUAL(test_verify(theOut, 0, 512, kTest_Channels), 0);
+
+    test_fill(theIn, 0, kTest_CapacityFrames, kTest_Channels);
+    VocanaRingBuffer_Write(&theRing, 0, theIn, kTest_CapacityFrames);
+    test_fill(theIn, kTest_CapacityFrames, 256, kTest_Channels);
+    VocanaRingBuffer_Write(&theRing, kTest_CapacityFrames, theIn, 256);
+
+    //	the first 256 frames have been overwritten, the next 256 are still there
+    CHECK_EQUAL(VocanaRingBuffer_Read(&theRing, 0, theOut, 512), 256);
+    CHECK_EQUAL(test_verify(theOut, 0, 512, kTest_Channels), 256);
+    CHECK(theOut[0] == 0.0f);
+    CHECK(theOut[256 * kTest_Channels] == test_sample_value(256, 0));
+
+    //	straddling the write cursor
+    uint64_t theWriteFrame = VocanaRingBuffer_GetWriteFrame(&theRing);
+    CHECK_EQUAL(VocanaRingBuffer_Read(&theRing, theWriteFrame - 100, theOut, 512), 100);
+    CHECK_EQUAL(VocanaRingBuffer_GetReadFrame(&theRing), theWriteFrame - 100 + 512);
+
+    VocanaRingBuffer_Teardown(&theRing);
+}
+
+static void test_skipped_frames_are_silenced(void)
+{
+    VocanaRingBuffer theRing;
+    CHECK_EQUAL(VocanaRingBuffer_Init(&theRing, kTest_CapacityFrames, kTest_Channels, 0), 0);
+
+    float theIn[kTest_CapacityFrames * kTest_Channels];
+    float theOut[kTest_CapacityFrames * kTest_Channels];
+
+    test_fill(theIn, 0, kTest_CapacityFrames, kTest_Channels);
+    VocanaRingBuffer_Write(&theRing, 0, theIn, kTest_CapacityFrames);
+
+    //	jump 1000 frames ahead; the frames in between must not read back as the old lap
+    test_fill(theIn, kTest_CapacityFrames + 1000, 100, kTest_Channels);
+    VocanaRingBuffer_Write(&theRing, kTest_CapacityFrames + 1000, theIn, 100);
+
+    CHECK_EQUAL(VocanaRingBuffer_Read(&theRing, kTest_CapacityFrames, theOut, 1100), 1100);
+    CHECK_EQUAL(test_verify(theOut, kTest_CapacityFrames, 1100, kTest_Channels), 100);
+    CHECK(theOut[999 * kTest_Channels] == 0.0f);
+
+    VocanaRingBuffer_Teardown(&theRing);
+}
+
+static void test_reset(void)
+{
+    VocanaRingBuffer theRing;
+    CHECK_EQUAL(VocanaRingBuffer_Init(&theRing, kTest_CapacityFrames, kTest_Channels, 0), 0);
+
+    float theIn[256 * kTest_Channels];
+    float theOut[256 * kTest_Channels];
+    test_fill(theIn, 0, 256, kTest_Channels);
+    VocanaRingBuffer_Write(&theRing, 0, theIn, 256);
+
+    VocanaRingBuffer_Reset(&theRing, 10000);
+    CHECK_EQUAL(VocanaRingBuffer_GetWriteFrame(&theRing), 10000);
+    CHECK_EQUAL(VocanaRingBuffer_Read(&theRing, 9900, theOut, 256), 0);
+    CHECK_EQUAL(test_verify(theOut, 9900, 256, kTest_Channels), 0);
+
+    VocanaRingBuffer_Teardown(&theRing);
+}
+
+//==================================================================================================
+//	Two-thread stress
+//==================================================================================================
+
+typedef struct StressContext
+{
+    VocanaRingBuffer    ring;
+    _Atomic bool        done;
+    uint64_t            totalFrames;
+    uint64_t            readFrames;
+    uint64_t            validFrames;
+    uint64_t            corruptReads;
+    uint64_t            miscountedReads;
+} StressContext;
+
+static void* stress_producer(void* inContext)
+{
+    StressContext* theContext = inContext;
+    float theBuffer[1024 * kTest_Channels];
+    uint64_t theFrame = 0;
+    uint32_t theSeed = 1;
+
+    while(theFrame < theContext->totalFrames)
+    {
+        theSeed = theSeed * 1103515245u + 12345u;
+        uint32_t theCount = 64 + (theSeed >> 16) % 960;
+        test_fill(theBuffer, theFrame, theCount, kTest_Channels);
+        VocanaRingBuffer_Write(&theContext->ring, theFrame, theBuffer, theCount);
+        theFrame += theCount;
+    }
+
+    atomic_store(&theContext->done, true);
+    return NULL;
+}
+
+static void* stress_consumer(void* inContext)
+{
+    StressContext* theContext = inContext;
+    float theBuffer[1024 * kTest_Channels];
+    uint32_t theSeed = 7;
+
+    while(!atomic_load(&theContext->done))
+    {
+        theSeed = theSeed * 1103515245u + 12345u;
+        uint32_t theCount = 32 + (theSeed >> 16) % 992;
+        uint32_t theLag = (theSeed >> 8) % (kTest_CapacityFrames + 512);
+
+        uint64_t theWriteFrame = VocanaRingBuffer_GetWriteFrame(&theContext->ring);
+        uint64_t theFrame = theWriteFrame > theLag ? theWriteFrame - theLag : 0;
+
+        uint32_t theValid = VocanaRingBuffer_Read(&theContext->ring, theFrame, theBuffer, theCount);
+        int theMatches = test_verify(theBuffer, theFrame, theCount, kTest_Channels);
+
+        theContext->readFrames += theCount;
+        theContext->validFrames += theValid;
+        theContext->corruptReads += (theMatches < 0);
+        theContext->miscountedReads += (theMatches >= 0 && (uint32_t)theMatches != theValid);
+    }
+
+    return NULL;
+}
+
+static void test_two_thread_stress(uint32_t inFlags)
+{
+    StressContext theContext;
+    memset(&theContext, 0, sizeof(theContext));
+    theContext.totalFrames = 48000ull * 600;    //  ten minutes of audio at 48kHz
+    CHECK_EQUAL(VocanaRingBuffer_Init(&theContext.ring, kTest_CapacityFrames, kTest_Channels, inFlags), 0);
+
+    pthread_t theProducer;
+    pthread_t theConsumer;
+    pthread_create(&theConsumer, NULL, stress_consumer, &theContext);
+    pthread_create(&theProducer, NULL, stress_producer, &theContext);
+    pthread_join(theProducer, NULL);
+    pthread_join(theConsumer, NULL);
+
+    printf("    %llu frames read, %llu carried data, %llu corrupt reads, %llu miscounted reads\n",
+           (unsigned long long)theContext.readFrames, (unsigned long long)theContext.validFrames,
+           (unsigned long long)theContext.corruptReads, (unsigned long long)theContext.miscountedReads);
+
+    CHECK(theContext.readFrames > 0);
+    CHECK_EQUAL(theContext.corruptReads, 0);
+    CHECK_EQUAL(theContext.miscountedReads, 0);
+
+    VocanaRingBuffer_Teardown(&theContext.ring);
+}
+
+static void test_two_thread_stress_mirrored(void)   { test_two_thread_stress(0); }
+static void test_two_thread_stress_split(void)      { test_two_thread_stress(kVocanaRingBufferFlag_NoMirror); }
+
+int main(void)
+{
+    RUN_TEST(test_init_rejects_bad_arguments);
+    RUN_TEST(test_round_trip_mirrored);
+    RUN_TEST(test_round_trip_split);
+    RUN_TEST(test_unwritten_and_overwritten_frames_are_silent);
+    RUN_TEST(test_skipped_frames_are_silenced);
+    RUN_TEST(test_reset);
+    RUN_TEST(test_two_thread_stress_mirrored);
+    RUN_TEST(test_two_thread_stress_split);
+    return TEST_RESULT();
+}
@@ -0,0 +1,186 @@
+/*
+     File: VocanaSpectralGateTests.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Host-side tests for VocanaSpectralGate: exact reconstruction with the gate open, noise
+ reduction between bursts of tone and preservation of the tone itself.
+
+ */
+
+#include "VocanaSpectralGate.h"
+#include "VocanaDriverTestSupport.h"
+
+#include <errno.h>
+#include <string.h>
+
+#define kTest_SampleRate        48000.0
+#define kTest_Channels          2
+#define kTest_MaxFrames         1024
+#define kTest_Seconds           4
+
+static const VocanaProcessorConfiguration kTest_Configuration = { kTest_SampleRate, kTest_Channels, kTest_MaxFrames };
+
+static float test_noise(uint32_t* ioSeed)
+{
+    *ioSeed = *ioSeed * 1664525u + 1013904223u;
+    return (float)(*ioSeed >> 8) / (float)(1u << 24) * 2.0f - 1.0f;
+}
+
+//	Runs inFrames through a new gate in cycles of varying size.
+static void test_run(const float* inFrames, float* outFrames, uint32_t inFrameCount, uint32_t* outLatency)
+{
+    const VocanaProcessorInterface* theInterface = VocanaSpectralGate_GetInterface();
+    void* theGate = NULL;
+    CHECK_EQUAL(theInterface->create(&kTest_Configuration, &theGate), 0);
+    *outLatency = theInterface->latency(theGate);
+
+    uint32_t theSeed = 3;
+    uint32_t theDone = 0;
+    while(theDone < inFrameCount)
+    {
+        theSeed = theSeed * 1103515245u + 12345u;
+        uint32_t theCount = 1 + (theSeed >> 16) % kTest_MaxFrames;
+        theCount = theCount < inFrameCount - theDone ? theCount : inFrameCount - theDone;
+        theInterface->process(theGate, inFrames + (size_t)theDone * kTest_Channels, outFrames + (size_t)theDone * kTest_Channels, theCount);
+        theDone += theCount;
+    }
+    theInterface->destroy(theGate);
+}
+
+static void test_open_gate_reconstructs_input(void)
+{
+    //	quiet noise for a second, then the same noise 40 dB louder; for a while after the jump every
+    //	bin is far above the floor it learned, so the gate is wide open
+    const uint32_t theFrames = (uint32_t)kTest_SampleRate * 2;
+    const uint32_t theJump = (uint32_t)kTest_SampleRate;
+    float* theInput = malloc(sizeof(float) * theFrames * kTest_Channels);
+    float* theOutput = malloc(sizeof(float) * theFrames * kTest_Channels);
+    uint32_t theSeed = 7;
+    for(uint32_t i = 0; i < theFrames * kTest_Channels; i++)
+    {
+        theInput[i] = (i / kTest_Channels < theJump ? 0.005f : 0.5f) * test_noise(&theSeed);
+    }
+
+    uint32_t theLatency = 0;
+    test_run(theInput, theOutput, theFrames, &theLatency);
+    CHECK_EQUAL(theLatency, 512);
+
+    //	with nothing to gate, the output is the input exactly a latency late
+    float theWorst = 0.0f;
+    for(uint32_t i = theJump + 2 * theLatency; i < theJump + (uint32_t)(kTest_SampleRate / 4); i++)
+    {
+        for(uint32_t c = 0; c < kTest_Channels; c++)
+        {
+            float theDifference = fabsf(theOutput[(i + theLatency) * kTest_Channels + c] - theInput[i * kTest_Channels + c]);
+            theWorst = theDifference > theWorst ? theDifference : theWorst;
+        }
+    }
+    CHECK(theWorst < 1.0e-4f);
+
+    free(theInput);
+    free(theOutput);
+}
+
+static void test_gates_noise_between_bursts(void)
+{
+    //	a 1 kHz tone, on for 100 ms and off for 100 ms, in white noise 30 dB below it
+    const uint32_t theFrames = (uint32_t)kTest_SampleRate * kTest_Seconds;
+    const uint32_t theBurst = (uint32_t)(kTest_SampleRate / 10);
+    float* theInput = malloc(sizeof(float) * theFrames * kTest_Channels);
+    float* theClean = malloc(sizeof(float) * theFrames);
+    float* theOutput = malloc(sizeof(float) * theFrames * kTest_Channels);
+    uint32_t theSeed = 1;
+    for(uint32_t i = 0; i < theFrames; i++)
+    {
+        bool isOn = (i / theBurst) % 2 == 1;
+        theClean[i] = isOn ? 0.5f * sinf(2.0f * (float)M_PI * 1000.0f * (float)i / (float)kTest_SampleRate) : 0.0f;
+        for(uint32_t c = 0; c < kTest_Channels; c++)
+        {
+            theInput[i * kTest_Channels + c] = theClean[i] + 0.0158f * 1.732f * test_noise(&theSeed);
+        }
+    }
+
+    uint32_t theLatency = 0;
+    test_run(theInput, theOutput, theFrames, &theLatency);
+
+    //	after the first second, compare the gaps and the middles of the bursts, as they are heard
+    double theNoiseIn = 0.0;
+    double theNoiseOut = 0.0;
+    double theToneCross = 0.0;
+    double theToneEnergy = 0.0;
+    for(uint32_t i = (uint32_t)kTest_SampleRate; i < theFrames - theLatency; i++)
+    {
+        uint32_t thePosition = i % theBurst;
+        if(thePosition < theBurst / 4 || thePosition >= theBurst * 3 / 4)
+        {
+            continue;
+        }
+        for(uint32_t c = 0; c < kTest_Channels; c++)
+        {
+            float theIn = theInput[i * kTest_Channels + c];
+            float theOut = theOutput[(i + theLatency) * kTest_Channels + c];
+            if(theClean[i] == 0.0f && (i / theBurst) % 2 == 0)
+            {
+                theNoiseIn += (double)theIn * theIn;
+                theNoiseOut += (double)theOut * theOut;
+            }
+            else
+            {
+                theToneCross += (double)theOut * theClean[i];
+                theToneEnergy += (double)theClean[i] * theClean[i];
+            }
+        }
+    }
+    double theReduction = 10.0 * log10(theNoiseIn / theNoiseOut);
+    double theToneGain = theToneCross / theToneEnergy;
+    printf("    noise reduced by %.1f dB between bursts, tone kept at %.3f\n", theReduction, theToneGain);
+    CHECK(theReduction > 10.0);
+    CHECK(theToneGain > 0.9 && theToneGain < 1.1);
+
+    free(theInput);
+    free(theClean);
+    free(theOutput);
+}
+
+static void test_reset_and_errors(void)
+{
+    const VocanaProcessorInterface* theInterface = VocanaSpectralGate_GetInterface();
+    CHECK_EQUAL(theInterface->version, kVocanaProcessor_InterfaceVersion);
+
+    VocanaProcessorConfiguration theConfiguration = kTest_Configuration;
+    void* theGate = NULL;
+    theConfiguration.channelCount = 0;
+    CHECK_EQUAL(theInterface->create(&theConfiguration, &theGate), EINVAL);
+
+    //	about 10 ms at the higher rates too
+    theConfiguration = kTest_Configuration;
+    theConfiguration.sampleRate = 96000.0;
+    CHECK_EQUAL(theInterface->create(&theConfiguration, &theGate), 0);
+    CHECK_EQUAL(theInterface->latency(theGate), 1024);
+
+    //	after a reset the gate starts over from silence
+    float theFrames[kTest_MaxFrames * kTest_Channels];
+    for(uint32_t i = 0; i < kTest_MaxFrames * kTest_Channels; i++)
+    {
+        theFrames[i] = 1.0f;
+    }
+    theInterface->process(theGate, theFrames, theFrames, kTest_MaxFrames);
+    theInterface->reset(theGate);
+    theInterface->process(theGate, theFrames, theFrames, kTest_MaxFrames);
+    float theLargest = 0.0f;
+    for(uint32_t i = 0; i < kTest_MaxFrames * kTest_Channels; i++)
+    {
+        theLargest = fabsf(theFrames[i]) > theLargest ? fabsf(theFrames[i]) : theLargest;
+    }
+    CHECK_EQUAL(theLargest, 0.0f);
+    theInterface->destroy(theGate);
+}
+
+int main(void)
+{
+    RUN_TEST(test_open_gate_reconstructs_input);
+    RUN_TEST(test_gates_noise_between_bursts);
+    RUN_TEST(test_reset_and_errors);
+    return TEST_RESULT();
+}
@@ -0,0 +1,77 @@
+#!/bin/bash
+
+# Host-side tests for the portable parts of the HAL driver.
+# These build with any C11 (gnu11) compiler and pthreads, so they run on Linux CI as well as macOS.
+
+set -e
+
+SCRIPT_DIR="$(cd "$(dirname "$0")" && pwd)"
+PROJECT_DIR="$(cd "$SCRIPT_DIR/../.." && pwd)"
+DRIVER_DIR="$PROJECT_DIR/Sources/VocanaAudioDriver"
+BUILD_DIR="$PROJECT_DIR/.build/driver-tests"
+CC="${CC:-cc}"
+CFLAGS="${CFLAGS:--std=gnu11 -O2 -g -Wall -Wextra -Wno-unused-parameter -Wno-unknown-pragmas}"
+
+mkdir -p "$BUILD_DIR"
+
+SIMULATOR_DIR="$SCRIPT_DIR/HALSimulator"
+SIMULATOR_SOURCES="HALSimulator/VocanaHALShim.c HALSimulator/VocanaHALSimulator.c"
+
+# Each test is "<test source>:<driver sources it links against>[:<test-side sources>[:<defines>]]".
+# Tests with test-side sources build against the HAL simulator's platform shims instead of the
+# macOS SDK headers, so they can compile VocanaVirtualDevice.c itself; the defines select its
+# build options.
+TESTS=(
+    "VocanaRingBufferTests.c:VocanaRingBuffer.c"
+    "VocanaRingBufferLifetimeTests.c:VocanaRingBuffer.c VocanaRingBufferLifetime.c"
+    "VocanaMixBusTests.c:VocanaRingBuffer.c VocanaMixBus.c"
+    "VocanaClockTests.c:VocanaClock.c"
+    "VocanaDeviceStateTests.c:VocanaDeviceState.c"
+    "VocanaPropertyTableTests.c:VocanaPropertyTable.c"
+    "VocanaAudioTransportTests.c:VocanaAudioTransport.c"
+    "VocanaPipelineTests.c:VocanaPipeline.c"
+    "VocanaClientScratchTests.c:VocanaClientScratch.c"
+    "VocanaProcessorTests.c:VocanaProcessor.c"
+    "VocanaSpectralGateTests.c:VocanaSpectralGate.c VocanaChannels.c"
+    "VocanaResamplerTests.c:VocanaResampler.c VocanaChannels.c"
+    "VocanaChannelsTests.c:VocanaChannels.c"
+    "VocanaDeviceRegistryTests.c:VocanaDeviceRegistry.c"
+    "VocanaHALSimulatorTests.c:VocanaVirtualDevice.c VocanaRingBuffer.c VocanaRingBufferLifetime.c VocanaMixBus.c VocanaClock.c VocanaDeviceState.c VocanaDeviceRegistry.c VocanaPropertyTable.c:$SIMULATOR_SOURCES"
+    "VocanaHALSimulatorDenoiseTests.c:VocanaVirtualDevice.c VocanaRingBuffer.c VocanaRingBufferLifetime.c VocanaMixBus.c VocanaClock.c VocanaDeviceState.c VocanaDeviceRegistry.c VocanaPropertyTable.c VocanaProcessor.c VocanaSpectralGate.c VocanaChannels.c:$SIMULATOR_SOURCES:-DkDevice_InProcessDenoise=1"
+)
+
+FAILED=0
+for ENTRY in "${TESTS[@]}"; do
+    IFS=':' read -r TEST_SOURCE DRIVER_SOURCES TEST_SIDE_SOURCES TEST_DEFINES <<< "$ENTRY"
+    TEST_NAME="${TEST_SOURCE%.c}"
+
+    SOURCES=("$SCRIPT_DIR/$TEST_SOURCE")
+    for SOURCE in $DRIVER_SOURCES; do
+        SOURCES+=("$DRIVER_DIR/$SOURCE")
+    done
+
+    INCLUDES=(-I "$DRIVER_DIR" -I "$SCRIPT_DIR")
+    DEFINES=()
+    if [ -n "$TEST_SIDE_SOURCES" ]; then
+        for SOURCE in $TEST_SIDE_SOURCES; do
+            SOURCES+=("$SCRIPT_DIR/$SOURCE")
+        done
+        INCLUDES+=(-I "$SIMULATOR_DIR/include" -I "$SIMULATOR_DIR")
+        DEFINES+=(-DDEBUG=0 $TEST_DEFINES)
+    fi
+
+    echo "=== Building $TEST_NAME ==="
+    $CC $CFLAGS "${DEFINES[@]}" "${INCLUDES[@]}" -o "$BUILD_DIR/$TEST_NAME" "${SOURCES[@]}" -lpthread -lm
+
+    echo "=== Running $TEST_NAME ==="
+    if ! "$BUILD_DIR/$TEST_NAME"; then
+        FAILED=1
+    fi
+done
+
+if [ $FAILED -ne 0 ]; then
+    echo "❌ Driver tests failed"
+    exit 1
+fi
+
+echo "✅ All driver tests passed"
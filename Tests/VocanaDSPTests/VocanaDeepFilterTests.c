@@ -0,0 +1,288 @@
+/*
+     File: VocanaDeepFilterTests.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Host-side tests for VocanaDeepFilter: the streaming filter with real and complex coefficients
+ against the FIR written out over a stream's history, causal and with lookahead, the mask on the
+ bins above the filter, Reset, the block filter against DeepFiltering's loop, Init's checks, and
+ what a frame costs.
+
+ */
+
+#include "VocanaDeepFilter.h"
+#include "VocanaDriverTestSupport.h"
+
+#include <errno.h>
+#include <string.h>
+
+#define kTest_Bins              481
+#define kTest_DFBins            96
+#define kTest_Order             5
+#define kTest_Frames            12
+
+static void test_frame(uint32_t inFrame, float* outReal, float* outImaginary)
+{
+    for(uint32_t n = 0; n < kTest_Bins; n++)
+    {
+        outReal[n] = (float)(sin(0.3 * n + 0.7 * inFrame) * (1.0 + 0.1 * inFrame));
+        outImaginary[n] = (float)(cos(0.5 * n - 0.2 * inFrame) * 0.5);
+    }
+}
+
+static void test_mask(uint32_t inFrame, float* outMask)
+{
+    for(uint32_t n = 0; n < kTest_Bins; n++)
+    {
+        outMask[n] = (float)(0.5 + 0.5 * sin(0.05 * n + inFrame));
+    }
+}
+
+//	complex coefficients [bin][tap][2]; the real ones are the real parts
+static void test_coefficients(uint32_t inFrame, float* outCoefficients)
+{
+    for(uint32_t n = 0; n < kTest_DFBins * kTest_Order; n++)
+    {
+        outCoefficients[2 * n] = (float)(0.4 * cos(0.11 * n + 0.3 * inFrame));
+        outCoefficients[2 * n + 1] = (float)(0.2 * sin(0.07 * n - 0.5 * inFrame));
+    }
+}
+
+//	The stream through the filter against the sum written out over every frame kept, for each
+//	coefficient kind and both the causal and centered filters.
+static void check_stream(int inComplex, uint32_t inLookahead)
+{
+    VocanaDeepFilter theFilter;
+    CHECK_EQUAL(VocanaDeepFilter_Init(&theFilter, kTest_Bins, kTest_DFBins, kTest_Order, inLookahead), 0);
+
+    static float theHistoryReal[kTest_Frames][kTest_Bins];
+    static float theHistoryImaginary[kTest_Frames][kTest_Bins];
+    float theReal[kTest_Bins];
+    float theImaginary[kTest_Bins];
+    float theMask[kTest_Bins];
+    float theComplex[2 * kTest_DFBins * kTest_Order];
+    float theCoefficients[kTest_DFBins * kTest_Order];
+    double theWorst = 0.0;
+    for(uint32_t theFrame = 0; theFrame < kTest_Frames; theFrame++)
+    {
+        test_frame(theFrame, theHistoryReal[theFrame], theHistoryImaginary[theFrame]);
+        test_mask(theFrame, theMask);
+        test_coefficients(theFrame, theComplex);
+        for(uint32_t n = 0; n < kTest_DFBins * kTest_Order; n++)
+        {
+            theCoefficients[n] = theComplex[2 * n];
+        }
+        memcpy(theReal, theHistoryReal[theFrame], sizeof(theReal));
+        memcpy(theImaginary, theHistoryImaginary[theFrame], sizeof(theImaginary));
+        if(inComplex)
+        {
+            VocanaDeepFilter_ProcessComplex(&theFilter, theReal, theImaginary, theMask, theComplex);
+        }
+        else
+        {
+            VocanaDeepFilter_Process(&theFilter, theReal, theImaginary, theMask, theCoefficients);
+        }
+
+        for(uint32_t n = 0; n < kTest_DFBins; n++)
+        {
+            double theSumReal = 0.0;
+            double theSumImaginary = 0.0;
+            for(uint32_t theTap = 0; theTap < kTest_Order; theTap++)
+            {
+                int theSource = (int)theFrame - (int)(kTest_Order - 1 - inLookahead) + (int)theTap;
+                if(theSource < 0 || theSource > (int)theFrame)
+                {
+                    continue;
+                }
+                double theXReal = theHistoryReal[theSource][n];
+                double theXImaginary = theHistoryImaginary[theSource][n];
+                double theCReal = theComplex[2 * (n * kTest_Order + theTap)];
+                double theCImaginary = inComplex ? theComplex[2 * (n * kTest_Order + theTap) + 1] : 0.0;
+                theSumReal += theCReal * theXReal - theCImaginary * theXImaginary;
+                theSumImaginary += theCReal * theXImaginary + theCImaginary * theXReal;
+            }
+            theWorst = fmax(theWorst, fabs(theReal[n] - theSumReal));
+            theWorst = fmax(theWorst, fabs(theImaginary[n] - theSumImaginary));
+        }
+        for(uint32_t n = kTest_DFBins; n < kTest_Bins; n++)
+        {
+            theWorst = fmax(theWorst, fabs(theReal[n] - (double)theHistoryReal[theFrame][n] * theMask[n]));
+            theWorst = fmax(theWorst, fabs(theImaginary[n] - (double)theHistoryImaginary[theFrame][n] * theMask[n]));
+        }
+    }
+    CHECK_CLOSE(theWorst, 0.0, 1e-5);
+    VocanaDeepFilter_Teardown(&theFilter);
+}
+
+static void test_stream_matches_reference(void)
+{
+    check_stream(0, 0);
+    check_stream(0, kTest_Order / 2);
+    check_stream(1, 0);
+    check_stream(1, kTest_Order / 2);
+}
+
+static void test_reset(void)
+{
+    VocanaDeepFilter theFilter;
+    CHECK_EQUAL(VocanaDeepFilter_Init(&theFilter, kTest_Bins, kTest_DFBins, kTest_Order, 0), 0);
+    float theReal[kTest_Bins];
+    float theImaginary[kTest_Bins];
+    float theFirstReal[kTest_Bins];
+    float theFirstImaginary[kTest_Bins];
+    float theMask[kTest_Bins];
+    float theComplex[2 * kTest_DFBins * kTest_Order];
+    test_mask(0, theMask);
+    test_coefficients(0, theComplex);
+
+    test_frame(0, theFirstReal, theFirstImaginary);
+    VocanaDeepFilter_ProcessComplex(&theFilter, theFirstReal, theFirstImaginary, theMask, theComplex);
+    for(uint32_t theFrame = 1; theFrame < 4; theFrame++)
+    {
+        test_frame(theFrame, theReal, theImaginary);
+        VocanaDeepFilter_ProcessComplex(&theFilter, theReal, theImaginary, theMask, theComplex);
+    }
+
+    //	after Reset the first frame again comes out as it did from nothing
+    VocanaDeepFilter_Reset(&theFilter);
+    test_frame(0, theReal, theImaginary);
+    VocanaDeepFilter_ProcessComplex(&theFilter, theReal, theImaginary, theMask, theComplex);
+    CHECK(memcmp(theReal, theFirstReal, sizeof(theReal)) == 0);
+    CHECK(memcmp(theImaginary, theFirstImaginary, sizeof(theImaginary)) == 0);
+    VocanaDeepFilter_Teardown(&theFilter);
+}
+
+static void test_block_matches_reference(void)
+{
+    enum { kStride = 484 };
+    static float theReal[kTest_Frames * kStride];
+    static float theImaginary[kTest_Frames * kStride];
+    static double theExpectedReal[kTest_Frames][kTest_DFBins];
+    static double theExpectedImaginary[kTest_Frames][kTest_DFBins];
+    static float theCoefficients[kTest_Frames * kTest_DFBins * kTest_Order];
+    float theComplex[2 * kTest_DFBins * kTest_Order];
+    for(uint32_t theFrame = 0; theFrame < kTest_Frames; theFrame++)
+    {
+        test_frame(theFrame, theReal + theFrame * kStride, theImaginary + theFrame * kStride);
+        test_coefficients(theFrame, theComplex);
+        for(uint32_t n = 0; n < kTest_DFBins * kTest_Order; n++)
+        {
+            theCoefficients[theFrame * kTest_DFBins * kTest_Order + n] = theComplex[2 * n];
+        }
+    }
+
+    //	DeepFiltering's loop: frames in order, in place, taps outside the block left out
+    static double theWorkReal[kTest_Frames][kTest_DFBins];
+    static double theWorkImaginary[kTest_Frames][kTest_DFBins];
+    for(uint32_t theFrame = 0; theFrame < kTest_Frames; theFrame++)
+    {
+        for(uint32_t n = 0; n < kTest_DFBins; n++)
+        {
+            theWorkReal[theFrame][n] = theReal[theFrame * kStride + n];
+            theWorkImaginary[theFrame][n] = theImaginary[theFrame * kStride + n];
+        }
+    }
+    for(int theFrame = 0; theFrame < kTest_Frames; theFrame++)
+    {
+        for(uint32_t n = 0; n < kTest_DFBins; n++)
+        {
+            double theSumReal = 0.0;
+            double theSumImaginary = 0.0;
+            for(int theTap = 0; theTap < kTest_Order; theTap++)
+            {
+                int theSource = theFrame - kTest_Order / 2 + theTap;
+                if(theSource < 0 || theSource >= kTest_Frames)
+                {
+                    continue;
+                }
+                double theC = theCoefficients[(theFrame * kTest_DFBins + n) * kTest_Order + theTap];
+                theSumReal += theC * theWorkReal[theSource][n];
+                theSumImaginary += theC * theWorkImaginary[theSource][n];
+            }
+            theExpectedReal[theFrame][n] = theSumReal;
+            theExpectedImaginary[theFrame][n] = theSumImaginary;
+        }
+        memcpy(theWorkReal[theFrame], theExpectedReal[theFrame], sizeof(theWorkReal[theFrame]));
+        memcpy(theWorkImaginary[theFrame], theExpectedImaginary[theFrame], sizeof(theWorkImaginary[theFrame]));
+    }
+
+    float theAbove = theReal[kStride + kTest_DFBins];
+    VocanaDeepFilter_FilterFrames(theReal, theImaginary, kStride, kTest_Frames, kTest_DFBins, kTest_Order, theCoefficients);
+    double theWorst = 0.0;
+    for(uint32_t theFrame = 0; theFrame < kTest_Frames; theFrame++)
+    {
+        for(uint32_t n = 0; n < kTest_DFBins; n++)
+        {
+            theWorst = fmax(theWorst, fabs(theReal[theFrame * kStride + n] - theExpectedReal[theFrame][n]));
+            theWorst = fmax(theWorst, fabs(theImaginary[theFrame * kStride + n] - theExpectedImaginary[theFrame][n]));
+        }
+    }
+    CHECK_CLOSE(theWorst, 0.0, 1e-4);
+
+    //	bins above the filter are left alone
+    CHECK_EQUAL(theReal[kStride + kTest_DFBins], theAbove);
+}
+
+static void test_init_errors(void)
+{
+    VocanaDeepFilter theFilter;
+    CHECK_EQUAL(VocanaDeepFilter_Init(NULL, kTest_Bins, kTest_DFBins, kTest_Order, 0), EINVAL);
+    CHECK_EQUAL(VocanaDeepFilter_Init(&theFilter, kTest_Bins, 0, kTest_Order, 0), EINVAL);
+    CHECK_EQUAL(VocanaDeepFilter_Init(&theFilter, kTest_Bins, kTest_Bins + 1, kTest_Order, 0), EINVAL);
+    CHECK_EQUAL(VocanaDeepFilter_Init(&theFilter, kTest_Bins, kTest_DFBins, 0, 0), EINVAL);
+    CHECK_EQUAL(VocanaDeepFilter_Init(&theFilter, kTest_Bins, kTest_DFBins, kVocanaDeepFilter_MaxOrder + 1, 0), EINVAL);
+    CHECK_EQUAL(VocanaDeepFilter_Init(&theFilter, kTest_Bins, kTest_DFBins, kTest_Order, kTest_Order), EINVAL);
+    CHECK(theFilter.memory == NULL);
+
+    //	a filter over every bin has no mask to apply
+    CHECK_EQUAL(VocanaDeepFilter_Init(&theFilter, kTest_DFBins, kTest_DFBins, 1, 0), 0);
+    VocanaDeepFilter_Teardown(&theFilter);
+    VocanaDeepFilter_Teardown(NULL);
+}
+
+static void test_cost(void)
+{
+    enum { kIterations = 200000 };
+    VocanaDeepFilter theFilter;
+    CHECK_EQUAL(VocanaDeepFilter_Init(&theFilter, kTest_Bins, kTest_DFBins, kTest_Order, 0), 0);
+    float theFramesReal[4][kTest_Bins];
+    float theFramesImaginary[4][kTest_Bins];
+    float theReal[kTest_Bins];
+    float theImaginary[kTest_Bins];
+    float theMask[kTest_Bins];
+    float theComplex[2 * kTest_DFBins * kTest_Order];
+    for(uint32_t theFrame = 0; theFrame < 4; theFrame++)
+    {
+        test_frame(theFrame, theFramesReal[theFrame], theFramesImaginary[theFrame]);
+    }
+    test_mask(0, theMask);
+    test_coefficients(0, theComplex);
+
+    //	each frame is a fresh analysis, as from the STFT, copied in like the hop's spectrum
+    float theSink = 0.0f;
+    double theStart = test_now_seconds();
+    for(int i = 0; i < kIterations; i++)
+    {
+        memcpy(theReal, theFramesReal[i & 3], sizeof(theReal));
+        memcpy(theImaginary, theFramesImaginary[i & 3], sizeof(theImaginary));
+        VocanaDeepFilter_ProcessComplex(&theFilter, theReal, theImaginary, theMask, theComplex);
+        theSink += theReal[i % kTest_DFBins];
+    }
+    double theNanoseconds = (test_now_seconds() - theStart) * 1.0e9 / kIterations;
+    printf("    %.1f ns per frame, %u bins x %u complex taps (%g)\n", theNanoseconds, kTest_DFBins, kTest_Order, theSink * 0.0f);
+
+    //	about twice the 1.2-1.9 us measured on a shared single-vCPU x86 machine at -O2; the
+    //	sub-microsecond target has not been reached and this bound doesn't claim it
+    CHECK(theNanoseconds < 4000.0);
+    VocanaDeepFilter_Teardown(&theFilter);
+}
+
+int main(void)
+{
+    RUN_TEST(test_stream_matches_reference);
+    RUN_TEST(test_reset);
+    RUN_TEST(test_block_matches_reference);
+    RUN_TEST(test_init_errors);
+    RUN_TEST(test_cost);
+    return TEST_RESULT();
+}
@@ -0,0 +1,261 @@
+/*
+     File: VocanaERBTests.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Host-side tests for VocanaERB: the banded filterbank gives the same bands as the dense matrix
+ it replaces, the fused log power matches the power computed step by step, expanding gains back
+ to bins keeps equal gains equal and fills the bins no band covers, and the cost per frame.
+
+ */
+
+#include "VocanaERB.h"
+#include "VocanaDriverTestSupport.h"
+
+#include <errno.h>
+#include <string.h>
+
+#define kTest_SampleRate        48000
+#define kTest_FrameSize         960
+#define kTest_Bins              (kTest_FrameSize / 2 + 1)
+#define kTest_Bands             32
+
+//	DeepFilterNet's filterbank as ERBFeatures builds it: triangles an ERB wide around centers
+//	spaced evenly on the ERB scale from 50 Hz to 20 kHz, each normalized to sum to 1
+static float gTest_Dense[kTest_Bands][kTest_Bins];
+
+static void make_dense_filterbank(void)
+{
+    double theMinERB = 21.4 * log(1.0 + 0.00437 * 50.0);
+    double theMaxERB = 21.4 * log(1.0 + 0.00437 * 20000.0);
+    double theResolution = (double)kTest_SampleRate / kTest_FrameSize;
+    memset(gTest_Dense, 0, sizeof(gTest_Dense));
+    for(uint32_t b = 0; b < kTest_Bands; b++)
+    {
+        double theERB = theMinERB + b * (theMaxERB - theMinERB) / (kTest_Bands - 1);
+        double theCenter = (exp(theERB / 21.4) - 1.0) / 0.00437;
+        double theWidth = 24.7 * (0.00437 * theCenter + 1.0);
+        double theSum = 0.0;
+        for(uint32_t k = 0; k < kTest_Bins; k++)
+        {
+            double theDistance = fabs(k * theResolution - theCenter);
+            gTest_Dense[b][k] = theDistance < theWidth ? (float)(1.0 - theDistance / theWidth) : 0.0f;
+            theSum += gTest_Dense[b][k];
+        }
+        for(uint32_t k = 0; k < kTest_Bins && theSum > 0.0; k++)
+        {
+            gTest_Dense[b][k] = (float)(gTest_Dense[b][k] / theSum);
+        }
+    }
+}
+
+//	the runs of nonzero weights of the dense rows
+static int make_banded(VocanaERB* outERB)
+{
+    static uint32_t theStarts[kTest_Bands];
+    static uint32_t theLengths[kTest_Bands];
+    static float theWeights[kTest_Bands * kTest_Bins];
+    uint32_t theCount = 0;
+    for(uint32_t b = 0; b < kTest_Bands; b++)
+    {
+        uint32_t theFirst = 0;
+        while(theFirst < kTest_Bins && gTest_Dense[b][theFirst] == 0.0f)
+        {
+            theFirst++;
+        }
+        uint32_t theEnd = kTest_Bins;
+        while(theEnd > theFirst && gTest_Dense[b][theEnd - 1] == 0.0f)
+        {
+            theEnd--;
+        }
+        theStarts[b] = theFirst < kTest_Bins ? theFirst : 0;
+        theLengths[b] = theEnd - theFirst;
+        memcpy(theWeights + theCount, &gTest_Dense[b][theFirst], theLengths[b] * sizeof(float));
+        theCount += theLengths[b];
+    }
+    return VocanaERB_Init(outERB, kTest_Bins, kTest_Bands, theStarts, theLengths, theWeights);
+}
+
+static void test_spectrum(float* outReal, float* outImaginary)
+{
+    for(uint32_t k = 0; k < kTest_Bins; k++)
+    {
+        outReal[k] = (float)(sin(0.37 * k) * exp(-0.004 * k));
+        outImaginary[k] = (float)(cos(0.11 * k + 0.5) * exp(-0.006 * k));
+    }
+}
+
+static void test_matches_dense(void)
+{
+    VocanaERB theERB;
+    CHECK_EQUAL(make_banded(&theERB), 0);
+
+    //	a few hundred weights in place of 32 x 481
+    CHECK(VocanaERB_GetWeightCount(&theERB) < kTest_Bins * 2);
+    CHECK(((uintptr_t)theERB.weights % kVocanaFFT_Alignment) == 0);
+
+    float theReal[kTest_Bins];
+    float theImaginary[kTest_Bins];
+    float theMagnitude[kTest_Bins];
+    test_spectrum(theReal, theImaginary);
+    for(uint32_t k = 0; k < kTest_Bins; k++)
+    {
+        theMagnitude[k] = sqrtf(theReal[k] * theReal[k] + theImaginary[k] * theImaginary[k]);
+    }
+
+    float theBands[kTest_Bands];
+    float theLevels[kTest_Bands];
+    CHECK(VocanaERB_Sum(&theERB, theMagnitude, theBands));
+    CHECK(VocanaERB_LogPower(&theERB, theReal, theImaginary, theLevels));
+    for(uint32_t b = 0; b < kTest_Bands; b++)
+    {
+        double theSum = 0.0;
+        double thePower = 0.0;
+        for(uint32_t k = 0; k < kTest_Bins; k++)
+        {
+            theSum += (double)gTest_Dense[b][k] * theMagnitude[k];
+            thePower += (double)gTest_Dense[b][k] * theMagnitude[k] * theMagnitude[k];
+        }
+        CHECK_CLOSE(theBands[b], theSum, 1e-5);
+        CHECK_CLOSE(theLevels[b], 10.0 * log10(thePower + 1e-10), 1e-3);
+    }
+
+    //	a bad bin shows up in the bands over it
+    theReal[200] = NAN;
+    CHECK(!VocanaERB_LogPower(&theERB, theReal, theImaginary, theLevels));
+    VocanaERB_Teardown(&theERB);
+}
+
+static void test_expand_gains(void)
+{
+    VocanaERB theERB;
+    CHECK_EQUAL(make_banded(&theERB), 0);
+    float theGains[kTest_Bands];
+    float theBinGains[kTest_Bins];
+
+    //	equal gains come back equal in every bin, covered or not
+    for(uint32_t b = 0; b < kTest_Bands; b++)
+    {
+        theGains[b] = 0.625f;
+    }
+    VocanaERB_ExpandGains(&theERB, theGains, theBinGains);
+    for(uint32_t k = 0; k < kTest_Bins; k++)
+    {
+        CHECK_CLOSE(theBinGains[k], 0.625, 1e-6);
+    }
+
+    //	in a covered bin, the weighted average of the bands' gains; elsewhere the nearest band's
+    for(uint32_t b = 0; b < kTest_Bands; b++)
+    {
+        theGains[b] = (float)b / kTest_Bands;
+    }
+    VocanaERB_ExpandGains(&theERB, theGains, theBinGains);
+    for(uint32_t k = 0; k < kTest_Bins; k++)
+    {
+        double theWeighted = 0.0;
+        double theTotal = 0.0;
+        for(uint32_t b = 0; b < kTest_Bands; b++)
+        {
+            theWeighted += (double)gTest_Dense[b][k] * theGains[b];
+            theTotal += gTest_Dense[b][k];
+        }
+        if(theTotal > 0.0)
+        {
+            CHECK_CLOSE(theBinGains[k], theWeighted / theTotal, 1e-5);
+        }
+    }
+
+    //	DC is below the 50 Hz band and the top bins are above the 20 kHz one
+    CHECK_EQUAL(theBinGains[0], theGains[0]);
+    CHECK_EQUAL(theBinGains[kTest_Bins - 1], theGains[kTest_Bands - 1]);
+    VocanaERB_Teardown(&theERB);
+}
+
+static void test_init_errors(void)
+{
+    VocanaERB theERB;
+    uint32_t theStarts[2] = { 0, 4 };
+    uint32_t theLengths[2] = { 3, 4 };
+    float theWeights[7] = { 0.25f, 0.5f, 0.25f, 0.1f, 0.4f, 0.4f, 0.1f };
+    CHECK_EQUAL(VocanaERB_Init(NULL, 8, 2, theStarts, theLengths, theWeights), EINVAL);
+    CHECK_EQUAL(VocanaERB_Init(&theERB, 0, 2, theStarts, theLengths, theWeights), EINVAL);
+    CHECK_EQUAL(VocanaERB_Init(&theERB, 8, 0, theStarts, theLengths, theWeights), EINVAL);
+    CHECK_EQUAL(VocanaERB_Init(&theERB, 8, 2, theStarts, theLengths, NULL), EINVAL);
+
+    //	a band past the last bin
+    CHECK_EQUAL(VocanaERB_Init(&theERB, 7, 2, theStarts, theLengths, theWeights), EINVAL);
+    theWeights[5] = INFINITY;
+    CHECK_EQUAL(VocanaERB_Init(&theERB, 8, 2, theStarts, theLengths, theWeights), EINVAL);
+    theWeights[5] = 0.4f;
+
+    CHECK_EQUAL(VocanaERB_Init(&theERB, 8, 2, theStarts, theLengths, theWeights), 0);
+    CHECK_EQUAL(VocanaERB_GetWeightCount(&theERB), 7);
+    CHECK_EQUAL(theERB.bands[1].offset, 3);
+
+    //	bin 3 is between the bands, a bin from each, and takes the lower one
+    float theGains[2] = { 1.0f, 3.0f };
+    float theBinGains[8];
+    VocanaERB_ExpandGains(&theERB, theGains, theBinGains);
+    CHECK_EQUAL(theBinGains[3], 1.0f);
+    CHECK_CLOSE(theBinGains[5], 3.0, 1e-6);
+    VocanaERB_Teardown(&theERB);
+    VocanaERB_Teardown(NULL);
+}
+
+static void test_cost(void)
+{
+    enum { kIterations = 20000 };
+    VocanaERB theERB;
+    CHECK_EQUAL(make_banded(&theERB), 0);
+    float theReal[kTest_Bins];
+    float theImaginary[kTest_Bins];
+    float thePower[kTest_Bins];
+    float theBands[kTest_Bands];
+    test_spectrum(theReal, theImaginary);
+
+    float theSink = 0.0f;
+    double theStart = test_now_seconds();
+    for(int i = 0; i < kIterations; i++)
+    {
+        theReal[i % kTest_Bins] += 1e-6f;
+        VocanaERB_LogPower(&theERB, theReal, theImaginary, theBands);
+        theSink += theBands[i % kTest_Bands];
+    }
+    double theNanoseconds = (test_now_seconds() - theStart) * 1.0e9 / kIterations;
+
+    //	the dense path: a power spectrum, the 32 x 481 matrix, then the logs
+    theStart = test_now_seconds();
+    for(int i = 0; i < kIterations; i++)
+    {
+        theReal[i % kTest_Bins] += 1e-6f;
+        for(uint32_t k = 0; k < kTest_Bins; k++)
+        {
+            thePower[k] = theReal[k] * theReal[k] + theImaginary[k] * theImaginary[k];
+        }
+        for(uint32_t b = 0; b < kTest_Bands; b++)
+        {
+            float theSum = 0.0f;
+            for(uint32_t k = 0; k < kTest_Bins; k++)
+            {
+                theSum += gTest_Dense[b][k] * thePower[k];
+            }
+            theBands[b] = 10.0f * log10f(theSum + 1e-10f);
+        }
+        theSink += theBands[i % kTest_Bands];
+    }
+    double theDenseNanoseconds = (test_now_seconds() - theStart) * 1.0e9 / kIterations;
+    printf("    %.1f ns per frame banded, %.1f ns dense (%g)\n", theNanoseconds, theDenseNanoseconds, theSink * 0.0f);
+
+    CHECK(theNanoseconds < theDenseNanoseconds);
+    VocanaERB_Teardown(&theERB);
+}
+
+int main(void)
+{
+    make_dense_filterbank();
+    RUN_TEST(test_matches_dense);
+    RUN_TEST(test_expand_gains);
+    RUN_TEST(test_init_errors);
+    RUN_TEST(test_cost);
+    return TEST_RESULT();
+}
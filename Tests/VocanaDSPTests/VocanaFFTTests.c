@@ -0,0 +1,152 @@
+/*
+     File: VocanaFFTTests.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Host-side tests for VocanaFFT: agreement with a direct DFT at the model sizes and others, the
+ inverse undoing the forward transform, the sizes it refuses, and the cost of a 960-point
+ transform.
+
+ */
+
+#include "VocanaFFT.h"
+#include "VocanaDriverTestSupport.h"
+
+#include <errno.h>
+#include <string.h>
+
+static const uint32_t kTest_Sizes[] = { 2, 4, 6, 8, 10, 12, 30, 60, 64, 96, 120, 240, 320, 480, 512, 960, 1024, 1920 };
+
+static void test_signal(uint32_t inSize, float* outSamples)
+{
+    for(uint32_t n = 0; n < inSize; n++)
+    {
+        outSamples[n] = (float)(sin(1.7 * n) + 0.5 * cos(0.3 * n * n));
+    }
+}
+
+static void test_matches_direct_dft(void)
+{
+    for(size_t s = 0; s < sizeof(kTest_Sizes) / sizeof(kTest_Sizes[0]); s++)
+    {
+        uint32_t theSize = kTest_Sizes[s];
+        uint32_t theBins = theSize / 2 + 1;
+        VocanaFFT theFFT;
+        CHECK_EQUAL(VocanaFFT_Init(&theFFT, theSize), 0);
+
+        float* theSamples = malloc(sizeof(float) * theSize);
+        float* theReal = malloc(sizeof(float) * theBins);
+        float* theImaginary = malloc(sizeof(float) * theBins);
+        test_signal(theSize, theSamples);
+        VocanaFFT_Forward(&theFFT, theSamples, theReal, theImaginary);
+
+        //	relative to the largest bin, as float rounding grows with the size
+        double theError = 0.0;
+        double thePeak = 0.0;
+        for(uint32_t k = 0; k < theBins; k++)
+        {
+            double theDirectReal = 0.0;
+            double theDirectImaginary = 0.0;
+            for(uint32_t n = 0; n < theSize; n++)
+            {
+                double theAngle = -2.0 * M_PI * (double)((uint64_t)k * n % theSize) / theSize;
+                theDirectReal += theSamples[n] * cos(theAngle);
+                theDirectImaginary += theSamples[n] * sin(theAngle);
+            }
+            theError = fmax(theError, hypot(theReal[k] - theDirectReal, theImaginary[k] - theDirectImaginary));
+            thePeak = fmax(thePeak, hypot(theDirectReal, theDirectImaginary));
+        }
+        if(theError > 1.0e-5 * thePeak)
+        {
+            fprintf(stderr, "    size %u: error %g of a peak of %g\n", theSize, theError, thePeak);
+        }
+        CHECK(theError <= 1.0e-5 * thePeak);
+        CHECK_EQUAL(theImaginary[0], 0);
+        CHECK_EQUAL(theImaginary[theBins - 1], 0);
+
+        free(theSamples);
+        free(theReal);
+        free(theImaginary);
+        VocanaFFT_Teardown(&theFFT);
+    }
+}
+
+static void test_inverse_round_trip(void)
+{
+    for(size_t s = 0; s < sizeof(kTest_Sizes) / sizeof(kTest_Sizes[0]); s++)
+    {
+        uint32_t theSize = kTest_Sizes[s];
+        VocanaFFT theFFT;
+        CHECK_EQUAL(VocanaFFT_Init(&theFFT, theSize), 0);
+
+        float* theSamples = malloc(sizeof(float) * theSize);
+        float* theReal = malloc(sizeof(float) * (theSize / 2 + 1));
+        float* theImaginary = malloc(sizeof(float) * (theSize / 2 + 1));
+        float* theResult = malloc(sizeof(float) * theSize);
+        test_signal(theSize, theSamples);
+        VocanaFFT_Forward(&theFFT, theSamples, theReal, theImaginary);
+        VocanaFFT_Inverse(&theFFT, theReal, theImaginary, theResult);
+
+        double theError = 0.0;
+        for(uint32_t n = 0; n < theSize; n++)
+        {
+            theError = fmax(theError, fabs(theResult[n] - theSamples[n]));
+        }
+        CHECK(theError < 1.0e-5);
+
+        free(theSamples);
+        free(theReal);
+        free(theImaginary);
+        free(theResult);
+        VocanaFFT_Teardown(&theFFT);
+    }
+}
+
+static void test_invalid_sizes(void)
+{
+    static const uint32_t kInvalid[] = { 0, 1, 7, 14, 962, 966, 1000 * 7, kVocanaFFT_MaxSize * 2 };
+    for(size_t s = 0; s < sizeof(kInvalid) / sizeof(kInvalid[0]); s++)
+    {
+        VocanaFFT theFFT;
+        CHECK(!VocanaFFT_IsValidSize(kInvalid[s]));
+        CHECK_EQUAL(VocanaFFT_Init(&theFFT, kInvalid[s]), EINVAL);
+        CHECK(theFFT.memory == NULL);
+        VocanaFFT_Teardown(&theFFT);
+    }
+    CHECK_EQUAL(VocanaFFT_Init(NULL, 960), EINVAL);
+    CHECK(VocanaFFT_IsValidSize(960));
+    CHECK(VocanaFFT_IsValidSize(kVocanaFFT_MaxSize));
+}
+
+static void test_cost(void)
+{
+    enum { kSize = 960, kIterations = 20000 };
+    VocanaFFT theFFT;
+    CHECK_EQUAL(VocanaFFT_Init(&theFFT, kSize), 0);
+    float theSamples[kSize];
+    float theReal[kSize / 2 + 1];
+    float theImaginary[kSize / 2 + 1];
+    test_signal(kSize, theSamples);
+
+    double theStart = test_now_seconds();
+    for(int i = 0; i < kIterations; i++)
+    {
+        VocanaFFT_Forward(&theFFT, theSamples, theReal, theImaginary);
+        VocanaFFT_Inverse(&theFFT, theReal, theImaginary, theSamples);
+    }
+    double theNanoseconds = (test_now_seconds() - theStart) * 1.0e9 / kIterations;
+    printf("    %.1f ns per 960-point forward and inverse transform\n", theNanoseconds);
+
+    //	a 10 ms hop has to leave nearly all of its time to the model
+    CHECK(theNanoseconds < 100000.0);
+    VocanaFFT_Teardown(&theFFT);
+}
+
+int main(void)
+{
+    RUN_TEST(test_matches_direct_dft);
+    RUN_TEST(test_inverse_round_trip);
+    RUN_TEST(test_invalid_sizes);
+    RUN_TEST(test_cost);
+    return TEST_RESULT();
+}
@@ -0,0 +1,374 @@
+/*
+     File: VocanaLayersTests.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Host-side tests for VocanaLayers: the polynomial activations against libm, dense and convolution
+ layers of sizes that don't fill their last panel against the plain sums, the fused GRU against
+ PyTorch's equations over several steps, two GRUs keeping their state apart in one arena, the
+ arena's slots, Init's checks, and what a GRU step and the deep filtering output layer cost.
+
+ */
+
+#include "VocanaLayers.h"
+#include "VocanaDriverTestSupport.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+static float test_weight(uint32_t inIndex, uint32_t inSeed)
+{
+    //	deterministic values in [-0.5, 0.5)
+    uint32_t theHash = (inIndex + 1) * 2654435761u ^ inSeed * 40503u;
+    theHash ^= theHash >> 13;
+    theHash *= 2246822519u;
+    theHash ^= theHash >> 16;
+    return (float)(theHash % 10000) / 10000.0f - 0.5f;
+}
+
+static void test_fill(float* outValues, uint32_t inCount, uint32_t inSeed)
+{
+    for(uint32_t n = 0; n < inCount; n++)
+    {
+        outValues[n] = test_weight(n, inSeed);
+    }
+}
+
+static double test_sigmoid(double inX)
+{
+    return 1.0 / (1.0 + exp(-inX));
+}
+
+static double test_activate(double inX, VocanaActivation inActivation)
+{
+    switch(inActivation)
+    {
+        case kVocanaActivation_ReLU:
+            return inX > 0.0 ? inX : 0.0;
+        case kVocanaActivation_Sigmoid:
+            return test_sigmoid(inX);
+        case kVocanaActivation_Tanh:
+            return tanh(inX);
+        default:
+            return inX;
+    }
+}
+
+static void test_activations(void)
+{
+    enum { kCount = 4001 };
+    static float theTanh[kCount];
+    static float theSigmoid[kCount];
+    for(uint32_t n = 0; n < kCount; n++)
+    {
+        //	-20 to 20, well past where both saturate
+        theTanh[n] = theSigmoid[n] = -20.0f + 40.0f * (float)n / (kCount - 1);
+    }
+    VocanaActivation_Apply(kVocanaActivation_Tanh, theTanh, kCount);
+    VocanaActivation_Apply(kVocanaActivation_Sigmoid, theSigmoid, kCount);
+
+    double theWorstTanh = 0.0;
+    double theWorstSigmoid = 0.0;
+    for(uint32_t n = 0; n < kCount; n++)
+    {
+        double theX = -20.0 + 40.0 * (float)n / (kCount - 1);
+        theWorstTanh = fmax(theWorstTanh, fabs(theTanh[n] - tanh(theX)));
+        theWorstSigmoid = fmax(theWorstSigmoid, fabs(theSigmoid[n] - test_sigmoid(theX)));
+    }
+    CHECK_CLOSE(theWorstTanh, 0.0, 1e-6);
+    CHECK_CLOSE(theWorstSigmoid, 0.0, 1e-6);
+
+    float theReLU[3] = { -1.0f, 0.0f, 2.5f };
+    VocanaActivation_Apply(kVocanaActivation_ReLU, theReLU, 3);
+    CHECK_EQUAL(theReLU[0], 0.0f);
+    CHECK_EQUAL(theReLU[2], 2.5f);
+}
+
+static void test_dense_matches_reference(void)
+{
+    enum { kInputs = 37, kOutputs = 19 };
+    float theWeights[kOutputs * kInputs];
+    float theBias[kOutputs];
+    float theInput[kInputs];
+    float theOutput[kOutputs];
+    test_fill(theWeights, kOutputs * kInputs, 1);
+    test_fill(theBias, kOutputs, 2);
+    test_fill(theInput, kInputs, 3);
+
+    VocanaDense theDense;
+    CHECK_EQUAL(VocanaDense_Init(&theDense, kInputs, kOutputs, theWeights, theBias), 0);
+    CHECK_EQUAL(theDense.panelCount, 3u);
+
+    VocanaActivation theActivations[4] = { kVocanaActivation_None, kVocanaActivation_ReLU, kVocanaActivation_Sigmoid, kVocanaActivation_Tanh };
+    for(int a = 0; a < 4; a++)
+    {
+        VocanaDense_Forward(&theDense, theInput, theOutput, theActivations[a]);
+        double theWorst = 0.0;
+        for(uint32_t o = 0; o < kOutputs; o++)
+        {
+            double theSum = theBias[o];
+            for(uint32_t i = 0; i < kInputs; i++)
+            {
+                theSum += (double)theWeights[o * kInputs + i] * theInput[i];
+            }
+            theWorst = fmax(theWorst, fabs(theOutput[o] - test_activate(theSum, theActivations[a])));
+        }
+        CHECK_CLOSE(theWorst, 0.0, 1e-5);
+    }
+    VocanaDense_Teardown(&theDense);
+
+    //	no bias is a zero bias
+    CHECK_EQUAL(VocanaDense_Init(&theDense, kInputs, kOutputs, theWeights, NULL), 0);
+    memset(theInput, 0, sizeof(theInput));
+    VocanaDense_Forward(&theDense, theInput, theOutput, kVocanaActivation_None);
+    CHECK_EQUAL(theOutput[kOutputs - 1], 0.0f);
+    VocanaDense_Teardown(&theDense);
+}
+
+static void test_conv_matches_reference(void)
+{
+    enum { kInChannels = 3, kOutChannels = 5, kKernel = 3, kStride = 2, kLength = 11 };
+    float theWeights[kOutChannels * kInChannels * kKernel];
+    float theBias[kOutChannels];
+    float theInput[kInChannels * kLength];
+    test_fill(theWeights, kOutChannels * kInChannels * kKernel, 4);
+    test_fill(theBias, kOutChannels, 5);
+    test_fill(theInput, kInChannels * kLength, 6);
+
+    VocanaConv1D theConv;
+    CHECK_EQUAL(VocanaConv1D_Init(&theConv, kInChannels, kOutChannels, kKernel, kStride, theWeights, theBias), 0);
+    uint32_t theLength = VocanaConv1D_GetOutputLength(&theConv, kLength);
+    CHECK_EQUAL(theLength, 5u);
+    CHECK_EQUAL(VocanaConv1D_GetOutputLength(&theConv, kKernel - 1), 0u);
+
+    float theOutput[kOutChannels * 5];
+    VocanaConv1D_Forward(&theConv, theInput, kLength, theOutput, kVocanaActivation_ReLU);
+    double theWorst = 0.0;
+    int thePositive = 0;
+    for(uint32_t o = 0; o < kOutChannels; o++)
+    {
+        for(uint32_t t = 0; t < theLength; t++)
+        {
+            double theSum = theBias[o];
+            for(uint32_t c = 0; c < kInChannels; c++)
+            {
+                for(uint32_t k = 0; k < kKernel; k++)
+                {
+                    theSum += (double)theWeights[(o * kInChannels + c) * kKernel + k] * theInput[c * kLength + t * kStride + k];
+                }
+            }
+            theWorst = fmax(theWorst, fabs(theOutput[o * theLength + t] - (theSum > 0.0 ? theSum : 0.0)));
+            thePositive += theSum > 0.0;
+        }
+    }
+    CHECK_CLOSE(theWorst, 0.0, 1e-5);
+
+    //	the ReLU had something on both sides of it
+    CHECK(thePositive > 0 && thePositive < kOutChannels * 5);
+    VocanaConv1D_Teardown(&theConv);
+}
+
+//	PyTorch's GRU step in double
+static void test_gru_step(const float* inWeights, const float* inInputBias, const float* inHiddenBias, uint32_t inInputs, uint32_t inHidden, const float* inInput, double* ioHidden)
+{
+    double theInputSums[3 * 64];
+    double theHiddenSums[3 * 64];
+    uint32_t theColumns = inInputs + inHidden;
+    for(uint32_t r = 0; r < 3 * inHidden; r++)
+    {
+        theInputSums[r] = inInputBias[r];
+        theHiddenSums[r] = inHiddenBias[r];
+        for(uint32_t i = 0; i < inInputs; i++)
+        {
+            theInputSums[r] += (double)inWeights[r * theColumns + i] * inInput[i];
+        }
+        for(uint32_t h = 0; h < inHidden; h++)
+        {
+            theHiddenSums[r] += (double)inWeights[r * theColumns + inInputs + h] * ioHidden[h];
+        }
+    }
+    for(uint32_t h = 0; h < inHidden; h++)
+    {
+        double theReset = test_sigmoid(theInputSums[h] + theHiddenSums[h]);
+        double theUpdate = test_sigmoid(theInputSums[inHidden + h] + theHiddenSums[inHidden + h]);
+        double theNew = tanh(theInputSums[2 * inHidden + h] + theReset * theHiddenSums[2 * inHidden + h]);
+        ioHidden[h] = (1.0 - theUpdate) * theNew + theUpdate * ioHidden[h];
+    }
+}
+
+static void test_gru_matches_reference(void)
+{
+    enum { kInputs = 7, kHidden = 10, kSteps = 6, kColumns = kInputs + kHidden };
+    float theWeights[3 * kHidden * kColumns];
+    float theInputBias[3 * kHidden];
+    float theHiddenBias[3 * kHidden];
+    float theInput[kSteps * kInputs];
+    test_fill(theWeights, 3 * kHidden * kColumns, 7);
+    test_fill(theInputBias, 3 * kHidden, 8);
+    test_fill(theHiddenBias, 3 * kHidden, 9);
+    test_fill(theInput, kSteps * kInputs, 10);
+    for(uint32_t n = 0; n < 3 * kHidden * kColumns; n++)
+    {
+        theWeights[n] *= 2.0f;
+    }
+
+    VocanaArena theArena;
+    CHECK_EQUAL(VocanaArena_Init(&theArena, 1024), 0);
+    VocanaGRU theGRU;
+    CHECK_EQUAL(VocanaGRU_Init(&theGRU, kInputs, kHidden, theWeights, theInputBias, theHiddenBias), 0);
+    float* theHidden = VocanaArena_Reserve(&theArena, kHidden);
+    CHECK(theHidden != NULL);
+
+    //	the first three steps in one call, the rest a step at a time, as a stream would
+    float theOutput[kSteps * kHidden];
+    VocanaGRU_Forward(&theGRU, theInput, 3, theHidden, theOutput);
+    for(uint32_t theStep = 3; theStep < kSteps; theStep++)
+    {
+        VocanaGRU_Forward(&theGRU, theInput + theStep * kInputs, 1, theHidden, theOutput + theStep * kHidden);
+    }
+
+    double theReference[kHidden] = { 0.0 };
+    double theWorst = 0.0;
+    for(uint32_t theStep = 0; theStep < kSteps; theStep++)
+    {
+        test_gru_step(theWeights, theInputBias, theHiddenBias, kInputs, kHidden, theInput + theStep * kInputs, theReference);
+        for(uint32_t h = 0; h < kHidden; h++)
+        {
+            theWorst = fmax(theWorst, fabs(theOutput[theStep * kHidden + h] - theReference[h]));
+        }
+    }
+    CHECK_CLOSE(theWorst, 0.0, 1e-5);
+    CHECK(memcmp(theHidden, theOutput + (kSteps - 1) * kHidden, kHidden * sizeof(float)) == 0);
+
+    //	a second GRU on the same weights in the next slot starts from zero, and Clear starts both over
+    float* theOtherHidden = VocanaArena_Reserve(&theArena, kHidden);
+    float theFirstStep[kHidden];
+    VocanaGRU_Forward(&theGRU, theInput, 1, theOtherHidden, theFirstStep);
+    CHECK(memcmp(theFirstStep, theOutput, sizeof(theFirstStep)) == 0);
+    CHECK(memcmp(theHidden, theOutput + (kSteps - 1) * kHidden, kHidden * sizeof(float)) == 0);
+    VocanaArena_Clear(&theArena);
+    CHECK_EQUAL(theHidden[0], 0.0f);
+    CHECK_EQUAL(theOtherHidden[kHidden - 1], 0.0f);
+
+    VocanaGRU_Teardown(&theGRU);
+    VocanaArena_Teardown(&theArena);
+}
+
+static void test_arena(void)
+{
+    VocanaArena theArena;
+    CHECK_EQUAL(VocanaArena_Init(&theArena, 60), 0);
+    float* theFirst = VocanaArena_Reserve(&theArena, 3);
+    float* theSecond = VocanaArena_Reserve(&theArena, 17);
+    CHECK(theFirst != NULL && theSecond != NULL);
+    CHECK_EQUAL((uintptr_t)theSecond % 64, 0u);
+    CHECK_EQUAL(theSecond - theFirst, 16);
+
+    //	60 floats round up to 64, and the slots to whole 16s: the 48 reserved leave room for 16 more
+    CHECK(VocanaArena_Reserve(&theArena, 17) == NULL);
+    CHECK(VocanaArena_Reserve(&theArena, 16) != NULL);
+    CHECK(VocanaArena_Reserve(&theArena, 1) == NULL);
+    CHECK(VocanaArena_Reserve(&theArena, 0) == NULL);
+    VocanaArena_Teardown(&theArena);
+    VocanaArena_Teardown(NULL);
+}
+
+static void test_init_errors(void)
+{
+    float theWeights[16] = { 0.0f };
+    VocanaDense theDense;
+    VocanaConv1D theConv;
+    VocanaGRU theGRU;
+    VocanaArena theArena;
+    CHECK_EQUAL(VocanaDense_Init(NULL, 4, 4, theWeights, NULL), EINVAL);
+    CHECK_EQUAL(VocanaDense_Init(&theDense, 0, 4, theWeights, NULL), EINVAL);
+    CHECK_EQUAL(VocanaDense_Init(&theDense, 4, 4, NULL, NULL), EINVAL);
+    CHECK_EQUAL(VocanaConv1D_Init(&theConv, 2, 2, 3, 0, theWeights, NULL), EINVAL);
+    CHECK_EQUAL(VocanaConv1D_Init(&theConv, 2, 0, 3, 1, theWeights, NULL), EINVAL);
+    CHECK(theConv.memory == NULL);
+    CHECK_EQUAL(VocanaGRU_Init(&theGRU, 1, 0, theWeights, NULL, NULL), EINVAL);
+    CHECK_EQUAL(VocanaGRU_Init(&theGRU, 1, kVocanaLayers_MaxSize, theWeights, NULL, NULL), EINVAL);
+    CHECK_EQUAL(VocanaArena_Init(&theArena, 0), EINVAL);
+    VocanaDense_Teardown(NULL);
+    VocanaConv1D_Teardown(NULL);
+    VocanaGRU_Teardown(NULL);
+}
+
+static void test_cost(void)
+{
+    enum { kIterations = 2000, kSize = 256, kDFInputs = 96, kDFOutputs = 96 * 5 };
+    static float theWeights[3 * kSize * 2 * kSize];
+    static float theRowMajorOutput[3 * kSize];
+    float theInput[kSize];
+    test_fill(theWeights, 3 * kSize * 2 * kSize, 11);
+    test_fill(theInput, kSize, 12);
+    for(uint32_t n = 0; n < 3 * kSize * 2 * kSize; n++)
+    {
+        theWeights[n] *= 0.1f;
+    }
+
+    VocanaArena theArena;
+    VocanaGRU theGRU;
+    VocanaDense theDense;
+    CHECK_EQUAL(VocanaArena_Init(&theArena, kSize + kDFOutputs), 0);
+    CHECK_EQUAL(VocanaGRU_Init(&theGRU, kSize, kSize, theWeights, NULL, NULL), 0);
+    CHECK_EQUAL(VocanaDense_Init(&theDense, kDFInputs, kDFOutputs, theWeights, NULL), 0);
+    float* theHidden = VocanaArena_Reserve(&theArena, kSize);
+    float* theCoefficients = VocanaArena_Reserve(&theArena, kDFOutputs);
+
+    float theSink = 0.0f;
+    double theStart = test_now_seconds();
+    for(int i = 0; i < kIterations; i++)
+    {
+        VocanaGRU_Forward(&theGRU, theInput, 1, theHidden, NULL);
+        theSink += theHidden[i % kSize];
+    }
+    double theGRUNanoseconds = (test_now_seconds() - theStart) * 1.0e9 / kIterations;
+
+    theStart = test_now_seconds();
+    for(int i = 0; i < kIterations; i++)
+    {
+        theInput[i % kDFInputs] += 1e-6f;
+        VocanaDense_Forward(&theDense, theInput, theCoefficients, kVocanaActivation_Tanh);
+        theSink += theCoefficients[i % kDFOutputs];
+    }
+    double theDenseNanoseconds = (test_now_seconds() - theStart) * 1.0e9 / kIterations;
+
+    //	the gates' product the plain way, a row-major dot product per row, for comparison
+    theStart = test_now_seconds();
+    for(int i = 0; i < kIterations; i++)
+    {
+        for(uint32_t r = 0; r < 3 * kSize; r++)
+        {
+            const float* theRow = theWeights + r * 2 * kSize;
+            float theSum = 0.0f;
+            for(uint32_t c = 0; c < kSize; c++)
+            {
+                theSum += theRow[c] * theInput[c] + theRow[kSize + c] * theHidden[c];
+            }
+            theRowMajorOutput[r] = theSum;
+        }
+        theSink += theRowMajorOutput[i % (3 * kSize)];
+    }
+    double theRowMajorNanoseconds = (test_now_seconds() - theStart) * 1.0e9 / kIterations;
+    printf("    %.0f ns per GRU step (256 -> 256, row-major gates alone %.0f ns), %.0f ns per 96 -> 480 dense (%g)\n",
+           theGRUNanoseconds, theRowMajorNanoseconds, theDenseNanoseconds, theSink * 0.0f);
+
+    CHECK(theGRUNanoseconds < theRowMajorNanoseconds);
+    VocanaDense_Teardown(&theDense);
+    VocanaGRU_Teardown(&theGRU);
+    VocanaArena_Teardown(&theArena);
+}
+
+int main(void)
+{
+    RUN_TEST(test_activations);
+    RUN_TEST(test_dense_matches_reference);
+    RUN_TEST(test_conv_matches_reference);
+    RUN_TEST(test_gru_matches_reference);
+    RUN_TEST(test_arena);
+    RUN_TEST(test_init_errors);
+    RUN_TEST(test_cost);
+    return TEST_RESULT();
+}
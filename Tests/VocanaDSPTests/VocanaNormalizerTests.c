@@ -0,0 +1,215 @@
+/*
+     File: VocanaNormalizerTests.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Host-side tests for VocanaNormalizer: the initial ramps, both normalizations against the
+ formulas frame by frame, a stream moved to a fresh normalizer through its state carrying on
+ exactly as if it had never moved, the unit floor in silence, and SetState rejecting bad state.
+
+ */
+
+#include "VocanaNormalizer.h"
+#include "VocanaDriverTestSupport.h"
+
+#include <errno.h>
+#include <string.h>
+
+#define kTest_Bands             32
+#define kTest_Bins              96
+#define kTest_Alpha             0.99f
+
+static void test_frame(uint32_t inFrame, uint32_t inCount, float* outReal, float* outImaginary)
+{
+    for(uint32_t n = 0; n < inCount; n++)
+    {
+        outReal[n] = (float)(sin(0.3 * n + 0.7 * inFrame) * (1.0 + 0.1 * inFrame));
+        outImaginary[n] = (float)(cos(0.5 * n - 0.2 * inFrame) * 0.5);
+    }
+}
+
+static void test_initial_state(void)
+{
+    VocanaNormalizer theMean;
+    CHECK_EQUAL(VocanaNormalizer_Init(&theMean, kVocanaNormalizer_Mean, kTest_Bands, kTest_Alpha, -60.0f, -90.0f), 0);
+    CHECK_CLOSE(theMean.state[0], -60.0, 1e-6);
+    CHECK_CLOSE(theMean.state[kTest_Bands - 1], -90.0, 1e-4);
+    CHECK_CLOSE(theMean.state[1] - theMean.state[0], -30.0 / (kTest_Bands - 1), 1e-4);
+
+    //	Reset goes back to the ramp
+    float theLevels[kTest_Bands];
+    for(uint32_t n = 0; n < kTest_Bands; n++)
+    {
+        theLevels[n] = -20.0f;
+    }
+    VocanaNormalizer_NormalizeMean(&theMean, theLevels, theLevels);
+    CHECK(theMean.state[0] > -60.0f);
+    VocanaNormalizer_Reset(&theMean);
+    CHECK_EQUAL(theMean.state[0], -60.0f);
+    VocanaNormalizer_Teardown(&theMean);
+}
+
+static void test_matches_formulas(void)
+{
+    VocanaNormalizer theMean;
+    VocanaNormalizer theUnit;
+    CHECK_EQUAL(VocanaNormalizer_Init(&theMean, kVocanaNormalizer_Mean, kTest_Bands, kTest_Alpha, -60.0f, -90.0f), 0);
+    CHECK_EQUAL(VocanaNormalizer_Init(&theUnit, kVocanaNormalizer_Unit, kTest_Bins, kTest_Alpha, 0.001f, 0.0001f), 0);
+
+    double theMeanState[kTest_Bands];
+    double theUnitState[kTest_Bins];
+    for(uint32_t n = 0; n < kTest_Bands; n++)
+    {
+        theMeanState[n] = theMean.state[n];
+    }
+    for(uint32_t n = 0; n < kTest_Bins; n++)
+    {
+        theUnitState[n] = theUnit.state[n];
+    }
+
+    float theReal[kTest_Bins];
+    float theImaginary[kTest_Bins];
+    float theLevels[kTest_Bands];
+    float theFeatures[kTest_Bands];
+    float theOutReal[kTest_Bins];
+    float theOutImaginary[kTest_Bins];
+    for(uint32_t theFrame = 0; theFrame < 50; theFrame++)
+    {
+        test_frame(theFrame, kTest_Bins, theReal, theImaginary);
+        for(uint32_t n = 0; n < kTest_Bands; n++)
+        {
+            theLevels[n] = 20.0f * theReal[n] - 50.0f;
+        }
+        VocanaNormalizer_NormalizeMean(&theMean, theLevels, theFeatures);
+        VocanaNormalizer_NormalizeUnit(&theUnit, theReal, theImaginary, theOutReal, theOutImaginary);
+
+        for(uint32_t n = 0; n < kTest_Bands; n++)
+        {
+            theMeanState[n] = theLevels[n] * (1.0 - kTest_Alpha) + theMeanState[n] * kTest_Alpha;
+            CHECK_CLOSE(theFeatures[n], (theLevels[n] - theMeanState[n]) / 40.0, 1e-4);
+        }
+        for(uint32_t n = 0; n < kTest_Bins; n++)
+        {
+            double theMagnitude = sqrt((double)theReal[n] * theReal[n] + (double)theImaginary[n] * theImaginary[n]);
+            theUnitState[n] = theMagnitude * (1.0 - kTest_Alpha) + theUnitState[n] * kTest_Alpha;
+            double theScale = 1.0 / sqrt(theUnitState[n]);
+            CHECK_CLOSE(theOutReal[n], theReal[n] * theScale, 1e-3 * fabs(theReal[n] * theScale) + 1e-5);
+            CHECK_CLOSE(theOutImaginary[n], theImaginary[n] * theScale, 1e-3 * fabs(theImaginary[n] * theScale) + 1e-5);
+        }
+    }
+    VocanaNormalizer_Teardown(&theUnit);
+    VocanaNormalizer_Teardown(&theMean);
+}
+
+static void test_moved_stream_carries_on(void)
+{
+    VocanaNormalizer theStaying;
+    VocanaNormalizer theLeaving;
+    VocanaNormalizer theArriving;
+    CHECK_EQUAL(VocanaNormalizer_Init(&theStaying, kVocanaNormalizer_Unit, kTest_Bins, kTest_Alpha, 0.001f, 0.0001f), 0);
+    CHECK_EQUAL(VocanaNormalizer_Init(&theLeaving, kVocanaNormalizer_Unit, kTest_Bins, kTest_Alpha, 0.001f, 0.0001f), 0);
+    CHECK_EQUAL(VocanaNormalizer_Init(&theArriving, kVocanaNormalizer_Unit, kTest_Bins, kTest_Alpha, 0.001f, 0.0001f), 0);
+
+    float theReal[kTest_Bins];
+    float theImaginary[kTest_Bins];
+    float theStayingReal[kTest_Bins];
+    float theStayingImaginary[kTest_Bins];
+    float theMovedReal[kTest_Bins];
+    float theMovedImaginary[kTest_Bins];
+    float theState[kTest_Bins];
+    int theSame = 1;
+    int theDiffersFromFresh = 0;
+    for(uint32_t theFrame = 0; theFrame < 40; theFrame++)
+    {
+        test_frame(theFrame, kTest_Bins, theReal, theImaginary);
+        VocanaNormalizer_NormalizeUnit(&theStaying, theReal, theImaginary, theStayingReal, theStayingImaginary);
+
+        //	halfway through, the stream moves to a normalizer that has never seen it
+        if(theFrame == 20)
+        {
+            VocanaNormalizer_GetState(&theLeaving, theState);
+            CHECK_EQUAL(VocanaNormalizer_SetState(&theArriving, theState, kTest_Bins), 0);
+        }
+        VocanaNormalizer* theCurrent = theFrame < 20 ? &theLeaving : &theArriving;
+        VocanaNormalizer_NormalizeUnit(theCurrent, theReal, theImaginary, theMovedReal, theMovedImaginary);
+        theSame = theSame && memcmp(theStayingReal, theMovedReal, sizeof(theMovedReal)) == 0;
+        theSame = theSame && memcmp(theStayingImaginary, theMovedImaginary, sizeof(theMovedImaginary)) == 0;
+    }
+    CHECK(theSame);
+
+    //	where starting over would have given something else
+    VocanaNormalizer_Reset(&theArriving);
+    VocanaNormalizer_NormalizeUnit(&theArriving, theReal, theImaginary, theMovedReal, theMovedImaginary);
+    theDiffersFromFresh = memcmp(theStayingReal, theMovedReal, sizeof(theMovedReal)) != 0;
+    CHECK(theDiffersFromFresh);
+
+    VocanaNormalizer_Teardown(&theArriving);
+    VocanaNormalizer_Teardown(&theLeaving);
+    VocanaNormalizer_Teardown(&theStaying);
+}
+
+static void test_unit_floor(void)
+{
+    VocanaNormalizer theUnit;
+    CHECK_EQUAL(VocanaNormalizer_Init(&theUnit, kVocanaNormalizer_Unit, kTest_Bins, 0.5f, 0.001f, 0.0001f), 0);
+    float theZeros[kTest_Bins];
+    float theReal[kTest_Bins];
+    float theImaginary[kTest_Bins];
+    memset(theZeros, 0, sizeof(theZeros));
+
+    //	long enough for the state to halve itself well below the smallest normal float
+    for(int i = 0; i < 1000; i++)
+    {
+        VocanaNormalizer_NormalizeUnit(&theUnit, theZeros, theZeros, theReal, theImaginary);
+    }
+    for(uint32_t n = 0; n < kTest_Bins; n++)
+    {
+        CHECK_EQUAL(theUnit.state[n], 1e-12f);
+        CHECK(isfinite(theReal[n]) && isfinite(theImaginary[n]));
+    }
+
+    //	in place, a sound after the silence comes out finite and scaled up
+    theReal[0] = 1e-3f;
+    theImaginary[0] = 0.0f;
+    VocanaNormalizer_NormalizeUnit(&theUnit, theReal, theImaginary, theReal, theImaginary);
+    CHECK(isfinite(theReal[0]) && theReal[0] > 1e-3f);
+    VocanaNormalizer_Teardown(&theUnit);
+}
+
+static void test_errors(void)
+{
+    VocanaNormalizer theNormalizer;
+    CHECK_EQUAL(VocanaNormalizer_Init(NULL, kVocanaNormalizer_Mean, 4, 0.9f, 0.0f, 0.0f), EINVAL);
+    CHECK_EQUAL(VocanaNormalizer_Init(&theNormalizer, kVocanaNormalizer_Mean, 0, 0.9f, 0.0f, 0.0f), EINVAL);
+    CHECK_EQUAL(VocanaNormalizer_Init(&theNormalizer, kVocanaNormalizer_Mean, 4, 1.0f, 0.0f, 0.0f), EINVAL);
+    CHECK_EQUAL(VocanaNormalizer_Init(&theNormalizer, kVocanaNormalizer_Mean, 4, NAN, 0.0f, 0.0f), EINVAL);
+    CHECK_EQUAL(VocanaNormalizer_Init(&theNormalizer, kVocanaNormalizer_Unit, 4, 0.9f, 0.0f, 1.0f), EINVAL);
+    CHECK_EQUAL(VocanaNormalizer_Init(&theNormalizer, (VocanaNormalizerKind)7, 4, 0.9f, 1.0f, 1.0f), EINVAL);
+
+    CHECK_EQUAL(VocanaNormalizer_Init(&theNormalizer, kVocanaNormalizer_Unit, 4, 0.9f, 1.0f, 1.0f), 0);
+    float theState[4] = { 0.5f, 0.5f, 0.5f, 0.5f };
+    CHECK_EQUAL(VocanaNormalizer_SetState(&theNormalizer, theState, 3), EINVAL);
+    CHECK_EQUAL(VocanaNormalizer_SetState(&theNormalizer, NULL, 4), EINVAL);
+    theState[2] = 0.0f;
+    CHECK_EQUAL(VocanaNormalizer_SetState(&theNormalizer, theState, 4), EINVAL);
+    theState[2] = INFINITY;
+    CHECK_EQUAL(VocanaNormalizer_SetState(&theNormalizer, theState, 4), EINVAL);
+
+    //	nothing changed by the ones rejected
+    CHECK_EQUAL(theNormalizer.state[0], 1.0f);
+    theState[2] = 0.5f;
+    CHECK_EQUAL(VocanaNormalizer_SetState(&theNormalizer, theState, 4), 0);
+    CHECK_EQUAL(theNormalizer.state[3], 0.5f);
+    VocanaNormalizer_Teardown(&theNormalizer);
+    VocanaNormalizer_Teardown(NULL);
+}
+
+int main(void)
+{
+    RUN_TEST(test_initial_state);
+    RUN_TEST(test_matches_formulas);
+    RUN_TEST(test_moved_stream_carries_on);
+    RUN_TEST(test_unit_floor);
+    RUN_TEST(test_errors);
+    return TEST_RESULT();
+}
@@ -0,0 +1,308 @@
+/*
+     File: VocanaSTFTTests.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Host-side tests for VocanaSTFT: 481 bins at the right frequencies for 960-sample frames, perfect
+ reconstruction through analysis and synthesis with both windows, the Hops calls matching hop by
+ hop calls, and the cost per frame against the zero-padded 1024-point FFT it replaces.
+
+ */
+
+#include "VocanaSTFT.h"
+#include "VocanaDriverTestSupport.h"
+
+#include <errno.h>
+#include <string.h>
+
+#define kTest_SampleRate        48000.0
+#define kTest_FrameSize         960
+#define kTest_HopSize           480
+#define kTest_Bins              (kTest_FrameSize / 2 + 1)
+#define kTest_Hops              200
+
+static void test_bins_are_exact(void)
+{
+    VocanaSTFT theSTFT;
+    CHECK_EQUAL(VocanaSTFT_Init(&theSTFT, kTest_FrameSize, kTest_HopSize, kVocanaSTFT_Hann), 0);
+    CHECK_EQUAL(theSTFT.binCount, 481);
+
+    //	1 kHz is exactly bin 20 at 50 Hz a bin, where a 1024-point FFT would put it at 21.33
+    float theHop[kTest_HopSize];
+    float theReal[kTest_Bins];
+    float theImaginary[kTest_Bins];
+    for(uint32_t h = 0; h < 4; h++)
+    {
+        for(uint32_t n = 0; n < kTest_HopSize; n++)
+        {
+            theHop[n] = (float)sin(2.0 * M_PI * 1000.0 * (h * kTest_HopSize + n) / kTest_SampleRate);
+        }
+        VocanaSTFT_Analyze(&theSTFT, theHop, theReal, theImaginary);
+    }
+    uint32_t thePeak = 0;
+    double theTotal = 0.0;
+    for(uint32_t k = 0; k < kTest_Bins; k++)
+    {
+        double theMagnitude = hypot(theReal[k], theImaginary[k]);
+        theTotal += theMagnitude;
+        if(theMagnitude > hypot(theReal[thePeak], theImaginary[thePeak]))
+        {
+            thePeak = k;
+        }
+    }
+    CHECK_EQUAL(thePeak, 20);
+
+    //	a Hann window spreads an exact bin over it and its two neighbours and nowhere else
+    double theMain = 0.0;
+    for(uint32_t k = 19; k <= 21; k++)
+    {
+        theMain += hypot(theReal[k], theImaginary[k]);
+    }
+    CHECK(theMain > 0.999 * theTotal);
+    CHECK_CLOSE(hypot(theReal[20], theImaginary[20]), kTest_FrameSize / 4.0, 0.01);
+    VocanaSTFT_Teardown(&theSTFT);
+}
+
+static void test_reconstruction(VocanaSTFTWindow inWindow, uint32_t inFrameSize, uint32_t inHopSize)
+{
+    VocanaSTFT theSTFT;
+    CHECK_EQUAL(VocanaSTFT_Init(&theSTFT, inFrameSize, inHopSize, inWindow), 0);
+    uint32_t theLength = inHopSize * kTest_Hops;
+    float* theInput = malloc(sizeof(float) * theLength);
+    float* theOutput = malloc(sizeof(float) * theLength);
+    float* theReal = malloc(sizeof(float) * theSTFT.binCount);
+    float* theImaginary = malloc(sizeof(float) * theSTFT.binCount);
+    srand(7);
+    for(uint32_t n = 0; n < theLength; n++)
+    {
+        theInput[n] = (float)rand() / RAND_MAX - 0.5f;
+    }
+    for(uint32_t h = 0; h < kTest_Hops; h++)
+    {
+        VocanaSTFT_Analyze(&theSTFT, theInput + h * inHopSize, theReal, theImaginary);
+        VocanaSTFT_Synthesize(&theSTFT, theReal, theImaginary, theOutput + h * inHopSize);
+    }
+
+    uint32_t theLatency = VocanaSTFT_GetLatency(&theSTFT);
+    CHECK_EQUAL(theLatency, inFrameSize - inHopSize);
+    double theError = 0.0;
+    for(uint32_t n = 0; n < theLatency; n++)
+    {
+        theError = fmax(theError, fabs(theOutput[n]));
+    }
+    for(uint32_t n = theLatency; n < theLength; n++)
+    {
+        theError = fmax(theError, fabs(theOutput[n] - theInput[n - theLatency]));
+    }
+    if(theError >= 1.0e-5)
+    {
+        fprintf(stderr, "    window %d, %u/%u: error %g\n", (int)inWindow, inFrameSize, inHopSize, theError);
+    }
+    CHECK(theError < 1.0e-5);
+
+    free(theInput);
+    free(theOutput);
+    free(theReal);
+    free(theImaginary);
+    VocanaSTFT_Teardown(&theSTFT);
+}
+
+static void test_perfect_reconstruction(void)
+{
+    test_reconstruction(kVocanaSTFT_Hann, kTest_FrameSize, kTest_HopSize);
+    test_reconstruction(kVocanaSTFT_Vorbis, kTest_FrameSize, kTest_HopSize);
+    test_reconstruction(kVocanaSTFT_Hann, kTest_FrameSize, kTest_HopSize / 2);
+    test_reconstruction(kVocanaSTFT_Vorbis, 480, 120);
+}
+
+static void test_vorbis_scale(void)
+{
+    //	DeepFilterNet's features: a full-scale DC frame comes out as 2 * hop / N^2 of its window sum
+    VocanaSTFT theSTFT;
+    CHECK_EQUAL(VocanaSTFT_Init(&theSTFT, kTest_FrameSize, kTest_HopSize, kVocanaSTFT_Vorbis), 0);
+    CHECK_CLOSE(theSTFT.spectrumScale, 2.0 * kTest_HopSize / ((double)kTest_FrameSize * kTest_FrameSize), 1.0e-9);
+    float theHop[kTest_HopSize];
+    float theReal[kTest_Bins];
+    float theImaginary[kTest_Bins];
+    for(uint32_t n = 0; n < kTest_HopSize; n++)
+    {
+        theHop[n] = 1.0f;
+    }
+    VocanaSTFT_Analyze(&theSTFT, theHop, theReal, theImaginary);
+    VocanaSTFT_Analyze(&theSTFT, theHop, theReal, theImaginary);
+    double theWindowSum = 0.0;
+    for(uint32_t n = 0; n < kTest_FrameSize; n++)
+    {
+        theWindowSum += theSTFT.analysisWindow[n];
+    }
+    CHECK_CLOSE(theReal[0], theWindowSum * theSTFT.spectrumScale, 1.0e-6);
+    VocanaSTFT_Teardown(&theSTFT);
+}
+
+static void test_hops_match_single_calls(void)
+{
+    enum { kHops = 8, kStride = 496 };
+    VocanaSTFT theSingle;
+    VocanaSTFT theBlock;
+    CHECK_EQUAL(VocanaSTFT_Init(&theSingle, kTest_FrameSize, kTest_HopSize, kVocanaSTFT_Vorbis), 0);
+    CHECK_EQUAL(VocanaSTFT_Init(&theBlock, kTest_FrameSize, kTest_HopSize, kVocanaSTFT_Vorbis), 0);
+
+    static float theInput[kHops * kTest_HopSize];
+    static float theSingleReal[kHops * kStride];
+    static float theSingleImaginary[kHops * kStride];
+    static float theBlockReal[kHops * kStride];
+    static float theBlockImaginary[kHops * kStride];
+    static float theSingleOutput[kHops * kTest_HopSize];
+    static float theBlockOutput[kHops * kTest_HopSize];
+    for(uint32_t n = 0; n < kHops * kTest_HopSize; n++)
+    {
+        theInput[n] = (float)sin(0.01 * n) * (float)cos(0.37 * n);
+    }
+    for(uint32_t h = 0; h < kHops; h++)
+    {
+        VocanaSTFT_Analyze(&theSingle, theInput + h * kTest_HopSize, theSingleReal + h * kStride, theSingleImaginary + h * kStride);
+        VocanaSTFT_Synthesize(&theSingle, theSingleReal + h * kStride, theSingleImaginary + h * kStride, theSingleOutput + h * kTest_HopSize);
+    }
+    VocanaSTFT_AnalyzeHops(&theBlock, theInput, kHops, theBlockReal, theBlockImaginary, kStride);
+    VocanaSTFT_SynthesizeHops(&theBlock, theBlockReal, theBlockImaginary, kHops, kStride, theBlockOutput);
+
+    for(uint32_t h = 0; h < kHops; h++)
+    {
+        CHECK(memcmp(theSingleReal + h * kStride, theBlockReal + h * kStride, sizeof(float) * kTest_Bins) == 0);
+        CHECK(memcmp(theSingleImaginary + h * kStride, theBlockImaginary + h * kStride, sizeof(float) * kTest_Bins) == 0);
+    }
+    CHECK(memcmp(theSingleOutput, theBlockOutput, sizeof(theSingleOutput)) == 0);
+
+    //	and Reset starts the stream over
+    VocanaSTFT_Reset(&theBlock);
+    VocanaSTFT_Analyze(&theBlock, theInput, theBlockReal, theBlockImaginary);
+    CHECK(memcmp(theSingleReal, theBlockReal, sizeof(float) * kTest_Bins) == 0);
+
+    VocanaSTFT_Teardown(&theSingle);
+    VocanaSTFT_Teardown(&theBlock);
+}
+
+static void test_init_errors(void)
+{
+    VocanaSTFT theSTFT;
+    CHECK_EQUAL(VocanaSTFT_Init(&theSTFT, 962, 481, kVocanaSTFT_Hann), EINVAL);
+    CHECK_EQUAL(VocanaSTFT_Init(&theSTFT, kTest_FrameSize, 0, kVocanaSTFT_Hann), EINVAL);
+    CHECK_EQUAL(VocanaSTFT_Init(&theSTFT, kTest_FrameSize, 500, kVocanaSTFT_Hann), EINVAL);
+    CHECK_EQUAL(VocanaSTFT_Init(&theSTFT, kTest_FrameSize, 1920, kVocanaSTFT_Hann), EINVAL);
+    CHECK_EQUAL(VocanaSTFT_Init(&theSTFT, kTest_FrameSize, kTest_HopSize, (VocanaSTFTWindow)7), EINVAL);
+    CHECK(theSTFT.memory == NULL);
+    VocanaSTFT_Teardown(&theSTFT);
+}
+
+//==================================================================================================
+//	The 1024-point radix-2 FFT the Swift STFT pads its frames to, as the cost to beat
+//==================================================================================================
+
+#define kTest_PaddedSize        1024
+
+static void test_radix2_fft(float* ioReal, float* ioImaginary, const float* inCosine, const float* inSine)
+{
+    for(uint32_t i = 1, j = 0; i < kTest_PaddedSize; i++)
+    {
+        uint32_t theBit = kTest_PaddedSize >> 1;
+        for(; j & theBit; theBit >>= 1)
+        {
+            j ^= theBit;
+        }
+        j ^= theBit;
+        if(i < j)
+        {
+            float theReal = ioReal[i];
+            float theImaginary = ioImaginary[i];
+            ioReal[i] = ioReal[j];
+            ioImaginary[i] = ioImaginary[j];
+            ioReal[j] = theReal;
+            ioImaginary[j] = theImaginary;
+        }
+    }
+    for(uint32_t theLength = 2; theLength <= kTest_PaddedSize; theLength <<= 1)
+    {
+        uint32_t theStep = kTest_PaddedSize / theLength;
+        for(uint32_t i = 0; i < kTest_PaddedSize; i += theLength)
+        {
+            for(uint32_t k = 0; k < theLength / 2; k++)
+            {
+                float theCosine = inCosine[k * theStep];
+                float theSine = inSine[k * theStep];
+                uint32_t a = i + k;
+                uint32_t b = i + k + theLength / 2;
+                float theReal = ioReal[b] * theCosine - ioImaginary[b] * theSine;
+                float theImaginary = ioReal[b] * theSine + ioImaginary[b] * theCosine;
+                ioReal[b] = ioReal[a] - theReal;
+                ioImaginary[b] = ioImaginary[a] - theImaginary;
+                ioReal[a] += theReal;
+                ioImaginary[a] += theImaginary;
+            }
+        }
+    }
+}
+
+static void test_cost(void)
+{
+    enum { kIterations = 20000 };
+    VocanaSTFT theSTFT;
+    CHECK_EQUAL(VocanaSTFT_Init(&theSTFT, kTest_FrameSize, kTest_HopSize, kVocanaSTFT_Vorbis), 0);
+    float theHop[kTest_HopSize];
+    float theReal[kTest_Bins];
+    float theImaginary[kTest_Bins];
+    for(uint32_t n = 0; n < kTest_HopSize; n++)
+    {
+        theHop[n] = (float)sin(0.1 * n);
+    }
+
+    double theStart = test_now_seconds();
+    for(int i = 0; i < kIterations; i++)
+    {
+        VocanaSTFT_Analyze(&theSTFT, theHop, theReal, theImaginary);
+        VocanaSTFT_Synthesize(&theSTFT, theReal, theImaginary, theHop);
+    }
+    double theNanoseconds = (test_now_seconds() - theStart) * 1.0e9 / kIterations;
+
+    //	the padded path: window, pad, transform, and the same again on the way back
+    static float theCosine[kTest_PaddedSize / 2];
+    static float theSine[kTest_PaddedSize / 2];
+    static float thePaddedReal[kTest_PaddedSize];
+    static float thePaddedImaginary[kTest_PaddedSize];
+    for(uint32_t k = 0; k < kTest_PaddedSize / 2; k++)
+    {
+        theCosine[k] = (float)cos(-2.0 * M_PI * k / kTest_PaddedSize);
+        theSine[k] = (float)sin(-2.0 * M_PI * k / kTest_PaddedSize);
+    }
+    float theSink = 0.0f;
+    theStart = test_now_seconds();
+    for(int i = 0; i < kIterations; i++)
+    {
+        for(uint32_t theDirection = 0; theDirection < 2; theDirection++)
+        {
+            for(uint32_t n = 0; n < kTest_PaddedSize; n++)
+            {
+                thePaddedReal[n] = n < kTest_FrameSize ? theSTFT.analysisWindow[n] * theHop[n % kTest_HopSize] : 0.0f;
+                thePaddedImaginary[n] = 0.0f;
+            }
+            test_radix2_fft(thePaddedReal, thePaddedImaginary, theCosine, theSine);
+            theSink += thePaddedReal[1];
+        }
+    }
+    double thePaddedNanoseconds = (test_now_seconds() - theStart) * 1.0e9 / kIterations;
+    printf("    %.1f ns per frame analyzed and synthesized, %.1f ns zero-padded to 1024 (%g)\n", theNanoseconds, thePaddedNanoseconds, theSink * 0.0f);
+
+    //	a 10 ms hop has to leave nearly all of its time to the model
+    CHECK(theNanoseconds < 100000.0);
+    VocanaSTFT_Teardown(&theSTFT);
+}
+
+int main(void)
+{
+    RUN_TEST(test_bins_are_exact);
+    RUN_TEST(test_perfect_reconstruction);
+    RUN_TEST(test_vorbis_scale);
+    RUN_TEST(test_hops_match_single_calls);
+    RUN_TEST(test_init_errors);
+    RUN_TEST(test_cost);
+    return TEST_RESULT();
+}
@@ -0,0 +1,211 @@
+/*
+     File: VocanaSpectrogramTests.c
+
+ Copyright (C) 2024 Vocana Inc.
+
+ Host-side tests for VocanaSpectrogram: aligned rows, the imaginary plane straight after the real
+ one at every frame count, dense layouts for the models' feature shapes, frames kept across
+ Reserve and SetFrameCount, and the STFT analyzing straight into the rows.
+
+ */
+
+#include "VocanaSpectrogram.h"
+#include "VocanaSTFT.h"
+#include "VocanaDriverTestSupport.h"
+
+#include <errno.h>
+#include <string.h>
+
+#define kTest_FrameSize         960
+#define kTest_HopSize           480
+#define kTest_Bins              (kTest_FrameSize / 2 + 1)
+
+static void fill_frames(VocanaSpectrogram* ioSpectrogram)
+{
+    for(uint32_t t = 0; t < ioSpectrogram->frameCount; t++)
+    {
+        for(uint32_t k = 0; k < ioSpectrogram->binCount; k++)
+        {
+            VocanaSpectrogram_Real(ioSpectrogram, t)[k] = (float)(t * 1000 + k);
+            if(ioSpectrogram->planeCount == 2)
+            {
+                VocanaSpectrogram_Imaginary(ioSpectrogram, t)[k] = -(float)(t * 1000 + k);
+            }
+        }
+    }
+}
+
+static int frames_match(const VocanaSpectrogram* inSpectrogram, uint32_t inFrameCount)
+{
+    for(uint32_t t = 0; t < inFrameCount; t++)
+    {
+        for(uint32_t k = 0; k < inSpectrogram->binCount; k++)
+        {
+            if(VocanaSpectrogram_Real(inSpectrogram, t)[k] != (float)(t * 1000 + k))
+            {
+                return 0;
+            }
+            if(inSpectrogram->planeCount == 2 && VocanaSpectrogram_Imaginary(inSpectrogram, t)[k] != -(float)(t * 1000 + k))
+            {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+static void test_layout(void)
+{
+    VocanaSpectrogram theSpectrogram;
+    CHECK_EQUAL(VocanaSpectrogram_Init(&theSpectrogram, 10, 0, kTest_Bins, 2), 0);
+    CHECK_EQUAL(theSpectrogram.frameCount, 10);
+    CHECK_EQUAL(theSpectrogram.frameCapacity, 10);
+
+    //	481 bins pad out to 496, a whole number of 64-byte rows
+    CHECK_EQUAL(theSpectrogram.frameStride, 496);
+    CHECK(!VocanaSpectrogram_IsDense(&theSpectrogram));
+    CHECK_EQUAL(VocanaSpectrogram_GetPlaneSize(&theSpectrogram), 4960);
+    CHECK(theSpectrogram.imaginary == theSpectrogram.real + 4960);
+    for(uint32_t t = 0; t < theSpectrogram.frameCount; t++)
+    {
+        CHECK(((uintptr_t)VocanaSpectrogram_Real(&theSpectrogram, t) % kVocanaFFT_Alignment) == 0);
+        CHECK(((uintptr_t)VocanaSpectrogram_Imaginary(&theSpectrogram, t) % kVocanaFFT_Alignment) == 0);
+    }
+
+    //	starts zeroed
+    float theSum = 0.0f;
+    for(size_t n = 0; n < 2 * VocanaSpectrogram_GetPlaneSize(&theSpectrogram); n++)
+    {
+        theSum += fabsf(theSpectrogram.real[n]);
+    }
+    CHECK_EQUAL(theSum, 0.0f);
+    VocanaSpectrogram_Teardown(&theSpectrogram);
+    CHECK(theSpectrogram.memory == NULL);
+}
+
+static void test_feature_shapes_are_dense(void)
+{
+    //	[1, 2, T, 96] spectral features and [1, 1, T, 32] ERB features, wrappable as they stand
+    VocanaSpectrogram theSpectral;
+    CHECK_EQUAL(VocanaSpectrogram_Init(&theSpectral, 4, 0, 96, 2), 0);
+    CHECK(VocanaSpectrogram_IsDense(&theSpectral));
+    fill_frames(&theSpectral);
+    for(uint32_t t = 0; t < 4; t++)
+    {
+        for(uint32_t k = 0; k < 96; k++)
+        {
+            CHECK_EQUAL(theSpectral.real[t * 96 + k], (float)(t * 1000 + k));
+            CHECK_EQUAL(theSpectral.real[4 * 96 + t * 96 + k], -(float)(t * 1000 + k));
+        }
+    }
+    VocanaSpectrogram_Teardown(&theSpectral);
+
+    VocanaSpectrogram theERB;
+    CHECK_EQUAL(VocanaSpectrogram_Init(&theERB, 4, 0, 32, 1), 0);
+    CHECK(VocanaSpectrogram_IsDense(&theERB));
+    CHECK(theERB.imaginary == NULL);
+    VocanaSpectrogram_Teardown(&theERB);
+}
+
+static void test_frame_count(void)
+{
+    VocanaSpectrogram theSpectrogram;
+    CHECK_EQUAL(VocanaSpectrogram_Init(&theSpectrogram, 3, 8, 100, 2), 0);
+    CHECK_EQUAL(theSpectrogram.frameCapacity, 8);
+    fill_frames(&theSpectrogram);
+    void* theMemory = theSpectrogram.memory;
+
+    //	growing within the capacity keeps the frames, zeroes the new ones and doesn't allocate
+    CHECK_EQUAL(VocanaSpectrogram_SetFrameCount(&theSpectrogram, 6), 0);
+    CHECK(theSpectrogram.memory == theMemory);
+    CHECK(theSpectrogram.imaginary == theSpectrogram.real + VocanaSpectrogram_GetPlaneSize(&theSpectrogram));
+    CHECK(frames_match(&theSpectrogram, 3));
+    for(uint32_t t = 3; t < 6; t++)
+    {
+        for(uint32_t k = 0; k < 100; k++)
+        {
+            CHECK_EQUAL(VocanaSpectrogram_Real(&theSpectrogram, t)[k], 0.0f);
+            CHECK_EQUAL(VocanaSpectrogram_Imaginary(&theSpectrogram, t)[k], 0.0f);
+        }
+    }
+
+    //	shrinking keeps the frames that are left
+    fill_frames(&theSpectrogram);
+    CHECK_EQUAL(VocanaSpectrogram_SetFrameCount(&theSpectrogram, 2), 0);
+    CHECK(theSpectrogram.imaginary == theSpectrogram.real + VocanaSpectrogram_GetPlaneSize(&theSpectrogram));
+    CHECK(frames_match(&theSpectrogram, 2));
+
+    //	past the capacity needs Reserve, which keeps the frames too
+    CHECK_EQUAL(VocanaSpectrogram_SetFrameCount(&theSpectrogram, 9), EINVAL);
+    CHECK_EQUAL(theSpectrogram.frameCount, 2);
+    CHECK_EQUAL(VocanaSpectrogram_Reserve(&theSpectrogram, 4), 0);
+    CHECK(theSpectrogram.memory == theMemory);
+    CHECK_EQUAL(VocanaSpectrogram_Reserve(&theSpectrogram, 20), 0);
+    CHECK_EQUAL(theSpectrogram.frameCapacity, 20);
+    CHECK(frames_match(&theSpectrogram, 2));
+    CHECK_EQUAL(VocanaSpectrogram_SetFrameCount(&theSpectrogram, 20), 0);
+    CHECK(frames_match(&theSpectrogram, 2));
+
+    VocanaSpectrogram_Clear(&theSpectrogram);
+    CHECK_EQUAL(VocanaSpectrogram_Real(&theSpectrogram, 1)[5], 0.0f);
+    CHECK_EQUAL(VocanaSpectrogram_Imaginary(&theSpectrogram, 19)[99], 0.0f);
+    VocanaSpectrogram_Teardown(&theSpectrogram);
+}
+
+static void test_stft_into_rows(void)
+{
+    enum { kHops = 6 };
+    VocanaSTFT theSingle;
+    VocanaSTFT theBlock;
+    CHECK_EQUAL(VocanaSTFT_Init(&theSingle, kTest_FrameSize, kTest_HopSize, kVocanaSTFT_Vorbis), 0);
+    CHECK_EQUAL(VocanaSTFT_Init(&theBlock, kTest_FrameSize, kTest_HopSize, kVocanaSTFT_Vorbis), 0);
+    VocanaSpectrogram theSpectrogram;
+    CHECK_EQUAL(VocanaSpectrogram_Init(&theSpectrogram, kHops, 0, kTest_Bins, 2), 0);
+
+    float theInput[kHops * kTest_HopSize];
+    for(uint32_t n = 0; n < kHops * kTest_HopSize; n++)
+    {
+        theInput[n] = (float)sin(0.01 * n) + 0.25f * (float)cos(0.37 * n);
+    }
+
+    //	the rows take the spectra where they are, with nothing in between
+    VocanaSTFT_AnalyzeHops(&theBlock, theInput, kHops, theSpectrogram.real, theSpectrogram.imaginary, theSpectrogram.frameStride);
+
+    float theReal[kTest_Bins];
+    float theImaginary[kTest_Bins];
+    for(uint32_t t = 0; t < kHops; t++)
+    {
+        VocanaSTFT_Analyze(&theSingle, theInput + t * kTest_HopSize, theReal, theImaginary);
+        CHECK(memcmp(theReal, VocanaSpectrogram_Real(&theSpectrogram, t), sizeof(theReal)) == 0);
+        CHECK(memcmp(theImaginary, VocanaSpectrogram_Imaginary(&theSpectrogram, t), sizeof(theImaginary)) == 0);
+    }
+    VocanaSpectrogram_Teardown(&theSpectrogram);
+    VocanaSTFT_Teardown(&theBlock);
+    VocanaSTFT_Teardown(&theSingle);
+}
+
+static void test_init_errors(void)
+{
+    VocanaSpectrogram theSpectrogram;
+    CHECK_EQUAL(VocanaSpectrogram_Init(NULL, 1, 0, 10, 1), EINVAL);
+    CHECK_EQUAL(VocanaSpectrogram_Init(&theSpectrogram, 1, 0, 0, 1), EINVAL);
+    CHECK_EQUAL(VocanaSpectrogram_Init(&theSpectrogram, 1, 0, 10, 3), EINVAL);
+    CHECK_EQUAL(VocanaSpectrogram_Init(&theSpectrogram, kVocanaSpectrogram_MaxFrames + 1, 0, 10, 1), EINVAL);
+
+    //	no frames yet is fine, for a spectrogram filled later
+    CHECK_EQUAL(VocanaSpectrogram_Init(&theSpectrogram, 0, 0, 10, 2), 0);
+    CHECK(theSpectrogram.real != NULL);
+    CHECK_EQUAL(VocanaSpectrogram_SetFrameCount(&theSpectrogram, 1), EINVAL);
+    VocanaSpectrogram_Teardown(&theSpectrogram);
+    VocanaSpectrogram_Teardown(NULL);
+}
+
+int main(void)
+{
+    RUN_TEST(test_layout);
+    RUN_TEST(test_feature_shapes_are_dense);
+    RUN_TEST(test_frame_count);
+    RUN_TEST(test_stft_into_rows);
+    RUN_TEST(test_init_errors);
+    return TEST_RESULT();
+}
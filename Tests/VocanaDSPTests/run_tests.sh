@@ -0,0 +1,53 @@
+#!/bin/bash
+
+# Host-side tests for the native DSP library.
+# These build with any C11 (gnu11) compiler, so they run on Linux CI as well as macOS.
+
+set -e
+
+SCRIPT_DIR="$(cd "$(dirname "$0")" && pwd)"
+PROJECT_DIR="$(cd "$SCRIPT_DIR/../.." && pwd)"
+DSP_DIR="$PROJECT_DIR/Sources/VocanaDSP"
+SUPPORT_DIR="$PROJECT_DIR/Tests/VocanaAudioDriverTests"
+BUILD_DIR="$PROJECT_DIR/.build/dsp-tests"
+CC="${CC:-cc}"
+CFLAGS="${CFLAGS:--std=gnu11 -O2 -g -Wall -Wextra -Wno-unused-parameter -Wno-unknown-pragmas}"
+
+mkdir -p "$BUILD_DIR"
+
+# Each test is "<test source>:<library sources it links against>".
+TESTS=(
+    "VocanaFFTTests.c:VocanaFFT.c"
+    "VocanaSTFTTests.c:VocanaSTFT.c VocanaFFT.c"
+    "VocanaSpectrogramTests.c:VocanaSpectrogram.c VocanaSTFT.c VocanaFFT.c"
+    "VocanaERBTests.c:VocanaERB.c"
+    "VocanaNormalizerTests.c:VocanaNormalizer.c"
+    "VocanaDeepFilterTests.c:VocanaDeepFilter.c"
+    "VocanaLayersTests.c:VocanaLayers.c"
+)
+
+FAILED=0
+for ENTRY in "${TESTS[@]}"; do
+    IFS=':' read -r TEST_SOURCE DSP_SOURCES <<< "$ENTRY"
+    TEST_NAME="${TEST_SOURCE%.c}"
+
+    SOURCES=("$SCRIPT_DIR/$TEST_SOURCE")
+    for SOURCE in $DSP_SOURCES; do
+        SOURCES+=("$DSP_DIR/$SOURCE")
+    done
+
+    echo "=== Building $TEST_NAME ==="
+    $CC $CFLAGS -I "$DSP_DIR/include" -I "$SUPPORT_DIR" -o "$BUILD_DIR/$TEST_NAME" "${SOURCES[@]}" -lm
+
+    echo "=== Running $TEST_NAME ==="
+    if ! "$BUILD_DIR/$TEST_NAME"; then
+        FAILED=1
+    fi
+done
+
+if [ $FAILED -ne 0 ]; then
+    echo "❌ DSP tests failed"
+    exit 1
+fi
+
+echo "✅ All DSP tests passed"
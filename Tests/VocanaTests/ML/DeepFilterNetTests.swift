@@ -147,7 +147,99 @@ final class DeepFilterNetTests: XCTestCase {
         XCTAssertEqual(enhanced.real.count, spectrum.real.count)
         XCTAssertEqual(enhanced.imag.count, spectrum.imag.count)
     }
-    
+
+    func testStreamingDeepFilterReachesBackAcrossHops() throws {
+        let binCount = 481
+        let filter = StreamingDeepFilter(binCount: binCount)
+        let frame = Spectrogram(frameCount: 1, binCount: binCount)
+        let mask = [Float](repeating: 0.5, count: binCount)
+
+        // Only the first tap, two frames back with the centered filter
+        var coefficients = [Float](repeating: 0, count: DeepFiltering.dfBins * DeepFiltering.dfOrder)
+        for bin in 0..<DeepFiltering.dfBins {
+            coefficients[bin * DeepFiltering.dfOrder] = 1
+        }
+
+        var outputs: [[Float]] = []
+        for hop in 0..<3 {
+            for bin in 0..<binCount {
+                frame.real(0)[bin] = Float(hop + 1)
+                frame.imag(0)[bin] = -Float(hop + 1)
+            }
+            try filter.process(frame, mask: mask, coefficients: coefficients)
+            outputs.append(Array(UnsafeBufferPointer(start: frame.real(0), count: binCount)))
+        }
+
+        // Nothing two frames back yet, then the first frame as it was analyzed
+        XCTAssertEqual(outputs[0][0], 0)
+        XCTAssertEqual(outputs[2][0], 1)
+        XCTAssertEqual(frame.imag(0)[DeepFiltering.dfBins - 1], -1)
+
+        // The mask alone above the deep filtering bins
+        XCTAssertEqual(outputs[2][DeepFiltering.dfBins], 1.5)
+
+        XCTAssertThrowsError(try filter.process(frame, mask: mask, coefficients: [0, 1]))
+    }
+
+    func testPackedLayersMatchSwiftLayers() throws {
+        let linear = LinearLayer(inputSize: 96, outputSize: 37, weightInit: .xavierUniform)
+        let linearInput = (0..<96).map { sin(Float($0) * 0.37) }
+        let expectedLinear = try linear.forward(linearInput)
+        let packedLinear = try PackedLinear(linear).forward(linearInput)
+        for (packed, reference) in zip(packedLinear, expectedLinear) {
+            XCTAssertEqual(packed, reference, accuracy: 1e-4)
+        }
+
+        let conv = Conv1DLayer(inputChannels: 3, outputChannels: 5, kernelSize: 3, stride: 2, weightInit: .kaimingUniform)
+        let convInput = (0..<33).map { cos(Float($0) * 0.21) }
+        let expectedConv = try conv.forward(convInput)
+        let packedConv = try PackedConv1D(conv).forward(convInput)
+        XCTAssertEqual(packedConv.count, expectedConv.count)
+        for (packed, reference) in zip(packedConv, expectedConv) {
+            XCTAssertEqual(packed, reference, accuracy: 1e-4)
+        }
+
+        XCTAssertThrowsError(try PackedConv1D(conv).forward([1, 2, 3]))
+    }
+
+    func testNativeEncoderShapesItsOutputs() throws {
+        let session = try NativeInferenceSession(modelPath: "enc.onnx", options: SessionOptions())
+        let batch: Int64 = 2
+        let frames: Int64 = 3
+        let erbCount = Int(batch * frames) * AppConstants.erbBands
+        let specCount = Int(batch * 2 * frames) * AppConstants.dfBands
+        let inputs = [
+            "erb_feat": try TensorData(shape: [batch, 1, frames, Int64(AppConstants.erbBands)],
+                                       data: (0..<erbCount).map { sin(Float($0) * 0.13) }),
+            "spec_feat": try TensorData(shape: [batch, 2, frames, Int64(AppConstants.dfBands)],
+                                        data: (0..<specCount).map { cos(Float($0) * 0.07) })
+        ]
+
+        // The shapes the decoders and the mock session take
+        let outputs = try session.run(inputs: inputs)
+        let expectedShapes: [String: [Int64]] = [
+            "e0": [batch, 1, frames, 96], "e1": [batch, 32, frames, 48], "e2": [batch, 64, frames, 24],
+            "e3": [batch, 128, frames, 12], "emb": [batch, 256, frames, 6], "c0": [batch, frames, 256],
+            "lsnr": [batch, frames, 1]
+        ]
+        for (name, shape) in expectedShapes {
+            let output = try XCTUnwrap(outputs[name], "Missing \(name)")
+            XCTAssertEqual(output.shape, shape, name)
+            XCTAssertTrue(output.data.allSatisfy { $0.isFinite }, name)
+        }
+        XCTAssertTrue(outputs["lsnr"]!.data.allSatisfy { $0 >= -15 && $0 <= 35 })
+
+        // The GRUs carry on from the last run until their state is cleared
+        let second = try session.run(inputs: inputs)
+        XCTAssertNotEqual(second["c0"]!.data, outputs["c0"]!.data)
+        session.resetHiddenStates()
+        let restarted = try session.run(inputs: inputs)
+        XCTAssertEqual(restarted["c0"]!.data, outputs["c0"]!.data)
+        XCTAssertEqual(restarted["e3"]!.data, outputs["e3"]!.data)
+
+        XCTAssertThrowsError(try session.run(inputs: ["erb_feat": inputs["erb_feat"]!]))
+    }
+
     // MARK: - DeepFilterNet Integration Tests
     
     func testDeepFilterNetInitialization() throws {
@@ -185,7 +277,310 @@ final class DeepFilterNetTests: XCTestCase {
         XCTAssertEqual(enhanced.count, testAudio.count)
         XCTAssertTrue(enhanced.allSatisfy { !$0.isNaN && !$0.isInfinite })
     }
+
+    func testDeepFilterNetWindowGivesOneHop() throws {
+        let modelsPath = getModelsPath()
+        let denoiser = try DeepFilterNet(modelsDirectory: modelsPath)
+
+        // Every window, however many frames it spans, gives back exactly one hop
+        for length in [960, 1440, 4800, 4800 + 123] {
+            let enhanced = try denoiser.process(audio: createTestAudio(samples: length, frequency: 440))
+            XCTAssertEqual(enhanced.count, 480, "Window of \(length) samples")
+            XCTAssertTrue(enhanced.allSatisfy { $0.isFinite })
+        }
+
+        // Silence stays silent, window after window
+        let silent = try DeepFilterNet(modelsDirectory: modelsPath)
+        for _ in 0..<3 {
+            XCTAssertEqual(try silent.process(audio: [Float](repeating: 0, count: 960)), [Float](repeating: 0, count: 480))
+        }
+
+        XCTAssertThrowsError(try denoiser.process(audio: [Float](repeating: 0, count: 959)))
+    }
+
+    func testSpectrogramRowsAreAligned() {
+        // Every frame of either plane starts on a 64-byte boundary, even at 481 bins a frame
+        let spectrum = Spectrogram(frameCount: 5, binCount: 481)
+        for frame in 0..<spectrum.frameCount {
+            XCTAssertEqual(Int(bitPattern: spectrum.real(frame)) % 64, 0, "Real row \(frame)")
+            XCTAssertEqual(Int(bitPattern: spectrum.imag(frame)) % 64, 0, "Imaginary row \(frame)")
+        }
+    }
+
+    func testDeepFilterNetBufferIsAlignedWithItsInput() throws {
+        let modelsPath = getModelsPath()
+
+        // Lengths that aren't whole hops come back just as long
+        for length in [960, 1000, 4800 + 123] {
+            let testAudio = createTestAudio(samples: length, frequency: 440)
+            let enhanced = try DeepFilterNet(modelsDirectory: modelsPath).processBuffer(testAudio)
+            XCTAssertEqual(enhanced.count, length)
+        }
+
+        // Anything shorter than one window comes back as it was
+        let short = createTestAudio(samples: 500, frequency: 440)
+        XCTAssertEqual(try DeepFilterNet(modelsDirectory: modelsPath).processBuffer(short), short)
+
+        // The buffer is the stream with its latency taken off: sample i is what processHop gives
+        // `streamingLatency` samples later
+        let testAudio = createTestAudio(samples: 4800 + 123, frequency: 440)
+        let enhanced = try DeepFilterNet(modelsDirectory: modelsPath).processBuffer(testAudio)
+        let streaming = try DeepFilterNet(modelsDirectory: modelsPath)
+        let latency = streaming.streamingLatency
+        var streamed: [Float] = []
+        var padded = testAudio
+        while padded.count % 480 != 0 || padded.count < testAudio.count + latency {
+            padded.append(0)
+        }
+        for start in stride(from: 0, to: padded.count, by: 480) {
+            streamed += try streaming.processHop(Array(padded[start..<start + 480]))
+        }
+        for index in 0..<testAudio.count {
+            XCTAssertEqual(enhanced[index], streamed[index + latency], accuracy: 1e-5, "Misaligned at sample \(index)")
+        }
+    }
     
+    func testDeepFilterNetStreamingHop() throws {
+        let modelsPath = getModelsPath()
+        let denoiser = try DeepFilterNet(modelsDirectory: modelsPath)
+        
+        // 100 hops of 480 samples = 1 second, each returning exactly one hop
+        let testAudio = createTestAudio(samples: 48000, frequency: 440)
+        for hopIndex in 0..<100 {
+            let hop = Array(testAudio[hopIndex * 480..<(hopIndex + 1) * 480])
+            let enhanced = try denoiser.processHop(hop)
+            XCTAssertEqual(enhanced.count, 480)
+            XCTAssertTrue(enhanced.allSatisfy { $0.isFinite })
+        }
+        XCTAssertEqual(denoiser.streamingLatency, 480)
+        
+        // Anything but exactly one hop is refused
+        XCTAssertThrowsError(try denoiser.processHop([Float](repeating: 0, count: 960)))
+    }
+
+    func testDeepFilterNetStreamingHopMatchesReference() throws {
+        let modelsPath = getModelsPath()
+        let denoiser = try DeepFilterNet(modelsDirectory: modelsPath)
+
+        // The mock decoders give a gain of 0.8 on every bin and 0.01 on every tap, so each hop
+        // is the FIR written out over the frames as analyzed, the centered filter's three taps
+        // up to this frame, and the mask above the deep filtering bins
+        let gain: Float = 0.8
+        let tap: Float = 0.01
+        let stft = StreamingSTFT(frameSize: 960, hopSize: 480)
+        let binCount = stft.binCount
+        var history = [[Float]](repeating: [Float](repeating: 0, count: 2 * binCount), count: 3)
+        var real = [Float](repeating: 0, count: binCount)
+        var imag = [Float](repeating: 0, count: binCount)
+        var expected = [Float](repeating: 0, count: 480)
+
+        let testAudio = createTestAudio(samples: 9600, frequency: 440)
+        for hopIndex in 0..<20 {
+            let hop = Array(testAudio[hopIndex * 480..<(hopIndex + 1) * 480])
+            let output = try denoiser.processHop(hop)
+
+            hop.withUnsafeBufferPointer { input in
+                stft.analyze(input.baseAddress!, real: &real, imag: &imag)
+            }
+            history.removeFirst()
+            history.append(real + imag)
+            for bin in 0..<binCount {
+                if bin < DeepFiltering.dfBins {
+                    real[bin] = tap * history.reduce(0) { $0 + $1[bin] }
+                    imag[bin] = tap * history.reduce(0) { $0 + $1[binCount + bin] }
+                } else {
+                    real[bin] *= gain
+                    imag[bin] *= gain
+                }
+            }
+            expected.withUnsafeMutableBufferPointer { result in
+                stft.synthesize(real: real, imag: imag, into: result.baseAddress!)
+            }
+
+            XCTAssertEqual(output.count, 480)
+            let maxError = zip(output, expected).map { abs($0 - $1) }.max() ?? 0
+            XCTAssertLessThan(maxError, 1e-5, "Diverged from the reference at hop \(hopIndex)")
+        }
+    }
+    
+    func testStreamingSTFTReconstruction() {
+        let stft = StreamingSTFT(frameSize: 960, hopSize: 480)
+        XCTAssertEqual(stft.binCount, 481)
+        
+        let testAudio = createTestAudio(samples: 9600, frequency: 1000)
+        var output = [Float](repeating: 0, count: testAudio.count)
+        var real = [Float](repeating: 0, count: stft.binCount)
+        var imag = [Float](repeating: 0, count: stft.binCount)
+        for start in stride(from: 0, to: testAudio.count, by: 480) {
+            testAudio.withUnsafeBufferPointer { input in
+                stft.analyze(input.baseAddress! + start, real: &real, imag: &imag)
+            }
+            output.withUnsafeMutableBufferPointer { result in
+                stft.synthesize(real: real, imag: imag, into: result.baseAddress! + start)
+            }
+        }
+        
+        // Passed straight through, the spectra give back the input delayed by the latency
+        for index in stft.latency..<testAudio.count {
+            XCTAssertEqual(output[index], testAudio[index - stft.latency], accuracy: 1e-4)
+        }
+    }
+    
+    func testMultiStreamEngineMatchesSeparateStreams() throws {
+        let modelsPath = getModelsPath()
+        let engine = DeepFilterNet.MultiStreamEngine(denoiser: try DeepFilterNet(modelsDirectory: modelsPath))
+
+        // Each stream batched together must come out as its own DeepFilterNet gives it
+        let frequencies: [Float] = [220, 440, 1000]
+        let streams = frequencies.map { _ in engine.addStream() }
+        let references = try frequencies.map { _ in try DeepFilterNet(modelsDirectory: modelsPath) }
+        let audio = frequencies.map { createTestAudio(samples: 9600, frequency: $0) }
+        XCTAssertEqual(engine.streamCount, 3)
+
+        for hopIndex in 0..<20 {
+            let range = hopIndex * 480..<(hopIndex + 1) * 480
+            var hops: [Int: [Float]] = [:]
+            for (index, stream) in streams.enumerated() {
+                hops[stream] = Array(audio[index][range])
+            }
+            let outputs = try engine.process(hops)
+
+            for (index, stream) in streams.enumerated() {
+                let expected = try references[index].processHop(Array(audio[index][range]))
+                let output = try XCTUnwrap(outputs[stream])
+                XCTAssertEqual(output.count, 480)
+                let maxError = zip(output, expected).map { abs($0 - $1) }.max() ?? 0
+                XCTAssertLessThan(maxError, 1e-5, "Stream \(index) diverged at hop \(hopIndex)")
+            }
+        }
+
+        XCTAssertThrowsError(try engine.process([99: [Float](repeating: 0, count: 480)]))
+        XCTAssertThrowsError(try engine.process([streams[0]: [Float](repeating: 0, count: 960)]))
+    }
+
+    func testNormalizationSnapshotMovesStream() throws {
+        let modelsPath = getModelsPath()
+        let denoiser = try DeepFilterNet(modelsDirectory: modelsPath)
+        let initial = denoiser.normalizationSnapshot()
+        let audio = createTestAudio(samples: 4800, frequency: 440)
+        for hopIndex in 0..<10 {
+            _ = try denoiser.processHop(Array(audio[hopIndex * 480..<(hopIndex + 1) * 480]))
+        }
+        let snapshot = denoiser.normalizationSnapshot()
+        XCTAssertNotEqual(snapshot, initial)
+        
+        // The stream picks up in an engine where it left off
+        let engine = DeepFilterNet.MultiStreamEngine(denoiser: try DeepFilterNet(modelsDirectory: modelsPath))
+        let stream = engine.addStream()
+        XCTAssertEqual(try engine.normalizationSnapshot(of: stream), initial)
+        try engine.restoreNormalization(snapshot, to: stream)
+        XCTAssertEqual(try engine.normalizationSnapshot(of: stream), snapshot)
+        XCTAssertThrowsError(try engine.normalizationSnapshot(of: 99))
+        
+        // and survives being encoded, for a warm restart
+        let restarted = try DeepFilterNet(modelsDirectory: modelsPath)
+        let encoded = try JSONEncoder().encode(snapshot)
+        try restarted.restoreNormalization(try JSONDecoder().decode(FeatureNormalization.Snapshot.self, from: encoded))
+        XCTAssertEqual(restarted.normalizationSnapshot(), snapshot)
+        
+        denoiser.resetSync()
+        XCTAssertEqual(denoiser.normalizationSnapshot(), initial)
+    }
+    
+    func testMultiStreamEngineDeadline() throws {
+        var configuration = DeepFilterNet.MultiStreamEngine.Configuration()
+        configuration.maxWait = 0.05
+        let engine = DeepFilterNet.MultiStreamEngine(
+            denoiser: try DeepFilterNet(modelsDirectory: getModelsPath()),
+            configuration: configuration
+        )
+        let active = engine.addStream()
+        let quiet = engine.addStream()
+        let hop = createTestAudio(samples: 480, frequency: 440)
+
+        // The quiet stream never submits, so the batch runs when the hop's wait is up
+        let partial = expectation(description: "partial batch ran")
+        try engine.submit(hop, to: active) { output in
+            XCTAssertEqual(output.count, 480)
+            partial.fulfill()
+        }
+        wait(for: [partial], timeout: 1.0)
+
+        // Removing the quiet stream hands back its waiting hop as it was
+        let orphan = expectation(description: "removed stream's hop returned")
+        try engine.submit(hop, to: quiet) { output in
+            XCTAssertEqual(output, hop)
+            orphan.fulfill()
+        }
+        engine.removeStream(quiet)
+        wait(for: [orphan], timeout: 1.0)
+        XCTAssertEqual(engine.streamCount, 1)
+
+        XCTAssertThrowsError(try engine.submit(hop, to: quiet) { _ in })
+    }
+
+    func testMultiStreamEngineResubmitsFromCompletion() throws {
+        let engine = DeepFilterNet.MultiStreamEngine(denoiser: try DeepFilterNet(modelsDirectory: getModelsPath()))
+        let stream = engine.addStream()
+        let hop = createTestAudio(samples: 480, frequency: 440)
+        let hopCount = 20
+
+        // Each completion submits the stream's next hop, the way a streaming caller does; the
+        // engine's other calls work from there too
+        let finished = expectation(description: "every hop came back")
+        var completed = 0
+        var submitNext: (() -> Void)!
+        submitNext = {
+            do {
+                try engine.submit(hop, to: stream) { output in
+                    XCTAssertEqual(output.count, 480)
+                    completed += 1
+                    if completed < hopCount {
+                        submitNext()
+                    } else {
+                        XCTAssertEqual(engine.streamCount, 1)
+                        let extra = engine.addStream()
+                        engine.removeStream(extra)
+                        XCTAssertEqual(engine.streamCount, 1)
+                        finished.fulfill()
+                    }
+                }
+            } catch {
+                XCTFail("Resubmitting failed: \(error)")
+            }
+        }
+        submitNext()
+        wait(for: [finished], timeout: 5.0)
+        XCTAssertEqual(completed, hopCount)
+    }
+
+    func testMultiStreamEngineThroughput() throws {
+        let modelsPath = getModelsPath()
+        let streamCount = 16
+        let hopCount = 50
+        let hop = createTestAudio(samples: 480, frequency: 440)
+
+        let separate = try (0..<streamCount).map { _ in try DeepFilterNet(modelsDirectory: modelsPath) }
+        var start = CFAbsoluteTimeGetCurrent()
+        for _ in 0..<hopCount {
+            for denoiser in separate {
+                _ = try denoiser.processHop(hop)
+            }
+        }
+        let separateTime = CFAbsoluteTimeGetCurrent() - start
+
+        let engine = DeepFilterNet.MultiStreamEngine(denoiser: try DeepFilterNet(modelsDirectory: modelsPath))
+        let streams = (0..<streamCount).map { _ in engine.addStream() }
+        let batch = Dictionary(uniqueKeysWithValues: streams.map { ($0, hop) })
+        start = CFAbsoluteTimeGetCurrent()
+        for _ in 0..<hopCount {
+            XCTAssertEqual(try engine.process(batch).count, streamCount)
+        }
+        let batchedTime = CFAbsoluteTimeGetCurrent() - start
+
+        print("\(streamCount) streams x \(hopCount) hops: separate \(String(format: "%.2f", separateTime * 1000))ms, batched \(String(format: "%.2f", batchedTime * 1000))ms")
+    }
+
     func testDeepFilterNetPerformance() throws {
         let modelsPath = getModelsPath()
         let denoiser = try DeepFilterNet(modelsDirectory: modelsPath)
@@ -89,6 +89,36 @@ final class FeatureExtractionTests: XCTestCase {
         }
     }
     
+    func testERBLevelsAndMaskExpansion() {
+        // A 1 kHz tone is loudest in the band centered nearest 1 kHz
+        let testSignal = (0..<960).map { sin(2.0 * Float.pi * 1000.0 * Float($0) / 48000) }
+        let spectrum = Spectrogram(frameCount: 0, binCount: 481)
+        stft.transform(testSignal, into: spectrum)
+        let levels = Spectrogram(frameCount: 0, binCount: 32, complex: false)
+        erbFeatures.extractLevels(spectrum, into: levels)
+        XCTAssertEqual(levels.frameCount, 1)
+        
+        let frame = Array(UnsafeBufferPointer(start: levels.real(0), count: 32))
+        let loudest = frame.indices.max { frame[$0] < frame[$1] }!
+        let nearest = erbFeatures.centerFrequencies.indices.min {
+            abs(erbFeatures.centerFrequencies[$0] - 1000) < abs(erbFeatures.centerFrequencies[$1] - 1000)
+        }!
+        XCTAssertEqual(loudest, nearest)
+        
+        // Silence sits at the floor
+        spectrum.clear()
+        erbFeatures.extractLevels(spectrum, into: levels)
+        XCTAssertEqual(levels.real(0)[0], ERBFeatures.silenceLevel, accuracy: 1e-3)
+        
+        // Equal band gains come back as that gain in every bin, frame by frame
+        let gains = [Float](repeating: 0.5, count: 32) + [Float](repeating: 0.25, count: 32)
+        let mask = erbFeatures.expandMask(gains)
+        XCTAssertEqual(mask.count, 2 * 481)
+        for (index, gain) in mask.enumerated() {
+            XCTAssertEqual(gain, index < 481 ? 0.5 : 0.25, accuracy: 1e-6)
+        }
+    }
+    
     // MARK: - Spectral Features Tests
     
     func testSpectralFeatureExtraction() throws {
@@ -147,6 +177,43 @@ final class FeatureExtractionTests: XCTestCase {
         XCTAssertNotEqual(normalized[0][0][0], realChannel[0])
     }
     
+    func testFeatureNormalizerCarriesOverSnapshots() throws {
+        // Six frames of deep filtering bins
+        let testSignal = (0..<(960 + 5 * 480)).map { sin(2.0 * Float.pi * 440.0 * Float($0) / 48000) * (1 + Float($0) / 4000) }
+        let (real, imag) = stft.transform(testSignal)
+        let bins = try spectralFeatures.extract(spectrogramReal: real, spectrogramImag: imag)
+        func features(_ frames: Range<Int>) -> Spectrogram {
+            return Spectrogram(real: frames.map { bins[$0][0] }, imag: frames.map { bins[$0][1] }, binCount: 96)
+        }
+        
+        // All six frames in one call...
+        let whole = FeatureNormalization(alpha: 0.99)
+        let allFrames = features(0..<6)
+        whole.spectral.normalize(allFrames)
+        
+        // ...match three, then three more on another normalizer carrying on from a snapshot
+        let first = FeatureNormalization(alpha: 0.99)
+        let firstFrames = features(0..<3)
+        first.spectral.normalize(firstFrames)
+        let moved = FeatureNormalization(alpha: 0.99)
+        try moved.restore(first.snapshot())
+        XCTAssertEqual(moved.snapshot(), first.snapshot())
+        let lastFrames = features(3..<6)
+        moved.spectral.normalize(lastFrames)
+        
+        XCTAssertEqual(firstFrames.nestedReal + lastFrames.nestedReal, allFrames.nestedReal)
+        XCTAssertEqual(firstFrames.nestedImag + lastFrames.nestedImag, allFrames.nestedImag)
+        XCTAssertEqual(moved.snapshot(), whole.snapshot())
+        
+        // A snapshot of other sizes is refused, leaving the state as it was
+        let other = FeatureNormalization(erbBands: 16, dfBands: 96, alpha: 0.99)
+        XCTAssertThrowsError(try moved.restore(other.snapshot()))
+        XCTAssertEqual(moved.snapshot(), whole.snapshot())
+        
+        moved.reset()
+        XCTAssertEqual(moved.snapshot(), FeatureNormalization(alpha: 0.99).snapshot())
+    }
+    
     // MARK: - ERB Formula Validation Tests
     
     func testERBFormulaGlasbergMoore1990() {
@@ -337,4 +404,58 @@ final class FeatureExtractionTests: XCTestCase {
             XCTAssertEqual(firstSpec[0].count, 96)
         }
     }
+    
+    func testSpectrogramPipelineMatchesNestedArrays() throws {
+        // Five frames of a 440 Hz sine wave
+        let numSamples = 960 + 4 * 480
+        let testSignal = (0..<numSamples).map { sin(2.0 * Float.pi * 440.0 * Float($0) / 48000) }
+        
+        let (real, imag) = stft.transform(testSignal)
+        let spectrum = Spectrogram(frameCount: 0, binCount: 481)
+        stft.transform(testSignal, into: spectrum)
+        XCTAssertEqual(spectrum.frameCount, real.count)
+        XCTAssertEqual(spectrum.nestedReal, real)
+        XCTAssertEqual(spectrum.nestedImag, imag)
+        
+        // ERB features land as the dense [1, 1, T, 32] model input
+        let nestedErb = erbFeatures.normalize(erbFeatures.extract(spectrogramReal: real, spectrogramImag: imag), alpha: 0.9)
+        let bands = Spectrogram(frameCount: 0, binCount: 32, complex: false)
+        erbFeatures.extract(spectrum, into: bands)
+        erbFeatures.normalize(bands, alpha: 0.9)
+        XCTAssertTrue(bands.isDense)
+        let erbTensor = bands.tensor(shape: [1, 1, real.count, 32])
+        for (index, value) in nestedErb.flatMap({ $0 }).enumerated() {
+            XCTAssertEqual(erbTensor.data[index], value, accuracy: 1e-4)
+        }
+        
+        // Spectral features land as the dense [1, 2, T, 96] model input, real plane first
+        let nestedSpec = spectralFeatures.normalize(try spectralFeatures.extract(spectrogramReal: real, spectrogramImag: imag), alpha: 0.6)
+        let features = Spectrogram(frameCount: 0, binCount: 96)
+        try spectralFeatures.extract(spectrum, into: features)
+        spectralFeatures.normalize(features, alpha: 0.6)
+        let specTensor = features.tensor(shape: [1, 2, real.count, 96])
+        for (frame, channels) in nestedSpec.enumerated() {
+            for bin in 0..<96 {
+                XCTAssertEqual(specTensor.data[frame * 96 + bin], channels[0][bin], accuracy: 1e-4)
+                XCTAssertEqual(specTensor.data[(real.count + frame) * 96 + bin], channels[1][bin], accuracy: 1e-4)
+            }
+        }
+        
+        // Filtering in place matches the flattened arrays, and so does the inverse
+        let frames = real.count
+        let mask = (0..<frames * 481).map { Float($0 % 7) / 7 }
+        let coefficients = (0..<frames * 96 * 5).map { Float($0 % 5) * 0.1 }
+        let enhanced = DeepFiltering.enhance(
+            spectrum: (real: real.flatMap { $0 }, imag: imag.flatMap { $0 }),
+            mask: mask,
+            coefficients: coefficients,
+            timeSteps: frames
+        )
+        try DeepFiltering.enhance(spectrum, mask: mask, coefficients: coefficients)
+        XCTAssertEqual(spectrum.nestedReal.flatMap { $0 }, enhanced.real)
+        XCTAssertEqual(spectrum.nestedImag.flatMap { $0 }, enhanced.imag)
+        
+        let nestedAudio = stft.inverse(real: spectrum.nestedReal, imag: spectrum.nestedImag)
+        XCTAssertEqual(stft.inverse(spectrum), nestedAudio)
+    }
 }
@@ -16,6 +16,15 @@ cd "$PROJECT_DIR"
 echo "Building VocanaAudioServerPlugin..."
 if ! clang -bundle -o "$BUILD_DIR/VocanaAudioServerPlugin.bundle" \
     Sources/VocanaAudioServerPlugin/VocanaAudioServerPlugin.c \
+    Sources/VocanaAudioServerPlugin/VocanaAudioTransport.c \
+    Sources/VocanaAudioServerPlugin/VocanaChannels.c \
+    Sources/VocanaAudioServerPlugin/VocanaClientScratch.c \
+    Sources/VocanaAudioServerPlugin/VocanaMixBus.c \
+    Sources/VocanaAudioServerPlugin/VocanaPipeline.c \
+    Sources/VocanaAudioServerPlugin/VocanaProcessor.c \
+    Sources/VocanaAudioServerPlugin/VocanaPropertyTable.c \
+    Sources/VocanaAudioServerPlugin/VocanaRingBuffer.c \
+    Sources/VocanaAudioServerPlugin/VocanaSpectralGate.c \
     -I Sources/VocanaAudioServerPlugin/include \
     -framework CoreAudio \
     -framework AudioToolbox \
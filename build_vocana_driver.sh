@@ -12,6 +12,9 @@ PROJECT_NAME="VocanaVirtualDevice"
 BUNDLE_NAME="VocanaVirtualDevice.driver"
 INSTALL_PATH="/Library/Audio/Plug-Ins/HAL"
 
+# 1 to build the device with the in-process denoiser on its input (kDevice_InProcessDenoise)
+IN_PROCESS_DENOISE="${IN_PROCESS_DENOISE:-0}"
+
 # Clean previous builds
 echo "Cleaning previous builds..."
 rm -rf ".build/release/${PROJECT_NAME}.bundle"
@@ -24,28 +27,47 @@ mkdir -p "${PROJECT_NAME}.driver/Contents/Resources"
 
 # Compile driver as bundle
 echo "Compiling driver..."
-clang -c \
-    -o "${PROJECT_NAME}.o" \
-    -framework CoreAudio \
-    -framework AudioToolbox \
-    -framework CoreFoundation \
-    -framework Accelerate \
-    -DDEBUG=0 \
-    -O3 \
+DRIVER_SOURCES=(
     "Sources/VocanaAudioDriver/VocanaVirtualDevice.c"
+    "Sources/VocanaAudioDriver/VocanaRingBuffer.c"
+    "Sources/VocanaAudioDriver/VocanaRingBufferLifetime.c"
+    "Sources/VocanaAudioDriver/VocanaMixBus.c"
+    "Sources/VocanaAudioDriver/VocanaClock.c"
+    "Sources/VocanaAudioDriver/VocanaDeviceState.c"
+    "Sources/VocanaAudioDriver/VocanaDeviceRegistry.c"
+    "Sources/VocanaAudioDriver/VocanaPropertyTable.c"
+)
+if [ "${IN_PROCESS_DENOISE}" = "1" ]; then
+    DRIVER_SOURCES+=(
+        "Sources/VocanaAudioDriver/VocanaProcessor.c"
+        "Sources/VocanaAudioDriver/VocanaSpectralGate.c"
+        "Sources/VocanaAudioDriver/VocanaChannels.c"
+    )
+fi
+DRIVER_OBJECTS=()
+for SOURCE in "${DRIVER_SOURCES[@]}"; do
+    OBJECT="$(basename "${SOURCE%.c}").o"
+    clang -c \
+        -o "${OBJECT}" \
+        -DDEBUG=0 \
+        -DkDevice_InProcessDenoise="${IN_PROCESS_DENOISE}" \
+        -O3 \
+        "${SOURCE}"
+    DRIVER_OBJECTS+=("${OBJECT}")
+done
 
 # Link driver as bundle
 echo "Linking driver..."
 clang -bundle \
     -o "${PROJECT_NAME}.driver/Contents/MacOS/${PROJECT_NAME}" \
-    "${PROJECT_NAME}.o" \
+    "${DRIVER_OBJECTS[@]}" \
     -framework CoreAudio \
     -framework AudioToolbox \
     -framework CoreFoundation \
     -framework Accelerate
 
-# Clean up object file
-rm "${PROJECT_NAME}.o"
+# Clean up object files
+rm "${DRIVER_OBJECTS[@]}"
 
 # Copy Info.plist
 cp "Sources/VocanaAudioDriver/Info.plist" "${PROJECT_NAME}.driver/Contents/"